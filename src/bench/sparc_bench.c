@@ -0,0 +1,634 @@
+/**
+ * @file    sparc_bench.c
+ * @brief   This file contains the micro-benchmarks of the main SPARC kernels.
+ *
+ *          The grid, the domain decomposition and the nonlocal projectors are
+ *          set up from a normal input file with Initialize(), so the kernels are
+ *          called exactly as in an SCF run, but on random vectors instead of
+ *          orbitals. Each kernel is called reps times for each number of columns
+ *          and one line is printed per kernel and ncol:
+ *
+ *          kernel np nthreads Nx Ny Nz order ncol calls t_call(s) GB/s GFLOP/s
+ *
+ *          t_call is the wall time per call (maximum over the processes). The
+ *          bytes and flops are model counts summed over all processes (see the
+ *          bench_* functions), i.e., GB/s is the rate at which the kernel would
+ *          have to stream its operands from memory and GFLOP/s the arithmetic
+ *          rate. Sweeps over processes, threads, grids and FD orders are done by
+ *          running this program with different inputs, see
+ *          tests/bench/SPARC_bench_script.py.
+ *
+ *          Usage: mpirun -np <np> sparc_bench -name <case> [-ncol 1,8,32] [-reps 10]
+ *                 [-kernels stencil,lap,vnl,chefsi,aar,mixing,fft,xc] [-cheb_degree m]
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <assert.h>
+#include <mpi.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "isddft.h"
+#include "initialization.h"
+#include "tools.h"
+#include "lapVecRoutines.h"
+#include "lapVecRoutinesKpt.h"
+#include "nlocVecRoutines.h"
+#include "eigenSolver.h"
+#include "electrostatics.h"
+#include "linearSolver.h"
+#include "mixing.h"
+#include "exchangeCorrelation.h"
+#include "exactExchange.h"
+#include "pencilFFT.h"
+
+#define max(a,b) ((a)>(b)?(a):(b))
+
+#define BENCH_MAX_NCOL 32
+
+typedef struct _BENCH_OBJ {
+    SPARC_OBJ *pSPARC;
+    int rank;
+    int nproc;
+    int reps;
+    int nncol;
+    int ncol_list[BENCH_MAX_NCOL];
+    int cheb_degree;
+    char kernels[L_STRING];
+    int dims[3];       // process grid of dmcomm
+    int DMnx, DMny, DMnz, DMnd;
+    int active;        // 1 if this process is in a dmcomm that works on bands
+} BENCH_OBJ;
+
+
+
+/**
+ * @brief   Check if the kernel called name is selected.
+ */
+static int bench_selected(BENCH_OBJ *pB, const char *name)
+{
+    char list[L_STRING], *tok;
+    snprintf(list, L_STRING, "%s", pB->kernels);
+    for (tok = strtok(list, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        if (strcmpi(tok, name) == 0 || strcmpi(tok, "all") == 0) return 1;
+    }
+    return 0;
+}
+
+
+
+/**
+ * @brief   Reduce the time, bytes and flops of one kernel and print the line.
+ *
+ * @param t     Time spent in the kernel by this process over all calls.
+ * @param bytes Bytes moved by this process over all calls.
+ * @param flops Flops done by this process over all calls.
+ */
+static void bench_report(BENCH_OBJ *pB, const char *kernel, int ncol, double t, double bytes, double flops)
+{
+    SPARC_OBJ *pSPARC = pB->pSPARC;
+    double counts[2] = {bytes, flops};
+    MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, counts, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    if (pB->rank == 0) {
+        double tc = t / pB->reps;
+        printf("%-24s %5d %5d %5d %5d %5d %5d %5d %8d %12.5E %10.3f %10.3f\n",
+               kernel, pB->nproc, pSPARC->num_omp_threads, pSPARC->Nx, pSPARC->Ny, pSPARC->Nz,
+               pSPARC->order, ncol, pB->reps, tc,
+               t > 0.0 ? counts[0] / t * 1e-9 : 0.0, t > 0.0 ? counts[1] / t * 1e-9 : 0.0);
+        fflush(stdout);
+    }
+}
+
+
+
+/**
+ * @brief   Bytes of the halo exchange of one vector in the psi-domain.
+ */
+static double bench_halo_bytes(BENCH_OBJ *pB)
+{
+    int nproc_dmcomm = pB->dims[0] * pB->dims[1] * pB->dims[2];
+    if (nproc_dmcomm == 1) return 0.0;
+    return sizeof(double) * pB->pSPARC->order *
+           ((double) pB->DMnx * pB->DMny + pB->DMny * pB->DMnz + pB->DMnx * pB->DMnz);
+}
+
+
+
+/**
+ * @brief   Flops per grid point of the Laplacian (plus diagonal) stencil.
+ *
+ *          The orthogonal stencil takes 3 multiply-adds per radius and axis,
+ *          i.e., 9*FDn flops, plus 4 for the diagonal terms. The nonorthogonal
+ *          Laplacian adds a first derivative (3*FDn) and the corresponding second
+ *          derivative term (3*FDn) for each nonzero off-diagonal entry of the
+ *          metric.
+ */
+static double bench_lap_flops_per_point(SPARC_OBJ *pSPARC)
+{
+    int FDn = pSPARC->order / 2;
+    double flops = 9.0 * FDn + 4.0;
+    if (pSPARC->cell_typ != 0) {
+        int nmix = (fabs(pSPARC->lapcT[1]) > 1e-12) + (fabs(pSPARC->lapcT[2]) > 1e-12)
+                 + (fabs(pSPARC->lapcT[5]) > 1e-12);
+        flops += 6.0 * FDn * nmix;
+    }
+    return flops;
+}
+
+
+
+/**
+ * @brief   Benchmark of the stencil kernel on a local extended vector.
+ *
+ *          No communication is done. Counts per column: read x_ex and v, write
+ *          y; (9*FDn+4) flops per point.
+ */
+static void bench_stencil(BENCH_OBJ *pB, int ncol)
+{
+    SPARC_OBJ *pSPARC = pB->pSPARC;
+    int FDn = pSPARC->order / 2;
+    int DMnx = pB->DMnx, DMny = pB->DMny, DMnz = pB->DMnz, DMnd = pB->DMnd;
+    int DMnx_ex = DMnx + pSPARC->order, DMny_ex = DMny + pSPARC->order;
+    int DMnd_ex = DMnx_ex * DMny_ex * (DMnz + pSPARC->order);
+    int p, n, r;
+    double t = 0.0, t1, bytes = 0.0, flops = 0.0;
+
+    double *Lap_weights = (double *)malloc(3 * (FDn + 1) * sizeof(double));
+    assert(Lap_weights != NULL);
+    for (p = 0; p < FDn + 1; p++) {
+        Lap_weights[3*p  ] = -0.5 * pSPARC->D2_stencil_coeffs_x[p];
+        Lap_weights[3*p+1] = -0.5 * pSPARC->D2_stencil_coeffs_y[p];
+        Lap_weights[3*p+2] = -0.5 * pSPARC->D2_stencil_coeffs_z[p];
+    }
+    double w2_diag = Lap_weights[0] + Lap_weights[1] + Lap_weights[2] + 1.0;
+
+    if (pB->active) {
+        double *x_ex = (double *)malloc(DMnd_ex * ncol * sizeof(double));
+        double *v = (double *)malloc(DMnd * sizeof(double));
+        double *y = (double *)malloc(DMnd * ncol * sizeof(double));
+        double _Complex *xc_ex = (double _Complex *)malloc(DMnd_ex * ncol * sizeof(double _Complex));
+        double _Complex *yc = (double _Complex *)malloc(DMnd * ncol * sizeof(double _Complex));
+        assert(x_ex != NULL && v != NULL && y != NULL && xc_ex != NULL && yc != NULL);
+        SetRandMat(x_ex, DMnd_ex, ncol, -0.5, 0.5, MPI_COMM_SELF);
+        SetRandMat(v, DMnd, 1, -1.0, 0.0, MPI_COMM_SELF);
+        for (n = 0; n < DMnd_ex * ncol; n++) xc_ex[n] = x_ex[n] - 0.5 * I * x_ex[n];
+
+        for (r = 0; r < pB->reps; r++) {
+            t1 = MPI_Wtime();
+            for (n = 0; n < ncol; n++) {
+                stencil_3axis_thread_v2(
+                    x_ex + n * DMnd_ex, FDn, DMnx, DMnx_ex, DMnx * DMny, DMnx_ex * DMny_ex,
+                    0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn,
+                    Lap_weights, w2_diag, 1.0, v, y + n * DMnd
+                );
+            }
+            t += MPI_Wtime() - t1;
+        }
+        bytes = (double) pB->reps * ncol * sizeof(double) * (DMnd_ex + 2.0 * DMnd);
+        flops = (double) pB->reps * ncol * DMnd * (9.0 * FDn + 4.0);
+        bench_report(pB, "stencil_3axis", ncol, t, bytes, flops);
+
+        t = 0.0;
+        for (r = 0; r < pB->reps; r++) {
+            t1 = MPI_Wtime();
+            for (n = 0; n < ncol; n++) {
+                stencil_3axis_thread_complex_v2(
+                    xc_ex + n * DMnd_ex, FDn, DMnx, DMnx_ex, DMnx * DMny, DMnx_ex * DMny_ex,
+                    0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn,
+                    Lap_weights, w2_diag, 1.0, v, yc + n * DMnd
+                );
+            }
+            t += MPI_Wtime() - t1;
+        }
+        bytes = (double) pB->reps * ncol * (sizeof(double _Complex) * (DMnd_ex + DMnd) + sizeof(double) * DMnd);
+        flops = (double) pB->reps * ncol * DMnd * (2.0 * (9.0 * FDn + 4.0));
+        bench_report(pB, "stencil_3axis_complex", ncol, t, bytes, flops);
+
+        free(x_ex); free(v); free(y); free(xc_ex); free(yc);
+    } else {
+        bench_report(pB, "stencil_3axis", ncol, 0.0, 0.0, 0.0);
+        bench_report(pB, "stencil_3axis_complex", ncol, 0.0, 0.0, 0.0);
+    }
+    free(Lap_weights);
+}
+
+
+
+/**
+ * @brief   Benchmark of (-0.5*Lap + Veff + c) * x in the psi-domain, including
+ *          the halo exchange.
+ *
+ *          Counts per column: read x and Veff, write y, plus the halo; flops from
+ *          bench_lap_flops_per_point.
+ */
+static void bench_lap(BENCH_OBJ *pB, int ncol)
+{
+    SPARC_OBJ *pSPARC = pB->pSPARC;
+    int DMnd = pB->DMnd, r;
+    double t = 0.0, t1, bytes = 0.0, flops = 0.0;
+    const char *name = pSPARC->cell_typ == 0 ? "Lap_plus_diag_orth" : "Lap_plus_diag_nonorth";
+
+    if (pB->active) {
+        double *x = (double *)malloc(DMnd * ncol * sizeof(double));
+        double *y = (double *)malloc(DMnd * ncol * sizeof(double));
+        assert(x != NULL && y != NULL);
+        SetRandMat(x, DMnd, ncol, -0.5, 0.5, pSPARC->dmcomm);
+        for (r = 0; r < pB->reps; r++) {
+            MPI_Barrier(pSPARC->dmcomm);
+            t1 = MPI_Wtime();
+            if (pSPARC->cell_typ == 0) {
+                Lap_plus_diag_vec_mult_orth(pSPARC, DMnd, pSPARC->DMVertices_dmcomm, ncol, -0.5, 1.0, 0.1,
+                    pSPARC->Veff_loc_dmcomm, x, DMnd, y, DMnd, pSPARC->dmcomm, pB->dims);
+            } else {
+                Lap_plus_diag_vec_mult_nonorth(pSPARC, DMnd, pSPARC->DMVertices_dmcomm, ncol, -0.5, 1.0, 0.1,
+                    pSPARC->Veff_loc_dmcomm, x, DMnd, y, DMnd, pSPARC->dmcomm, pSPARC->comm_dist_graph_psi, pB->dims);
+            }
+            t += MPI_Wtime() - t1;
+        }
+        bytes = (double) pB->reps * ncol * (3.0 * sizeof(double) * DMnd + bench_halo_bytes(pB));
+        flops = (double) pB->reps * ncol * DMnd * bench_lap_flops_per_point(pSPARC);
+        free(x); free(y);
+    }
+    bench_report(pB, name, ncol, t, bytes, flops);
+}
+
+
+
+/**
+ * @brief   Benchmark of the nonlocal operator Vnl * x.
+ *
+ *          Counts per atom: read x and Chi twice, write Vnl*x (gather and
+ *          scatter of the ndc points), 4*ndc*nproj*ncol flops (inner product and
+ *          projection back), plus the reduction of the inner products.
+ */
+static void bench_vnl(BENCH_OBJ *pB, int ncol)
+{
+    SPARC_OBJ *pSPARC = pB->pSPARC;
+    int DMnd = pB->DMnd, r, ityp, iat;
+    double t = 0.0, t1, bytes = 0.0, flops = 0.0;
+
+    if (pB->active) {
+        double *x = (double *)malloc(DMnd * ncol * sizeof(double));
+        double *y = (double *)calloc(DMnd * ncol, sizeof(double));
+        assert(x != NULL && y != NULL);
+        SetRandMat(x, DMnd, ncol, -0.5, 0.5, pSPARC->dmcomm);
+        for (r = 0; r < pB->reps; r++) {
+            MPI_Barrier(pSPARC->dmcomm);
+            t1 = MPI_Wtime();
+            Vnl_vec_mult(pSPARC, DMnd, pSPARC->Atom_Influence_nloc, pSPARC->nlocProj, ncol,
+                         x, DMnd, y, DMnd, pSPARC->dmcomm);
+            t += MPI_Wtime() - t1;
+        }
+        for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+            int nproj = pSPARC->nlocProj[ityp].nproj;
+            if (!nproj) continue;
+            for (iat = 0; iat < pSPARC->Atom_Influence_nloc[ityp].n_atom; iat++) {
+                double ndc = pSPARC->Atom_Influence_nloc[ityp].ndc[iat];
+                bytes += sizeof(double) * ndc * (2.0 * nproj + 4.0 * ncol);
+                flops += 4.0 * ndc * nproj * ncol;
+            }
+        }
+        int size_dmcomm;
+        MPI_Comm_size(pSPARC->dmcomm, &size_dmcomm);
+        if (size_dmcomm > 1) bytes += sizeof(double) * pSPARC->IP_displ[pSPARC->n_atom] * ncol;
+        bytes *= pB->reps;
+        flops *= pB->reps;
+        free(x); free(y);
+    }
+    bench_report(pB, "Vnl_vec_mult", ncol, t, bytes, flops);
+}
+
+
+
+/**
+ * @brief   Benchmark of the Chebyshev filter of degree m.
+ *
+ *          Each step applies H (Laplacian and nonlocal operator) and updates the
+ *          three term recurrence, which reads two and writes one vector (2 flops
+ *          per point). X is restored outside of the timed region since the
+ *          filter overwrites it.
+ */
+static void bench_chefsi(BENCH_OBJ *pB, int ncol)
+{
+    SPARC_OBJ *pSPARC = pB->pSPARC;
+    int DMnd = pB->DMnd, r, ityp, iat, m = pB->cheb_degree;
+    double t = 0.0, t1, bytes = 0.0, flops = 0.0, t_info;
+
+    if (pB->active) {
+        double *X0 = (double *)malloc(DMnd * ncol * sizeof(double));
+        double *X = (double *)malloc(DMnd * ncol * sizeof(double));
+        double *Y = (double *)malloc(DMnd * ncol * sizeof(double));
+        assert(X0 != NULL && X != NULL && Y != NULL);
+        SetRandMat(X0, DMnd, ncol, -0.5, 0.5, pSPARC->dmcomm);
+
+        // Gershgorin bound of -0.5*Lap + Veff (Veff is in [-1,0])
+        int FDn = pSPARC->order / 2, p;
+        double eigmax = 0.0;
+        for (p = 0; p <= FDn; p++) {
+            double w = (p == 0 ? 0.5 : 1.0);
+            eigmax += w * (fabs(pSPARC->D2_stencil_coeffs_x[p]) + fabs(pSPARC->D2_stencil_coeffs_y[p])
+                        + fabs(pSPARC->D2_stencil_coeffs_z[p]));
+        }
+        if (pSPARC->cell_typ != 0) eigmax *= 2.0;
+
+        for (r = 0; r < pB->reps; r++) {
+            memcpy(X, X0, DMnd * ncol * sizeof(double));
+            MPI_Barrier(pSPARC->dmcomm);
+            t1 = MPI_Wtime();
+            ChebyshevFiltering(pSPARC, pSPARC->DMVertices_dmcomm, X, DMnd, Y, DMnd, ncol, m,
+                               0.5, eigmax, -1.0, 0, 0, pSPARC->dmcomm, &t_info);
+            t += MPI_Wtime() - t1;
+        }
+
+        double vnl_bytes = 0.0, vnl_flops = 0.0;
+        for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+            int nproj = pSPARC->nlocProj[ityp].nproj;
+            if (!nproj) continue;
+            for (iat = 0; iat < pSPARC->Atom_Influence_nloc[ityp].n_atom; iat++) {
+                double ndc = pSPARC->Atom_Influence_nloc[ityp].ndc[iat];
+                vnl_bytes += sizeof(double) * ndc * (2.0 * nproj + 4.0 * ncol);
+                vnl_flops += 4.0 * ndc * nproj * ncol;
+            }
+        }
+        bytes = (double) pB->reps * m * (ncol * (6.0 * sizeof(double) * DMnd + bench_halo_bytes(pB)) + vnl_bytes);
+        flops = (double) pB->reps * m * (ncol * DMnd * (bench_lap_flops_per_point(pSPARC) + 2.0) + vnl_flops);
+        free(X0); free(X); free(Y);
+    }
+    bench_report(pB, "ChebyshevFiltering", ncol, t, bytes, flops);
+}
+
+
+
+/**
+ * @brief   Benchmark of AAR on the Poisson equation in the phi-domain.
+ *
+ *          The tolerance is 0 so that every call does max_iter iterations. Counts
+ *          per iteration: one residual (Laplacian, 4 vectors), the Jacobi
+ *          preconditioner and the Richardson update (6 vectors); the Anderson
+ *          steps (2*m vectors every p iterations) are included on average.
+ */
+static void bench_aar(BENCH_OBJ *pB)
+{
+    SPARC_OBJ *pSPARC = pB->pSPARC;
+    int N = pSPARC->Nd_d, r, i, max_iter = 50, m = 7, p = 6;
+    double t = 0.0, t1, bytes = 0.0, flops = 0.0;
+
+    if (pSPARC->dmcomm_phi != MPI_COMM_NULL) {
+        double *x = (double *)malloc(N * sizeof(double));
+        double *b = (double *)malloc(N * sizeof(double));
+        assert(x != NULL && b != NULL);
+        SetRandMat(b, N, 1, -0.5, 0.5, pSPARC->dmcomm_phi);
+        for (r = 0; r < pB->reps; r++) {
+            for (i = 0; i < N; i++) x[i] = 0.0;
+            MPI_Barrier(pSPARC->dmcomm_phi);
+            t1 = MPI_Wtime();
+            AAR(pSPARC, poisson_residual, Jacobi_preconditioner, 0.0, N, x, b,
+                0.6, 0.6, m, p, 0.0, max_iter, pSPARC->dmcomm_phi);
+            t += MPI_Wtime() - t1;
+        }
+        int npx = pSPARC->npNdx_phi, npy = pSPARC->npNdy_phi, npz = pSPARC->npNdz_phi;
+        int nx = pSPARC->Nx / npx, ny = pSPARC->Ny / npy, nz = pSPARC->Nz / npz;
+        double halo = (npx * npy * npz > 1) ? sizeof(double) * pSPARC->order * ((double) nx*ny + ny*nz + nx*nz) : 0.0;
+        double bytes_iter = sizeof(double) * N * (10.0 + 2.0 * m / p) + halo;
+        double flops_iter = N * (bench_lap_flops_per_point(pSPARC) + 6.0 + 4.0 * m / p);
+        bytes = (double) pB->reps * max_iter * bytes_iter;
+        flops = (double) pB->reps * max_iter * flops_iter;
+        free(x); free(b);
+    }
+    bench_report(pB, "AAR_poisson", 1, t, bytes, flops);
+}
+
+
+
+/**
+ * @brief   Benchmark of one Pulay mixing step on random densities.
+ *
+ *          Counts: the history update and the weighted averages read and write
+ *          (2*m + 10) vectors of Nspden*Nd_d and take 4*m + 10 flops per entry.
+ *          The work of the preconditioner (e.g. the Kerker solve) is timed but
+ *          not counted.
+ */
+static void bench_mixing(BENCH_OBJ *pB)
+{
+    SPARC_OBJ *pSPARC = pB->pSPARC;
+    int N = pSPARC->Nd_d * pSPARC->Nspden, r, m = pSPARC->MixingHistory;
+    double t = 0.0, t1, bytes = 0.0, flops = 0.0;
+
+    if (pSPARC->dmcomm_phi != MPI_COMM_NULL) {
+        double *g = pSPARC->MixingVariable == 0 ? pSPARC->electronDens : pSPARC->Veff_loc_dmcomm_phi;
+        SetRandMat(pSPARC->mixing_hist_xk, N, 1, 0.01, 0.02, pSPARC->dmcomm_phi);
+        memcpy(pSPARC->mixing_hist_xkm1, pSPARC->mixing_hist_xk, N * sizeof(double));
+        for (r = 0; r < pB->reps; r++) {
+            SetRandMat(g, N, 1, 0.01, 0.02, pSPARC->dmcomm_phi);
+            MPI_Barrier(pSPARC->dmcomm_phi);
+            t1 = MPI_Wtime();
+            Mixing_periodic_pulay(pSPARC, r);
+            t += MPI_Wtime() - t1;
+        }
+        bytes = (double) pB->reps * sizeof(double) * N * (2.0 * m + 10.0);
+        flops = (double) pB->reps * N * (4.0 * m + 10.0);
+    }
+    bench_report(pB, "Mixing_periodic_pulay", pSPARC->Nspden, t, bytes, flops);
+}
+
+
+
+/**
+ * @brief   Benchmark of the exchange-correlation potential on a random density.
+ *
+ *          The functional of the input file is used. For metaGGA the kinetic
+ *          energy density is random as well, and for hybrids the short-range
+ *          part of the exchange is included as after the first Fock loop.
+ *          Counts: rho, e_xc and V_xc are streamed for every functional, sigma
+ *          and Dxcdgrho for GGA, tau and vxcMGGA3 for metaGGA. The work of the
+ *          gradients of the density and of Dxcdgrho * \nabla rho is timed but
+ *          not counted, and flops are not counted.
+ */
+static void bench_xc(BENCH_OBJ *pB)
+{
+    SPARC_OBJ *pSPARC = pB->pSPARC;
+    int DMnd = pSPARC->Nd_d, r;
+    double t = 0.0, t1, bytes = 0.0;
+
+    if (pSPARC->dmcomm_phi != MPI_COMM_NULL) {
+        int usefock = pSPARC->usefock, count = pSPARC->countPotentialCalculate;
+        if (usefock > 0) pSPARC->usefock = 2;
+        if (pSPARC->ixc[2]) {
+            pSPARC->countPotentialCalculate = 1;
+            SetRandMat(pSPARC->KineticTauPhiDomain, DMnd, 1, 0.01, 0.5, pSPARC->dmcomm_phi);
+        }
+        for (r = 0; r < pB->reps; r++) {
+            SetRandMat(pSPARC->electronDens, DMnd, 1, 0.01, 0.5, pSPARC->dmcomm_phi);
+            MPI_Barrier(pSPARC->dmcomm_phi);
+            t1 = MPI_Wtime();
+            Calculate_Vxc(pSPARC);
+            t += MPI_Wtime() - t1;
+        }
+        pSPARC->usefock = usefock;
+        pSPARC->countPotentialCalculate = count;
+        double narray = 3.0 + (pSPARC->isgradient ? 2.0 : 0.0) + (pSPARC->ixc[2] ? 2.0 : 0.0);
+        bytes = (double) pB->reps * sizeof(double) * DMnd * narray;
+    }
+    bench_report(pB, "Calculate_Vxc", 1, t, bytes, 0.0);
+}
+
+
+
+/**
+ * @brief   Benchmark of the FFT Poisson solver of exact exchange on ncol columns
+ *          in the psi-domain.
+ *
+ *          Counts: 5*N*log2(N) flops per column for the forward and backward
+ *          real transforms together, and 6 transposes of the half spectrum per
+ *          column.
+ */
+static void bench_fft(BENCH_OBJ *pB, int ncol)
+{
+#if defined(USE_MKL) || defined(USE_FFTW)
+    SPARC_OBJ *pSPARC = pB->pSPARC;
+    int DMnd = pB->DMnd, r, i;
+    double t = 0.0, t1, bytes = 0.0, flops = 0.0;
+    int Nxc = pSPARC->Nx / 2 + 1;
+    double Nd = (double) pSPARC->Nx * pSPARC->Ny * pSPARC->Nz;
+
+    if (pB->active) {
+        double *rhs = (double *)malloc(DMnd * ncol * sizeof(double));
+        double *Vi = (double *)malloc(DMnd * ncol * sizeof(double));
+        double *alpha = (double *)malloc(Nxc * pSPARC->Ny * pSPARC->Nz * sizeof(double));
+        assert(rhs != NULL && Vi != NULL && alpha != NULL);
+        SetRandMat(rhs, DMnd, ncol, -0.5, 0.5, pSPARC->dmcomm);
+        for (i = 0; i < Nxc * pSPARC->Ny * pSPARC->Nz; i++) alpha[i] = 1.0;
+
+        pSPARC->ExxFFT[0] = pSPARC->ExxFFT[1] = NULL;
+        for (r = 0; r < pB->reps; r++) {
+            MPI_Barrier(pSPARC->dmcomm);
+            t1 = MPI_Wtime();
+            pois_fft(pSPARC, rhs, alpha, ncol, Vi, pSPARC->dmcomm);
+            t += MPI_Wtime() - t1;
+        }
+        for (i = 0; i < 2; i++) {
+            if (pSPARC->ExxFFT[i] != NULL) {
+                Pencil_FFT_free(pSPARC->ExxFFT[i]);
+                free(pSPARC->ExxFFT[i]);
+                pSPARC->ExxFFT[i] = NULL;
+            }
+        }
+        int size_dmcomm;
+        MPI_Comm_size(pSPARC->dmcomm, &size_dmcomm);
+        bytes = (double) pB->reps * ncol * 6.0 * sizeof(double _Complex) * Nxc * pSPARC->Ny * pSPARC->Nz / size_dmcomm;
+        flops = (double) pB->reps * ncol * 5.0 * Nd * log2(Nd) / size_dmcomm;
+        free(rhs); free(Vi); free(alpha);
+    }
+    bench_report(pB, "pois_fft", ncol, t, bytes, flops);
+#else
+    if (pB->rank == 0) printf("# pois_fft skipped: compile with USE_MKL or USE_FFTW\n");
+#endif
+}
+
+
+
+/**
+ * @brief   Read the options of the benchmark, the rest is left to Initialize.
+ */
+static void bench_read_options(BENCH_OBJ *pB, int argc, char *argv[])
+{
+    int i;
+    pB->reps = 10;
+    pB->nncol = 3;
+    pB->ncol_list[0] = 1; pB->ncol_list[1] = 8; pB->ncol_list[2] = 32;
+    pB->cheb_degree = -1;
+    snprintf(pB->kernels, L_STRING, "all");
+    for (i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "-reps") == 0) {
+            pB->reps = max(1, atoi(argv[i+1]));
+        } else if (strcmp(argv[i], "-cheb_degree") == 0) {
+            pB->cheb_degree = atoi(argv[i+1]);
+        } else if (strcmp(argv[i], "-kernels") == 0) {
+            snprintf(pB->kernels, L_STRING, "%s", argv[i+1]);
+        } else if (strcmp(argv[i], "-ncol") == 0) {
+            char list[L_STRING], *tok;
+            snprintf(list, L_STRING, "%s", argv[i+1]);
+            pB->nncol = 0;
+            for (tok = strtok(list, ","); tok != NULL && pB->nncol < BENCH_MAX_NCOL; tok = strtok(NULL, ",")) {
+                if (atoi(tok) > 0) pB->ncol_list[pB->nncol++] = atoi(tok);
+            }
+        }
+    }
+}
+
+
+
+int main(int argc, char *argv[])
+{
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    SPARC_OBJ SPARC;
+    SPARC_OBJ *pSPARC = &SPARC;
+    BENCH_OBJ bench;
+    BENCH_OBJ *pB = &bench;
+    int i, periods[3], coords[3];
+
+    memset(pB, 0, sizeof(BENCH_OBJ));
+    MPI_Comm_rank(MPI_COMM_WORLD, &pB->rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &pB->nproc);
+    bench_read_options(pB, argc, argv);
+
+    SPARC.time_start = MPI_Wtime();
+    Initialize(pSPARC, argc, argv);
+    pB->pSPARC = pSPARC;
+    if (pSPARC->isGammaPoint != 1 || pSPARC->spin_typ != 0 || pSPARC->SOC_Flag || pSPARC->SQFlag || pSPARC->CyclixFlag) {
+        if (pB->rank == 0)
+            printf("ERROR: the benchmark supports spin-unpolarized gamma-point calculations only\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    if (pB->cheb_degree <= 0) pB->cheb_degree = pSPARC->ChebDegree;
+
+    pB->active = (pSPARC->dmcomm != MPI_COMM_NULL && pSPARC->bandcomm_index >= 0);
+    if (pB->active) {
+        pB->DMnx = pSPARC->Nx_d_dmcomm;
+        pB->DMny = pSPARC->Ny_d_dmcomm;
+        pB->DMnz = pSPARC->Nz_d_dmcomm;
+        pB->DMnd = pSPARC->Nd_d_dmcomm;
+        int size_dmcomm;
+        MPI_Comm_size(pSPARC->dmcomm, &size_dmcomm);
+        if (size_dmcomm > 1)
+            MPI_Cart_get(pSPARC->dmcomm, 3, pB->dims, periods, coords);
+        else
+            pB->dims[0] = pB->dims[1] = pB->dims[2] = 1;
+        SetRandMat(pSPARC->Veff_loc_dmcomm, pB->DMnd, 1, -1.0, 0.0, pSPARC->dmcomm);
+    }
+
+    // nonlocal projectors in the psi-domain, as in Calculate_EGS_elecDensEnergy
+    GetInfluencingAtoms_nloc(pSPARC, &pSPARC->Atom_Influence_nloc, pSPARC->DMVertices_dmcomm,
+                             pSPARC->bandcomm_index < 0 ? MPI_COMM_NULL : pSPARC->dmcomm);
+    CalculateNonlocalProjectors(pSPARC, &pSPARC->nlocProj, pSPARC->Atom_Influence_nloc,
+                                pSPARC->DMVertices_dmcomm, pSPARC->bandcomm_index < 0 ? MPI_COMM_NULL : pSPARC->dmcomm);
+
+    if (pB->rank == 0) {
+        printf("# SPARC kernel benchmark, %d calls per kernel, Chebyshev degree %d\n", pB->reps, pB->cheb_degree);
+        printf("# kernel                    np  nthr    Nx    Ny    Nz order  ncol    calls    t_call(s)       GB/s    GFLOP/s\n");
+    }
+
+    for (i = 0; i < pB->nncol; i++) {
+        int ncol = pB->ncol_list[i];
+        if (bench_selected(pB, "stencil")) bench_stencil(pB, ncol);
+        if (bench_selected(pB, "lap"))     bench_lap(pB, ncol);
+        if (bench_selected(pB, "vnl"))     bench_vnl(pB, ncol);
+        if (bench_selected(pB, "chefsi"))  bench_chefsi(pB, ncol);
+        if (bench_selected(pB, "fft"))     bench_fft(pB, ncol);
+    }
+    if (bench_selected(pB, "aar"))    bench_aar(pB);
+    if (bench_selected(pB, "mixing")) bench_mixing(pB);
+    if (bench_selected(pB, "xc"))     bench_xc(pB);
+
+    MPI_Finalize();
+    return 0;
+}
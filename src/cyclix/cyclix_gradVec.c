@@ -20,6 +20,7 @@
 #include "gradVecRoutines.h"
 #include "gradVecRoutinesKpt.h"
 #include "isddft.h"
+#include "haloExchange.h"
 #include "assert.h"
 
 
@@ -313,7 +314,7 @@ void Gradient_vec_dir_rotfac(const SPARC_OBJ *pSPARC, const int DMnd, const int
     int count, n, k, j, i, nshift, kshift, jshift;
     int nbrcount, nbr_i;
     
-    MPI_Request request;
+    HALO_PLAN_OBJ *halo = NULL;
     double *x_in, *x_out;
     x_in = x_out = NULL;
 
@@ -332,24 +333,16 @@ void Gradient_vec_dir_rotfac(const SPARC_OBJ *pSPARC, const int DMnd, const int
     }
 
     if(nproc > 1){
-        int nd_in = ncol * pSPARC->order * (isDir[0] * DMny * DMnz + DMnx * isDir[1] * DMnz + DMnxny * isDir[2]);
-        int nd_out = nd_in;
-        x_in  = (double *)calloc( nd_in, sizeof(double));
-        x_out = (double *)malloc( nd_out * sizeof(double)); // no need to init x_out
-
-        int sendcounts[6], sdispls[6], recvcounts[6], rdispls[6];
-        // set up parameters for MPI_Ineighbor_alltoallv
-        // TODO: do this in Initialization to save computation time!
-        sendcounts[0] = sendcounts[1] = recvcounts[0] = recvcounts[1] = ncol * FDn * (DMny * DMnz * isDir[0]);
-        sendcounts[2] = sendcounts[3] = recvcounts[2] = recvcounts[3] = ncol * FDn * (DMnx * DMnz * isDir[1]);
-        sendcounts[4] = sendcounts[5] = recvcounts[4] = recvcounts[5] = ncol * FDn * (DMnxny * isDir[2]);
-    
-        rdispls[0] = sdispls[0] = 0;
-        rdispls[1] = sdispls[1] = sdispls[0] + sendcounts[0];
-        rdispls[2] = sdispls[2] = sdispls[1] + sendcounts[1];
-        rdispls[3] = sdispls[3] = sdispls[2] + sendcounts[2];
-        rdispls[4] = sdispls[4] = sdispls[3] + sendcounts[3];
-        rdispls[5] = sdispls[5] = sdispls[4] + sendcounts[4];
+        // number of halo values per vector exchanged with each neighbor, only along dir
+        int nbr_size[6];
+        nbr_size[0] = nbr_size[1] = FDn * (DMny * DMnz * isDir[0]);
+        nbr_size[2] = nbr_size[3] = FDn * (DMnx * DMnz * isDir[1]);
+        nbr_size[4] = nbr_size[5] = FDn * (DMnxny * isDir[2]);
+
+        // the buffers are owned by the plan, x_in is 0 for the missing neighbors
+        halo = Halo_plan_get(comm, MPI_DOUBLE, 6, nbr_size, ncol);
+        x_in  = (double *) halo->recvbuf;
+        x_out = (double *) halo->sendbuf;
 
         count = 0;
         for (nbr_i = dir*2; nbr_i < dir*2+2; nbr_i++) {
@@ -402,16 +395,15 @@ void Gradient_vec_dir_rotfac(const SPARC_OBJ *pSPARC, const int DMnd, const int
         }    
 
         // first transfer info. to/from neighbor processors
-        MPI_Ineighbor_alltoallv(x_out, sendcounts, sdispls, MPI_DOUBLE, 
-                                x_in, recvcounts, rdispls, MPI_DOUBLE, 
-                                comm, &request); // non-blocking
+        Halo_plan_start(halo); // non-blocking
     }                             
  
     // while the non-blocking communication is undergoing, compute Dx which only requires values from local memory
     int pshift = 0, pshift_ex = 0;
     double *D1_stencil_coeffs_dim;
     D1_stencil_coeffs_dim = (double *)malloc((FDn + 1) * sizeof(double));
-    double *x_ex = (double *)malloc(ncol * DMnd_ex * sizeof(double));
+    // the extended domain is kept by the plan
+    double *x_ex = (double *)Halo_ex_buffer(comm, halo, ncol * DMnd_ex * sizeof(double));
     D1_stencil_coeffs_dim[0] = 0.0;
     
     int p;
@@ -492,7 +484,7 @@ void Gradient_vec_dir_rotfac(const SPARC_OBJ *pSPARC, const int DMnd, const int
         kstart[5] = DMnz+exDir[2]; kend[5] = DMnz+2*exDir[2];
 
         // make sure receive buffer is ready
-        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        Halo_plan_wait(halo);
 
         // copy receive buffer into extended domain
         count = 0;
@@ -510,8 +502,6 @@ void Gradient_vec_dir_rotfac(const SPARC_OBJ *pSPARC, const int DMnd, const int
                 }
             }
         }
-        free(x_out);
-        free(x_in);
     } else {
         int istart_in[6], iend_in[6], jstart_in[6], jend_in[6], kstart_in[6], kend_in[6];
         istart_in[0] = 0;             iend_in[0] = exDir[0];        
@@ -633,7 +623,7 @@ void Gradient_vec_dir_rotfac(const SPARC_OBJ *pSPARC, const int DMnd, const int
         }
     }
     
-    free(x_ex);
+    if (nproc > 1) Halo_plan_release(halo);
     free(D1_stencil_coeffs_dim);
 
 }
@@ -44,8 +44,10 @@ void stencil_4comp_cyclix(
     double dx = pSPARC->delta_x;
     double c0 = pSPARC->D2_stencil_coeffs_y[0] * a;
 
-    for (k = z_X1_spos, kk = z_X_spos; k < z_X1_epos; k++, kk++)
+    #pragma omp parallel for private(i, j, jj, kk, r) schedule(static)
+    for (k = z_X1_spos; k < z_X1_epos; k++)
     {
+        kk = z_X_spos + (k - z_X1_spos);
         int kshift_X1 = k * stride_z_X1;
         int kshift_X  = kk * stride_z_X;
         for (j = y_X1_spos, jj = y_X_spos; j < y_X1_epos; j++, jj++)
@@ -107,8 +109,11 @@ void stencil_5comp_cyclix(
     double tw2 = pSPARC->twist * pSPARC->twist;
     double c0 = pSPARC->D2_stencil_coeffs_y[0] * a;
 
-    for (k = z_X1_spos, kk = z_X_spos, kkk = z_DX_spos; k < z_X1_epos; k++, kk++, kkk++)
+    #pragma omp parallel for private(i, j, jj, kk, jjj, kkk, r) schedule(static)
+    for (k = z_X1_spos; k < z_X1_epos; k++)
     {
+        kk = z_X_spos + (k - z_X1_spos);
+        kkk = z_DX_spos + (k - z_X1_spos);
         int kshift_X1 = k * stride_z_X1;
         int kshift_X  = kk * stride_z_X;
         int kshift_DX = kkk * stride_z_DX;
@@ -174,8 +179,10 @@ void stencil_4comp_kpt_cyclix(
     double c0 = pSPARC->D2_stencil_coeffs_y[0] * a;
     double xin = pSPARC->xin + DMVertices[0] * pSPARC->delta_x;
  
-    for (k = z_X1_spos, kk = z_X_spos; k < z_X1_epos; k++, kk++)
+    #pragma omp parallel for private(i, j, jj, kk, r) schedule(static)
+    for (k = z_X1_spos; k < z_X1_epos; k++)
     {
+        kk = z_X_spos + (k - z_X1_spos);
         int kshift_X1 = k * stride_z_X1;
         int kshift_X  = kk * stride_z_X;
         for (j = y_X1_spos, jj = y_X_spos; j < y_X1_epos; j++, jj++)
@@ -240,8 +247,11 @@ void stencil_5comp_kpt_cyclix(
     double c0 = pSPARC->D2_stencil_coeffs_y[0] * a;
     double xin = pSPARC->xin + DMVertices[0] * pSPARC->delta_x;
 
-    for (k = z_X1_spos, kk = z_X_spos, kkk = z_DX_spos; k < z_X1_epos; k++, kk++, kkk++)
+    #pragma omp parallel for private(i, j, jj, kk, jjj, kkk, r) schedule(static)
+    for (k = z_X1_spos; k < z_X1_epos; k++)
     {
+        kk = z_X_spos + (k - z_X1_spos);
+        kkk = z_DX_spos + (k - z_X1_spos);
         int kshift_X1 = k * stride_z_X1;
         int kshift_X  = kk * stride_z_X;
         int kshift_DX = kkk * stride_z_DX;
@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
 #include <assert.h>
 #include <mpi.h>
 /* BLAS and LAPACK routines */
@@ -47,6 +48,8 @@
 #include "parallelization.h"
 #include "linearAlgebra.h"
 #include "cyclix_tools.h"
+#include "mixedPrecisionFilter.h"
+#include "timing.h"
 
 #ifdef SPARCX_ACCEL
 #include "accel.h"
@@ -54,6 +57,13 @@
 
 #define TEMP_TOL 1e-12
 
+// filtered subspace iteration for the top states in the CS mode
+#define CS_FILTER_DEGREE  8
+#define CS_FILTER_MAXIT   10
+#define CS_FILTER_NBUF    5
+#define CS_FILTER_TOL     1e-9
+#define CS_LANCZOS_STEPS  40
+
 #define max(a,b) ((a)>(b)?(a):(b))
 #define min(a,b) ((a)<(b)?(a):(b))
 
@@ -154,7 +164,10 @@ void eigSolve_CheFSI(int rank, SPARC_OBJ *pSPARC, int SCFcount, double error) {
     int count, spn_i;    
     double t1, t2, lambda_cutoff = 0.0;
     double *x0 = pSPARC->Lanczos_x0;
-    if (pSPARC->elecgs_Count > 0 || pSPARC->usefock > 1) pSPARC->rhoTrigger = pSPARC->Nchefsi;
+    if (pSPARC->elecgs_Count > 0 || pSPARC->usefock > 1 || pSPARC->SCFRestartRead) pSPARC->rhoTrigger = pSPARC->Nchefsi;
+    // filter in single precision while the SCF error is large
+    pSPARC->CheFSI_UseSP = CheFSI_use_single_precision(pSPARC, error);
+    timing_region_begin("eigSolve_CheFSI");
 
     if (SCFcount == 0) {
         pSPARC->npl_max = pSPARC->ChebDegree; 
@@ -182,8 +195,13 @@ void eigSolve_CheFSI(int rank, SPARC_OBJ *pSPARC, int SCFcount, double error) {
         // 1) Find Chebyshev filtering bounds
         // 2) Chebyshev filtering,          3) Projection, 
         // 4) Solve projected eigenproblem, 5) Subspace rotation
+        // extrapolated orbitals are filtered with 3/4 of the degree (at least npl_min)
+        int ChebDegree = pSPARC->ChebDegree;
+        if (pSPARC->OrbExtrapStep)
+            pSPARC->ChebDegree = max(pSPARC->npl_min, 3 * ChebDegree / 4);
         for (spn_i = 0; spn_i < pSPARC->Nspin_spincomm; spn_i++)
             CheFSI(pSPARC, lambda_cutoff, x0, count, 0, spn_i);
+        pSPARC->ChebDegree = ChebDegree;
         
         t1 = MPI_Wtime();
         
@@ -224,6 +242,18 @@ void eigSolve_CheFSI(int rank, SPARC_OBJ *pSPARC, int SCFcount, double error) {
             }
         }
 
+        if (pSPARC->CSFlag == 1) {
+            // the states below the top CS_NTOP ones are assumed to be fully occupied
+            int Nb = pSPARC->Nstates - pSPARC->CS_Ntop;
+            for (spn_i = 0; spn_i < pSPARC->Nspin_spincomm; spn_i++) {
+                if (!pSPARC->CS_warned && pSPARC->occ[spn_i*pSPARC->Nstates + Nb] < 1.0 - 1e-6) {
+                    if (!rank) printf("WARNING: the lowest of the top CS_NTOP states is partially occupied, "
+                                      "consider increasing CS_NTOP.\n");
+                    pSPARC->CS_warned = 1;
+                }
+            }
+        }
+
         t2 = MPI_Wtime();
 #ifdef DEBUG
         if (!rank) {
@@ -260,6 +290,7 @@ void eigSolve_CheFSI(int rank, SPARC_OBJ *pSPARC, int SCFcount, double error) {
 #endif
         }
     }
+    timing_region_end("eigSolve_CheFSI");
 }
 
 
@@ -274,7 +305,9 @@ void CheFSI(SPARC_OBJ *pSPARC, double lambda_cutoff, double *x0, int count, int
     MPI_Comm_size(pSPARC->kptcomm, &nproc_kptcomm);
     
     // determine the constants for performing chebyshev filtering
+    timing_region_begin("Chebyshevfilter_constants");
     Chebyshevfilter_constants(pSPARC, x0, &lambda_cutoff, &pSPARC->eigmin[spn_i], &pSPARC->eigmax[spn_i], count, k, spn_i);
+    timing_region_end("Chebyshevfilter_constants");
     
 #ifdef DEBUG
             if (!rank && spn_i == 0) {
@@ -301,6 +334,7 @@ void CheFSI(SPARC_OBJ *pSPARC, double lambda_cutoff, double *x0, int count, int
     
     // ** Chebyshev filtering ** //
     t1 = MPI_Wtime();
+    timing_region_begin("ChebyshevFiltering");
     #ifdef USE_EVA_MODULE
     if (CheFSI_use_EVA == 1)
     {
@@ -321,6 +355,14 @@ void CheFSI(SPARC_OBJ *pSPARC, double lambda_cutoff, double *x0, int count, int
 		}
 		else
 		#endif // SPARCX_ACCEL
+        if (pSPARC->CheFSI_UseSP)
+        {
+            ChebyshevFiltering_mixed(pSPARC, pSPARC->DMVertices_dmcomm, pSPARC->Xorb + spn_i*DMnd, DMndsp,
+                           pSPARC->Yorb + spn_i*DMnd, DMndsp, pSPARC->Nband_bandcomm, 
+                           pSPARC->ChebDegree, lambda_cutoff, pSPARC->eigmax[spn_i], pSPARC->eigmin[spn_i], k, spn_i, 
+                           pSPARC->dmcomm, &t_temp);
+        }
+        else
         {
             ChebyshevFiltering(pSPARC, pSPARC->DMVertices_dmcomm, pSPARC->Xorb + spn_i*DMnd, DMndsp,
                            pSPARC->Yorb + spn_i*DMnd, DMndsp, pSPARC->Nband_bandcomm, 
@@ -330,6 +372,7 @@ void CheFSI(SPARC_OBJ *pSPARC, double lambda_cutoff, double *x0, int count, int
     #ifdef USE_EVA_MODULE
     }
     #endif
+    timing_region_end("ChebyshevFiltering");
     t2 = MPI_Wtime();
     #ifdef DEBUG
     if(!rank && spn_i == 0) 
@@ -338,6 +381,7 @@ void CheFSI(SPARC_OBJ *pSPARC, double lambda_cutoff, double *x0, int count, int
     #endif
     
     t1 = MPI_Wtime();
+    timing_region_begin("Project_Hamiltonian");
     // ** calculate projected Hamiltonian and overlap matrix ** //
     #ifdef USE_DP_SUBEIG
     if (pSPARC->StandardEigenFlag == 1) {
@@ -364,16 +408,21 @@ void CheFSI(SPARC_OBJ *pSPARC, double lambda_cutoff, double *x0, int count, int
     Project_Hamiltonian(pSPARC, pSPARC->DMVertices_dmcomm, pSPARC->Yorb + spn_i*DMnd, DMndsp, pSPARC->Xorb + spn_i*DMnd, DMndsp,
                         pSPARC->Hp, pSPARC->Mp, k, spn_i, pSPARC->dmcomm);
     #endif
+    timing_region_end("Project_Hamiltonian");
     t2 = MPI_Wtime();
     #ifdef DEBUG
     if(!rank && spn_i == 0) printf("Total time for projection: %.3f ms\n", (t2-t1)*1e3);
     #endif
 
     t1 = MPI_Wtime();
+    timing_region_begin("Solve_Generalized_EigenProblem");
     // ** solve the subspace eigenvalue problem Hp * Q = Mp * Q * Lambda **//
     // ** or Hp * Q = Q * Lambda, if StandardEigenFlag = 1 ** //
     #ifdef USE_DP_SUBEIG
-    DP_Solve_Generalized_EigenProblem(pSPARC, spn_i);
+    if (pSPARC->CSFlag == 1)
+        DP_CS_Solve_EigenProblem(pSPARC, spn_i);
+    else
+        DP_Solve_Generalized_EigenProblem(pSPARC, spn_i);
     #else
     Solve_Generalized_EigenProblem(pSPARC, k, spn_i);
     #endif    
@@ -390,6 +439,7 @@ void CheFSI(SPARC_OBJ *pSPARC, double lambda_cutoff, double *x0, int count, int
                   MPI_DOUBLE, 0, pSPARC->kptcomm); // TODO: bcast in blacscomm if possible
     }
     #endif //SPARCX_ACCEL
+    timing_region_end("Solve_Generalized_EigenProblem");
     
     t2 = MPI_Wtime();
     #ifdef DEBUG
@@ -415,9 +465,13 @@ void CheFSI(SPARC_OBJ *pSPARC, double lambda_cutoff, double *x0, int count, int
     #endif
 
     t1 = MPI_Wtime();
+    timing_region_begin("Subspace_Rotation");
     // ** subspace rotation ** //
     #ifdef USE_DP_SUBEIG
-    DP_Subspace_Rotation(pSPARC, pSPARC->Xorb + spn_i*DMnd);
+    if (pSPARC->CSFlag == 1)
+        DP_CS_Subspace_Rotation(pSPARC, pSPARC->Xorb + spn_i*DMnd);
+    else
+        DP_Subspace_Rotation(pSPARC, pSPARC->Xorb + spn_i*DMnd);
     #else
     // find Y * Q, store the result in Xorb (band+domain) and Xorb_BLCYC (block cyclic format)
     Subspace_Rotation(pSPARC, pSPARC->Yorb_BLCYC, pSPARC->Q, 
@@ -427,6 +481,7 @@ void CheFSI(SPARC_OBJ *pSPARC, double lambda_cutoff, double *x0, int count, int
         free(pSPARC->Yorb_BLCYC); pSPARC->Yorb_BLCYC = NULL;
     }
     #endif
+    timing_region_end("Subspace_Rotation");
     
     t2 = MPI_Wtime();
     #ifdef DEBUG
@@ -706,7 +761,7 @@ void Chebyshevfilter_constants(
         } 
     }
 
-    if (pSPARC->elecgs_Count == 0 && count == 0) {
+    if (pSPARC->elecgs_Count == 0 && count == 0 && !pSPARC->SCFRestartRead) {
         *lambda_cutoff = 0.5 * (*eigmin + *eigmax);
     } else{
         //*lambda_cutoff = pSPARC->Efermi + log(1e6-1) / pSPARC->Beta + 0.1;
@@ -917,6 +972,12 @@ void init_DP_CheFSI(SPARC_OBJ *pSPARC)
     DP_CheFSI->Mp_local   = (double*) malloc(Ns_dp_2_msize);
     DP_CheFSI->Hp_local   = (double*) malloc(Ns_dp_2_msize);
     DP_CheFSI->eig_vecs   = (double*) malloc(Ns_dp_2_msize);
+    DP_CheFSI->cs_tau     = NULL;
+    DP_CheFSI->cs_warm[0] = DP_CheFSI->cs_warm[1] = 0;
+    if (pSPARC->CSFlag == 1) {
+        DP_CheFSI->cs_tau = (double*) malloc(sizeof(double) * Ns_dp);
+        assert(DP_CheFSI->cs_tau != NULL);
+    }
     assert(DP_CheFSI->Y_dp != NULL && DP_CheFSI->HY_dp != NULL);
     assert(DP_CheFSI->Y_packbuf  != NULL);
     assert(DP_CheFSI->HY_packbuf != NULL);
@@ -1438,6 +1499,340 @@ void DP_Subspace_Rotation(SPARC_OBJ *pSPARC, double *Psi_rot)
     #endif
 }
 
+/**
+ * @brief   Top nt eigenpairs of the standard form projected Hamiltonian Hs (upper
+ *          triangle, size ns) by Chebyshev filtered subspace iteration on Hs.
+ *
+ *          After a CS subspace rotation the top states are the last columns of the
+ *          next filtered block, so the last nt + buffer unit vectors are a good
+ *          starting guess and a few iterations of O(ns^2 * nt) cost are enough,
+ *          instead of the O(ns^3) tridiagonal reduction. The filter damps
+ *          [eigmin, cut], where the cutoff is the lowest Ritz value of the block,
+ *          the bounds of Hs come from a short Lanczos run.
+ *
+ * @return  0 if all top residuals are below tol, then w (ascending), Z (ns x nt)
+ *          and the lowest eigenvalue estimate *eigmin are set.
+ */
+static int CS_filtered_top_eigenpairs(
+    const double *Hs, int ns, int nt, double tol, double *eigmin, double *w, double *Z)
+{
+    int nb = min(ns, nt + max(CS_FILTER_NBUF, nt / 10));
+    int k = min(ns, CS_LANCZOS_STEPS);
+    int i, j, it, info, conv = 0;
+    double lmin, lmax, cut;
+
+    // bounds of the spectrum of Hs
+    double *q = (double *)calloc(3 * ns, sizeof(double));
+    double *alpha = (double *)malloc(k * sizeof(double));
+    double *beta = (double *)malloc(k * sizeof(double));
+    assert(q != NULL && alpha != NULL && beta != NULL);
+    double *q0 = q, *q1 = q + ns, *r = q + 2*ns;
+    for (i = 0; i < ns; i++) q1[i] = 1.0 + (double) i / ns;
+    double vscal = 1.0 / cblas_dnrm2(ns, q1, 1);
+    for (i = 0; i < ns; i++) q1[i] *= vscal;
+    double bprev = 0.0;
+    for (j = 0; j < k; j++) {
+        cblas_dsymv(CblasColMajor, CblasUpper, ns, 1.0, Hs, ns, q1, 1, 0.0, r, 1);
+        alpha[j] = cblas_ddot(ns, q1, 1, r, 1);
+        for (i = 0; i < ns; i++) r[i] -= alpha[j] * q1[i] + bprev * q0[i];
+        beta[j] = bprev = cblas_dnrm2(ns, r, 1);
+        if (bprev < TEMP_TOL) { k = j + 1; break; }
+        for (i = 0; i < ns; i++) { q0[i] = q1[i]; q1[i] = r[i] / bprev; }
+    }
+    double bres = fabs(beta[k-1]);
+    LAPACKE_dsterf(k, alpha, beta);
+    lmin = alpha[0];
+    lmax = alpha[k-1] + bres;
+    free(q); free(alpha); free(beta);
+
+    double *X  = (double *)calloc((size_t)ns * nb, sizeof(double));
+    double *Y  = (double *)malloc((size_t)ns * nb * sizeof(double));
+    double *HY = (double *)malloc((size_t)ns * nb * sizeof(double));
+    double *G  = (double *)malloc((size_t)nb * nb * sizeof(double));
+    double *M  = (double *)malloc((size_t)nb * nb * sizeof(double));
+    double *ev = (double *)malloc(nb * sizeof(double));
+    assert(X != NULL && Y != NULL && HY != NULL && G != NULL && M != NULL && ev != NULL);
+
+    // starting guess and cutoff from the trailing nb x nb block
+    for (j = 0; j < nb; j++) {
+        X[(size_t)j*ns + ns-nb+j] = 1.0;
+        for (i = 0; i <= j; i++) G[j*nb+i] = Hs[(size_t)(ns-nb+j)*ns + ns-nb+i];
+    }
+    info = LAPACKE_dsyevd(LAPACK_COL_MAJOR, 'N', 'U', nb, G, nb, ev);
+    cut = ev[0];
+
+    for (it = 0; it < CS_FILTER_MAXIT && info == 0 && cut > lmin && cut < lmax; it++) {
+        // Chebyshev filter of -Hs, damping [-cut, -lmin], scaled at -lmax
+        double e = 0.5 * (cut - lmin), c = 0.5 * (cut + lmin);
+        double sigma = e / (c - lmax), gamma = 2.0 / sigma, sigma2;
+        cblas_dsymm(CblasColMajor, CblasLeft, CblasUpper, ns, nb, 1.0, Hs, ns, X, ns, 0.0, Y, ns);
+        vscal = -sigma / e;
+        for (size_t n = 0; n < (size_t)ns*nb; n++) Y[n] = vscal * (Y[n] - c * X[n]);
+        for (j = 1; j < CS_FILTER_DEGREE; j++) {
+            sigma2 = 1.0 / (gamma - sigma);
+            cblas_dsymm(CblasColMajor, CblasLeft, CblasUpper, ns, nb, 1.0, Hs, ns, Y, ns, 0.0, HY, ns);
+            vscal = -2.0 * sigma2 / e;
+            double vscal2 = sigma * sigma2;
+            for (size_t n = 0; n < (size_t)ns*nb; n++) {
+                double ynew = vscal * (HY[n] - c * Y[n]) - vscal2 * X[n];
+                X[n] = Y[n];
+                Y[n] = ynew;
+            }
+            sigma = sigma2;
+        }
+
+        // Rayleigh-Ritz on the filtered block, X = Y * G and HY = Hs * X
+        cblas_dsymm(CblasColMajor, CblasLeft, CblasUpper, ns, nb, 1.0, Hs, ns, Y, ns, 0.0, HY, ns);
+        cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, nb, nb, ns, 1.0, Y, ns, HY, ns, 0.0, G, nb);
+        cblas_dsyrk(CblasColMajor, CblasUpper, CblasTrans, nb, ns, 1.0, Y, ns, 0.0, M, nb);
+        info = LAPACKE_dsygvd(LAPACK_COL_MAJOR, 1, 'V', 'U', nb, G, nb, M, nb, ev);
+        if (info != 0) break;
+        cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, ns, nb, nb, 1.0, Y, ns, G, nb, 0.0, X, ns);
+        cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, ns, nb, nb, 1.0, HY, ns, G, nb, 0.0, Y, ns);
+        cut = ev[0];
+
+        // residuals of the top nt Ritz pairs
+        double res = 0.0;
+        for (j = nb-nt; j < nb; j++) {
+            double *x = X + (size_t)j*ns, *hx = Y + (size_t)j*ns, rn = 0.0;
+            for (i = 0; i < ns; i++) rn += (hx[i] - ev[j] * x[i]) * (hx[i] - ev[j] * x[i]);
+            res = max(res, sqrt(rn));
+        }
+        if (res < tol) {
+            conv = 1;
+            break;
+        }
+    }
+
+    if (conv) {
+        *eigmin = lmin;
+        for (j = 0; j < nt; j++) w[j] = ev[nb-nt+j];
+        memcpy(Z, X + (size_t)(nb-nt)*ns, sizeof(double) * ns * nt);
+    }
+    #ifdef DEBUG
+    printf("CS filtered subspace iteration: %s after %d iterations\n", conv ? "converged" : "not converged", it+1);
+    #endif
+    free(X); free(Y); free(HY); free(G); free(M); free(ev);
+    return !conv;
+}
+
+/**
+ * @brief   Top nt eigenpairs and the lowest eigenvalue of Hs (upper triangle) from
+ *          the tridiagonal form, by bisection and inverse iteration. Hs is
+ *          overwritten by the Householder reflectors of the reduction.
+ */
+static int CS_tridiag_top_eigenpairs(double *Hs, int ns, int nt, double *eigmin, double *w, double *Z)
+{
+    int nb = ns - nt, info = 0, m, nsplit;
+    double abstol = 2.0 * DBL_MIN;
+    double *d    = (double *)malloc(ns * sizeof(double));
+    double *e    = (double *)malloc(ns * sizeof(double));
+    double *tau  = (double *)malloc(ns * sizeof(double));
+    double *wall = (double *)malloc(ns * sizeof(double));
+    int *iblock  = (int *)malloc(ns * sizeof(int));
+    int *isplit  = (int *)malloc(ns * sizeof(int));
+    int *ifail   = (int *)malloc(ns * sizeof(int));
+    assert(d != NULL && e != NULL && tau != NULL && wall != NULL);
+    assert(iblock != NULL && isplit != NULL && ifail != NULL);
+    info += LAPACKE_dsytrd(LAPACK_COL_MAJOR, 'U', ns, Hs, ns, d, e, tau);
+
+    // lowest eigenvalue
+    info += LAPACKE_dstebz('I', 'E', ns, 0.0, 0.0, 1, 1, abstol, d, e,
+                           &m, &nsplit, wall, iblock, isplit);
+    *eigmin = wall[0];
+    // top nt eigenpairs of the tridiagonal matrix, back-transformed to Hs
+    info += LAPACKE_dstebz('I', 'B', ns, 0.0, 0.0, nb+1, ns, abstol, d, e,
+                           &m, &nsplit, wall, iblock, isplit);
+    info += LAPACKE_dstein(LAPACK_COL_MAJOR, ns, d, e, m, wall, iblock, isplit,
+                           Z, ns, ifail);
+    info += LAPACKE_dormtr(LAPACK_COL_MAJOR, 'L', 'U', 'N', ns, nt,
+                           Hs, ns, tau, Z, ns);
+
+    // eigenvalues are ordered by split-off blocks, sort them in ascending order
+    for (int i = 0; i < nt; i++) w[i] = wall[i];
+    for (int i = 0; i < nt-1; i++) {
+        int jmin = i;
+        for (int j = i+1; j < nt; j++)
+            if (w[j] < w[jmin]) jmin = j;
+        if (jmin == i) continue;
+        double tmp = w[i]; w[i] = w[jmin]; w[jmin] = tmp;
+        for (int r = 0; r < ns; r++) {
+            tmp = Z[i*ns+r]; Z[i*ns+r] = Z[jmin*ns+r]; Z[jmin*ns+r] = tmp;
+        }
+    }
+
+    free(d); free(e); free(tau); free(wall);
+    free(iblock); free(isplit); free(ifail);
+    return info;
+}
+
+/**
+ * @brief   Top nt eigenpairs and the lowest eigenvalue of Hs (upper triangle) from
+ *          all eigenpairs, used if the partial eigensolver fails. Hs is
+ *          overwritten by the eigenvectors.
+ */
+static int CS_full_top_eigenpairs(double *Hs, int ns, int nt, double *eigmin, double *w, double *Z)
+{
+    double *ev = (double *)malloc(ns * sizeof(double));
+    assert(ev != NULL);
+    int info = LAPACKE_dsyevd(LAPACK_COL_MAJOR, 'V', 'U', ns, Hs, ns, ev);
+    if (info == 0) {
+        *eigmin = ev[0];
+        for (int i = 0; i < nt; i++) w[i] = ev[ns-nt+i];
+        memcpy(Z, Hs + (size_t)(ns-nt)*ns, sizeof(double) * ns * nt);
+    }
+    free(ev);
+    return info;
+}
+
+/**
+ * @brief   Complementary subspace version of DP_Solve_Generalized_EigenProblem.
+ *
+ *          Hp is reduced to the standard form Hs = R^{-T} * Hp * R^{-1} with the
+ *          Cholesky factor R of Mp (the std path has Mp = I already). Only the top
+ *          Nt eigenpairs of Hs are computed, by filtered subspace iteration once
+ *          the columns are ordered by a previous CS rotation, otherwise (or if it
+ *          does not converge) from the tridiagonal form. If the tridiagonal solver
+ *          fails, all eigenpairs of Hs are computed instead. The lowest Ns - Nt
+ *          states are fully occupied, so only the sum of their eigenvalues matters,
+ *          which is trace(Hs) - sum(top eigenvalues). The lowest eigenvalue is
+ *          computed as well since it is the lower bound of the next Chebyshev filter.
+ *
+ *          The top eigenvectors Z are stored as Householder reflectors (QR of Z),
+ *          whose last Ns - Nt columns span the complement.
+ */
+void DP_CS_Solve_EigenProblem(SPARC_OBJ *pSPARC, int spn_i)
+{
+    DP_CheFSI_t DP_CheFSI = (DP_CheFSI_t) pSPARC->DP_CheFSI;
+    if (DP_CheFSI == NULL) return;
+
+    int Ns_dp = DP_CheFSI->Ns_dp;
+    int Nt = pSPARC->CS_Ntop;
+    int Nb = Ns_dp - Nt;
+    int rank_kpt = DP_CheFSI->rank_kpt;
+    double *Hp_local = DP_CheFSI->Hp_local;
+    double *Mp_local = DP_CheFSI->Mp_local;
+    double *Z = DP_CheFSI->eig_vecs;
+    double *eig_val = pSPARC->lambda + spn_i * Ns_dp;
+    #ifdef DEBUG
+    double st = MPI_Wtime();
+    #endif
+    int info = 0;
+    if (rank_kpt == 0) {
+        if (pSPARC->StandardEigenFlag == 0) {
+            info = LAPACKE_dpotrf(LAPACK_COL_MAJOR, 'U', Ns_dp, Mp_local, Ns_dp);
+            if (info == 0)
+                info = LAPACKE_dsygst(LAPACK_COL_MAJOR, 1, 'U', Ns_dp, Hp_local, Ns_dp, Mp_local, Ns_dp);
+        }
+        double trace = 0.0;
+        for (int i = 0; i < Ns_dp; i++) trace += Hp_local[i*Ns_dp+i];
+
+        double eigmin = 0.0, *w = (double *)calloc(Nt, sizeof(double));
+        assert(w != NULL);
+        int full = 1;
+        if (info == 0 && DP_CheFSI->cs_warm[spn_i])
+            full = CS_filtered_top_eigenpairs(Hp_local, Ns_dp, Nt, CS_FILTER_TOL, &eigmin, w, Z);
+        if (info == 0 && full) {
+            // Hs is overwritten by the tridiagonal reduction, keep it for the full solve
+            double *Hs = (double *)malloc(sizeof(double) * Ns_dp * Ns_dp);
+            assert(Hs != NULL);
+            memcpy(Hs, Hp_local, sizeof(double) * Ns_dp * Ns_dp);
+            if (CS_tridiag_top_eigenpairs(Hp_local, Ns_dp, Nt, &eigmin, w, Z) != 0) {
+                printf("WARNING: the partial subspace eigensolver of CS_FLAG failed, "
+                       "all eigenpairs are computed in this step.\n");
+                info = CS_full_top_eigenpairs(Hs, Ns_dp, Nt, &eigmin, w, Z);
+            }
+            free(Hs);
+        }
+        DP_CheFSI->cs_warm[spn_i] = 1;
+
+        double sum_top = 0.0;
+        for (int i = 0; i < Nt; i++) {
+            eig_val[Nb+i] = w[i];
+            sum_top += w[i];
+        }
+        eig_val[0] = eigmin;
+        // placeholders with the right sum for the occupations and band energy,
+        // not eigenvalues (PRINT_EIGEN is not allowed with CS_FLAG)
+        double avg = Nb > 1 ? (trace - sum_top - eigmin) / (Nb - 1) : eigmin;
+        for (int i = 1; i < Nb; i++) eig_val[i] = avg;
+
+        if (info == 0)
+            info = LAPACKE_dgeqrf(LAPACK_COL_MAJOR, Ns_dp, Nt, Z, Ns_dp, DP_CheFSI->cs_tau);
+        free(w);
+    }
+    MPI_Bcast(&info, 1, MPI_INT, 0, DP_CheFSI->kpt_comm);
+    if (info != 0) {
+        if (rank_kpt == 0)
+            printf("ERROR: failed to solve the subspace eigenproblem in the CS mode, info = %d\n", info);
+        exit(EXIT_FAILURE);
+    }
+    #ifdef DEBUG
+    double et0 = MPI_Wtime();
+    #endif
+    if (pSPARC->StandardEigenFlag == 0)
+        MPI_Bcast(Mp_local, Ns_dp * Ns_dp, MPI_DOUBLE, 0, DP_CheFSI->kpt_comm);
+    MPI_Bcast(Z, Ns_dp * Nt, MPI_DOUBLE, 0, DP_CheFSI->kpt_comm);
+    MPI_Bcast(DP_CheFSI->cs_tau, Nt, MPI_DOUBLE, 0, DP_CheFSI->kpt_comm);
+    #ifdef DEBUG
+    double et1 = MPI_Wtime();
+    if (rank_kpt == 0) printf("DP_CS_Solve_EigenProblem, rank 0 used %.3lf ms, bcast used %.3lf ms\n", 1000.0 * (et1 - st), 1000.0 * (et1 - et0));
+    #endif
+}
+
+/**
+ * @brief   Complementary subspace version of DP_Subspace_Rotation.
+ *
+ *          Y is first orthonormalized with R from DP_CS_Solve_EigenProblem (the
+ *          std path did this in the projection), then multiplied by the Householder
+ *          matrix of the top eigenvectors. The complement is moved in front of
+ *          the top eigenvectors to match the order of the eigenvalues.
+ */
+void DP_CS_Subspace_Rotation(SPARC_OBJ *pSPARC, double *Psi_rot)
+{
+    DP_CheFSI_t DP_CheFSI = (DP_CheFSI_t) pSPARC->DP_CheFSI;
+    if (DP_CheFSI == NULL) return;
+
+    #ifdef DEBUG
+    int rank_kpt = DP_CheFSI->rank_kpt;
+    double st, et0, et1;
+    st = MPI_Wtime();
+    #endif
+    int Nd_dp = DP_CheFSI->Nd_dp;
+    int Ns_dp = DP_CheFSI->Ns_dp;
+    int Nt = pSPARC->CS_Ntop;
+    int Nb = Ns_dp - Nt;
+    double *Y_dp  = DP_CheFSI->Y_dp;
+    double *YQ_dp = DP_CheFSI->HY_dp;
+    if (Nd_dp > 0) {
+        if (pSPARC->StandardEigenFlag == 0) {
+            cblas_dtrsm(CblasColMajor, CblasRight, CblasUpper, CblasNoTrans, CblasNonUnit,
+                Nd_dp, Ns_dp, 1.0, DP_CheFSI->Mp_local, Ns_dp, Y_dp, Nd_dp);
+        }
+        LAPACKE_dormqr(LAPACK_COL_MAJOR, 'R', 'N', Nd_dp, Ns_dp, Nt,
+                       DP_CheFSI->eig_vecs, Ns_dp, DP_CheFSI->cs_tau, Y_dp, Nd_dp);
+        memcpy(YQ_dp, Y_dp + (size_t)Nt * Nd_dp, sizeof(double) * Nd_dp * Nb);
+        memcpy(YQ_dp + (size_t)Nb * Nd_dp, Y_dp, sizeof(double) * Nd_dp * Nt);
+    }
+    #ifdef DEBUG
+    et0 = MPI_Wtime();
+    #endif
+
+    DP2BP(
+        pSPARC->blacscomm, DP_CheFSI->nproc_row,
+        DP_CheFSI->Ndsp_bp, DP_CheFSI->Ns_bp, DP_CheFSI->Nd_dp_displs,
+        DP_CheFSI->bp2dp_sendcnts, DP_CheFSI->bp2dp_sdispls,
+        DP_CheFSI->dp2bp_sendcnts, DP_CheFSI->dp2bp_sdispls,
+        sizeof(double), YQ_dp, DP_CheFSI->Y_packbuf, Psi_rot
+    );
+    // Synchronize here to prevent some processes run too fast and enter next DP_Project_Hamiltonian too earlier
+    MPI_Barrier(DP_CheFSI->kpt_comm);
+    #ifdef DEBUG
+    et1 = MPI_Wtime();
+    if (rank_kpt == 0) printf("DP_CS_Subspace_Rotation rank 0 used %.3lf ms, redist PsiQ used %.3lf ms\n\n", 1000.0 * (et1 - st), 1000.0 * (et1 - et0));
+    #endif
+}
+
 /**
  * @brief   Free domain parallelization data structures for calculating projected Hamiltonian, 
  *          solving generalized eigenproblem, and performing subspace rotation in CheFSI().
@@ -1460,6 +1855,7 @@ void free_DP_CheFSI(SPARC_OBJ *pSPARC)
     free(DP_CheFSI->Mp_local);
     free(DP_CheFSI->Hp_local);
     free(DP_CheFSI->eig_vecs);
+    free(DP_CheFSI->cs_tau);
     MPI_Comm_free(&DP_CheFSI->kpt_comm);
     
     free(DP_CheFSI);
@@ -48,6 +48,8 @@
 #include "occupation.h"
 #include "isddft.h"
 #include "parallelization.h"
+#include "mixedPrecisionFilter.h"
+#include "timing.h"
 #include "linearAlgebra.h"
 #include "cyclix_tools.h"
 
@@ -76,7 +78,10 @@ void eigSolve_CheFSI_kpt(int rank, SPARC_OBJ *pSPARC, int SCFcount, double error
     int count, kpt, spn_i;
     double t1, t2, lambda_cutoff = 0;
     double _Complex *x0 = pSPARC->Lanczos_x0_complex;
-    if (pSPARC->elecgs_Count > 0 || pSPARC->usefock > 1) pSPARC->rhoTrigger = pSPARC->Nchefsi;
+    if (pSPARC->elecgs_Count > 0 || pSPARC->usefock > 1 || pSPARC->SCFRestartRead) pSPARC->rhoTrigger = pSPARC->Nchefsi;
+    // filter in single precision while the SCF error is large
+    pSPARC->CheFSI_UseSP = CheFSI_use_single_precision(pSPARC, error);
+    timing_region_begin("eigSolve_CheFSI_kpt");
 
     if(SCFcount == 0){
         pSPARC->npl_max = pSPARC->ChebDegree;
@@ -96,6 +101,10 @@ void eigSolve_CheFSI_kpt(int rank, SPARC_OBJ *pSPARC, int SCFcount, double error
     }   
 
     while(count < pSPARC->rhoTrigger + SCFcount*pSPARC->Nchefsi){
+        // extrapolated orbitals are filtered with 3/4 of the degree (at least npl_min)
+        int ChebDegree = pSPARC->ChebDegree;
+        if (pSPARC->OrbExtrapStep)
+            pSPARC->ChebDegree = max(pSPARC->npl_min, 3 * ChebDegree / 4);
         for(spn_i = 0; spn_i < pSPARC->Nspin_spincomm; spn_i++) {
             // each kpt group take care of the kpts assigned to it
             for (kpt = 0; kpt < pSPARC->Nkpts_kptcomm; kpt++) {
@@ -106,6 +115,7 @@ void eigSolve_CheFSI_kpt(int rank, SPARC_OBJ *pSPARC, int SCFcount, double error
                 CheFSI_kpt(pSPARC, lambda_cutoff, x0, count, kpt, spn_i);
             }
         }
+        pSPARC->ChebDegree = ChebDegree;
         t1 = MPI_Wtime();
         
         int indx0, ns;
@@ -198,6 +208,7 @@ void eigSolve_CheFSI_kpt(int rank, SPARC_OBJ *pSPARC, int SCFcount, double error
 #endif
         }
     }
+    timing_region_end("eigSolve_CheFSI_kpt");
 }
 
 
@@ -213,7 +224,9 @@ void CheFSI_kpt(SPARC_OBJ *pSPARC, double lambda_cutoff, double _Complex *x0, in
     MPI_Comm_size(pSPARC->kptcomm, &nproc_kptcomm);
 
     // determine the bounds for performing chebyshev filtering
+    timing_region_begin("Chebyshevfilter_constants_kpt");
     Chebyshevfilter_constants_kpt(pSPARC, x0, &lambda_cutoff, &pSPARC->eigmin[spn_i*pSPARC->Nkpts_kptcomm + kpt], &pSPARC->eigmax[spn_i*pSPARC->Nkpts_kptcomm + kpt], count, kpt, spn_i);
+    timing_region_end("Chebyshevfilter_constants_kpt");
 
 #ifdef DEBUG
             if (!rank && kpt == 0) {
@@ -231,6 +244,7 @@ void CheFSI_kpt(SPARC_OBJ *pSPARC, double lambda_cutoff, double _Complex *x0, in
 
     // ** Chebyshev filtering ** //
     t1 = MPI_Wtime();
+    timing_region_begin("ChebyshevFiltering_kpt");
 
     #ifdef SPARCX_ACCEL
     if (pSPARC->useACCEL == 1 && pSPARC->cell_typ < 20 && pSPARC->spin_typ <= 1 && pSPARC->usefock <=1 && pSPARC->SOC_Flag == 0 && pSPARC->Nd_d_dmcomm == pSPARC->Nd)
@@ -242,12 +256,21 @@ void CheFSI_kpt(SPARC_OBJ *pSPARC, double lambda_cutoff, double _Complex *x0, in
 	}
 	else
     #endif // SPARCX_ACCEL   
+    if (pSPARC->CheFSI_UseSP)
+    {
+        ChebyshevFiltering_mixed_kpt(pSPARC, pSPARC->DMVertices_dmcomm, pSPARC->Xorb_kpt + kpt*size_k + spn_i*DMnd, DMndsp, 
+                            pSPARC->Yorb_kpt + spn_i*DMnd, DMndsp, pSPARC->Nband_bandcomm, 
+                            pSPARC->ChebDegree, lambda_cutoff, pSPARC->eigmax[spn_i*pSPARC->Nkpts_kptcomm + kpt], pSPARC->eigmin[spn_i*pSPARC->Nkpts_kptcomm + kpt], kpt, spn_i,
+                            pSPARC->dmcomm, &t_temp);
+    }
+    else
     {
         ChebyshevFiltering_kpt(pSPARC, pSPARC->DMVertices_dmcomm, pSPARC->Xorb_kpt + kpt*size_k + spn_i*DMnd, DMndsp, 
                             pSPARC->Yorb_kpt + spn_i*DMnd, DMndsp, pSPARC->Nband_bandcomm, 
                             pSPARC->ChebDegree, lambda_cutoff, pSPARC->eigmax[spn_i*pSPARC->Nkpts_kptcomm + kpt], pSPARC->eigmin[spn_i*pSPARC->Nkpts_kptcomm + kpt], kpt, spn_i,
                             pSPARC->dmcomm, &t_temp);
     }
+    timing_region_end("ChebyshevFiltering_kpt");
 
     t2 = MPI_Wtime();
     #ifdef DEBUG
@@ -257,6 +280,7 @@ void CheFSI_kpt(SPARC_OBJ *pSPARC, double lambda_cutoff, double _Complex *x0, in
     #endif
     
     t1 = MPI_Wtime();
+    timing_region_begin("Project_Hamiltonian_kpt");
     // ** calculate projected Hamiltonian and overlap matrix ** //
     #ifdef USE_DP_SUBEIG
     DP_Project_Hamiltonian_kpt(
@@ -273,12 +297,14 @@ void CheFSI_kpt(SPARC_OBJ *pSPARC, double lambda_cutoff, double _Complex *x0, in
     Project_Hamiltonian_kpt(pSPARC, pSPARC->DMVertices_dmcomm, pSPARC->Yorb_kpt + spn_i*DMnd, DMndsp, pSPARC->Xorb_kpt + kpt*size_k + spn_i*DMnd, DMndsp,
                         pSPARC->Hp_kpt, pSPARC->Mp_kpt, kpt, spn_i, pSPARC->dmcomm);
     #endif
+    timing_region_end("Project_Hamiltonian_kpt");
     t2 = MPI_Wtime();
     #ifdef DEBUG
     if(!rank && kpt == 0) printf("Total time for projection: %.3f ms\n", (t2-t1)*1e3);
     #endif
     
     t1 = MPI_Wtime();
+    timing_region_begin("Solve_Generalized_EigenProblem_kpt");
     // ** solve the generalized eigenvalue problem Hp * Q = Mp * Q * Lambda **//
     #ifdef USE_DP_SUBEIG
     DP_Solve_Generalized_EigenProblem_kpt(pSPARC, kpt, spn_i);
@@ -297,6 +323,7 @@ void CheFSI_kpt(SPARC_OBJ *pSPARC, double lambda_cutoff, double _Complex *x0, in
                   MPI_DOUBLE, 0, pSPARC->kptcomm); // TODO: bcast in blacscomm if possible
     }
     #endif //SPARCX_ACCEL
+    timing_region_end("Solve_Generalized_EigenProblem_kpt");
     
     t2 = MPI_Wtime();
     #ifdef DEBUG
@@ -308,6 +335,7 @@ void CheFSI_kpt(SPARC_OBJ *pSPARC, double lambda_cutoff, double _Complex *x0, in
     #endif
     
     t1 = MPI_Wtime();
+    timing_region_begin("Subspace_Rotation_kpt");
     // ** subspace rotation ** //
     #ifdef USE_DP_SUBEIG
     DP_Subspace_Rotation_kpt(pSPARC, pSPARC->Xorb_kpt + kpt*size_k + spn_i*DMnd);
@@ -328,6 +356,7 @@ void CheFSI_kpt(SPARC_OBJ *pSPARC, double lambda_cutoff, double _Complex *x0, in
         pSPARC->Yorb_BLCYC_kpt = NULL;
     }
     #endif
+    timing_region_end("Subspace_Rotation_kpt");
     t2 = MPI_Wtime();
     #ifdef DEBUG
     if(!rank && kpt == 0) printf("Total time for subspace rotation: %.3f ms\n", (t2-t1)*1e3);
@@ -442,7 +471,7 @@ void Chebyshevfilter_constants_kpt(
         } 
     }
     
-    if (pSPARC->elecgs_Count == 0 && count == 0) 
+    if (pSPARC->elecgs_Count == 0 && count == 0 && !pSPARC->SCFRestartRead) 
         *lambda_cutoff = 0.5 * (*eigmin + *eigmax);
     else{
         //*lambda_cutoff = pSPARC->Efermi + log(1e6-1) / pSPARC->Beta + 0.1;
@@ -120,28 +120,36 @@ void CalculateDensity_psi(SPARC_OBJ *pSPARC, double *rho)
     t1 = MPI_Wtime();
 #endif
 
-    // calculate rho based on local bands
-    count = 0;
-    for (k = 0; k < pSPARC->Nkpts_kptcomm; k++) {
-        for (n = nstart; n <= nend; n++) {
-            double woccfac = pSPARC->occfac * (pSPARC->kptWts_loc[k] / pSPARC->Nkpts);
-            for (spinor = 0; spinor < pSPARC->Nspinor_spincomm; spinor ++) {
-                int spinor_g = spinor + pSPARC->spinor_start_indx;
-                double *occ = pSPARC->occ + k*Ns; 
-                if (pSPARC->spin_typ == 1) occ += spinor*Ns*pSPARC->Nkpts_kptcomm;
-                g_nk = woccfac * occ[n];
-
-                if (pSPARC->isGammaPoint) {
-                    for (i = 0; i < DMnd; i++) {
-                        rho[i+spinor_g*DMnd] += g_nk * pSPARC->Xorb[count] * pSPARC->Xorb[count];
-                        count++;
-                    }
-                } else {
-                    for (i = 0; i < DMnd; i++) {
-                        rho[i+spinor_g*DMnd] += g_nk * (creal(pSPARC->Xorb_kpt[count]) * creal(pSPARC->Xorb_kpt[count])
-                                                      + cimag(pSPARC->Xorb_kpt[count]) * cimag(pSPARC->Xorb_kpt[count]));
-                        count++;
+    // calculate rho based on local bands. The team is forked once, every band
+    // is split the same way (static schedule), so each thread adds all bands 
+    // on its own grid points and no barrier is needed between the bands
+    #pragma omp parallel private(i, n, k, spinor, g_nk, count)
+    {
+        count = 0;
+        for (k = 0; k < pSPARC->Nkpts_kptcomm; k++) {
+            for (n = nstart; n <= nend; n++) {
+                double woccfac = pSPARC->occfac * (pSPARC->kptWts_loc[k] / pSPARC->Nkpts);
+                for (spinor = 0; spinor < pSPARC->Nspinor_spincomm; spinor ++) {
+                    int spinor_g = spinor + pSPARC->spinor_start_indx;
+                    double *occ = pSPARC->occ + k*Ns; 
+                    if (pSPARC->spin_typ == 1) occ += spinor*Ns*pSPARC->Nkpts_kptcomm;
+                    g_nk = woccfac * occ[n];
+
+                    double *rho_sp = rho + spinor_g*DMnd;
+                    if (pSPARC->isGammaPoint) {
+                        double *psi = pSPARC->Xorb + count;
+                        #pragma omp for schedule(static) nowait
+                        for (i = 0; i < DMnd; i++) {
+                            rho_sp[i] += g_nk * psi[i] * psi[i];
+                        }
+                    } else {
+                        double _Complex *psi = pSPARC->Xorb_kpt + count;
+                        #pragma omp for schedule(static) nowait
+                        for (i = 0; i < DMnd; i++) {
+                            rho_sp[i] += g_nk * (creal(psi[i]) * creal(psi[i]) + cimag(psi[i]) * cimag(psi[i]));
+                        }
                     }
+                    count += DMnd;
                 }
             }
         }
@@ -50,6 +50,10 @@
 #include "sqParallelization.h"
 #include "sqNlocVecRoutines.h"
 #include "printing.h"
+#include "incrementalUpdate.h"
+#include "mixedPrecisionFilter.h"
+#include "scfRestart.h"
+#include "timing.h"
 
 #ifdef USE_EVA_MODULE
 #include "ExtVecAccel/ExtVecAccel.h"
@@ -71,6 +75,7 @@ void Calculate_electronicGroundState(SPARC_OBJ *pSPARC) {
 #ifdef DEBUG
     if (rank == 0) printf("Start ground-state calculation.\n");
 #endif
+    timing_region_begin("Calculate_electronicGroundState");
     
     // Check if Reference Cutoff > 0.5 * nearest neighbor distance
     // Check if Reference Cutoff < mesh spacing
@@ -143,7 +148,9 @@ void Calculate_electronicGroundState(SPARC_OBJ *pSPARC) {
     
     t1 = MPI_Wtime();
     // calculate forces
+    timing_region_begin("Calculate_EGS_Forces");
     Calculate_EGS_Forces(pSPARC);
+    timing_region_end("Calculate_EGS_Forces");
     t2 = MPI_Wtime();
     
     // calculate atom magnetization
@@ -201,7 +208,9 @@ void Calculate_electronicGroundState(SPARC_OBJ *pSPARC) {
     // Calculate Stress and pressure
     if(pSPARC->Calc_stress == 1){
         t1 = MPI_Wtime();
+        timing_region_begin("Calculate_electronic_stress");
         Calculate_electronic_stress(pSPARC);
+        timing_region_end("Calculate_electronic_stress");
         // if (pSPARC->d3Flag == 1) d3_grad_cell_stress(pSPARC); // move this function into Calculate_electronic_stress?
         t2 = MPI_Wtime();
         if(!rank && pSPARC->Verbosity) {
@@ -247,7 +256,9 @@ void Calculate_electronicGroundState(SPARC_OBJ *pSPARC) {
         }
     } else if(pSPARC->Calc_pres == 1){
         t1 = MPI_Wtime();
-        Calculate_electronic_pressure(pSPARC);        
+        timing_region_begin("Calculate_electronic_pressure");
+        Calculate_electronic_pressure(pSPARC);
+        timing_region_end("Calculate_electronic_pressure");
         t2 = MPI_Wtime();
         if(!rank && pSPARC->Verbosity) {
         	output_fp = fopen(pSPARC->OutFilename,"a");
@@ -317,6 +328,14 @@ void Calculate_electronicGroundState(SPARC_OBJ *pSPARC) {
         #endif
     }
 
+    // write orbitals, eigenvalues and density for restarting the SCF
+    if (pSPARC->Printrestart_scf == 1) {
+        int SCF_ind = pSPARC->MDFlag == 1 ? pSPARC->MDCount : pSPARC->RelaxCount;
+        SCF_ind += pSPARC->restartCount + (pSPARC->RestartFlag == 0);
+        if (SCF_ind % pSPARC->Printrestart_fq == 0)
+            write_restart_SCF(pSPARC);
+    }
+
     // print energy density
     if (pSPARC->PrintEnergyDensFlag == 1) {
         #ifdef DEBUG
@@ -329,6 +348,10 @@ void Calculate_electronicGroundState(SPARC_OBJ *pSPARC) {
         if (rank == 0) printf("Time for printing energy density: %.3f ms\n", (t2-t1)*1e3);
         #endif
     }
+    timing_region_end("Calculate_electronicGroundState");
+
+    // write the timings of this step into the .timing file
+    write_timing_report(pSPARC);
 }
 
 
@@ -346,6 +369,12 @@ void Calculate_EGS_elecDensEnergy(SPARC_OBJ *pSPARC) {
     t1 = MPI_Wtime();
 #endif
     
+    // atoms within TOL_INCREMENTAL_UPDATE of their last position are kept there, 
+    // so that their pseudocharges and projectors can be reused
+    IncrementalUpdate_begin(pSPARC);
+    double *atom_pos = pSPARC->atom_pos;
+    if (pSPARC->IncrUpdateFlag) pSPARC->atom_pos = pSPARC->atom_pos_ref;
+
     // find atoms that influence the process domain
     GetInfluencingAtoms(pSPARC);
     
@@ -417,6 +446,10 @@ void Calculate_EGS_elecDensEnergy(SPARC_OBJ *pSPARC) {
             CalculateNonlocalProjectors_kpt(pSPARC, &pSPARC->nlocProj, pSPARC->Atom_Influence_nloc, 
                                             pSPARC->DMVertices_dmcomm, pSPARC->bandcomm_index < 0 ? MPI_COMM_NULL : pSPARC->dmcomm);	                            
         
+        // single precision copy for the mixed-precision filter
+        CalculateNonlocalProjectors_sp(pSPARC, pSPARC->nlocProj, pSPARC->Atom_Influence_nloc, 
+                                       pSPARC->bandcomm_index < 0 ? MPI_COMM_NULL : pSPARC->dmcomm);
+
         if (pSPARC->SOC_Flag) {
             CalculateNonlocalProjectors_SOC(pSPARC, pSPARC->nlocProj, pSPARC->Atom_Influence_nloc, 
                                             pSPARC->DMVertices_dmcomm, pSPARC->bandcomm_index < 0 ? MPI_COMM_NULL : pSPARC->dmcomm);
@@ -461,8 +494,15 @@ void Calculate_EGS_elecDensEnergy(SPARC_OBJ *pSPARC) {
         if (rank == 0) printf("\nCalculating nonlocal projectors in kptcomm_topo took %.3f ms\n",(t2-t1)*1000);   
     #endif
         
+        pSPARC->atom_pos = atom_pos;
+        IncrementalUpdate_end(pSPARC);
+
         // initialize orbitals psi
         Init_orbital(pSPARC);
+
+        // replace the initial guess by the orbitals and density of the run being restarted
+        if (pSPARC->elecgs_Count == 0 && pSPARC->RestartFlag != 0 && pSPARC->Printrestart_scf == 1)
+            read_restart_SCF(pSPARC);
     }
 
     // initialize electron density rho (initial guess)
@@ -504,6 +544,7 @@ void scf(SPARC_OBJ *pSPARC)
 	#ifdef DEBUG
     if (rank == 0) printf("Start SCF calculation ... \n");
 	#endif
+    timing_region_begin("scf");
     
     if (!rank && pSPARC->Verbosity) {
         output_fp = fopen(pSPARC->OutFilename,"a");
@@ -553,7 +594,9 @@ void scf(SPARC_OBJ *pSPARC)
     int DMnd = pSPARC->Nd_d;
     int i;
     // solve the poisson equation for electrostatic potential, "phi"
+    timing_region_begin("Calculate_elecstPotential");
     Calculate_elecstPotential(pSPARC);
+    timing_region_end("Calculate_elecstPotential");
 
     #ifdef DEBUG
     t1 = MPI_Wtime();
@@ -595,6 +638,7 @@ void scf(SPARC_OBJ *pSPARC)
         Exact_Exchange_loop(pSPARC);
         pSPARC->usefock ++;
     }
+    timing_region_end("scf");
 }
 
 /**
@@ -648,6 +692,7 @@ void scf_loop(SPARC_OBJ *pSPARC) {
 
 		// start scf timer
         t_scf_s = MPI_Wtime();
+        timing_region_begin("scf_iteration");
         
         if (pSPARC->SQFlag == 1)
             Calculate_elecDens_SQ(pSPARC, SCFcount);
@@ -700,7 +745,9 @@ void scf_loop(SPARC_OBJ *pSPARC) {
             #endif
 
             // solve the poisson equation for electrostatic potential, "phi"
+            timing_region_begin("Calculate_elecstPotential");
             Calculate_elecstPotential(pSPARC);
+            timing_region_end("Calculate_elecstPotential");
 
 		    #ifdef DEBUG
             t2 = MPI_Wtime();
@@ -782,7 +829,9 @@ void scf_loop(SPARC_OBJ *pSPARC) {
             shiting_Veff_mean(pSPARC, pSPARC->Veff_loc_dmcomm_phi, pSPARC->Nspden, Veff_mean, 0, -1);
         }
 
+        timing_region_begin("Mixing");
         Mixing(pSPARC, SCFcount);
+        timing_region_end("Mixing");
 
         #ifdef DEBUG
         t2 = MPI_Wtime();
@@ -796,7 +845,9 @@ void scf_loop(SPARC_OBJ *pSPARC) {
             shiting_Veff_mean(pSPARC, pSPARC->Veff_loc_dmcomm_phi, pSPARC->Nspden, Veff_mean, 1, 1);
         } else if (pSPARC->MixingVariable == 0) { // recalculate potential for density mixing 
             // solve the poisson equation for electrostatic potential, "phi"
+            timing_region_begin("Calculate_elecstPotential");
             Calculate_elecstPotential(pSPARC);
+            timing_region_end("Calculate_elecstPotential");
             Calculate_Vxc(pSPARC);
             pSPARC->countPotentialCalculate++;
             Calculate_Veff_loc_dmcomm_phi(pSPARC);
@@ -824,6 +875,7 @@ void scf_loop(SPARC_OBJ *pSPARC) {
         
         SCFcount++;
         t_scf_e = MPI_Wtime();
+        timing_region_end("scf_iteration");
         #ifdef DEBUG        
         if (!rank) printf("\nThis SCF took %.3f ms, scf error = %.3e\n", (t_scf_e-t_scf_s)*1e3, error);
         #endif
@@ -25,6 +25,7 @@
 #include "cyclix_tools.h"
 #include "cyclix_lapVec.h"
 #include "electronDensity.h"
+#include "multigrid.h"
 
 #include <mpi.h>
 // #include <cblas.h> 
@@ -766,6 +767,277 @@ void GetInfluencingAtoms(SPARC_OBJ *pSPARC) {
 }
 
 
+/**
+ * @brief   Add the contributions of one image atom to the pseudocharge density,
+ *          the reference pseudocharge density, the correction potential Vc, the
+ *          atomic and core electron densities and the atomic magnetization,
+ *          multiplied by sgn. The atom part of the self energy is added to Esc.
+ *
+ *          Calling this with sgn = -1.0 for the image of a previous step removes
+ *          exactly what was added for it (up to round-off), which is used to
+ *          update only the atoms that moved.
+ */
+static void Add_AtomPseudoCharge(SPARC_OBJ *pSPARC, ATOM_INFLUENCE_OBJ *Atom_Influence, 
+    const int ityp, const int iat, const double sgn, double *Lap_wt, const double w2_diag, double *Esc) 
+{
+#define electronDens_at(i,j,k) electronDens_at[(k)*DMnx*DMny+(j)*DMnx+(i)]
+#define electronDens_core(i,j,k) electronDens_core[(k)*DMnx*DMny+(j)*DMnx+(i)]
+#define rho_J(i,j,k) rho_J[(k)*nxp*nyp+(j)*nxp+(i)]
+#define rho_c_J(i,j,k) rho_c_J[(k)*nxp*nyp+(j)*nxp+(i)]
+#define magx(i,j,k) magx[(k)*DMnx*DMny+(j)*DMnx+(i)]
+#define magy(i,j,k) magy[(k)*DMnx*DMny+(j)*DMnx+(i)]
+#define magz(i,j,k) magz[(k)*DMnx*DMny+(j)*DMnx+(i)]
+
+    int i, j, k, ip, jp, kp, i_global, j_global, k_global, i_DM, j_DM, k_DM, dI, dJ, dK, 
+        FDn, count, count_interp, DMnx, DMny, DMnz, DMnd, nx, ny, nz, nd, nxp, nyp, nzp, 
+        nd_ex, icor, jcor, kcor, len_interp;
+    double x0_i, y0_i, z0_i, x0_i_shift, y0_i_shift, z0_i_shift, x, y, z, xin, 
+           *R, *VJ, *VJ_ref, *rho_J, *rho_c_J;
+    double inv_4PI = 0.25 / M_PI;
+    double rchrg = pSPARC->psd[ityp].RadialGrid[pSPARC->psd[ityp].size-1];
+
+    FDn = pSPARC->order / 2;
+    DMnx = pSPARC->Nx_d;
+    DMny = pSPARC->Ny_d;
+    DMnz = pSPARC->Nz_d;
+    DMnd = pSPARC->Nd_d;
+
+    double *magx, *magy, *magz;
+    magx = magy = magz = NULL;
+    if (pSPARC->spin_typ == 1) {
+        magz = pSPARC->mag_at;
+    } else if (pSPARC->spin_typ == 2) {
+        magx = pSPARC->mag_at;
+        magy = pSPARC->mag_at + DMnd;
+        magz = pSPARC->mag_at + DMnd*2;
+    }
+
+    // coordinates of the image atom
+    x0_i = Atom_Influence[ityp].coords[iat * 3];
+    y0_i = Atom_Influence[ityp].coords[iat * 3 + 1];
+    z0_i = Atom_Influence[ityp].coords[iat * 3 + 2];
+    
+    // number of finite-difference nodes in each direction of overlap rb region
+    nx = Atom_Influence[ityp].xe[iat] - Atom_Influence[ityp].xs[iat] + 1;
+    ny = Atom_Influence[ityp].ye[iat] - Atom_Influence[ityp].ys[iat] + 1;
+    nz = Atom_Influence[ityp].ze[iat] - Atom_Influence[ityp].zs[iat] + 1;
+    nd = nx * ny * nz;
+    
+    // number of finite-difference nodes in each direction of extended rb (+ order/2) region
+    nxp = nx + pSPARC->order;
+    nyp = ny + pSPARC->order;
+    nzp = nz + pSPARC->order;
+    nd_ex = nxp * nyp * nzp; // total number of nodes
+
+    // radii^2 of the finite difference grids of the extended-rb-region
+    R  = (double *)malloc(sizeof(double) * nd_ex);
+    if (R == NULL) {
+        printf("\nMemory allocation failed!\n");
+        exit(EXIT_FAILURE);
+    } 
+    
+    // left corner of the extended-rb-region
+    icor = Atom_Influence[ityp].xs[iat] - FDn;
+    jcor = Atom_Influence[ityp].ys[iat] - FDn;
+    kcor = Atom_Influence[ityp].zs[iat] - FDn;
+    
+    // relative coordinate of image atoms
+    x0_i_shift =  x0_i - pSPARC->delta_x * icor; 
+    y0_i_shift =  y0_i - pSPARC->delta_y * jcor;
+    z0_i_shift =  z0_i - pSPARC->delta_z * kcor; 
+    
+    // find distance between atom and finite-difference grids
+    count = 0; 
+    count_interp = 0;        
+    if(pSPARC->cell_typ == 0) {    
+        for (k = 0; k < nzp; k++) {
+            z = k * pSPARC->delta_z - z0_i_shift; 
+            for (j = 0; j < nyp; j++) {
+                y = j * pSPARC->delta_y - y0_i_shift;
+                for (i = 0; i < nxp; i++) {
+                    x = i * pSPARC->delta_x - x0_i_shift;
+                    R[count] = sqrt((x*x) + (y*y) + (z*z) );                   
+                    if (R[count] <= rchrg) count_interp++;
+                    count++;
+                }
+            }
+        }
+    } else if(pSPARC->cell_typ > 10 && pSPARC->cell_typ < 20) {
+        for (k = 0; k < nzp; k++) {
+            z = k * pSPARC->delta_z - z0_i_shift; 
+            for (j = 0; j < nyp; j++) {
+                y = j * pSPARC->delta_y - y0_i_shift;
+                for (i = 0; i < nxp; i++) {
+                    x = i * pSPARC->delta_x - x0_i_shift;
+                    R[count] = sqrt(pSPARC->metricT[0] * (x*x) + pSPARC->metricT[1] * (x*y) + pSPARC->metricT[2] * (x*z) 
+                                + pSPARC->metricT[4] * (y*y) + pSPARC->metricT[5] * (y*z) + pSPARC->metricT[8] * (z*z) );
+                    //R[count] = sqrt((x*x) + (y*y) + (z*z) );                   
+                    if (R[count] <= rchrg) count_interp++;
+                    count++;
+                }
+            }
+        }
+    } else if (pSPARC->cell_typ > 20 && pSPARC->cell_typ < 30) {
+        for (k = kcor; k < kcor+nzp; k++) {
+            z = k * pSPARC->delta_z;
+            for (j = jcor; j < jcor+nyp; j++) {
+                y = j * pSPARC->delta_y;
+                for (i = icor; i < icor+nxp; i++) {
+                    x = pSPARC->xin + i * pSPARC->delta_x;
+                    CalculateDistance(pSPARC, x, y, z, x0_i, y0_i, z0_i, &R[count]);
+                    if (R[count] <= rchrg) count_interp++;
+                    count++;
+                }
+            }
+        }
+    }
+    
+    //Calc_dist(pSPARC, nxp, nyp, nzp, x0_i_shift, y0_i_shift, z0_i_shift, R, rchrg, &count_interp);
+    VJ_ref = (double *)malloc( nd_ex * sizeof(double) );
+    if (VJ_ref == NULL) {
+       printf("\nMemory allocation failed!\n");
+       exit(EXIT_FAILURE);
+    }
+    // Calculate pseudopotential reference
+    Calculate_Pseudopot_Ref(R, nd_ex, pSPARC->REFERENCE_CUTOFF, -pSPARC->Znucl[ityp], VJ_ref);
+    
+    VJ = (double *)malloc( nd_ex * sizeof(double) );
+    if (VJ == NULL) {
+        printf("\nMemory allocation failed!\n");
+        exit(EXIT_FAILURE);
+    } 
+
+    len_interp = nd_ex;
+    if (pSPARC->psd[ityp].is_r_uniform == 1) {
+        SplineInterpUniformTable(pSPARC->psd[ityp].RadialGrid, pSPARC->psd[ityp].size, 
+                                 pSPARC->psd[ityp].SplineTabrVloc, R, VJ, len_interp);
+    } else {
+        SplineInterpNonuniform(pSPARC->psd[ityp].RadialGrid,pSPARC->psd[ityp].rVloc, pSPARC->psd[ityp].size, 
+                               R, VJ, len_interp, pSPARC->psd[ityp].SplinerVlocD);
+    }
+
+    for (i = 0; i < nd_ex; i++) {
+        // rearrange VJ back to original order
+        if (fabs(R[i]) < TEMP_TOL) {
+            VJ[i] = pSPARC->psd[ityp].Vloc_0;
+        } else if (R[i] > rchrg) {
+            VJ[i] = -pSPARC->Znucl[ityp] / R[i];
+        } else {
+            VJ[i] = VJ[i] / R[i];
+        }
+    }
+    // calculate the sum of atomic charge densities as initial electron density guess, only in the very 
+    // first MD/Relaxation step, and only if restart_flag is off
+    rho_J = (double *)malloc( nd_ex * sizeof(double) );
+    rho_c_J = (double *)malloc( nd_ex * sizeof(double) );
+    assert(rho_J != NULL && rho_c_J != NULL);
+
+    len_interp = nd_ex;
+    if (pSPARC->psd[ityp].is_r_uniform == 1) {
+        SplineInterpUniformTable(pSPARC->psd[ityp].RadialGrid, pSPARC->psd[ityp].size, 
+                                 pSPARC->psd[ityp].SplineTabIsoAtomDen, R, rho_J, len_interp);
+        SplineInterpUniformTable(pSPARC->psd[ityp].RadialGrid, pSPARC->psd[ityp].size, 
+                                 pSPARC->psd[ityp].SplineTabRhoc, R, rho_c_J, len_interp);
+    } else {
+        SplineInterpNonuniform(pSPARC->psd[ityp].RadialGrid,pSPARC->psd[ityp].rhoIsoAtom, pSPARC->psd[ityp].size, 
+                               R, rho_J, len_interp, pSPARC->psd[ityp].SplineFitIsoAtomDen);
+        SplineInterpNonuniform(pSPARC->psd[ityp].RadialGrid,pSPARC->psd[ityp].rho_c_table, pSPARC->psd[ityp].size, 
+                               R, rho_c_J, len_interp, pSPARC->psd[ityp].SplineRhocD);
+    }
+
+    for (i = 0; i < nd_ex; i++) {
+        if (R[i] > rchrg) {
+            rho_J[i] = 0.0;
+            rho_c_J[i] = 0.0;
+        }
+    }
+
+    for (k = 0; k < nz; k++) {
+        kp = k + FDn;
+        k_global = k + Atom_Influence[ityp].zs[iat];// global coord 
+        k_DM = k_global - pSPARC->DMVertices[4]; // local coord 
+        if (k_DM < 0 || k_DM >= DMnz) continue;
+        for (j = 0; j < ny; j++) {
+            jp = j + FDn;
+            j_global = j + Atom_Influence[ityp].ys[iat];
+            j_DM = j_global - pSPARC->DMVertices[2]; // local coord 
+            if (j_DM < 0 || j_DM >= DMny) continue;
+            for (i = 0; i < nx; i++) {
+                ip = i + FDn;
+                i_global = i + Atom_Influence[ityp].xs[iat];
+                i_DM = i_global - pSPARC->DMVertices[0]; // local coord 
+                if (i_DM < 0 || i_DM >= DMnx) continue;
+                pSPARC->electronDens_at(i_DM,j_DM,k_DM) += sgn * rho_J(ip,jp,kp);
+                pSPARC->electronDens_core(i_DM,j_DM,k_DM) += sgn * rho_c_J(ip,jp,kp);
+                if (pSPARC->spin_typ == 1) {
+                    magz(i_DM,j_DM,k_DM) += sgn * ((Atom_Influence[ityp].atom_spin[3*iat+2] / pSPARC->Znucl[ityp]) * rho_J(ip,jp,kp));
+                } else if (pSPARC->spin_typ == 2) {
+                    magx(i_DM,j_DM,k_DM) += sgn * ((Atom_Influence[ityp].atom_spin[3*iat] / pSPARC->Znucl[ityp]) * rho_J(ip,jp,kp));
+                    magy(i_DM,j_DM,k_DM) += sgn * ((Atom_Influence[ityp].atom_spin[3*iat+1] / pSPARC->Znucl[ityp]) * rho_J(ip,jp,kp));
+                    magz(i_DM,j_DM,k_DM) += sgn * ((Atom_Influence[ityp].atom_spin[3*iat+2] / pSPARC->Znucl[ityp]) * rho_J(ip,jp,kp));
+                }
+            }
+        }
+    }
+
+    free(rho_J);
+    free(rho_c_J);
+    
+    free(R);
+
+    dK = Atom_Influence[ityp].zs[iat] - pSPARC->DMVertices[4];
+    dJ = Atom_Influence[ityp].ys[iat] - pSPARC->DMVertices[2];
+    dI = Atom_Influence[ityp].xs[iat] - pSPARC->DMVertices[0];
+    
+    // calculate pseudocharge density bJ and add to b
+    double *bJ = (double*)malloc(nd * sizeof(double));
+    double *bJ_ref = (double*)malloc(nd * sizeof(double));
+        
+    xin = pSPARC->xin + Atom_Influence[ityp].xs[iat] * pSPARC->delta_x;
+    Calc_lapV(pSPARC, VJ, FDn, nxp, nyp, nzp, nx, ny, nz, Lap_wt, w2_diag, xin, -inv_4PI, bJ);
+    Calc_lapV(pSPARC, VJ_ref, FDn, nxp, nyp, nzp, nx, ny, nz, Lap_wt, w2_diag, xin, -inv_4PI, bJ_ref);
+
+    for (k = 0, kp = FDn, k_DM = dK; k < nz; k++, kp++, k_DM++) {
+        int kshift_DM = k_DM * DMnx * DMny;
+        int kshift_p = kp * nxp * nyp;
+        int kshift = k * nx * ny;  
+        for (j = 0, jp = FDn, j_DM = dJ; j < ny; j++, jp++, j_DM++) {
+            int jshift_DM = kshift_DM + j_DM * DMnx;
+            int jshift_p = kshift_p + jp * nxp;
+            int jshift = kshift + j * nx;
+            for (i = 0, ip = FDn, i_DM = dI; i < nx; i++, ip++, i_DM++) {
+                int ishift_DM = jshift_DM + i_DM;
+                int ishift_p = jshift_p + ip;
+                int ishift = jshift + i;
+                pSPARC->psdChrgDens[ishift_DM] += sgn * bJ[ishift];
+                pSPARC->psdChrgDens_ref[ishift_DM] += sgn * bJ_ref[ishift];
+                pSPARC->Vc[ishift_DM] += sgn * (VJ_ref[ishift_p] -  VJ[ishift_p]);
+                double bJvJ = bJ_ref[ishift] * VJ_ref[ishift_p];
+                if (pSPARC->CyclixFlag) {
+                    x = xin + i*pSPARC->delta_x;
+                    bJvJ *= (x*pSPARC->dV);
+                }
+                *Esc -= sgn * bJvJ;
+            }
+        }
+    }
+    
+    free(bJ);
+    free(bJ_ref);
+    free(VJ);
+    free(VJ_ref);
+
+#undef electronDens_at
+#undef electronDens_core
+#undef rho_J
+#undef rho_c_J
+#undef magx
+#undef magy
+#undef magz
+}
+
+
+
 /**
  * @brief   Calculate pseudocharge density for given atom positions
  */
@@ -783,19 +1055,13 @@ void Generate_PseudoChargeDensity(SPARC_OBJ *pSPARC) {
 #define magy(i,j,k) magy[(k)*DMnx*DMny+(j)*DMnx+(i)]
 #define magz(i,j,k) magz[(k)*DMnx*DMny+(j)*DMnx+(i)]
 
-    int nproc, rank, ityp, iat, i, j, k, ip, jp, kp, i_global, j_global, k_global, 
-        i_DM, j_DM, k_DM,dI, dJ, dK, FDn, count, count_interp, DMnx, DMny, DMnz, 
-        DMnd, nx, ny, nz, nd, nxp, nyp, nzp, nd_ex, icor, jcor, kcor, len_interp;
-    double x0_i, y0_i, z0_i, x0_i_shift, y0_i_shift, z0_i_shift, x, y, z, *R,
-           *VJ, *VJ_ref, Esc, *rho_J;     
-    double inv_4PI = 0.25 / M_PI, w2_diag, rchrg;
+    int nproc, rank, ityp, iat, i, j, k, FDn, count, DMnx, DMny, DMnz, DMnd;
+    double Esc;     
+    double inv_4PI = 0.25 / M_PI, w2_diag;
     double *Lap_wt, *Lap_stencil;
-    double xin;
 #ifdef DEBUG
     double t1, t2;
-    double tt1, tt2, ttot, ttot2;
-    ttot = 0;
-    ttot2 = 0;
+    t1 = MPI_Wtime();
 #endif
     
     if (pSPARC->dmcomm_phi == MPI_COMM_NULL) {
@@ -839,260 +1105,60 @@ void Generate_PseudoChargeDensity(SPARC_OBJ *pSPARC) {
     DMnz = pSPARC->Nz_d;
     DMnd = pSPARC->Nd_d;
     
-    // initialize to zero at the beginning of each relax/MD step
-    memset(pSPARC->electronDens_at, 0, sizeof(double)*DMnd);
-    memset(pSPARC->electronDens_core, 0, sizeof(double)*DMnd);
-    memset(pSPARC->psdChrgDens, 0, sizeof(double)*DMnd);
-    memset(pSPARC->psdChrgDens_ref, 0, sizeof(double)*DMnd);
-    memset(pSPARC->Vc, 0, sizeof(double)*DMnd);
-
     double *magx, *magy, *magz;
     magx = magy = magz = NULL;
     if (pSPARC->spin_typ == 1) {
-        memset(pSPARC->mag_at, 0, sizeof(double)*DMnd);
         magz = pSPARC->mag_at;
     } else if (pSPARC->spin_typ == 2) {
-        memset(pSPARC->mag_at, 0, sizeof(double)*DMnd*3);
         magx = pSPARC->mag_at;
         magy = pSPARC->mag_at + DMnd;
         magz = pSPARC->mag_at + DMnd*2;
     }
 
     // calculate pseudocharge density bJ and (self + correction) energy
-    Esc = 0.0; // Esc = Eself + Ec
-    for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
-        rchrg = pSPARC->psd[ityp].RadialGrid[pSPARC->psd[ityp].size-1];
-        for (iat = 0; iat < pSPARC->Atom_Influence_local[ityp].n_atom; iat++) {      
-            // coordinates of the image atom
-            x0_i = pSPARC->Atom_Influence_local[ityp].coords[iat * 3];
-            y0_i = pSPARC->Atom_Influence_local[ityp].coords[iat * 3 + 1];
-            z0_i = pSPARC->Atom_Influence_local[ityp].coords[iat * 3 + 2];
-            
-            // number of finite-difference nodes in each direction of overlap rb region
-            nx = pSPARC->Atom_Influence_local[ityp].xe[iat] - pSPARC->Atom_Influence_local[ityp].xs[iat] + 1;
-            ny = pSPARC->Atom_Influence_local[ityp].ye[iat] - pSPARC->Atom_Influence_local[ityp].ys[iat] + 1;
-            nz = pSPARC->Atom_Influence_local[ityp].ze[iat] - pSPARC->Atom_Influence_local[ityp].zs[iat] + 1;
-            nd = nx * ny * nz;
-            
-            // number of finite-difference nodes in each direction of extended rb (+ order/2) region
-            nxp = nx + pSPARC->order;
-            nyp = ny + pSPARC->order;
-            nzp = nz + pSPARC->order;
-            nd_ex = nxp * nyp * nzp; // total number of nodes
-
-            // radii^2 of the finite difference grids of the extended-rb-region
-            R  = (double *)malloc(sizeof(double) * nd_ex);
-            if (R == NULL) {
-                printf("\nMemory allocation failed!\n");
-                exit(EXIT_FAILURE);
-            } 
-            
-            // left corner of the extended-rb-region
-            icor = pSPARC->Atom_Influence_local[ityp].xs[iat] - FDn;
-            jcor = pSPARC->Atom_Influence_local[ityp].ys[iat] - FDn;
-            kcor = pSPARC->Atom_Influence_local[ityp].zs[iat] - FDn;
-            
-            // relative coordinate of image atoms
-            x0_i_shift =  x0_i - pSPARC->delta_x * icor; 
-            y0_i_shift =  y0_i - pSPARC->delta_y * jcor;
-            z0_i_shift =  z0_i - pSPARC->delta_z * kcor; 
-            
-            // find distance between atom and finite-difference grids
-            count = 0; 
-            count_interp = 0;        
-            if(pSPARC->cell_typ == 0) {    
-                for (k = 0; k < nzp; k++) {
-                    z = k * pSPARC->delta_z - z0_i_shift; 
-                    for (j = 0; j < nyp; j++) {
-                        y = j * pSPARC->delta_y - y0_i_shift;
-                        for (i = 0; i < nxp; i++) {
-                            x = i * pSPARC->delta_x - x0_i_shift;
-                            R[count] = sqrt((x*x) + (y*y) + (z*z) );                   
-                            if (R[count] <= rchrg) count_interp++;
-                            count++;
-                        }
-                    }
-                }
-            } else if(pSPARC->cell_typ > 10 && pSPARC->cell_typ < 20) {
-                for (k = 0; k < nzp; k++) {
-                    z = k * pSPARC->delta_z - z0_i_shift; 
-                    for (j = 0; j < nyp; j++) {
-                        y = j * pSPARC->delta_y - y0_i_shift;
-                        for (i = 0; i < nxp; i++) {
-                            x = i * pSPARC->delta_x - x0_i_shift;
-                            R[count] = sqrt(pSPARC->metricT[0] * (x*x) + pSPARC->metricT[1] * (x*y) + pSPARC->metricT[2] * (x*z) 
-                                        + pSPARC->metricT[4] * (y*y) + pSPARC->metricT[5] * (y*z) + pSPARC->metricT[8] * (z*z) );
-                            //R[count] = sqrt((x*x) + (y*y) + (z*z) );                   
-                            if (R[count] <= rchrg) count_interp++;
-                            count++;
-                        }
-                    }
-                }
-            } else if (pSPARC->cell_typ > 20 && pSPARC->cell_typ < 30) {
-                for (k = kcor; k < kcor+nzp; k++) {
-                    z = k * pSPARC->delta_z;
-                    for (j = jcor; j < jcor+nyp; j++) {
-                        y = j * pSPARC->delta_y;
-                        for (i = icor; i < icor+nxp; i++) {
-                            x = pSPARC->xin + i * pSPARC->delta_x;
-                            CalculateDistance(pSPARC, x, y, z, x0_i, y0_i, z0_i, &R[count]);
-                            if (R[count] <= rchrg) count_interp++;
-                            count++;
-                        }
-                    }
-                }
-            }
-            
-            //Calc_dist(pSPARC, nxp, nyp, nzp, x0_i_shift, y0_i_shift, z0_i_shift, R, rchrg, &count_interp);
-            #ifdef DEBUG
-            tt1 = MPI_Wtime();
-            #endif
-            VJ_ref = (double *)malloc( nd_ex * sizeof(double) );
-            if (VJ_ref == NULL) {
-               printf("\nMemory allocation failed!\n");
-               exit(EXIT_FAILURE);
-            }
-            // Calculate pseudopotential reference
-            Calculate_Pseudopot_Ref(R, nd_ex, pSPARC->REFERENCE_CUTOFF, -pSPARC->Znucl[ityp], VJ_ref);
-            #ifdef DEBUG
-            tt2 = MPI_Wtime();
-            ttot += (tt2 - tt1);
-            #endif
-            
-            VJ = (double *)malloc( nd_ex * sizeof(double) );
-            if (VJ == NULL) {
-                printf("\nMemory allocation failed!\n");
-                exit(EXIT_FAILURE);
-            } 
-
-            len_interp = nd_ex;
-            if (pSPARC->psd[ityp].is_r_uniform == 1) {
-				SplineInterpUniform(pSPARC->psd[ityp].RadialGrid,pSPARC->psd[ityp].rVloc, pSPARC->psd[ityp].size, 
-				         R, VJ, len_interp, pSPARC->psd[ityp].SplinerVlocD);
-            } else {
-				SplineInterpNonuniform(pSPARC->psd[ityp].RadialGrid,pSPARC->psd[ityp].rVloc, pSPARC->psd[ityp].size, 
-				         R, VJ, len_interp, pSPARC->psd[ityp].SplinerVlocD);
-            }
-
-            for (i = 0; i < nd_ex; i++) {
-                // rearrange VJ back to original order
-                if (fabs(R[i]) < TEMP_TOL) {
-                    VJ[i] = pSPARC->psd[ityp].Vloc_0;
-                } else if (R[i] > rchrg) {
-            		VJ[i] = -pSPARC->Znucl[ityp] / R[i];
-                } else {
-                    VJ[i] = VJ[i] / R[i];
-                }
+    if (pSPARC->Atom_Influence_local_prev != NULL && 2 * pSPARC->n_atom_moved < pSPARC->n_atom) {
+        // only the atoms that moved are updated, the images of the other atoms
+        // are identical to the ones of the last step
+        ATOM_INFLUENCE_OBJ *Atom_Influence_prev = pSPARC->Atom_Influence_local_prev;
+        for (i = 0; i < DMnd; i++) {
+            pSPARC->electronDens_at[i] /= pSPARC->scal_fac_at;
+        }
+        Esc = pSPARC->Esc_atom;
+        for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+            for (iat = 0; iat < Atom_Influence_prev[ityp].n_atom; iat++) {
+                if (!pSPARC->atom_moved[Atom_Influence_prev[ityp].atom_index[iat]]) continue;
+                Add_AtomPseudoCharge(pSPARC, Atom_Influence_prev, ityp, iat, -1.0, Lap_wt, w2_diag, &Esc);
             }
-            #ifdef DEBUG
-            tt1 = MPI_Wtime();
-            #endif
-            // calculate the sum of atomic charge densities as initial electron density guess, only in the very 
-            // first MD/Relaxation step, and only if restart_flag is off
-			rho_J = (double *)malloc( nd_ex * sizeof(double) );
-            assert(rho_J != NULL);
-
-            len_interp = nd_ex;
-			if (pSPARC->psd[ityp].is_r_uniform == 1) {
-				SplineInterpUniform(pSPARC->psd[ityp].RadialGrid,pSPARC->psd[ityp].rhoIsoAtom, pSPARC->psd[ityp].size, 
-				         R, rho_J, len_interp, pSPARC->psd[ityp].SplineFitIsoAtomDen);
-            } else {
-				SplineInterpNonuniform(pSPARC->psd[ityp].RadialGrid,pSPARC->psd[ityp].rhoIsoAtom, pSPARC->psd[ityp].size, 
-				         R, rho_J, len_interp, pSPARC->psd[ityp].SplineFitIsoAtomDen);
-			}
-            
-            double *rho_c_J = (double *)malloc( nd_ex * sizeof(double) );
-            assert(rho_c_J != NULL);
-            SplineInterpMain(pSPARC->psd[ityp].RadialGrid,pSPARC->psd[ityp].rho_c_table, pSPARC->psd[ityp].size, 
-                         R, rho_c_J, len_interp, pSPARC->psd[ityp].SplineRhocD,pSPARC->psd[ityp].is_r_uniform);
-
-            for (i = 0; i < nd_ex; i++) {
-                if (R[i] > rchrg) {
-                    rho_J[i] = 0.0;
-                    rho_c_J[i] = 0.0;
-                }
+            for (iat = 0; iat < pSPARC->Atom_Influence_local[ityp].n_atom; iat++) {
+                if (!pSPARC->atom_moved[pSPARC->Atom_Influence_local[ityp].atom_index[iat]]) continue;
+                Add_AtomPseudoCharge(pSPARC, pSPARC->Atom_Influence_local, ityp, iat, 1.0, Lap_wt, w2_diag, &Esc);
             }
+        }
+    } else {
+        // initialize to zero at the beginning of each relax/MD step
+        memset(pSPARC->electronDens_at, 0, sizeof(double)*DMnd);
+        memset(pSPARC->electronDens_core, 0, sizeof(double)*DMnd);
+        memset(pSPARC->psdChrgDens, 0, sizeof(double)*DMnd);
+        memset(pSPARC->psdChrgDens_ref, 0, sizeof(double)*DMnd);
+        memset(pSPARC->Vc, 0, sizeof(double)*DMnd);
+        if (pSPARC->spin_typ == 1) {
+            memset(pSPARC->mag_at, 0, sizeof(double)*DMnd);
+        } else if (pSPARC->spin_typ == 2) {
+            memset(pSPARC->mag_at, 0, sizeof(double)*DMnd*3);
+        }
 
-            for (k = 0; k < nz; k++) {
-                kp = k + FDn;
-                k_global = k + pSPARC->Atom_Influence_local[ityp].zs[iat];// global coord 
-                k_DM = k_global - pSPARC->DMVertices[4]; // local coord 
-                if (k_DM < 0 || k_DM >= DMnz) continue;
-                for (j = 0; j < ny; j++) {
-                    jp = j + FDn;
-                    j_global = j + pSPARC->Atom_Influence_local[ityp].ys[iat];
-                    j_DM = j_global - pSPARC->DMVertices[2]; // local coord 
-                    if (j_DM < 0 || j_DM >= DMny) continue;
-                    for (i = 0; i < nx; i++) {
-                        ip = i + FDn;
-                        i_global = i + pSPARC->Atom_Influence_local[ityp].xs[iat];
-                        i_DM = i_global - pSPARC->DMVertices[0]; // local coord 
-                        if (i_DM < 0 || i_DM >= DMnx) continue;
-                        pSPARC->electronDens_at(i_DM,j_DM,k_DM) += rho_J(ip,jp,kp);
-                        pSPARC->electronDens_core(i_DM,j_DM,k_DM) += rho_c_J(ip,jp,kp);
-                        if (pSPARC->spin_typ == 1) {
-                            magz(i_DM,j_DM,k_DM) += (pSPARC->Atom_Influence_local[ityp].atom_spin[3*iat+2] / pSPARC->Znucl[ityp]) * rho_J(ip,jp,kp);
-                        } else if (pSPARC->spin_typ == 2) {
-                            magx(i_DM,j_DM,k_DM) += (pSPARC->Atom_Influence_local[ityp].atom_spin[3*iat] / pSPARC->Znucl[ityp]) * rho_J(ip,jp,kp);
-                            magy(i_DM,j_DM,k_DM) += (pSPARC->Atom_Influence_local[ityp].atom_spin[3*iat+1] / pSPARC->Znucl[ityp]) * rho_J(ip,jp,kp);
-                            magz(i_DM,j_DM,k_DM) += (pSPARC->Atom_Influence_local[ityp].atom_spin[3*iat+2] / pSPARC->Znucl[ityp]) * rho_J(ip,jp,kp);
-                        }
-                    }
-                }
-            }
-
-            free(rho_J); rho_J = NULL;
-            free(rho_c_J); rho_c_J = NULL;
-            #ifdef DEBUG
-            tt2 = MPI_Wtime();
-            ttot2 += (tt2 - tt1);
-            #endif
-            
-            free(R); R = NULL;
-
-            dK = pSPARC->Atom_Influence_local[ityp].zs[iat] - pSPARC->DMVertices[4];
-            dJ = pSPARC->Atom_Influence_local[ityp].ys[iat] - pSPARC->DMVertices[2];
-            dI = pSPARC->Atom_Influence_local[ityp].xs[iat] - pSPARC->DMVertices[0];
-            
-            // calculate pseudocharge density bJ and add to b
-            double *bJ = (double*)malloc(nd * sizeof(double));
-            double *bJ_ref = (double*)malloc(nd * sizeof(double));
-                
-            xin = pSPARC->xin + pSPARC->Atom_Influence_local[ityp].xs[iat] * pSPARC->delta_x;
-            Calc_lapV(pSPARC, VJ, FDn, nxp, nyp, nzp, nx, ny, nz, Lap_wt, w2_diag, xin, -inv_4PI, bJ);
-            Calc_lapV(pSPARC, VJ_ref, FDn, nxp, nyp, nzp, nx, ny, nz, Lap_wt, w2_diag, xin, -inv_4PI, bJ_ref);
-
-            for (k = 0, kp = FDn, k_DM = dK; k < nz; k++, kp++, k_DM++) {
-                int kshift_DM = k_DM * DMnx * DMny;
-                int kshift_p = kp * nxp * nyp;
-                int kshift = k * nx * ny;  
-                for (j = 0, jp = FDn, j_DM = dJ; j < ny; j++, jp++, j_DM++) {
-                    int jshift_DM = kshift_DM + j_DM * DMnx;
-                    int jshift_p = kshift_p + jp * nxp;
-                    int jshift = kshift + j * nx;
-                    for (i = 0, ip = FDn, i_DM = dI; i < nx; i++, ip++, i_DM++) {
-                        int ishift_DM = jshift_DM + i_DM;
-                        int ishift_p = jshift_p + ip;
-                        int ishift = jshift + i;
-                        pSPARC->psdChrgDens[ishift_DM] += bJ[ishift];
-                        pSPARC->psdChrgDens_ref[ishift_DM] += bJ_ref[ishift];
-                        pSPARC->Vc[ishift_DM] += (VJ_ref[ishift_p] -  VJ[ishift_p]);
-                        double bJvJ = bJ_ref[ishift] * VJ_ref[ishift_p];
-                        if (pSPARC->CyclixFlag) {
-                            x = xin + i*pSPARC->delta_x;
-                            bJvJ *= (x*pSPARC->dV);
-                        }
-                        Esc -= bJvJ;
-                    }
-                }
+        Esc = 0.0; // Esc = Eself + Ec
+        for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+            for (iat = 0; iat < pSPARC->Atom_Influence_local[ityp].n_atom; iat++) {
+                Add_AtomPseudoCharge(pSPARC, pSPARC->Atom_Influence_local, ityp, iat, 1.0, Lap_wt, w2_diag, &Esc);
             }
-            
-            free(bJ); bJ = NULL;
-            free(bJ_ref); bJ_ref = NULL;
-            free(VJ); VJ = NULL;
-            free(VJ_ref); VJ_ref = NULL;
         }
     }
+    pSPARC->Esc_atom = Esc;
+#ifdef DEBUG
+    t2 = MPI_Wtime();
+    if (rank == 0) printf("--Atom contributions to b, b_ref, Vc and rho_at took %.3f ms\n", (t2-t1)*1e3);
+#endif
 
     /*  Calculate integral of b and Esc  */
     double int_b = 0.0, int_rho = 0.0;
@@ -1144,6 +1210,7 @@ void Generate_PseudoChargeDensity(SPARC_OBJ *pSPARC) {
 
     /*  Scale electron density so that PosCharge + NegCharge = NetCharge  */
     double Nelectron_check = 0.0, scal_fac = (pSPARC->NetCharge - pSPARC->PosCharge) / pSPARC->NegCharge;
+    pSPARC->scal_fac_at = scal_fac;
     if (pSPARC->CyclixFlag) {
         for (int i = 0; i < DMnd; i++) {
             pSPARC->electronDens_at[i] *= scal_fac;
@@ -1218,10 +1285,6 @@ void Generate_PseudoChargeDensity(SPARC_OBJ *pSPARC) {
 #endif
  
 #ifdef DEBUG 
-    if (rank == 0) {
-        printf("--Calculate Vref took %.3f ms\n", ttot * 1e3);
-        printf("--Calculate rho_guess took %.3f ms\n", ttot2 * 1e3);
-    }
     if (rank == 0) {
         printf("\n integral of b = %.13f,\n int{b} + Nelectron + NetCharge = %.3e,\n Esc = %.13f,\n MPI_Allreduce took %.3f ms\n",
                           -pSPARC->PosCharge, -pSPARC->PosCharge + pSPARC->Nelectron + pSPARC->NetCharge,pSPARC->Esc,(t2-t1)*1e3);
@@ -1615,7 +1678,9 @@ void Calculate_elecstPotential(SPARC_OBJ *pSPARC) {
     
     // function pointer that applies b + Laplacian * x
     void (*residule_fptr) (SPARC_OBJ*, int, double, double*, double*, double*, MPI_Comm, double*) = poisson_residual; // poisson_residual is defined in lapVecRoutines.c
-    void (*Jacobi_fptr) (SPARC_OBJ*, int, double, double*, double*, MPI_Comm) = Jacobi_preconditioner;
+    void (*precond_fptr) (SPARC_OBJ*, int, double, double*, double*, MPI_Comm) = Jacobi_preconditioner;
+    if (pSPARC->POISSON_PRECOND == 1 && !pSPARC->CyclixFlag)
+        precond_fptr = Multigrid_preconditioner;
     
 #ifdef DEBUG
     double t1, t2;
@@ -1649,13 +1714,12 @@ void Calculate_elecstPotential(SPARC_OBJ *pSPARC) {
 
     // call linear solver to solve the poisson equation
     // solve -Laplacian phi = 4 * M_PI * (rho + b) 
-    // TODO: use real preconditioner instead of Jacobi preconditioner!
     if(pSPARC->POISSON_SOLVER == 0) {
         double omega, beta;
         int m, p;
         omega = 0.6, beta = 0.6; //omega = 0.6, beta = 0.6;
         m = 7, p = 6; //m = 9, p = 8; //m = 9, p = 9;
-        AAR(pSPARC, residule_fptr, Jacobi_fptr, 0.0, DMnd, pSPARC->elecstPotential, rhs, 
+        AAR(pSPARC, residule_fptr, precond_fptr, 0.0, DMnd, pSPARC->elecstPotential, rhs, 
         omega, beta, m, p, pSPARC->TOL_POISSON, pSPARC->MAXIT_POISSON, pSPARC->dmcomm_phi);
     } else {
         if (rank == 0) printf("Please provide a valid poisson solver!\n");
@@ -30,6 +30,13 @@
 
 #define max(x,y) ((x)>(y)?(x):(y))
 
+// range of the tabulated HSE short-range enhancement factor, in s and in
+// x = sqrt(w/WPBE_TAB_WMAX) with w = omega/kF
+#define WPBE_TAB_SMAX 8.6
+#define WPBE_TAB_WMAX 4.0
+#define WPBE_TAB_NMIN 32
+#define WPBE_TAB_NMAX 512
+
 /**
 * @brief  Calculate exchange correlation potential
 **/
@@ -163,16 +170,23 @@ void Calculate_Vxc(SPARC_OBJ *pSPARC)
         }
 
         if ((pSPARC->usefock > 0) && (pSPARC->usefock % 2 == 0) && strcmpi(pSPARC->XC,"HSE") == 0) {
+            double *e_xc_sr = (double *) malloc(sizeof(double) * DMnd * 3);
+            assert(e_xc_sr != NULL);
+            double *XCPotential_sr = e_xc_sr + DMnd;
+            double *Dxcdgrho_sr = e_xc_sr + 2*DMnd;
+            // Use the same strategy as \rho for \grho here. 
+            // Without this threshold, numerical issue will make simulation fail. 
             for (int i = 0; i < DMnd; i++) {
-                double e_xc_sr, Dxcdgrho_sr, XCPotential_sr;
-                // Use the same strategy as \rho for \grho here. 
-                // Without this threshold, numerical issue will make simulation fail. 
                 if (sigma[i] < 1E-14) sigma[i] = 1E-14;
-                pbexsr(rho[i], sigma[i], pSPARC->hyb_range_pbe, &e_xc_sr, &XCPotential_sr, &Dxcdgrho_sr);
-                ex[i] -=  pSPARC->exx_frac * e_xc_sr / rho[i];
-                vx[i] -= pSPARC->exx_frac * XCPotential_sr;
-                v2x[i] -= pSPARC->exx_frac * Dxcdgrho_sr;
             }
+            pbexsr_vec(pSPARC, DMnd, rho, sigma, e_xc_sr, XCPotential_sr, Dxcdgrho_sr);
+            #pragma omp parallel for schedule(static)
+            for (int i = 0; i < DMnd; i++) {
+                ex[i] -=  pSPARC->exx_frac * e_xc_sr[i] / rho[i];
+                vx[i] -= pSPARC->exx_frac * XCPotential_sr[i];
+                v2x[i] -= pSPARC->exx_frac * Dxcdgrho_sr[i];
+            }
+            free(e_xc_sr);
         }
         
         for (int i = 0; i < DMnd; i++) {
@@ -317,18 +331,30 @@ void Calculate_Vxc(SPARC_OBJ *pSPARC)
         }
 
         if ((pSPARC->usefock > 0) && (pSPARC->usefock % 2 == 0) && strcmpi(pSPARC->XC,"HSE") == 0) {
+            // spin-scaled densities of both spin channels, treated as one batch
+            double *rho_s = (double *) malloc(sizeof(double) * 2*DMnd * 5);
+            assert(rho_s != NULL);
+            double *sigma_s = rho_s + 2*DMnd;
+            double *e_xc_sr = rho_s + 4*DMnd;
+            double *XCPotential_sr = rho_s + 6*DMnd;
+            double *Dxcdgrho_sr = rho_s + 8*DMnd;
+            for (int i = 0; i < 2*DMnd; i++) {
+                // Use the same strategy as \rho for \grho here. 
+                // Without this threshold, numerical issue will make simulation fail. 
+                if (sigma[DMnd + i] < 1E-14) sigma[DMnd + i] = 1E-14;
+                rho_s[i] = rho[DMnd + i] * 2.0;
+                sigma_s[i] = sigma[DMnd + i] * 4.0;
+            }
+            pbexsr_vec(pSPARC, 2*DMnd, rho_s, sigma_s, e_xc_sr, XCPotential_sr, Dxcdgrho_sr);
+            #pragma omp parallel for schedule(static)
             for (int i = 0; i < DMnd; i++) {
                 for(int spn_i = 0; spn_i < 2; spn_i++) {
-                    double e_xc_sr, Dxcdgrho_sr, XCPotential_sr;
-                    // Use the same strategy as \rho for \grho here. 
-                    // Without this threshold, numerical issue will make simulation fail. 
-                    if (sigma[DMnd + spn_i*DMnd + i] < 1E-14) sigma[DMnd + spn_i*DMnd + i] = 1E-14;
-                    pbexsr(rho[DMnd + spn_i*DMnd + i] * 2.0, sigma[DMnd + spn_i*DMnd + i] * 4.0, pSPARC->hyb_range_pbe, &e_xc_sr, &XCPotential_sr, &Dxcdgrho_sr);
-                    ex[i] -= pSPARC->exx_frac * e_xc_sr / 2.0 / rho[i];
-                    vx[i+spn_i*DMnd] -= pSPARC->exx_frac * XCPotential_sr;
-                    v2x[i+spn_i*DMnd] -= pSPARC->exx_frac * Dxcdgrho_sr * 2.0;
+                    ex[i] -= pSPARC->exx_frac * e_xc_sr[i+spn_i*DMnd] / 2.0 / rho[i];
+                    vx[i+spn_i*DMnd] -= pSPARC->exx_frac * XCPotential_sr[i+spn_i*DMnd];
+                    v2x[i+spn_i*DMnd] -= pSPARC->exx_frac * Dxcdgrho_sr[i+spn_i*DMnd] * 2.0;
                 }
             }
+            free(rho_s);
         }        
 
         for (int i = 0; i < DMnd; i++) {
@@ -461,6 +487,7 @@ void slater(int DMnd, double *rho, double *ex, double *vx) {
     double C2 = 0.738558766382022;  // 3/4 * (3/pi)^(1/3)
     double C3 = 0.9847450218426965; // (3/pi)^(1/3)
     
+    #pragma omp parallel for schedule(static)
     for (int i = 0; i < DMnd; i++) {
         double rho_cbrt = cbrt(rho[i]);
         ex[i] = - C2 * rho_cbrt;
@@ -482,19 +509,35 @@ void pw(int DMnd, double *rho, double *ec, double *vc) {
     double beta3 = 1.6382;
     double beta4 = 0.49294;
     double C31 = 0.6203504908993999; // (3/4pi)^(1/3)    
+    int nchunk = (DMnd + XC_CHUNK - 1) / XC_CHUNK;
     
-    for (int i = 0; i < DMnd; i++) {
-        double rho_cbrt = cbrt(rho[i]);
-        double rs = C31 / rho_cbrt; // rs = (3/(4*pi*rho))^(1/3)
-        double rs_sqrt = sqrt(rs); // rs^0.5
-        double rs_pow_1p5 = rs * rs_sqrt; // rs^1.5
-        double rs_pow_p = rs; // rs^p, where p = 1, pow function is slow (~100x slower than add/sub)
-        double rs_pow_pplus1 = rs_pow_p * rs; // rs^(p+1)
-        double G1 = log(1.0+1.0/(2.0*A*(beta1*rs_sqrt + beta2*rs + beta3*rs_pow_1p5 + beta4*rs_pow_pplus1 )));
-        double G2 = 2.0*A*(beta1*rs_sqrt + beta2*rs + beta3*rs_pow_1p5 + beta4*rs_pow_pplus1);
-        
-        ec[i] = -2.0*A*(1.0+alpha1*rs) * G1;
-        vc[i] = ec[i] - (rs/3.0) * ( -2.0*A*alpha1 * G1 + (2.0*A*(1.0+alpha1*rs) * (A*(beta1/rs_sqrt + 2.0*beta2 + 3.0*beta3*rs_sqrt + 2.0*(p+1.0)*beta4*rs_pow_p))) / (G2 * (G2 + 1.0)) );
+    #pragma omp parallel for schedule(static)
+    for (int ic = 0; ic < nchunk; ic++) {
+        double rs[XC_CHUNK], rs_sqrt[XC_CHUNK], G1[XC_CHUNK], G2[XC_CHUNK];
+        int i0 = ic * XC_CHUNK;
+        int len = (DMnd - i0 < XC_CHUNK) ? DMnd - i0 : XC_CHUNK;
+        double *r = rho + i0;
+
+        for (int k = 0; k < len; k++) {
+            rs[k] = C31 / cbrt(r[k]); // rs = (3/(4*pi*rho))^(1/3)
+            rs_sqrt[k] = sqrt(rs[k]); // rs^0.5
+        }
+
+        for (int k = 0; k < len; k++) {
+            double rs_pow_1p5 = rs[k] * rs_sqrt[k]; // rs^1.5
+            double rs_pow_pplus1 = rs[k] * rs[k]; // rs^(p+1), where p = 1
+            G2[k] = 2.0*A*(beta1*rs_sqrt[k] + beta2*rs[k] + beta3*rs_pow_1p5 + beta4*rs_pow_pplus1);
+        }
+
+        for (int k = 0; k < len; k++)
+            G1[k] = log(1.0+1.0/G2[k]);
+
+        for (int k = 0; k < len; k++) {
+            double rs_pow_p = rs[k]; // rs^p, where p = 1
+            double e = -2.0*A*(1.0+alpha1*rs[k]) * G1[k];
+            ec[i0+k] = e;
+            vc[i0+k] = e - (rs[k]/3.0) * ( -2.0*A*alpha1 * G1[k] + (2.0*A*(1.0+alpha1*rs[k]) * (A*(beta1/rs_sqrt[k] + 2.0*beta2 + 3.0*beta3*rs_sqrt[k] + 2.0*(p+1.0)*beta4*rs_pow_p))) / (G2[k] * (G2[k] + 1.0)) );
+        }
     }
 }
 
@@ -513,6 +556,7 @@ void pz(int DMnd, double *rho, double *ec, double *vc) {
     double beta2 = 0.3334 ; 
     double C31 = 0.6203504908993999; // (3/4pi)^(1/3)    
     
+    #pragma omp parallel for schedule(static)
     for (int i = 0; i < DMnd; i++) {
         double rho_cbrt = cbrt(rho[i]);
         double rs = C31 / rho_cbrt; // rs = (3/(4*pi*rho))^(1/3)
@@ -521,9 +565,10 @@ void pz(int DMnd, double *rho, double *ec, double *vc) {
             vc[i] = log(rs)*(A+(2.0/3.0)*C*rs) + (B-(1.0/3.0)*A) + (1.0/3.0)*(2.0*D-C)*rs; 
         } else {
             double sqrtrs = sqrt(rs);
-            ec[i] = gamma1/(1.0+beta1*sqrt(rs)+beta2*rs);
+            double den = 1.0+beta1*sqrtrs+beta2*rs;
+            ec[i] = gamma1/den;
             vc[i] = (gamma1 + (7.0/6.0)*gamma1*beta1*sqrtrs 
-                    + (4.0/3.0)*gamma1*beta2*rs)/pow(1+beta1*sqrtrs+beta2*rs,2.0) ;		  
+                    + (4.0/3.0)*gamma1*beta2*rs)/(den*den);
         }
     }
 }
@@ -550,38 +595,48 @@ void pbex(int DMnd, double *rho, double *sigma, int iflag, double *ex, double *v
     double third = 1.0/3.0;
     double sixpi2_1_3 = pow(6.0*M_PI*M_PI, third);
     double sixpi2m1_3 = 1.0/sixpi2_1_3;
+    int rpbe = (iflag == 3);
+    int nchunk = (DMnd + XC_CHUNK - 1) / XC_CHUNK;
     
-    for(int i = 0; i < DMnd; i++){
-        double rho_updn = rho[i]/2.0;
-        double rho_updnm1_3 = pow(rho_updn, -third);
+    #pragma omp parallel for schedule(static)
+    for (int ic = 0; ic < nchunk; ic++) {
+        double rhomot[XC_CHUNK], ss[XC_CHUNK], divss[XC_CHUNK];
+        int i0 = ic * XC_CHUNK;
+        int len = (DMnd - i0 < XC_CHUNK) ? DMnd - i0 : XC_CHUNK;
+
+        for (int k = 0; k < len; k++)
+            rhomot[k] = 1.0 / cbrt(rho[i0+k]/2.0);
+
+        for (int k = 0; k < len; k++) {
+            double rho_inv = rhomot[k] * rhomot[k] * rhomot[k];
+            double coeffss = (1.0/4.0) * sixpi2m1_3 * sixpi2m1_3 * (rho_inv * rho_inv * rhomot[k] * rhomot[k]);
+            ss[k] = (sigma[i0+k]/4.0) * coeffss; // s^2
+        }
 
-        // First take care of the exchange part of the functional
-        double rhomot = rho_updnm1_3;
-        double ex_lsd = -threefourth_divpi * sixpi2_1_3 * (rhomot * rhomot * rho_updn);
-
-        // Perdew-Burke-Ernzerhof GGA, exchange part
-        double rho_inv = rhomot * rhomot * rhomot;
-        double coeffss = (1.0/4.0) * sixpi2m1_3 * sixpi2m1_3 * (rho_inv * rho_inv * rhomot * rhomot);
-        double ss = (sigma[i]/4.0) * coeffss; // s^2
-
-        double divss, dfxdss;
-        if (iflag == 1 || iflag == 2 || iflag == 4) {
-            divss = 1.0/(1.0 + mu_divkappa * ss);
-            dfxdss = mu * (divss * divss);
-        } else if (iflag == 3) {
-            divss = exp(-mu_divkappa * ss);
-            dfxdss = mu * divss;
+        // only RPBE (iflag = 3) has an exponential enhancement factor
+        if (rpbe) {
+            for (int k = 0; k < len; k++) divss[k] = exp(-mu_divkappa * ss[k]);
+        } else {
+            for (int k = 0; k < len; k++) divss[k] = 1.0/(1.0 + mu_divkappa * ss[k]);
+        }
+
+        for (int k = 0; k < len; k++) {
+            double rho_updn = rho[i0+k]/2.0;
+            double ex_lsd = -threefourth_divpi * sixpi2_1_3 * (rhomot[k] * rhomot[k] * rho_updn);
+            double rho_inv = rhomot[k] * rhomot[k] * rhomot[k];
+            double coeffss = (1.0/4.0) * sixpi2m1_3 * sixpi2m1_3 * (rho_inv * rho_inv * rhomot[k] * rhomot[k]);
+            double dfxdss = rpbe ? mu * divss[k] : mu * (divss[k] * divss[k]);
+            
+            double fx = 1.0 + kappa * (1.0 - divss[k]);
+            double dssdn = (-8.0/3.0) * (ss[k] * rho_inv);
+            double dfxdn = dfxdss * dssdn;
+            double dssdg = 2.0 * coeffss;
+            double dfxdg = dfxdss * dssdg;
+
+            ex[i0+k] = ex_lsd * fx;
+            vx[i0+k] = ex_lsd * ((4.0/3.0) * fx + rho_updn * dfxdn);
+            v2x[i0+k] = 0.5 * ex_lsd * rho_updn * dfxdg;
         }
-        
-        double fx = 1.0 + kappa * (1.0 - divss);
-        double dssdn = (-8.0/3.0) * (ss * rho_inv);
-        double dfxdn = dfxdss * dssdn;
-        double dssdg = 2.0 * coeffss;
-        double dfxdg = dfxdss * dssdg;
-
-        ex[i] = ex_lsd * fx;
-        vx[i] = ex_lsd * ((4.0/3.0) * fx + rho_updn * dfxdn);
-        v2x[i] = 0.5 * ex_lsd * rho_updn * dfxdg;
     }
 }
 
@@ -597,20 +652,23 @@ void rPW86x(int DMnd, double *rho, double *sigma, double *vdWDFex, double *vdWDF
     double Ax = -0.738558766382022; // -3/4 * (3/pi)^(1/3)
     double four_thirds = 4.0/3.0;
     
+    #pragma omp parallel for private(s, s_2, s_3, s_4, s_5, s_6, fs, grad_rho, df_ds) schedule(static)
     for (int i = 0; i < DMnd; i++) {
         if (sigma[i] < 1E-14) sigma[i] = 1E-14;
         grad_rho = sqrt(sigma[i]);
-        s = grad_rho / (s_prefactor*pow(rho[i], four_thirds));
+        double rho_1_3 = cbrt(rho[i]);
+        s = grad_rho / (s_prefactor*rho[i]*rho_1_3);
         s_2 = s*s;
         s_3 = s_2*s;
         s_4 = s_3*s;
         s_5 = s_3*s_2;
         s_6 = s_5*s;
 
-        fs = pow(1.0 + a*s_2 + b*s_4 + c*s_6, 1.0/15.0);
-        vdWDFex[i] = Ax * pow(rho[i], 1.0/3.0) * fs; // \epsilon_x, not n\epsilon_x
-        df_ds = (1.0/(15.0*pow(fs, 14.0))) * (2.0*a*s + 4.0*b*s_3 + 6.0*c*s_5);
-        vdWDFVx1[i] = Ax*four_thirds * (pow(rho[i], 1.0/3.0)*fs - grad_rho/(s_prefactor*rho[i])*df_ds);
+        double fs15 = 1.0 + a*s_2 + b*s_4 + c*s_6;
+        fs = pow(fs15, 1.0/15.0);
+        vdWDFex[i] = Ax * rho_1_3 * fs; // \epsilon_x, not n\epsilon_x
+        df_ds = (fs/(15.0*fs15)) * (2.0*a*s + 4.0*b*s_3 + 6.0*c*s_5); // fs^14 = fs15/fs
+        vdWDFVx1[i] = Ax*four_thirds * (rho_1_3*fs - grad_rho/(s_prefactor*rho[i])*df_ds);
         vdWDFVx2[i] = Ax * df_ds/(s_prefactor*grad_rho);
     }
 }
@@ -647,109 +705,115 @@ void pbec(int DMnd, double *rho, double *sigma, int iflag, double *ec, double *v
     double ec0_b3 = 1.6382;   
     double ec0_b4 = 0.49294;  
 
-    for(int i = 0; i < DMnd; i++){
-        double rho_updn = rho[i]/2.0;
-        double rho_updnm1_3 = pow(rho_updn, -third);
-        double rhom1_3 = twom1_3 * rho_updnm1_3;
-        double rhotot_inv = rhom1_3 * rhom1_3 * rhom1_3;
-        double rhotmo6 = sqrt(rhom1_3);
-        double rhoto6 = rho[i] * rhom1_3 * rhom1_3 * rhotmo6;
-
-        // Then takes care of the LSD correlation part of the functional
-        double rs = rsfac * rhom1_3;
-        double sqr_rs = sq_rsfac * rhotmo6;
-        double rsm1_2 = sq_rsfac_inv * rhoto6;
-
-        // Formulas A6-A8 of PW92LSD
-        double ec0_q0 = -2.0 * ec0_aa * (1.0 + ec0_a1 * rs);
-        double ec0_q1 = 2.0 * ec0_aa * (ec0_b1 * sqr_rs + ec0_b2 * rs + ec0_b3 * rs * sqr_rs + ec0_b4 * rs * rs);
-        double ec0_q1p = ec0_aa * (ec0_b1 * rsm1_2 + 2.0 * ec0_b2 + 3.0 * ec0_b3 * sqr_rs + 4.0 * ec0_b4 * rs);
-        double ec0_den = 1.0/(ec0_q1 * ec0_q1 + ec0_q1);
-        double ec0_log = -log(ec0_q1 * ec0_q1 * ec0_den);
-        double ecrs0 = ec0_q0 * ec0_log;
-        double decrs0_drs = -2.0 * ec0_aa * ec0_a1 * ec0_log - ec0_q0 * ec0_q1p * ec0_den;
+    double coeff_aa = beta * gamma_inv * phi_zeta_inv * phi_zeta_inv;
+    int nchunk = (DMnd + XC_CHUNK - 1) / XC_CHUNK;
 
-        double ecrs = ecrs0;
-        double decrs_drs = decrs0_drs;
+    #pragma omp parallel for schedule(static)
+    for (int ic = 0; ic < nchunk; ic++) {
+        double rhom1_3[XC_CHUNK], rhotmo6[XC_CHUNK], rs[XC_CHUNK], ec0_q0[XC_CHUNK];
+        double ec0_log[XC_CHUNK], decrs_drs[XC_CHUNK], exp_pbe[XC_CHUNK], tt[XC_CHUNK];
+        double dtt_dg[XC_CHUNK], dqq_drs[XC_CHUNK], dqq_dtt[XC_CHUNK], arg_rr[XC_CHUNK];
+        int i0 = ic * XC_CHUNK;
+        int len = (DMnd - i0 < XC_CHUNK) ? DMnd - i0 : XC_CHUNK;
 
-        // Add LSD correlation functional to GGA exchange functional
-        ec[i] = ecrs;
-        vc[i] = ecrs - (rs/3.0) * decrs_drs;
+        for (int k = 0; k < len; k++) {
+            double rho_updnm1_3 = 1.0 / cbrt(rho[i0+k]/2.0);
+            rhom1_3[k] = twom1_3 * rho_updnm1_3;
+        }
+        for (int k = 0; k < len; k++)
+            rhotmo6[k] = sqrt(rhom1_3[k]);
+
+        // Then takes care of the LSD correlation part of the functional,
+        // formulas A6-A8 of PW92LSD
+        for (int k = 0; k < len; k++) {
+            double rhoto6 = rho[i0+k] * rhom1_3[k] * rhom1_3[k] * rhotmo6[k];
+            rs[k] = rsfac * rhom1_3[k];
+            double sqr_rs = sq_rsfac * rhotmo6[k];
+            double rsm1_2 = sq_rsfac_inv * rhoto6;
+            ec0_q0[k] = -2.0 * ec0_aa * (1.0 + ec0_a1 * rs[k]);
+            double ec0_q1 = 2.0 * ec0_aa * (ec0_b1 * sqr_rs + ec0_b2 * rs[k] + ec0_b3 * rs[k] * sqr_rs + ec0_b4 * rs[k] * rs[k]);
+            double ec0_q1p = ec0_aa * (ec0_b1 * rsm1_2 + 2.0 * ec0_b2 + 3.0 * ec0_b3 * sqr_rs + 4.0 * ec0_b4 * rs[k]);
+            double ec0_den = 1.0/(ec0_q1 * ec0_q1 + ec0_q1);
+            ec0_log[k] = ec0_q1 * ec0_q1 * ec0_den;
+            // the log term of decrs_drs is added once the log is known
+            decrs_drs[k] = ec0_q0[k] * ec0_q1p * ec0_den;
+        }
+        for (int k = 0; k < len; k++)
+            ec0_log[k] = -log(ec0_log[k]);
+
+        for (int k = 0; k < len; k++) {
+            double ecrs = ec0_q0[k] * ec0_log[k];
+            decrs_drs[k] = -2.0 * ec0_aa * ec0_a1 * ec0_log[k] - decrs_drs[k];
+            // Add LSD correlation functional to GGA exchange functional
+            ec[i0+k] = ecrs;
+            vc[i0+k] = ecrs - (rs[k]/3.0) * decrs_drs[k];
+            // From ec to bb
+            exp_pbe[k] = -(ecrs * gamphi3inv);
+        }
+        for (int k = 0; k < len; k++)
+            exp_pbe[k] = exp(exp_pbe[k]);
 
         // Eventually add the GGA correlation part of the PBE functional
-        // Note : the computation of the potential in the spin-unpolarized
-        // case could be optimized much further. Other optimizations are left to do.
-
-        // From ec to bb
-        double bb = ecrs * gamphi3inv;
-        double dbb_drs = decrs_drs * gamphi3inv;
-        // dbb_dzeta = gamphi3inv * (decrs_dzeta - 3.0 * ecrs * phi_logder);
-
-        // From bb to cc
-        double exp_pbe = exp(-bb);
-        double cc = 1.0/(exp_pbe - 1.0);
-        double dcc_dbb = cc * cc * exp_pbe;
-        double dcc_drs = dcc_dbb * dbb_drs;
-        // dcc_dzeta = dcc_dbb * dbb_dzeta;
-
-        // From cc to aa
-        double coeff_aa = beta * gamma_inv * phi_zeta_inv * phi_zeta_inv;
-        double aa = coeff_aa * cc;
-        double daa_drs = coeff_aa * dcc_drs;
-        //daa_dzeta = -2.0 * aa * phi_logder + coeff_aa * dcc_dzeta;
-
-        // Introduce tt : do not assume that the spin-dependent gradients are collinear
-        double grrho2 = sigma[i];
-        double dtt_dg = 2.0 * rhotot_inv * rhotot_inv * rhom1_3 * coeff_tt;
-        // Note that tt is (the t variable of PBE divided by phi) squared
-        double tt = 0.5 * grrho2 * dtt_dg;
-
-        // Get xx from aa and tt
-        double xx = aa * tt;
-        double dxx_drs = daa_drs * tt;
-        double dxx_dtt = aa;
-
-        // From xx to pade
-        double pade_den = 1.0/(1.0 + xx * (1.0 + xx));
-        double pade = (1.0 + xx) * pade_den;
-        double dpade_dxx = -xx * (2.0 + xx) * pow(pade_den,2);
-        double dpade_drs = dpade_dxx * dxx_drs;
-        double dpade_dtt = dpade_dxx * dxx_dtt;
-        //dpade_dzeta = dpade_dxx * dxx_dzeta;
-
-        // From pade to qq
-        double coeff_qq = tt * phi_zeta_inv * phi_zeta_inv;
-        double qq = coeff_qq * pade;
-        double dqq_drs = coeff_qq * dpade_drs;
-        double dqq_dtt = pade * phi_zeta_inv * phi_zeta_inv + coeff_qq * dpade_dtt;
-        //dqq_dzeta = coeff_qq * (dpade_dzeta - 2.0 * pade * phi_logder);
-
-        // From qq to rr
-        double arg_rr = 1.0 + beta * gamma_inv * qq;
-        double div_rr = 1.0/arg_rr;
-        double rr = gamma * log(arg_rr);
-        double drr_dqq = beta * div_rr;
-        double drr_drs = drr_dqq * dqq_drs;
-        double drr_dtt = drr_dqq * dqq_dtt;
-        //drr_dzeta = drr_dqq * dqq_dzeta;
-
-        // From rr to hh
-        double hh = phi3_zeta * rr;
-        double dhh_drs = phi3_zeta * drr_drs;
-        double dhh_dtt = phi3_zeta * drr_dtt;
-        //dhh_dzeta = phi3_zeta * (drr_dzeta + 3.0 * rr * phi_logder);
-
-        // The GGA correlation energy is added
-        ec[i] += hh;
-
-        // From hh to the derivative of the energy wrt the density
-        double drhohh_drho = hh - third * rs * dhh_drs - (7.0/3.0) * tt * dhh_dtt; //- zeta * dhh_dzeta 
-        vc[i] += drhohh_drho;
+        for (int k = 0; k < len; k++) {
+            double dbb_drs = decrs_drs[k] * gamphi3inv;
+            // From bb to cc
+            double cc = 1.0/(exp_pbe[k] - 1.0);
+            double dcc_dbb = cc * cc * exp_pbe[k];
+            double dcc_drs = dcc_dbb * dbb_drs;
+            // From cc to aa
+            double aa = coeff_aa * cc;
+            double daa_drs = coeff_aa * dcc_drs;
+            // Introduce tt : do not assume that the spin-dependent gradients are collinear
+            double rhotot_inv = rhom1_3[k] * rhom1_3[k] * rhom1_3[k];
+            dtt_dg[k] = 2.0 * rhotot_inv * rhotot_inv * rhom1_3[k] * coeff_tt;
+            // Note that tt is (the t variable of PBE divided by phi) squared
+            tt[k] = 0.5 * sigma[i0+k] * dtt_dg[k];
+            // Get xx from aa and tt
+            double xx = aa * tt[k];
+            double dxx_drs = daa_drs * tt[k];
+            double dxx_dtt = aa;
+            // From xx to pade
+            double pade_den = 1.0/(1.0 + xx * (1.0 + xx));
+            double pade = (1.0 + xx) * pade_den;
+            double dpade_dxx = -xx * (2.0 + xx) * (pade_den * pade_den);
+            double dpade_drs = dpade_dxx * dxx_drs;
+            double dpade_dtt = dpade_dxx * dxx_dtt;
+            // From pade to qq
+            double coeff_qq = tt[k] * phi_zeta_inv * phi_zeta_inv;
+            double qq = coeff_qq * pade;
+            dqq_drs[k] = coeff_qq * dpade_drs;
+            dqq_dtt[k] = pade * phi_zeta_inv * phi_zeta_inv + coeff_qq * dpade_dtt;
+            // From qq to rr
+            arg_rr[k] = 1.0 + beta * gamma_inv * qq;
+        }
 
-        // From hh to the derivative of the energy wrt to the gradient of the
-        // density, divided by the gradient of the density
-        // (The v3.3 definition includes the division by the norm of the gradient)
-        v2c[i] = (rho[i] * dtt_dg * dhh_dtt);    
+        for (int k = 0; k < len; k++) {
+            double div_rr = 1.0/arg_rr[k];
+            double drr_dqq = beta * div_rr;
+            double drr_drs = drr_dqq * dqq_drs[k];
+            double drr_dtt = drr_dqq * dqq_dtt[k];
+            dqq_drs[k] = drr_drs;
+            dqq_dtt[k] = drr_dtt;
+        }
+        for (int k = 0; k < len; k++)
+            arg_rr[k] = log(arg_rr[k]);
+
+        for (int k = 0; k < len; k++) {
+            double rr = gamma * arg_rr[k];
+            // From rr to hh
+            double hh = phi3_zeta * rr;
+            double dhh_drs = phi3_zeta * dqq_drs[k];
+            double dhh_dtt = phi3_zeta * dqq_dtt[k];
+            // The GGA correlation energy is added
+            ec[i0+k] += hh;
+            // From hh to the derivative of the energy wrt the density
+            double drhohh_drho = hh - third * rs[k] * dhh_drs - (7.0/3.0) * tt[k] * dhh_dtt;
+            vc[i0+k] += drhohh_drho;
+            // From hh to the derivative of the energy wrt to the gradient of the
+            // density, divided by the gradient of the density
+            // (The v3.3 definition includes the division by the norm of the gradient)
+            v2c[i0+k] = (rho[i0+k] * dtt_dg[k] * dhh_dtt);
+        }
     }
 }
 
@@ -762,15 +826,16 @@ void slater_spin(int DMnd, double *rho, double *ex, double *vx) {
     double threefourth_divpi = (3.0/4.0) / M_PI;
     double sixpi2_1_3 = pow(6.0*M_PI*M_PI, third);
 
+    #pragma omp parallel for schedule(static)
     for(int i = 0; i < DMnd; i++) {
-        double rhom1_3 = pow(rho[i],-third);
-        double rhotot_inv = pow(rhom1_3,3.0);  
+        double rhom1_3 = 1.0 / cbrt(rho[i]);
+        double rhotot_inv = rhom1_3 * rhom1_3 * rhom1_3;  
 
         // First take care of the exchange part of the functional
         double extot = 0.0;
         for(int spn_i = 0; spn_i < 2; spn_i++){
             double rho_updn = rho[DMnd + spn_i*DMnd + i]; 
-            double rho_updnm1_3 = pow(rho_updn, -third);
+            double rho_updnm1_3 = 1.0 / cbrt(rho_updn);
             double rhomot = rho_updnm1_3;
             double ex_lsd = -threefourth_divpi * sixpi2_1_3 * (rhomot * rhomot * rho_updn);
             vx[spn_i*DMnd + i] = (4.0/3.0) * ex_lsd;
@@ -802,14 +867,15 @@ void pw_spin(int DMnd, double *rho, double *ec, double *vc) {
     double ec0_b3 = 1.6382;   double ec1_b3 = 3.3662;   double mac_b3 = 0.88026;
     double ec0_b4 = 0.49294;  double ec1_b4 = 0.62517;  double mac_b4 = 0.49671;
 
+    #pragma omp parallel for schedule(static)
     for(int i = 0; i < DMnd; i++) {
-        double rhom1_3 = pow(rho[i],-third);
-        double rhotot_inv = pow(rhom1_3,3.0);
+        double rhom1_3 = 1.0 / cbrt(rho[i]);
+        double rhotot_inv = rhom1_3 * rhom1_3 * rhom1_3;
         double zeta = (rho[DMnd+i] - rho[2*DMnd+i]) * rhotot_inv;
         double zetp = 1.0 + zeta * alpha_zeta;
         double zetm = 1.0 - zeta * alpha_zeta;
-        double zetpm1_3 = pow(zetp,-third);
-        double zetmm1_3 = pow(zetm,-third);
+        double zetpm1_3 = 1.0 / cbrt(zetp);
+        double zetmm1_3 = 1.0 / cbrt(zetm);
         double rhotmo6 = sqrt(rhom1_3);
         double rhoto6 = rho[i] * rhom1_3 * rhom1_3 * rhotmo6;
 
@@ -844,18 +910,18 @@ void pw_spin(int DMnd, double *rho, double *ec, double *vc) {
         double decrs1_drs = -2.0 * ec1_aa * ec1_a1 * ec1_log - ec1_q0 * ec1_q1p * ec1_den;
         
         // alpha_zeta is introduced in order to remove singularities for fully polarized systems.
-        double zetp_1_3 = (1.0 + zeta * alpha_zeta) * pow(zetpm1_3,2.0);
-        double zetm_1_3 = (1.0 - zeta * alpha_zeta) * pow(zetmm1_3,2.0);
+        double zetp_1_3 = (1.0 + zeta * alpha_zeta) * (zetpm1_3 * zetpm1_3);
+        double zetm_1_3 = (1.0 - zeta * alpha_zeta) * (zetmm1_3 * zetmm1_3);
 
         double f_zeta = ( (1.0 + zeta * alpha_zeta2) * zetp_1_3 + (1.0 - zeta * alpha_zeta2) * zetm_1_3 - 2.0 ) * factf_zeta;
         double fp_zeta = ( zetp_1_3 - zetm_1_3 ) * factfp_zeta;
-        double zeta4 = pow(zeta, 4.0);
+        double zeta4 = (zeta * zeta) * (zeta * zeta);
 
         double gcrs = ecrs1 - ecrs0 + macrs * fsec_inv;
         double ecrs = ecrs0 + f_zeta * (zeta4 * gcrs - macrs * fsec_inv);
         double dgcrs_drs = decrs1_drs - decrs0_drs + dmacrs_drs * fsec_inv;
         double decrs_drs = decrs0_drs + f_zeta * (zeta4 * dgcrs_drs - dmacrs_drs * fsec_inv);
-        double dfzeta4_dzeta = 4.0 * pow(zeta,3.0) * f_zeta + fp_zeta * zeta4;
+        double dfzeta4_dzeta = 4.0 * (zeta * zeta * zeta) * f_zeta + fp_zeta * zeta4;
         double decrs_dzeta = dfzeta4_dzeta * gcrs - fp_zeta * macrs * fsec_inv;
         double vxcadd = ecrs - rs * third * decrs_drs - zeta * decrs_dzeta;
 
@@ -897,30 +963,26 @@ void pbex_spin(int DMnd, double *rho, double *sigma, int iflag, double *ex, doub
     double third = 1.0/3.0;
     double sixpi2_1_3 = pow(6.0*M_PI*M_PI, third);
     double sixpi2m1_3 = 1.0/sixpi2_1_3;
+    int rpbe = (iflag == 3);
 
+    #pragma omp parallel for schedule(static)
     for(int i = 0; i < DMnd; i++) {
-        double rhom1_3 = pow(rho[i],-third);
-        double rhotot_inv = pow(rhom1_3,3.0);
+        double rhom1_3 = 1.0 / cbrt(rho[i]);
+        double rhotot_inv = rhom1_3 * rhom1_3 * rhom1_3;
 
         // First take care of the exchange part of the functional
         double extot = 0.0;
         for(int spn_i = 0; spn_i < 2; spn_i++){
             double rho_updn = rho[DMnd + spn_i*DMnd + i];
-            double rho_updnm1_3 = pow(rho_updn, -third);
+            double rho_updnm1_3 = 1.0 / cbrt(rho_updn);
             double rhomot = rho_updnm1_3;
             double ex_lsd = -threefourth_divpi * sixpi2_1_3 * (rhomot * rhomot * rho_updn);
             double rho_inv = rhomot * rhomot * rhomot;
             double coeffss = (1.0/4.0) * sixpi2m1_3 * sixpi2m1_3 * (rho_inv * rho_inv * rhomot * rhomot);
             double ss = sigma[DMnd + spn_i*DMnd + i] * coeffss;
             
-            double divss, dfxdss;
-            if (iflag == 1 || iflag == 2 || iflag == 4) {
-                divss = 1.0/(1.0 + mu_divkappa * ss);
-                dfxdss = mu * (divss * divss);
-            } else if (iflag == 3) {
-                divss = exp(-mu_divkappa * ss);
-                dfxdss = mu * divss;
-            }
+            double divss = rpbe ? exp(-mu_divkappa * ss) : 1.0/(1.0 + mu_divkappa * ss);
+            double dfxdss = rpbe ? mu * divss : mu * (divss * divss);
 
 			double fx = 1.0 + kappa * (1.0 - divss);
             double ex_gga = ex_lsd * fx;
@@ -953,22 +1015,26 @@ void rPW86x_spin(int DMnd, double *rho, double *sigma, double *vdWDFex, double *
     int i;
     double two_pow13 = pow(2.0, 1.0/3.0);
     
+    #pragma omp parallel for private(s, s_2, s_3, s_4, s_5, s_6, fs, grad_rho, df_ds) schedule(static)
     for (i = 0; i < 2*DMnd; i++) {
         if (sigma[i] < 1E-14) sigma[i] = 1E-14;
         grad_rho = sqrt(sigma[i]);
-        s = grad_rho / (two_pow13 * s_prefactor*pow(rho[DMnd + i], four_thirds));
+        double rho_1_3 = cbrt(rho[DMnd + i]);
+        s = grad_rho / (two_pow13 * s_prefactor*rho[DMnd + i]*rho_1_3);
         s_2 = s*s;
         s_3 = s_2*s;
         s_4 = s_3*s;
         s_5 = s_3*s_2;
         s_6 = s_5*s;
 
-        fs = pow(1.0 + a*s_2 + b*s_4 + c*s_6, 1.0/15.0);
-        exUpDn[i] = Ax * two_pow13 * pow(rho[DMnd + i], 1.0/3.0 + 1.0) * fs; // \epsilon_x, not n\epsilon_x
-        df_ds = (1.0/(15.0*pow(fs, 14.0))) * (2.0*a*s + 4.0*b*s_3 + 6.0*c*s_5);
-        vdWDFVx1[i] = Ax*four_thirds * (two_pow13 * pow(rho[DMnd + i], 1.0/3.0)*fs - grad_rho/(s_prefactor*rho[DMnd + i])*df_ds);
+        double fs15 = 1.0 + a*s_2 + b*s_4 + c*s_6;
+        fs = pow(fs15, 1.0/15.0);
+        exUpDn[i] = Ax * two_pow13 * rho[DMnd + i]*rho_1_3 * fs; // \epsilon_x, not n\epsilon_x
+        df_ds = (fs/(15.0*fs15)) * (2.0*a*s + 4.0*b*s_3 + 6.0*c*s_5); // fs^14 = fs15/fs
+        vdWDFVx1[i] = Ax*four_thirds * (two_pow13 * rho_1_3*fs - grad_rho/(s_prefactor*rho[DMnd + i])*df_ds);
         vdWDFVx2[i] = Ax * df_ds/(s_prefactor*grad_rho);
     }
+    #pragma omp parallel for schedule(static)
     for (i = 0; i < DMnd; i++) {
         vdWDFex[i] = (exUpDn[i] + exUpDn[DMnd + i]) / rho[i];
     }
@@ -1008,14 +1074,15 @@ void pbec_spin(int DMnd, double *rho, double *sigma, int iflag, double *ec, doub
     double ec0_b3 = 1.6382;   double ec1_b3 = 3.3662;   double mac_b3 = 0.88026;
     double ec0_b4 = 0.49294;  double ec1_b4 = 0.62517;  double mac_b4 = 0.49671;
     
+    #pragma omp parallel for schedule(static)
     for(int i = 0; i < DMnd; i++) {
-        double rhom1_3 = pow(rho[i],-third);
-        double rhotot_inv = pow(rhom1_3,3.0);
+        double rhom1_3 = 1.0 / cbrt(rho[i]);
+        double rhotot_inv = rhom1_3 * rhom1_3 * rhom1_3;
         double zeta = (rho[DMnd + i] - rho[2*DMnd + i]) * rhotot_inv;
         double zetp = 1.0 + zeta * alpha_zeta;
         double zetm = 1.0 - zeta * alpha_zeta;
-        double zetpm1_3 = pow(zetp,-third);
-        double zetmm1_3 = pow(zetm,-third);
+        double zetpm1_3 = 1.0 / cbrt(zetp);
+        double zetmm1_3 = 1.0 / cbrt(zetm);
         double rhotmo6 = sqrt(rhom1_3);
         double rhoto6 = rho[i] * rhom1_3 * rhom1_3 * rhotmo6;
 
@@ -1050,18 +1117,18 @@ void pbec_spin(int DMnd, double *rho, double *sigma, int iflag, double *ec, doub
         double decrs1_drs = -2.0 * ec1_aa * ec1_a1 * ec1_log - ec1_q0 * ec1_q1p * ec1_den;
         
         // alpha_zeta is introduced in order to remove singularities for fully polarized systems.
-        double zetp_1_3 = (1.0 + zeta * alpha_zeta) * pow(zetpm1_3,2.0);
-        double zetm_1_3 = (1.0 - zeta * alpha_zeta) * pow(zetmm1_3,2.0);
+        double zetp_1_3 = (1.0 + zeta * alpha_zeta) * (zetpm1_3 * zetpm1_3);
+        double zetm_1_3 = (1.0 - zeta * alpha_zeta) * (zetmm1_3 * zetmm1_3);
 
         double f_zeta = ( (1.0 + zeta * alpha_zeta2) * zetp_1_3 + (1.0 - zeta * alpha_zeta2) * zetm_1_3 - 2.0 ) * factf_zeta;
         double fp_zeta = ( zetp_1_3 - zetm_1_3 ) * factfp_zeta;
-        double zeta4 = pow(zeta, 4.0);
+        double zeta4 = (zeta * zeta) * (zeta * zeta);
 
         double gcrs = ecrs1 - ecrs0 + macrs * fsec_inv;
         double ecrs = ecrs0 + f_zeta * (zeta4 * gcrs - macrs * fsec_inv);
         double dgcrs_drs = decrs1_drs - decrs0_drs + dmacrs_drs * fsec_inv;
         double decrs_drs = decrs0_drs + f_zeta * (zeta4 * dgcrs_drs - dmacrs_drs * fsec_inv);
-        double dfzeta4_dzeta = 4.0 * pow(zeta,3.0) * f_zeta + fp_zeta * zeta4;
+        double dfzeta4_dzeta = 4.0 * (zeta * zeta * zeta) * f_zeta + fp_zeta * zeta4;
         double decrs_dzeta = dfzeta4_dzeta * gcrs - fp_zeta * macrs * fsec_inv;
 
         ec[i] = ecrs;
@@ -1113,7 +1180,7 @@ void pbec_spin(int DMnd, double *rho, double *sigma, int iflag, double *ec, doub
         // From xx to pade
         double pade_den = 1.0/(1.0 + xx * (1.0 + xx));
         double pade = (1.0 + xx) * pade_den;
-        double dpade_dxx = -xx * (2.0 + xx) * pow(pade_den,2.0);
+        double dpade_dxx = -xx * (2.0 + xx) * (pade_den * pade_den);
         double dpade_drs = dpade_dxx * dxx_drs;
         double dpade_dtt = dpade_dxx * dxx_dtt;
         double dpade_dzeta = dpade_dxx * dxx_dzeta;
@@ -1338,6 +1405,207 @@ void pbexsr(double rho, double grho, double omega, double *e_xc_sr, double *XCPo
 }
 
 
+/**
+ * @brief   Evaluate the HSE short-range enhancement factor F(s,x) and its 
+ *          derivatives F_s and F_x in the table variables, x = sqrt(w/WMAX).
+ */
+static void wpbe_sx(double s, double x, double *F, double *Fs, double *Fx)
+{
+    // rho_ref = 1/(3 pi^2) gives kF = 1, so that w = omega/kF is passed directly
+    double rho_ref = 1.0 / (3.0*M_PI*M_PI);
+    double w = WPBE_TAB_WMAX*x*x;
+    double d1rfx, d1rw;
+    if (w < 1e-14) w = 1e-14;
+    wpbe_analy_erfc_approx_grad(rho_ref, s, w, F, &d1rfx, Fs);
+    d1rw = -w / (3.0*rho_ref);
+    *Fx = d1rfx / d1rw * 2.0 * WPBE_TAB_WMAX * x;
+}
+
+
+/**
+ * @brief   Fill the nodes of an n x n bicubic Hermite table of the HSE 
+ *          short-range enhancement factor. Each node stores F, F_s, F_x and F_sx.
+ *
+ *          The rows are distributed over all processes and summed up.
+ */
+static void wpbe_table_fill(int n, double *tab)
+{
+    int rank, nproc;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+    double hs = WPBE_TAB_SMAX / n, hx = 1.0 / n;
+    int len = 4 * (n+1) * (n+1);
+    memset(tab, 0, sizeof(double) * len);
+    for (int j = rank; j <= n; j += nproc) {
+        double x = j * hx;
+        // F_sx by central difference of F_s in x, one-sided at x = 0
+        double d = 1e-4 * hx;
+        double xp = x + d, xm = (x - d < 0.0) ? x : x - d;
+        #pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i <= n; i++) {
+            double s = i * hs, F, Fx, Fsp, Fsm;
+            double *t = tab + 4 * (j*(n+1) + i);
+            wpbe_sx(s, x, t, t+1, t+2);
+            wpbe_sx(s, xp, &F, &Fsp, &Fx);
+            wpbe_sx(s, xm, &F, &Fsm, &Fx);
+            t[3] = (Fsp - Fsm) / (xp - xm);
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, tab, len, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+}
+
+
+/**
+ * @brief   Bicubic Hermite interpolation of the tabulated HSE short-range 
+ *          enhancement factor, 0 <= s <= WPBE_TAB_SMAX, 0 <= x <= 1.
+ */
+static inline void wpbe_table_interp(const double *tab, int n, double s, double x, 
+                                     double *F, double *Fs, double *Fx)
+{
+    double hs = WPBE_TAB_SMAX / n, hx = 1.0 / n;
+    double ts = s / hs, tx = x / hx;
+    int i = (int) ts, j = (int) tx;
+    if (i > n-1) i = n-1;
+    if (j > n-1) j = n-1;
+    double t = ts - i, u = tx - j;
+    double t2 = t*t, t3 = t2*t, u2 = u*u, u3 = u2*u;
+    // Hermite basis (value/slope at both ends) and their derivatives
+    double h0[2] = {2*t3-3*t2+1, 3*t2-2*t3}, h1[2] = {(t3-2*t2+t)*hs, (t3-t2)*hs};
+    double d0[2] = {6*(t2-t)/hs, 6*(t-t2)/hs}, d1[2] = {3*t2-4*t+1, 3*t2-2*t};
+    double g0[2] = {2*u3-3*u2+1, 3*u2-2*u3}, g1[2] = {(u3-2*u2+u)*hx, (u3-u2)*hx};
+    double e0[2] = {6*(u2-u)/hx, 6*(u-u2)/hx}, e1[2] = {3*u2-4*u+1, 3*u2-2*u};
+    double f = 0.0, fs = 0.0, fx = 0.0;
+    for (int b = 0; b < 2; b++) {
+        for (int a = 0; a < 2; a++) {
+            const double *c = tab + 4 * ((j+b)*(n+1) + i+a);
+            f  += (c[0]*h0[a] + c[1]*h1[a]) * g0[b] + (c[2]*h0[a] + c[3]*h1[a]) * g1[b];
+            fs += (c[0]*d0[a] + c[1]*d1[a]) * g0[b] + (c[2]*d0[a] + c[3]*d1[a]) * g1[b];
+            fx += (c[0]*h0[a] + c[1]*h1[a]) * e0[b] + (c[2]*h0[a] + c[3]*h1[a]) * e1[b];
+        }
+    }
+    *F = f; *Fs = fs; *Fx = fx;
+}
+
+
+/**
+ * @brief   Maximum interpolation error of the table, measured at cell centers 
+ *          on F, F_s and x*F_x.
+ */
+static double wpbe_table_error(int n, const double *tab)
+{
+    int rank, nproc;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+    double hs = WPBE_TAB_SMAX / n, hx = 1.0 / n;
+    double err = 0.0;
+    for (int j = rank; j < n; j += nproc) {
+        double x = (j + 0.5) * hx;
+        #pragma omp parallel for schedule(dynamic) reduction(max:err)
+        for (int i = 0; i < n; i++) {
+            double s = (i + 0.5) * hs;
+            double F, Fs, Fx, Ft, Fst, Fxt;
+            wpbe_sx(s, x, &F, &Fs, &Fx);
+            wpbe_table_interp(tab, n, s, x, &Ft, &Fst, &Fxt);
+            err = max(err, fabs(F - Ft));
+            err = max(err, fabs(Fs - Fst));
+            err = max(err, fabs(Fx - Fxt) * x);
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &err, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    return err;
+}
+
+
+/**
+ * @brief   Create the table of the HSE short-range enhancement factor. The 
+ *          table is refined until its error is below EXX_SR_TABLE_TOL.
+ */
+void wpbe_table_create(SPARC_OBJ *pSPARC)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    double err = 0.0;
+    int n;
+    for (n = WPBE_TAB_NMIN; n <= WPBE_TAB_NMAX; n *= 2) {
+        pSPARC->wpbe_tab = (double *) realloc(pSPARC->wpbe_tab, sizeof(double) * 4 * (n+1) * (n+1));
+        assert(pSPARC->wpbe_tab != NULL);
+        wpbe_table_fill(n, pSPARC->wpbe_tab);
+        err = wpbe_table_error(n, pSPARC->wpbe_tab);
+        if (err <= pSPARC->exx_sr_table_tol) break;
+    }
+    if (n > WPBE_TAB_NMAX) {
+        n = WPBE_TAB_NMAX;
+        if (!rank) printf("WARNING: EXX_SR_TABLE_TOL = %.3E is not reached, the table error is %.3E.\n", 
+                            pSPARC->exx_sr_table_tol, err);
+    }
+    pSPARC->wpbe_tab_n = n;
+#ifdef DEBUG
+    if (!rank) printf("HSE short-range enhancement factor table: %d x %d intervals, error %.3E\n", n, n, err);
+#endif
+}
+
+
+/**
+ * @brief   Calculate PBE short ranged exchange for a batch of grid points.
+ *
+ *          Points within the range of the table use the interpolated 
+ *          enhancement factor when the table exists, the others call 
+ *          wpbe_analy_erfc_approx_grad.
+ */
+void pbexsr_vec(SPARC_OBJ *pSPARC, int DMnd, double *rho, double *grho, 
+                double *e_xc_sr, double *XCPotential_sr, double *Dxcdgrho_sr)
+{
+    double us = 0.161620459673995492;
+    double ax = -0.738558766382022406;
+    double f1 = -1.10783814957303361;
+    double alpha = 2.0/3.0;
+    double omega = pSPARC->hyb_range_pbe;
+    double cbrt_3pi2 = cbrt(3.0*M_PI*M_PI);
+    double *tab = pSPARC->wpbe_tab;
+    int n = pSPARC->wpbe_tab_n;
+    int nchunk = (DMnd + XC_CHUNK - 1) / XC_CHUNK;
+
+    #pragma omp parallel for schedule(static)
+    for (int ic = 0; ic < nchunk; ic++) {
+        double rs[XC_CHUNK], s[XC_CHUNK], x[XC_CHUNK];
+        double fx[XC_CHUNK], d1x[XC_CHUNK], d2x[XC_CHUNK];
+        int i0 = ic * XC_CHUNK;
+        int len = (DMnd - i0 < XC_CHUNK) ? DMnd - i0 : XC_CHUNK;
+        double *r = rho + i0, *g = grho + i0;
+
+        for (int k = 0; k < len; k++) {
+            rs[k] = cbrt(r[k]);
+            double rr = 1.0 / (r[k]*rs[k]);
+            double s2 = g[k]*rr*rr*us*us;
+            s[k] = sqrt(s2);
+            if (s[k] > 8.3)
+                s[k] = 8.572844 - 18.796223/s2;
+            x[k] = sqrt(omega / (cbrt_3pi2 * rs[k] * WPBE_TAB_WMAX));
+        }
+
+        for (int k = 0; k < len; k++) {
+            if (tab != NULL && x[k] <= 1.0) {
+                double Fx;
+                wpbe_table_interp(tab, n, s[k], x[k], fx+k, d2x+k, &Fx);
+                d1x[k] = -Fx * x[k] / (6.0 * r[k]);
+            } else {
+                wpbe_analy_erfc_approx_grad(r[k], s[k], omega, fx+k, d1x+k, d2x+k);
+            }
+        }
+
+        for (int k = 0; k < len; k++) {
+            double vx = (4.0/3.0)*f1*alpha*rs[k];
+            double rr = 1.0 / (r[k]*rs[k]);
+            double ex = ax/rr;
+            double dsdn = -4.0/3.0*s[k]/r[k];
+            e_xc_sr[i0+k] = ex*fx[k];
+            XCPotential_sr[i0+k] = vx*fx[k] + (dsdn*d2x[k]+d1x[k])*ex;
+            Dxcdgrho_sr[i0+k] = ex/sqrt(g[k])*us*rr*d2x[k];
+        }
+    }
+}
+
+
 /**
  * @brief   Calculate PBE short ranged enhancement factor
  *          Taken from Quantum Espresson
@@ -18,6 +18,7 @@
 #include "parallelization.h"
 #include "isddft.h"
 #include "tools.h"
+#include "mixedPrecisionFilter.h"
 #include "eigenSolver.h"     // free_GTM_CheFSI()
 #include "eigenSolverKpt.h"  // free_GTM_CheFSI_kpt()
 #include "exactExchangeFinalization.h"
@@ -26,7 +27,10 @@
 #include "mGGAfinalization.h"
 #include "sqFinalization.h"
 #include "cyclix_tools.h"
+#include "multigrid.h"
+#include "pencilFFT.h"
 #include "sparc_mlff_interface.h"
+#include "incrementalUpdate.h"
 
 /* ScaLAPACK routines */
 #ifdef USE_MKL
@@ -144,6 +148,10 @@ void Free_basic(SPARC_OBJ *pSPARC) {
         free(pSPARC->psd[i].SplineFitUdV);
         free(pSPARC->psd[i].SplineFitIsoAtomDen);
         free(pSPARC->psd[i].SplineRhocD);
+        free(pSPARC->psd[i].SplineTabrVloc);
+        free(pSPARC->psd[i].SplineTabUdV);
+        free(pSPARC->psd[i].SplineTabIsoAtomDen);
+        free(pSPARC->psd[i].SplineTabRhoc);
         free(pSPARC->psd[i].rc);
         free(pSPARC->psd[i].Gamma);
         free(pSPARC->psd[i].rho_c_table);
@@ -182,6 +190,7 @@ void Free_basic(SPARC_OBJ *pSPARC) {
             free(pSPARC->Dxcdgrho);
         }    
         free(pSPARC->elecstPotential);
+        Free_multigrid(pSPARC);
         free(pSPARC->Veff_loc_dmcomm_phi);
         
         // free MD and relax stuff
@@ -230,6 +239,17 @@ void Free_basic(SPARC_OBJ *pSPARC) {
         free(pSPARC->precondcoeff_a);
         free(pSPARC->precondcoeff_lambda_sqr);
     }
+    if (pSPARC->PrecondFFT != NULL) {
+        Pencil_FFT_free(pSPARC->PrecondFFT);
+        free(pSPARC->PrecondFFT);
+        free(pSPARC->PrecondFFT_lap);
+    }
+
+    // free the atom influence lists and projectors kept by the incremental update
+    IncrementalUpdate_free(pSPARC);
+
+    // free the workspace of the nonlocal operator
+    free(pSPARC->Vnl_work);
 
     if (pSPARC->mlff_flag > 1){
         free_MLFF(pSPARC->mlff_str);
@@ -262,6 +282,11 @@ void Free_SPARC(SPARC_OBJ *pSPARC) {
             free(pSPARC->Yorb_kpt);
         }
     }
+    // orbitals of the previous relax/MD steps, NULL if not stored
+    free(pSPARC->Xorb_1dt);
+    free(pSPARC->Xorb_2dt);
+    free(pSPARC->Xorb_kpt_1dt);
+    free(pSPARC->Xorb_kpt_2dt);
 
     #if defined(USE_MKL) || defined(USE_SCALAPACK)
     if (pSPARC->isGammaPoint) {
@@ -395,10 +420,14 @@ void Free_SPARC(SPARC_OBJ *pSPARC) {
 void Free_scfvar(SPARC_OBJ *pSPARC) {	
 	int i, j;
 	
+    // keep the atom influence lists and projectors for the next step
+    if (IncrementalUpdate_store(pSPARC)) return;
+	
 	int iat, ityp;
 	if (pSPARC->isGammaPoint){
         // deallocate nonlocal projectors in psi-domain
         if (pSPARC->dmcomm != MPI_COMM_NULL && pSPARC->bandcomm_index >= 0) {
+            Free_NonlocalProjectors_sp(pSPARC->nlocProj, pSPARC->Atom_Influence_nloc, pSPARC->Ntypes);
             for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) { 
                 // if (! pSPARC->nlocProj[ityp].nproj) continue;
                 if (! pSPARC->nlocProj[ityp].nproj) {
@@ -443,6 +472,7 @@ void Free_scfvar(SPARC_OBJ *pSPARC) {
     } else{
         // deallocate nonlocal projectors in psi-domain
         if (pSPARC->dmcomm != MPI_COMM_NULL && pSPARC->bandcomm_index >= 0) {
+            Free_NonlocalProjectors_sp(pSPARC->nlocProj, pSPARC->Atom_Influence_nloc, pSPARC->Ntypes);
             for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) { 
                 // if (! pSPARC->nlocProj[ityp].nproj) continue;
                 if (! pSPARC->nlocProj[ityp].nproj) {
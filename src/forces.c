@@ -34,6 +34,7 @@
 #include "d3forceStress.h"
 #include "cyclix_forces.h"
 #include "cyclix_tools.h"
+#include "nlocForceStress.h"
 
 #ifdef SPARCX_ACCEL
 	#include "accel.h"
@@ -733,7 +734,11 @@ void Calculate_nonlocal_forces(SPARC_OBJ *pSPARC)
         } else
     #endif
         {
-            Calculate_nonlocal_forces_linear(pSPARC);
+            // compute the nonlocal and kinetic stress in the same pass over the orbitals
+            if (pSPARC->Calc_stress == 1 && pSPARC->CyclixFlag == 0)
+                Calculate_nonlocal_forces_stress_linear(pSPARC);
+            else
+                Calculate_nonlocal_forces_linear(pSPARC);
         }
     } else {
         #ifdef SPARCX_ACCEL
@@ -743,7 +748,10 @@ void Calculate_nonlocal_forces(SPARC_OBJ *pSPARC)
             } else
         #endif	
         {
-            Calculate_nonlocal_forces_kpt(pSPARC);
+            if (pSPARC->Calc_stress == 1 && pSPARC->CyclixFlag == 0)
+                Calculate_nonlocal_forces_stress_kpt(pSPARC);
+            else
+                Calculate_nonlocal_forces_kpt(pSPARC);
         }
     }
 }
@@ -19,6 +19,7 @@
 
 #include "gradVecRoutines.h"
 #include "isddft.h"
+#include "haloExchange.h"
 #include "cyclix_gradVec.h"
 
 
@@ -104,28 +105,20 @@ void Gradient_vec_dir(const SPARC_OBJ *pSPARC, const int DMnd, const int *DMVert
     int count, n, k, j, i, nshift, kshift, jshift;
     int nbrcount, nbr_i;
     
-    MPI_Request request;
+    HALO_PLAN_OBJ *halo = NULL;
     double *x_in, *x_out;   
     
     if(nproc > 1){
-        int nd_in = ncol * pSPARC->order * (isDir[0] * DMny * DMnz + DMnx * isDir[1] * DMnz + DMnxny * isDir[2]);
-        int nd_out = nd_in;
-        x_in  = (double *)calloc( nd_in, sizeof(double));
-        x_out = (double *)malloc( nd_out * sizeof(double)); // no need to init x_out
+        // number of halo values per vector exchanged with each neighbor, only along dir
+        int nbr_size[6];
+        nbr_size[0] = nbr_size[1] = FDn * (DMny * DMnz * isDir[0]);
+        nbr_size[2] = nbr_size[3] = FDn * (DMnx * DMnz * isDir[1]);
+        nbr_size[4] = nbr_size[5] = FDn * (DMnxny * isDir[2]);
 
-        int sendcounts[6], sdispls[6], recvcounts[6], rdispls[6];
-        // set up parameters for MPI_Ineighbor_alltoallv
-        // TODO: do this in Initialization to save computation time!
-        sendcounts[0] = sendcounts[1] = recvcounts[0] = recvcounts[1] = ncol * FDn * (DMny * DMnz * isDir[0]);
-        sendcounts[2] = sendcounts[3] = recvcounts[2] = recvcounts[3] = ncol * FDn * (DMnx * DMnz * isDir[1]);
-        sendcounts[4] = sendcounts[5] = recvcounts[4] = recvcounts[5] = ncol * FDn * (DMnxny * isDir[2]);
-    
-        rdispls[0] = sdispls[0] = 0;
-        rdispls[1] = sdispls[1] = sdispls[0] + sendcounts[0];
-        rdispls[2] = sdispls[2] = sdispls[1] + sendcounts[1];
-        rdispls[3] = sdispls[3] = sdispls[2] + sendcounts[2];
-        rdispls[4] = sdispls[4] = sdispls[3] + sendcounts[3];
-        rdispls[5] = sdispls[5] = sdispls[4] + sendcounts[4];
+        // the buffers are owned by the plan, x_in is 0 for the missing neighbors
+        halo = Halo_plan_get(comm, MPI_DOUBLE, 6, nbr_size, ncol);
+        x_in  = (double *) halo->recvbuf;
+        x_out = (double *) halo->sendbuf;
 
         count = 0;
         for (nbr_i = dir*2; nbr_i < dir*2+2; nbr_i++) {
@@ -146,16 +139,15 @@ void Gradient_vec_dir(const SPARC_OBJ *pSPARC, const int DMnd, const int *DMVert
         }    
 
         // first transfer info. to/from neighbor processors
-        MPI_Ineighbor_alltoallv(x_out, sendcounts, sdispls, MPI_DOUBLE, 
-                                x_in, recvcounts, rdispls, MPI_DOUBLE, 
-                                comm, &request); // non-blocking
+        Halo_plan_start(halo); // non-blocking
     }                             
  
     // while the non-blocking communication is undergoing, compute Dx which only requires values from local memory
     int pshift_ex = 0;
     double *D1_stencil_coeffs_dim;
     D1_stencil_coeffs_dim = (double *)malloc((FDn + 1) * sizeof(double));
-    double *x_ex = (double *)malloc(ncol * DMnd_ex * sizeof(double));
+    // the extended domain is kept by the plan
+    double *x_ex = (double *)Halo_ex_buffer(comm, halo, ncol * DMnd_ex * sizeof(double));
     D1_stencil_coeffs_dim[0] = 0.0;
     
     int p;
@@ -224,7 +216,7 @@ void Gradient_vec_dir(const SPARC_OBJ *pSPARC, const int DMnd, const int *DMVert
         kstart[5] = DMnz+exDir[2]; kend[5] = DMnz+2*exDir[2];
 
         // make sure receive buffer is ready
-        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        Halo_plan_wait(halo);
 
         // copy receive buffer into extended domain
         count = 0;
@@ -242,8 +234,6 @@ void Gradient_vec_dir(const SPARC_OBJ *pSPARC, const int DMnd, const int *DMVert
                 }
             }
         }
-        free(x_out);
-        free(x_in);
     } else {
         int istart_in[6], iend_in[6], jstart_in[6], jend_in[6], kstart_in[6], kend_in[6];
         istart_in[0] = 0;             iend_in[0] = exDir[0];        
@@ -306,7 +296,7 @@ void Gradient_vec_dir(const SPARC_OBJ *pSPARC, const int DMnd, const int *DMVert
                 0, DMnx, 0, DMny, 0, DMnz, exDir[0], exDir[1], exDir[2], D1_stencil_coeffs_dim, w1_diag);    
     }
     
-    free(x_ex);
+    if (nproc > 1) Halo_plan_release(halo);
     free(D1_stencil_coeffs_dim);
 }
 
@@ -330,8 +320,10 @@ void Calc_DX_variable_radius(
 {
     int i, j, k, jj, kk, r;
     
-    for (k = z_DX_spos, kk = z_X_spos; k < z_DX_epos; k++, kk++)
+    #pragma omp parallel for private(i, j, jj, kk, r) schedule(static)
+    for (k = z_DX_spos; k < z_DX_epos; k++)
     {
+        kk = z_X_spos + (k - z_DX_spos);
         int kshift_DX = k * stride_z_DX;
         int kshift_X = kk * stride_z_X;
         for (j = y_DX_spos, jj = y_X_spos; j < y_DX_epos; j++, jj++)
@@ -375,8 +367,10 @@ void Calc_DX_radius6(
 {
     int i, j, k, jj, kk, r;
     
-    for (k = z_DX_spos, kk = z_X_spos; k < z_DX_epos; k++, kk++)
+    #pragma omp parallel for private(i, j, jj, kk, r) schedule(static)
+    for (k = z_DX_spos; k < z_DX_epos; k++)
     {
+        kk = z_X_spos + (k - z_DX_spos);
         int kshift_DX = k * stride_z_DX;
         int kshift_X = kk * stride_z_X;
         for (j = y_DX_spos, jj = y_X_spos; j < y_DX_epos; j++, jj++)
@@ -0,0 +1,237 @@
+/**
+ * @file    haloExchange.c
+ * @brief   This file contains the persistent halo-exchange plans of the stencil
+ *          operators.
+ *
+ *          A plan holds the counts and displacements of the neighbor alltoallv
+ *          and the send and receive buffers for one set of halo sizes and one
+ *          number of columns. With MPI-4 the exchange is a persistent neighbor
+ *          collective, otherwise MPI_Ineighbor_alltoallv is called on the
+ *          buffers of the plan. A plan also keeps the extended-domain work
+ *          array of the operator using it. The plans are cached as an attribute
+ *          of the communicator, so they are freed together with it and a plan
+ *          is never used on a communicator other than the one it was built on.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <mpi.h>
+
+#include "haloExchange.h"
+#include "isddft.h"
+
+#define HALO_PLAN_MAX 8   // maximum number of plans cached on one communicator
+
+typedef struct _HALO_CACHE {
+    HALO_PLAN_OBJ *plans;
+    unsigned long clock;
+    void *x_ex;         // extended-domain work array for the calls without a plan (one process)
+    size_t x_ex_len;
+} HALO_CACHE;
+
+static int halo_keyval = MPI_KEYVAL_INVALID;
+
+
+
+/**
+ * @brief   Free a halo-exchange plan.
+ */
+static void halo_plan_free(HALO_PLAN_OBJ *plan)
+{
+    if (plan->is_persistent) MPI_Request_free(&plan->request);
+    free(plan->sendbuf);
+    free(plan->recvbuf);
+    free(plan->x_ex);
+    free(plan);
+}
+
+
+
+/**
+ * @brief   Free the plans of a communicator when it is freed.
+ */
+static int halo_cache_delete(MPI_Comm comm, int keyval, void *attr_val, void *extra_state)
+{
+    HALO_CACHE *cache = (HALO_CACHE *) attr_val;
+    HALO_PLAN_OBJ *plan = cache->plans;
+    while (plan != NULL) {
+        HALO_PLAN_OBJ *next = plan->next;
+        halo_plan_free(plan);
+        plan = next;
+    }
+    free(cache->x_ex);
+    free(cache);
+    return MPI_SUCCESS;
+}
+
+
+
+/**
+ * @brief   Create a halo-exchange plan.
+ */
+static HALO_PLAN_OBJ *halo_plan_create(MPI_Comm comm, MPI_Datatype type, int nnbr, const int *nbr_size, int ncol)
+{
+    HALO_PLAN_OBJ *plan = (HALO_PLAN_OBJ *) calloc(1, sizeof(HALO_PLAN_OBJ));
+    assert(plan != NULL);
+    plan->comm = comm;
+    plan->type = type;
+    plan->nnbr = nnbr;
+    plan->ncol = ncol;
+    plan->nd = 0;
+    for (int i = 0; i < nnbr; i++) {
+        plan->nbr_size[i] = nbr_size[i];
+        plan->counts[i] = ncol * nbr_size[i];
+        plan->displs[i] = plan->nd;
+        plan->nd += plan->counts[i];
+    }
+
+    int type_size;
+    MPI_Type_size(type, &type_size);
+    // the receive buffer is zero, the halos of missing neighbors (non-periodic BC) are never written
+    plan->sendbuf = malloc((size_t) plan->nd * type_size + 1);
+    plan->recvbuf = calloc((size_t) plan->nd * type_size + 1, 1);
+    assert(plan->sendbuf != NULL && plan->recvbuf != NULL);
+
+    plan->request = MPI_REQUEST_NULL;
+#if MPI_VERSION >= 4
+    MPI_Neighbor_alltoallv_init(plan->sendbuf, plan->counts, plan->displs, type,
+                                plan->recvbuf, plan->counts, plan->displs, type,
+                                comm, MPI_INFO_NULL, &plan->request);
+    plan->is_persistent = 1;
+#else
+    plan->is_persistent = 0;
+#endif
+    return plan;
+}
+
+
+
+/**
+ * @brief   Get the plan cache of comm, creating it the first time.
+ */
+static HALO_CACHE *halo_cache_get(MPI_Comm comm)
+{
+    if (halo_keyval == MPI_KEYVAL_INVALID) {
+        MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, halo_cache_delete, &halo_keyval, NULL);
+    }
+
+    HALO_CACHE *cache;
+    int flag;
+    MPI_Comm_get_attr(comm, halo_keyval, &cache, &flag);
+    if (!flag) {
+        cache = (HALO_CACHE *) calloc(1, sizeof(HALO_CACHE));
+        assert(cache != NULL);
+        MPI_Comm_set_attr(comm, halo_keyval, cache);
+    }
+    return cache;
+}
+
+
+
+/**
+ * @brief   Grow a work array to at least len bytes, the contents are not kept.
+ */
+static void *halo_buffer_grow(void **buf, size_t *buf_len, size_t len)
+{
+    if (len > *buf_len) {
+        free(*buf);
+        *buf = malloc(len);
+        assert(*buf != NULL);
+        *buf_len = len;
+    }
+    return *buf;
+}
+
+
+
+/**
+ * @brief   Get the halo-exchange plan of comm for the given halo sizes and
+ *          number of columns, creating it the first time it is asked for.
+ */
+HALO_PLAN_OBJ *Halo_plan_get(MPI_Comm comm, MPI_Datatype type, int nnbr, const int *nbr_size, int ncol)
+{
+    HALO_CACHE *cache = halo_cache_get(comm);
+    cache->clock++;
+
+    HALO_PLAN_OBJ *plan, *lru = NULL;
+    int nplan = 0;
+    for (plan = cache->plans; plan != NULL; plan = plan->next) {
+        nplan++;
+        if (plan->in_use) continue;
+        if (plan->type == type && plan->nnbr == nnbr && plan->ncol == ncol &&
+            memcmp(plan->nbr_size, nbr_size, nnbr * sizeof(int)) == 0) {
+            plan->in_use = 1;
+            plan->last_use = cache->clock;
+            return plan;
+        }
+        if (lru == NULL || plan->last_use < lru->last_use) lru = plan;
+    }
+
+    // evict the least recently used plan if the cache is full
+    if (nplan >= HALO_PLAN_MAX && lru != NULL) {
+        HALO_PLAN_OBJ **p = &cache->plans;
+        while (*p != lru) p = &(*p)->next;
+        *p = lru->next;
+        halo_plan_free(lru);
+    }
+
+    plan = halo_plan_create(comm, type, nnbr, nbr_size, ncol);
+    plan->next = cache->plans;
+    cache->plans = plan;
+    plan->in_use = 1;
+    plan->last_use = cache->clock;
+    return plan;
+}
+
+
+
+/**
+ * @brief   Start the halo exchange of a plan (non-blocking).
+ */
+void Halo_plan_start(HALO_PLAN_OBJ *plan)
+{
+    if (plan->is_persistent) {
+        MPI_Start(&plan->request);
+    } else {
+        MPI_Ineighbor_alltoallv(plan->sendbuf, plan->counts, plan->displs, plan->type,
+                                plan->recvbuf, plan->counts, plan->displs, plan->type,
+                                plan->comm, &plan->request);
+    }
+}
+
+
+
+/**
+ * @brief   Wait for the halo exchange of a plan to complete.
+ */
+void Halo_plan_wait(HALO_PLAN_OBJ *plan)
+{
+    MPI_Wait(&plan->request, MPI_STATUS_IGNORE);
+}
+
+
+
+/**
+ * @brief   Get the extended-domain work array of a stencil operator.
+ */
+void *Halo_ex_buffer(MPI_Comm comm, HALO_PLAN_OBJ *plan, size_t len)
+{
+    if (plan != NULL)
+        return halo_buffer_grow(&plan->x_ex, &plan->x_ex_len, len);
+    HALO_CACHE *cache = halo_cache_get(comm);
+    return halo_buffer_grow(&cache->x_ex, &cache->x_ex_len, len);
+}
+
+
+
+/**
+ * @brief   Release a plan after its receive buffer has been read.
+ */
+void Halo_plan_release(HALO_PLAN_OBJ *plan)
+{
+    plan->in_use = 0;
+}
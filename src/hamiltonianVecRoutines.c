@@ -37,9 +37,8 @@
 /**
  * @brief   Calculate (Hamiltonian + c * I) times a bunch of vectors in a matrix-free way.
  *          
- *          This function simply calls the Hamiltonian_vec_mult (or the sequential version) 
- *          multiple times. For some reason it is more efficient than calling it ones and do  
- *          the multiplication together. TODO: think of a more efficient way!
+ *          The local part is applied to all the vectors at once, so that the halos of
+ *          all the vectors are exchanged in a single message.
  */
 void Hamiltonian_vectors_mult(
     const SPARC_OBJ *pSPARC, int DMnd, int *DMVertices, double *Veff_loc,
@@ -47,7 +46,6 @@ void Hamiltonian_vectors_mult(
     int ncol, double c, double *x, const int ldi, double *Hx, const int ldo, int spin, MPI_Comm comm
 )
 {
-    unsigned i;
     int nproc;
     MPI_Comm_size(comm, &nproc);
     
@@ -57,16 +55,19 @@ void Hamiltonian_vectors_mult(
         MPI_Cart_get(comm, 3, dims, periods, my_coords);
     else 
         dims[0] = dims[1] = dims[2] = 1;
+
+    // start the nonlocal projectors, the reduction of the inner products 
+    // is overlapped with the local part
+    MPI_Request req_nl;
+    double *alpha = (double *) Vnl_inner_product_workspace(pSPARC, Atom_Influence_nloc, nlocProj, ncol, sizeof(double), 1);
+    Vnl_vec_mult_begin(pSPARC, DMnd, Atom_Influence_nloc, nlocProj, ncol, x, ldi, alpha, &req_nl, comm);
         
     // first find (-0.5 * Lap + Veff + c) * x
     if (pSPARC->cell_typ == 0) { // orthogonal cell
-        for (i = 0; i < ncol; i++) {
-            Lap_plus_diag_vec_mult_orth(
-                pSPARC, DMnd, DMVertices, 1, -0.5, 1.0, c, Veff_loc,
-                x+i*(unsigned)ldi, ldi, Hx+i*(unsigned)ldo, ldo, comm, dims
-            );
-        }
-        // Lap_plus_diag_vec_mult_orth(.., ncol,..) slower than the for loop above
+        Lap_plus_diag_vec_mult_orth(
+            pSPARC, DMnd, DMVertices, ncol, -0.5, 1.0, c, Veff_loc,
+            x, ldi, Hx, ldo, comm, dims
+        );
     } else {  // non-orthogonal cell
         MPI_Comm comm2;
         if (comm == pSPARC->kptcomm_topo)
@@ -74,12 +75,10 @@ void Hamiltonian_vectors_mult(
         else    
             comm2 = pSPARC->comm_dist_graph_psi;
   
-        for (i = 0; i < ncol; i++) {
-            Lap_plus_diag_vec_mult_nonorth(
-                pSPARC, DMnd, DMVertices, 1, -0.5, 1.0, c, Veff_loc,
-                x+i*(unsigned)ldi, ldi, Hx+i*(unsigned)ldo, ldo, comm, comm2, dims
-            );
-        }
+        Lap_plus_diag_vec_mult_nonorth(
+            pSPARC, DMnd, DMVertices, ncol, -0.5, 1.0, c, Veff_loc,
+            x, ldi, Hx, ldo, comm, comm2, dims
+        );
     }
 
     // adding Exact Exchange potential  
@@ -96,7 +95,7 @@ void Hamiltonian_vectors_mult(
     #ifdef USE_EVA_MODULE
     t1 = MPI_Wtime();
     #endif
-    Vnl_vec_mult(pSPARC, DMnd, Atom_Influence_nloc, nlocProj, ncol, x, ldi, Hx, ldo, comm);
+    Vnl_vec_mult_end(pSPARC, DMnd, Atom_Influence_nloc, nlocProj, ncol, alpha, &req_nl, Hx, ldo);
     #ifdef USE_EVA_MODULE
     t2 = MPI_Wtime();
     EVA_buff_timer_add(0.0, 0.0, 0.0, 0.0, 0.0, t2 - t1);
@@ -131,6 +130,18 @@ void Hamiltonian_vectors_mult_kpt(
         dims[0] = dims[1] = dims[2] = 1;
     int spinor;
 
+    // start the nonlocal projectors, the reduction of the inner products 
+    // is overlapped with the local part
+    MPI_Request req_nl[2];
+    double _Complex *alpha[2];
+    alpha[0] = (double _Complex *) Vnl_inner_product_workspace(pSPARC, Atom_Influence_nloc, nlocProj, ncol, 
+        sizeof(double _Complex), pSPARC->Nspinor_eig);
+    for (spinor = 0; spinor < pSPARC->Nspinor_eig; spinor++) {
+        alpha[spinor] = alpha[0] + (size_t) spinor * pSPARC->IP_displ[pSPARC->n_atom] * ncol;
+        Vnl_vec_mult_kpt_begin(pSPARC, DMnd, Atom_Influence_nloc, nlocProj, ncol, 
+                               x+spinor*DMnd, ldi, kpt, alpha[spinor], &req_nl[spinor], comm);
+    }
+
     // first find (-0.5 * Lap + Veff + c) * x
     if (pSPARC->cell_typ == 0) { // orthogonal cell
         for (i = 0; i < ncol; i++) {
@@ -174,8 +185,8 @@ void Hamiltonian_vectors_mult_kpt(
     // apply nonlocal projectors
     for (spinor = 0; spinor < pSPARC->Nspinor_eig; spinor++) {
         // Apply scalar-relativistic part
-        Vnl_vec_mult_kpt(pSPARC, DMnd, Atom_Influence_nloc, nlocProj, ncol, 
-                            x+spinor*DMnd, ldi, Hx+spinor*DMnd, ldo, kpt, comm);
+        Vnl_vec_mult_kpt_end(pSPARC, DMnd, Atom_Influence_nloc, nlocProj, ncol, kpt, 
+                             alpha[spinor], &req_nl[spinor], Hx+spinor*DMnd, ldo);
         
         if (pSPARC->SOC_Flag == 0) continue;
         // Apply spin-orbit onto the same spinor
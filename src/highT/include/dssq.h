@@ -92,6 +92,7 @@ typedef struct _SQ_OBJ
     double **gwt;
     double *Veff_PR;                // Veff operator within PR (process+Rcut) domain
     double *x_ex;
+    double *x_ex_block;             // extended block of vectors for SQ_BLOCK_SIZE > 1
     int forceFlag;
 } SQ_OBJ;
 
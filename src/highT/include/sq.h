@@ -42,6 +42,16 @@ void TridiagEigenSolve_gauss(SPARC_OBJ *pSPARC, double *diag, double *subdiag, i
  */
 void LanczosAlgorithm_gauss(SPARC_OBJ *pSPARC, double *vkm1, double *lambda_min, double *lambda_max, int nd);
 
+/**
+ * @brief   Lanczos algorithm for Gauss method on a block of FD nodes
+ * 
+ * @param nd_start      Index of the first FD node of the block in current process domain
+ * @param ncol          Number of FD nodes in the block
+ * @param lambda_min    minimal eigenvales of the nodes (length ncol)
+ * @param lambda_max    maximal eigenvales of the nodes (length ncol)
+ */
+void LanczosAlgorithm_gauss_block(SPARC_OBJ *pSPARC, int nd_start, int ncol, double *lambda_min, double *lambda_max);
+
 
 /**
  * @brief   Compute nodal Hamiltonian times a vector
@@ -52,6 +62,16 @@ void LanczosAlgorithm_gauss(SPARC_OBJ *pSPARC, double *vkm1, double *lambda_min,
  */
 void HsubTimesVec(SPARC_OBJ *pSPARC, const double *x, const int nd, double *Hx);
 
+/**
+ * @brief   Compute nodal Hamiltonians times a block of vectors
+ * 
+ * @param x         Interleaved block of vectors, x[i*ncol+n] belongs to node nd_start+n
+ * @param nd_start  The index of the first node of the block
+ * @param ncol      Number of nodes in the block
+ * @param Hx        The block stores the result of Hx
+ */
+void HsubTimesVec_block(SPARC_OBJ *pSPARC, const double *x, const int nd_start, const int ncol, double *Hx);
+
 /**
  * @brief Calculate (a * Laplacian + diag(Veff)) times x 
  * 
@@ -65,6 +85,36 @@ void HsubTimesVec(SPARC_OBJ *pSPARC, const double *x, const int nd, double *Hx);
 void Lap_vec_mult_orth_SQ(
     SPARC_OBJ *pSPARC, const double *x, const double a, const double *Veff, int nd, double *Hx);
 
+/**
+ * @brief Calculate (a * Laplacian + diag(Veff)) times a block of vectors 
+ * 
+ * @param pSPARC    SPARC object pointer
+ * @param x         interleaved block of vectors, x[i*ncol+n] belongs to node nd_start+n
+ * @param a         scaling of Laplacian
+ * @param Veff      effective potential in PR domain
+ * @param nd_start  index of the first FD node of the block
+ * @param ncol      number of FD nodes in the block
+ * @param Hx        (a * Laplacian + diag(Veff))x, same layout as x
+ */
+void Lap_vec_mult_orth_SQ_block(
+    SPARC_OBJ *pSPARC, const double *x, const double a, const double *Veff, 
+    int nd_start, int ncol, double *Hx);
+
+/**
+ * @brief   Kernel for calculating y = (a * Lap + b * diag(v0)) * x for a block of 
+ *          interleaved vectors, x0[idx*ncol+n], each with its own shift in v0.
+ */
+void stencil_3axis_block_sq(
+    const double *x0,    const int radius,    const int ncol,
+    const int stride_y,  const int stride_y_ex, 
+    const int stride_z,  const int stride_z_ex,
+    const int nx, const int ny, const int nz,
+    const double *stencil_coefs, 
+    const double coef_0, const double b, const double *v0, 
+    const int stride_y_v, const int stride_z_v, const int *v_shift, 
+    double *y
+);
+
 
 /**
  * @brief   Kernel for calculating y = (a * Lap + b * diag(v0)) * x.
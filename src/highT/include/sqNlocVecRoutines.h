@@ -28,6 +28,15 @@ void GetNonlocalProjectorsForNode(SPARC_OBJ *pSPARC, NLOC_PROJ_OBJ *nlocProj, NL
 void Vnl_vec_mult_SQ(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
                   NLOC_PROJ_OBJ *nlocProj, const double *x, double *Hx);
 
+/**
+ * @brief   Calculate Vnl times a block of vectors in a matrix-free way.
+ * 
+ *          The block is interleaved, x[i*ncol+n], and vector n is multiplied 
+ *          by the nonlocal projectors of the n-th FD node of the block.
+ */
+void Vnl_vec_mult_SQ_block(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ **Atom_Influence_nloc, 
+                  NLOC_PROJ_OBJ **nlocProj, int ncol, const double *x, double *Hx);
+
 /**
  * @brief   Calculate Vnl times vectors in a matrix-free way for force calculation.
  */
@@ -100,7 +100,13 @@ void GaussQuadrature(SPARC_OBJ *pSPARC, int SCFCount) {
 	}
 	else
 	#endif // SPARCX_ACCEL
-	{
+	if (pSPARC->SQ_block_size > 1) {
+        // run Lanczos for a block of FD nodes at a time
+        for (nd = 0; nd < DMnd; nd += pSPARC->SQ_block_size) {
+            int ncol = min(pSPARC->SQ_block_size, DMnd - nd);
+            LanczosAlgorithm_gauss_block(pSPARC, nd, ncol, pSQ->mineig + nd, pSQ->maxeig + nd);
+        }
+	} else {
     	t0 = (double *) malloc(sizeof(double) * pSQ->Nd_loc);
     	int center = nloc[0] + nloc[1]*Nx_loc + nloc[2]*Nx_loc*Ny_loc;    
     	for (nd = 0; nd < DMnd; nd ++) {
@@ -267,6 +273,143 @@ void LanczosAlgorithm_gauss(SPARC_OBJ *pSPARC, double *vkm1, double *lambda_min,
     free(bb);
 }
 
+
+/**
+ * @brief   Dot products of the columns of two interleaved blocks of vectors
+ */
+static void BlockDotProduct(const double *X, const double *Y, const int len, const int ncol, double *dot)
+{
+    int i, n;
+    for (n = 0; n < ncol; n++) dot[n] = 0.0;
+    for (i = 0; i < len; i++) {
+        const double *x = X + i * ncol;
+        const double *y = Y + i * ncol;
+        #pragma omp simd
+        for (n = 0; n < ncol; n++) {
+            dot[n] += x[n] * y[n];
+        }
+    }
+}
+
+
+/**
+ * @brief   Save column n of the interleaved block V as the m-th Lanczos vector of each node
+ */
+static void SaveLanczosVectorsBlock(SPARC_OBJ *pSPARC, const double *V, const int nd_start, const int ncol, const int m)
+{
+    SQ_OBJ* pSQ  = pSPARC->pSQ;
+    int i, n;
+    int Nd_loc = pSQ->Nd_loc;
+    for (n = 0; n < ncol; n++) {
+        double *lanczos_vec = pSQ->lanczos_vec_all[nd_start + n] + m * Nd_loc;
+        for (i = 0; i < Nd_loc; i++) {
+            lanczos_vec[i] = V[i * ncol + n];
+        }
+    }
+}
+
+
+/**
+ * @brief   Lanczos algorithm for Gauss method on a block of FD nodes
+ * 
+ *          The Lanczos iterations of ncol consecutive FD nodes are carried out 
+ *          together, each node with its own tridiagonal recurrence. Vectors are 
+ *          stored interleaved, i.e., V[i*ncol+n] is the i-th entry of the vector 
+ *          of node nd_start+n, so that the stencil and the vector updates work 
+ *          on ncol contiguous values.
+ * 
+ * @param nd_start      Index of the first FD node of the block in current process domain
+ * @param ncol          Number of FD nodes in the block
+ * @param lambda_min    minimal eigenvales of the nodes (length ncol)
+ * @param lambda_max    maximal eigenvales of the nodes (length ncol)
+ */
+void LanczosAlgorithm_gauss_block(SPARC_OBJ *pSPARC, int nd_start, int ncol, double *lambda_min, double *lambda_max) {
+    SQ_OBJ* pSQ  = pSPARC->pSQ;
+    int i, n, count;
+    int npl = pSPARC->SQ_npl_g;
+    int Nd_loc = pSQ->Nd_loc;
+    int len = Nd_loc * ncol;
+    // Lanczos vectors are only kept for the high memory option 
+    int save_vec = (pSPARC->SQ_gauss_mem == 1);
+    double *vkm1, *vk, *vkp1, *tmp, *aa, *bb, *val;
+
+    vkm1 = (double *) calloc(len, sizeof(double));
+    vk = (double *) malloc(sizeof(double) * len);
+    vkp1 = (double *) malloc(sizeof(double) * len);
+    aa = (double *) malloc(sizeof(double) * npl * ncol);
+    bb = (double *) malloc(sizeof(double) * npl * ncol);
+    val = (double *) malloc(sizeof(double) * ncol);
+    assert(vkm1 != NULL && vk != NULL && vkp1 != NULL);
+
+    // initial guess is the identity vector of each node, already normalized
+    int center = pSQ->nloc[0] + pSQ->nloc[1]*pSQ->Nx_loc + pSQ->nloc[2]*pSQ->Nx_loc*pSQ->Ny_loc;
+    for (n = 0; n < ncol; n++) {
+        vkm1[center*ncol + n] = 1.0;
+    }
+    if (save_vec) SaveLanczosVectorsBlock(pSPARC, vkm1, nd_start, ncol, 0);
+
+    // the zero padding of the extended block depends on ncol, reset it for this block
+    memset(pSQ->x_ex_block, 0, sizeof(double) * pSQ->Nd_ex * ncol);
+
+    HsubTimesVec_block(pSPARC, vkm1, nd_start, ncol, vk);
+
+    BlockDotProduct(vkm1, vk, Nd_loc, ncol, val);
+    for (n = 0; n < ncol; n++) aa[n*npl] = val[n];
+    for (i = 0; i < Nd_loc; i++) {
+        for (n = 0; n < ncol; n++) {
+            vk[i*ncol+n] = vk[i*ncol+n] - aa[n*npl] * vkm1[i*ncol+n];
+        }
+    }
+
+    BlockDotProduct(vk, vk, Nd_loc, ncol, val);
+    for (n = 0; n < ncol; n++) bb[n*npl] = sqrt(val[n]);
+    for (i = 0; i < Nd_loc; i++) {
+        for (n = 0; n < ncol; n++) {
+            vk[i*ncol+n] = vk[i*ncol+n] / bb[n*npl];
+        }
+    }
+    if (save_vec) SaveLanczosVectorsBlock(pSPARC, vk, nd_start, ncol, 1);
+
+    count = 0;
+    while (count < npl - 1) {
+        HsubTimesVec_block(pSPARC, vk, nd_start, ncol, vkp1); // vkp1=Hsub*vk
+
+        BlockDotProduct(vk, vkp1, Nd_loc, ncol, val); // val=vk'*vkp1
+        for (n = 0; n < ncol; n++) aa[n*npl + count + 1] = val[n];
+        for (i = 0; i < Nd_loc; i++) {
+            for (n = 0; n < ncol; n++) {
+                vkp1[i*ncol+n] = vkp1[i*ncol+n] - aa[n*npl + count + 1] * vk[i*ncol+n] 
+                               - bb[n*npl + count] * vkm1[i*ncol+n];
+            }
+        }
+
+        BlockDotProduct(vkp1, vkp1, Nd_loc, ncol, val);
+        for (n = 0; n < ncol; n++) bb[n*npl + count + 1] = val[n] = sqrt(val[n]);
+
+        // vkm1 = vk, vk = vkp1 / norm(vkp1)
+        tmp = vkm1; vkm1 = vk; vk = vkp1; vkp1 = tmp;
+        for (i = 0; i < Nd_loc; i++) {
+            for (n = 0; n < ncol; n++) {
+                vk[i*ncol+n] = vk[i*ncol+n] / val[n];
+            }
+        }
+        if (save_vec && count != npl - 2) 
+            SaveLanczosVectorsBlock(pSPARC, vk, nd_start, ncol, count + 2);
+        count = count + 1;
+    }
+
+    for (n = 0; n < ncol; n++) {
+        TridiagEigenSolve_gauss(pSPARC, aa + n*npl, bb + n*npl, nd_start + n, lambda_min + n, lambda_max + n);
+    }
+
+    free(vkm1);
+    free(vk);
+    free(vkp1);
+    free(aa);
+    free(bb);
+    free(val);
+}
+
 /**
  * @brief   Tridiagonal eigenvalue solver for Gauss method
  * 
@@ -408,6 +551,26 @@ void HsubTimesVec(SPARC_OBJ *pSPARC, const double *x, const int nd, double *Hx)
 }
 
 
+/**
+ * @brief Calculate nodal Hamiltonians times a block of vectors
+ * 
+ * @param pSPARC    SPARC object pointer
+ * @param x         interleaved block of vectors, x[i*ncol+n] belongs to node nd_start+n
+ * @param nd_start  index of the first FD node of the block
+ * @param ncol      number of FD nodes in the block
+ * @param Hx        nodal Hamiltonians times vectors, same layout as x
+ */
+void HsubTimesVec_block(SPARC_OBJ *pSPARC, const double *x, const int nd_start, const int ncol, double *Hx)
+{
+    SQ_OBJ *pSQ = pSPARC->pSQ;
+    // Apply Laplacian 
+    Lap_vec_mult_orth_SQ_block(pSPARC, x, -0.5, pSQ->Veff_PR, nd_start, ncol, Hx);
+    // Apply nonlocal projector
+    Vnl_vec_mult_SQ_block(pSPARC, pSQ->Nd_loc, pSPARC->Atom_Influence_nloc_SQ + nd_start, 
+                  pSPARC->nlocProj_SQ + nd_start, ncol, x, Hx);
+}
+
+
 /**
  * @brief Calculate (a * Laplacian + diag(Veff)) times x 
  * 
@@ -478,6 +641,164 @@ void Lap_vec_mult_orth_SQ(
 }
 
 
+/**
+ * @brief Calculate (a * Laplacian + diag(Veff)) times a block of vectors 
+ * 
+ * @param pSPARC    SPARC object pointer
+ * @param x         interleaved block of vectors, x[i*ncol+n] belongs to node nd_start+n
+ * @param a         scaling of Laplacian
+ * @param Veff      effective potential in PR domain
+ * @param nd_start  index of the first FD node of the block
+ * @param ncol      number of FD nodes in the block
+ * @param Hx        (a * Laplacian + diag(Veff))x, same layout as x
+ */
+void Lap_vec_mult_orth_SQ_block(
+    SPARC_OBJ *pSPARC, const double *x, const double a, const double *Veff, 
+    int nd_start, int ncol, double *Hx)
+{
+    SQ_OBJ *pSQ = pSPARC->pSQ;
+    int FDn = pSPARC->order / 2;
+
+    int Nx_loc = pSQ->Nx_loc;
+    int Ny_loc = pSQ->Ny_loc;
+    int Nz_loc = pSQ->Nz_loc;
+    int NxNy_loc = Nx_loc * Ny_loc;
+    
+    int Nx_ex = Nx_loc + pSPARC->order;
+    int Ny_ex = Ny_loc + pSPARC->order;
+    int NxNy_ex = Nx_ex * Ny_ex;
+
+    int DMnx = pSQ->DMnx_SQ;
+    int DMny = pSQ->DMny_SQ;
+    int DMnxny = DMnx * DMny;
+
+    int stride_y_v = pSQ->DMnx_PR;
+    int stride_z_v = pSQ->DMnx_PR * pSQ->DMny_PR;
+
+    // integrate a into coefficients weights
+    double *Lap_weights = (double *)malloc(3*(FDn+1)*sizeof(double)); 
+    double *Lap_stencil = Lap_weights;
+    int p, n, j, k;
+    for (p = 0; p < FDn + 1; p++)
+    {
+        (*Lap_stencil++) = pSPARC->D2_stencil_coeffs_x[p] * a;
+        (*Lap_stencil++) = pSPARC->D2_stencil_coeffs_y[p] * a;
+        (*Lap_stencil++) = pSPARC->D2_stencil_coeffs_z[p] * a;
+    }
+    
+    double w2_diag;
+    w2_diag  = Lap_weights[0];
+    w2_diag += Lap_weights[1];
+    w2_diag += Lap_weights[2];    
+
+    // shift of the Rcut domain of each node within PR domain
+    int *v_shift = (int *)malloc(ncol * sizeof(int));
+    for (n = 0; n < ncol; n++) {
+        int nd = nd_start + n;
+        int kk = nd / DMnxny;
+        int jj = (nd - kk * DMnxny) / DMnx;
+        int ii = nd % DMnx;
+        v_shift[n] = ii + jj * stride_y_v + kk * stride_z_v;
+    }
+
+    // extend into x_ex_block with zero padding outside (dirichlet boundary condition)
+    double *x_ex = pSQ->x_ex_block;
+    for (k = 0; k < Nz_loc; k++) {
+        for (j = 0; j < Ny_loc; j++) {
+            memcpy(x_ex + ((k+FDn)*NxNy_ex + (j+FDn)*Nx_ex + FDn) * ncol, 
+                   x + (k*NxNy_loc + j*Nx_loc) * ncol, sizeof(double) * Nx_loc * ncol);
+        }
+    }
+
+    // apply a*Lap*x + Veff*x
+    stencil_3axis_block_sq(
+        x_ex, FDn, ncol, Nx_loc, Nx_ex, NxNy_loc, NxNy_ex, Nx_loc, Ny_loc, Nz_loc,
+        Lap_weights, w2_diag, 1.0, Veff, stride_y_v, stride_z_v, v_shift, Hx);
+
+    free(v_shift);
+    free(Lap_weights);
+}
+
+
+
+/**
+ * @brief   Kernel for calculating y = (a * Lap + b * diag(v0)) * x for a block of 
+ *          interleaved vectors, x0[idx*ncol+n], each with its own shift in v0.
+ *
+ * @param x0               : Input block with extended boundary 
+ * @param radius           : Radius of the stencil (radius * 2 = stencil order)
+ * @param ncol             : Number of vectors in the block
+ * @param stride_y         : Distance between y(i, j, k) and y(i, j+1, k) in grid points
+ * @param stride_y_ex      : Distance between x0(i, j, k) and x0(i, j+1, k) in grid points
+ * @param stride_z         : Distance between y(i, j, k) and y(i, j, k+1) in grid points
+ * @param stride_z_ex      : Distance between x0(i, j, k) and x0(i, j, k+1) in grid points
+ * @param nx, ny, nz       : Number of grid points of y in each direction
+ * @param stencil_coefs    : Stencil coefficients for the stencil points, length radius+1,
+ *                           ordered as [x_0 y_0 z_0 x_1 y_1 y_2 ... x_radius y_radius z_radius]
+ * @param coef_0           : Stencil coefficient for the center element 
+ * @param b                : Scaling factor of v0
+ * @param v0               : Values of the diagonal matrix
+ * @param stride_y_v       : Distance between v0(i, j, k) and v0(i, j+1, k)
+ * @param stride_z_v       : Distance between v0(i, j, k) and v0(i, j+1, k)
+ * @param v_shift          : Start index in v0 of each vector
+ * @param y (OUT)          : Output block with original boundary
+ */
+void stencil_3axis_block_sq(
+    const double *x0,    const int radius,    const int ncol,
+    const int stride_y,  const int stride_y_ex, 
+    const int stride_z,  const int stride_z_ex,
+    const int nx, const int ny, const int nz,
+    const double *stencil_coefs, 
+    const double coef_0, const double b, const double *v0, 
+    const int stride_y_v, const int stride_z_v, const int *v_shift, 
+    double *y
+)
+{
+    int i, j, k, n, r;
+    for (k = 0; k < nz; k++)
+    {
+        for (j = 0; j < ny; j++)
+        {
+            int offset = k * stride_z + j * stride_y;
+            int offset_ex = (k+radius) * stride_z_ex + (j+radius) * stride_y_ex + radius;
+            int offset_v = k * stride_z_v + j * stride_y_v;
+            for (i = 0; i < nx; i++)
+            {
+                const double *xc = x0 + (offset_ex + i) * ncol;
+                const double *vc = v0 + offset_v + i;
+                double *yc = y + (offset + i) * ncol;
+
+                #pragma omp simd
+                for (n = 0; n < ncol; n++) 
+                    yc[n] = coef_0 * xc[n];
+
+                for (r = 1; r <= radius; r++)
+                {
+                    int sx = r * ncol;
+                    int sy = r * stride_y_ex * ncol;
+                    int sz = r * stride_z_ex * ncol;
+                    double cx = stencil_coefs[3*r];
+                    double cy = stencil_coefs[3*r+1];
+                    double cz = stencil_coefs[3*r+2];
+                    #pragma omp simd
+                    for (n = 0; n < ncol; n++) 
+                    {
+                        double res_x = (xc[n - sx] + xc[n + sx]) * cx;
+                        double res_y = (xc[n - sy] + xc[n + sy]) * cy;
+                        double res_z = (xc[n - sz] + xc[n + sz]) * cz;
+                        yc[n] += res_x + res_y + res_z;
+                    }
+                }
+
+                #pragma omp simd
+                for (n = 0; n < ncol; n++) 
+                    yc[n] = yc[n] + b * (vc[v_shift[n]] * xc[n]);
+            }
+        }
+    }
+}
+
+
 
 /**
  * @brief   Kernel for calculating y = (a * Lap + b * diag(v0)) * x.
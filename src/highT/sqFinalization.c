@@ -50,6 +50,7 @@ void Free_SQ(SPARC_OBJ *pSPARC) {
     free(pSQ->Veff_PR);
     free(pSQ->Veff_loc_SQ);
     free(pSQ->x_ex);
+    free(pSQ->x_ex_block);
 
     if (pSPARC->SQ_gauss_mem == 1) {
         for (i = 0; i < pSQ->DMnd_SQ; i++) {
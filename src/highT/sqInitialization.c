@@ -63,6 +63,11 @@ void init_SQ(SPARC_OBJ *pSPARC) {
     pSQ->Veff_loc_SQ = (double *) calloc(sizeof(double), pSQ->DMnd_SQ);
     pSQ->x_ex = (double *) malloc(sizeof(double)*pSQ->Nd_ex);
     memset(pSQ->x_ex, 0, sizeof(double)*pSQ->Nd_ex);
+    pSQ->x_ex_block = NULL;
+    if (pSPARC->SQ_block_size > 1) {
+        pSQ->x_ex_block = (double *) calloc(sizeof(double), (size_t) pSQ->Nd_ex * pSPARC->SQ_block_size);
+        assert(pSQ->x_ex_block != NULL);
+    }
     
     // Get coordinates for each process in kptcomm_topo
     MPI_Cart_coords(pSQ->dmcomm_SQ, rank, 3, pSQ->coords);
@@ -250,6 +250,80 @@ void Vnl_vec_mult_SQ(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ
 
 
 
+/**
+ * @brief   Calculate Vnl times a block of vectors in a matrix-free way.
+ * 
+ *          The block is interleaved, x[i*ncol+n], and vector n is multiplied 
+ *          by the nonlocal projectors of the n-th FD node of the block.
+ */
+void Vnl_vec_mult_SQ_block(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ **Atom_Influence_nloc, 
+                  NLOC_PROJ_OBJ **nlocProj, int ncol, const double *x, double *Hx)
+{
+    int i, n, np, count;
+    int ityp, iat, l, m, ldispl, lmax, ndc, nproj, lloc, *grid_pos;
+    double *alpha, *x_rc;
+
+    // one work array for all atoms of all nodes of the block
+    int max_ndc = 0, max_nproj = 0;
+    for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+        max_nproj = max(max_nproj, nlocProj[0][ityp].nproj);
+        for (n = 0; n < ncol; n++) {
+            for (iat = 0; iat < Atom_Influence_nloc[n][ityp].n_atom; iat++)
+                max_ndc = max(max_ndc, Atom_Influence_nloc[n][ityp].ndc[iat]);
+        }
+    }
+    if (max_nproj == 0 || max_ndc == 0) return;
+    alpha = (double *)malloc((max_nproj + max_ndc) * sizeof(double));
+    assert(alpha != NULL);
+    x_rc = alpha + max_nproj;
+
+    for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+        nproj = nlocProj[0][ityp].nproj;
+        if (!nproj) continue; // this is typical for hydrogen
+        lloc = pSPARC->localPsd[ityp];
+        lmax = pSPARC->psd[ityp].lmax;
+        
+        for (n = 0; n < ncol; n++) {
+            for (iat = 0; iat < Atom_Influence_nloc[n][ityp].n_atom; iat++) {
+                ndc = Atom_Influence_nloc[n][ityp].ndc[iat]; 
+                grid_pos = Atom_Influence_nloc[n][ityp].grid_pos[iat];
+                for (i = 0; i < ndc; i++) {
+                    x_rc[i] = x[grid_pos[i]*ncol + n];
+                }
+                
+                // Find inner product
+                cblas_dgemv (CblasColMajor, CblasTrans, ndc, nproj, pSPARC->dV, 
+                        nlocProj[n][ityp].Chi[iat], ndc, x_rc, 1, 0.0, alpha, 1);
+                
+                // Apply Gamma
+                count = 0;
+                ldispl = 0;
+                for (l = 0; l <= lmax; l++) {
+                    // skip the local l
+                    if (l == lloc) {
+                        ldispl += pSPARC->psd[ityp].ppl[l];
+                        continue;
+                    }
+                    for (np = 0; np < pSPARC->psd[ityp].ppl[l]; np++) {
+                        for (m = -l; m <= l; m++) {
+                            alpha[count++] *= pSPARC->psd[ityp].Gamma[ldispl+np];
+                        }
+                    }
+                    ldispl += pSPARC->psd[ityp].ppl[l];
+                }
+                cblas_dgemv (CblasColMajor, CblasNoTrans, ndc, nproj, 1.0, 
+                        nlocProj[n][ityp].Chi[iat], ndc, alpha, 1, 0.0, x_rc, 1);
+                for (i = 0; i < ndc; i++) {
+                    Hx[grid_pos[i]*ncol + n] += x_rc[i];
+                }
+            }
+        }
+    }
+    free(alpha);
+}
+
+
+
 /**
  * @brief   Calculate Vnl times vectors in a matrix-free way for force calculation.
  */
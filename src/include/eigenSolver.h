@@ -136,6 +136,8 @@ struct DP_CheFSI_s
     double   *Mp_local;         // Local Mp result
     double   *Hp_local;         // Local Hp result
     double   *eig_vecs;         // Eigen vectors from solving generalized eigenproblem
+    double   *cs_tau;           // Householder scalars of the top eigenvectors (CS_FLAG)
+    int      cs_warm[2];        // 1 once a CS rotation has moved the top states of each spin to the last columns (CS_FLAG)
     MPI_Comm kpt_comm;          // MPI communicator that contains all active processes in pSPARC->kptcomm
 };
 typedef struct DP_CheFSI_s* DP_CheFSI_t;
@@ -184,6 +186,29 @@ void DP_Solve_Generalized_EigenProblem(SPARC_OBJ *pSPARC, int spn_i);
  */
 void DP_Subspace_Rotation(SPARC_OBJ *pSPARC, double *Psi_rot);
 
+/**
+ * @brief   Complementary subspace version of DP_Solve_Generalized_EigenProblem.
+ *
+ *          Only the top CS_NTOP eigenpairs of the projected problem are computed
+ *          (filtered subspace iteration warm started from the previous rotation,
+ *          or tridiagonal reduction, bisection and inverse iteration), together
+ *          with the lowest eigenvalue. The remaining fully occupied states get
+ *          the average of the remaining eigenvalues, taken from the trace. Rank 0
+ *          of each kpt_comm solves the problem and broadcasts the top
+ *          eigenvectors in Householder form.
+ */
+void DP_CS_Solve_EigenProblem(SPARC_OBJ *pSPARC, int spn_i);
+
+/**
+ * @brief   Complementary subspace version of DP_Subspace_Rotation.
+ *
+ *          Applies the Householder reflectors of the top eigenvectors to the
+ *          (orthonormalized) filtered block, which gives the top eigenvectors and
+ *          an orthonormal basis of the fully occupied complement without forming
+ *          the full eigenvector matrix.
+ */
+void DP_CS_Subspace_Rotation(SPARC_OBJ *pSPARC, double *Psi_rot);
+
 /**
  * @brief   Free domain parallelization data structures for calculating projected Hamiltonian, 
  *          solving generalized eigenproblem, and performing subspace rotation in CheFSI().
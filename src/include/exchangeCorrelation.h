@@ -15,6 +15,10 @@
 
 #include "isddft.h"
 
+// number of grid points processed together by the batched xc kernels, the
+// transcendental functions of a chunk are evaluated in their own loops
+#define XC_CHUNK 256
+
 /**
 * @brief  Calculate exchange correlation potential
 **/
@@ -151,6 +155,19 @@ void Drho_times_v2xc(SPARC_OBJ *pSPARC, int DMnd, int ncol, double *Drho_x, doub
  */
 void pbexsr(double rho, double grho, double omega, double *e_xc_sr, double *XCPotential_sr, double *Dxcdgrho_sr);
 
+/**
+ * @brief   Create the table of the HSE short-range enhancement factor, refined
+ *          until its error is below EXX_SR_TABLE_TOL
+ */
+void wpbe_table_create(SPARC_OBJ *pSPARC);
+
+/**
+ * @brief   Calculate PBE short ranged exchange for a batch of grid points, 
+ *          using the tabulated enhancement factor when available
+ */
+void pbexsr_vec(SPARC_OBJ *pSPARC, int DMnd, double *rho, double *grho, 
+                double *e_xc_sr, double *XCPotential_sr, double *Dxcdgrho_sr);
+
 /**
  * @brief   Calculate PBE short ranged enhancement factor
  *          Taken from Quantum Espresson
@@ -0,0 +1,64 @@
+/**
+ * @file    haloExchange.h
+ * @brief   This file contains the function declarations for the persistent
+ *          halo-exchange plans of the stencil operators.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#ifndef HALOEXCHANGE_H
+#define HALOEXCHANGE_H
+
+#include "isddft.h"
+
+
+/**
+ * @brief   Get the halo-exchange plan of comm for the given halo sizes and
+ *          number of columns, creating it the first time it is asked for.
+ *
+ *          The plan owns the send and receive buffers. The halo of column n for
+ *          neighbor i starts at displs[i] + n * nbr_size[i] in both buffers. The
+ *          caller packs sendbuf, calls Halo_plan_start and Halo_plan_wait, reads
+ *          recvbuf and gives the plan back with Halo_plan_release.
+ *
+ * @param comm      Communicator with a neighbor graph topology (Cartesian).
+ * @param type      Data type of the halo values.
+ * @param nnbr      Number of neighbors (6 or 26).
+ * @param nbr_size  Number of halo values per column for each neighbor, the same
+ *                  number is sent to and received from each neighbor.
+ * @param ncol      Number of columns.
+ */
+HALO_PLAN_OBJ *Halo_plan_get(MPI_Comm comm, MPI_Datatype type, int nnbr, const int *nbr_size, int ncol);
+
+
+/**
+ * @brief   Start the halo exchange of a plan (non-blocking).
+ */
+void Halo_plan_start(HALO_PLAN_OBJ *plan);
+
+
+/**
+ * @brief   Wait for the halo exchange of a plan to complete.
+ */
+void Halo_plan_wait(HALO_PLAN_OBJ *plan);
+
+
+/**
+ * @brief   Get the extended-domain work array of a stencil operator, of at
+ *          least len bytes.
+ *
+ *          The array belongs to plan, or to the plan cache of comm when plan is
+ *          NULL (one process, no exchange). It only grows, its contents are not
+ *          kept between calls and it is freed together with its owner, so it
+ *          must not be freed or used after the plan is released.
+ */
+void *Halo_ex_buffer(MPI_Comm comm, HALO_PLAN_OBJ *plan, size_t len);
+
+
+/**
+ * @brief   Release a plan after its receive buffer has been read, so that it
+ *          can be handed out again by Halo_plan_get.
+ */
+void Halo_plan_release(HALO_PLAN_OBJ *plan);
+
+#endif // HALOEXCHANGE_H
@@ -0,0 +1,85 @@
+/**
+ * @file    incrementalUpdate.h
+ * @brief   This file contains the function declarations for the incremental
+ *          update of the atom-centered quantities across relax/MD steps.
+ *
+ *          The pseudocharges and the nonlocal projectors of an atom only depend
+ *          on its own position. An atom whose displacement since the quantities
+ *          were last built is within TOL_INCREMENTAL_UPDATE is kept at that
+ *          position, so that its images, rc-domains and projectors are the same
+ *          as in the last step and can be reused. Only the atoms that moved
+ *          further are rebuilt.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#ifndef INCREMENTALUPDATE_H
+#define INCREMENTALUPDATE_H
+
+#include "isddft.h"
+
+
+/**
+ * @brief   Find the atoms that have to be rebuilt in this step.
+ *
+ *          Sets atom_moved and n_atom_moved, and updates atom_pos_ref to the
+ *          current position for the atoms that moved. All atoms are rebuilt in
+ *          the first step and when the cell or the mesh has changed.
+ */
+void IncrementalUpdate_begin(SPARC_OBJ *pSPARC);
+
+
+/**
+ * @brief   Free what is left of the quantities of the last step, after the
+ *          reusable parts have been taken over by the current step.
+ */
+void IncrementalUpdate_end(SPARC_OBJ *pSPARC);
+
+
+/**
+ * @brief   Keep the atom influence lists and projectors of this step for the
+ *          next step instead of freeing them.
+ *
+ * @return  1 if they are kept, 0 if the incremental update is off and the
+ *          caller has to free them.
+ */
+int IncrementalUpdate_store(SPARC_OBJ *pSPARC);
+
+
+/**
+ * @brief   Free all memory of the incremental update.
+ */
+void IncrementalUpdate_free(SPARC_OBJ *pSPARC);
+
+
+/**
+ * @brief   Find the image atom of the last step that can be reused for an
+ *          image atom of this step.
+ *
+ *          The image lists are ordered by atom index, cursor is the position to
+ *          start searching from and is advanced along the list. It must be set
+ *          to 0 before the first search of each atom type.
+ *
+ * @return  Index of the image in the list of the last step, or -1 if the atom
+ *          moved or the image is not found.
+ */
+int IncrementalUpdate_find_image(
+    const SPARC_OBJ *pSPARC, const int n_prev, const int *atom_index_prev,
+    const double *coords_prev, const int atom_index, const double *coords, int *cursor
+);
+
+
+/**
+ * @brief   Atom influence list of the last step for the nonlocal domain of comm
+ *          (dmcomm or kptcomm_topo), NULL if there is none.
+ */
+ATOM_NLOC_INFLUENCE_OBJ *IncrementalUpdate_nloc_prev(const SPARC_OBJ *pSPARC, MPI_Comm comm);
+
+
+/**
+ * @brief   Nonlocal projectors of the last step for comm (dmcomm or
+ *          kptcomm_topo), NULL if there are none.
+ */
+NLOC_PROJ_OBJ *IncrementalUpdate_proj_prev(const SPARC_OBJ *pSPARC, MPI_Comm comm);
+
+#endif // INCREMENTALUPDATE_H
@@ -91,6 +91,10 @@ typedef struct _PSD_OBJ {
     double *SplineFitUdV; // derivative of UdV from Spline
     double *SplineFitIsoAtomDen;
     double *SplineRhocD; // derivative of rho_c_table for spline
+    double *SplineTabrVloc;       // spline coefficient tables on uniform RadialGrid (NULL otherwise),
+    double *SplineTabUdV;         // each of size 4 x (size-1), see SplineTableUniform
+    double *SplineTabIsoAtomDen;
+    double *SplineTabRhoc;
     double *rc;     // component pseudopotential cutoff
     double *Gamma;  // KB SC energy for each channel
     double *rho_c_table;  // model core charge for nonlinear core correction
@@ -161,6 +165,8 @@ typedef struct _NLOC_PROJ_OBJ {
     int nproj;                  // number of projectors per atom
     double **Chi;               // projector real
     double _Complex **Chi_c;     // projector complex
+    float **Chi_sp;             // single precision copy of Chi for the mixed-precision filter, or NULL
+    float _Complex **Chi_c_sp;  // single precision copy of Chi_c for the mixed-precision filter, or NULL
     // variables for spin-orbit coupling
     int nprojso;                // number of SO projectors per atom
     double _Complex **Chiso;     // SO projector complex
@@ -179,6 +185,98 @@ typedef struct _NLOC_PROJ_OBJ {
 
 
 
+/**
+ * @brief   This structure type is designed for storing one level of the geometric
+ *          multigrid hierarchy used to precondition the Poisson equation. Level 0
+ *          is the phi-domain grid, coarser levels share the same process grid.
+ */
+typedef struct _MG_LEVEL_OBJ {
+    int N[3];           // global number of grid points in each direction
+    int n[3];           // local number of grid points in each direction
+    int s[3];           // global index of the first local grid point in each direction
+    int nd;             // total number of local grid points
+    int off[3];         // 0 for periodic, 1 for Dirichlet (zero value at index -1 and N)
+    double h[3];        // mesh size in each direction
+    double coef[6];     // stencil coefficients T_ii/h_i^2 (xx, yy, zz) and 2*T_ij/(h_i*h_j) (xy, xz, yz)
+    double eig_max;     // estimate of the maximum eigenvalue of -Lap on this level
+    double eig_min;     // estimate of the minimum (nonzero) eigenvalue of -Lap, used on the coarsest level
+    double *x;          // solution on this level
+    double *b;          // right hand side on this level
+    double *r;          // residual on this level
+    double *d;          // Chebyshev search direction on this level
+    double *w;          // work vector for applying the operator
+    double *ex;         // work vector with halo
+    double *sendbuf;    // buffer for sending halo
+    double *recvbuf;    // buffer for receiving halo
+    // transfer operators between this level and the next finer level
+    int *P_idx[3];      // coarse (this level) index of the left neighbor of each fine point
+    double *P_wt[3];    // weight of the left neighbor, right neighbor gets 1 - weight
+    int *R_idx[3];      // fine index of the first point restricted to each coarse point
+    double *R_wt[3];    // restriction weights, MG_RWIDTH per coarse point
+} MG_LEVEL_OBJ;
+
+
+
+/**
+ * @brief   This structure type is designed for storing a persistent plan of the
+ *          pencil-decomposed parallel 3D FFT. Data enter and leave in the block
+ *          (domain) decomposition of a Cartesian communicator, and are transposed
+ *          to x-, y- and z-pencils in between, where batched 1D transforms are done.
+ */
+typedef struct _PENCIL_FFT_OBJ {
+    MPI_Comm comm;      // Cartesian communicator the plan is built on
+    int nproc;          // number of processes in comm
+    int is_complex;     // 0 - real to complex (Gamma point), 1 - complex to complex
+    int N[3];           // global number of grid points in x, y, z
+    int Nxf;            // number of frequencies in x, N[0]/2+1 if real, N[0] otherwise
+    int ncol_max;       // number of columns the buffers and batched plans are built for
+    // local boxes (start and size in x, y, z) of each layout on every process, 6 ints per process
+    int *dm_box;        // domain decomposition, input/output of the transform
+    int *xp_box;        // x-pencils, x range is [0,N[0]) in real space, [0,Nxf) in frequency
+    int *yp_box;        // y-pencils
+    int *zp_box;        // z-pencils, layout of the data in frequency space
+    MPI_Comm sub_comm[3]; // sub-communicators of the transposes domain <-> x, x <-> y and y <-> z pencils
+    int sub_nproc[3];     // number of processes in each sub-communicator
+    int *sub_ranks[3];    // ranks in comm of the processes of each sub-communicator
+    int *sendcounts, *sdispls, *recvcounts, *rdispls; // variables for alltoallv in the transposes
+    int nd_max;         // maximum local size among all layouts (per column)
+    double *sendbuf, *recvbuf;
+    double *work1, *work2; // the frequency-space result of the forward transform is in work2
+    // batched 1D transforms along x, y, z, for ncol_max columns and for a single column
+    void *fwd_plan[3], *bwd_plan[3];
+    void *fwd_plan1[3], *bwd_plan1[3];
+} PENCIL_FFT_OBJ;
+
+
+
+/**
+ * @brief   This structure type is designed for storing a persistent plan of the
+ *          halo exchange of a stencil operator on a Cartesian communicator. The
+ *          plans are cached on the communicator and reused by every call with
+ *          the same halo sizes and number of columns.
+ */
+typedef struct _HALO_PLAN_OBJ {
+    MPI_Comm comm;      // communicator the plan is built on (not owned)
+    MPI_Datatype type;  // data type of the halo values
+    int nnbr;           // number of neighbors of the graph topology (6 or 26)
+    int ncol;           // number of columns exchanged together
+    int nbr_size[26];   // number of halo values per column sent to/received from each neighbor
+    int counts[26];     // counts and displacements of the neighbor alltoallv (all columns)
+    int displs[26];
+    int nd;             // total number of halo values in each buffer
+    void *sendbuf;      // packed halo values to be sent, in the order of the neighbors
+    void *recvbuf;      // received halo values, zero for the missing neighbors of non-periodic BCs
+    void *x_ex;         // extended-domain work array of the operator using the plan
+    size_t x_ex_len;    // size of x_ex in bytes
+    MPI_Request request;
+    int is_persistent;  // 1 if request is a persistent neighbor collective (MPI-4)
+    int in_use;         // 1 between Halo_plan_get and Halo_plan_release
+    unsigned long last_use;
+    struct _HALO_PLAN_OBJ *next;
+} HALO_PLAN_OBJ;
+
+
+
 typedef struct _SPARC_OBJ{
     char SPARCROOT[L_STRING]; // SPARC root directory
     
@@ -194,6 +292,7 @@ typedef struct _SPARC_OBJ{
     char restart_Filename[L_STRING];
     char restartC_Filename[L_STRING];
     char restartP_Filename[L_STRING];  
+    char SCFRestartFilename[L_STRING];
     char DensTCubFilename[L_STRING];
     char DensDCubFilename[L_STRING];
     char DensUCubFilename[L_STRING];
@@ -202,6 +301,7 @@ typedef struct _SPARC_OBJ{
     char KinEnDensUCubFilename[L_STRING];
     char KinEnDensDCubFilename[L_STRING];
     char XcEnDensCubFilename[L_STRING];
+    char TimingFilename[L_STRING];
     char ExxEnDensTCubFilename[L_STRING];
     char ExxEnDensUCubFilename[L_STRING];
     char ExxEnDensDCubFilename[L_STRING];
@@ -220,10 +320,12 @@ typedef struct _SPARC_OBJ{
     int npNdx_phi;      // number of processes for calculating phi in paral. over domain in x-dir
     int npNdy_phi;      // number of processes for calculating phi in paral. over domain in y-dir
     int npNdz_phi;      // number of processes for calculating phi in paral. over domain in z-dir 
+    int num_omp_threads; // number of OpenMP threads per MPI process for grid kernels
     int npNdx_kptcomm;  // number of processes in x-dir for creating Cartesian topology in kptcomm 
     int npNdy_kptcomm;  // number of processes in y-dir for creating Cartesian topology in kptcomm 
     int npNdz_kptcomm;  // number of processes in z-dir for creating Cartesian topology in kptcomm
     int useDefaultParalFlag; // Flag for using default parallelization
+    int paral_autotune;  // number of layouts timed by the parallelization autotuner, 0 for off
     int FixRandSeed;    // flag to fix the random number seeds so that all random numbers generated in parallel 
                         // under MPI are the same as those generated in sequential execution
                         
@@ -361,7 +463,25 @@ typedef struct _SPARC_OBJ{
     //int *IP_len;              // nonlocal inner product length corresponding to each atom, size: n_atom x 1
     int *IP_displ;              // start index for storing nonlocal inner product, size: (n_atom + 1) x 1
     int *IP_displ_SOC;          // start index for storing nonlocal inner product, size: (n_atom + 1) x 1
+    void *Vnl_work;             // workspace of the nonlocal operator, reused across calls (LOCAL)
+    size_t Vnl_work_len;        // size of Vnl_work in bytes
+    size_t Vnl_work_ip;         // bytes at the front of Vnl_work holding the inner products
     
+    /* incremental update of atom-centered quantities across relax/MD steps */
+    int IncrUpdateFlag;         // flag for reusing the pseudocharges and projectors of atoms that did not move
+    double IncrUpdateTol;       // displacement (Bohr) up to which an atom is considered as not moved
+    double *atom_pos_ref;       // positions at which the atom-centered quantities were last built, size: 3*n_atom
+    int *atom_moved;            // flag for each atom, 1 if its quantities are rebuilt in this step
+    int n_atom_moved;           // number of atoms that are rebuilt in this step
+    double IncrUpdateCell[6];   // mesh sizes and cell lengths of the last step
+    double Esc_atom;            // atom part of Esc in the local domain, -sum_J bJ_ref*VJ_ref (LOCAL)
+    double scal_fac_at;         // scaling factor applied to electronDens_at in the last step
+    ATOM_INFLUENCE_OBJ *Atom_Influence_local_prev;          // Atom_Influence_local of the last step (LOCAL)
+    ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc_prev;      // Atom_Influence_nloc of the last step (LOCAL)
+    ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc_kptcomm_prev; // Atom_Influence_nloc_kptcomm of the last step (LOCAL)
+    NLOC_PROJ_OBJ *nlocProj_prev;            // nlocProj of the last step (LOCAL)
+    NLOC_PROJ_OBJ *nlocProj_kptcomm_prev;    // nlocProj_kptcomm of the last step (LOCAL)
+
     /* Finite difference */
     int order;          // order of central difference
     double *FDweights_D1; // finite difference weights for first derivatives
@@ -397,6 +517,9 @@ typedef struct _SPARC_OBJ{
     
     /* Poisson solver */
     int POISSON_SOLVER;  // AAR or CG
+    int POISSON_PRECOND; // 0 - Jacobi, 1 - geometric multigrid
+    int MG_nlevels;      // number of levels in the multigrid hierarchy (0 if not set up)
+    MG_LEVEL_OBJ *MG_levels; // multigrid levels
     /* Iterations: tolerances and max_iters */
     int MAXIT_SCF;      // max number of SCF iterations
     int MINIT_SCF;      // min number of SCF iterations
@@ -409,6 +532,7 @@ typedef struct _SPARC_OBJ{
     double TOL_RELAX;   // Relaxation tolerance
     double TOL_POISSON; // Poisson tolerance
     double TOL_LANCZOS; // Lanczos tolerance
+    double TOL_CheFSI_MixedPrec; // SCF error below which the Chebyshev filter is done in double precision
     double TOL_PSEUDOCHARGE;    // tolerance for calculating 
                                 // pseudocharge density radius
     double TOL_PRECOND;  // tolerance for Kerker preconditioner
@@ -425,6 +549,8 @@ typedef struct _SPARC_OBJ{
     double precondcoeff_k; // constant term in the rational fit of the preconditioner
     double _Complex *precondcoeff_a; // coeff in the numerator of the rational fit of the preconditioner
     double _Complex *precondcoeff_lambda_sqr; // coeff in the denominator of the rational fit of the preconditioner
+    PENCIL_FFT_OBJ *PrecondFFT; // parallel FFT plan on dmcomm_phi for the Kerker preconditioner in periodic cells
+    double *PrecondFFT_lap;     // FD Laplacian symbol at the local frequencies of PrecondFFT
 
     int RelaxCount;     // current relaxation step
     int StressCount;    // current stress count used in full relaxation
@@ -596,6 +722,11 @@ typedef struct _SPARC_OBJ{
     /* Chebyshev filtering */
     int ChebDegree;        // degree of Chebyshev polynomial
     int CheFSI_Optmz;      // flag for optimizing Chebyshev filtering polynomial degrees
+    int CheFSI_MixedPrec;  // flag for running the Chebyshev filter in single precision in early SCF iterations
+    int CheFSI_UseSP;      // flag for filtering in single precision in the current SCF iteration
+    int CSFlag;            // flag for the complementary subspace Rayleigh-Ritz step
+    int CS_Ntop;           // number of top states computed explicitly in the complementary subspace mode
+    int CS_warned;         // flag for the warning on partially occupied states below the top CS_NTOP ones
     int rhoTrigger;        // triger for starting to update electron density during scf iterations
     int chefsibound_flag;  // flag for estimating upper bounds of Chebyshev Filtering in every SCF iter
     double *eigmin;        // Stores minimum eigenvalue of Hamiltonian/Laplacian
@@ -632,6 +763,8 @@ typedef struct _SPARC_OBJ{
     double radial_max;
     //
     double rcut_SOAP;
+    double nlist_skin_MLFF;   // Verlet skin for reusing the MLFF neighbor list (bohr)
+    double hyper_tol_MLFF;    // relative change of the MLFF row scales or hyperparameters that triggers a re-optimization
     double sigma_atom_SOAP;
     double beta_2_SOAP;
     double beta_3_SOAP;
@@ -642,6 +775,7 @@ typedef struct _SPARC_OBJ{
     char mlff_data_folder[L_STRING];
     double stress_rel_scale[6];
     int MLFF_DFT_fq;
+    int hyper_nstr_MLFF;   // new structures after which the MLFF hyperparameters are re-optimized
     
     /* Energies */
     double Esc;            // self + correction energy, Esc = Eself + Ec
@@ -666,6 +800,7 @@ typedef struct _SPARC_OBJ{
     double stress_xc[6];   // Exchange-correlation contr. to ST
     double stress_el[6];   // Electrostatics contr. to ST
     double stress_nl[6];   // Nonlocal psp. contr. to ST
+    int nlocStressReady;   // 1 if stress_k and stress_nl were computed together with the nonlocal forces
     double stress_i[6];    // Ionic contr. to ST
     double stress_exx[6];  // Exact Exchange contr. to ST
     double pres;           // Full pressure
@@ -838,6 +973,10 @@ typedef struct _SPARC_OBJ{
     D2D_OBJ gatherThetasRecvr;
     D2D_OBJ scatterThetasSender;
     D2D_OBJ scatterThetasRecvr;
+    void *vdWDFFFTplan;            // persistent parallel FFT on zAxisComm (MKL CDFT descriptor or FFTW MPI forward plan)
+    void *vdWDFiFFTplan;           // persistent parallel iFFT on zAxisComm (FFTW MPI backward plan, unused by MKL)
+    double _Complex *vdWDFFFTin;   // input buffer of the persistent FFT plans
+    double _Complex *vdWDFFFTout;  // output buffer of the persistent FFT plans
     double _Complex **vdWDFthetaFTs;
     double reciLattice[9]; // inverse of lattice multiply a coefficient
     int **timeReciLattice; // reciprocal lattice grid point i = timeReciLattice[0][i]*pSPARC->reciLattice0(0 1 2)+timeReciLattice[1][i]*pSPARC->reciLattice1(3 4 5)+timeReciLattice[2][i]*pSPARC->reciLattice2(6 7 8)
@@ -868,6 +1007,9 @@ typedef struct _SPARC_OBJ{
     double exx_frac;                // hybrid mixing coefficient
     double hyb_range_fock;          // hybrid short range for fock operator 
     double hyb_range_pbe;           // hybrid short range for exchange correlation 
+    double exx_sr_table_tol;        // tolerance of tabulated HSE short-range enhancement factor, 0 for analytic
+    int wpbe_tab_n;                 // number of intervals per dimension of the tabulated enhancement factor
+    double *wpbe_tab;               // tabulated HSE short-range enhancement factor and derivatives
     int EXXMeth_Flag;               // Method to solve Poisson's equation, in Real space or Fourier space
     double Eexx;                    // Exact Exchange energy
     double *psi_outer;              // outer orbitals to construct Hartree-Fock operator 
@@ -913,6 +1055,7 @@ typedef struct _SPARC_OBJ{
     double *pois_FFT_const_stress;  // Constants for FFT solver in Poisson's equation in stress
     double *pois_FFT_const_stress2; // Constants for FFT solver in Poisson's equation in stress
     double *pois_FFT_const_press;   // Constants for FFT solver in Poisson's equation in press
+    PENCIL_FFT_OBJ *ExxFFT[2];      // persistent parallel FFT plans for dmcomm and kptcomm_topo
     int ACEFlag;                    // Flag for ACE operator 
     int Nstates_occ;                // Number of occupied states 
     int Nstates_occ_list[2];        // List of number of occupied states 
@@ -921,6 +1064,11 @@ typedef struct _SPARC_OBJ{
     int EXXDownsampling[3];         // Downsampling info
     double const_aux;               // constant for auxlliary function
     int EXXDiv_Flag;                // Method for integrable singularity 
+    int ISDFFlag;                   // Flag for ISDF compression of exact exchange
+    double EXXISDF_ratio;           // ratio of number of ISDF points to number of occupied states
+    int ISDF_Npts;                  // number of ISDF interpolation points
+    int *ISDF_pts;                  // global grid indices of ISDF interpolation points
+    double *ISDF_W;                 // ISDF exact exchange operator W(r,mu) in dmcomm
     int flag_kpttopo_dm;            // flag of whether the dmcomm and kpttopo are the same
     int flag_kpttopo_dm_type;       // flag for receving or sending the correct occupations
     MPI_Comm kpttopo_dmcomm_inter;  // the extra communicator for occupations transferring 
@@ -935,6 +1083,7 @@ typedef struct _SPARC_OBJ{
     int SQFlag;                     // Flag of SQ method
     int SQ_gauss_mem;               // Memory option for gauss quadrature 
     int SQ_npl_g;                   // Degree of polynomial (should be a multiple of 4) for Gauss Quadrature
+    int SQ_block_size;              // Number of FD nodes whose Lanczos iterations are run together
     int SQ_correction;              // Flag for culculating "charge overlap correction".
     double SQ_rcut;                 // Truncation or localization radius    
     double SQ_tol_occ;              // Tolerance for occupation corresponding to maximum eigenvalue
@@ -981,6 +1130,13 @@ typedef struct _SPARC_OBJ{
     double *atom_pos_0dt;
     double *atom_pos_1dt;
     double *atom_pos_2dt;
+    int OrbExtrapFlag;            // flag for extrapolating the orbitals between relax/MD steps
+    int OrbExtrapCount;           // number of previous orbital sets stored (at most 2)
+    int OrbExtrapStep;            // 1 if the orbitals of the current step have been extrapolated
+    double *Xorb_1dt;             // orbitals of the previous step, aligned as Xorb (LOCAL)
+    double *Xorb_2dt;             // orbitals of the step before the previous one (LOCAL)
+    double _Complex *Xorb_kpt_1dt;
+    double _Complex *Xorb_kpt_2dt;
     
     /* print options */
     int Verbosity;
@@ -988,14 +1144,18 @@ typedef struct _SPARC_OBJ{
     int PrintAtomPosFlag;
     int PrintAtomVelFlag;
     int PrintEigenFlag;
+    int PrintTimingFlag;  // flag for writing the per-phase timing report
     int PrintElecDensFlag;
     int PrintMDout;
     int PrintRelaxout;
     int Printrestart;
     int Printrestart_fq;
+    int Printrestart_scf;   // flag for writing/reading orbitals, eigenvalues and density for restarting the SCF
+    int SCFRestartRead;     // 1 if the initial guess of the first SCF is read from the SCF restart file
     int suffixNum;  // the number appended to the output filename, only used if it's greater than 0    
     int PrintPsiFlag[7];
     int PrintEnergyDensFlag;
+    int PrintDensFormat;    // format of the density files, 0 - cube, 1 - binary, 2 - both
     
     /* Energy density */
     double *KineticRho;         // Kinetic energy density
@@ -1067,6 +1227,8 @@ typedef struct _SPARC_INPUT_OBJ{
     double condK_min;
     double factor_multiply_sigma_tol;
     double rcut_SOAP;
+    double nlist_skin_MLFF;   // Verlet skin for reusing the MLFF neighbor list (bohr)
+    double hyper_tol_MLFF;    // relative change of the MLFF row scales or hyperparameters that triggers a re-optimization
     double sigma_atom_SOAP;
     double beta_3_SOAP;
     double xi_3_SOAP;
@@ -1076,6 +1238,7 @@ typedef struct _SPARC_INPUT_OBJ{
     char hnl_file_name[L_STRING];
     char mlff_data_folder[L_STRING];
     int MLFF_DFT_fq;
+    int hyper_nstr_MLFF;   // new structures after which the MLFF hyperparameters are re-optimized
     
     /* Parallelizing parameters */
     int num_node;       // number of processor nodes
@@ -1090,6 +1253,8 @@ typedef struct _SPARC_INPUT_OBJ{
     int npNdx_phi;      // number of processes for calculating phi in paral. over domain in x-dir
     int npNdy_phi;      // number of processes for calculating phi in paral. over domain in y-dir
     int npNdz_phi;      // number of processes for calculating phi in paral. over domain in z-dir    
+    int num_omp_threads; // number of OpenMP threads per MPI process for grid kernels
+    int paral_autotune;  // number of layouts timed by the parallelization autotuner, 0 for off
     int eig_serial_maxns;   // maximum Nstates for using LAPACK to solve the subspace eigenproblem by default,
                         // for Nstates greater than this value, ScaLAPACK will be used instead, unless 
                         // useLAPACK is turned off.
@@ -1098,6 +1263,8 @@ typedef struct _SPARC_INPUT_OBJ{
     int MDFlag;
     int RelaxFlag;
     int RestartFlag;
+    int IncrUpdateFlag; // flag for reusing the pseudocharges and projectors of atoms that did not move
+    int OrbExtrapFlag;  // flag for extrapolating the orbitals between relax/MD steps
     int Flag_latvec_scale; // Flag indicating wether LATVEC_SCALE is specified
     int numIntervals_x; // number of intervals in x direction
     int numIntervals_y; // number of intervals in y direction
@@ -1121,6 +1288,9 @@ typedef struct _SPARC_INPUT_OBJ{
     /* Chebyshev filtering */
     int ChebDegree;     // degree of Chebyshev polynomial   
     int CheFSI_Optmz;   // flag for optimizing Chebyshev filtering polynomial degrees
+    int CheFSI_MixedPrec; // flag for running the Chebyshev filter in single precision in early SCF iterations
+    int CSFlag;          // flag for the complementary subspace Rayleigh-Ritz step
+    int CS_Ntop;         // number of top states computed explicitly in the complementary subspace mode
     int chefsibound_flag; // flag for calculating bounds for Chebyshev filtering
     int rhoTrigger;      // triger for starting to update electron density during scf iterations
     int Nchefsi;         // Number of ChefSi for each scf step
@@ -1158,13 +1328,16 @@ typedef struct _SPARC_INPUT_OBJ{
     int PrintAtomPosFlag;
     int PrintAtomVelFlag;
     int PrintEigenFlag;
+    int PrintTimingFlag;  // flag for writing the per-phase timing report
     int PrintElecDensFlag;
     int PrintMDout;
     int PrintRelaxout;
     int Printrestart;
     int Printrestart_fq;
+    int Printrestart_scf;
     int PrintPsiFlag[7];
     int PrintEnergyDensFlag;
+    int PrintDensFormat;    // format of the density files, 0 - cube, 1 - binary, 2 - both
     
     /* Smearing */
     int elec_T_type;    // electronic temperature (smearing) type, 0 - fermi-dirac, 1 - gaussian
@@ -1186,6 +1359,7 @@ typedef struct _SPARC_INPUT_OBJ{
 
     /* Linear solver*/
     int Poisson_solver;
+    int Poisson_precond;
 
     /* Domain description */
     double range_x;
@@ -1210,6 +1384,8 @@ typedef struct _SPARC_INPUT_OBJ{
     double TOL_RELAX;   // Relaxation tolerance
     double TOL_POISSON; // Poisson tolerance
     double TOL_LANCZOS; // Lanczos tolerance
+    double TOL_CheFSI_MixedPrec; // SCF error below which the Chebyshev filter is done in double precision
+    double IncrUpdateTol; // displacement (Bohr) up to which an atom is considered as not moved
     double TOL_PSEUDOCHARGE;    // tolerance for calculating 
                                 // pseudocharge density radius
     double TOL_PRECOND;  // tolerance for real-space preconditioner in SCF
@@ -1293,14 +1469,18 @@ typedef struct _SPARC_INPUT_OBJ{
     int EXXACEVal_state;    // Number of extra unoccupied states in constructing ACE operator
     int EXXDownsampling[3]; // Downsampling info 
     int EXXDiv_Flag;        // Method for integrable singularity 
+    int ISDFFlag;           // Flag for ISDF compression of exact exchange
+    double EXXISDF_ratio;   // ratio of number of ISDF points to number of occupied states
     double hyb_range_fock;  // hybrid short range for fock operator 
     double hyb_range_pbe;   // hybrid short range for exchange correlation 
+    double exx_sr_table_tol;// tolerance of tabulated HSE short-range enhancement factor, 0 for analytic
     double exx_frac;        // hybrid mixing coefficient
 
     /* SQ methods */
     int SQFlag;             // Flag of SQ method
     int SQ_gauss_mem;       // Memory option for gauss quadrature 
     int SQ_npl_g;           // Degree of polynomial (should be a multiple of 4) for Gauss Quadrature
+    int SQ_block_size;      // Number of FD nodes whose Lanczos iterations are run together
     double SQ_rcut;         // Truncation or localization radius
     double SQ_tol_occ;      // Tolerance for occupation corresponding to maximum eigenvalue
     int npNdx_SQ;           // number of processes for paral. over domain in x-dir
@@ -18,6 +18,16 @@
 
 #include "isddft.h"
 
+// The interior stencil of orthogonal cells is applied in tiles of LAP_TILE_NCOL
+// vectors times a slab of z-planes, the slab is the thickest one whose planes of
+// v, x and y fit in LAP_TILE_BYTES. Both can be set at compile time.
+#ifndef LAP_TILE_NCOL
+#define LAP_TILE_NCOL  4
+#endif
+#ifndef LAP_TILE_BYTES
+#define LAP_TILE_BYTES 262144
+#endif
+
 
 /**
  * @brief   Calculate (Lap + c * I) times vectors in a matrix-free way.
@@ -62,11 +72,7 @@ void Lap_vec_mult_orth(
  *
  *          This is only for orthogonal systems.
  *
- *          Warning:
- *            Although the function is intended for multiple vectors,
- *          it turns out to be slower than applying it to one vector
- *          at a time. So we will be calling this function ncol times
- *          if ncol is greater than 1.
+ *          The halos of all ncol vectors are exchanged in one message.
  */
 void Lap_plus_diag_vec_mult_orth(
     const SPARC_OBJ *pSPARC, const int DMnd, const int *DMVertices,
@@ -203,11 +209,7 @@ void snd_rcv_buffer(
 /**
  * @brief   Calculate (a * Lap + b * diag(v) + c * I) times vectors.
  *
- *          Warning:
- *            Although the function is intended for multiple vectors,
- *          it turns out to be slower than applying it to one vector
- *          at a time. So we will be calling this function ncol times
- *          if ncol is greater than 1.
+ *          The halos of all ncol vectors are exchanged in one message.
  */
 void Lap_plus_diag_vec_mult_nonorth(
     const SPARC_OBJ *pSPARC, const int DMnd, const int *DMVertices,
@@ -0,0 +1,137 @@
+/**
+ * @file    mixedPrecisionFilter.h
+ * @brief   This file contains the function declarations for the mixed-precision
+ *          Chebyshev filter.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#ifndef MIXEDPRECISIONFILTER_H
+#define MIXEDPRECISIONFILTER_H
+
+#include <complex.h>
+#include "isddft.h"
+
+// number of final Chebyshev recurrence steps that are always done in double precision
+#define CHEFSI_MIXED_PREC_DP_STEPS 2
+
+
+/**
+ * @brief   Decide if the Chebyshev filter is done in single precision in the
+ *          current SCF iteration.
+ *
+ *          Single precision is used if CHEFSI_MIXED_PREC is on, the SCF error is
+ *          still above TOL_CHEFSI_MIXED_PREC and the Hamiltonian is supported by
+ *          the single precision routines (orthogonal cell, no cyclix, one spinor
+ *          per eigenproblem, no hybrid or metaGGA term).
+ */
+int CheFSI_use_single_precision(const SPARC_OBJ *pSPARC, double error);
+
+
+/**
+ * @brief   Calculate (a * Lap + diag(v) + c * I) times vectors in single precision.
+ *
+ *          This is only for orthogonal discretization.
+ */
+void Lap_plus_diag_vec_mult_orth_sp(
+        const SPARC_OBJ *pSPARC, const int DMnd, const int *DMVertices,
+        const int ncol, const double a, const double c, const float *v,
+        const float *x, const int ldi, float *y, const int ldo, MPI_Comm comm, const int *dims
+);
+
+
+/**
+ * @brief   Calculate (a * Lap + diag(v) + c * I) times vectors in single precision
+ *          with a Bloch factor.
+ *
+ *          This is only for orthogonal discretization.
+ */
+void Lap_plus_diag_vec_mult_orth_sp_kpt(
+        const SPARC_OBJ *pSPARC, const int DMnd, const int *DMVertices,
+        const int ncol, const double a, const double c, const float *v,
+        const float _Complex *x, const int ldi, float _Complex *y, const int ldo, MPI_Comm comm,
+        const int *dims, const int kpt
+);
+
+
+/**
+ * @brief   Keep a single precision copy of the nonlocal projectors next to Chi
+ *          (Chi_c for k-points), used by Vnl_vec_mult_sp(_kpt).
+ *
+ *          Called once after the projectors of the psi-domain are calculated,
+ *          i.e., at the start and after every update of the atom positions.
+ *          Nothing is done if the mixed-precision filter cannot be used.
+ */
+void CalculateNonlocalProjectors_sp(const SPARC_OBJ *pSPARC, NLOC_PROJ_OBJ *nlocProj,
+                                    ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, MPI_Comm comm);
+
+
+/**
+ * @brief   Free the single precision copy of the nonlocal projectors.
+ */
+void Free_NonlocalProjectors_sp(NLOC_PROJ_OBJ *nlocProj, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, int Ntypes);
+
+
+/**
+ * @brief   Calculate Vnl times vectors in single precision.
+ */
+void Vnl_vec_mult_sp(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc,
+                     NLOC_PROJ_OBJ *nlocProj, int ncol, float *x, int ldi, float *Hx, int ldo, MPI_Comm comm);
+
+
+/**
+ * @brief   Calculate Vnl times vectors in single precision with Bloch factor.
+ */
+void Vnl_vec_mult_sp_kpt(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc,
+                         NLOC_PROJ_OBJ *nlocProj, int ncol, float _Complex *x, int ldi, float _Complex *Hx,
+                         int ldo, int kpt, MPI_Comm comm);
+
+
+/**
+ * @brief   Calculate (Hamiltonian + c * I) times vectors in single precision.
+ */
+void Hamiltonian_vectors_mult_sp(
+    const SPARC_OBJ *pSPARC, int DMnd, int *DMVertices, float *Veff_loc,
+    ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, NLOC_PROJ_OBJ *nlocProj,
+    int ncol, double c, float *x, const int ldi, float *Hx, const int ldo, MPI_Comm comm
+);
+
+
+/**
+ * @brief   Calculate (Hamiltonian + c * I) times vectors in single precision
+ *          with a Bloch wavevector.
+ */
+void Hamiltonian_vectors_mult_sp_kpt(
+    const SPARC_OBJ *pSPARC, int DMnd, int *DMVertices, float *Veff_loc,
+    ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, NLOC_PROJ_OBJ *nlocProj,
+    int ncol, double c, float _Complex *x, const int ldi, float _Complex *Hx, const int ldo,
+    int kpt, MPI_Comm comm
+);
+
+
+/**
+ * @brief   Perform Chebyshev filtering in mixed precision.
+ *
+ *          The first m - CHEFSI_MIXED_PREC_DP_STEPS steps of the recurrence are
+ *          done in single precision. The last steps are done in double precision
+ *          so that the filtered vectors passed to the projection and the subspace
+ *          rotation are consistent with the double precision Hamiltonian. The
+ *          arguments are the same as for ChebyshevFiltering.
+ */
+void ChebyshevFiltering_mixed(
+    SPARC_OBJ *pSPARC, int *DMVertices, double *X, int ldi, double *Y, int ldo, int ncol,
+    int m, double a, double b, double a0, int k, int spn_i, MPI_Comm comm,
+    double *time_info
+);
+
+
+/**
+ * @brief   Perform Chebyshev filtering in mixed precision with a Bloch wavevector.
+ */
+void ChebyshevFiltering_mixed_kpt(
+    SPARC_OBJ *pSPARC, int *DMVertices, double _Complex *X, int ldi, double _Complex *Y, int ldo, int ncol,
+    int m, double a, double b, double a0, int kpt, int spn_i, MPI_Comm comm,
+    double *time_info
+);
+
+#endif // MIXEDPRECISIONFILTER_H
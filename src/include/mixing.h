@@ -95,6 +95,10 @@ double dotprod_nc(const double *vec1, const double *vec2, int N, int opt);
  *          inverse of diemac (dielectric macroscopic constant).
  *          When c is 0, it's the original Kerker preconditioner.
  *          The result is written in Pf.
+ *
+ *          In cells that are periodic in all directions the operator is
+ *          applied directly with FFT (if MKL or FFTW is linked), otherwise
+ *          the linear system is solved iteratively with AAR.
  */
 void Kerker_precond(
     SPARC_OBJ *pSPARC, double *f, const double a, 
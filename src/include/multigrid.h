@@ -0,0 +1,36 @@
+/**
+ * @file    multigrid.h
+ * @brief   This file contains the function declarations for the geometric
+ *          multigrid preconditioner of the Poisson equation.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#ifndef MULTIGRID_H
+#define MULTIGRID_H
+
+#include "isddft.h"
+
+
+/**
+ * @brief   Set up the multigrid hierarchy on the phi-domain.
+ */
+void Setup_multigrid(SPARC_OBJ *pSPARC, MPI_Comm comm);
+
+
+/**
+ * @brief   Free the multigrid hierarchy.
+ */
+void Free_multigrid(SPARC_OBJ *pSPARC);
+
+
+/**
+ * @brief   Multigrid preconditioner for the Poisson equation, f = inv(M) * r,
+ *          where M approximates -(Lap + c * I).
+ *
+ *          One V-cycle is applied. The hierarchy is set up at the first call
+ *          and again whenever the mesh size changes (e.g., NPT MD or cell relaxation).
+ */
+void Multigrid_preconditioner(SPARC_OBJ *pSPARC, int N, double c, double *r, double *f, MPI_Comm comm);
+
+#endif // MULTIGRID_H
@@ -0,0 +1,68 @@
+/**
+ * @file    nlocForceStress.h
+ * @brief   This file contains the function declarations for calculating the
+ *          nonlocal forces together with the nonlocal and kinetic stress.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#ifndef NLOCFORCESTRESS_H
+#define NLOCFORCESTRESS_H
+
+#include "isddft.h"
+
+
+/**
+ * @brief   Calculate nonlocal forces and nonlocal + kinetic stress in one pass
+ *          over the orbitals - gamma point.
+ *
+ *          The orbitals are processed in band tiles. The gradient of each tile
+ *          is computed once and used for the force integrals, the nonlocal
+ *          stress integrals and the kinetic stress before it is discarded. The
+ *          stress is stored in pSPARC->stress_nl and pSPARC->stress_k, and
+ *          pSPARC->nlocStressReady is set so Calculate_nonlocal_kinetic_stress
+ *          does not compute it again.
+ */
+void Calculate_nonlocal_forces_stress_linear(SPARC_OBJ *pSPARC);
+
+
+/**
+ * @brief   Calculate nonlocal forces and nonlocal + kinetic stress in one pass
+ *          over the orbitals - k-points.
+ */
+void Calculate_nonlocal_forces_stress_kpt(SPARC_OBJ *pSPARC);
+
+
+/**
+ * @brief   Number of bands in one tile of the fused force/stress pass.
+ *
+ *          The tile is chosen such that the gradients of one tile in all three
+ *          directions fit in the work array Yorb (Yorb_kpt).
+ */
+int nloc_force_stress_tile_size(int ncol);
+
+
+/**
+ * @brief   Calculate <Chi_Jlm, DPsi_n> (dim2 < 0) or <Chi_Jlm, ST(x-RJ')_dim2 DPsi_n>
+ *          (0 <= dim2 < 3) for the bands n0 ~ n0+nt-1 of the local block.
+ *
+ *          dpsi holds the gradient of the nt bands of the tile, and the
+ *          results are added to the corresponding columns of beta, which is
+ *          laid out for all the Nband_bandcomm local bands.
+ */
+void Compute_Integral_Chi_Dpsi_tile(SPARC_OBJ *pSPARC, double *dpsi, int nt, int n0, double *beta, int dim2);
+void Compute_Integral_Chi_Dpsi_tile_kpt(SPARC_OBJ *pSPARC, double _Complex *dpsi, int nt, int n0,
+                                        double _Complex *beta, int kpt, int dim2, char *option);
+
+
+/**
+ * @brief   Add the kinetic stress of the bands n0 ~ n0+nt-1 to stress_k.
+ *
+ *          dpsi_full holds the cartesian gradients of the tile, with a stride
+ *          of ld between the x, y and z components.
+ */
+void Compute_stress_tensor_kinetic_tile(SPARC_OBJ *pSPARC, double *dpsi_full, int ld, int nt, int n0, double *stress_k);
+void Compute_stress_tensor_kinetic_tile_kpt(SPARC_OBJ *pSPARC, double _Complex *dpsi_full, int ld, int nt, int n0,
+                                            int kpt, double *stress_k);
+
+#endif // NLOCFORCESTRESS_H
@@ -44,6 +44,49 @@ void CalculateNonlocalProjectors_kpt(SPARC_OBJ *pSPARC, NLOC_PROJ_OBJ **nlocProj
 void CalculateNonlocalInnerProductIndex(SPARC_OBJ *pSPARC);
 
 
+/**
+ * @brief   Get the packed rc-domain buffer of the nonlocal workspace for ncol 
+ *          vectors with elements of elem bytes, with room for the inner products
+ *          of all images if with_ip is 1, and the storage for the image offsets
+ *          of one atom type in *displ. The workspace is kept in pSPARC and only
+ *          grows, the buffer is valid until the next call.
+ */
+void *Vnl_workspace_packed(const SPARC_OBJ *pSPARC, const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                           const NLOC_PROJ_OBJ *nlocProj, int ncol, size_t elem, int with_ip, size_t **displ);
+
+
+/**
+ * @brief   Get zeroed storage for the inner products of nalpha concurrent calls 
+ *          of Vnl_vec_mult_begin/end (elements of elem bytes) from the front of
+ *          the nonlocal workspace. It stays valid until the next call.
+ */
+void *Vnl_inner_product_workspace(const SPARC_OBJ *pSPARC, const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                                  const NLOC_PROJ_OBJ *nlocProj, int ncol, size_t elem, int nalpha);
+
+
+/**
+ * @brief   Start the nonlocal operator: find the inner products of the projectors
+ *          with the vectors and start their reduction over the domain comm.
+ *
+ *          The images of each atom type are processed as one batch: the vectors
+ *          are gathered into a packed workspace kept in pSPARC, and the small
+ *          per-image GEMMs are run concurrently over the images when there are
+ *          enough of them. alpha (zero on input) has to stay untouched until
+ *          Vnl_vec_mult_end, so that the reduction can overlap other work.
+ */
+void Vnl_vec_mult_begin(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                        NLOC_PROJ_OBJ *nlocProj, int ncol, double *x, int ldi, double *alpha, 
+                        MPI_Request *request, MPI_Comm comm);
+
+
+/**
+ * @brief   Finish the nonlocal operator: wait for the inner products, and add
+ *          the projectors times the scaled inner products to Hx.
+ */
+void Vnl_vec_mult_end(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                      NLOC_PROJ_OBJ *nlocProj, int ncol, double *alpha, MPI_Request *request, double *Hx, int ldo);
+
+
 /**
  * @brief   Calculate Vnl times vectors in a matrix-free way.
  */
@@ -52,6 +95,22 @@ void Vnl_vec_mult(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *At
 
 
 
+/**
+ * @brief   Start the nonlocal operator with Bloch factor (see Vnl_vec_mult_begin).
+ */
+void Vnl_vec_mult_kpt_begin(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                            NLOC_PROJ_OBJ *nlocProj, int ncol, double _Complex *x, int ldi, int kpt, 
+                            double _Complex *alpha, MPI_Request *request, MPI_Comm comm);
+
+
+/**
+ * @brief   Finish the nonlocal operator with Bloch factor (see Vnl_vec_mult_end).
+ */
+void Vnl_vec_mult_kpt_end(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                          NLOC_PROJ_OBJ *nlocProj, int ncol, int kpt, double _Complex *alpha, MPI_Request *request, 
+                          double _Complex *Hx, int ldo);
+
+
 /**
  * @brief   Calculate Vnl times vectors in a matrix-free way with Bloch factor
  */
@@ -0,0 +1,38 @@
+/**
+ * @file    paralAutotune.h
+ * @brief   This file contains the function declarations for the measured-cost
+ *          autotuner of the default process grid.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#ifndef PARALAUTOTUNE_H
+#define PARALAUTOTUNE_H
+
+#include "isddft.h"
+
+#define PARAL_AUTOTUNE_FNAME "sparc_paral.cache" // cache file, in the directory of the input file
+#define PARAL_AUTOTUNE_NREP  3                   // number of timed repetitions of each probe
+#define PARAL_AUTOTUNE_MAXN  16                  // largest number of layouts that can be timed
+
+
+/**
+ * @brief   Choose npspin, npkpt, npband and npNdx/y/z by timing the layouts.
+ *
+ *          On entry pSPARC holds the layout found by dims_divide_skbd. The
+ *          PARAL_AUTOTUNE best layouts according to skbd_weighted_efficiency
+ *          (the given one always included) are timed on a probe made of the
+ *          kernels that dominate an SCF step, i.e., the stencil part of
+ *          Hamiltonian_vectors_mult on the local bands, the projection of the
+ *          Hamiltonian onto the subspace and the subspace rotation, each over
+ *          the real band and domain distribution of the layout. The fastest
+ *          layout is written back to pSPARC.
+ *
+ *          The decision is cached in PARAL_AUTOTUNE_FNAME with the grid sizes,
+ *          the number of states, spins and k-points, the number of processes,
+ *          nodes and threads as key, so that later runs of the same system
+ *          size on the same allocation skip the probe.
+ */
+void Paral_autotune(SPARC_OBJ *pSPARC);
+
+#endif // PARALAUTOTUNE_H
@@ -0,0 +1,90 @@
+/**
+ * @file    parallelIO.h
+ * @brief   This file contains the function declarations for the collective
+ *          MPI-IO writers and readers of distributed grid vectors.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#ifndef PARALLELIO_H
+#define PARALLELIO_H
+
+#include "isddft.h"
+
+#define SPARC_VEC_MAGIC "SPARCVEC"  // first 8 bytes of a binary vector file
+#define SPARC_VEC_HEADER_SIZE 96    // magic, version, Nx, Ny, Nz, lattice vectors
+#define PSI_HEADER_SIZE 68          // header of a .psi file written by print_orbitals
+#define PSI_RECORD_HEADER_SIZE 36   // spin, kpt, kpt_vec, band in front of each orbital
+
+
+/**
+ * @brief   Write a distributed vector into a text file in cube format.
+ *
+ *          The vector is moved from the subdomains into slabs along x, each
+ *          process formats its slab and the chunks are written collectively
+ *          at their offsets. The file is the same as the one printDens_cube
+ *          writes from the gathered vector.
+ *
+ * @param x           Local part of the vector.
+ * @param DMVertices  Domain vertices of the local subdomain.
+ * @param comm        Cartesian communicator the vector is distributed over.
+ * @param fname       Name of the file.
+ * @param vecname     Name of the vector printed in the title line.
+ */
+void write_vec_cube_par(SPARC_OBJ *pSPARC, double *x, int *DMVertices, MPI_Comm comm,
+                        char *fname, char *vecname);
+
+
+/**
+ * @brief   Write a distributed vector into a binary file.
+ *
+ *          The file has a header of SPARC_VEC_HEADER_SIZE bytes (magic, version,
+ *          Nx, Ny, Nz as int, 9 lattice vector components as double) followed by
+ *          the Nx*Ny*Nz doubles with x running fastest. Each process writes its
+ *          subdomain directly through a subarray file view.
+ */
+void write_vec_bin_par(SPARC_OBJ *pSPARC, double *x, int *DMVertices, MPI_Comm comm, char *fname);
+
+
+/**
+ * @brief   Write a distributed density-like vector in the format(s) selected by
+ *          PRINT_DENSITY_FORMAT. The binary file is named fname.bin.
+ */
+void write_dens_par(SPARC_OBJ *pSPARC, double *x, int *DMVertices, MPI_Comm comm,
+                    char *fname, char *vecname);
+
+
+/**
+ * @brief   Read a vector from a binary file written by write_vec_bin_par or a
+ *          cube file and distribute it over comm.
+ *
+ *          The file name is taken from rank 0 of comm. The lattice vectors and
+ *          the grid sizes in the file are checked against pSPARC.
+ *
+ * @param fname       Name of the file (only needed on rank 0 of comm).
+ * @param x           (OUTPUT) Local part of the vector.
+ * @param DMVertices  Domain vertices of the local subdomain.
+ * @param comm        Cartesian communicator the vector is distributed over.
+ */
+void read_vec_par(SPARC_OBJ *pSPARC, char *fname, double *x, int *DMVertices, MPI_Comm comm);
+
+
+/**
+ * @brief   Write one Kohn-Sham orbital record of a .psi file.
+ *
+ *          The record header (spin, kpt, kpt_vec, band) is written by rank 0 of
+ *          comm, and the Nspinor components are written collectively from the
+ *          subdomains, scaled to unit L2-norm.
+ *
+ * @param x           Local part of the orbital, Nspinor blocks of DMnd values.
+ * @param unit_size   Size of a value, sizeof(double) or sizeof(double _Complex).
+ * @param fh          File opened on comm.
+ * @param offset      Offset of the record in bytes.
+ */
+void write_orbital_par(
+    void *x, int unit_size, int *gridsizes, int *DMVertices, double dV, int Nspinor,
+    MPI_File fh, MPI_Offset offset, int spin_index, int kpt_index, double *kpt_vec,
+    int band_index, MPI_Comm comm
+);
+
+#endif // PARALLELIO_H
@@ -17,6 +17,10 @@
 
 #include "isddft.h"
 
+// maximum NSTATES for the serial subspace eigensolver in the CS mode (CS_FLAG),
+// its cost is O(NSTATES^2 * CS_NTOP) once the top states are known
+#define CS_SERIAL_MAXNS 5000
+
 void bind_proc_to_phys_core();
 void bind_kptcomm_rank0_to_all_cores();
 int  get_kptcomm_core_num();
@@ -214,6 +218,28 @@ void dims_divide_kbd(
     const int np, int *np1, int *np2, int *np3);
 
 
+/**
+ * @brief  Estimated parallel efficiency of a division of processors into 
+ *         spin, kpoint, band and domain (SKBD) groups, used to rank the 
+ *         divisions in dims_divide_skbd.
+ *
+ * @param Nspin     Number of spin, 1 or 2.
+ * @param Nk        Number of kpoints (after symmetry reduction).
+ * @param Ns        Number of states.
+ * @param gridsizes Number of grid points in all three directions.
+ * @param np        Number of processors available.
+ * @param nps       Number of spin groups.
+ * @param npk       Number of kpoint groups.
+ * @param npb       Number of band groups.
+ * @param npd       Number of domain groups.
+ * @param isfock    Flag for if it's hybrid calculation
+ **/
+double skbd_weighted_efficiency(
+    const int Nspin, const int Nk, const int Ns, 
+    const int *gridsizes, const int np, const int nps, 
+    const int npk, const int npb, const int npd, const int isfock);
+
+
 /**
  * @brief  Caluclate a division of processors in for spin, kpoint, band, 
  *         domain (SKBD). 
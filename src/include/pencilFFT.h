@@ -0,0 +1,60 @@
+/**
+ * @file    pencilFFT.h
+ * @brief   This file contains the function declarations for the pencil-decomposed
+ *          parallel 3D FFT with persistent plans.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#ifndef PENCILFFT_H
+#define PENCILFFT_H
+
+#include "isddft.h"
+
+
+/**
+ * @brief   Create a persistent parallel FFT plan on a Cartesian communicator.
+ *
+ *          The data are distributed in the block (domain) decomposition given by
+ *          block_decompose over the process grid of comm, with x running fastest.
+ *
+ * @param plan          Plan to be created.
+ * @param gridsizes     Global number of grid points in x, y, z.
+ * @param is_complex    0 - real to complex transform, 1 - complex to complex transform.
+ * @param ncol          Number of columns transformed together (buffers grow if more are given).
+ * @param comm          Cartesian communicator with 3 dimensions.
+ */
+void Pencil_FFT_init(PENCIL_FFT_OBJ *plan, const int *gridsizes, int is_complex, int ncol, MPI_Comm comm);
+
+
+/**
+ * @brief   Free a parallel FFT plan.
+ */
+void Pencil_FFT_free(PENCIL_FFT_OBJ *plan);
+
+
+/**
+ * @brief   Forward 3D FFT of ncol columns in the domain decomposition.
+ *
+ *          The result is stored in plan->work2 as complex numbers in the z-pencil
+ *          layout: for process p, box = plan->zp_box + 6*p holds the start and size
+ *          in x, y, z, and the local index of frequency (i,j,k) in column n is
+ *          n*nd + (j-ys)*nx*Nz + (i-xs)*Nz + k, where nd is the size of the box.
+ *          For real input only the first N[0]/2+1 frequencies in x are kept.
+ *
+ * @param in    Local part of the input, double (real) or double _Complex (complex).
+ */
+void Pencil_FFT_forward(PENCIL_FFT_OBJ *plan, void *in, int ncol);
+
+
+/**
+ * @brief   Backward 3D FFT of ncol columns stored in plan->work2 (z-pencil layout)
+ *          to the domain decomposition.
+ *
+ *          The transform is not normalized, i.e., the result has to be divided by
+ *          N[0]*N[1]*N[2] to invert Pencil_FFT_forward. The content of plan->work2
+ *          is destroyed.
+ */
+void Pencil_FFT_backward(PENCIL_FFT_OBJ *plan, void *out, int ncol);
+
+#endif // PENCILFFT_H
@@ -20,6 +20,12 @@
  */
 void printElecDens(SPARC_OBJ *pSPARC);
 
+/**
+ * @brief   Format the header of a cube file (title lines, grid and atoms).
+ *          The returned string is allocated here and freed by the caller.
+ */
+char *format_cube_header(SPARC_OBJ *pSPARC, char *rhoname);
+
 /**
  * @brief   Print converged density in cube format.
  */
@@ -35,35 +41,9 @@ void printEigen(SPARC_OBJ *pSPARC);
  */
 void print_orbitals(SPARC_OBJ *pSPARC);
 
-/**
- * @brief   Print real Kohn-Sham orbitals
- */
-void print_orbital_real(
-    double *x, int *gridsizes, int *DMVertices, double dV, int Nspinor,
-    char *fname, int spin_index, int kpt_index, double *kpt_vec, int band_index, MPI_Comm comm
-);
-
-/**
- * @brief   Print complex Kohn-Sham orbitals
- */
-void print_orbital_complex(
-    double _Complex *x, int *gridsizes, int *DMVertices, double dV, int Nspinor,
-    char *fname, int spin_index, int kpt_index, double *kpt_vec, int band_index, MPI_Comm comm
-);
-
 /**
  * @brief   Print Energy density
  */
 void printEnergyDensity(SPARC_OBJ *pSPARC);
 
-/**
- * @brief   Gather Energy Density from dmcomm
- */
-void GatherEnergyDensity_dmcomm(SPARC_OBJ *pSPARC, double *rho_send, double *rho_recv);
-
-/**
- * @brief   Gather Energy Density from dmcomm_phi
- */
-void GatherEnergyDensity_dmcomm_phi(SPARC_OBJ *pSPARC, double *rho_send, double *rho_recv);
-
 #endif // PRINTING_H
\ No newline at end of file
@@ -12,6 +12,7 @@
 #ifndef READFILES_H
 #define READFILES_H
 
+#include <stdio.h>
 #include "isddft.h"
 
 /**
@@ -52,6 +53,17 @@ void read_ion(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC);
 void read_pseudopotential_PSP(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC);
 
 
+/**
+ * @brief Read the header of a cube file, including the atom lines. The file
+ * is left at the first value of the data.
+ * 
+ * @param dens_fp Cube file opened for reading.
+ * @param dens_gridsizes (OUTPUT) Grid sizes (in 3-dim) of the density.
+ * @param dens_latvecs (OUTPUT) Lattice vectors (scaled).
+ */
+void readDens_cube_header(FILE *dens_fp, int dens_gridsizes[3], double dens_latvecs[9]);
+
+
 /**
  * @brief Read density in cube format.
  * 
@@ -63,6 +75,18 @@ void read_pseudopotential_PSP(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC);
 double* readDens_cube(char *filename, int dens_gridsizes[3], double dens_latvecs[9]);
 
 
+/**
+ * @brief Double-check if the given scaled latvecs are equiv. to the
+ * latvecs and the given scale factors.
+ * 
+ * @return int 0 - success, 1 - fail.
+ */
+int check_lattice(
+    const double latvecs_scaled[9], const double latvec[9],
+    const double scalex, const double scaley, const double scalez,
+    double tol);
+
+
 /**
  * @brief Read data from cube file and check if the lattice vectors
  * and the grid sizes match with the input lattice and grid.
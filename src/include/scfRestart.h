@@ -0,0 +1,38 @@
+/**
+ * @file    scfRestart.h
+ * @brief   This file contains the function declarations for writing and reading
+ *          the SCF restart file (orbitals, eigenvalues, occupations and density).
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#ifndef SCFRESTART_H
+#define SCFRESTART_H
+
+#include "isddft.h"
+
+
+/**
+ * @brief   Write the converged orbitals, eigenvalues, occupations and electron
+ *          density into the binary SCF restart file.
+ *
+ *          All processes write their own part of the data directly with MPI-IO.
+ *          Grid vectors are stored in the global (natural) ordering, so the file
+ *          does not depend on the process grid used to write it.
+ */
+void write_restart_SCF(SPARC_OBJ *pSPARC);
+
+
+/**
+ * @brief   Read the SCF restart file and use it as the initial guess of the
+ *          first SCF (orbitals, eigenvalues, occupations and electron density).
+ *
+ *          The data are read directly into the current band/domain decomposition,
+ *          which may differ from the one used to write the file. If the file does
+ *          not exist or does not match the current system, nothing is changed.
+ *
+ * @return  1 if the initial guess was read, 0 otherwise.
+ */
+int read_restart_SCF(SPARC_OBJ *pSPARC);
+
+#endif // SCFRESTART_H
@@ -0,0 +1,55 @@
+/**
+ * @file    timing.h
+ * @brief   This file contains the function declarations for the per-phase
+ *          timing and counter report.
+ *
+ *          Named regions are opened and closed with timing_region_begin and
+ *          timing_region_end. Regions opened inside another region are nested
+ *          under it, so the same function called from different phases (e.g.
+ *          the Laplacian in CheFSI and in the Poisson solver) is reported
+ *          separately for each phase.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "isddft.h"
+
+
+/**
+ * @brief   Open the region called name inside the currently open region.
+ *
+ *          name must be a string that stays valid for the whole run (a string
+ *          literal).
+ */
+void timing_region_begin(const char *name);
+
+
+/**
+ * @brief   Close the innermost open region, which must have been opened with
+ *          the same name.
+ */
+void timing_region_end(const char *name);
+
+
+/**
+ * @brief   Add the bytes communicated and the floating point operations done
+ *          by this process to the innermost open region.
+ */
+void timing_add_counts(double bytes, double flops);
+
+
+/**
+ * @brief   Write the timings and counters collected since the last report into
+ *          the .timing file and reset them.
+ *
+ *          The time, number of calls, bytes and flops of each region are
+ *          reduced over all processes in MPI_COMM_WORLD (min/avg/max over the
+ *          processes that entered the region). This function has to be called
+ *          by all processes outside of any open region.
+ */
+void write_timing_report(SPARC_OBJ *pSPARC);
+
+#endif // TIMING_H
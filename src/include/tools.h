@@ -168,6 +168,29 @@ void SplineInterpUniform(
 
 
 
+/**
+ * @brief   Tabulate the cubic spline coefficients of all intervals of a
+ *          uniform grid.
+ *
+ *          tab has size 4*(len1-1), tab[4*j..4*j+3] stores the coefficients
+ *          A0, A1, A2, A3 of the cubic polynomial in interval (X1[j],X1[j+1]).
+ */
+void SplineTableUniform(double *X1, double *Y1, int len1, double *YD, double *tab);
+
+
+
+/**
+ * @brief   Cubic spline evaluation from a coefficient table of a uniform grid.
+ *
+ *          Gives the same result as SplineInterpUniform with the same Y1 and YD,
+ *          but only does a table lookup per point, so that the loop vectorizes.
+ */
+void SplineInterpUniformTable(
+    const double *X1, int len1, const double *tab, const double *X2, double *Y2, int len2
+);
+
+
+
 /**
  * @brief   Cubic spline evaluation from precalculated data. This function
  *          assumes X1 is a monotically increasing grid (but not necessarily
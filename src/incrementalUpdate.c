@@ -0,0 +1,270 @@
+/**
+ * @file    incrementalUpdate.c
+ * @brief   This file contains the functions for the incremental update of the
+ *          atom-centered quantities across relax/MD steps.
+ *
+ *          At the end of each step the atom influence lists and the nonlocal
+ *          projectors are kept instead of freed. In the next step, the image
+ *          atoms of the atoms that did not move are identical to the ones of the
+ *          last step, so their rc-domain index sets and projectors are taken
+ *          over, and their pseudocharges are left in b, b_ref and Vc. Only the
+ *          contributions of the atoms that moved are removed and rebuilt.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <complex.h>
+#include <mpi.h>
+
+#include "incrementalUpdate.h"
+#include "initialization.h"
+#include "isddft.h"
+#include "mixedPrecisionFilter.h"
+
+
+/**
+ * @brief   Free an atom influence list (local pseudopotential).
+ */
+static void free_atom_influence(ATOM_INFLUENCE_OBJ *Atom_Influence, int Ntypes)
+{
+    if (Atom_Influence == NULL) return;
+    for (int ityp = 0; ityp < Ntypes; ityp++) {
+        free(Atom_Influence[ityp].coords);
+        free(Atom_Influence[ityp].atom_spin);
+        free(Atom_Influence[ityp].atom_index);
+        free(Atom_Influence[ityp].xs);
+        free(Atom_Influence[ityp].xe);
+        free(Atom_Influence[ityp].ys);
+        free(Atom_Influence[ityp].ye);
+        free(Atom_Influence[ityp].zs);
+        free(Atom_Influence[ityp].ze);
+    }
+    free(Atom_Influence);
+}
+
+
+/**
+ * @brief   Free an atom influence list (nonlocal pseudopotential). Entries of
+ *          grid_pos that have been taken over are NULL.
+ */
+static void free_atom_nloc_influence(ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, int Ntypes)
+{
+    if (Atom_Influence_nloc == NULL) return;
+    for (int ityp = 0; ityp < Ntypes; ityp++) {
+        if (Atom_Influence_nloc[ityp].n_atom == 0) continue;
+        free(Atom_Influence_nloc[ityp].coords);
+        free(Atom_Influence_nloc[ityp].atom_index);
+        free(Atom_Influence_nloc[ityp].xs);
+        free(Atom_Influence_nloc[ityp].xe);
+        free(Atom_Influence_nloc[ityp].ys);
+        free(Atom_Influence_nloc[ityp].ye);
+        free(Atom_Influence_nloc[ityp].zs);
+        free(Atom_Influence_nloc[ityp].ze);
+        free(Atom_Influence_nloc[ityp].ndc);
+        for (int iat = 0; iat < Atom_Influence_nloc[ityp].n_atom; iat++) {
+            free(Atom_Influence_nloc[ityp].grid_pos[iat]);
+        }
+        free(Atom_Influence_nloc[ityp].grid_pos);
+    }
+    free(Atom_Influence_nloc);
+}
+
+
+/**
+ * @brief   Free nonlocal projectors. Projectors that have been taken over are NULL.
+ */
+static void free_nloc_proj(NLOC_PROJ_OBJ *nlocProj, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc,
+    int Ntypes, int isGammaPoint)
+{
+    if (nlocProj == NULL) return;
+    Free_NonlocalProjectors_sp(nlocProj, Atom_Influence_nloc, Ntypes);
+    for (int ityp = 0; ityp < Ntypes; ityp++) {
+        if (nlocProj[ityp].nproj) {
+            for (int iat = 0; iat < Atom_Influence_nloc[ityp].n_atom; iat++) {
+                if (isGammaPoint) free(nlocProj[ityp].Chi[iat]);
+                else free(nlocProj[ityp].Chi_c[iat]);
+            }
+        }
+        if (isGammaPoint) free(nlocProj[ityp].Chi);
+        else free(nlocProj[ityp].Chi_c);
+    }
+    free(nlocProj);
+}
+
+
+/**
+ * @brief   Free the quantities kept from the last step.
+ */
+static void free_prev(SPARC_OBJ *pSPARC)
+{
+    free_atom_influence(pSPARC->Atom_Influence_local_prev, pSPARC->Ntypes);
+    free_nloc_proj(pSPARC->nlocProj_prev, pSPARC->Atom_Influence_nloc_prev, pSPARC->Ntypes, pSPARC->isGammaPoint);
+    free_nloc_proj(pSPARC->nlocProj_kptcomm_prev, pSPARC->Atom_Influence_nloc_kptcomm_prev, pSPARC->Ntypes, pSPARC->isGammaPoint);
+    free_atom_nloc_influence(pSPARC->Atom_Influence_nloc_prev, pSPARC->Ntypes);
+    free_atom_nloc_influence(pSPARC->Atom_Influence_nloc_kptcomm_prev, pSPARC->Ntypes);
+    pSPARC->Atom_Influence_local_prev = NULL;
+    pSPARC->nlocProj_prev = NULL;
+    pSPARC->nlocProj_kptcomm_prev = NULL;
+    pSPARC->Atom_Influence_nloc_prev = NULL;
+    pSPARC->Atom_Influence_nloc_kptcomm_prev = NULL;
+}
+
+
+
+/**
+ * @brief   Find the atoms that have to be rebuilt in this step.
+ */
+void IncrementalUpdate_begin(SPARC_OBJ *pSPARC)
+{
+    if (pSPARC->IncrUpdateFlag == 0) return;
+
+    int n_atom = pSPARC->n_atom;
+    double cell[6] = {pSPARC->delta_x, pSPARC->delta_y, pSPARC->delta_z,
+                      pSPARC->range_x, pSPARC->range_y, pSPARC->range_z};
+    int rebuild_all = 0;
+    if (pSPARC->atom_pos_ref == NULL) {
+        pSPARC->atom_pos_ref = (double *)malloc(3 * n_atom * sizeof(double));
+        pSPARC->atom_moved = (int *)malloc(n_atom * sizeof(int));
+        assert(pSPARC->atom_pos_ref != NULL && pSPARC->atom_moved != NULL);
+        rebuild_all = 1;
+    } else if (memcmp(cell, pSPARC->IncrUpdateCell, sizeof(cell)) != 0) {
+        // the grid has changed (NPT or cell relaxation), nothing can be reused
+        free_prev(pSPARC);
+        rebuild_all = 1;
+    }
+    memcpy(pSPARC->IncrUpdateCell, cell, sizeof(cell));
+
+    pSPARC->n_atom_moved = 0;
+    for (int i = 0; i < n_atom; i++) {
+        int moved = rebuild_all;
+        if (!moved) {
+            double dx = pSPARC->atom_pos[3*i  ] - pSPARC->atom_pos_ref[3*i  ];
+            double dy = pSPARC->atom_pos[3*i+1] - pSPARC->atom_pos_ref[3*i+1];
+            double dz = pSPARC->atom_pos[3*i+2] - pSPARC->atom_pos_ref[3*i+2];
+            if (pSPARC->cell_typ != 0) nonCart2Cart_coord(pSPARC, &dx, &dy, &dz);
+            moved = sqrt(dx*dx + dy*dy + dz*dz) > pSPARC->IncrUpdateTol;
+        }
+        if (moved) {
+            pSPARC->atom_pos_ref[3*i  ] = pSPARC->atom_pos[3*i  ];
+            pSPARC->atom_pos_ref[3*i+1] = pSPARC->atom_pos[3*i+1];
+            pSPARC->atom_pos_ref[3*i+2] = pSPARC->atom_pos[3*i+2];
+            pSPARC->n_atom_moved++;
+        }
+        pSPARC->atom_moved[i] = moved;
+    }
+
+#ifdef DEBUG
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) printf("Incremental update: %d of %d atoms are rebuilt\n", pSPARC->n_atom_moved, n_atom);
+#endif
+}
+
+
+
+/**
+ * @brief   Free what is left of the quantities of the last step.
+ */
+void IncrementalUpdate_end(SPARC_OBJ *pSPARC)
+{
+    if (pSPARC->IncrUpdateFlag == 0) return;
+    free_prev(pSPARC);
+}
+
+
+
+/**
+ * @brief   Keep the atom influence lists and projectors of this step for the
+ *          next step instead of freeing them.
+ */
+int IncrementalUpdate_store(SPARC_OBJ *pSPARC)
+{
+    if (pSPARC->IncrUpdateFlag == 0) return 0;
+    free_prev(pSPARC);
+    if (pSPARC->dmcomm_phi != MPI_COMM_NULL) {
+        pSPARC->Atom_Influence_local_prev = pSPARC->Atom_Influence_local;
+        pSPARC->Atom_Influence_local = NULL;
+    }
+    if (pSPARC->dmcomm != MPI_COMM_NULL && pSPARC->bandcomm_index >= 0) {
+        pSPARC->Atom_Influence_nloc_prev = pSPARC->Atom_Influence_nloc;
+        pSPARC->nlocProj_prev = pSPARC->nlocProj;
+        pSPARC->Atom_Influence_nloc = NULL;
+        pSPARC->nlocProj = NULL;
+    }
+    if (pSPARC->kptcomm_topo != MPI_COMM_NULL && pSPARC->kptcomm_index >= 0) {
+        pSPARC->Atom_Influence_nloc_kptcomm_prev = pSPARC->Atom_Influence_nloc_kptcomm;
+        pSPARC->nlocProj_kptcomm_prev = pSPARC->nlocProj_kptcomm;
+        pSPARC->Atom_Influence_nloc_kptcomm = NULL;
+        pSPARC->nlocProj_kptcomm = NULL;
+    }
+    return 1;
+}
+
+
+
+/**
+ * @brief   Free all memory of the incremental update.
+ */
+void IncrementalUpdate_free(SPARC_OBJ *pSPARC)
+{
+    free_prev(pSPARC);
+    free(pSPARC->atom_pos_ref);
+    free(pSPARC->atom_moved);
+    pSPARC->atom_pos_ref = NULL;
+    pSPARC->atom_moved = NULL;
+}
+
+
+
+/**
+ * @brief   Find the image atom of the last step that can be reused for an
+ *          image atom of this step.
+ */
+int IncrementalUpdate_find_image(
+    const SPARC_OBJ *pSPARC, const int n_prev, const int *atom_index_prev,
+    const double *coords_prev, const int atom_index, const double *coords, int *cursor
+)
+{
+    if (pSPARC->atom_moved[atom_index]) return -1;
+    int j = *cursor;
+    while (j < n_prev && atom_index_prev[j] < atom_index) j++;
+    *cursor = j;
+    for (; j < n_prev && atom_index_prev[j] == atom_index; j++) {
+        if (coords_prev[3*j  ] == coords[0] &&
+            coords_prev[3*j+1] == coords[1] &&
+            coords_prev[3*j+2] == coords[2])
+            return j;
+    }
+    return -1;
+}
+
+
+
+/**
+ * @brief   Atom influence list of the last step for the nonlocal domain of comm.
+ */
+ATOM_NLOC_INFLUENCE_OBJ *IncrementalUpdate_nloc_prev(const SPARC_OBJ *pSPARC, MPI_Comm comm)
+{
+    if (pSPARC->IncrUpdateFlag == 0 || comm == MPI_COMM_NULL) return NULL;
+    if (comm == pSPARC->dmcomm) return pSPARC->Atom_Influence_nloc_prev;
+    if (comm == pSPARC->kptcomm_topo) return pSPARC->Atom_Influence_nloc_kptcomm_prev;
+    return NULL;
+}
+
+
+
+/**
+ * @brief   Nonlocal projectors of the last step for comm.
+ */
+NLOC_PROJ_OBJ *IncrementalUpdate_proj_prev(const SPARC_OBJ *pSPARC, MPI_Comm comm)
+{
+    if (pSPARC->IncrUpdateFlag == 0 || comm == MPI_COMM_NULL) return NULL;
+    if (comm == pSPARC->dmcomm) return pSPARC->nlocProj_prev;
+    if (comm == pSPARC->kptcomm_topo) return pSPARC->nlocProj_kptcomm_prev;
+    return NULL;
+}
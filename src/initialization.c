@@ -19,6 +19,9 @@
 #include <mpi.h>
 #include <time.h>
 #include <assert.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 // this is for checking existence of files
 # include <unistd.h>
 #include "initialization.h"
@@ -29,6 +32,7 @@
 #include "eigenSolver.h" // Mesh2ChebDegree, init_GTM_CheFSI()
 #include "eigenSolverKpt.h"  // init_GTM_CheFSI_kpt()
 #include "parallelization.h"
+#include "paralAutotune.h" // PARAL_AUTOTUNE_MAXN
 #include "isddft.h"
 #include "d3initialization.h"
 #include "vdWDFinitialization.h"
@@ -45,7 +49,7 @@
 #define min(x,y) ((x)<(y)?(x):(y))
 #define max(x,y) ((x)>(y)?(x):(y))
 
-#define N_MEMBR 202
+#define N_MEMBR 222
 
 
 /**
@@ -339,6 +343,22 @@ void Initialize(SPARC_OBJ *pSPARC, int argc, char *argv[]) {
     // copy the data read from input files into struct SPARC
     SPARC_copy_input(pSPARC,&SPARC_Input);
 
+    // set number of OpenMP threads used by the grid kernels
+#ifdef _OPENMP
+    if (pSPARC->num_omp_threads <= 0)
+        pSPARC->num_omp_threads = getenv("OMP_NUM_THREADS") != NULL ? omp_get_max_threads() : 1;
+    // OpenMP regions need the MPI library to support at least MPI_THREAD_FUNNELED
+    int thread_level;
+    MPI_Query_thread(&thread_level);
+    if (pSPARC->num_omp_threads > 1 && thread_level < MPI_THREAD_FUNNELED) {
+        if (rank == 0) printf("WARNING: MPI library does not support MPI_THREAD_FUNNELED, NUM_OMP_THREADS is set to 1.\n");
+        pSPARC->num_omp_threads = 1;
+    }
+    omp_set_num_threads(pSPARC->num_omp_threads);
+#else
+    pSPARC->num_omp_threads = 1;
+#endif
+
 #ifdef DEBUG
     t2 = MPI_Wtime();
     if (rank == 0) printf("\nrank = %d, Copying data from SPARC_Input into SPARC & set up subcomm took %.3f ms\n",rank,(t2-t1)*1000);
@@ -376,6 +396,14 @@ void Initialize(SPARC_OBJ *pSPARC, int argc, char *argv[]) {
         }
         #endif
 
+        // the CS mode is only implemented in the serial subspace eigensolver, which
+        // is kept up to max(EIG_SERIAL_MAXNS, CS_SERIAL_MAXNS) states in this mode
+        if (pSPARC->CSFlag == 1 && pSPARC->useLAPACK == 0) {
+            if (rank == 0)
+                printf("WARNING: CS_FLAG needs NSTATES <= max(EIG_SERIAL_MAXNS, %d) (serial subspace eigensolver), it is turned off.\n", CS_SERIAL_MAXNS);
+            pSPARC->CSFlag = 0;
+        }
+
         pSPARC->DP_CheFSI     = NULL;
         pSPARC->DP_CheFSI_kpt = NULL;
         if (pSPARC->isGammaPoint) init_DP_CheFSI(pSPARC);
@@ -567,6 +595,8 @@ void set_defaults(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
     pSPARC_Input->npNdx_phi = 0;      // number of processes for calculating phi in paral. over domain in x-dir
     pSPARC_Input->npNdy_phi = 0;      // number of processes for calculating phi in paral. over domain in y-dir
     pSPARC_Input->npNdz_phi = 0;      // number of processes for calculating phi in paral. over domain in z-dir
+    pSPARC_Input->num_omp_threads = 0; // number of OpenMP threads per process, 0 means OMP_NUM_THREADS if set, otherwise 1
+    pSPARC_Input->paral_autotune = 0;  // default: do not time the default parallelization
     pSPARC_Input->eig_serial_maxns = 1500; // maximum Nstates for solving the subspace eigenproblem in serial by default,
                                       // for Nstates greater than this value, a parallel methods will be used instead, unless 
                                       // ScaLAPACK is not compiled or useLAPACK is turned off.
@@ -584,11 +614,15 @@ void set_defaults(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
     strncpy(pSPARC_Input->RelaxMeth,"LBFGS",sizeof(pSPARC_Input->RelaxMeth));   // default relax method: LBFGS
 
     pSPARC_Input->RestartFlag = 0;            // default: no retart
+    pSPARC_Input->IncrUpdateFlag = 0;         // default: rebuild pseudocharges and projectors of all atoms in every step
+    pSPARC_Input->OrbExtrapFlag = 0;          // default: orbitals of the last step are the initial guess of the next step
+    pSPARC_Input->IncrUpdateTol = 0.0;        // default: only atoms that did not move at all are reused
     /* default finite difference scheme info. */
     pSPARC_Input->order = 12;                 // default FD order: 12th
 
     /* default poisson solver */
     pSPARC_Input->Poisson_solver = 0;          // default AAR solver
+    pSPARC_Input->Poisson_precond = 0;         // default Jacobi preconditioner for the Poisson solver
     /* Iterations: tolerances and max_iters */
     pSPARC_Input->FixRandSeed = 0;            // default flag for fixing random numbers for MPI paralllelization
     pSPARC_Input->accuracy_level = -1;        // default accuracy level (2 - 'medium', 1e-3 in energy and forces)    
@@ -602,6 +636,7 @@ void set_defaults(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
     pSPARC_Input->TOL_RELAX = 5e-4;           // default Relaxation tolerance
     pSPARC_Input->TOL_POISSON = -1.0;         // default Poisson solve tolerance (will be set up later)
     pSPARC_Input->TOL_LANCZOS = 1e-2;         // default Lanczos tolerance
+    pSPARC_Input->TOL_CheFSI_MixedPrec = 1e-3;// default SCF error below which filtering is done in double precision
     pSPARC_Input->TOL_PSEUDOCHARGE = -1.0;    // default tolerance for calculating pseudocharge density radius (will be set up later)
     pSPARC_Input->TOL_PRECOND = -1.0;         // default Kerker tolerance will be set up later, depending on the mesh size
     pSPARC_Input->precond_kerker_kTF = 1.0;    // Thomas-Fermi screening length in the Kerker preconditioner
@@ -677,6 +712,9 @@ void set_defaults(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
     /* default Chebyshev filter */
     pSPARC_Input->ChebDegree = -1;            // default chebyshev polynomial degree (will be automatically found based on spectral width)
     pSPARC_Input->CheFSI_Optmz = 0;           // default is off
+    pSPARC_Input->CheFSI_MixedPrec = 0;       // default is off
+    pSPARC_Input->CSFlag = 0;                 // default is off, all eigenpairs of the projected problem are computed
+    pSPARC_Input->CS_Ntop = -1;               // default number of top states in the complementary subspace mode (set later)
     pSPARC_Input->chefsibound_flag = 0;       // default is to find bound using Lanczos on H in the first SCF of each MD/Relax only
     pSPARC_Input->rhoTrigger = -1;            // default step to start updating electron density, later will be subtracted by 1
     pSPARC_Input->Nchefsi = 1;                // default to do only 1 ChefSi each scf 
@@ -744,14 +782,17 @@ void set_defaults(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
     pSPARC_Input->PrintAtomVelFlag = 1;       // flag for printing atom velocities in case of MD/relax
     pSPARC_Input->PrintElecDensFlag = 0;      // flag for printing final electron density
     pSPARC_Input->PrintEigenFlag = 0;         // Flag for printing final eigenvalues and occupations
+    pSPARC_Input->PrintTimingFlag = 0;        // Flag for writing the per-phase timing report
     pSPARC_Input->PrintMDout = 1;             // Flag for printing MD output in a .aimd file
     pSPARC_Input->PrintRelaxout = 1;          // Flag for printing relax output in a .relax file
     pSPARC_Input->Printrestart = 1;           // Flag for printing output needed for restarting a simulation
     pSPARC_Input->Printrestart_fq = 1;        // Steps after which the output is written in the restart file
+    pSPARC_Input->Printrestart_scf = 0;       // Flag for writing orbitals and density for restarting the SCF
     pSPARC_Input->PrintPsiFlag[0] = 0;        // Flag for printing Kohn-Sham orbitals
     for (int i = 1; i < 7; i++) 
         pSPARC_Input->PrintPsiFlag[i] = -1;   // defualt spin, kpt, band start and end index for printing psi
     pSPARC_Input->PrintEnergyDensFlag = 0;    // flag for printing kinetic energy density
+    pSPARC_Input->PrintDensFormat = 0;        // format of the density files, 0 - cube, 1 - binary, 2 - both
     
     /* Default pSPARC members */
     pSPARC->is_default_psd = 0;               // default pseudopotential path is disabled
@@ -772,14 +813,18 @@ void set_defaults(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
     pSPARC_Input->EXXDownsampling[1] = 1;     // default setting for downsampling, using full k-points
     pSPARC_Input->EXXDownsampling[2] = 1;     // default setting for downsampling, using full k-points
     pSPARC_Input->EXXDiv_Flag = -1;           // default setting for singularity in exact exchange, default spherical trucation    
+    pSPARC_Input->ISDFFlag = 0;               // default is off, exact exchange with all pairs of orbitals
+    pSPARC_Input->EXXISDF_ratio = 8.0;        // default number of ISDF points is 8 times the number of occupied states
     pSPARC_Input->hyb_range_fock = 0.1587;    // default using VASP's HSE03 value
     pSPARC_Input->hyb_range_pbe = 0.1587;     // default using VASP's HSE03 value
+    pSPARC_Input->exx_sr_table_tol = 0.0;     // default: evaluate HSE short-range enhancement factor analytically
     pSPARC_Input->exx_frac = -1;              // default exx_frac
 
     /* Default SQ method option */
     pSPARC_Input->SQFlag = 0;
     pSPARC_Input->SQ_gauss_mem = 0;             // default not saving Lanczos vectors and eigenvectors 
     pSPARC_Input->SQ_npl_g = -1;    
+    pSPARC_Input->SQ_block_size = 1;            // default Lanczos for one FD node at a time
     pSPARC_Input->SQ_rcut = -1;
     pSPARC_Input->SQ_tol_occ = 1e-6;
     pSPARC_Input->npNdx_SQ = 0;
@@ -803,6 +848,7 @@ void set_defaults(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
     pSPARC_Input->n_train_max_mlff=5000;
     pSPARC_Input->mlff_flag=0;
     pSPARC_Input->rcut_SOAP=10.0;
+    pSPARC_Input->nlist_skin_MLFF=0.0;
     pSPARC_Input->sigma_atom_SOAP=1.0;
     pSPARC_Input->kernel_typ_MLFF=0;
     pSPARC_Input->descriptor_typ_MLFF=0;
@@ -818,6 +864,8 @@ void set_defaults(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
     pSPARC_Input->stress_rel_scale[4]=1.0;
     pSPARC_Input->stress_rel_scale[5]=1.0;
     pSPARC_Input->MLFF_DFT_fq=100000000;
+    pSPARC_Input->hyper_nstr_MLFF=10;
+    pSPARC_Input->hyper_tol_MLFF=0.05;
     pSPARC_Input->mlff_internal_energy_flag  = 0;
     pSPARC_Input->mlff_pressure_train_flag  = 0;
     pSPARC_Input->N_rgrid_MLFF  = 100;
@@ -1197,6 +1245,7 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
     pSPARC->n_str_max_mlff = pSPARC_Input->n_str_max_mlff;
     pSPARC->n_train_max_mlff = pSPARC_Input->n_train_max_mlff;
     pSPARC->rcut_SOAP = pSPARC_Input->rcut_SOAP;
+    pSPARC->nlist_skin_MLFF = pSPARC_Input->nlist_skin_MLFF;
     pSPARC->sigma_atom_SOAP = pSPARC_Input->sigma_atom_SOAP;
     pSPARC->kernel_typ_MLFF = pSPARC_Input->kernel_typ_MLFF;
     pSPARC->descriptor_typ_MLFF = pSPARC_Input->descriptor_typ_MLFF;
@@ -1218,6 +1267,8 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
     pSPARC->stress_rel_scale[4] = pSPARC_Input->stress_rel_scale[4];
     pSPARC->stress_rel_scale[5] = pSPARC_Input->stress_rel_scale[5];
     pSPARC->MLFF_DFT_fq = pSPARC_Input->MLFF_DFT_fq;
+    pSPARC->hyper_nstr_MLFF = pSPARC_Input->hyper_nstr_MLFF;
+    pSPARC->hyper_tol_MLFF = pSPARC_Input->hyper_tol_MLFF;
     // MLFF end
 
     pSPARC->num_node = pSPARC_Input->num_node;
@@ -1232,11 +1283,25 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
     pSPARC->npNdx_phi = pSPARC_Input->npNdx_phi;
     pSPARC->npNdy_phi = pSPARC_Input->npNdy_phi;
     pSPARC->npNdz_phi = pSPARC_Input->npNdz_phi;
+    pSPARC->num_omp_threads = pSPARC_Input->num_omp_threads;
+    pSPARC->paral_autotune = pSPARC_Input->paral_autotune;
+    if (pSPARC->paral_autotune < 0 || pSPARC->paral_autotune > PARAL_AUTOTUNE_MAXN) {
+        if (!rank)
+            printf(RED "ERROR: PARAL_AUTOTUNE must be between 0 and %d.\n" RESET, PARAL_AUTOTUNE_MAXN);
+        exit(EXIT_FAILURE);
+    }
     pSPARC->eig_serial_maxns = pSPARC_Input->eig_serial_maxns;
     pSPARC->eig_paral_blksz = pSPARC_Input->eig_paral_blksz;
     pSPARC->spin_typ = pSPARC_Input->spin_typ;
     pSPARC->MDFlag = pSPARC_Input->MDFlag;
     pSPARC->RelaxFlag = pSPARC_Input->RelaxFlag;
+    pSPARC->IncrUpdateFlag = pSPARC_Input->IncrUpdateFlag;
+    pSPARC->OrbExtrapFlag = pSPARC_Input->OrbExtrapFlag;
+    pSPARC->OrbExtrapCount = 0;
+    pSPARC->OrbExtrapStep = 0;
+    pSPARC->Xorb_1dt = pSPARC->Xorb_2dt = NULL;
+    pSPARC->Xorb_kpt_1dt = pSPARC->Xorb_kpt_2dt = NULL;
+    pSPARC->IncrUpdateTol = pSPARC_Input->IncrUpdateTol;
     pSPARC->RestartFlag = pSPARC_Input->RestartFlag;
     pSPARC->Flag_latvec_scale = pSPARC_Input->Flag_latvec_scale;
     pSPARC->numIntervals_x = pSPARC_Input->numIntervals_x;
@@ -1252,6 +1317,12 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
     pSPARC->order = pSPARC_Input->order;
     pSPARC->ChebDegree = pSPARC_Input->ChebDegree;
     pSPARC->CheFSI_Optmz = pSPARC_Input->CheFSI_Optmz;
+    pSPARC->CheFSI_MixedPrec = pSPARC_Input->CheFSI_MixedPrec;
+    pSPARC->CSFlag = pSPARC_Input->CSFlag;
+    pSPARC->CS_Ntop = pSPARC_Input->CS_Ntop;
+    pSPARC->CS_warned = 0;
+    pSPARC->TOL_CheFSI_MixedPrec = pSPARC_Input->TOL_CheFSI_MixedPrec;
+    pSPARC->CheFSI_UseSP = 0;
     pSPARC->chefsibound_flag = pSPARC_Input->chefsibound_flag;
     pSPARC->rhoTrigger = pSPARC_Input->rhoTrigger;
     pSPARC->Nchefsi = pSPARC_Input->Nchefsi;
@@ -1279,11 +1350,14 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
     pSPARC->PrintAtomPosFlag = pSPARC_Input->PrintAtomPosFlag;
     pSPARC->PrintAtomVelFlag = pSPARC_Input->PrintAtomVelFlag;
     pSPARC->PrintEigenFlag = pSPARC_Input->PrintEigenFlag;
+    pSPARC->PrintTimingFlag = pSPARC_Input->PrintTimingFlag;
     pSPARC->PrintElecDensFlag = pSPARC_Input->PrintElecDensFlag;
     pSPARC->PrintMDout = pSPARC_Input->PrintMDout;
     pSPARC->PrintRelaxout = pSPARC_Input->PrintRelaxout;
     pSPARC->Printrestart = pSPARC_Input->Printrestart;
     pSPARC->Printrestart_fq = pSPARC_Input->Printrestart_fq;
+    pSPARC->Printrestart_scf = pSPARC_Input->Printrestart_scf;
+    pSPARC->SCFRestartRead = 0;
     pSPARC->elec_T_type = pSPARC_Input->elec_T_type;
     pSPARC->MD_Nstep = pSPARC_Input->MD_Nstep;
     pSPARC->NPTscaleVecs[0] = pSPARC_Input->NPTscaleVecs[0];
@@ -1298,6 +1372,7 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
     pSPARC->L_autoscale = pSPARC_Input->L_autoscale;
     pSPARC->L_lineopt = pSPARC_Input->L_lineopt;
     pSPARC->Calc_stress = pSPARC_Input->Calc_stress;
+    pSPARC->nlocStressReady = 0;
     pSPARC->Calc_pres = pSPARC_Input->Calc_pres;
     pSPARC->d3Flag = pSPARC_Input->d3Flag;
     pSPARC->MAXIT_FOCK = pSPARC_Input->MAXIT_FOCK;
@@ -1306,6 +1381,8 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
     pSPARC->EXXMem_batch = pSPARC_Input->EXXMem_batch;
     pSPARC->EXXACEVal_state = pSPARC_Input->EXXACEVal_state;
     pSPARC->EXXDiv_Flag = pSPARC_Input->EXXDiv_Flag;
+    pSPARC->ISDFFlag = pSPARC_Input->ISDFFlag;
+    pSPARC->EXXISDF_ratio = pSPARC_Input->EXXISDF_ratio;
     pSPARC->EXXDownsampling[0] = pSPARC_Input->EXXDownsampling[0];
     pSPARC->EXXDownsampling[1] = pSPARC_Input->EXXDownsampling[1];
     pSPARC->EXXDownsampling[2] = pSPARC_Input->EXXDownsampling[2];
@@ -1313,12 +1390,14 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
     pSPARC->SQFlag = pSPARC_Input->SQFlag;
     pSPARC->SQ_gauss_mem = pSPARC_Input->SQ_gauss_mem;
     pSPARC->SQ_npl_g = pSPARC_Input->SQ_npl_g;
+    pSPARC->SQ_block_size = pSPARC_Input->SQ_block_size;
     pSPARC->npNdx_SQ = pSPARC_Input->npNdx_SQ;
     pSPARC->npNdy_SQ = pSPARC_Input->npNdy_SQ;
     pSPARC->npNdz_SQ = pSPARC_Input->npNdz_SQ;
     for (i = 0; i < 7; i++)
         pSPARC->PrintPsiFlag[i] = pSPARC_Input->PrintPsiFlag[i];
     pSPARC->PrintEnergyDensFlag = pSPARC_Input->PrintEnergyDensFlag;
+    pSPARC->PrintDensFormat = pSPARC_Input->PrintDensFormat;
     pSPARC->StandardEigenFlag = pSPARC_Input->StandardEigenFlag;
     pSPARC->BandStructFlag = pSPARC_Input->BandStructFlag;
     pSPARC->n_kpt_line = pSPARC_Input->n_kpt_line;
@@ -1359,12 +1438,28 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
     pSPARC->TOL_PSEUDOCHARGE = pSPARC_Input->TOL_PSEUDOCHARGE;
     pSPARC->TOL_PRECOND = pSPARC_Input->TOL_PRECOND;
     pSPARC->POISSON_SOLVER = pSPARC_Input->Poisson_solver;
+    pSPARC->POISSON_PRECOND = pSPARC_Input->Poisson_precond;
+    pSPARC->MG_nlevels = 0;
+    pSPARC->MG_levels = NULL;
     pSPARC->precond_kerker_kTF = pSPARC_Input->precond_kerker_kTF;
     pSPARC->precond_kerker_thresh = pSPARC_Input->precond_kerker_thresh;
     pSPARC->precond_kerker_kTF_mag = pSPARC_Input->precond_kerker_kTF_mag;
     pSPARC->precond_kerker_thresh_mag = pSPARC_Input->precond_kerker_thresh_mag;
     pSPARC->precond_resta_q0 = pSPARC_Input->precond_resta_q0;
     pSPARC->precond_resta_Rs = pSPARC_Input->precond_resta_Rs;
+    pSPARC->PrecondFFT = NULL;
+    pSPARC->PrecondFFT_lap = NULL;
+    pSPARC->atom_pos_ref = NULL;
+    pSPARC->atom_moved = NULL;
+    pSPARC->n_atom_moved = 0;
+    pSPARC->Atom_Influence_local_prev = NULL;
+    pSPARC->Atom_Influence_nloc_prev = NULL;
+    pSPARC->Atom_Influence_nloc_kptcomm_prev = NULL;
+    pSPARC->nlocProj_prev = NULL;
+    pSPARC->nlocProj_kptcomm_prev = NULL;
+    pSPARC->Vnl_work = NULL;
+    pSPARC->Vnl_work_len = 0;
+    pSPARC->Vnl_work_ip = 0;
     pSPARC->REFERENCE_CUTOFF = pSPARC_Input->REFERENCE_CUTOFF;
     pSPARC->Beta = pSPARC_Input->Beta;
     pSPARC->elec_T = pSPARC_Input->elec_T;
@@ -1401,6 +1496,9 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
     pSPARC->TOL_SCF_INIT = pSPARC_Input->TOL_SCF_INIT;
     pSPARC->hyb_range_fock = pSPARC_Input->hyb_range_fock;
     pSPARC->hyb_range_pbe = pSPARC_Input->hyb_range_pbe;
+    pSPARC->exx_sr_table_tol = pSPARC_Input->exx_sr_table_tol;
+    pSPARC->wpbe_tab_n = 0;
+    pSPARC->wpbe_tab = NULL;
     pSPARC->exx_frac = pSPARC_Input->exx_frac;
     pSPARC->SQ_rcut = pSPARC_Input->SQ_rcut;
     pSPARC->SQ_tol_occ = pSPARC_Input->SQ_tol_occ;
@@ -1543,11 +1641,21 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
         snprintf(pSPARC->StaticFilename,    L_STRING, "%s.static",     pSPARC->filename_out);
         snprintf(pSPARC->AtomFilename,      L_STRING, "%s.atom",      pSPARC->filename_out);
         snprintf(pSPARC->EigenFilename,     L_STRING, "%s.eigen",     pSPARC->filename_out);
+        if (snprintf(pSPARC->TimingFilename, L_STRING, "%s.timing", pSPARC->filename_out) >= L_STRING
+            && pSPARC->PrintTimingFlag == 1) {
+            printf(RED "ERROR: output file name is too long for the timing report!\n" RESET);
+            exit(EXIT_FAILURE);
+        }
         snprintf(pSPARC->MDFilename,        L_STRING, "%s.aimd",      pSPARC->filename_out);
         snprintf(pSPARC->RelaxFilename,     L_STRING, "%s.geopt",     pSPARC->filename_out);
         snprintf(pSPARC->restart_Filename,  L_STRING, "%s.restart",   pSPARC->filename_out);
         snprintf(pSPARC->restartC_Filename, L_STRING, "%s.restart-0", pSPARC->filename_out);
         snprintf(pSPARC->restartP_Filename, L_STRING, "%s.restart-1", pSPARC->filename_out);
+        if (snprintf(pSPARC->SCFRestartFilename, L_STRING, "%s.restart_scf", pSPARC->filename_out) >= L_STRING
+            && pSPARC->Printrestart_scf == 1) {
+            printf(RED "ERROR: output file name is too long for the SCF restart file!\n" RESET);
+            exit(EXIT_FAILURE);
+        }
         snprintf(pSPARC->DensTCubFilename,  L_STRING, "%s.dens",   pSPARC->filename_out);
         snprintf(pSPARC->DensUCubFilename,  L_STRING, "%s.densUp",    pSPARC->filename_out);
         snprintf(pSPARC->DensDCubFilename,  L_STRING, "%s.densDwn",   pSPARC->filename_out);
@@ -1601,6 +1709,12 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
             snprintf(pSPARC->AtomFilename,  L_STRING, "%s_%02d", tempchar, i);
             snprintf(tempchar, L_STRING, "%s", pSPARC->EigenFilename);
             snprintf(pSPARC->EigenFilename, L_STRING, "%s_%02d", tempchar, i);
+            snprintf(tempchar, L_STRING, "%s", pSPARC->TimingFilename);
+            if (snprintf(pSPARC->TimingFilename, L_STRING, "%s_%02d", tempchar, i) >= L_STRING
+                && pSPARC->PrintTimingFlag == 1) {
+                printf(RED "ERROR: output file name is too long for the timing report!\n" RESET);
+                exit(EXIT_FAILURE);
+            }
             snprintf(tempchar, L_STRING, "%s", pSPARC->MDFilename);
             snprintf(pSPARC->MDFilename,    L_STRING, "%s_%02d", tempchar, i);
             snprintf(tempchar, L_STRING, "%s", pSPARC->RelaxFilename);
@@ -1632,6 +1746,18 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
     }
     // Not only rank 0 printing orbitals
     MPI_Bcast(pSPARC->OrbitalsFilename, L_STRING, MPI_CHAR, 0, MPI_COMM_WORLD);
+    // density and energy density files are written collectively as well
+    MPI_Bcast(pSPARC->DensTCubFilename, L_STRING, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(pSPARC->DensUCubFilename, L_STRING, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(pSPARC->DensDCubFilename, L_STRING, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(pSPARC->KinEnDensTCubFilename, L_STRING, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(pSPARC->KinEnDensUCubFilename, L_STRING, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(pSPARC->KinEnDensDCubFilename, L_STRING, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(pSPARC->XcEnDensCubFilename, L_STRING, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(pSPARC->ExxEnDensTCubFilename, L_STRING, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(pSPARC->ExxEnDensUCubFilename, L_STRING, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(pSPARC->ExxEnDensDCubFilename, L_STRING, MPI_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Bcast(pSPARC->SCFRestartFilename, L_STRING, MPI_CHAR, 0, MPI_COMM_WORLD);
 
     // Initialize MD/relax variables
     pSPARC->RelaxCount = 0; // initialize current relaxation step
@@ -1648,6 +1774,11 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
         pSPARC->Printrestart = 0;   
     }
 
+    // SCF restart file is only used together with the MD/relax restart file, and not in SQ
+    if (pSPARC->Printrestart == 0 || pSPARC->SQFlag == 1 || (pSPARC->MDFlag == 0 && pSPARC->RelaxFlag == 0)) {
+        pSPARC->Printrestart_scf = 0;
+    }
+
     // Value of tol used in xc functional
     pSPARC->xc_rhotol = 1e-14;
     pSPARC->xc_magtol = 1e-8;
@@ -2560,10 +2691,27 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
         } else {
             pSPARC->EXXACEVal_state = 0;
         }
+
+        if (pSPARC->ISDFFlag == 1) {
+            if (pSPARC->isGammaPoint == 0) {
+                if (!rank)
+                    printf(RED "ERROR: EXX_ISDF_FLAG is only available for Gamma-point calculations.\n" RESET);
+                exit(EXIT_FAILURE);
+            } else if (pSPARC->ACEFlag == 1) {
+                if (!rank)
+                    printf(RED "ERROR: EXX_ISDF_FLAG is not available with ACE operator, please set ACE_FLAG: 0.\n" RESET);
+                exit(EXIT_FAILURE);
+            } else if (pSPARC->EXXISDF_ratio <= 0.0) {
+                if (!rank)
+                    printf(RED "ERROR: EXX_ISDF_RATIO must be positive.\n" RESET);
+                exit(EXIT_FAILURE);
+            }
+        }
     } else {
         pSPARC->ACEFlag = 0;
         pSPARC->EXXMem_batch = 0;
         pSPARC->EXXACEVal_state = 0;
+        pSPARC->ISDFFlag = 0;
     }
     
     if (pSPARC->SOC_Flag == 1) {
@@ -2590,6 +2738,55 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
         }
     }
 
+    if (pSPARC->IncrUpdateFlag == 1 && (pSPARC->SQFlag || pSPARC->CyclixFlag || pSPARC->SOC_Flag)) {
+        if (rank == 0)
+            printf("WARNING: INCREMENTAL_UPDATE is not supported with SQ, Cyclix or spin-orbit coupling, it is turned off.\n");
+        pSPARC->IncrUpdateFlag = 0;
+    }
+
+    if (pSPARC->OrbExtrapFlag == 1 && (pSPARC->SQFlag || pSPARC->CyclixFlag || pSPARC->mlff_flag > 0)) {
+        if (rank == 0)
+            printf("WARNING: ORBITAL_EXTRAPOLATION is not supported with SQ, Cyclix or MLFF, it is turned off.\n");
+        pSPARC->OrbExtrapFlag = 0;
+    }
+
+    // complementary subspace Rayleigh-Ritz, only implemented in the domain parallel
+    // subspace eigensolver for gamma-point calculations
+    if (pSPARC->CSFlag == 1) {
+    #ifndef USE_DP_SUBEIG
+        if (rank == 0)
+            printf(RED "ERROR: CS_FLAG needs SPARC to be compiled with USE_DP_SUBEIG = 1 in makefile!\n" RESET);
+        exit(EXIT_FAILURE);
+    #endif
+        if (!pSPARC->isGammaPoint || pSPARC->SQFlag || pSPARC->CyclixFlag) {
+            if (rank == 0)
+                printf("WARNING: CS_FLAG is not supported with k-points, SQ or Cyclix, it is turned off.\n");
+            pSPARC->CSFlag = 0;
+        }
+    }
+    if (pSPARC->CSFlag == 1) {
+        if (pSPARC->CS_Ntop < 0) {
+            // unoccupied states plus 10% of the occupied ones (at least 10) near the Fermi level
+            int Nocc = (pSPARC->Nelectron / 2) * pSPARC->Nspinor_eig;
+            pSPARC->CS_Ntop = pSPARC->Nstates - Nocc + max(10, Nocc / 10);
+        }
+        if (pSPARC->CS_Ntop >= pSPARC->Nstates) {
+            // nothing to save, solve the full projected problem
+            if (rank == 0)
+                printf("WARNING: CS_NTOP (%d) is not less than NSTATES, CS_FLAG is turned off.\n", pSPARC->CS_Ntop);
+            pSPARC->CSFlag = 0;
+        } else if (pSPARC->CS_Ntop < 1) {
+            if (rank == 0) printf("ERROR: CS_NTOP must be positive.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (pSPARC->CSFlag == 1 && pSPARC->PrintEigenFlag > 0) {
+        // only the top CS_NTOP eigenvalues are computed, the others are not printed
+        if (rank == 0)
+            printf(RED "ERROR: PRINT_EIGEN is not valid with CS_FLAG.\n" RESET);
+        exit(EXIT_FAILURE);
+    }
+
     // constraints on SQ
     if (pSPARC->SQFlag == 1) {
         if (pSPARC->BCx || pSPARC->BCy || pSPARC->BCz) {
@@ -2629,6 +2826,12 @@ void SPARC_copy_input(SPARC_OBJ *pSPARC, SPARC_INPUT_OBJ *pSPARC_Input) {
                 printf(RED "ERROR: SQ_NPL_G must be provided a positive integer when Gauss Quadrature method is turned on in SQ method.\n" RESET);
             exit(EXIT_FAILURE);
         }
+
+        if (pSPARC->SQ_block_size <= 0) {
+            if (!rank)
+                printf(RED "ERROR: SQ_BLOCK_SIZE must be a positive integer.\n" RESET);
+            exit(EXIT_FAILURE);
+        }
         
         if (pSPARC->PrintEigenFlag > 0) {
             if (!rank)
@@ -3241,6 +3444,37 @@ void Calculate_SplineDerivRadFun(SPARC_OBJ *pSPARC) {
                 lcount++; lcount2++;
             }
         }
+        // tabulate the spline coefficients for fast lookup on uniform radial grids
+        pSPARC->psd[ityp].SplineTabrVloc = NULL;
+        pSPARC->psd[ityp].SplineTabUdV = NULL;
+        pSPARC->psd[ityp].SplineTabIsoAtomDen = NULL;
+        pSPARC->psd[ityp].SplineTabRhoc = NULL;
+        if (pSPARC->psd[ityp].is_r_uniform == 1 && psd_len >= 2) {
+            int tab_len = 4 * (psd_len - 1);
+            pSPARC->psd[ityp].SplineTabrVloc = (double *)malloc(sizeof(double) * tab_len);
+            pSPARC->psd[ityp].SplineTabIsoAtomDen = (double *)malloc(sizeof(double) * tab_len);
+            pSPARC->psd[ityp].SplineTabRhoc = (double *)malloc(sizeof(double) * tab_len);
+            pSPARC->psd[ityp].SplineTabUdV = (double *)malloc(sizeof(double) * tab_len * max(ppl_sum,1));
+            assert(pSPARC->psd[ityp].SplineTabrVloc != NULL && pSPARC->psd[ityp].SplineTabIsoAtomDen != NULL &&
+                   pSPARC->psd[ityp].SplineTabRhoc != NULL && pSPARC->psd[ityp].SplineTabUdV != NULL);
+            SplineTableUniform(pSPARC->psd[ityp].RadialGrid, pSPARC->psd[ityp].rVloc, psd_len, 
+                               pSPARC->psd[ityp].SplinerVlocD, pSPARC->psd[ityp].SplineTabrVloc);
+            SplineTableUniform(pSPARC->psd[ityp].RadialGrid, pSPARC->psd[ityp].rhoIsoAtom, psd_len, 
+                               pSPARC->psd[ityp].SplineFitIsoAtomDen, pSPARC->psd[ityp].SplineTabIsoAtomDen);
+            SplineTableUniform(pSPARC->psd[ityp].RadialGrid, pSPARC->psd[ityp].rho_c_table, psd_len, 
+                               pSPARC->psd[ityp].SplineRhocD, pSPARC->psd[ityp].SplineTabRhoc);
+            for (l = lcount = lcount2 = 0; l <= pSPARC->psd[ityp].lmax; l++) {
+                if (l == lloc) {
+                    lcount2 += pSPARC->psd[ityp].ppl[l];
+                    continue;
+                }
+                for (np = 0; np < pSPARC->psd[ityp].ppl[l]; np++) {
+                    SplineTableUniform(pSPARC->psd[ityp].RadialGrid, pSPARC->psd[ityp].UdV+lcount2*psd_len, psd_len, 
+                                       pSPARC->psd[ityp].SplineFitUdV+lcount*psd_len, pSPARC->psd[ityp].SplineTabUdV+lcount*tab_len);
+                    lcount++; lcount2++;
+                }
+            }
+        }
         if (pSPARC->psd[ityp].pspsoc) {
             ppl_sum = 0;
             for (l = 1; l <= pSPARC->psd[ityp].lmax; l++) {
@@ -3530,11 +3764,14 @@ void write_output_init(SPARC_OBJ *pSPARC) {
     if (strcmpi(pSPARC->XC, "HSE") == 0) {
         fprintf(output_fp,"EXX_RANGE_FOCK: %.6f\n", pSPARC->hyb_range_fock);
         fprintf(output_fp,"EXX_RANGE_PBE: %.6f\n", pSPARC->hyb_range_pbe);
+        if (pSPARC->exx_sr_table_tol > 0.0)
+            fprintf(output_fp,"EXX_SR_TABLE_TOL: %.3E\n", pSPARC->exx_sr_table_tol);
     }
     if (pSPARC->SQFlag == 1) {
         fprintf(output_fp,"SQ_FLAG: %d\n", pSPARC->SQFlag);
         fprintf(output_fp,"SQ_RCUT: %.10g\n", pSPARC->SQ_rcut);
         fprintf(output_fp,"SQ_NPL_G: %d\n", pSPARC->SQ_npl_g);
+        fprintf(output_fp,"SQ_BLOCK_SIZE: %d\n", pSPARC->SQ_block_size);
         if (pSPARC->SQ_gauss_mem == 1) {
             fprintf(output_fp,"SQ_GAUSS_MEM: HIGH\n");
         } else {
@@ -3551,6 +3788,14 @@ void write_output_init(SPARC_OBJ *pSPARC) {
         if (pSPARC->CheFSI_Optmz == 1) {
             fprintf(output_fp,"CHEFSI_OPTMZ: %d\n",pSPARC->CheFSI_Optmz);
         }
+        if (pSPARC->CheFSI_MixedPrec == 1) {
+            fprintf(output_fp,"CHEFSI_MIXED_PREC: %d\n",pSPARC->CheFSI_MixedPrec);
+            fprintf(output_fp,"TOL_CHEFSI_MIXED_PREC: %.2E\n",pSPARC->TOL_CheFSI_MixedPrec);
+        }
+        if (pSPARC->CSFlag == 1) {
+            fprintf(output_fp,"CS_FLAG: %d\n",pSPARC->CSFlag);
+            fprintf(output_fp,"CS_NTOP: %d\n",pSPARC->CS_Ntop);
+        }
         fprintf(output_fp,"CHEFSI_BOUND_FLAG: %d\n",pSPARC->chefsibound_flag);
     }
     
@@ -3582,6 +3827,12 @@ void write_output_init(SPARC_OBJ *pSPARC) {
         fprintf(output_fp,"CALC_PRES: %d\n",pSPARC->Calc_pres);
     if (pSPARC->MDFlag == 1 || pSPARC->RelaxFlag == 1)
         fprintf(output_fp,"TWTIME: %G\n",pSPARC->TWtime);
+    if (pSPARC->IncrUpdateFlag == 1) {
+        fprintf(output_fp,"INCREMENTAL_UPDATE: %d\n",pSPARC->IncrUpdateFlag);
+        fprintf(output_fp,"TOL_INCREMENTAL_UPDATE: %.2E\n",pSPARC->IncrUpdateTol);
+    }
+    if (pSPARC->OrbExtrapFlag == 1)
+        fprintf(output_fp,"ORBITAL_EXTRAPOLATION: %d\n",pSPARC->OrbExtrapFlag);
     if (pSPARC->MDFlag == 1) {
         fprintf(output_fp,"MD_FLAG: %d\n",pSPARC->MDFlag);
         fprintf(output_fp,"MD_METHOD: %s\n",pSPARC->MDMeth);
@@ -3648,6 +3899,9 @@ void write_output_init(SPARC_OBJ *pSPARC) {
     }else{
         fprintf(output_fp,"POISSON_SOLVER: CG\n");
     }
+    if (pSPARC->POISSON_PRECOND == 1) {
+        fprintf(output_fp,"POISSON_PRECOND: multigrid\n");
+    }
     fprintf(output_fp,"TOL_POISSON: %.2E\n",pSPARC->TOL_POISSON);
     fprintf(output_fp,"TOL_LANCZOS: %.2E\n",pSPARC->TOL_LANCZOS);
     fprintf(output_fp,"TOL_PSEUDOCHARGE: %.2E\n",pSPARC->TOL_PSEUDOCHARGE);
@@ -3761,6 +4015,7 @@ void write_output_init(SPARC_OBJ *pSPARC) {
         fprintf(output_fp, "MLFF_MAX_STR_STORE: %d\n", pSPARC->n_str_max_mlff);
         fprintf(output_fp, "MLFF_MAX_CONFIG_STORE: %d\n", pSPARC->n_train_max_mlff);
         fprintf(output_fp, "MLFF_RCUT_SOAP: %lf\n", pSPARC->rcut_SOAP);
+        fprintf(output_fp, "MLFF_NLIST_SKIN: %lf\n", pSPARC->nlist_skin_MLFF);
         fprintf(output_fp, "MLFF_SIGMA_ATOM_SOAP: %lf\n", pSPARC->sigma_atom_SOAP);
         // fprintf(output_fp, "MLFF_KERNEL_TYPE: %d\n", pSPARC->kernel_typ_MLFF);
         // fprintf(output_fp, "MLFF_WT_THREE_BODY_SOAP: %lf\n", pSPARC->beta_3_SOAP);
@@ -3774,20 +4029,26 @@ void write_output_init(SPARC_OBJ *pSPARC) {
                 pSPARC->stress_rel_scale[1], pSPARC->stress_rel_scale[2], pSPARC->stress_rel_scale[3],
                 pSPARC->stress_rel_scale[4], pSPARC->stress_rel_scale[5]);
         fprintf(output_fp, "MLFF_DFT_FQ: %d\n", pSPARC->MLFF_DFT_fq);
+        fprintf(output_fp, "MLFF_HYPER_NSTR: %d\n", pSPARC->hyper_nstr_MLFF);
+        fprintf(output_fp, "MLFF_HYPER_TOL: %.2E\n", pSPARC->hyper_tol_MLFF);
     }
 
     fprintf(output_fp,"VERBOSITY: %d\n",pSPARC->Verbosity);
     fprintf(output_fp,"PRINT_FORCES: %d\n",pSPARC->PrintForceFlag);
     fprintf(output_fp,"PRINT_ATOMS: %d\n",pSPARC->PrintAtomPosFlag);
     fprintf(output_fp,"PRINT_EIGEN: %d\n",pSPARC->PrintEigenFlag);
+    if (pSPARC->PrintTimingFlag == 1)
+        fprintf(output_fp,"PRINT_TIMING: %d\n",pSPARC->PrintTimingFlag);
     fprintf(output_fp,"PRINT_DENSITY: %d\n",pSPARC->PrintElecDensFlag);
     if(pSPARC->MDFlag == 1)
         fprintf(output_fp,"PRINT_MDOUT: %d\n",pSPARC->PrintMDout);
     if(pSPARC->MDFlag == 1 || pSPARC->RelaxFlag >= 1){
         fprintf(output_fp,"PRINT_VELS: %d\n",pSPARC->PrintAtomVelFlag);
         fprintf(output_fp,"PRINT_RESTART: %d\n",pSPARC->Printrestart);
-        if(pSPARC->Printrestart == 1)
+        if(pSPARC->Printrestart == 1) {
             fprintf(output_fp,"PRINT_RESTART_FQ: %d\n",pSPARC->Printrestart_fq);
+            fprintf(output_fp,"PRINT_RESTART_SCF: %d\n",pSPARC->Printrestart_scf);
+        }
     }
     if (pSPARC->PrintPsiFlag[0] == 1) {
         fprintf(output_fp,"PRINT_ORBITAL: %d %d %d %d %d %d %d\n",
@@ -3795,6 +4056,9 @@ void write_output_init(SPARC_OBJ *pSPARC) {
             pSPARC->PrintPsiFlag[4],pSPARC->PrintPsiFlag[5],pSPARC->PrintPsiFlag[6]);
     }
     fprintf(output_fp,"PRINT_ENERGY_DENSITY: %d\n",pSPARC->PrintEnergyDensFlag);
+    if (pSPARC->PrintDensFormat != 0) {
+        fprintf(output_fp,"PRINT_DENSITY_FORMAT: %d\n",pSPARC->PrintDensFormat);
+    }
 
     if (pSPARC->RelaxFlag == 1) {
         fprintf(output_fp,"TOL_RELAX: %.2E\n",pSPARC->TOL_RELAX);
@@ -3832,6 +4096,10 @@ void write_output_init(SPARC_OBJ *pSPARC) {
         }
         fprintf(output_fp,"EXX_DOWNSAMPLING: %d %d %d\n",pSPARC->EXXDownsampling[0]
                             ,pSPARC->EXXDownsampling[1],pSPARC->EXXDownsampling[2]);
+        if (pSPARC->ISDFFlag == 1) {
+            fprintf(output_fp,"EXX_ISDF_FLAG: %d\n",pSPARC->ISDFFlag);
+            fprintf(output_fp,"EXX_ISDF_RATIO: %.15G\n",pSPARC->EXXISDF_ratio);
+        }
     }
     if (pSPARC->d3Flag == 1) {
         fprintf(output_fp,"D3_FLAG: %d\n",pSPARC->d3Flag);
@@ -3890,6 +4158,9 @@ void write_output_init(SPARC_OBJ *pSPARC) {
         fprintf(output_fp,"NP_BAND_PARAL: %d\n",pSPARC->npband);
         fprintf(output_fp,"NP_DOMAIN_PARAL: %d %d %d\n",pSPARC->npNdx,pSPARC->npNdy,pSPARC->npNdz);
         fprintf(output_fp,"NP_DOMAIN_PHI_PARAL: %d %d %d\n",pSPARC->npNdx_phi,pSPARC->npNdy_phi,pSPARC->npNdz_phi);
+        fprintf(output_fp,"NUM_OMP_THREADS: %d\n",pSPARC->num_omp_threads);
+        if (pSPARC->paral_autotune > 0)
+            fprintf(output_fp,"PARAL_AUTOTUNE: %d\n",pSPARC->paral_autotune);
         fprintf(output_fp,"EIG_SERIAL_MAXNS: %d\n",pSPARC->eig_serial_maxns);
         if (pSPARC->useLAPACK == 0) {
             fprintf(output_fp,"EIG_PARAL_BLKSZ: %d\n",pSPARC->eig_paral_blksz);
@@ -3932,6 +4203,10 @@ void write_output_init(SPARC_OBJ *pSPARC) {
         fprintf(output_fp,"Final eigenvalues printed to       :  %s\n",pSPARC->EigenFilename);
     }
 
+    if (pSPARC->PrintTimingFlag==1) {
+        fprintf(output_fp,"Timing report printed to           :  %s\n",pSPARC->TimingFilename);
+    }
+
     if (pSPARC->MDFlag == 1 && pSPARC->PrintMDout == 1) {
         fprintf(output_fp,"MD output printed to               :  %s\n",pSPARC->MDFilename);
     }
@@ -4042,7 +4317,10 @@ void SPARC_Input_MPI_create(MPI_Datatype *pSPARC_INPUT_MPI) {
                                          MPI_INT, MPI_INT, MPI_INT, MPI_INT, MPI_INT,
                                          MPI_INT, MPI_INT, MPI_INT, MPI_INT, MPI_INT,
                                          MPI_INT, MPI_INT, MPI_INT, MPI_INT, MPI_INT,
-                                         MPI_INT, MPI_INT, MPI_INT,     /* int array */
+                                         MPI_INT, MPI_INT, MPI_INT, MPI_INT, MPI_INT,
+                                         MPI_INT, MPI_INT, MPI_INT, MPI_INT, MPI_INT,
+                                         MPI_INT, MPI_INT, MPI_INT, MPI_INT, MPI_INT,
+                                         MPI_INT, MPI_INT, /* int array */
 
                                          MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE,
                                          MPI_DOUBLE, MPI_DOUBLE,
@@ -4059,6 +4337,7 @@ void SPARC_Input_MPI_create(MPI_Datatype *pSPARC_INPUT_MPI) {
                                          MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, 
                                          MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE,
                                          MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE,
+                                         MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE,
                                          MPI_DOUBLE, MPI_DOUBLE, MPI_DOUBLE,
                                          MPI_CHAR, MPI_CHAR, MPI_CHAR, MPI_CHAR, MPI_CHAR,
                                          MPI_CHAR, MPI_CHAR, MPI_CHAR, MPI_CHAR, MPI_CHAR,
@@ -4086,7 +4365,10 @@ void SPARC_Input_MPI_create(MPI_Datatype *pSPARC_INPUT_MPI) {
                           1, 1, 1, 1, 1,
                           1, 1, 1, 1, 1,
                           1, 1, 1, 1, 1,
-                          1, 1, 1,/* int */ 
+                          1, 1, 1, 1, 1,
+                          1, 1, 1, 1, 1,
+                          1, 1, 1, 1, 1,
+                          1, 1, /* int */ 
                           9, 3, L_QMASS, L_kpoint, L_kpoint,
                           L_kpoint, 6, /* double array */
                           1, 1, 1, 1, 1, 
@@ -4102,7 +4384,7 @@ void SPARC_Input_MPI_create(MPI_Datatype *pSPARC_INPUT_MPI) {
                           1, 1, 1, 1, 1, 
                           1, 1, 1, 1, 1,
                           1, 1, 1, 1, 1,
-                          1, 1, 1, /* double */
+                          1, 1, 1, 1, 1, 1, 1, 1, 1, /* double */
                           32, 32, 32, L_STRING, L_STRING, /* char */
                           L_STRING, L_STRING, L_STRING, L_STRING, L_STRING,
                           L_STRING};
@@ -4128,11 +4410,15 @@ void SPARC_Input_MPI_create(MPI_Datatype *pSPARC_INPUT_MPI) {
     MPI_Get_address(&sparc_input_tmp.npNdx_phi, addr + i++);
     MPI_Get_address(&sparc_input_tmp.npNdy_phi, addr + i++);
     MPI_Get_address(&sparc_input_tmp.npNdz_phi, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.num_omp_threads, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.paral_autotune, addr + i++);
     MPI_Get_address(&sparc_input_tmp.eig_serial_maxns, addr + i++);
     MPI_Get_address(&sparc_input_tmp.eig_paral_blksz, addr + i++);
     MPI_Get_address(&sparc_input_tmp.MDFlag, addr + i++);
     MPI_Get_address(&sparc_input_tmp.spin_typ, addr + i++);
     MPI_Get_address(&sparc_input_tmp.RelaxFlag, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.IncrUpdateFlag, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.OrbExtrapFlag, addr + i++);
     MPI_Get_address(&sparc_input_tmp.RestartFlag, addr + i++);
     MPI_Get_address(&sparc_input_tmp.Flag_latvec_scale, addr + i++);
     MPI_Get_address(&sparc_input_tmp.numIntervals_x, addr + i++);
@@ -4148,6 +4434,9 @@ void SPARC_Input_MPI_create(MPI_Datatype *pSPARC_INPUT_MPI) {
     MPI_Get_address(&sparc_input_tmp.order, addr + i++);
     MPI_Get_address(&sparc_input_tmp.ChebDegree, addr + i++);
     MPI_Get_address(&sparc_input_tmp.CheFSI_Optmz, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.CheFSI_MixedPrec, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.CSFlag, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.CS_Ntop, addr + i++);
     MPI_Get_address(&sparc_input_tmp.chefsibound_flag, addr + i++);
     MPI_Get_address(&sparc_input_tmp.rhoTrigger, addr + i++);
     MPI_Get_address(&sparc_input_tmp.Nchefsi, addr + i++);
@@ -4175,11 +4464,13 @@ void SPARC_Input_MPI_create(MPI_Datatype *pSPARC_INPUT_MPI) {
     MPI_Get_address(&sparc_input_tmp.PrintAtomPosFlag, addr + i++);
     MPI_Get_address(&sparc_input_tmp.PrintAtomVelFlag, addr + i++);
     MPI_Get_address(&sparc_input_tmp.PrintEigenFlag, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.PrintTimingFlag, addr + i++);
     MPI_Get_address(&sparc_input_tmp.PrintElecDensFlag, addr + i++);
     MPI_Get_address(&sparc_input_tmp.PrintMDout, addr + i++);
     MPI_Get_address(&sparc_input_tmp.PrintRelaxout, addr + i++);
     MPI_Get_address(&sparc_input_tmp.Printrestart, addr + i++);
     MPI_Get_address(&sparc_input_tmp.Printrestart_fq, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.Printrestart_scf, addr + i++);
     MPI_Get_address(&sparc_input_tmp.elec_T_type, addr + i++);
     MPI_Get_address(&sparc_input_tmp.MD_Nstep, addr + i++);
     MPI_Get_address(&sparc_input_tmp.ion_elec_eqT, addr + i++);
@@ -4191,6 +4482,7 @@ void SPARC_Input_MPI_create(MPI_Datatype *pSPARC_INPUT_MPI) {
     MPI_Get_address(&sparc_input_tmp.Calc_stress, addr + i++);
     MPI_Get_address(&sparc_input_tmp.Calc_pres, addr + i++);
     MPI_Get_address(&sparc_input_tmp.Poisson_solver, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.Poisson_precond, addr + i++);
     MPI_Get_address(&sparc_input_tmp.d3Flag, addr + i++);
     MPI_Get_address(&sparc_input_tmp.NPT_NHnnos, addr + i++);    
     MPI_Get_address(&sparc_input_tmp.NPTconstraintFlag, addr + i++);
@@ -4200,14 +4492,17 @@ void SPARC_Input_MPI_create(MPI_Datatype *pSPARC_INPUT_MPI) {
     MPI_Get_address(&sparc_input_tmp.EXXMem_batch, addr + i++);
     MPI_Get_address(&sparc_input_tmp.EXXACEVal_state, addr + i++);
     MPI_Get_address(&sparc_input_tmp.EXXDiv_Flag, addr + i++);    
+    MPI_Get_address(&sparc_input_tmp.ISDFFlag, addr + i++);
     MPI_Get_address(&sparc_input_tmp.MINIT_FOCK, addr + i++);
     MPI_Get_address(&sparc_input_tmp.SQFlag, addr + i++);
     MPI_Get_address(&sparc_input_tmp.SQ_gauss_mem, addr + i++);
     MPI_Get_address(&sparc_input_tmp.SQ_npl_g, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.SQ_block_size, addr + i++);
     MPI_Get_address(&sparc_input_tmp.npNdx_SQ, addr + i++);
     MPI_Get_address(&sparc_input_tmp.npNdy_SQ, addr + i++);
     MPI_Get_address(&sparc_input_tmp.npNdz_SQ, addr + i++);
     MPI_Get_address(&sparc_input_tmp.PrintEnergyDensFlag, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.PrintDensFormat, addr + i++);
     MPI_Get_address(&sparc_input_tmp.eig_paral_maxnp, addr + i++);
     MPI_Get_address(&sparc_input_tmp.StandardEigenFlag, addr + i++);
     MPI_Get_address(&sparc_input_tmp.n_kpt_line, addr + i++);
@@ -4230,6 +4525,7 @@ void SPARC_Input_MPI_create(MPI_Datatype *pSPARC_INPUT_MPI) {
     MPI_Get_address(&sparc_input_tmp.mlff_pressure_train_flag, addr + i++);
     MPI_Get_address(&sparc_input_tmp.N_rgrid_MLFF, addr + i++);
     MPI_Get_address(&sparc_input_tmp.MLFF_DFT_fq, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.hyper_nstr_MLFF, addr + i++);
 
     // double array type
     MPI_Get_address(&sparc_input_tmp.LatVec, addr + i++);
@@ -4255,6 +4551,8 @@ void SPARC_Input_MPI_create(MPI_Datatype *pSPARC_INPUT_MPI) {
     MPI_Get_address(&sparc_input_tmp.TOL_RELAX, addr + i++);
     MPI_Get_address(&sparc_input_tmp.TOL_POISSON, addr + i++);
     MPI_Get_address(&sparc_input_tmp.TOL_LANCZOS, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.TOL_CheFSI_MixedPrec, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.IncrUpdateTol, addr + i++);
     MPI_Get_address(&sparc_input_tmp.TOL_PSEUDOCHARGE, addr + i++);
     MPI_Get_address(&sparc_input_tmp.TOL_PRECOND, addr + i++);
     MPI_Get_address(&sparc_input_tmp.precond_kerker_kTF, addr + i++);
@@ -4295,7 +4593,9 @@ void SPARC_Input_MPI_create(MPI_Datatype *pSPARC_INPUT_MPI) {
     MPI_Get_address(&sparc_input_tmp.TOL_SCF_INIT, addr + i++);
     MPI_Get_address(&sparc_input_tmp.hyb_range_fock, addr + i++);
     MPI_Get_address(&sparc_input_tmp.hyb_range_pbe, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.exx_sr_table_tol, addr + i++);
     MPI_Get_address(&sparc_input_tmp.exx_frac, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.EXXISDF_ratio, addr + i++);
     MPI_Get_address(&sparc_input_tmp.SQ_rcut, addr + i++);
     MPI_Get_address(&sparc_input_tmp.SQ_tol_occ, addr + i++);
     MPI_Get_address(&sparc_input_tmp.twist, addr + i++);
@@ -4305,11 +4605,13 @@ void SPARC_Input_MPI_create(MPI_Datatype *pSPARC_INPUT_MPI) {
     MPI_Get_address(&sparc_input_tmp.condK_min, addr + i++);
     MPI_Get_address(&sparc_input_tmp.factor_multiply_sigma_tol, addr + i++);
     MPI_Get_address(&sparc_input_tmp.rcut_SOAP, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.nlist_skin_MLFF, addr + i++);
     MPI_Get_address(&sparc_input_tmp.sigma_atom_SOAP, addr + i++);
     MPI_Get_address(&sparc_input_tmp.beta_3_SOAP, addr + i++);
     MPI_Get_address(&sparc_input_tmp.xi_3_SOAP, addr + i++);
     MPI_Get_address(&sparc_input_tmp.F_tol_SOAP, addr + i++);
     MPI_Get_address(&sparc_input_tmp.F_rel_scale, addr + i++);
+    MPI_Get_address(&sparc_input_tmp.hyper_tol_MLFF, addr + i++);
     
 
     // char type
@@ -4535,9 +4837,15 @@ void xc_decomposition(SPARC_OBJ *pSPARC)
             printf("Note: You are using HSE with range-separation parameter omega_HF = %.6f (1/Bohr) and omega_PBE = %.6f (1/Bohr)\n", pSPARC->hyb_range_fock, pSPARC->hyb_range_pbe);
             printf("If you want to change it, please use EXX_RANGE_FOCK and EXX_RANGE_PBE input options.\n");
         }
+        if (pSPARC->exx_sr_table_tol < 0.0) {
+            if (!rank)
+                printf(RED "ERROR: EXX_SR_TABLE_TOL must be non-negative.\n" RESET);
+            exit(EXIT_FAILURE);
+        }
     } else {
         pSPARC->hyb_range_fock = -1;
         pSPARC->hyb_range_pbe = -1;
+        pSPARC->exx_sr_table_tol = 0.0;
     }
 
 #ifdef DEBUG
@@ -14,6 +14,7 @@
  
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 #include <mpi.h> 
@@ -22,6 +23,8 @@
 #include "gradVecRoutines.h"
 #include "isddft.h"
 #include "cyclix_lapVec.h"
+#include "timing.h"
+#include "haloExchange.h"
 
 #ifdef USE_EVA_MODULE
 #include "ExtVecAccel/ExtVecAccel.h"
@@ -92,14 +95,11 @@ void Lap_vec_mult_orth(
     double *y, const int ldo, MPI_Comm comm, const int *dims
 ) 
 {   
-    unsigned i;
     // Call the function for (a*Lap+b*v+c)x with b = 0 and v = NULL
-    for (i = 0; i < ncol; i++) {
-        Lap_plus_diag_vec_mult_orth(
-            pSPARC, DMnd, DMVertices, 1, a, 0.0, c, NULL, 
-            x+i*(unsigned)ldi, ldi, y+i*(unsigned)ldo, ldo, comm, dims
-        );
-    }
+    Lap_plus_diag_vec_mult_orth(
+        pSPARC, DMnd, DMVertices, ncol, a, 0.0, c, NULL, 
+        x, ldi, y, ldo, comm, dims
+    );
 }
 
 
@@ -153,8 +153,10 @@ void stencil_3axis_thread_variable_radius(
 {
     int i, j, k, jp, kp, r;
     const int shift_ip = x_ex_spos - x_spos;
-    for (k = z_spos, kp = z_ex_spos; k < z_epos; k++, kp++)
+    #pragma omp parallel for private(i, j, jp, kp, r) schedule(static)
+    for (k = z_spos; k < z_epos; k++)
     {
+        kp = z_ex_spos + (k - z_spos);
         for (j = y_spos, jp = y_ex_spos; j < y_epos; j++, jp++)
         {
             int offset = k * stride_z + j * stride_y;
@@ -198,8 +200,10 @@ void stencil_3axis_thread_radius6(
 {
     int i, j, k, jp, kp, r;
     const int shift_ip = x_ex_spos - x_spos;
-    for (k = z_spos, kp = z_ex_spos; k < z_epos; k++, kp++)
+    #pragma omp parallel for private(i, j, jp, kp, r) schedule(static)
+    for (k = z_spos; k < z_epos; k++)
     {
+        kp = z_ex_spos + (k - z_spos);
         for (j = y_spos, jp = y_ex_spos; j < y_epos; j++, jp++)
         {
             int offset = k * stride_z + j * stride_y;
@@ -293,15 +297,54 @@ void stencil_3axis_thread_v2(
 
 
 /**
- * @brief   Calculate (a * Lap + b * diag(v) + c * I) times vectors.
+ * @brief   Apply the stencil on the points of the local domain that are within
+ *          FDn of the domain faces, i.e., the points that need the halo of x.
  *
- *          This is only for orthogonal discretization.
+ *          If the domain is too thin to have an interior region, the whole
+ *          domain is computed.
+ */
+static void stencil_boundary_shell(
+    const double *x_ex, const int FDn, const int DMnx, const int DMny, const int DMnz,
+    const int DMnx_ex, const int DMny_ex, const int has_interior,
+    const double *stencil_coefs, const double coef_0, const double b,
+    const double *v0, double *y)
+{
+    const int stride_y = DMnx, stride_z = DMnx * DMny;
+    const int stride_y_ex = DMnx_ex, stride_z_ex = DMnx_ex * DMny_ex;
+    if (!has_interior) {
+        stencil_3axis_thread_v2(
+            x_ex, FDn, stride_y, stride_y_ex, stride_z, stride_z_ex,
+            0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn,
+            stencil_coefs, coef_0, b, v0, y
+        );
+        return;
+    }
+
+    // the shell is split into 6 non-overlapping slabs: z faces, then y faces, then x faces
+    int xs[6] = {0,    0,         0,    0,         0,    DMnx-FDn};
+    int xe[6] = {DMnx, DMnx,      DMnx, DMnx,      FDn,  DMnx};
+    int ys[6] = {0,    0,         0,    DMny-FDn,  FDn,  FDn};
+    int ye[6] = {DMny, DMny,      FDn,  DMny,      DMny-FDn, DMny-FDn};
+    int zs[6] = {0,    DMnz-FDn,  FDn,  FDn,       FDn,  FDn};
+    int ze[6] = {FDn,  DMnz,      DMnz-FDn, DMnz-FDn, DMnz-FDn, DMnz-FDn};
+    for (int s = 0; s < 6; s++) {
+        stencil_3axis_thread_v2(
+            x_ex, FDn, stride_y, stride_y_ex, stride_z, stride_z_ex,
+            xs[s], xe[s], ys[s], ye[s], zs[s], ze[s], xs[s]+FDn, ys[s]+FDn, zs[s]+FDn,
+            stencil_coefs, coef_0, b, v0, y
+        );
+    }
+}
+
+
+
+/**
+ * @brief   Calculate (a * Lap + b * diag(v) + c * I) times vectors.
  *
- *          Warning:
- *            Although the function is intended for multiple vectors,
- *          it turns out to be slower than applying it to one vector
- *          at a time. So we will be calling this function ncol times
- *          if ncol is greater than 1.
+ *          This is only for orthogonal discretization. The interior of the
+ *          local domain is computed while the halo is exchanged, in tiles of
+ *          LAP_TILE_NCOL vectors by z-slabs of about LAP_TILE_BYTES, and the
+ *          boundary shell after the halo has arrived.
  */
 void Lap_plus_diag_vec_mult_orth(
         const SPARC_OBJ *pSPARC, const int DMnd, const int *DMVertices,
@@ -311,90 +354,90 @@ void Lap_plus_diag_vec_mult_orth(
 ) 
 {
 #define X(n,i,j,k) x[(n)*ldi+(k)*DMnxny+(j)*DMnx+(i)]
-#define x_ex(n,i,j,k) x_ex[(n)*DMnd_ex+(k)*DMnxny_ex+(j)*DMnx_ex+(i)]
+#define x_ex(i,j,k) x_ex[(k)*DMnxny_ex+(j)*DMnx_ex+(i)]
+
+    timing_region_begin("Lap_plus_diag_vec_mult_orth");
 
     #ifdef USE_EVA_MODULE
     double pack_t = 0.0, cpyx_t = 0.0, krnl_t = 0.0, unpk_t = 0.0, comm_t = 0.0;
     double st, et;
     #endif
 
-    const double *_v = v; double _b = b; 
-    if (fabs(b) < 1e-14 || v == NULL) _v = x, _b = 0.0;
-    
+    // without v the kernel reads x in its place, multiplied by 0
+    const double *_v = v; double _b = b;
+    if (fabs(b) < 1e-14 || v == NULL) _v = x, _b = 0;
+
     int nproc = dims[0] * dims[1] * dims[2];
     int periods[3];
     periods[0] = 1 - pSPARC->BCx;
     periods[1] = 1 - pSPARC->BCy;
     periods[2] = 1 - pSPARC->BCz;
-    
+
     int FDn = pSPARC->order / 2;
-    
+
     // The user has to make sure DMnd = DMnx * DMny * DMnz
     int DMnx = 1 - DMVertices[0] + DMVertices[1];
     int DMny = 1 - DMVertices[2] + DMVertices[3];
     int DMnz = 1 - DMVertices[4] + DMVertices[5];
     int DMnxny = DMnx * DMny;
-    
+
     int DMnx_ex = DMnx + pSPARC->order;
     int DMny_ex = DMny + pSPARC->order;
     int DMnz_ex = DMnz + pSPARC->order;
     int DMnxny_ex = DMnx_ex * DMny_ex;
     int DMnd_ex = DMnxny_ex * DMnz_ex;
-    
+
     int DMnx_in  = DMnx - FDn;
     int DMny_in  = DMny - FDn;
     int DMnz_in  = DMnz - FDn;
     int DMnx_out = DMnx + FDn;
     int DMny_out = DMny + FDn;
     int DMnz_out = DMnz + FDn;
-    
-    // int Nx = pSPARC->Nx;
-    // int Ny = pSPARC->Ny;
-    
+
+    // points at least FDn away from all faces do not need the halo
+    int has_interior = (DMnx > 2*FDn) && (DMny > 2*FDn) && (DMnz > 2*FDn);
+
     #ifdef USE_EVA_MODULE
     st = MPI_Wtime();
     #endif
-    
+
     // integrate a into coefficients weights
-    double *Lap_weights = (double *)malloc(3*(FDn+1)*sizeof(double)); 
-    double *Lap_stencil = Lap_weights;
+    double *Lap_weights = (double *)malloc(3*(FDn+1)*sizeof(double));
+    assert(Lap_weights != NULL);
     int p;
-    for (p = 0; p < FDn + 1; p++)
-    {
-        (*Lap_stencil++) = pSPARC->D2_stencil_coeffs_x[p] * a;
-        (*Lap_stencil++) = pSPARC->D2_stencil_coeffs_y[p] * a;
-        (*Lap_stencil++) = pSPARC->D2_stencil_coeffs_z[p] * a;
+    for (p = 0; p < FDn + 1; p++) {
+        Lap_weights[3*p  ] = pSPARC->D2_stencil_coeffs_x[p] * a;
+        Lap_weights[3*p+1] = pSPARC->D2_stencil_coeffs_y[p] * a;
+        Lap_weights[3*p+2] = pSPARC->D2_stencil_coeffs_z[p] * a;
     }
-    
-    double w2_diag;
-    w2_diag  = Lap_weights[0];
-    w2_diag += Lap_weights[1];
-    w2_diag += Lap_weights[2];
-    w2_diag += c; // shift the diagonal by c
+    // shift the diagonal by c
+    double w2_diag = Lap_weights[0] + Lap_weights[1] + Lap_weights[2] + c;
 
     // set up send buffer based on the ordering of the neighbors
-    int istart[6] = {0,    DMnx_in,  0,    0,        0,    0}, 
-          iend[6] = {FDn,  DMnx,     DMnx, DMnx,     DMnx, DMnx}, 
-        jstart[6] = {0,    0,        0,    DMny_in,  0,    0},  
-          jend[6] = {DMny, DMny,     FDn,  DMny,     DMny, DMny}, 
-        kstart[6] = {0,    0,        0,    0,        0,    DMnz_in}, 
+    int istart[6] = {0,    DMnx_in,  0,    0,        0,    0},
+          iend[6] = {FDn,  DMnx,     DMnx, DMnx,     DMnx, DMnx},
+        jstart[6] = {0,    0,        0,    DMny_in,  0,    0},
+          jend[6] = {DMny, DMny,     FDn,  DMny,     DMny, DMny},
+        kstart[6] = {0,    0,        0,    0,        0,    DMnz_in},
           kend[6] = {DMnz, DMnz,     DMnz, DMnz,     FDn,  DMnz};
-    
-    int nbrcount;
-    MPI_Request request;
-    double *x_in, *x_out;
-    x_in = NULL; x_out = NULL;
+
+    // number of halo values per vector received from each neighbor
+    int nbr_size[6];
+    nbr_size[0] = nbr_size[1] = FDn * (DMny * DMnz);
+    nbr_size[2] = nbr_size[3] = FDn * (DMnx * DMnz);
+    nbr_size[4] = nbr_size[5] = FDn * (DMnx * DMny);
+
+    int nbrcount, n, i, j, k, ip, jp, kp, count;
+    HALO_PLAN_OBJ *halo = NULL;
+    double *x_in = NULL, *x_out = NULL;
     if (nproc > 1) { // pack info and init Halo exchange
-        // TODO: we have to take BC into account here!
-        int nd_in = ncol * pSPARC->order * (DMnx*DMny + DMny*DMnz + DMnx*DMnz);
-        int nd_out = nd_in;
-        
-        // Notice here we init x_in to 0
-        x_in  = (double *)calloc( nd_in, sizeof(double)); 
-        x_out = (double *)malloc( nd_out * sizeof(double)); // no need to init x_out
-        assert(x_in != NULL && x_out != NULL);
+        // the buffers are owned by the plan, x_in is 0 for the missing neighbors
+        halo = Halo_plan_get(comm, MPI_DOUBLE, 6, nbr_size, ncol);
+        x_in  = (double *) halo->recvbuf;
+        x_out = (double *) halo->sendbuf;
 
-        int nbr_i, n, k, j, i, count = 0;
+        int nbr_i;
+        count = 0;
         for (nbr_i = 0; nbr_i < 6; nbr_i++) {
             // if dims[i] < 3 and periods[i] == 1, switch send buffer for left and right neighbors
             nbrcount = nbr_i + (1 - 2 * (nbr_i % 2)) * (int)(dims[nbr_i / 2] < 3 && periods[nbr_i / 2]);
@@ -414,198 +457,195 @@ void Lap_plus_diag_vec_mult_orth(
                 }
             }
         }
-        
-        #ifdef USE_EVA_MODULE
+
+    #ifdef USE_EVA_MODULE
         et = MPI_Wtime();
         pack_t = et - st;
-        #endif
-        
-        int sendcounts[6], sdispls[6], recvcounts[6], rdispls[6];
-        // set up parameters for MPI_Ineighbor_alltoallv
-        // TODO: do this in Initialization to save computation time!
-        sendcounts[0] = sendcounts[1] = recvcounts[0] = recvcounts[1] = ncol * FDn * (DMny * DMnz);
-        sendcounts[2] = sendcounts[3] = recvcounts[2] = recvcounts[3] = ncol * FDn * (DMnx * DMnz);
-        sendcounts[4] = sendcounts[5] = recvcounts[4] = recvcounts[5] = ncol * FDn * (DMnx * DMny);
-        
-        rdispls[0] = sdispls[0] = 0;
-        rdispls[1] = sdispls[1] = sdispls[0] + sendcounts[0];
-        rdispls[2] = sdispls[2] = sdispls[1] + sendcounts[1];
-        rdispls[3] = sdispls[3] = sdispls[2] + sendcounts[2];
-        rdispls[4] = sdispls[4] = sdispls[3] + sendcounts[3];
-        rdispls[5] = sdispls[5] = sdispls[4] + sendcounts[4];
-        
+    #endif
+
         // first transfer info. to/from neighbor processors
-        //MPI_Request request;
-        MPI_Ineighbor_alltoallv(x_out, sendcounts, sdispls, MPI_DOUBLE, 
-                                 x_in, recvcounts, rdispls, MPI_DOUBLE, 
-                                 comm, &request); // non-blocking
+        Halo_plan_start(halo); // non-blocking
+        timing_add_counts(sizeof(double) * halo->nd, 0.0);
     }
-    
-    // overlap some work with communication
+
+    // overlap the interior part of Lx of all vectors with communication
     #ifdef USE_EVA_MODULE
     st = MPI_Wtime();
     #endif
-    
-    int *pshifty    = (int *)malloc( (FDn+1) * sizeof(int));
-    int *pshiftz    = (int *)malloc( (FDn+1) * sizeof(int));
-    int *pshifty_ex = (int *)malloc( (FDn+1) * sizeof(int));
-    int *pshiftz_ex = (int *)malloc( (FDn+1) * sizeof(int));
-    double *x_ex = (double *)malloc(ncol * DMnd_ex * sizeof(double));
-    pshifty[0] = pshiftz[0] = pshifty_ex[0] = pshiftz_ex[0] = 0;
-    for (p = 1; p <= FDn; p++) {
-        // for x
-        pshifty[p] = p * DMnx;
-        pshiftz[p] = pshifty[p] * DMny;
-        // for x_ex
-        pshifty_ex[p] = p * DMnx_ex;
-        pshiftz_ex[p] = pshifty_ex[p] * DMny_ex;
-    }
-    
-    // copy x into extended x_ex
-    int n, kp, jp, ip, count;    
-    for (n = 0; n < ncol; n++) {
-        count = 0;
-        for (kp = FDn; kp < DMnz_out; kp++) {
-            for (jp = FDn; jp < DMny_out; jp++) {
-                for (ip = FDn; ip < DMnx_out; ip++) {
-                    x_ex(n,ip,jp,kp) = x[count++ + n*ldi]; 
+    if (has_interior) {
+        // bytes of v, x and y per z-plane, x is also read FDn planes below and above the slab
+        size_t plane_bytes = (size_t) DMnxny * (3 * sizeof(double));
+        int nz_blk = (int) (LAP_TILE_BYTES / plane_bytes) - 2 * FDn;
+        // every slab has at least one plane per thread of the kernel
+        if (nz_blk < pSPARC->num_omp_threads) nz_blk = pSPARC->num_omp_threads;
+        if (nz_blk < 1) nz_blk = 1;
+        int n0, k0;
+        for (n0 = 0; n0 < ncol; n0 += LAP_TILE_NCOL) {
+            int n1 = (n0 + LAP_TILE_NCOL < ncol) ? n0 + LAP_TILE_NCOL : ncol;
+            for (k0 = FDn; k0 < DMnz_in; k0 += nz_blk) {
+                int k1 = (k0 + nz_blk < DMnz_in) ? k0 + nz_blk : DMnz_in;
+                for (n = n0; n < n1; n++) {
+                    stencil_3axis_thread_v2(
+                        x+n*(unsigned)ldi, FDn, DMnx, DMnx, DMnxny, DMnxny,
+                        FDn, DMnx_in, FDn, DMny_in, k0, k1, FDn, FDn, k0,
+                        Lap_weights, w2_diag, _b, _v, y+n*(unsigned)ldo
+                    );
                 }
             }
         }
-    } 
-    
+    }
     #ifdef USE_EVA_MODULE
     et = MPI_Wtime();
-    cpyx_t = et - st;
-    
-    st = MPI_Wtime();
+    krnl_t += et - st;
     #endif
-                          
-    int i, j, k;
-    
+
     // set up start and end indices for copying edge nodes in x_ex
-    int istart_in[6] = {0,       DMnx_out, FDn,     FDn,      FDn,      FDn}; 
+    int istart_in[6] = {0,       DMnx_out, FDn,     FDn,      FDn,      FDn};
     int   iend_in[6] = {FDn,     DMnx_ex,  DMnx_out,DMnx_out, DMnx_out, DMnx_out};
     int jstart_in[6] = {FDn,     FDn,      0,       DMny_out, FDn,      FDn};
     int   jend_in[6] = {DMny_out,DMny_out, FDn,     DMny_ex,  DMny_out, DMny_out};
-    int kstart_in[6] = {FDn,     FDn,      FDn,     FDn,      0,        DMnz_out}; 
+    int kstart_in[6] = {FDn,     FDn,      FDn,     FDn,      0,        DMnz_out};
     int   kend_in[6] = {DMnz_out,DMnz_out, DMnz_out,DMnz_out, FDn,      DMnz_ex};
-    
-    if (nproc > 1) { // unpack info and copy into x_ex
+
+    if (nproc > 1) {
         // make sure receive buffer is ready
-        #ifdef USE_EVA_MODULE
+    #ifdef USE_EVA_MODULE
         st = MPI_Wtime();
-        #endif
-        MPI_Wait(&request, MPI_STATUS_IGNORE);
-        #ifdef USE_EVA_MODULE
+    #endif
+        timing_region_begin("halo_wait");
+        Halo_plan_wait(halo);
+        timing_region_end("halo_wait");
+    #ifdef USE_EVA_MODULE
         et = MPI_Wtime();
         comm_t = et - st;
-        #endif
+    #endif
+    }
 
-        // copy receive buffer into extended domain
-        #ifdef USE_EVA_MODULE
+    // the boundary shell only reads x_ex within 2*FDn of the faces of the local domain
+    int ip_lo = FDn + 2*FDn, ip_hi = DMnx_out - 2*FDn;
+    int jp_lo = FDn + 2*FDn, jp_hi = DMny_out - 2*FDn;
+    int kp_lo = FDn + 2*FDn, kp_hi = DMnz_out - 2*FDn;
+    if (!has_interior || ip_lo >= ip_hi) {
+        ip_lo = ip_hi = DMnx_out;
+    }
+
+    // the extended domain of one vector is reused for all vectors and kept by the plan
+    double *x_ex = (double *)Halo_ex_buffer(comm, halo, DMnd_ex * sizeof(double));
+    for (n = 0; n < ncol; n++) {
+    #ifdef USE_EVA_MODULE
         st = MPI_Wtime();
-        #endif
-        count = 0;
-        for (nbrcount = 0; nbrcount < 6; nbrcount++) {
-            const int k_s = kstart_in[nbrcount];
-            const int k_e = kend_in  [nbrcount];
-            const int j_s = jstart_in[nbrcount];
-            const int j_e = jend_in  [nbrcount];
-            const int i_s = istart_in[nbrcount];
-            const int i_e = iend_in  [nbrcount];
-            for (n = 0; n < ncol; n++) {
+    #endif
+
+        // copy x into extended x_ex
+        const double *xn = x + n*(unsigned)ldi;
+        for (kp = FDn; kp < DMnz_out; kp++) {
+            int row_full = (kp < kp_lo || kp >= kp_hi);
+            for (jp = FDn; jp < DMny_out; jp++) {
+                count = (kp-FDn) * DMnxny + (jp-FDn) * DMnx;
+                if (row_full || jp < jp_lo || jp >= jp_hi) {
+                    for (ip = FDn; ip < DMnx_out; ip++)
+                        x_ex(ip,jp,kp) = xn[count++];
+                } else {
+                    for (ip = FDn; ip < ip_lo; ip++)
+                        x_ex(ip,jp,kp) = xn[count++];
+                    count += ip_hi - ip_lo;
+                    for (ip = ip_hi; ip < DMnx_out; ip++)
+                        x_ex(ip,jp,kp) = xn[count++];
+                }
+            }
+        }
+
+    #ifdef USE_EVA_MODULE
+        et = MPI_Wtime();
+        cpyx_t += et - st;
+        st = MPI_Wtime();
+    #endif
+
+        if (nproc > 1) { // unpack info and copy into x_ex
+            for (nbrcount = 0; nbrcount < 6; nbrcount++) {
+                const int k_s = kstart_in[nbrcount];
+                const int k_e = kend_in  [nbrcount];
+                const int j_s = jstart_in[nbrcount];
+                const int j_e = jend_in  [nbrcount];
+                const int i_s = istart_in[nbrcount];
+                const int i_e = iend_in  [nbrcount];
+                count = halo->displs[nbrcount] + n * nbr_size[nbrcount];
                 for (k = k_s; k < k_e; k++) {
                     for (j = j_s; j < j_e; j++) {
                         for (i = i_s; i < i_e; i++) {
-                            x_ex(n,i,j,k) = x_in[count++];
+                            x_ex(i,j,k) = x_in[count++];
                         }
                     }
                 }
             }
-        }
-        
-        free(x_out);
-        free(x_in);
-        
-        #ifdef USE_EVA_MODULE
-        et = MPI_Wtime();
-        unpk_t = et - st;
-        #endif    
-    
-    } else { // copy the extended part directly from x into x_ex
-        int nbr_i;
-        for (nbr_i = 0; nbr_i < 6; nbr_i++) {
-            // if dims[i] < 3 and periods[i] == 1, switch send 
-            // buffer for left and right neighbors
-            nbrcount = nbr_i + (1 - 2 * (nbr_i % 2)); 
-            // * (int)(dims[nbr_i / 2] < 3 && periods[nbr_i / 2]);
-            const int kp_s = kstart_in[nbr_i];
-            const int kp_e = kend_in  [nbr_i];
-            const int jp_s = jstart_in[nbr_i];
-            const int jp_e = jend_in  [nbr_i];
-            const int ip_s = istart_in[nbr_i];
-            const int ip_e = iend_in  [nbr_i];
-            if (periods[nbr_i / 2]) {
-                const int k_s = kstart[nbrcount];
-                const int k_e = kend  [nbrcount];
-                const int j_s = jstart[nbrcount];
-                const int j_e = jend  [nbrcount];
-                const int i_s = istart[nbrcount];
-                const int i_e = iend  [nbrcount];
-                for (n = 0; n < ncol; n++) {
+        } else { // copy the extended part directly from x into x_ex
+            int nbr_i;
+            for (nbr_i = 0; nbr_i < 6; nbr_i++) {
+                // if dims[i] < 3 and periods[i] == 1, switch send
+                // buffer for left and right neighbors
+                nbrcount = nbr_i + (1 - 2 * (nbr_i % 2));
+                const int kp_s = kstart_in[nbr_i];
+                const int kp_e = kend_in  [nbr_i];
+                const int jp_s = jstart_in[nbr_i];
+                const int jp_e = jend_in  [nbr_i];
+                const int ip_s = istart_in[nbr_i];
+                const int ip_e = iend_in  [nbr_i];
+                if (periods[nbr_i / 2]) {
+                    const int k_s = kstart[nbrcount];
+                    const int k_e = kend  [nbrcount];
+                    const int j_s = jstart[nbrcount];
+                    const int j_e = jend  [nbrcount];
+                    const int i_s = istart[nbrcount];
+                    const int i_e = iend  [nbrcount];
                     for (k = k_s, kp = kp_s; k < k_e; k++, kp++) {
                         for (j = j_s, jp = jp_s; j < j_e; j++, jp++) {
                             for (i = i_s, ip = ip_s; i < i_e; i++, ip++) {
-                                x_ex(n,ip,jp,kp) = X(n,i,j,k);
+                                x_ex(ip,jp,kp) = X(n,i,j,k);
                             }
                         }
                     }
-                }
-            } else {
-                for (n = 0; n < ncol; n++) {
+                } else {
                     for (kp = kp_s; kp < kp_e; kp++) {
                         for (jp = jp_s; jp < jp_e; jp++) {
                             for (ip = ip_s; ip < ip_e; ip++) {
-                                x_ex(n,ip,jp,kp) = 0.0;
+                                x_ex(ip,jp,kp) = 0;
                             }
                         }
                     }
                 }
             }
         }
-    }
-    
+
     #ifdef USE_EVA_MODULE
-    st = MPI_Wtime();
+        et = MPI_Wtime();
+        unpk_t += et - st;
+        st = MPI_Wtime();
     #endif
-    
-    //int ind_ex;
-    // calculate Lx
-    for (n = 0; n < ncol; n++) {
-        stencil_3axis_thread_v2(
-            x_ex+n*DMnd_ex, FDn, pshifty[1], pshifty_ex[1], pshiftz[1], pshiftz_ex[1], 
-            0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, 
-            Lap_weights, w2_diag, _b, _v, y+n*ldo
+
+        // calculate the remaining part of Lx
+        stencil_boundary_shell(
+            x_ex, FDn, DMnx, DMny, DMnz, DMnx_ex, DMny_ex, has_interior,
+            Lap_weights, w2_diag, _b, _v, y+n*(unsigned)ldo
         );
+
+    #ifdef USE_EVA_MODULE
+        et = MPI_Wtime();
+        krnl_t += et - st;
+    #endif
     }
 
-    free(x_ex);
-    free(pshifty);
-    free(pshiftz);
-    free(pshifty_ex);
-    free(pshiftz_ex);
-    
+    if (nproc > 1) Halo_plan_release(halo);
     free(Lap_weights);
-    
+
     #ifdef USE_EVA_MODULE
-    et = MPI_Wtime();
-    krnl_t += et - st;
-    
     EVA_buff_timer_add(cpyx_t, pack_t, comm_t, unpk_t, krnl_t, 0.0);
     EVA_buff_rhs_add(ncol, 0);
     #endif
 
+    // each point takes FDn pairs of neighbors (2 adds, 1 mult) along 3 axes plus the diagonal terms
+    timing_add_counts(0.0, (9.0 * FDn + 4.0) * DMnd * ncol);
+    timing_region_end("Lap_plus_diag_vec_mult_orth");
+
 #undef X
 #undef x_ex
 }
@@ -621,14 +661,11 @@ void Lap_vec_mult_nonorth(
         double *y, const int ldo, MPI_Comm comm,  MPI_Comm comm2, const int *dims
 ) 
 {   
-    unsigned i;
     // Call the function for (a*Lap+b*v+c)x with b = 0 and v = NULL
-    for (i = 0; i < ncol; i++) {
-        Lap_plus_diag_vec_mult_nonorth(
-            pSPARC, DMnd, DMVertices, 1, a, 0.0, c, NULL, 
-            x+i*(unsigned)ldi, ldi, y+i*(unsigned)ldo, ldo, comm, comm2, dims
-        );
-    }
+    Lap_plus_diag_vec_mult_nonorth(
+        pSPARC, DMnd, DMVertices, ncol, a, 0.0, c, NULL, 
+        x, ldi, y, ldo, comm, comm2, dims
+    );
 }
 
 /**
@@ -931,11 +968,10 @@ void snd_rcv_buffer(
 
 /**
  * @brief   Calculate (a * Lap + b * diag(v) + c * I) times vectors.
- *          Warning:
- *            Although the function is intended for multiple vectors,
- *          it turns out to be slower than applying it to one vector
- *          at a time. So we will be calling this function ncol times
- *          if ncol is greater than 1.
+ *
+ *          The halos of all ncol vectors are exchanged in a single message. The
+ *          extended domain and the intermediate derivatives are then formed one 
+ *          vector at a time, so the work buffers are only as large as one vector.
  */
 void Lap_plus_diag_vec_mult_nonorth(
         const SPARC_OBJ *pSPARC, const int DMnd, const int *DMVertices,
@@ -951,6 +987,7 @@ void Lap_plus_diag_vec_mult_nonorth(
     
     const double *_v = v; double _b = b;
     if (fabs(b) < 1e-14 || v == NULL) _v = x, _b = 0.0;
+    timing_region_begin("Lap_plus_diag_vec_mult_nonorth");
 
     int nproc = dims[0] * dims[1] * dims[2];
     int periods[3];
@@ -997,7 +1034,7 @@ void Lap_plus_diag_vec_mult_nonorth(
     int nshift1, kshift1, jshift1;
     int kp, jp, ip;
     
-    MPI_Request request;    
+    HALO_PLAN_OBJ *halo = NULL;
     double *x_in, *x_out;
     x_in = NULL; x_out = NULL;
     // set up send-receive buffer based on the ordering of the neighbors
@@ -1006,33 +1043,21 @@ void Lap_plus_diag_vec_mult_nonorth(
     
     snd_rcv_buffer(nproc, dims, periods, FDn, DMnx, DMny, DMnz, istart, iend, jstart, jend, kstart, kend, istart_in, iend_in, jstart_in, jend_in, kstart_in, kend_in, isnonzero);
 
+    // number of halo values per vector exchanged with each neighbor
+    int nbr_size[26];
+    nbr_size[0] = nbr_size[2] = nbr_size[6] = nbr_size[8] = nbr_size[17] = nbr_size[19] = nbr_size[23] = nbr_size[25] = FDn * FDn * FDn;
+    nbr_size[1] = nbr_size[7] = nbr_size[18] = nbr_size[24] = DMnx * FDn * FDn;
+    nbr_size[3] = nbr_size[5] = nbr_size[20] = nbr_size[22] = FDn * DMny * FDn;
+    nbr_size[4] = nbr_size[21] = DMnxny * FDn;
+    nbr_size[9] = nbr_size[11] = nbr_size[14] = nbr_size[16] = FDn * FDn * DMnz;
+    nbr_size[10] = nbr_size[15] = DMnx * FDn * DMnz;
+    nbr_size[12] = nbr_size[13] = FDn * DMny * DMnz;
+
     if (nproc > 1) { // pack info and init Halo exchange
-    
-        int sendcounts[26], sdispls[26], recvcounts[26], rdispls[26];
-        // set up parameters for MPI_Ineighbor_alltoallv
-        // TODO: do this in Initialization to save computation time!
-        sendcounts[0] = sendcounts[2] = sendcounts[6] = sendcounts[8] = sendcounts[17] = sendcounts[19] = sendcounts[23] = sendcounts[25] = ncol * FDn * FDn * FDn;
-        sendcounts[1] = sendcounts[7] = sendcounts[18] = sendcounts[24] = ncol * DMnx * FDn * FDn;
-        sendcounts[3] = sendcounts[5] = sendcounts[20] = sendcounts[22] = ncol * FDn * DMny * FDn;
-        sendcounts[4] = sendcounts[21] = ncol * DMnxny * FDn;
-        sendcounts[9] = sendcounts[11] = sendcounts[14] = sendcounts[16] = ncol * FDn * FDn * DMnz;
-        sendcounts[10] = sendcounts[15] = ncol * DMnx * FDn * DMnz;
-        sendcounts[12] = sendcounts[13] = ncol * FDn * DMny * DMnz;
-        
-        for(i = 0; i < 26; i++){
-            recvcounts[i] = sendcounts[i];
-        }    
-        
-        rdispls[0] = sdispls[0] = 0;
-        for(i = 1; i < 26;i++){
-            rdispls[i] = sdispls[i] = sdispls[i-1] + sendcounts[i-1]; 
-        }
-       
-        int nd_in = ncol * 2 * FDn* (4 * FDn * FDn + 2 * FDn * (DMnx + DMny + DMnz) + (DMnxny + DMnx * DMnz + DMny * DMnz) );
-        int nd_out = nd_in;
-        x_in  = (double *)calloc( nd_in, sizeof(double)); // TODO: init to 0
-        x_out = (double *)malloc( nd_out * sizeof(double)); // no need to init x_out        
-        assert(x_in != NULL && x_out != NULL);
+        // the buffers are owned by the plan, x_in is 0 for the missing neighbors
+        halo = Halo_plan_get(comm2, MPI_DOUBLE, 26, nbr_size, ncol);
+        x_in  = (double *) halo->recvbuf;
+        x_out = (double *) halo->sendbuf;
 
         int nbr_i;
         count = 0;
@@ -1061,47 +1086,19 @@ void Lap_plus_diag_vec_mult_nonorth(
         #endif
         
         // first transfer info. to/from neighbor processors
-        //MPI_Request request;
-        MPI_Ineighbor_alltoallv(x_out, sendcounts, sdispls, MPI_DOUBLE, 
-                                x_in, recvcounts, rdispls, MPI_DOUBLE, 
-                                comm2, &request); // non-blocking
+        Halo_plan_start(halo); // non-blocking
+        timing_add_counts(sizeof(double) * halo->nd, 0.0);
     } 
-    
-    // overlap some work with communication
-    #ifdef USE_EVA_MODULE
-    st = MPI_Wtime();
-    #endif
 
     int pshifty = DMnx;
     int pshiftz = pshifty * DMny;
     int pshifty_ex = DMnx_ex;
     int pshiftz_ex = pshifty_ex * DMny_ex;
     
-    double *x_ex = (double *)calloc(ncol * DMnd_ex, sizeof(double));
-    assert(x_ex != NULL);
-    // copy x into extended x_ex
-    
-    for (n = 0; n < ncol; n++) {
-        nshift = n * DMnd_ex;
-        count = 0;
-        for (kp = FDn; kp < DMnz_out; kp++) {
-            kshift = nshift + kp * DMnxny_ex;
-            for (jp = FDn; jp < DMny_out; jp++) {
-                jshift = kshift + jp * DMnx_ex;
-                for (ip = FDn; ip < DMnx_out; ip++) {
-                    ind = jshift + ip;
-                    x_ex[ind] = x[count++ + n*ldi];
-                }
-            }
-        }
-    }
-    
-    #ifdef USE_EVA_MODULE
-    et = MPI_Wtime();
-    cpyx_t = et - st;
-    
-    st = MPI_Wtime();
-    #endif
+    // the extended domain of one vector is reused for all vectors and kept by
+    // the plan, the parts of the halo that are never received stay zero
+    double *x_ex = (double *)Halo_ex_buffer(comm2, halo, DMnd_ex * sizeof(double));
+    memset(x_ex, 0, DMnd_ex * sizeof(double));
                      
     int DMnxexny = DMnx_ex * DMny;
     int DMnd_xex = DMnxexny * DMnz;
@@ -1111,57 +1108,77 @@ void Lap_plus_diag_vec_mult_nonorth(
     double *Dx1, *Dx2;
     Dx1 = NULL; Dx2 = NULL;
     if(pSPARC->cell_typ == 11){
-        Dx1 = (double *) malloc(ncol * DMnd_xex * sizeof(double) ); // df/dy
+        Dx1 = (double *) malloc(DMnd_xex * sizeof(double) ); // df/dy
         assert(Dx1 != NULL);
     } else if(pSPARC->cell_typ == 12){
-        Dx1 = (double *) malloc(ncol * DMnd_xex * sizeof(double) ); // df/dz
+        Dx1 = (double *) malloc(DMnd_xex * sizeof(double) ); // df/dz
         assert(Dx1 != NULL);
     } else if(pSPARC->cell_typ == 13){
-        Dx1 = (double *) malloc(ncol * DMnd_yex * sizeof(double) ); // df/dz
+        Dx1 = (double *) malloc(DMnd_yex * sizeof(double) ); // df/dz
         assert(Dx1 != NULL);
     } else if(pSPARC->cell_typ == 14){
-        Dx1 = (double *) malloc(ncol * DMnd_xex * sizeof(double) ); // 2*T_12*df/dy + 2*T_13*df/dz
+        Dx1 = (double *) malloc(DMnd_xex * sizeof(double) ); // 2*T_12*df/dy + 2*T_13*df/dz
         assert(Dx1 != NULL);
     } else if(pSPARC->cell_typ == 15){
-        Dx1 = (double *) malloc(ncol * DMnd_zex * sizeof(double) ); // 2*T_13*dV/dx + 2*T_23*dV/dy
+        Dx1 = (double *) malloc(DMnd_zex * sizeof(double) ); // 2*T_13*dV/dx + 2*T_23*dV/dy
         assert(Dx1 != NULL);
     } else if(pSPARC->cell_typ == 16){
-        Dx1 = (double *) malloc(ncol * DMnd_yex * sizeof(double) ); // 2*T_12*dV/dx + 2*T_23*dV/dz
+        Dx1 = (double *) malloc(DMnd_yex * sizeof(double) ); // 2*T_12*dV/dx + 2*T_23*dV/dz
         assert(Dx1 != NULL);
     } else if(pSPARC->cell_typ == 17){
-        Dx1 = (double *) malloc(ncol * DMnd_xex * sizeof(double) ); // 2*T_12*df/dy + 2*T_13*df/dz
-        Dx2 = (double *) malloc(ncol * DMnd_yex * sizeof(double) ); // df/dz
+        Dx1 = (double *) malloc(DMnd_xex * sizeof(double) ); // 2*T_12*df/dy + 2*T_13*df/dz
+        Dx2 = (double *) malloc(DMnd_yex * sizeof(double) ); // df/dz
         assert(Dx1 != NULL && Dx2 != NULL);
     } else if(pSPARC->cell_typ == 21){
         // nothing required
     } else if(pSPARC->cell_typ > 21 && pSPARC->cell_typ < 30){
-        Dx1 = (double *) malloc(ncol * DMnd_yex * sizeof(double) ); // df/dz
+        Dx1 = (double *) malloc(DMnd_yex * sizeof(double) ); // df/dz
         assert(Dx1 != NULL);
     }
         
-    if (nproc > 1) { // unpack info and copy into x_ex
+    if (nproc > 1) {
         // make sure receive buffer is ready
         #ifdef USE_EVA_MODULE
         st = MPI_Wtime();
         #endif
-        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        timing_region_begin("halo_wait");
+        Halo_plan_wait(halo);
+        timing_region_end("halo_wait");
         #ifdef USE_EVA_MODULE
         et = MPI_Wtime();
         comm_t = et - st;
         #endif
-        
-        // copy receive buffer into extended domain
+    }
+
+    for (n = 0; n < ncol; n++) {
         #ifdef USE_EVA_MODULE
         st = MPI_Wtime();
         #endif
-    
-        // copy receive buffer into extended domain
+
+        // copy x into extended x_ex
         count = 0;
-        for (nbrcount = 0; nbrcount < 26; nbrcount++) {
-            for (n = 0; n < ncol; n++) {
-                nshift = n * DMnd_ex;
+        for (kp = FDn; kp < DMnz_out; kp++) {
+            kshift = kp * DMnxny_ex;
+            for (jp = FDn; jp < DMny_out; jp++) {
+                jshift = kshift + jp * DMnx_ex;
+                for (ip = FDn; ip < DMnx_out; ip++) {
+                    ind = jshift + ip;
+                    x_ex[ind] = x[count++ + n*ldi];
+                }
+            }
+        }
+
+        #ifdef USE_EVA_MODULE
+        et = MPI_Wtime();
+        cpyx_t += et - st;
+        st = MPI_Wtime();
+        #endif
+
+        if (nproc > 1) { // unpack info and copy into x_ex
+            for (nbrcount = 0; nbrcount < 26; nbrcount++) {
+                count = halo->displs[nbrcount] + n * nbr_size[nbrcount];
                 for (k = kstart_in[nbrcount]; k < kend_in[nbrcount]; k++) {
-                    kshift = nshift + k * DMnxny_ex;
+                    kshift = k * DMnxny_ex;
                     for (j = jstart_in[nbrcount]; j < jend_in[nbrcount]; j++) {
                         jshift = kshift + j * DMnx_ex;
                         for (i = istart_in[nbrcount]; i < iend_in[nbrcount]; i++) {
@@ -1171,22 +1188,12 @@ void Lap_plus_diag_vec_mult_nonorth(
                     }
                 }
             }
-        }
-    
-        free(x_out);
-        free(x_in);
-        
-        #ifdef USE_EVA_MODULE
-        et = MPI_Wtime();
-        unpk_t = et - st;
-        #endif
-    } else {
-        int nbr_i, ind1;
-        // copy the extended part from x into x_ex
-        for (nbr_i = 0; nbr_i < 26; nbr_i++) {
-            if(isnonzero[nbr_i]){
-                for (n = 0; n < ncol; n++) {
-                    nshift = n * ldi; nshift1 = n * DMnd_ex;
+        } else {
+            int nbr_i, ind1;
+            // copy the extended part from x into x_ex
+            for (nbr_i = 0; nbr_i < 26; nbr_i++) {
+                if(isnonzero[nbr_i]){
+                    nshift = n * ldi; nshift1 = 0;
                     for (k = kstart[nbr_i], kp = kstart_in[nbr_i]; k < kend[nbr_i]; k++, kp++) {
                         kshift = nshift + k * DMnxny; kshift1 = nshift1 + kp * DMnxny_ex;
                         for (j = jstart[nbr_i], jp = jstart_in[nbr_i]; j < jend[nbr_i]; j++, jp++) {
@@ -1198,136 +1205,93 @@ void Lap_plus_diag_vec_mult_nonorth(
                             }
                         }
                     }
-                }
-            }    
-        }
-    }   
+                }    
+            }
+        }   
 
-    #ifdef USE_EVA_MODULE
-    st = MPI_Wtime();
-    #endif
+        #ifdef USE_EVA_MODULE
+        et = MPI_Wtime();
+        unpk_t += et - st;
+        st = MPI_Wtime();
+        #endif
 
-    if(pSPARC->cell_typ == 11){
         // calculate Lx
-        for (n = 0; n < ncol; n++) {
-            Calc_DX(x_ex+n*DMnd_ex, Dx1+n*DMnd_xex, FDn, pshifty_ex, pshifty_ex, DMnx_ex, pshiftz_ex, DMnxexny,
+        double *yn = y + n*ldo;
+        if(pSPARC->cell_typ == 11){
+            Calc_DX(x_ex, Dx1, FDn, pshifty_ex, pshifty_ex, DMnx_ex, pshiftz_ex, DMnxexny,
                         0, DMnx_ex, 0, DMny, 0, DMnz, 0, FDn, FDn, pSPARC->D1_stencil_coeffs_y, 0.0);
-        }
 
-        for (n = 0; n < ncol; n++) {
-            stencil_4comp(x_ex+n*DMnd_ex, Dx1+n*DMnd_xex, FDn, 1, pshifty, pshifty_ex, DMnx_ex, pshiftz, pshiftz_ex, DMnxexny,
-                                0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, FDn, 0, 0, Lap_wt, w2_diag, _b, _v, y+n*ldo);
-        }
-
-        free(Dx1); Dx1 = NULL;
-    } else if(pSPARC->cell_typ == 12){
-        // calculate Lx
-        for (n = 0; n < ncol; n++) {
-            Calc_DX(x_ex+n*DMnd_ex, Dx1+n*DMnd_xex, FDn, pshiftz_ex, pshifty_ex, DMnx_ex, pshiftz_ex, DMnxexny,
+            stencil_4comp(x_ex, Dx1, FDn, 1, pshifty, pshifty_ex, DMnx_ex, pshiftz, pshiftz_ex, DMnxexny,
+                                0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, FDn, 0, 0, Lap_wt, w2_diag, _b, _v, yn);
+        } else if(pSPARC->cell_typ == 12){
+            Calc_DX(x_ex, Dx1, FDn, pshiftz_ex, pshifty_ex, DMnx_ex, pshiftz_ex, DMnxexny,
                         0, DMnx_ex, 0, DMny, 0, DMnz, 0, FDn, FDn, pSPARC->D1_stencil_coeffs_z, 0.0);
-        }
-
-        for (n = 0; n < ncol; n++) {
-            stencil_4comp(x_ex+n*DMnd_ex, Dx1+n*DMnd_xex, FDn, 1, pshifty, pshifty_ex, DMnx_ex, pshiftz, pshiftz_ex, DMnxexny,
-                                0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, FDn, 0, 0, Lap_wt, w2_diag, _b, _v, y+n*ldo);
-        }
 
-        free(Dx1); Dx1 = NULL;
-    } else if(pSPARC->cell_typ == 13){
-        // calculate Lx
-        for (n = 0; n < ncol; n++) {
-            Calc_DX(x_ex+n*DMnd_ex, Dx1+n*DMnd_yex, FDn, pshiftz_ex, pshifty_ex, DMnx, pshiftz_ex, DMnxnyex,
+            stencil_4comp(x_ex, Dx1, FDn, 1, pshifty, pshifty_ex, DMnx_ex, pshiftz, pshiftz_ex, DMnxexny,
+                                0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, FDn, 0, 0, Lap_wt, w2_diag, _b, _v, yn);
+        } else if(pSPARC->cell_typ == 13){
+            Calc_DX(x_ex, Dx1, FDn, pshiftz_ex, pshifty_ex, DMnx, pshiftz_ex, DMnxnyex,
                     0, DMnx, 0, DMny_ex, 0, DMnz, FDn, 0, FDn, pSPARC->D1_stencil_coeffs_z, 0.0);
-        }
-
-        for (n = 0; n < ncol; n++) {
-            stencil_4comp(x_ex+n*DMnd_ex, Dx1+n*DMnd_yex, FDn, DMnx, pshifty, pshifty_ex, DMnx, pshiftz, pshiftz_ex, DMnxnyex,
-                            0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, 0, FDn, 0, Lap_wt, w2_diag, _b, _v, y+n*ldo);
-        }
 
-        free(Dx1); Dx1 = NULL;
-    } else if(pSPARC->cell_typ == 14){
-        for (n = 0; n < ncol; n++) {
-            Calc_DX1_DX2(x_ex+n*DMnd_ex, Dx1+n*DMnd_xex, FDn, pshifty_ex, pshiftz_ex, pshifty_ex, DMnx_ex, pshiftz_ex, DMnxexny,
+            stencil_4comp(x_ex, Dx1, FDn, DMnx, pshifty, pshifty_ex, DMnx, pshiftz, pshiftz_ex, DMnxnyex,
+                            0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, 0, FDn, 0, Lap_wt, w2_diag, _b, _v, yn);
+        } else if(pSPARC->cell_typ == 14){
+            Calc_DX1_DX2(x_ex, Dx1, FDn, pshifty_ex, pshiftz_ex, pshifty_ex, DMnx_ex, pshiftz_ex, DMnxexny,
                             0, DMnx_ex, 0, DMny, 0, DMnz, 0, FDn, FDn, pSPARC->D1_stencil_coeffs_xy, pSPARC->D1_stencil_coeffs_xz);
-        }
 
-        for (n = 0; n < ncol; n++) {
-            stencil_4comp(x_ex+n*DMnd_ex, Dx1+n*DMnd_xex, FDn, 1, pshifty, pshifty_ex, DMnx_ex, pshiftz, pshiftz_ex, DMnxexny,
-                            0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, FDn, 0, 0, Lap_wt, w2_diag, _b, _v, y+n*ldo);
-        }
-        free(Dx1); Dx1 = NULL;
-    } else if(pSPARC->cell_typ == 15){
-        for (n = 0; n < ncol; n++) {
-            Calc_DX1_DX2(x_ex+n*DMnd_ex, Dx1+n*DMnd_zex, FDn, 1, pshifty_ex, pshifty_ex, DMnx, pshiftz_ex, DMnxny,
+            stencil_4comp(x_ex, Dx1, FDn, 1, pshifty, pshifty_ex, DMnx_ex, pshiftz, pshiftz_ex, DMnxexny,
+                            0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, FDn, 0, 0, Lap_wt, w2_diag, _b, _v, yn);
+        } else if(pSPARC->cell_typ == 15){
+            Calc_DX1_DX2(x_ex, Dx1, FDn, 1, pshifty_ex, pshifty_ex, DMnx, pshiftz_ex, DMnxny,
                             0, DMnx, 0, DMny, 0, DMnz_ex, FDn, FDn, 0, pSPARC->D1_stencil_coeffs_zx, pSPARC->D1_stencil_coeffs_zy);
-        }
 
-        for (n = 0; n < ncol; n++) {
-            stencil_4comp(x_ex+n*DMnd_ex, Dx1+n*DMnd_zex, FDn, DMnxny, pshifty, pshifty_ex, DMnx, pshiftz, pshiftz_ex, DMnxny,
-                            0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, 0, 0, FDn, Lap_wt, w2_diag, _b, _v, y+n*ldo);
-        }
-        free(Dx1); Dx1 = NULL;
-    } else if(pSPARC->cell_typ == 16){
-        for (n = 0; n < ncol; n++) {
-            Calc_DX1_DX2(x_ex+n*DMnd_ex, Dx1+n*DMnd_yex, FDn, 1, pshiftz_ex, pshifty_ex, DMnx, pshiftz_ex, DMnxnyex,
+            stencil_4comp(x_ex, Dx1, FDn, DMnxny, pshifty, pshifty_ex, DMnx, pshiftz, pshiftz_ex, DMnxny,
+                            0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, 0, 0, FDn, Lap_wt, w2_diag, _b, _v, yn);
+        } else if(pSPARC->cell_typ == 16){
+            Calc_DX1_DX2(x_ex, Dx1, FDn, 1, pshiftz_ex, pshifty_ex, DMnx, pshiftz_ex, DMnxnyex,
                             0, DMnx, 0, DMny_ex, 0, DMnz, FDn, 0, FDn, pSPARC->D1_stencil_coeffs_yx, pSPARC->D1_stencil_coeffs_yz);
-        }
 
-        for (n = 0; n < ncol; n++) {
-            stencil_4comp(x_ex+n*DMnd_ex, Dx1+n*DMnd_yex, FDn, DMnx, pshifty, pshifty_ex, DMnx, pshiftz, pshiftz_ex, DMnxnyex,
-                            0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, 0, FDn, 0, Lap_wt, w2_diag, _b, _v, y+n*ldo);
-        }
-        free(Dx1); Dx1 = NULL;
-    } else if(pSPARC->cell_typ == 17){
-        for (n = 0; n < ncol; n++) {
-            Calc_DX1_DX2(x_ex+n*DMnd_ex, Dx1+n*DMnd_xex, FDn, pshifty_ex, pshiftz_ex, pshifty_ex, DMnx_ex, pshiftz_ex, DMnxexny,
+            stencil_4comp(x_ex, Dx1, FDn, DMnx, pshifty, pshifty_ex, DMnx, pshiftz, pshiftz_ex, DMnxnyex,
+                            0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, 0, FDn, 0, Lap_wt, w2_diag, _b, _v, yn);
+        } else if(pSPARC->cell_typ == 17){
+            Calc_DX1_DX2(x_ex, Dx1, FDn, pshifty_ex, pshiftz_ex, pshifty_ex, DMnx_ex, pshiftz_ex, DMnxexny,
                                 0, DMnx_ex, 0, DMny, 0, DMnz, 0, FDn, FDn, pSPARC->D1_stencil_coeffs_xy, pSPARC->D1_stencil_coeffs_xz);
 
-            Calc_DX(x_ex+n*DMnd_ex, Dx2+n*DMnd_yex, FDn, pshiftz_ex, pshifty_ex, DMnx, pshiftz_ex, DMnxnyex,
+            Calc_DX(x_ex, Dx2, FDn, pshiftz_ex, pshifty_ex, DMnx, pshiftz_ex, DMnxnyex,
                         0, DMnx, 0, DMny_ex, 0, DMnz, FDn, 0, FDn, pSPARC->D1_stencil_coeffs_z, 0.0);
-        }
 
-        for (n = 0; n < ncol; n++) {
-            stencil_5comp(x_ex+n*DMnd_ex, Dx1+n*DMnd_xex, Dx2+n*DMnd_yex, FDn, 1, DMnx, pshifty, pshifty_ex, DMnx_ex, DMnx,
+            stencil_5comp(x_ex, Dx1, Dx2, FDn, 1, DMnx, pshifty, pshifty_ex, DMnx_ex, DMnx,
                                 pshiftz, pshiftz_ex, DMnxexny, DMnxnyex,
-                                0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, FDn, 0, 0, 0, FDn, 0, Lap_wt, w2_diag, _b, _v, y+n*ldo);
-        }
-        free(Dx1); Dx1 = NULL;
-        free(Dx2); Dx2 = NULL;
-    } else if(pSPARC->cell_typ == 21) {
-        // calculate Lx
-        for (n = 0; n < ncol; n++) {
-            stencil_4comp_cyclix(pSPARC,x_ex+n*DMnd_ex, FDn, pshifty, pshifty_ex, pshiftz, pshiftz_ex,
+                                0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, FDn, 0, 0, 0, FDn, 0, Lap_wt, w2_diag, _b, _v, yn);
+        } else if(pSPARC->cell_typ == 21) {
+            stencil_4comp_cyclix(pSPARC,x_ex, FDn, pshifty, pshifty_ex, pshiftz, pshiftz_ex,
                         0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn,
-                        Lap_wt, w2_diag, _b, pSPARC->xin + DMVertices[0] * pSPARC->delta_x, a, _v, y+n*ldo);
-        }
-    } else if (pSPARC->cell_typ > 21 && pSPARC->cell_typ < 30) {
-        // calculate Lx
-        for (n = 0; n < ncol; n++) {
-            Calc_DX(x_ex+n*DMnd_ex, Dx1+n*DMnd_yex, FDn, pshiftz_ex, pshifty_ex, DMnx, pshiftz_ex, DMnxnyex,
+                        Lap_wt, w2_diag, _b, pSPARC->xin + DMVertices[0] * pSPARC->delta_x, a, _v, yn);
+        } else if (pSPARC->cell_typ > 21 && pSPARC->cell_typ < 30) {
+            Calc_DX(x_ex, Dx1, FDn, pshiftz_ex, pshifty_ex, DMnx, pshiftz_ex, DMnxnyex,
                     0, DMnx, 0, DMny_ex, 0, DMnz, FDn, 0, FDn, pSPARC->D1_stencil_coeffs_z, 0.0);
-        }
 
-        for (n = 0; n < ncol; n++) {
-            stencil_5comp_cyclix(pSPARC,x_ex+n*DMnd_ex, Dx1+n*DMnd_yex, FDn, DMnx, pshifty, pshifty_ex, DMnx, pshiftz, pshiftz_ex, DMnxnyex,
+            stencil_5comp_cyclix(pSPARC,x_ex, Dx1, FDn, DMnx, pshifty, pshifty_ex, DMnx, pshiftz, pshiftz_ex, DMnxnyex,
                         0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn, 0, FDn, 0,
-                        Lap_wt, w2_diag, _b, pSPARC->xin + DMVertices[0] * pSPARC->delta_x, a, _v, y+n*ldo);
+                        Lap_wt, w2_diag, _b, pSPARC->xin + DMVertices[0] * pSPARC->delta_x, a, _v, yn);
         }
 
-        free(Dx1); Dx1 = NULL;
+        #ifdef USE_EVA_MODULE
+        et = MPI_Wtime();
+        krnl_t += et - st;
+        #endif
     }
 
-    free(x_ex);
+    if (nproc > 1) Halo_plan_release(halo);
+    free(Dx1);
+    free(Dx2);
     free(Lap_wt);
     
     #ifdef USE_EVA_MODULE
-    et = MPI_Wtime();
-    krnl_t += et - st;
-    
     EVA_buff_timer_add(cpyx_t, pack_t, comm_t, unpk_t, krnl_t, 0.0);
     EVA_buff_rhs_add(ncol, 0);
     #endif
+    timing_region_end("Lap_plus_diag_vec_mult_nonorth");
 }
 
 
@@ -1443,8 +1407,10 @@ void Calc_DX1_DX2(
 {
     int i, j, k, jj, kk, r;
     
-    for (k = z_DX_spos, kk = z_X_spos; k < z_DX_epos; k++, kk++)
+    #pragma omp parallel for private(i, j, jj, kk, r) schedule(static)
+    for (k = z_DX_spos; k < z_DX_epos; k++)
     {
+        kk = z_X_spos + (k - z_DX_spos);
         int kshift_DX = k * stride_z_DX;
         int kshift_X = kk * stride_z_X;
         for (j = y_DX_spos, jj = y_X_spos; j < y_DX_epos; j++, jj++)
@@ -1497,8 +1463,11 @@ void stencil_4comp(
 {
     int i, j, k, jj, kk, jjj, kkk, r;
     
-    for (k = z_X1_spos, kk = z_X_spos, kkk = z_DX_spos; k < z_X1_epos; k++, kk++, kkk++)
+    #pragma omp parallel for private(i, j, jj, kk, jjj, kkk, r) schedule(static)
+    for (k = z_X1_spos; k < z_X1_epos; k++)
     {
+        kk = z_X_spos + (k - z_X1_spos);
+        kkk = z_DX_spos + (k - z_X1_spos);
         int kshift_X1 = k * stride_z_X1;
         int kshift_X  = kk * stride_z_X;
         int kshift_DX = kkk * stride_z_DX;
@@ -1560,8 +1529,12 @@ void stencil_5comp(
 {
     int i, j, k, jj, kk, jjj, kkk, jjjj, kkkk, r;
     
-    for (k = z_X1_spos, kk = z_X_spos, kkk = z_DX1_spos, kkkk = z_DX2_spos; k < z_X1_epos; k++, kk++, kkk++, kkkk++)
+    #pragma omp parallel for private(i, j, jj, kk, jjj, kkk, jjjj, kkkk, r) schedule(static)
+    for (k = z_X1_spos; k < z_X1_epos; k++)
     {
+        kk = z_X_spos + (k - z_X1_spos);
+        kkk = z_DX1_spos + (k - z_X1_spos);
+        kkkk = z_DX2_spos + (k - z_X1_spos);
         int kshift_X1 = k * stride_z_X1;
         int kshift_X  = kk * stride_z_X;
         int kshift_DX1 = kkk * stride_z_DX1;
@@ -1624,8 +1597,11 @@ void stencil_4comp_extd(
 {
     int i, j, k, jj, kk, jjj, kkk, r;
     
-    for (k = z_X1_spos, kk = z_X_spos, kkk = z_DX_spos; k < z_X1_epos; k++, kk++, kkk++)
+    #pragma omp parallel for private(i, j, jj, kk, jjj, kkk, r) schedule(static)
+    for (k = z_X1_spos; k < z_X1_epos; k++)
     {
+        kk = z_X_spos + (k - z_X1_spos);
+        kkk = z_DX_spos + (k - z_X1_spos);
         int kshift_X1 = k * stride_z_X1;
         int kshift_X  = kk * stride_z_X;
         int kshift_DX = kkk * stride_z_DX;
@@ -1688,8 +1664,12 @@ void stencil_5comp_extd(
 {
     int i, j, k, jj, kk, jjj, kkk, jjjj, kkkk, r;
     
-    for (k = z_X1_spos, kk = z_X_spos, kkk = z_DX1_spos, kkkk = z_DX2_spos; k < z_X1_epos; k++, kk++, kkk++, kkkk++)
+    #pragma omp parallel for private(i, j, jj, kk, jjj, kkk, jjjj, kkkk, r) schedule(static)
+    for (k = z_X1_spos; k < z_X1_epos; k++)
     {
+        kk = z_X_spos + (k - z_X1_spos);
+        kkk = z_DX1_spos + (k - z_X1_spos);
+        kkkk = z_DX2_spos + (k - z_X1_spos);
         int kshift_X1 = k * stride_z_X1;
         int kshift_X  = kk * stride_z_X;
         int kshift_DX1 = kkk * stride_z_DX1;
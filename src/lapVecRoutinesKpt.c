@@ -15,6 +15,7 @@
 #include <complex.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 #include <mpi.h>
@@ -25,6 +26,8 @@
 #include "tools.h"
 #include "isddft.h"
 #include "cyclix_lapVec.h"
+#include "timing.h"
+#include "haloExchange.h"
 
 #ifdef USE_EVA_MODULE
 #include "ExtVecAccel/ExtVecAccel.h"
@@ -133,8 +136,10 @@ void stencil_3axis_thread_complex_v2(
 {
     int i, j, k, jp, kp, r;
     const int shift_ip = x_ex_spos - x_spos;
-    for (k = z_spos, kp = z_ex_spos; k < z_epos; k++, kp++)
+    #pragma omp parallel for private(i, j, jp, kp, r) schedule(static)
+    for (k = z_spos; k < z_epos; k++)
     {
+        kp = z_ex_spos + (k - z_spos);
         for (j = y_spos, jp = y_ex_spos; j < y_epos; j++, jp++)
         {
             int offset = k * stride_z + j * stride_y;
@@ -193,6 +198,7 @@ void Lap_plus_diag_vec_mult_orth_kpt(
 
     const double *_v = v; double _b = b; 
     if (fabs(b) < 1e-14 || v == NULL) _v = (double * )x, _b = 0.0;
+    timing_region_begin("Lap_plus_diag_vec_mult_orth_kpt");
     
     int nproc = dims[0] * dims[1] * dims[2];
     int gridsizes[3];
@@ -256,19 +262,21 @@ void Lap_plus_diag_vec_mult_orth_kpt(
         kstart[6] = {0,    0,        0,    0,        0,    DMnz_in}, 
           kend[6] = {DMnz, DMnz,     DMnz, DMnz,     FDn,  DMnz};
     
+    // number of halo values per vector exchanged with each neighbor
+    int nbr_size[6];
+    nbr_size[0] = nbr_size[1] = FDn * (DMny * DMnz);
+    nbr_size[2] = nbr_size[3] = FDn * (DMnx * DMnz);
+    nbr_size[4] = nbr_size[5] = FDn * (DMnx * DMny);
+
     int nbrcount;
-    MPI_Request request;
+    HALO_PLAN_OBJ *halo = NULL;
     double _Complex *x_in, *x_out;
     x_in = NULL; x_out = NULL;
     if (nproc > 1) { // pack info and init Halo exchange
-        // TODO: we have to take BC into account here!
-        int nd_in = ncol * pSPARC->order * (DMnx*DMny + DMny*DMnz + DMnx*DMnz);
-        int nd_out = nd_in;
-        
-        // Notice here we init x_in to 0
-        x_in  = (double _Complex *)calloc( nd_in, sizeof(double _Complex)); 
-        x_out = (double _Complex *)malloc( nd_out * sizeof(double _Complex)); // no need to init x_out
-        assert(x_in != NULL && x_out != NULL);
+        // the buffers are owned by the plan, x_in is 0 for the missing neighbors
+        halo = Halo_plan_get(comm, MPI_DOUBLE_COMPLEX, 6, nbr_size, ncol);
+        x_in  = (double _Complex *) halo->recvbuf;
+        x_out = (double _Complex *) halo->sendbuf;
 
         int nbr_i, n, k, j, i, count = 0;
         for (nbr_i = 0; nbr_i < 6; nbr_i++) {
@@ -296,25 +304,9 @@ void Lap_plus_diag_vec_mult_orth_kpt(
         pack_t = et - st;
         #endif
         
-        int sendcounts[6], sdispls[6], recvcounts[6], rdispls[6];
-        // set up parameters for MPI_Ineighbor_alltoallv
-        // TODO: do this in Initialization to save computation time!
-        sendcounts[0] = sendcounts[1] = recvcounts[0] = recvcounts[1] = ncol * FDn * (DMny * DMnz);
-        sendcounts[2] = sendcounts[3] = recvcounts[2] = recvcounts[3] = ncol * FDn * (DMnx * DMnz);
-        sendcounts[4] = sendcounts[5] = recvcounts[4] = recvcounts[5] = ncol * FDn * (DMnx * DMny);
-        
-        rdispls[0] = sdispls[0] = 0;
-        rdispls[1] = sdispls[1] = sdispls[0] + sendcounts[0];
-        rdispls[2] = sdispls[2] = sdispls[1] + sendcounts[1];
-        rdispls[3] = sdispls[3] = sdispls[2] + sendcounts[2];
-        rdispls[4] = sdispls[4] = sdispls[3] + sendcounts[3];
-        rdispls[5] = sdispls[5] = sdispls[4] + sendcounts[4];
-        
         // first transfer info. to/from neighbor processors
-        //MPI_Request request;
-        MPI_Ineighbor_alltoallv(x_out, sendcounts, sdispls, MPI_DOUBLE_COMPLEX, 
-                                x_in, recvcounts, rdispls, MPI_DOUBLE_COMPLEX,
-                                comm, &request); // non-blocking
+        Halo_plan_start(halo); // non-blocking
+        timing_add_counts(sizeof(double _Complex) * halo->nd, 0.0);
     }
     
     // overlap some work with communication
@@ -326,7 +318,8 @@ void Lap_plus_diag_vec_mult_orth_kpt(
     int *pshiftz    = (int *)malloc( (FDn+1) * sizeof(int));
     int *pshifty_ex = (int *)malloc( (FDn+1) * sizeof(int));
     int *pshiftz_ex = (int *)malloc( (FDn+1) * sizeof(int));
-    double _Complex *x_ex = (double _Complex *)malloc(ncol * DMnd_ex * sizeof(double _Complex));
+    // the extended domain is kept by the plan
+    double _Complex *x_ex = (double _Complex *)Halo_ex_buffer(comm, halo, ncol * DMnd_ex * sizeof(double _Complex));
     pshifty[0] = pshiftz[0] = pshifty_ex[0] = pshiftz_ex[0] = 0;
     for (p = 1; p <= FDn; p++) {
         // for x
@@ -386,7 +379,9 @@ void Lap_plus_diag_vec_mult_orth_kpt(
         #ifdef USE_EVA_MODULE
         st = MPI_Wtime();
         #endif
-        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        timing_region_begin("halo_wait");
+        Halo_plan_wait(halo);
+        timing_region_end("halo_wait");
         #ifdef USE_EVA_MODULE
         et = MPI_Wtime();
         comm_t = et - st;
@@ -421,9 +416,6 @@ void Lap_plus_diag_vec_mult_orth_kpt(
             }
         }
         
-        free(x_out);
-        free(x_in);
-        
         #ifdef USE_EVA_MODULE
         et = MPI_Wtime();
         unpk_t = et - st;
@@ -492,7 +484,7 @@ void Lap_plus_diag_vec_mult_orth_kpt(
         );
     }
 
-    free(x_ex);
+    if (nproc > 1) Halo_plan_release(halo);
     free(pshifty);
     free(pshiftz);
     free(pshifty_ex);
@@ -508,6 +500,10 @@ void Lap_plus_diag_vec_mult_orth_kpt(
     EVA_buff_rhs_add(ncol, 0);
     #endif
 
+    // each point takes FDn pairs of neighbors (2 adds, 1 mult) along 3 axes plus the diagonal terms
+    timing_add_counts(0.0, 2.0 * (9.0 * FDn + 4.0) * DMnd * ncol);
+    timing_region_end("Lap_plus_diag_vec_mult_orth_kpt");
+
 #undef X
 #undef x_ex
 }
@@ -578,6 +574,7 @@ void Lap_plus_diag_vec_mult_nonorth_kpt(
 
     const double *_v = v; double _b = b;
     if (fabs(b) < 1e-14 || v == NULL) _v = (double * )x, _b = 0.0;
+    timing_region_begin("Lap_plus_diag_vec_mult_nonorth_kpt");
 
     int nproc = dims[0] * dims[1] * dims[2];
     double Lx = pSPARC->range_x;
@@ -635,7 +632,7 @@ void Lap_plus_diag_vec_mult_nonorth_kpt(
     int nshift1, kshift1, jshift1;
     int kp, jp, ip;
 
-    MPI_Request request;
+    HALO_PLAN_OBJ *halo = NULL;
     double _Complex *x_in, *x_out;
     x_in = NULL; x_out = NULL;
     // set up send-receive buffer based on the ordering of the neighbors
@@ -661,31 +658,20 @@ void Lap_plus_diag_vec_mult_nonorth_kpt(
 
     if (nproc > 1) { // pack info and init Halo exchange
 
-        int sendcounts[26], sdispls[26], recvcounts[26], rdispls[26];
-        // set up parameters for MPI_Ineighbor_alltoallv
-        // TODO: do this in Initialization to save computation time!
-        sendcounts[0] = sendcounts[2] = sendcounts[6] = sendcounts[8] = sendcounts[17] = sendcounts[19] = sendcounts[23] = sendcounts[25] = ncol * FDn * FDn * FDn;
-        sendcounts[1] = sendcounts[7] = sendcounts[18] = sendcounts[24] = ncol * DMnx * FDn * FDn;
-        sendcounts[3] = sendcounts[5] = sendcounts[20] = sendcounts[22] = ncol * FDn * DMny * FDn;
-        sendcounts[4] = sendcounts[21] = ncol * DMnxny * FDn;
-        sendcounts[9] = sendcounts[11] = sendcounts[14] = sendcounts[16] = ncol * FDn * FDn * DMnz;
-        sendcounts[10] = sendcounts[15] = ncol * DMnx * FDn * DMnz;
-        sendcounts[12] = sendcounts[13] = ncol * FDn * DMny * DMnz;
-
-        for(i = 0; i < 26; i++){
-            recvcounts[i] = sendcounts[i];
-        }
-
-        rdispls[0] = sdispls[0] = 0;
-        for(i = 1; i < 26;i++){
-            rdispls[i] = sdispls[i] = sdispls[i-1] + sendcounts[i-1];
-        }
-
-        int nd_in = ncol * 2 * FDn* (4 * FDn * FDn + 2 * FDn * (DMnx + DMny + DMnz) + (DMnxny + DMnx * DMnz + DMny * DMnz) );
-        int nd_out = nd_in;
-        x_in  = (double _Complex *)calloc( nd_in, sizeof(double _Complex)); // TODO: init to 0
-        x_out = (double _Complex *)malloc( nd_out * sizeof(double _Complex)); // no need to init x_out
-        assert(x_in != NULL && x_out != NULL);
+        // number of halo values per vector exchanged with each neighbor
+        int nbr_size[26];
+        nbr_size[0] = nbr_size[2] = nbr_size[6] = nbr_size[8] = nbr_size[17] = nbr_size[19] = nbr_size[23] = nbr_size[25] = FDn * FDn * FDn;
+        nbr_size[1] = nbr_size[7] = nbr_size[18] = nbr_size[24] = DMnx * FDn * FDn;
+        nbr_size[3] = nbr_size[5] = nbr_size[20] = nbr_size[22] = FDn * DMny * FDn;
+        nbr_size[4] = nbr_size[21] = DMnxny * FDn;
+        nbr_size[9] = nbr_size[11] = nbr_size[14] = nbr_size[16] = FDn * FDn * DMnz;
+        nbr_size[10] = nbr_size[15] = DMnx * FDn * DMnz;
+        nbr_size[12] = nbr_size[13] = FDn * DMny * DMnz;
+
+        // the buffers are owned by the plan, x_in is 0 for the missing neighbors
+        halo = Halo_plan_get(comm2, MPI_DOUBLE_COMPLEX, 26, nbr_size, ncol);
+        x_in  = (double _Complex *) halo->recvbuf;
+        x_out = (double _Complex *) halo->sendbuf;
 
         int nbr_i;
         count = 0;
@@ -714,10 +700,8 @@ void Lap_plus_diag_vec_mult_nonorth_kpt(
         #endif
 
         // first transfer info. to/from neighbor processors
-        //MPI_Request request;
-        MPI_Ineighbor_alltoallv(x_out, sendcounts, sdispls, MPI_DOUBLE_COMPLEX,
-                                x_in, recvcounts, rdispls, MPI_DOUBLE_COMPLEX,
-                                comm2, &request); // non-blocking
+        Halo_plan_start(halo); // non-blocking
+        timing_add_counts(sizeof(double _Complex) * halo->nd, 0.0);
     }
 
     // overlap some work with communication
@@ -730,8 +714,9 @@ void Lap_plus_diag_vec_mult_nonorth_kpt(
     int pshifty_ex = DMnx_ex;
     int pshiftz_ex = pshifty_ex * DMny_ex;
 
-    double _Complex *x_ex = (double _Complex *)calloc(ncol * DMnd_ex, sizeof(double _Complex));
-    assert(x_ex != NULL);
+    // the extended domain is kept by the plan
+    double _Complex *x_ex = (double _Complex *)Halo_ex_buffer(comm2, halo, ncol * DMnd_ex * sizeof(double _Complex));
+    memset(x_ex, 0, ncol * DMnd_ex * sizeof(double _Complex));
     // copy x into extended x_ex
     for (n = 0; n < ncol; n++) {
         nshift = n * DMnd_ex;
@@ -796,7 +781,9 @@ void Lap_plus_diag_vec_mult_nonorth_kpt(
         #ifdef USE_EVA_MODULE
         st = MPI_Wtime();
         #endif
-        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        timing_region_begin("halo_wait");
+        Halo_plan_wait(halo);
+        timing_region_end("halo_wait");
         #ifdef USE_EVA_MODULE
         et = MPI_Wtime();
         comm_t = et - st;
@@ -830,9 +817,6 @@ void Lap_plus_diag_vec_mult_nonorth_kpt(
             }
         }
 
-        free(x_out);
-        free(x_in);
-
         #ifdef USE_EVA_MODULE
         et = MPI_Wtime();
         unpk_t = et - st;
@@ -978,7 +962,7 @@ void Lap_plus_diag_vec_mult_nonorth_kpt(
         free(Dx1); Dx1 = NULL;
     }
 
-    free(x_ex);
+    if (nproc > 1) Halo_plan_release(halo);
     free(Lap_wt);
 
     #ifdef USE_EVA_MODULE
@@ -988,6 +972,7 @@ void Lap_plus_diag_vec_mult_nonorth_kpt(
     EVA_buff_timer_add(cpyx_t, pack_t, comm_t, unpk_t, krnl_t, 0.0);
     EVA_buff_rhs_add(ncol, 0);
     #endif
+    timing_region_end("Lap_plus_diag_vec_mult_nonorth_kpt");
 }
 
 
@@ -1011,8 +996,10 @@ void Calc_DX1_DX2_kpt(
 {
     int i, j, k, jj, kk, r;
 
-    for (k = z_DX_spos, kk = z_X_spos; k < z_DX_epos; k++, kk++)
+    #pragma omp parallel for private(i, j, jj, kk, r) schedule(static)
+    for (k = z_DX_spos; k < z_DX_epos; k++)
     {
+        kk = z_X_spos + (k - z_DX_spos);
         int kshift_DX = k * stride_z_DX;
         int kshift_X = kk * stride_z_X;
         for (j = y_DX_spos, jj = y_X_spos; j < y_DX_epos; j++, jj++)
@@ -1065,8 +1052,11 @@ void stencil_4comp_kpt(
 {
     int i, j, k, jj, kk, jjj, kkk, r;
 
-    for (k = z_X1_spos, kk = z_X_spos, kkk = z_DX_spos; k < z_X1_epos; k++, kk++, kkk++)
+    #pragma omp parallel for private(i, j, jj, kk, jjj, kkk, r) schedule(static)
+    for (k = z_X1_spos; k < z_X1_epos; k++)
     {
+        kk = z_X_spos + (k - z_X1_spos);
+        kkk = z_DX_spos + (k - z_X1_spos);
         int kshift_X1 = k * stride_z_X1;
         int kshift_X  = kk * stride_z_X;
         int kshift_DX = kkk * stride_z_DX;
@@ -1128,8 +1118,12 @@ void stencil_5comp_kpt(
     const double *v0,          double _Complex *X1)
 {
     int i, j, k, jj, kk, jjj, kkk, jjjj, kkkk, r;
-    for (k = z_X1_spos, kk = z_X_spos, kkk = z_DX1_spos, kkkk = z_DX2_spos; k < z_X1_epos; k++, kk++, kkk++, kkkk++)
+    #pragma omp parallel for private(i, j, jj, kk, jjj, kkk, jjjj, kkkk, r) schedule(static)
+    for (k = z_X1_spos; k < z_X1_epos; k++)
     {
+        kk = z_X_spos + (k - z_X1_spos);
+        kkk = z_DX1_spos + (k - z_X1_spos);
+        kkkk = z_DX2_spos + (k - z_X1_spos);
         int kshift_X1 = k * stride_z_X1;
         int kshift_X  = kk * stride_z_X;
         int kshift_DX1 = kkk * stride_z_DX1;
@@ -23,8 +23,9 @@
 #include "electronicGroundState.h"
 
 int main(int argc, char *argv[]) {
-    // set up MPI
-    MPI_Init(&argc, &argv);
+    // set up MPI, only the master thread of the OpenMP regions makes MPI calls
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
     // get communicator size and my rank
     MPI_Comm comm = MPI_COMM_WORLD;
     int nproc, rank;
@@ -0,0 +1,1414 @@
+/**
+ * @file    mixedPrecisionFilter.c
+ * @brief   This file contains the functions for the mixed-precision Chebyshev
+ *          filter.
+ *
+ *          In the early SCF iterations the orbitals are far from converged, and
+ *          the accuracy of a single precision Hamiltonian-vector product is far
+ *          below the error of the subspace. The recurrence of the Chebyshev
+ *          filter is then done in single precision, which halves the memory
+ *          traffic of the stencil and of the halo exchange. The last steps of
+ *          the recurrence, the projection and the subspace rotation are always
+ *          done in double precision.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#include <complex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include <mpi.h>
+/* BLAS routines */
+#ifdef USE_MKL
+    #include <mkl.h> // for cblas_* functions
+#else
+    #include <cblas.h>
+#endif
+
+#include "mixedPrecisionFilter.h"
+#include "eigenSolver.h"
+#include "eigenSolverKpt.h"
+#include "hamiltonianVecRoutines.h"
+#include "tools.h"
+#include "isddft.h"
+#include "timing.h"
+#include "haloExchange.h"
+#include "nlocVecRoutines.h"
+#include "lapVecRoutines.h"
+
+
+
+/**
+ * @brief   Check if the mixed-precision filter is on and the cell and spin
+ *          setting have a single precision Hamiltonian.
+ */
+static int mixed_precision_supported(const SPARC_OBJ *pSPARC)
+{
+    if (pSPARC->CheFSI_MixedPrec != 1) return 0;
+    return pSPARC->cell_typ == 0 && pSPARC->CyclixFlag == 0 && pSPARC->Nspinor_eig == 1;
+}
+
+
+
+/**
+ * @brief   Decide if the Chebyshev filter is done in single precision in the
+ *          current SCF iteration.
+ */
+int CheFSI_use_single_precision(const SPARC_OBJ *pSPARC, double error)
+{
+    if (!mixed_precision_supported(pSPARC)) return 0;
+    if (error <= pSPARC->TOL_CheFSI_MixedPrec) return 0;
+    if (pSPARC->usefock > 0 && pSPARC->usefock % 2 == 0) return 0;
+    if (pSPARC->ixc[2] && pSPARC->countPotentialCalculate > 1) return 0;
+    return 1;
+}
+
+
+
+/**
+ * @brief   Kernel for calculating y = (a * Lap + b * diag(v0) + c * I) * x in
+ *          single precision. The arguments are the same as for
+ *          stencil_3axis_thread_v2, with a and c integrated into stencil_coefs
+ *          and coef_0.
+ */
+static void stencil_3axis_sp(
+    const float *x0,     const int radius,
+    const int stride_y,  const int stride_y_ex,
+    const int stride_z,  const int stride_z_ex,
+    const int x_spos,    const int x_epos,
+    const int y_spos,    const int y_epos,
+    const int z_spos,    const int z_epos,
+    const int x_ex_spos, const int y_ex_spos,
+    const int z_ex_spos,
+    const float *stencil_coefs, const float coef_0, const float b,
+    const float *v0,     float *y
+)
+{
+    int i, j, k, jp, kp, r;
+    const int shift_ip = x_ex_spos - x_spos;
+    #pragma omp parallel for private(i, j, jp, kp, r) schedule(static)
+    for (k = z_spos; k < z_epos; k++)
+    {
+        kp = z_ex_spos + (k - z_spos);
+        for (j = y_spos, jp = y_ex_spos; j < y_epos; j++, jp++)
+        {
+            int offset = k * stride_z + j * stride_y;
+            int offset_ex = kp * stride_z_ex + jp * stride_y_ex;
+            #pragma omp simd
+            for (i = x_spos; i < x_epos; i++)
+            {
+                int ip     = i + shift_ip;
+                int idx    = offset + i;
+                int idx_ex = offset_ex + ip;
+                float res = coef_0 * x0[idx_ex];
+                for (r = 1; r <= radius; r++)
+                {
+                    int stride_y_r = r * stride_y_ex;
+                    int stride_z_r = r * stride_z_ex;
+                    float res_x = (x0[idx_ex - r]          + x0[idx_ex + r])          * stencil_coefs[3*r];
+                    float res_y = (x0[idx_ex - stride_y_r] + x0[idx_ex + stride_y_r]) * stencil_coefs[3*r+1];
+                    float res_z = (x0[idx_ex - stride_z_r] + x0[idx_ex + stride_z_r]) * stencil_coefs[3*r+2];
+                    res += res_x + res_y + res_z;
+                }
+                y[idx] = res + b * (v0[idx] * x0[idx_ex]);
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Complex version of stencil_3axis_sp.
+ */
+static void stencil_3axis_sp_complex(
+    const float _Complex *x0, const int radius,
+    const int stride_y,  const int stride_y_ex,
+    const int stride_z,  const int stride_z_ex,
+    const int x_spos,    const int x_epos,
+    const int y_spos,    const int y_epos,
+    const int z_spos,    const int z_epos,
+    const int x_ex_spos, const int y_ex_spos,
+    const int z_ex_spos,
+    const float *stencil_coefs, const float coef_0, const float b,
+    const float *v0,     float _Complex *y
+)
+{
+    int i, j, k, jp, kp, r;
+    const int shift_ip = x_ex_spos - x_spos;
+    #pragma omp parallel for private(i, j, jp, kp, r) schedule(static)
+    for (k = z_spos; k < z_epos; k++)
+    {
+        kp = z_ex_spos + (k - z_spos);
+        for (j = y_spos, jp = y_ex_spos; j < y_epos; j++, jp++)
+        {
+            int offset = k * stride_z + j * stride_y;
+            int offset_ex = kp * stride_z_ex + jp * stride_y_ex;
+            for (i = x_spos; i < x_epos; i++)
+            {
+                int ip     = i + shift_ip;
+                int idx    = offset + i;
+                int idx_ex = offset_ex + ip;
+                float _Complex res = coef_0 * x0[idx_ex];
+                for (r = 1; r <= radius; r++)
+                {
+                    int stride_y_r = r * stride_y_ex;
+                    int stride_z_r = r * stride_z_ex;
+                    float _Complex res_x = (x0[idx_ex - r]          + x0[idx_ex + r])          * stencil_coefs[3*r];
+                    float _Complex res_y = (x0[idx_ex - stride_y_r] + x0[idx_ex + stride_y_r]) * stencil_coefs[3*r+1];
+                    float _Complex res_z = (x0[idx_ex - stride_z_r] + x0[idx_ex + stride_z_r]) * stencil_coefs[3*r+2];
+                    res += res_x + res_y + res_z;
+                }
+                y[idx] = res + b * (v0[idx] * x0[idx_ex]);
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Single precision version of stencil_boundary_shell in lapVecRoutines.c.
+ */
+static void stencil_boundary_shell_sp(
+    const float *x_ex, const int FDn, const int DMnx, const int DMny, const int DMnz,
+    const int DMnx_ex, const int DMny_ex, const int has_interior,
+    const float *stencil_coefs, const float coef_0, const float b,
+    const float *v0, float *y)
+{
+    const int stride_y = DMnx, stride_z = DMnx * DMny;
+    const int stride_y_ex = DMnx_ex, stride_z_ex = DMnx_ex * DMny_ex;
+    if (!has_interior) {
+        stencil_3axis_sp(
+            x_ex, FDn, stride_y, stride_y_ex, stride_z, stride_z_ex,
+            0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn,
+            stencil_coefs, coef_0, b, v0, y
+        );
+        return;
+    }
+
+    // the shell is split into 6 non-overlapping slabs: z faces, then y faces, then x faces
+    int xs[6] = {0,    0,         0,    0,         0,    DMnx-FDn};
+    int xe[6] = {DMnx, DMnx,      DMnx, DMnx,      FDn,  DMnx};
+    int ys[6] = {0,    0,         0,    DMny-FDn,  FDn,  FDn};
+    int ye[6] = {DMny, DMny,      FDn,  DMny,      DMny-FDn, DMny-FDn};
+    int zs[6] = {0,    DMnz-FDn,  FDn,  FDn,       FDn,  FDn};
+    int ze[6] = {FDn,  DMnz,      DMnz-FDn, DMnz-FDn, DMnz-FDn, DMnz-FDn};
+    for (int s = 0; s < 6; s++) {
+        stencil_3axis_sp(
+            x_ex, FDn, stride_y, stride_y_ex, stride_z, stride_z_ex,
+            xs[s], xe[s], ys[s], ye[s], zs[s], ze[s], xs[s]+FDn, ys[s]+FDn, zs[s]+FDn,
+            stencil_coefs, coef_0, b, v0, y
+        );
+    }
+}
+
+
+
+/**
+ * @brief   Calculate (a * Lap + diag(v) + c * I) times vectors in single precision.
+ *
+ *          Same as Lap_plus_diag_vec_mult_orth, with float vectors and weights.
+ */
+void Lap_plus_diag_vec_mult_orth_sp(
+        const SPARC_OBJ *pSPARC, const int DMnd, const int *DMVertices,
+        const int ncol, const double a, const double c, const float *v,
+        const float *x, const int ldi, float *y, const int ldo, MPI_Comm comm, const int *dims
+)
+{
+#define X(n,i,j,k) x[(n)*ldi+(k)*DMnxny+(j)*DMnx+(i)]
+#define x_ex(i,j,k) x_ex[(k)*DMnxny_ex+(j)*DMnx_ex+(i)]
+
+    timing_region_begin("Lap_plus_diag_vec_mult_orth_sp");
+
+    // without v the kernel reads x in its place, multiplied by 0
+    const float *_v = v; float _b = 1.0;
+    if (v == NULL) _v = (const float *) x, _b = 0;
+
+    int nproc = dims[0] * dims[1] * dims[2];
+    int periods[3];
+    periods[0] = 1 - pSPARC->BCx;
+    periods[1] = 1 - pSPARC->BCy;
+    periods[2] = 1 - pSPARC->BCz;
+
+    int FDn = pSPARC->order / 2;
+
+    // The user has to make sure DMnd = DMnx * DMny * DMnz
+    int DMnx = 1 - DMVertices[0] + DMVertices[1];
+    int DMny = 1 - DMVertices[2] + DMVertices[3];
+    int DMnz = 1 - DMVertices[4] + DMVertices[5];
+    int DMnxny = DMnx * DMny;
+
+    int DMnx_ex = DMnx + pSPARC->order;
+    int DMny_ex = DMny + pSPARC->order;
+    int DMnz_ex = DMnz + pSPARC->order;
+    int DMnxny_ex = DMnx_ex * DMny_ex;
+    int DMnd_ex = DMnxny_ex * DMnz_ex;
+
+    int DMnx_in  = DMnx - FDn;
+    int DMny_in  = DMny - FDn;
+    int DMnz_in  = DMnz - FDn;
+    int DMnx_out = DMnx + FDn;
+    int DMny_out = DMny + FDn;
+    int DMnz_out = DMnz + FDn;
+
+    // points at least FDn away from all faces do not need the halo
+    int has_interior = (DMnx > 2*FDn) && (DMny > 2*FDn) && (DMnz > 2*FDn);
+
+    // integrate a into coefficients weights
+    float *Lap_weights = (float *)malloc(3*(FDn+1)*sizeof(float));
+    assert(Lap_weights != NULL);
+    int p;
+    for (p = 0; p < FDn + 1; p++) {
+        Lap_weights[3*p  ] = (float) (pSPARC->D2_stencil_coeffs_x[p] * a);
+        Lap_weights[3*p+1] = (float) (pSPARC->D2_stencil_coeffs_y[p] * a);
+        Lap_weights[3*p+2] = (float) (pSPARC->D2_stencil_coeffs_z[p] * a);
+    }
+    // shift the diagonal by c
+    float w2_diag = (float) ((double) Lap_weights[0] + (double) Lap_weights[1]
+                           + (double) Lap_weights[2] + c);
+
+    // set up send buffer based on the ordering of the neighbors
+    int istart[6] = {0,    DMnx_in,  0,    0,        0,    0},
+          iend[6] = {FDn,  DMnx,     DMnx, DMnx,     DMnx, DMnx},
+        jstart[6] = {0,    0,        0,    DMny_in,  0,    0},
+          jend[6] = {DMny, DMny,     FDn,  DMny,     DMny, DMny},
+        kstart[6] = {0,    0,        0,    0,        0,    DMnz_in},
+          kend[6] = {DMnz, DMnz,     DMnz, DMnz,     FDn,  DMnz};
+
+    // number of halo values per vector received from each neighbor
+    int nbr_size[6];
+    nbr_size[0] = nbr_size[1] = FDn * (DMny * DMnz);
+    nbr_size[2] = nbr_size[3] = FDn * (DMnx * DMnz);
+    nbr_size[4] = nbr_size[5] = FDn * (DMnx * DMny);
+
+    int nbrcount, n, i, j, k, ip, jp, kp, count;
+    HALO_PLAN_OBJ *halo = NULL;
+    float *x_in = NULL, *x_out = NULL;
+    if (nproc > 1) { // pack info and init Halo exchange
+        // the buffers are owned by the plan, x_in is 0 for the missing neighbors
+        halo = Halo_plan_get(comm, MPI_FLOAT, 6, nbr_size, ncol);
+        x_in  = (float *) halo->recvbuf;
+        x_out = (float *) halo->sendbuf;
+
+        int nbr_i;
+        count = 0;
+        for (nbr_i = 0; nbr_i < 6; nbr_i++) {
+            // if dims[i] < 3 and periods[i] == 1, switch send buffer for left and right neighbors
+            nbrcount = nbr_i + (1 - 2 * (nbr_i % 2)) * (int)(dims[nbr_i / 2] < 3 && periods[nbr_i / 2]);
+            const int k_s = kstart[nbrcount];
+            const int k_e = kend  [nbrcount];
+            const int j_s = jstart[nbrcount];
+            const int j_e = jend  [nbrcount];
+            const int i_s = istart[nbrcount];
+            const int i_e = iend  [nbrcount];
+            for (n = 0; n < ncol; n++) {
+                for (k = k_s; k < k_e; k++) {
+                    for (j = j_s; j < j_e; j++) {
+                        for (i = i_s; i < i_e; i++) {
+                            x_out[count++] = X(n,i,j,k);
+                        }
+                    }
+                }
+            }
+        }
+
+        // first transfer info. to/from neighbor processors
+        Halo_plan_start(halo); // non-blocking
+        timing_add_counts(sizeof(float) * halo->nd, 0.0);
+    }
+
+    // overlap the interior part of Lx of all vectors with communication
+    if (has_interior) {
+        // bytes of v, x and y per z-plane, x is also read FDn planes below and above the slab
+        size_t plane_bytes = (size_t) DMnxny * (3 * sizeof(float));
+        int nz_blk = (int) (LAP_TILE_BYTES / plane_bytes) - 2 * FDn;
+        // every slab has at least one plane per thread of the kernel
+        if (nz_blk < pSPARC->num_omp_threads) nz_blk = pSPARC->num_omp_threads;
+        if (nz_blk < 1) nz_blk = 1;
+        int n0, k0;
+        for (n0 = 0; n0 < ncol; n0 += LAP_TILE_NCOL) {
+            int n1 = (n0 + LAP_TILE_NCOL < ncol) ? n0 + LAP_TILE_NCOL : ncol;
+            for (k0 = FDn; k0 < DMnz_in; k0 += nz_blk) {
+                int k1 = (k0 + nz_blk < DMnz_in) ? k0 + nz_blk : DMnz_in;
+                for (n = n0; n < n1; n++) {
+                    stencil_3axis_sp(
+                        x+n*(unsigned)ldi, FDn, DMnx, DMnx, DMnxny, DMnxny,
+                        FDn, DMnx_in, FDn, DMny_in, k0, k1, FDn, FDn, k0,
+                        Lap_weights, w2_diag, _b, _v, y+n*(unsigned)ldo
+                    );
+                }
+            }
+        }
+    }
+
+    // set up start and end indices for copying edge nodes in x_ex
+    int istart_in[6] = {0,       DMnx_out, FDn,     FDn,      FDn,      FDn};
+    int   iend_in[6] = {FDn,     DMnx_ex,  DMnx_out,DMnx_out, DMnx_out, DMnx_out};
+    int jstart_in[6] = {FDn,     FDn,      0,       DMny_out, FDn,      FDn};
+    int   jend_in[6] = {DMny_out,DMny_out, FDn,     DMny_ex,  DMny_out, DMny_out};
+    int kstart_in[6] = {FDn,     FDn,      FDn,     FDn,      0,        DMnz_out};
+    int   kend_in[6] = {DMnz_out,DMnz_out, DMnz_out,DMnz_out, FDn,      DMnz_ex};
+
+    if (nproc > 1) {
+        // make sure receive buffer is ready
+        timing_region_begin("halo_wait");
+        Halo_plan_wait(halo);
+        timing_region_end("halo_wait");
+    }
+
+    // the boundary shell only reads x_ex within 2*FDn of the faces of the local domain
+    int ip_lo = FDn + 2*FDn, ip_hi = DMnx_out - 2*FDn;
+    int jp_lo = FDn + 2*FDn, jp_hi = DMny_out - 2*FDn;
+    int kp_lo = FDn + 2*FDn, kp_hi = DMnz_out - 2*FDn;
+    if (!has_interior || ip_lo >= ip_hi) {
+        ip_lo = ip_hi = DMnx_out;
+    }
+
+    // the extended domain of one vector is reused for all vectors and kept by the plan
+    float *x_ex = (float *)Halo_ex_buffer(comm, halo, DMnd_ex * sizeof(float));
+    for (n = 0; n < ncol; n++) {
+
+        // copy x into extended x_ex
+        const float *xn = x + n*(unsigned)ldi;
+        for (kp = FDn; kp < DMnz_out; kp++) {
+            int row_full = (kp < kp_lo || kp >= kp_hi);
+            for (jp = FDn; jp < DMny_out; jp++) {
+                count = (kp-FDn) * DMnxny + (jp-FDn) * DMnx;
+                if (row_full || jp < jp_lo || jp >= jp_hi) {
+                    for (ip = FDn; ip < DMnx_out; ip++)
+                        x_ex(ip,jp,kp) = xn[count++];
+                } else {
+                    for (ip = FDn; ip < ip_lo; ip++)
+                        x_ex(ip,jp,kp) = xn[count++];
+                    count += ip_hi - ip_lo;
+                    for (ip = ip_hi; ip < DMnx_out; ip++)
+                        x_ex(ip,jp,kp) = xn[count++];
+                }
+            }
+        }
+
+        if (nproc > 1) { // unpack info and copy into x_ex
+            for (nbrcount = 0; nbrcount < 6; nbrcount++) {
+                const int k_s = kstart_in[nbrcount];
+                const int k_e = kend_in  [nbrcount];
+                const int j_s = jstart_in[nbrcount];
+                const int j_e = jend_in  [nbrcount];
+                const int i_s = istart_in[nbrcount];
+                const int i_e = iend_in  [nbrcount];
+                count = halo->displs[nbrcount] + n * nbr_size[nbrcount];
+                for (k = k_s; k < k_e; k++) {
+                    for (j = j_s; j < j_e; j++) {
+                        for (i = i_s; i < i_e; i++) {
+                            x_ex(i,j,k) = x_in[count++];
+                        }
+                    }
+                }
+            }
+        } else { // copy the extended part directly from x into x_ex
+            int nbr_i;
+            for (nbr_i = 0; nbr_i < 6; nbr_i++) {
+                // if dims[i] < 3 and periods[i] == 1, switch send
+                // buffer for left and right neighbors
+                nbrcount = nbr_i + (1 - 2 * (nbr_i % 2));
+                const int kp_s = kstart_in[nbr_i];
+                const int kp_e = kend_in  [nbr_i];
+                const int jp_s = jstart_in[nbr_i];
+                const int jp_e = jend_in  [nbr_i];
+                const int ip_s = istart_in[nbr_i];
+                const int ip_e = iend_in  [nbr_i];
+                if (periods[nbr_i / 2]) {
+                    const int k_s = kstart[nbrcount];
+                    const int k_e = kend  [nbrcount];
+                    const int j_s = jstart[nbrcount];
+                    const int j_e = jend  [nbrcount];
+                    const int i_s = istart[nbrcount];
+                    const int i_e = iend  [nbrcount];
+                    for (k = k_s, kp = kp_s; k < k_e; k++, kp++) {
+                        for (j = j_s, jp = jp_s; j < j_e; j++, jp++) {
+                            for (i = i_s, ip = ip_s; i < i_e; i++, ip++) {
+                                x_ex(ip,jp,kp) = X(n,i,j,k);
+                            }
+                        }
+                    }
+                } else {
+                    for (kp = kp_s; kp < kp_e; kp++) {
+                        for (jp = jp_s; jp < jp_e; jp++) {
+                            for (ip = ip_s; ip < ip_e; ip++) {
+                                x_ex(ip,jp,kp) = 0;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // calculate the remaining part of Lx
+        stencil_boundary_shell_sp(
+            x_ex, FDn, DMnx, DMny, DMnz, DMnx_ex, DMny_ex, has_interior,
+            Lap_weights, w2_diag, _b, _v, y+n*(unsigned)ldo
+        );
+
+    }
+
+    if (nproc > 1) Halo_plan_release(halo);
+    free(Lap_weights);
+
+    // each point takes FDn pairs of neighbors (2 adds, 1 mult) along 3 axes plus the diagonal terms
+    timing_add_counts(0.0, (9.0 * FDn + 4.0) * DMnd * ncol);
+    timing_region_end("Lap_plus_diag_vec_mult_orth_sp");
+
+#undef X
+#undef x_ex
+}
+
+
+
+/**
+ * @brief   Complex version of stencil_boundary_shell_sp.
+ */
+static void stencil_boundary_shell_sp_complex(
+    const float _Complex *x_ex, const int FDn, const int DMnx, const int DMny, const int DMnz,
+    const int DMnx_ex, const int DMny_ex, const int has_interior,
+    const float *stencil_coefs, const float coef_0, const float b,
+    const float *v0, float _Complex *y)
+{
+    const int stride_y = DMnx, stride_z = DMnx * DMny;
+    const int stride_y_ex = DMnx_ex, stride_z_ex = DMnx_ex * DMny_ex;
+    if (!has_interior) {
+        stencil_3axis_sp_complex(
+            x_ex, FDn, stride_y, stride_y_ex, stride_z, stride_z_ex,
+            0, DMnx, 0, DMny, 0, DMnz, FDn, FDn, FDn,
+            stencil_coefs, coef_0, b, v0, y
+        );
+        return;
+    }
+
+    // the shell is split into 6 non-overlapping slabs: z faces, then y faces, then x faces
+    int xs[6] = {0,    0,         0,    0,         0,    DMnx-FDn};
+    int xe[6] = {DMnx, DMnx,      DMnx, DMnx,      FDn,  DMnx};
+    int ys[6] = {0,    0,         0,    DMny-FDn,  FDn,  FDn};
+    int ye[6] = {DMny, DMny,      FDn,  DMny,      DMny-FDn, DMny-FDn};
+    int zs[6] = {0,    DMnz-FDn,  FDn,  FDn,       FDn,  FDn};
+    int ze[6] = {FDn,  DMnz,      DMnz-FDn, DMnz-FDn, DMnz-FDn, DMnz-FDn};
+    for (int s = 0; s < 6; s++) {
+        stencil_3axis_sp_complex(
+            x_ex, FDn, stride_y, stride_y_ex, stride_z, stride_z_ex,
+            xs[s], xe[s], ys[s], ye[s], zs[s], ze[s], xs[s]+FDn, ys[s]+FDn, zs[s]+FDn,
+            stencil_coefs, coef_0, b, v0, y
+        );
+    }
+}
+
+
+
+/**
+ * @brief   Calculate (a * Lap + diag(v) + c * I) times vectors in single precision
+ *          with a Bloch factor.
+ *
+ *          Same as Lap_plus_diag_vec_mult_orth_sp, the halo outside the global
+ *          domain takes the phase factor of k-point kpt.
+ */
+void Lap_plus_diag_vec_mult_orth_sp_kpt(
+        const SPARC_OBJ *pSPARC, const int DMnd, const int *DMVertices,
+        const int ncol, const double a, const double c, const float *v,
+        const float _Complex *x, const int ldi, float _Complex *y, const int ldo, MPI_Comm comm,
+        const int *dims, const int kpt
+)
+{
+#define X(n,i,j,k) x[(n)*ldi+(k)*DMnxny+(j)*DMnx+(i)]
+#define x_ex(i,j,k) x_ex[(k)*DMnxny_ex+(j)*DMnx_ex+(i)]
+
+    timing_region_begin("Lap_plus_diag_vec_mult_orth_sp_kpt");
+
+    // without v the kernel reads x in its place, multiplied by 0
+    const float *_v = v; float _b = 1.0;
+    if (v == NULL) _v = (const float *) x, _b = 0;
+
+    int nproc = dims[0] * dims[1] * dims[2];
+    int periods[3];
+    periods[0] = 1 - pSPARC->BCx;
+    periods[1] = 1 - pSPARC->BCy;
+    periods[2] = 1 - pSPARC->BCz;
+
+    int FDn = pSPARC->order / 2;
+
+    // The user has to make sure DMnd = DMnx * DMny * DMnz
+    int DMnx = 1 - DMVertices[0] + DMVertices[1];
+    int DMny = 1 - DMVertices[2] + DMVertices[3];
+    int DMnz = 1 - DMVertices[4] + DMVertices[5];
+    int DMnxny = DMnx * DMny;
+
+    int DMnx_ex = DMnx + pSPARC->order;
+    int DMny_ex = DMny + pSPARC->order;
+    int DMnz_ex = DMnz + pSPARC->order;
+    int DMnxny_ex = DMnx_ex * DMny_ex;
+    int DMnd_ex = DMnxny_ex * DMnz_ex;
+
+    int DMnx_in  = DMnx - FDn;
+    int DMny_in  = DMny - FDn;
+    int DMnz_in  = DMnz - FDn;
+    int DMnx_out = DMnx + FDn;
+    int DMny_out = DMny + FDn;
+    int DMnz_out = DMnz + FDn;
+
+    // points at least FDn away from all faces do not need the halo
+    int has_interior = (DMnx > 2*FDn) && (DMny > 2*FDn) && (DMnz > 2*FDn);
+
+    // integrate a into coefficients weights
+    float *Lap_weights = (float *)malloc(3*(FDn+1)*sizeof(float));
+    assert(Lap_weights != NULL);
+    int p;
+    for (p = 0; p < FDn + 1; p++) {
+        Lap_weights[3*p  ] = (float) (pSPARC->D2_stencil_coeffs_x[p] * a);
+        Lap_weights[3*p+1] = (float) (pSPARC->D2_stencil_coeffs_y[p] * a);
+        Lap_weights[3*p+2] = (float) (pSPARC->D2_stencil_coeffs_z[p] * a);
+    }
+    // shift the diagonal by c
+    float w2_diag = (float) ((double) Lap_weights[0] + (double) Lap_weights[1]
+                           + (double) Lap_weights[2] + c);
+
+    // set up send buffer based on the ordering of the neighbors
+    int istart[6] = {0,    DMnx_in,  0,    0,        0,    0},
+          iend[6] = {FDn,  DMnx,     DMnx, DMnx,     DMnx, DMnx},
+        jstart[6] = {0,    0,        0,    DMny_in,  0,    0},
+          jend[6] = {DMny, DMny,     FDn,  DMny,     DMny, DMny},
+        kstart[6] = {0,    0,        0,    0,        0,    DMnz_in},
+          kend[6] = {DMnz, DMnz,     DMnz, DMnz,     FDn,  DMnz};
+
+    // number of halo values per vector received from each neighbor
+    int nbr_size[6];
+    nbr_size[0] = nbr_size[1] = FDn * (DMny * DMnz);
+    nbr_size[2] = nbr_size[3] = FDn * (DMnx * DMnz);
+    nbr_size[4] = nbr_size[5] = FDn * (DMnx * DMny);
+
+    int nbrcount, n, i, j, k, ip, jp, kp, count;
+    HALO_PLAN_OBJ *halo = NULL;
+    float _Complex *x_in = NULL, *x_out = NULL;
+    if (nproc > 1) { // pack info and init Halo exchange
+        // the buffers are owned by the plan, x_in is 0 for the missing neighbors
+        halo = Halo_plan_get(comm, MPI_C_FLOAT_COMPLEX, 6, nbr_size, ncol);
+        x_in  = (float _Complex *) halo->recvbuf;
+        x_out = (float _Complex *) halo->sendbuf;
+
+        int nbr_i;
+        count = 0;
+        for (nbr_i = 0; nbr_i < 6; nbr_i++) {
+            // if dims[i] < 3 and periods[i] == 1, switch send buffer for left and right neighbors
+            nbrcount = nbr_i + (1 - 2 * (nbr_i % 2)) * (int)(dims[nbr_i / 2] < 3 && periods[nbr_i / 2]);
+            const int k_s = kstart[nbrcount];
+            const int k_e = kend  [nbrcount];
+            const int j_s = jstart[nbrcount];
+            const int j_e = jend  [nbrcount];
+            const int i_s = istart[nbrcount];
+            const int i_e = iend  [nbrcount];
+            for (n = 0; n < ncol; n++) {
+                for (k = k_s; k < k_e; k++) {
+                    for (j = j_s; j < j_e; j++) {
+                        for (i = i_s; i < i_e; i++) {
+                            x_out[count++] = X(n,i,j,k);
+                        }
+                    }
+                }
+            }
+        }
+
+        // first transfer info. to/from neighbor processors
+        Halo_plan_start(halo); // non-blocking
+        timing_add_counts(sizeof(float _Complex) * halo->nd, 0.0);
+    }
+
+    // overlap the interior part of Lx of all vectors with communication
+    if (has_interior) {
+        // bytes of v, x and y per z-plane, x is also read FDn planes below and above the slab
+        size_t plane_bytes = (size_t) DMnxny * (sizeof(float) + 2 * sizeof(float _Complex));
+        int nz_blk = (int) (LAP_TILE_BYTES / plane_bytes) - 2 * FDn;
+        // every slab has at least one plane per thread of the kernel
+        if (nz_blk < pSPARC->num_omp_threads) nz_blk = pSPARC->num_omp_threads;
+        if (nz_blk < 1) nz_blk = 1;
+        int n0, k0;
+        for (n0 = 0; n0 < ncol; n0 += LAP_TILE_NCOL) {
+            int n1 = (n0 + LAP_TILE_NCOL < ncol) ? n0 + LAP_TILE_NCOL : ncol;
+            for (k0 = FDn; k0 < DMnz_in; k0 += nz_blk) {
+                int k1 = (k0 + nz_blk < DMnz_in) ? k0 + nz_blk : DMnz_in;
+                for (n = n0; n < n1; n++) {
+                    stencil_3axis_sp_complex(
+                        x+n*(unsigned)ldi, FDn, DMnx, DMnx, DMnxny, DMnxny,
+                        FDn, DMnx_in, FDn, DMny_in, k0, k1, FDn, FDn, k0,
+                        Lap_weights, w2_diag, _b, _v, y+n*(unsigned)ldo
+                    );
+                }
+            }
+        }
+    }
+
+    // set up start and end indices for copying edge nodes in x_ex
+    int istart_in[6] = {0,       DMnx_out, FDn,     FDn,      FDn,      FDn};
+    int   iend_in[6] = {FDn,     DMnx_ex,  DMnx_out,DMnx_out, DMnx_out, DMnx_out};
+    int jstart_in[6] = {FDn,     FDn,      0,       DMny_out, FDn,      FDn};
+    int   jend_in[6] = {DMny_out,DMny_out, FDn,     DMny_ex,  DMny_out, DMny_out};
+    int kstart_in[6] = {FDn,     FDn,      FDn,     FDn,      0,        DMnz_out};
+    int   kend_in[6] = {DMnz_out,DMnz_out, DMnz_out,DMnz_out, FDn,      DMnz_ex};
+
+    int gridsizes[3] = {pSPARC->Nx, pSPARC->Ny, pSPARC->Nz};
+    double _Complex phase_fac_l_x = cos(pSPARC->k1_loc[kpt] * pSPARC->range_x) - sin(pSPARC->k1_loc[kpt] * pSPARC->range_x) * I;
+    double _Complex phase_fac_l_y = cos(pSPARC->k2_loc[kpt] * pSPARC->range_y) - sin(pSPARC->k2_loc[kpt] * pSPARC->range_y) * I;
+    double _Complex phase_fac_l_z = cos(pSPARC->k3_loc[kpt] * pSPARC->range_z) - sin(pSPARC->k3_loc[kpt] * pSPARC->range_z) * I;
+    float _Complex phase_factors[6]; // xl, xr, yl, yr, zl, zr
+    phase_factors[0] = (float _Complex) phase_fac_l_x;
+    phase_factors[1] = (float _Complex) conj(phase_fac_l_x);
+    phase_factors[2] = (float _Complex) phase_fac_l_y;
+    phase_factors[3] = (float _Complex) conj(phase_fac_l_y);
+    phase_factors[4] = (float _Complex) phase_fac_l_z;
+    phase_factors[5] = (float _Complex) conj(phase_fac_l_z);
+
+    if (nproc > 1) {
+        // make sure receive buffer is ready
+        timing_region_begin("halo_wait");
+        Halo_plan_wait(halo);
+        timing_region_end("halo_wait");
+    }
+
+    // the boundary shell only reads x_ex within 2*FDn of the faces of the local domain
+    int ip_lo = FDn + 2*FDn, ip_hi = DMnx_out - 2*FDn;
+    int jp_lo = FDn + 2*FDn, jp_hi = DMny_out - 2*FDn;
+    int kp_lo = FDn + 2*FDn, kp_hi = DMnz_out - 2*FDn;
+    if (!has_interior || ip_lo >= ip_hi) {
+        ip_lo = ip_hi = DMnx_out;
+    }
+
+    // the extended domain of one vector is reused for all vectors and kept by the plan
+    float _Complex *x_ex = (float _Complex *)Halo_ex_buffer(comm, halo, DMnd_ex * sizeof(float _Complex));
+    for (n = 0; n < ncol; n++) {
+
+        // copy x into extended x_ex
+        const float _Complex *xn = x + n*(unsigned)ldi;
+        for (kp = FDn; kp < DMnz_out; kp++) {
+            int row_full = (kp < kp_lo || kp >= kp_hi);
+            for (jp = FDn; jp < DMny_out; jp++) {
+                count = (kp-FDn) * DMnxny + (jp-FDn) * DMnx;
+                if (row_full || jp < jp_lo || jp >= jp_hi) {
+                    for (ip = FDn; ip < DMnx_out; ip++)
+                        x_ex(ip,jp,kp) = xn[count++];
+                } else {
+                    for (ip = FDn; ip < ip_lo; ip++)
+                        x_ex(ip,jp,kp) = xn[count++];
+                    count += ip_hi - ip_lo;
+                    for (ip = ip_hi; ip < DMnx_out; ip++)
+                        x_ex(ip,jp,kp) = xn[count++];
+                }
+            }
+        }
+
+        if (nproc > 1) { // unpack info and copy into x_ex
+            for (nbrcount = 0; nbrcount < 6; nbrcount++) {
+                const int k_s = kstart_in[nbrcount];
+                const int k_e = kend_in  [nbrcount];
+                const int j_s = jstart_in[nbrcount];
+                const int j_e = jend_in  [nbrcount];
+                const int i_s = istart_in[nbrcount];
+                const int i_e = iend_in  [nbrcount];
+                count = halo->displs[nbrcount] + n * nbr_size[nbrcount];
+                const float _Complex phase_factor = phase_factors[nbrcount];
+                for (k = k_s; k < k_e; k++) {
+                    for (j = j_s; j < j_e; j++) {
+                        for (i = i_s; i < i_e; i++) {
+                            // apply phase factor if the domain goes outside the global domain
+                            if (is_grid_outside(i, j, k, -FDn, -FDn, -FDn, DMVertices, gridsizes))
+                                x_ex(i,j,k) = x_in[count++] * phase_factor;
+                            else
+                                x_ex(i,j,k) = x_in[count++];
+                        }
+                    }
+                }
+            }
+        } else { // copy the extended part directly from x into x_ex
+            int nbr_i;
+            for (nbr_i = 0; nbr_i < 6; nbr_i++) {
+                // if dims[i] < 3 and periods[i] == 1, switch send
+                // buffer for left and right neighbors
+                nbrcount = nbr_i + (1 - 2 * (nbr_i % 2));
+                const int kp_s = kstart_in[nbr_i];
+                const int kp_e = kend_in  [nbr_i];
+                const int jp_s = jstart_in[nbr_i];
+                const int jp_e = jend_in  [nbr_i];
+                const int ip_s = istart_in[nbr_i];
+                const int ip_e = iend_in  [nbr_i];
+                if (periods[nbr_i / 2]) {
+                    const int k_s = kstart[nbrcount];
+                    const int k_e = kend  [nbrcount];
+                    const int j_s = jstart[nbrcount];
+                    const int j_e = jend  [nbrcount];
+                    const int i_s = istart[nbrcount];
+                    const int i_e = iend  [nbrcount];
+                    const float _Complex phase_factor = phase_factors[nbr_i];
+                    for (k = k_s, kp = kp_s; k < k_e; k++, kp++) {
+                        for (j = j_s, jp = jp_s; j < j_e; j++, jp++) {
+                            for (i = i_s, ip = ip_s; i < i_e; i++, ip++) {
+                                if (is_grid_outside(ip, jp, kp, -FDn, -FDn, -FDn, DMVertices, gridsizes))
+                                    x_ex(ip,jp,kp) = X(n,i,j,k) * phase_factor;
+                                else
+                                    x_ex(ip,jp,kp) = X(n,i,j,k);
+                            }
+                        }
+                    }
+                } else {
+                    for (kp = kp_s; kp < kp_e; kp++) {
+                        for (jp = jp_s; jp < jp_e; jp++) {
+                            for (ip = ip_s; ip < ip_e; ip++) {
+                                x_ex(ip,jp,kp) = 0;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // calculate the remaining part of Lx
+        stencil_boundary_shell_sp_complex(
+            x_ex, FDn, DMnx, DMny, DMnz, DMnx_ex, DMny_ex, has_interior,
+            Lap_weights, w2_diag, _b, _v, y+n*(unsigned)ldo
+        );
+
+    }
+
+    if (nproc > 1) Halo_plan_release(halo);
+    free(Lap_weights);
+
+    // each point takes FDn pairs of neighbors (2 adds, 1 mult) along 3 axes plus the diagonal terms
+    timing_add_counts(0.0, 2.0 * (9.0 * FDn + 4.0) * DMnd * ncol);
+    timing_region_end("Lap_plus_diag_vec_mult_orth_sp_kpt");
+
+#undef X
+#undef x_ex
+}
+
+
+
+/**
+ * @brief   Keep a single precision copy of the nonlocal projectors next to Chi
+ *          (Chi_c for k-points), used by Vnl_vec_mult_sp(_kpt).
+ */
+void CalculateNonlocalProjectors_sp(const SPARC_OBJ *pSPARC, NLOC_PROJ_OBJ *nlocProj,
+                                    ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, MPI_Comm comm)
+{
+    if (comm == MPI_COMM_NULL || !mixed_precision_supported(pSPARC)) return;
+    int ityp, iat, i;
+    for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+        int nproj = nlocProj[ityp].nproj;
+        int n_atom = Atom_Influence_nloc[ityp].n_atom;
+        if (! nproj) continue;
+        if (pSPARC->isGammaPoint) {
+            nlocProj[ityp].Chi_sp = (float **)malloc(n_atom * sizeof(float *));
+            assert(nlocProj[ityp].Chi_sp != NULL);
+        } else {
+            nlocProj[ityp].Chi_c_sp = (float _Complex **)malloc(n_atom * sizeof(float _Complex *));
+            assert(nlocProj[ityp].Chi_c_sp != NULL);
+        }
+        for (iat = 0; iat < n_atom; iat++) {
+            int len = Atom_Influence_nloc[ityp].ndc[iat] * nproj;
+            if (pSPARC->isGammaPoint) {
+                float *Chi = (float *)malloc(len * sizeof(float));
+                assert(Chi != NULL);
+                for (i = 0; i < len; i++) Chi[i] = (float) nlocProj[ityp].Chi[iat][i];
+                nlocProj[ityp].Chi_sp[iat] = Chi;
+            } else {
+                float _Complex *Chi = (float _Complex *)malloc(len * sizeof(float _Complex));
+                assert(Chi != NULL);
+                for (i = 0; i < len; i++) Chi[i] = (float _Complex) nlocProj[ityp].Chi_c[iat][i];
+                nlocProj[ityp].Chi_c_sp[iat] = Chi;
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Free the single precision copy of the nonlocal projectors.
+ */
+void Free_NonlocalProjectors_sp(NLOC_PROJ_OBJ *nlocProj, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, int Ntypes)
+{
+    if (nlocProj == NULL) return;
+    for (int ityp = 0; ityp < Ntypes; ityp++) {
+        for (int iat = 0; iat < Atom_Influence_nloc[ityp].n_atom; iat++) {
+            if (nlocProj[ityp].Chi_sp != NULL) free(nlocProj[ityp].Chi_sp[iat]);
+            if (nlocProj[ityp].Chi_c_sp != NULL) free(nlocProj[ityp].Chi_c_sp[iat]);
+        }
+        free(nlocProj[ityp].Chi_sp);
+        free(nlocProj[ityp].Chi_c_sp);
+        nlocProj[ityp].Chi_sp = NULL;
+        nlocProj[ityp].Chi_c_sp = NULL;
+    }
+}
+
+
+
+/**
+ * @brief   Multiply gamma_Jl to the inner products <Chi_Jlm, x_n> of all atoms.
+ *
+ *          ncomp is the number of floats per inner product (1 for real, 2 for
+ *          complex inner products).
+ */
+static void scale_inner_product_sp(const SPARC_OBJ *pSPARC, float *alpha, int ncol, int ncomp)
+{
+    int ityp, iat, n, l, np, m, r, ldispl, lmax, count = 0;
+    for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+        int lloc = pSPARC->localPsd[ityp];
+        lmax = pSPARC->psd[ityp].lmax;
+        for (iat = 0; iat < pSPARC->nAtomv[ityp]; iat++) {
+            for (n = 0; n < ncol; n++) {
+                ldispl = 0;
+                for (l = 0; l <= lmax; l++) {
+                    // skip the local l
+                    if (l == lloc) {
+                        ldispl += pSPARC->psd[ityp].ppl[l];
+                        continue;
+                    }
+                    for (np = 0; np < pSPARC->psd[ityp].ppl[l]; np++) {
+                        float gamma_Jl = (float) pSPARC->psd[ityp].Gamma[ldispl+np];
+                        for (m = -l; m <= l; m++) {
+                            for (r = 0; r < ncomp; r++) alpha[count++] *= gamma_Jl;
+                        }
+                    }
+                    ldispl += pSPARC->psd[ityp].ppl[l];
+                }
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Find the offsets of the images of one atom type in the packed
+ *          (image after image) rc-domain buffers, displ[n_atom] is the total
+ *          number of rc-domain nodes.
+ */
+static void image_displ_sp(const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, size_t *displ)
+{
+    displ[0] = 0;
+    for (int iat = 0; iat < Atom_Influence_nloc->n_atom; iat++)
+        displ[iat+1] = displ[iat] + Atom_Influence_nloc->ndc[iat];
+}
+
+
+
+/**
+ * @brief   Gather the vectors on the rc-domains of all images of one atom type,
+ *          packed image after image, in one parallel region. ncomp is the
+ *          number of floats per entry (1 for real, 2 for complex vectors).
+ */
+static void gather_sp(const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, const size_t *displ,
+                      int ncol, const float *x, int ldi, float *x_rc, int ncomp)
+{
+    int n, i, r, iat;
+    int n_img = Atom_Influence_nloc->n_atom;
+    #pragma omp parallel for collapse(2) private(n, i, r, iat) schedule(static)
+    for (iat = 0; iat < n_img; iat++) {
+        for (n = 0; n < ncol; n++) {
+            int ndc = Atom_Influence_nloc->ndc[iat];
+            const int *grid_pos = Atom_Influence_nloc->grid_pos[iat];
+            const float *x_n = x + (size_t) n * ldi * ncomp;
+            float *x_rc_n = x_rc + (displ[iat] * ncol + (size_t) n * ndc) * ncomp;
+            for (i = 0; i < ndc; i++) {
+                for (r = 0; r < ncomp; r++) x_rc_n[i*ncomp+r] = x_n[(size_t) grid_pos[i]*ncomp+r];
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Add the projections of all images of one atom type, packed image
+ *          after image, to the grid in one parallel region. Images may overlap,
+ *          so the threads split one image at a time (grid_pos has no repeated
+ *          entries within one image).
+ */
+static void scatter_sp(const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, const size_t *displ,
+                       int ncol, const float *Vnlx, float *Hx, int ldo, int ncomp)
+{
+    int n, i, r, iat;
+    int n_img = Atom_Influence_nloc->n_atom;
+    #pragma omp parallel private(n, i, r, iat)
+    for (iat = 0; iat < n_img; iat++) {
+        int ndc = Atom_Influence_nloc->ndc[iat];
+        const int *grid_pos = Atom_Influence_nloc->grid_pos[iat];
+        const float *Vnlx_img = Vnlx + displ[iat] * ncol * ncomp;
+        #pragma omp for collapse(2) schedule(static)
+        for (n = 0; n < ncol; n++) {
+            for (i = 0; i < ndc; i++) {
+                for (r = 0; r < ncomp; r++)
+                    Hx[((size_t) n * ldo + grid_pos[i]) * ncomp + r] += Vnlx_img[((size_t) n * ndc + i) * ncomp + r];
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Calculate Vnl times vectors in single precision, with the projector
+ *          copies made by CalculateNonlocalProjectors_sp.
+ */
+void Vnl_vec_mult_sp(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc,
+                     NLOC_PROJ_OBJ *nlocProj, int ncol, float *x, int ldi, float *Hx, int ldo, MPI_Comm comm)
+{
+    int ityp, iat, ndc, nproj, n_img, atom_index;
+    size_t *displ;
+    float *alpha, *x_rc, *Vnlx;
+    timing_region_begin("Vnl_vec_mult_sp");
+    alpha = (float *)calloc( pSPARC->IP_displ[pSPARC->n_atom] * ncol, sizeof(float));
+    assert(alpha != NULL);
+    // x_rc and Vnlx share the packed buffer of the nonlocal workspace
+    x_rc = Vnlx = (float *)Vnl_workspace_packed(pSPARC, Atom_Influence_nloc, nlocProj, ncol, sizeof(float), 0, &displ);
+
+    //first find inner product
+    for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+        nproj = nlocProj[ityp].nproj;
+        n_img = Atom_Influence_nloc[ityp].n_atom;
+        if (! nproj || ! n_img) continue; // this is typical for hydrogen
+        image_displ_sp(&Atom_Influence_nloc[ityp], displ);
+        gather_sp(&Atom_Influence_nloc[ityp], displ, ncol, x, ldi, x_rc, 1);
+        for (iat = 0; iat < n_img; iat++) {
+            ndc = Atom_Influence_nloc[ityp].ndc[iat];
+            atom_index = Atom_Influence_nloc[ityp].atom_index[iat];
+            cblas_sgemm(CblasColMajor, CblasTrans, CblasNoTrans, nproj, ncol, ndc,
+                (float)pSPARC->dV, nlocProj[ityp].Chi_sp[iat], ndc, x_rc + displ[iat] * ncol, ndc, 1.0f,
+                alpha+pSPARC->IP_displ[atom_index]*ncol, nproj);
+        }
+        // inner product and projection back to the grid
+        timing_add_counts(0.0, 4.0 * displ[n_img] * nproj * ncol);
+    }
+
+    int commsize;
+    MPI_Comm_size(comm, &commsize);
+    if (commsize > 1) {
+        MPI_Allreduce(MPI_IN_PLACE, alpha, pSPARC->IP_displ[pSPARC->n_atom] * ncol, MPI_FLOAT, MPI_SUM, comm);
+        timing_add_counts(sizeof(float) * pSPARC->IP_displ[pSPARC->n_atom] * ncol, 0.0);
+    }
+
+    // go over all atoms and multiply gamma_Jl to the inner product
+    scale_inner_product_sp(pSPARC, alpha, ncol, 1);
+
+    // multiply the inner product and the nonlocal projector
+    for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+        nproj = nlocProj[ityp].nproj;
+        n_img = Atom_Influence_nloc[ityp].n_atom;
+        if (! nproj || ! n_img) continue;
+        image_displ_sp(&Atom_Influence_nloc[ityp], displ);
+        for (iat = 0; iat < n_img; iat++) {
+            ndc = Atom_Influence_nloc[ityp].ndc[iat];
+            atom_index = Atom_Influence_nloc[ityp].atom_index[iat];
+            cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, ndc, ncol, nproj, 1.0f, nlocProj[ityp].Chi_sp[iat], ndc,
+                        alpha+pSPARC->IP_displ[atom_index]*ncol, nproj, 0.0f, Vnlx + displ[iat] * ncol, ndc);
+        }
+        scatter_sp(&Atom_Influence_nloc[ityp], displ, ncol, Vnlx, Hx, ldo, 1);
+    }
+    free(alpha);
+    timing_region_end("Vnl_vec_mult_sp");
+}
+
+
+
+/**
+ * @brief   Calculate Vnl times vectors in single precision with Bloch factor.
+ */
+void Vnl_vec_mult_sp_kpt(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc,
+                         NLOC_PROJ_OBJ *nlocProj, int ncol, float _Complex *x, int ldi, float _Complex *Hx,
+                         int ldo, int kpt, MPI_Comm comm)
+{
+    int ityp, iat, ndc, nproj, n_img, atom_index;
+    size_t *displ;
+    double x0_i, y0_i, z0_i, theta;
+    float _Complex *alpha, *x_rc, *Vnlx, a, b;
+    timing_region_begin("Vnl_vec_mult_sp_kpt");
+    alpha = (float _Complex *)calloc( pSPARC->IP_displ[pSPARC->n_atom] * ncol, sizeof(float _Complex));
+    assert(alpha != NULL);
+    // x_rc and Vnlx share the packed buffer of the nonlocal workspace
+    x_rc = Vnlx = (float _Complex *)Vnl_workspace_packed(pSPARC, Atom_Influence_nloc, nlocProj, ncol, 
+        sizeof(float _Complex), 0, &displ);
+    double Lx = pSPARC->range_x;
+    double Ly = pSPARC->range_y;
+    double Lz = pSPARC->range_z;
+    double k1 = pSPARC->k1_loc[kpt];
+    double k2 = pSPARC->k2_loc[kpt];
+    double k3 = pSPARC->k3_loc[kpt];
+
+    //first find inner product
+    for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+        nproj = nlocProj[ityp].nproj;
+        n_img = Atom_Influence_nloc[ityp].n_atom;
+        if (! nproj || ! n_img) continue; // this is typical for hydrogen
+        image_displ_sp(&Atom_Influence_nloc[ityp], displ);
+        gather_sp(&Atom_Influence_nloc[ityp], displ, ncol, (float *)x, ldi, (float *)x_rc, 2);
+        for (iat = 0; iat < n_img; iat++) {
+            x0_i = Atom_Influence_nloc[ityp].coords[iat*3  ];
+            y0_i = Atom_Influence_nloc[ityp].coords[iat*3+1];
+            z0_i = Atom_Influence_nloc[ityp].coords[iat*3+2];
+            theta = -k1 * (floor(x0_i/Lx) * Lx) - k2 * (floor(y0_i/Ly) * Ly) - k3 * (floor(z0_i/Lz) * Lz);
+            a = (float _Complex) ((cos(theta) + sin(theta) * I) * pSPARC->dV);
+            b = 1.0f;
+            ndc = Atom_Influence_nloc[ityp].ndc[iat];
+            atom_index = Atom_Influence_nloc[ityp].atom_index[iat];
+            cblas_cgemm(CblasColMajor, CblasTrans, CblasNoTrans, nproj, ncol, ndc,
+                &a, nlocProj[ityp].Chi_c_sp[iat], ndc, x_rc + displ[iat] * ncol, ndc, &b, 
+                alpha+pSPARC->IP_displ[atom_index]*ncol, nproj);
+        }
+        // inner product and projection back to the grid
+        timing_add_counts(0.0, 16.0 * displ[n_img] * nproj * ncol);
+    }
+
+    int commsize;
+    MPI_Comm_size(comm, &commsize);
+    if (commsize > 1) {
+        MPI_Allreduce(MPI_IN_PLACE, alpha, pSPARC->IP_displ[pSPARC->n_atom] * ncol, MPI_C_FLOAT_COMPLEX, MPI_SUM, comm);
+        timing_add_counts(sizeof(float _Complex) * pSPARC->IP_displ[pSPARC->n_atom] * ncol, 0.0);
+    }
+
+    // go over all atoms and multiply gamma_Jl to the inner product
+    scale_inner_product_sp(pSPARC, (float *)alpha, ncol, 2);
+
+    // multiply the inner product and the nonlocal projector
+    for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+        nproj = nlocProj[ityp].nproj;
+        n_img = Atom_Influence_nloc[ityp].n_atom;
+        if (! nproj || ! n_img) continue;
+        image_displ_sp(&Atom_Influence_nloc[ityp], displ);
+        for (iat = 0; iat < n_img; iat++) {
+            x0_i = Atom_Influence_nloc[ityp].coords[iat*3  ];
+            y0_i = Atom_Influence_nloc[ityp].coords[iat*3+1];
+            z0_i = Atom_Influence_nloc[ityp].coords[iat*3+2];
+            theta = -k1 * (floor(x0_i/Lx) * Lx) - k2 * (floor(y0_i/Ly) * Ly) - k3 * (floor(z0_i/Lz) * Lz);
+            a = (float _Complex) (cos(theta) - sin(theta) * I);
+            b = 0.0f;
+            ndc = Atom_Influence_nloc[ityp].ndc[iat];
+            atom_index = Atom_Influence_nloc[ityp].atom_index[iat];
+            cblas_cgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, ndc, ncol, nproj, &a, nlocProj[ityp].Chi_c_sp[iat], ndc,
+                        alpha+pSPARC->IP_displ[atom_index]*ncol, nproj, &b, Vnlx + displ[iat] * ncol, ndc);
+        }
+        scatter_sp(&Atom_Influence_nloc[ityp], displ, ncol, (float *)Vnlx, (float *)Hx, ldo, 2);
+    }
+    free(alpha);
+    timing_region_end("Vnl_vec_mult_sp_kpt");
+}
+
+
+
+/**
+ * @brief   Calculate (Hamiltonian + c * I) times vectors in single precision.
+ */
+void Hamiltonian_vectors_mult_sp(
+    const SPARC_OBJ *pSPARC, int DMnd, int *DMVertices, float *Veff_loc,
+    ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, NLOC_PROJ_OBJ *nlocProj,
+    int ncol, double c, float *x, const int ldi, float *Hx, const int ldo, MPI_Comm comm
+)
+{
+    int nproc;
+    MPI_Comm_size(comm, &nproc);
+
+    int dims[3], periods[3], my_coords[3];
+    if (nproc > 1)
+        MPI_Cart_get(comm, 3, dims, periods, my_coords);
+    else
+        dims[0] = dims[1] = dims[2] = 1;
+
+    // first find (-0.5 * Lap + Veff + c) * x
+    Lap_plus_diag_vec_mult_orth_sp(
+        pSPARC, DMnd, DMVertices, ncol, -0.5, c, Veff_loc, x, ldi, Hx, ldo, comm, dims
+    );
+
+    // apply nonlocal projectors
+    Vnl_vec_mult_sp(pSPARC, DMnd, Atom_Influence_nloc, nlocProj, ncol, x, ldi, Hx, ldo, comm);
+}
+
+
+
+/**
+ * @brief   Calculate (Hamiltonian + c * I) times vectors in single precision
+ *          with a Bloch wavevector.
+ */
+void Hamiltonian_vectors_mult_sp_kpt(
+    const SPARC_OBJ *pSPARC, int DMnd, int *DMVertices, float *Veff_loc,
+    ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, NLOC_PROJ_OBJ *nlocProj,
+    int ncol, double c, float _Complex *x, const int ldi, float _Complex *Hx, const int ldo,
+    int kpt, MPI_Comm comm
+)
+{
+    int nproc;
+    MPI_Comm_size(comm, &nproc);
+
+    int dims[3], periods[3], my_coords[3];
+    if (nproc > 1)
+        MPI_Cart_get(comm, 3, dims, periods, my_coords);
+    else
+        dims[0] = dims[1] = dims[2] = 1;
+
+    // first find (-0.5 * Lap + Veff + c) * x
+    Lap_plus_diag_vec_mult_orth_sp_kpt(
+        pSPARC, DMnd, DMVertices, ncol, -0.5, c, Veff_loc, x, ldi, Hx, ldo, comm, dims, kpt
+    );
+
+    // apply nonlocal projectors
+    Vnl_vec_mult_sp_kpt(pSPARC, DMnd, Atom_Influence_nloc, nlocProj, ncol, x, ldi, Hx, ldo, kpt, comm);
+}
+
+
+
+/**
+ * @brief   Perform Chebyshev filtering in mixed precision.
+ */
+void ChebyshevFiltering_mixed(
+    SPARC_OBJ *pSPARC, int *DMVertices, double *X, int ldi, double *Y, int ldo, int ncol,
+    int m, double a, double b, double a0, int k, int spn_i, MPI_Comm comm,
+    double *time_info
+)
+{
+    if (comm == MPI_COMM_NULL || pSPARC->bandcomm_index < 0) return;
+    // number of steps done in single precision
+    int m_sp = m - CHEFSI_MIXED_PREC_DP_STEPS;
+    if (m_sp < 1) {
+        ChebyshevFiltering(pSPARC, DMVertices, X, ldi, Y, ldo, ncol, m, a, b, a0, k, spn_i, comm, time_info);
+        return;
+    }
+    // a0: minimum eigval, b: maxinum eigval, a: cutoff eigval
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    #ifdef DEBUG
+    if(!rank && spn_i == 0) printf("Start mixed-precision Chebyshev filtering ... \n");
+    #endif
+
+    double t1, t2;
+    *time_info = 0.0;
+
+    double e, c, sigma, sigma1, sigma2, gamma, vscal, vscal2, *Ynew;
+    int i, j, n, DMnd, len_tot, DMndspe;
+    DMnd = (1 - DMVertices[0] + DMVertices[1]) *
+           (1 - DMVertices[2] + DMVertices[3]) *
+           (1 - DMVertices[4] + DMVertices[5]);
+    DMndspe = DMnd * pSPARC->Nspinor_eig;
+
+    len_tot = DMndspe * ncol;
+    e = 0.5 * (b - a);
+    c = 0.5 * (b + a);
+    sigma = sigma1 = e / (a0 - c);
+    gamma = 2.0 / sigma1;
+
+    int sg  = pSPARC->spin_start_indx + spn_i;
+    double *Veff_loc = pSPARC->Veff_loc_dmcomm + sg * pSPARC->Nd_d_dmcomm;
+    float *Veff_sp = (float *)malloc(DMnd * sizeof(float));
+    float *work = (float *)malloc(3 * (size_t)len_tot * sizeof(float));
+    assert(Veff_sp != NULL && work != NULL);
+    float *Xs = work, *Ys = work + len_tot, *Ynews = work + 2*(size_t)len_tot, *tmp;
+    for (i = 0; i < DMnd; i++) Veff_sp[i] = (float) Veff_loc[i];
+    for (n = 0; n < ncol; n++) {
+        for (i = 0; i < DMndspe; i++) {
+            Xs[i+n*DMndspe] = (float) X[i+n*ldi];
+        }
+    }
+
+    t1 = MPI_Wtime();
+    // find Y = (H - c*I)X
+    Hamiltonian_vectors_mult_sp(
+        pSPARC, DMnd, DMVertices, Veff_sp, pSPARC->Atom_Influence_nloc, pSPARC->nlocProj,
+        ncol, -c, Xs, DMndspe, Ys, DMndspe, comm
+    );
+    t2 = MPI_Wtime();
+    *time_info += t2 - t1;
+
+    // scale Y by (sigma1 / e)
+    float fscal = (float)(sigma1 / e), fscal2;
+    for (i = 0; i < len_tot; i++) Ys[i] *= fscal;
+
+    for (j = 1; j < m_sp; j++) {
+        sigma2 = 1.0 / (gamma - sigma);
+
+        t1 = MPI_Wtime();
+        // Ynew = (H - c*I)Y
+        Hamiltonian_vectors_mult_sp(
+            pSPARC, DMnd, DMVertices, Veff_sp, pSPARC->Atom_Influence_nloc, pSPARC->nlocProj,
+            ncol, -c, Ys, DMndspe, Ynews, DMndspe, comm
+        );
+        t2 = MPI_Wtime();
+        *time_info += t2 - t1;
+
+        // Ynew = (2*sigma2/e) * Ynew - (sigma*sigma2) * X, then update X and Y
+        fscal = (float)(2.0 * sigma2 / e); fscal2 = (float)(sigma * sigma2);
+        for (i = 0; i < len_tot; i++) {
+            Ynews[i] = fscal * Ynews[i] - fscal2 * Xs[i];
+        }
+        tmp = Xs; Xs = Ys; Ys = Ynews; Ynews = tmp;
+        sigma = sigma2;
+    }
+
+    // the last steps of the recurrence are done in double precision
+    for (n = 0; n < ncol; n++) {
+        for (i = 0; i < DMndspe; i++) {
+            X[i+n*ldi] = (double) Xs[i+n*DMndspe];
+            Y[i+n*ldo] = (double) Ys[i+n*DMndspe];
+        }
+    }
+    free(work);
+    free(Veff_sp);
+
+    Ynew = (double *)malloc( len_tot * sizeof(double));
+
+    for (j = m_sp; j < m; j++) {
+        sigma2 = 1.0 / (gamma - sigma);
+
+        t1 = MPI_Wtime();
+        // Ynew = (H - c*I)Y
+        Hamiltonian_vectors_mult(
+            pSPARC, DMnd, DMVertices, Veff_loc,
+            pSPARC->Atom_Influence_nloc, pSPARC->nlocProj, ncol, -c, Y, ldo, Ynew, DMndspe, spn_i, comm
+        );
+        t2 = MPI_Wtime();
+        *time_info += t2 - t1;
+
+        // Ynew = (2*sigma2/e) * Ynew - (sigma*sigma2) * X, then update X and Y
+        vscal = 2.0 * sigma2 / e; vscal2 = sigma * sigma2;
+
+        for (n = 0; n < ncol; n++)  {
+            for (i = 0; i < DMndspe; i++) {
+                Ynew[i+n*DMndspe] *= vscal;
+                Ynew[i+n*DMndspe] -= vscal2 * X[i+n*ldi];
+                X[i+n*ldi] = Y[i+n*ldo];
+                Y[i+n*ldo] = Ynew[i+n*DMndspe];
+            }
+        }
+        sigma = sigma2;
+    }
+    free(Ynew);
+}
+
+
+
+/**
+ * @brief   Perform Chebyshev filtering in mixed precision with a Bloch wavevector.
+ */
+void ChebyshevFiltering_mixed_kpt(
+    SPARC_OBJ *pSPARC, int *DMVertices, double _Complex *X, int ldi, double _Complex *Y, int ldo, int ncol,
+    int m, double a, double b, double a0, int kpt, int spn_i, MPI_Comm comm,
+    double *time_info
+)
+{
+    if (comm == MPI_COMM_NULL || pSPARC->bandcomm_index < 0) return;
+    // number of steps done in single precision
+    int m_sp = m - CHEFSI_MIXED_PREC_DP_STEPS;
+    if (m_sp < 1) {
+        ChebyshevFiltering_kpt(pSPARC, DMVertices, X, ldi, Y, ldo, ncol, m, a, b, a0, kpt, spn_i, comm, time_info);
+        return;
+    }
+    // a0: minimum eigval, b: maxinum eigval, a: cutoff eigval
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    #ifdef DEBUG
+    if(!rank && kpt == 0) printf("Start mixed-precision Chebyshev filtering ... \n");
+    #endif
+
+    double t1, t2;
+    *time_info = 0.0;
+
+    double e, c, sigma, sigma1, sigma2, gamma, vscal, vscal2;
+    double _Complex *Ynew;
+    int i, j, n, DMnd, len_tot, DMndspe;
+    DMnd = (1 - DMVertices[0] + DMVertices[1]) *
+           (1 - DMVertices[2] + DMVertices[3]) *
+           (1 - DMVertices[4] + DMVertices[5]);
+    DMndspe = DMnd * pSPARC->Nspinor_eig;
+
+    len_tot = DMndspe * ncol;
+    e = 0.5 * (b - a);
+    c = 0.5 * (b + a);
+    sigma = sigma1 = e / (a0 - c);
+    gamma = 2.0 / sigma1;
+
+    int sg  = pSPARC->spin_start_indx + spn_i;
+    double *Veff_loc = pSPARC->Veff_loc_dmcomm + sg * pSPARC->Nd_d_dmcomm;
+    float *Veff_sp = (float *)malloc(DMnd * sizeof(float));
+    float _Complex *work = (float _Complex *)malloc(3 * (size_t)len_tot * sizeof(float _Complex));
+    assert(Veff_sp != NULL && work != NULL);
+    float _Complex *Xs = work, *Ys = work + len_tot, *Ynews = work + 2*(size_t)len_tot, *tmp;
+    for (i = 0; i < DMnd; i++) Veff_sp[i] = (float) Veff_loc[i];
+    for (n = 0; n < ncol; n++) {
+        for (i = 0; i < DMndspe; i++) {
+            Xs[i+n*DMndspe] = (float _Complex) X[i+n*ldi];
+        }
+    }
+
+    t1 = MPI_Wtime();
+    // find Y = (H - c*I)X
+    Hamiltonian_vectors_mult_sp_kpt(
+        pSPARC, DMnd, DMVertices, Veff_sp, pSPARC->Atom_Influence_nloc, pSPARC->nlocProj,
+        ncol, -c, Xs, DMndspe, Ys, DMndspe, kpt, comm
+    );
+    t2 = MPI_Wtime();
+    *time_info += t2 - t1;
+
+    // scale Y by (sigma1 / e)
+    float fscal = (float)(sigma1 / e), fscal2;
+    for (i = 0; i < len_tot; i++) Ys[i] *= fscal;
+
+    for (j = 1; j < m_sp; j++) {
+        sigma2 = 1.0 / (gamma - sigma);
+
+        t1 = MPI_Wtime();
+        // Ynew = (H - c*I)Y
+        Hamiltonian_vectors_mult_sp_kpt(
+            pSPARC, DMnd, DMVertices, Veff_sp, pSPARC->Atom_Influence_nloc, pSPARC->nlocProj,
+            ncol, -c, Ys, DMndspe, Ynews, DMndspe, kpt, comm
+        );
+        t2 = MPI_Wtime();
+        *time_info += t2 - t1;
+
+        // Ynew = (2*sigma2/e) * Ynew - (sigma*sigma2) * X, then update X and Y
+        fscal = (float)(2.0 * sigma2 / e); fscal2 = (float)(sigma * sigma2);
+        for (i = 0; i < len_tot; i++) {
+            Ynews[i] = fscal * Ynews[i] - fscal2 * Xs[i];
+        }
+        tmp = Xs; Xs = Ys; Ys = Ynews; Ynews = tmp;
+        sigma = sigma2;
+    }
+
+    // the last steps of the recurrence are done in double precision
+    for (n = 0; n < ncol; n++) {
+        for (i = 0; i < DMndspe; i++) {
+            X[i+n*ldi] = (double _Complex) Xs[i+n*DMndspe];
+            Y[i+n*ldo] = (double _Complex) Ys[i+n*DMndspe];
+        }
+    }
+    free(work);
+    free(Veff_sp);
+
+    Ynew = (double _Complex *)malloc( len_tot * sizeof(double _Complex));
+
+    for (j = m_sp; j < m; j++) {
+        sigma2 = 1.0 / (gamma - sigma);
+
+        t1 = MPI_Wtime();
+        // Ynew = (H - c*I)Y
+        Hamiltonian_vectors_mult_kpt(
+            pSPARC, DMnd, DMVertices, Veff_loc,
+            pSPARC->Atom_Influence_nloc, pSPARC->nlocProj, ncol, -c, Y, ldo, Ynew, DMndspe, spn_i, kpt, comm
+        );
+        t2 = MPI_Wtime();
+        *time_info += t2 - t1;
+
+        // Ynew = (2*sigma2/e) * Ynew - (sigma*sigma2) * X, then update X and Y
+        vscal = 2.0 * sigma2 / e; vscal2 = sigma * sigma2;
+
+        for (n = 0; n < ncol; n++)  {
+            for (i = 0; i < DMndspe; i++) {
+                Ynew[i+n*DMndspe] *= vscal;
+                Ynew[i+n*DMndspe] -= vscal2 * X[i+n*ldi];
+                X[i+n*ldi] = Y[i+n*ldo];
+                Y[i+n*ldo] = Ynew[i+n*DMndspe];
+            }
+        }
+        sigma = sigma2;
+    }
+    free(Ynew);
+}
@@ -31,6 +31,7 @@
 #include "isddft.h"
 #include "linearSolver.h"
 #include "electronDensity.h"
+#include "pencilFFT.h"
 
 #define max(a,b) ((a)>(b)?(a):(b))
 #define min(a,b) ((a)<(b)?(a):(b))
@@ -446,6 +447,127 @@ void Mixing_periodic_pulay(SPARC_OBJ *pSPARC, int iter_count)
 
 
 
+#if defined(USE_MKL) || defined(USE_FFTW)
+/**
+ * @brief   Set up the parallel FFT plan on comm and the symbol of the FD
+ *          Laplacian at the local frequencies (z-pencils) of the plan.
+ *
+ *          The symbol of the second derivative along d is 
+ *          w2_d[0] + 2*sum_p w2_d[p]*cos(p*theta_d), and the mixed derivative
+ *          terms of nonorthogonal cells are products of first derivative
+ *          symbols 2*sum_p w1[p]*sin(p*theta_d)/h_d, i.e., the same stencils
+ *          that Lap_vec_mult applies in real space.
+ */
+static void Kerker_precond_fft_setup(SPARC_OBJ *pSPARC, MPI_Comm comm)
+{
+    int i, j, k, p, lrank, gridsizes[3], *box;
+    int FDn = pSPARC->order / 2;
+    int Nx = pSPARC->Nx, Ny = pSPARC->Ny, Nz = pSPARC->Nz;
+
+    if (pSPARC->PrecondFFT == NULL) {
+        pSPARC->PrecondFFT = (PENCIL_FFT_OBJ *) malloc(sizeof(PENCIL_FFT_OBJ));
+        assert(pSPARC->PrecondFFT != NULL);
+    } else {
+        Pencil_FFT_free(pSPARC->PrecondFFT);
+        free(pSPARC->PrecondFFT_lap);
+    }
+    gridsizes[0] = Nx; gridsizes[1] = Ny; gridsizes[2] = Nz;
+    Pencil_FFT_init(pSPARC->PrecondFFT, gridsizes, 0, 1, comm);
+
+    MPI_Comm_rank(comm, &lrank);
+    box = pSPARC->PrecondFFT->zp_box + 6*lrank;
+    int nd = box[1] * box[3] * box[5];
+    pSPARC->PrecondFFT_lap = (double *) malloc(max(nd, 1) * sizeof(double));
+    assert(pSPARC->PrecondFFT_lap != NULL);
+
+    // 1D symbols of the second and first derivatives
+    double *d2x = (double *) calloc(Nx + Ny + Nz, sizeof(double));
+    double *d1x = (double *) calloc(Nx + Ny + Nz, sizeof(double));
+    assert(d2x != NULL && d1x != NULL);
+    double *d2y = d2x + Nx, *d2z = d2y + Ny;
+    double *d1y = d1x + Nx, *d1z = d1y + Ny;
+    for (i = 0; i < Nx; i++) {
+        d2x[i] = pSPARC->D2_stencil_coeffs_x[0];
+        for (p = 1; p <= FDn; p++) {
+            d2x[i] += 2.0 * pSPARC->D2_stencil_coeffs_x[p] * cos(2.0*M_PI/Nx*p*i);
+            d1x[i] += 2.0 * pSPARC->FDweights_D1[p] * sin(2.0*M_PI/Nx*p*i) / pSPARC->delta_x;
+        }
+    }
+    for (j = 0; j < Ny; j++) {
+        d2y[j] = pSPARC->D2_stencil_coeffs_y[0];
+        for (p = 1; p <= FDn; p++) {
+            d2y[j] += 2.0 * pSPARC->D2_stencil_coeffs_y[p] * cos(2.0*M_PI/Ny*p*j);
+            d1y[j] += 2.0 * pSPARC->FDweights_D1[p] * sin(2.0*M_PI/Ny*p*j) / pSPARC->delta_y;
+        }
+    }
+    for (k = 0; k < Nz; k++) {
+        d2z[k] = pSPARC->D2_stencil_coeffs_z[0];
+        for (p = 1; p <= FDn; p++) {
+            d2z[k] += 2.0 * pSPARC->D2_stencil_coeffs_z[p] * cos(2.0*M_PI/Nz*p*k);
+            d1z[k] += 2.0 * pSPARC->FDweights_D1[p] * sin(2.0*M_PI/Nz*p*k) / pSPARC->delta_z;
+        }
+    }
+
+    for (j = 0; j < box[3]; j++) {
+        int jg = j + box[2];
+        for (i = 0; i < box[1]; i++) {
+            int ig = i + box[0];
+            double *lap = pSPARC->PrecondFFT_lap + (j*box[1] + i)*Nz;
+            for (k = 0; k < Nz; k++) {
+                lap[k] = d2x[ig] + d2y[jg] + d2z[k];
+                if (pSPARC->cell_typ != 0) {
+                    // 2*T_12 d/dx(d/dy) + 2*T_13 d/dx(d/dz) + 2*T_23 d/dy(d/dz)
+                    lap[k] -= 2.0 * (pSPARC->lapcT[1] * d1x[ig] * d1y[jg] 
+                                   + pSPARC->lapcT[2] * d1x[ig] * d1z[k]
+                                   + pSPARC->lapcT[5] * d1y[jg] * d1z[k]);
+                }
+                if (ig == 0 && jg == 0 && k == 0) lap[k] = 0.0; // remove round-off
+            }
+        }
+    }
+    free(d2x);
+    free(d1x);
+}
+
+
+
+/**
+ * @brief   Perform Kerker preconditioner with FFT in periodic cells.
+ *
+ *          The discrete Laplacian is diagonal in Fourier space, so 
+ *          Pf := a * (L - lambda_TF^2)^-1 * (L - idemac*lambda_TF^2)f 
+ *          is applied exactly with one forward and one backward FFT. For 
+ *          lambda_TF = 0 the constant component of Pf is set to 0.
+ */
+static void Kerker_precond_fft(
+    SPARC_OBJ *pSPARC, double *f, const double a, 
+    const double lambda_TF, const double idiemac, double *Pf, MPI_Comm comm
+)
+{
+    int i, lrank, *box;
+    if (pSPARC->PrecondFFT == NULL || pSPARC->PrecondFFT->comm != comm)
+        Kerker_precond_fft_setup(pSPARC, comm);
+    PENCIL_FFT_OBJ *plan = pSPARC->PrecondFFT;
+
+    MPI_Comm_rank(comm, &lrank);
+    box = plan->zp_box + 6*lrank;
+    int nd = box[1] * box[3] * box[5];
+    double lambda_sqr = lambda_TF * lambda_TF;
+    double scale = 1.0 / pSPARC->Nd; // normalization of iFFT
+
+    Pencil_FFT_forward(plan, f, 1);
+    double _Complex *f_hat = (double _Complex *) plan->work2;
+    for (i = 0; i < nd; i++) {
+        double lap = pSPARC->PrecondFFT_lap[i];
+        double den = lap - lambda_sqr;
+        f_hat[i] *= (fabs(den) < 1e-14) ? 0.0 : a * (lap - idiemac * lambda_sqr) / den * scale;
+    }
+    Pencil_FFT_backward(plan, Pf, 1);
+}
+#endif // #if defined(USE_MKL) || defined(USE_FFTW)
+
+
+
 /**
  * @brief   Perform Kerker preconditioner.
  *
@@ -456,6 +578,10 @@ void Mixing_periodic_pulay(SPARC_OBJ *pSPARC, int iter_count)
  *          inverse of diemac (dielectric macroscopic constant).
  *          When c is 0, it's the original Kerker preconditioner.
  *          The result is written in Pf.
+ *
+ *          In cells that are periodic in all directions the operator is 
+ *          applied directly with FFT (if MKL or FFTW is linked), otherwise
+ *          the linear system is solved iteratively with AAR.
  */
 void Kerker_precond(
     SPARC_OBJ *pSPARC, double *f, const double a, 
@@ -465,6 +591,14 @@ void Kerker_precond(
 {
     if (comm == MPI_COMM_NULL) return;
 
+#if defined(USE_MKL) || defined(USE_FFTW)
+    if (pSPARC->BCx == 0 && pSPARC->BCy == 0 && pSPARC->BCz == 0 && pSPARC->CyclixFlag == 0
+        && pSPARC->cell_typ < 20 && comm == pSPARC->dmcomm_phi) {
+        Kerker_precond_fft(pSPARC, f, a, lambda_TF, idiemac, Pf, comm);
+        return;
+    }
+#endif
+
     #ifdef DEBUG
     int rank; MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     if (!rank) printf("Start applying Kerker preconditioner ...\n");
@@ -386,6 +386,8 @@ void add_firstMD(DescriptorObj *desc_str, NeighList *nlist, MLFF_Obj *mlff_str,
 	
 
 	mlff_str->n_cols = count;
+	mlff_str->AtA_F_nrows = 0;
+	mlff_str->AtA_F_ncols = 0;
 
 
 	int *cum_natm_elem1 = (int *)malloc(sizeof(int)*nelem);
@@ -1380,6 +1382,9 @@ void remove_str_rows(MLFF_Obj *mlff_str, int str_ID){
 		}
 	}
 	mlff_str->n_rows = mlff_str->n_rows - rows_to_delete;
+	// rows in the middle of K_train are gone, K'K of the force rows has to be rebuilt
+	mlff_str->AtA_F_nrows = 0;
+	mlff_str->AtA_F_ncols = 0;
 }
 
 /*
@@ -1421,6 +1426,8 @@ void remove_train_cols(MLFF_Obj *mlff_str, int col_ID){
 	for (i =col_ID; i < mlff_str->n_cols-1; i++){
 		mlff_str->natm_typ_train[i] = mlff_str->natm_typ_train[i+1];
 	}
+
+	remove_AtA_force_col(mlff_str, col_ID);
 	
 	mlff_str->n_cols = mlff_str->n_cols - 1;
 }
@@ -408,6 +408,8 @@ void read_MLFF_files(MLFF_Obj *mlff_str, SPARC_OBJ *pSPARC){
             int n_rows;
             fscanf(fptr,"%d", &n_rows);
             mlff_str->n_rows = n_rows;
+            mlff_str->AtA_F_nrows = 0;
+            mlff_str->AtA_F_ncols = 0;
             fscanf(fptr, "%*[^\n]\n");
         } else if (strcmpi(str,"n_cols:") == 0){
             fscanf(fptr,"%d", &mlff_str->n_cols);
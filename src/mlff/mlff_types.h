@@ -18,6 +18,7 @@
 
 
 typedef struct NeighList NeighList;
+typedef struct NeighListCache NeighListCache;
 typedef struct SoapObj SoapObj;
 typedef struct DescriptorObj DescriptorObj;
 typedef struct MLFF_Obj MLFF_Obj;
@@ -123,6 +124,28 @@ typedef struct DescriptorObj
 } DescriptorObj;
 
 
+/**
+ * @brief   This structure type keeps the candidate neighbors (within rcut + skin) of the local atoms,
+ *          which are reused by build_nlist across MD steps until an atom has moved more than skin/2
+ */
+typedef struct NeighListCache
+{
+  double skin;                      // Verlet skin (bohr), no reuse if skin <= 0
+  int valid;                        // if the candidates below can be checked for reuse
+  int natom;
+  int natom_domain;
+  int cell_typ;
+  int BC[3];
+  double cell_len[3];
+  double LatUVec[9];
+  double twist;                     // system the candidates were built for
+  double rcut;
+  double *atompos_ref;              // atom positions when the candidates were built
+  int *atom_idx_domain;
+  dyArray *candidates;              // for each local atom, (j, img_x, img_y, img_z) of the candidate neighbors, sorted
+} NeighListCache;
+
+
 typedef struct MLFF_Obj
 {
 
@@ -139,10 +162,16 @@ typedef struct MLFF_Obj
   int if_sparsify_before_train;
   double **K_train;
   double *b_no_norm;    // Covariance matrix anf E,F,sigma vectors
-  double *AtA_SVD_U;
-  double *AtA_SVD_Vt;
-  double *AtA_SingVal;
+  double *AtA_chol;     // Cholesky factor of K'K + (sigma_v/sigma_w)^2*I used in the weights and the Bayesian error
+  int AtA_chol_ncols;   // size of AtA_chol kept for its update at the next training (0: recompute, rank 0 only)
+  int n_str_hyper;      // number of structures at the last hyperparameter optimization (-1: never)
+  int hyper_nstr;       // hyperparameters are re-optimized after this many new structures (MLFF_HYPER_NSTR)
+  double hyper_tol; // relative change of the row scales or hyperparameters that triggers a re-optimization (MLFF_HYPER_TOL)
   double *AtA;          
+  double *AtA_F;        // unscaled K'K of the force rows accumulated over trainings (rank 0 only)
+  double *Atb_F;        // unscaled K'b of the force rows accumulated over trainings (rank 0 only)
+  int AtA_F_nrows;      // number of local rows of K_train included in AtA_F
+  int AtA_F_ncols;      // number of cols of K_train included in AtA_F (0: rebuild from scratch)
   double *weights;     
   double *cov_train;
   dyArray atom_idx_addtrain;   // matrices required during BLR
@@ -232,6 +261,7 @@ typedef struct MLFF_Obj
   int stress_len;
   int mlff_flag;
   FILE *fp_mlff;
+  NeighListCache nlist_cache;  // Verlet list reused across MD steps by build_nlist
 
   // GMP variables
   int **params_i;
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <complex.h>
 #include <math.h>
+#include <float.h>
 #include <time.h>
 #include <mpi.h>
 
@@ -176,10 +177,28 @@ t1 = MPI_Wtime();
 	double *a_scaled, *b_scaled;
 	int info, m = mlff_str->n_rows, n = mlff_str->n_cols;
 
-	mlff_str->E_scale = 1.0;
-	mlff_str->F_scale = mlff_str->std_E/mlff_str->std_F;
+	// the row scales are only refreshed with the hyperparameters or when they move by more than
+	// MLFF_HYPER_TOL, in between K'K only changes by the new rows and columns and the
+	// Cholesky factor of the last training can be updated
+	int hyper_due = mlff_str->n_str_hyper < 0 || abs(mlff_str->n_str - mlff_str->n_str_hyper) >= mlff_str->hyper_nstr;
+	int rescale = hyper_due || !(fabs(mlff_str->F_scale*mlff_str->std_F/mlff_str->std_E - 1.0) <= mlff_str->hyper_tol);
 	for (int i = 0; i < mlff_str->stress_len; i++){
-		mlff_str->stress_scale[i] = mlff_str->std_E/mlff_str->std_stress[i];
+		rescale = rescale || !(fabs(mlff_str->stress_scale[i]*mlff_str->std_stress[i]/mlff_str->std_E - 1.0) <= mlff_str->hyper_tol);
+	}
+	MPI_Bcast(&rescale, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	if (rescale){
+		mlff_str->E_scale = 1.0;
+		mlff_str->F_scale = mlff_str->std_E/mlff_str->std_F;
+		for (int i = 0; i < mlff_str->stress_len; i++){
+			mlff_str->stress_scale[i] = mlff_str->std_E/mlff_str->std_stress[i];
+		}
+		mlff_str->AtA_chol_ncols = 0;
+	}
+	// units of the scaled force and stress rows, std_F and std_stress when the scales are fresh
+	double unit_F = mlff_str->std_E/mlff_str->F_scale;
+	double unit_stress[mlff_str->stress_len];
+	for (int i = 0; i < mlff_str->stress_len; i++){
+		unit_stress[i] = mlff_str->std_E/mlff_str->stress_scale[i];
 	}
 
 	a_scaled = (double *) malloc(m*n * sizeof(double));
@@ -197,10 +216,10 @@ t1 = MPI_Wtime();
 				b_scaled[i] = (1.0/mlff_str->std_E)*(mlff_str->b_no_norm[i] - mlff_str->mu_E);
 			} else if (quot>0 && quot < 1+mlff_str->stress_len) {
 				scale = mlff_str->stress_scale[quot-1]* mlff_str->relative_scale_stress[quot-1];
-				b_scaled[i] = (1.0/mlff_str->std_stress[quot-1])*(mlff_str->b_no_norm[i])* mlff_str->relative_scale_stress[quot-1];
+				b_scaled[i] = (1.0/unit_stress[quot-1])*(mlff_str->b_no_norm[i])* mlff_str->relative_scale_stress[quot-1];
 			} else {
 				scale = mlff_str->F_scale* mlff_str->relative_scale_F;
-				b_scaled[i] = (1.0/mlff_str->std_F)*(mlff_str->b_no_norm[i])* mlff_str->relative_scale_F;
+				b_scaled[i] = (1.0/unit_F)*(mlff_str->b_no_norm[i])* mlff_str->relative_scale_F;
 				
 			}
 			for (int j = 0; j < n; j++){
@@ -209,7 +228,7 @@ t1 = MPI_Wtime();
 		}
 	} else {
 		for (int i = 0; i < m; i++ ){
-			b_scaled[i] = (1.0/mlff_str->std_F)*(mlff_str->b_no_norm[i])* mlff_str->relative_scale_F;
+			b_scaled[i] = (1.0/unit_F)*(mlff_str->b_no_norm[i])* mlff_str->relative_scale_F;
 			for (int j = 0; j < n; j++){
 				a_scaled[j*m+i] = mlff_str->F_scale* mlff_str->relative_scale_F * mlff_str->K_train[i][j];
 			}
@@ -227,7 +246,6 @@ t2 = MPI_Wtime();
 	}
 t1 = MPI_Wtime();
 
-	double *AtA, *Atb, *AtA_h, *Atb_h;
 	double btb=0.0;
 
 	for (int i=0; i < mlff_str->n_rows; i++){
@@ -237,36 +255,53 @@ t1 = MPI_Wtime();
 	double btb_reduced;
 	MPI_Allreduce(&btb, &btb_reduced, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
 
-	AtA = (double *) malloc(sizeof(double)* mlff_str->n_cols * mlff_str->n_cols);
-	Atb = (double *) malloc(sizeof(double)* mlff_str->n_cols);
+	// K'K and K'b of the force rows are only updated for the rows and columns added since the last training
+	int n_kept = update_AtA_force(mlff_str);
 
-	AtA_h = (double *) malloc(sizeof(double)* mlff_str->n_cols * mlff_str->n_cols);
-	Atb_h = (double *) malloc(sizeof(double)* mlff_str->n_cols);
+	double *AtA_reduced = NULL, *Atb_reduced = NULL, *AtA_prev = NULL;
+	if (rank == 0){
+		AtA_reduced = (double *) malloc(sizeof(double)* n * n);
+		Atb_reduced = (double *) malloc(sizeof(double)* n);
 
-	if ( mlff_str->n_rows > 0){
-		// AtA MKL call
-		cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, mlff_str->n_cols, mlff_str->n_cols,
-                    mlff_str->n_rows, 1.0, a_scaled, mlff_str->n_rows, a_scaled, mlff_str->n_rows,
-                     0.0, AtA, mlff_str->n_cols);
-		// Atb MKL call
-		cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, mlff_str->n_cols, 1, mlff_str->n_rows,
-                    1.0, a_scaled, mlff_str->n_rows, b_scaled, mlff_str->n_rows,
-                     0.0, Atb, mlff_str->n_cols);
-		for (int i=0; i < mlff_str->n_cols * mlff_str->n_cols; i++){
-			 AtA_h[i] = AtA[i];
+		double scale_F = mlff_str->F_scale* mlff_str->relative_scale_F;
+		double scale_bF = scale_F * mlff_str->relative_scale_F/unit_F;
+		for (int i=0; i < n * n; i++){
+			AtA_reduced[i] = scale_F * scale_F * mlff_str->AtA_F[i];
 		}
-		for (int i=0; i < mlff_str->n_cols; i++){
-			Atb_h[i] = Atb[i];
+		for (int i=0; i < n; i++){
+			Atb_reduced[i] = scale_bF * mlff_str->Atb_F[i];
 		}
 
-	} else {
-		for (int i=0; i < mlff_str->n_cols * mlff_str->n_cols; i++){
-			AtA[i] = 0.0;
-			AtA_h[i] = 0.0;
+		// energy and stress rows (only a few per structure) are added directly since their scaling changes
+		int nrow_per_str = 1+mlff_str->stress_len+3*mlff_str->natom_domain;
+		int n_ES = 0;
+		for (int i = 0; i < m; i++){
+			if (i%nrow_per_str < 1+mlff_str->stress_len) n_ES++;
+		}
+		if (n_ES > 0){
+			double *a_ES = (double *) malloc(sizeof(double)* n_ES * n);
+			double *b_ES = (double *) malloc(sizeof(double)* n_ES);
+			int count = 0;
+			for (int i = 0; i < m; i++){
+				if (i%nrow_per_str >= 1+mlff_str->stress_len) continue;
+				b_ES[count] = b_scaled[i];
+				for (int j = 0; j < n; j++){
+					a_ES[j*n_ES+count] = a_scaled[j*m+i];
+				}
+				count++;
+			}
+			cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, n, n, n_ES, 
+						1.0, a_ES, n_ES, a_ES, n_ES, 1.0, AtA_reduced, n);
+			cblas_dgemv(CblasColMajor, CblasTrans, n_ES, n, 1.0, a_ES, n_ES, b_ES, 1, 1.0, Atb_reduced, 1);
+			free(a_ES);
+			free(b_ES);
 		}
-		for (int i=0; i < mlff_str->n_cols; i++){
-			Atb_h[i] = 0.0;
-			Atb[i] = 0.0;
+
+		// K'K of the last training is kept for the update of the Cholesky factor
+		AtA_prev = mlff_str->AtA;
+		mlff_str->AtA = (double *) malloc(sizeof(double)*n*n);
+		for (int i= 0; i < n*n; i++){
+			mlff_str->AtA[i] = AtA_reduced[i];
 		}
 	}
 
@@ -280,79 +315,59 @@ t2 = MPI_Wtime();
 	if (mlff_str->print_mlff_flag == 1 && rank ==0){
 		fprintf(fp_mlff, "Calculation btb, AtA, Atb done! Time taken: %.3f s\n", t2-t1);
 	}
-	
-t1 = MPI_Wtime();
-
-	double *AtA_reduced, *Atb_reduced, *AtA_h_reduced, *Atb_h_reduced;
-	AtA_reduced = (double *) malloc(sizeof(double)* mlff_str->n_cols * mlff_str->n_cols);
-	Atb_reduced = (double *) malloc(sizeof(double)* mlff_str->n_cols);
-
-	AtA_h_reduced = (double *) malloc(sizeof(double)* mlff_str->n_cols * mlff_str->n_cols);
-	Atb_h_reduced = (double *) malloc(sizeof(double)* mlff_str->n_cols);
-
-	MPI_Allreduce(AtA, AtA_reduced, mlff_str->n_cols * mlff_str->n_cols, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-	MPI_Allreduce(Atb, Atb_reduced, mlff_str->n_cols , MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-
-	for (int i=0; i < mlff_str->n_cols * mlff_str->n_cols; i++){
-		AtA_h_reduced[i] = AtA_reduced[i];
-	}
-	for (int i=0; i < mlff_str->n_cols; i++){
-		Atb_h_reduced[i] = Atb_reduced[i];
-	}
-
-t2 = MPI_Wtime();
-#ifdef DEBUG
-	if (rank == 0) {
-	    printf("Doing MPI_Allreduce for AtA and Atb took %.3f s.\n", t2 - t1); 
-	}
-#endif 
-	if (mlff_str->print_mlff_flag == 1 && rank ==0){
-		fprintf(fp_mlff, "Doing MPI_Allreduce for AtA and Atb done! Time taken: %.3f s\n", t2-t1);
-	}
-	free(mlff_str->AtA);
-	mlff_str->AtA = (double *) malloc(sizeof(double)*mlff_str->n_cols*mlff_str->n_cols);
-	for (int i= 0; i < mlff_str->n_cols*mlff_str->n_cols; i++){
-		mlff_str->AtA[i] = AtA_reduced[i];
-	}
 
-	int ipiv[mlff_str->n_cols];
 	int M_total_rows;
 	MPI_Allreduce(&mlff_str->n_rows, &M_total_rows, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
 
-	free(mlff_str->AtA_SVD_U);
-	free(mlff_str->AtA_SVD_Vt);
-	free(mlff_str->AtA_SingVal);
-	mlff_str->AtA_SVD_U = (double *)malloc(mlff_str->n_cols*mlff_str->n_cols*sizeof(double));
-	mlff_str->AtA_SVD_Vt = (double *)malloc(mlff_str->n_cols*mlff_str->n_cols*sizeof(double));
-	mlff_str->AtA_SingVal = (double *)malloc(mlff_str->n_cols*sizeof(double));
-
 t1 = MPI_Wtime();
+	double *R = (double *)malloc(n*n*sizeof(double));
 	if (rank==0){
-		double sigma_w, sigma_v;
-		int dohyperparameter = 1;
-		if (dohyperparameter){
-			hyperparameter_Bayesian(btb_reduced, AtA_h_reduced, Atb_h_reduced, mlff_str, M_total_rows, mlff_str->condK_min);
-		}
-
-		MPI_Bcast(&mlff_str->sigma_v, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-		MPI_Bcast(&mlff_str->sigma_w, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-		MPI_Bcast(mlff_str->weights, mlff_str->n_cols, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-		MPI_Bcast(mlff_str->AtA_SingVal, mlff_str->n_cols, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-		MPI_Bcast(mlff_str->AtA_SVD_U, mlff_str->n_cols*mlff_str->n_cols, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-		MPI_Bcast(mlff_str->AtA_SVD_Vt, mlff_str->n_cols*mlff_str->n_cols, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+		// the Cholesky factor of the last training is updated for the new rows and columns if the
+		// old columns and the row scales did not change, otherwise it is recomputed
+		double regul = (mlff_str->sigma_v*mlff_str->sigma_v)/(mlff_str->sigma_w*mlff_str->sigma_w);
+		int n0 = mlff_str->AtA_chol_ncols;
+		int R_valid = !hyper_due && n0 > 0 && n0 == n_kept
+			&& update_AtA_chol(AtA_prev, AtA_reduced, regul, n0, n, mlff_str->AtA_chol, R) == 0;
+		free(mlff_str->AtA_chol);
+		mlff_str->AtA_chol = R;
+		mlff_str->AtA_chol_ncols = n;
+		if (mlff_str->print_mlff_flag == 1){
+			fprintf(fp_mlff, "Cholesky factor of K'K %s\n", R_valid ? "updated" : "recomputed");
+		}
+
+		// the hyperparameters (eigendecomposition of K'K) are only re-optimized every MLFF_HYPER_NSTR
+		// structures or when they drift, otherwise the weights come from the Cholesky factor
+		int reopt = hyper_due;
+		if (!reopt){
+			reopt = hyperparameter_drift(btb_reduced, AtA_reduced, Atb_reduced, mlff_str, M_total_rows, mlff_str->condK_min, R_valid);
+		}
+		if (reopt){
+			hyperparameter_Bayesian(btb_reduced, AtA_reduced, Atb_reduced, mlff_str, M_total_rows, mlff_str->condK_min);
+			mlff_str->n_str_hyper = mlff_str->n_str;
+			double regul = (mlff_str->sigma_v*mlff_str->sigma_v)/(mlff_str->sigma_w*mlff_str->sigma_w);
+			if (factorize_AtA_regularized(AtA_reduced, regul, mlff_str->n_cols, mlff_str->AtA_chol) != 0){
+				printf("Cholesky factorization of the regularized K'K failed after the hyperparameter optimization.\n");
+				exit(1);
+			}
+		}
+		if (mlff_str->print_mlff_flag == 1){
+			fprintf(fp_mlff, "Hyperparameters %s\n", reopt ? "re-optimized" : "kept, weights from the Cholesky factor");
+		}
+		free(AtA_prev);
 	} else {
-		MPI_Bcast(&mlff_str->sigma_v, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-		MPI_Bcast(&mlff_str->sigma_w, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-		MPI_Bcast(mlff_str->weights, mlff_str->n_cols, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-		MPI_Bcast(mlff_str->AtA_SingVal, mlff_str->n_cols, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-		MPI_Bcast(mlff_str->AtA_SVD_U, mlff_str->n_cols*mlff_str->n_cols, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-		MPI_Bcast(mlff_str->AtA_SVD_Vt, mlff_str->n_cols*mlff_str->n_cols, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+		free(mlff_str->AtA_chol);
+		mlff_str->AtA_chol = R;
 	}
+	MPI_Bcast(&mlff_str->sigma_v, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	MPI_Bcast(&mlff_str->sigma_w, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	MPI_Bcast(&mlff_str->n_str_hyper, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	MPI_Bcast(mlff_str->weights, mlff_str->n_cols, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	MPI_Bcast(mlff_str->AtA_chol, mlff_str->n_cols*mlff_str->n_cols, MPI_DOUBLE, 0, MPI_COMM_WORLD);
 
 t2 = MPI_Wtime();
 #ifdef DEBUG
 	if (rank == 0) {
-	    printf("Doing hyperparameter_Bayesian and broadcasting weights and SVD took %.3f s.\n", t2 - t1); 
+	    printf("Doing hyperparameter_Bayesian and broadcasting weights and Cholesky factor took %.3f s.\n", t2 - t1); 
 	}	
 #endif 
 	if (mlff_str->print_mlff_flag == 1 && rank ==0){
@@ -383,12 +398,12 @@ t1 = MPI_Wtime();
 	    				error_train_E = error_b_scaled[i];
 	    			}
 	    		} else if (quot>0 && quot < 1+mlff_str->stress_len){
-	    			error_b_scaled[i] = error_b_scaled[i] * mlff_str->std_stress[quot-1] / mlff_str->relative_scale_stress[quot-1];
+	    			error_b_scaled[i] = error_b_scaled[i] * unit_stress[quot-1] / mlff_str->relative_scale_stress[quot-1];
 	    			if (error_b_scaled[i] > error_train_stress[quot-1]){
 	    				error_train_stress[quot-1] = error_b_scaled[i];
 	    			}
 	    		} else {
-	    			error_b_scaled[i] = error_b_scaled[i] * mlff_str->std_F / mlff_str->relative_scale_F;
+	    			error_b_scaled[i] = error_b_scaled[i] * unit_F / mlff_str->relative_scale_F;
 	    			if (error_b_scaled[i]>error_train_F){
 	    				error_train_F = error_b_scaled[i];
 	    			}
@@ -396,7 +411,7 @@ t1 = MPI_Wtime();
 	    	}
 	    } else {
 	    	for (int i=0; i < mlff_str->n_rows; i++){
-	    		error_b_scaled[i] = error_b_scaled[i] * mlff_str->std_F / mlff_str->relative_scale_F;
+	    		error_b_scaled[i] = error_b_scaled[i] * unit_F / mlff_str->relative_scale_F;
 	    		if (error_b_scaled[i]>error_train_F){
 	    			error_train_F = error_b_scaled[i];
 	    		}
@@ -431,12 +446,8 @@ t2 = MPI_Wtime();
 	print_restart_MLFF(mlff_str);
 	if (rank==0) print_ref_atom_MLFF(mlff_str);
 
-	free(a_scaled); free(AtA_reduced); free(Atb_reduced);free(AtA_h_reduced); free(Atb_h_reduced);
+	free(a_scaled); free(AtA_reduced); free(Atb_reduced);
 	free(b_scaled);
-	free(AtA);
-	free(Atb);
-	free(AtA_h);
-	free(Atb_h);
 	free(b_predict);
 	free(error_b_scaled);
 t4 = MPI_Wtime();
@@ -446,12 +457,148 @@ t4 = MPI_Wtime();
 	}
 #endif
 	if (mlff_str->print_mlff_flag == 1 && rank ==0){
-		fprintf(fp_mlff, "mlff_train_Bayesian done! Time taken: %.3f s\n", t2-t1);
+		fprintf(fp_mlff, "mlff_train_Bayesian done! Time taken: %.3f s\n", t4-t3);
 		// fclose(fp_mlff);
 	}
 }
 
 
+/*
+Update K'K and K'b of the (unscaled) force rows of K_train. Rows and columns are only
+appended to K_train between trainings, so only the contributions of the new rows (all 
+columns) and of the old rows to the new columns are computed. Result is reduced on rank 0.
+
+Input:
+1. mlff_str: MLFF structure
+
+Output:
+1. mlff_str: MLFF structure (AtA_F, Atb_F on rank 0)
+2. returns the number of columns kept from the last call (0: rebuilt from scratch)
+*/
+int update_AtA_force(MLFF_Obj *mlff_str){
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	int m = mlff_str->n_rows, n = mlff_str->n_cols;
+	int m0 = mlff_str->AtA_F_nrows, n0 = mlff_str->AtA_F_ncols;
+	int valid = (m0 <= m && n0 <= n), valid_all;
+	MPI_Allreduce(&valid, &valid_all, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+	if (!valid_all || n0 == 0) {
+		m0 = 0; n0 = 0;
+	}
+	int k = n - n0;
+
+	// split local force rows into rows already in AtA_F and new rows
+	int nrow_per_str = 1+mlff_str->stress_len+3*mlff_str->natom_domain;
+	int m_old = 0, m_new = 0;
+	for (int i = 0; i < m; i++){
+		if (rank == 0 && i%nrow_per_str < 1+mlff_str->stress_len) continue;
+		if (i < m0) m_old++; else m_new++;
+	}
+
+	double *a_old = (double *) malloc(sizeof(double) * max(m_old*n,1));
+	double *b_old = (double *) malloc(sizeof(double) * max(m_old,1));
+	double *a_new = (double *) malloc(sizeof(double) * max(m_new*n,1));
+	double *b_new = (double *) malloc(sizeof(double) * max(m_new,1));
+	int count_old = 0, count_new = 0;
+	for (int i = 0; i < m; i++){
+		if (rank == 0 && i%nrow_per_str < 1+mlff_str->stress_len) continue;
+		if (i < m0) {
+			if (k > 0){
+				b_old[count_old] = mlff_str->b_no_norm[i];
+				for (int j = 0; j < n; j++) a_old[j*m_old+count_old] = mlff_str->K_train[i][j];
+			}
+			count_old++;
+		} else {
+			b_new[count_new] = mlff_str->b_no_norm[i];
+			for (int j = 0; j < n; j++) a_new[j*m_new+count_new] = mlff_str->K_train[i][j];
+			count_new++;
+		}
+	}
+
+	// [dAtA | dAtb] in one buffer for a single reduction
+	double *delta = (double *) calloc(n*n+n, sizeof(double));
+	if (m_new > 0){
+		cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, n, n, m_new, 
+					1.0, a_new, m_new, a_new, m_new, 0.0, delta, n);
+		cblas_dgemv(CblasColMajor, CblasTrans, m_new, n, 1.0, a_new, m_new, b_new, 1, 0.0, delta+n*n, 1);
+	}
+	if (k > 0 && m_old > 0){
+		double *D2 = (double *) malloc(sizeof(double) * n * k);
+		cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, n, k, m_old, 
+					1.0, a_old, m_old, a_old+n0*m_old, m_old, 0.0, D2, n);
+		for (int c = 0; c < k; c++){
+			for (int r = 0; r < n; r++){
+				delta[(n0+c)*n+r] += D2[c*n+r];
+			}
+			for (int r = 0; r < n0; r++){
+				delta[r*n+n0+c] += D2[c*n+r];
+			}
+		}
+		cblas_dgemv(CblasColMajor, CblasTrans, m_old, k, 1.0, a_old+n0*m_old, m_old, b_old, 1, 1.0, delta+n*n+n0, 1);
+		free(D2);
+	}
+
+	if (rank == 0){
+		MPI_Reduce(MPI_IN_PLACE, delta, n*n+n, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+		double *AtA_F = (double *) malloc(sizeof(double) * n * n);
+		double *Atb_F = (double *) malloc(sizeof(double) * n);
+		for (int j = 0; j < n; j++){
+			for (int i = 0; i < n; i++){
+				AtA_F[j*n+i] = delta[j*n+i] + ((i < n0 && j < n0) ? mlff_str->AtA_F[j*n0+i] : 0.0);
+			}
+			Atb_F[j] = delta[n*n+j] + (j < n0 ? mlff_str->Atb_F[j] : 0.0);
+		}
+		free(mlff_str->AtA_F);
+		free(mlff_str->Atb_F);
+		mlff_str->AtA_F = AtA_F;
+		mlff_str->Atb_F = Atb_F;
+	} else {
+		MPI_Reduce(delta, NULL, n*n+n, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+	}
+	mlff_str->AtA_F_nrows = m;
+	mlff_str->AtA_F_ncols = n;
+
+	free(a_old); free(b_old);
+	free(a_new); free(b_new);
+	free(delta);
+	return n0;
+}
+
+
+/*
+Remove a column of K_train from the accumulated K'K and K'b of the force rows
+
+Input:
+1. mlff_str: MLFF structure
+2. col_ID: ID of the local confiugration removed from the training dataset
+
+Output:
+1. mlff_str: MLFF structure
+*/
+void remove_AtA_force_col(MLFF_Obj *mlff_str, int col_ID){
+	int n0 = mlff_str->AtA_F_ncols;
+	if (col_ID >= n0) return;
+
+	if (mlff_str->AtA_F != NULL){
+		int count = 0;
+		for (int j = 0; j < n0; j++){
+			if (j == col_ID) continue;
+			for (int i = 0; i < n0; i++){
+				if (i == col_ID) continue;
+				mlff_str->AtA_F[count++] = mlff_str->AtA_F[j*n0+i];
+			}
+		}
+		for (int j = col_ID; j < n0-1; j++){
+			mlff_str->Atb_F[j] = mlff_str->Atb_F[j+1];
+		}
+	}
+	mlff_str->AtA_F_ncols = n0 - 1;
+	// the Cholesky factor of K'K cannot be updated once a column is removed
+	mlff_str->AtA_chol_ncols = 0;
+}
+
+
 /*
 Hyperparameter optimization (noise parameter and the prior on w)
 
@@ -474,93 +621,57 @@ double t1, t2, t3, t4;
     	fp_mlff = mlff_str->fp_mlff;
     }
 
-
-t1 = MPI_Wtime();
-
-	double *AtA_h, *Atb_h;
-
-	AtA_h = (double *) malloc(mlff_str->n_cols*mlff_str->n_cols*sizeof(double));
-	Atb_h = (double *) malloc(mlff_str->n_cols*sizeof(double));
-
-	for (int i =0; i <mlff_str->n_cols; i++){
-		Atb_h[i] = Atb[i];
-		for (int j=0; j <mlff_str->n_cols; j++){
-			 AtA_h[j*mlff_str->n_cols+i] = AtA[j*mlff_str->n_cols+i];
-		}
-	}
-
-	int ipiv[mlff_str->n_cols], info;
-
-	// info = LAPACKE_dsyevd(LAPACK_COL_MAJOR, 'V', 'U', mlff_str->n_cols, AtA_h, mlff_str->n_cols, lambda_0);
-
-	double *u, *vt, *S_0, *S, *superb;
-	S_0 = (double *) malloc(sizeof(double)* mlff_str->n_cols);
-	S = (double *) malloc(sizeof(double)* mlff_str->n_cols);
-	u = (double *)malloc(sizeof(double)*mlff_str->n_cols*mlff_str->n_cols);
-	vt = (double *)malloc(sizeof(double)*mlff_str->n_cols*mlff_str->n_cols);
-	superb = (double *)malloc(sizeof(double)*mlff_str->n_cols);
-
-t2 = MPI_Wtime();
-#ifdef DEBUG
-	printf("Doing hyperparameter_Bayesian and broadcasting weights and SVD took %.3f s.\n", t2 - t1); 
-#endif
-
-	if (mlff_str->print_mlff_flag == 1 && rank ==0){
-		fprintf(fp_mlff, "broadcasting weights and SVD done! Time taken: %.3f s\n", t2-t1);
+	int n = mlff_str->n_cols, info;
+	double *V, *lambda, *S_0, *S, *c, *y;
+	V = (double *) malloc(n*n*sizeof(double));
+	lambda = (double *) malloc(n*sizeof(double));
+	S_0 = (double *) malloc(n*sizeof(double));
+	S = (double *) malloc(n*sizeof(double));
+	c = (double *) malloc(n*sizeof(double));
+	y = (double *) malloc(n*sizeof(double));
+
+	for (int i = 0; i < n*n; i++){
+		V[i] = AtA[i];
 	}
 
 t1 = MPI_Wtime();
 
-	info = LAPACKE_dgesvd(LAPACK_COL_MAJOR, 'A', 'A', mlff_str->n_cols, mlff_str->n_cols, 
-						  AtA_h, mlff_str->n_cols, S_0, u, mlff_str->n_cols, vt, mlff_str->n_cols,superb);
+	// AtA is symmetric, one eigendecomposition replaces the SVD and all linear solves in the loop
+	info = LAPACKE_dsyevd(LAPACK_COL_MAJOR, 'V', 'U', n, V, n, lambda);
 
 t2 = MPI_Wtime();
 #ifdef DEBUG
-	printf("Doing SVD of AtA took %.3f s.\n", t2 - t1); 
+	printf("Doing eigendecomposition of AtA took %.3f s.\n", t2 - t1); 
 #endif
 	if (mlff_str->print_mlff_flag == 1 && rank ==0){
-		fprintf(fp_mlff, "SVD of AtA done! Time taken: %.3f s\n", t2-t1);
+		fprintf(fp_mlff, "Eigendecomposition of AtA done! Time taken: %.3f s\n", t2-t1);
 	}
 t1 = MPI_Wtime();
 
-	if (info==0){
-		printf("SVD inside hyperparameter_Bayesian is successful!!\n");
-	} else if (info < 0){
-		
-		printf("the %d-th parameter in SVD inside hyperparameter_Bayesian had an illegal value.\n", info);
+	if (info < 0){
+		printf("the %d-th parameter in eigendecomposition inside hyperparameter_Bayesian had an illegal value.\n", info);
 		exit(1);
-	} else {
-		printf(" ?bdsqr did not converge in SVD inside hyperparameter_Bayesian.\n");
+	} else if (info > 0){
+		printf("Eigendecomposition inside hyperparameter_Bayesian did not converge.\n");
 		exit(1);
 	}
 
-	for (int i=0; i < mlff_str->n_cols; i++){
-		mlff_str->AtA_SingVal[i] = S_0[i];
+	// singular values of AtA
+	for (int k = 0; k < n; k++){
+		S_0[k] = fabs(lambda[k]);
 	}
 
-	for (int i=0; i < mlff_str->n_cols * mlff_str->n_cols; i++){
-		mlff_str->AtA_SVD_U[i] = u[i];
-		mlff_str->AtA_SVD_Vt[i] = vt[i];
-	}
+	// coefficients of Atb in the eigenbasis
+	cblas_dgemv(CblasColMajor, CblasTrans, n, n, 1.0, V, n, Atb, 1, 0.0, c, 1);
 
 	double error_w = 10, error_v=1, error_tol_v = 0.001, error_tol_w = 1, sigma_v, sigma_w;
 	double sigma_v0, sigma_w0;
-	double *term2, *term3, *AtAw;
-	double *weights, *Ax, *e;
-	double *s_loop;
-	int matrank;
-
-	weights = (double *) malloc(mlff_str->n_cols*sizeof(double));
-	Ax = (double *) malloc(sizeof(double)*mlff_str->n_rows);
-	e = (double *) malloc(sizeof(double)*mlff_str->n_rows);
-
-	term2 = (double *)malloc(sizeof(double)*1);
-	term3 = (double *)malloc(sizeof(double)*1);
-	AtAw = (double *)malloc(sizeof(double)*mlff_str->n_cols);
-    
-    s_loop = (double *)malloc(sizeof(double)*mlff_str->n_cols);
+	double lambda_max = 0.0;
+	for (int k = 0; k < n; k++){
+		lambda_max = max(lambda_max, fabs(lambda[k]));
+	}
 
-    double regul_min = get_regularization_min(AtA, mlff_str->n_cols, condK_min);
+    double regul_min = get_regularization_min(lambda, n, condK_min);
 
     sigma_v0 = mlff_str->sigma_v;
     sigma_w0 =  mlff_str->sigma_w;
@@ -575,7 +686,9 @@ t1 = MPI_Wtime();
 		fprintf(fp_mlff, "Initial guess; sigma_v0: %f, sigma_w0: %f\n",sigma_v0,sigma_w0);
 	}
 t2 = MPI_Wtime();
-printf("Saving and other initialization before hyperparamter SCF loop took %.3f s.\n", t2 - t1); 
+#ifdef DEBUG
+	printf("Saving and other initialization before hyperparamter SCF loop took %.3f s.\n", t2 - t1); 
+#endif
 	if (mlff_str->print_mlff_flag == 1 && rank ==0){
 		fprintf(fp_mlff, "Saving and other initialization before hyperparamter done! Time taken: %.3f s\n", t2-t1);
 	}
@@ -585,90 +698,34 @@ t1 = MPI_Wtime();
 
 t3 = MPI_Wtime();
     	double gamma = 0.0;
-    	for (int k = 0; k < mlff_str->n_cols; k++){
+    	for (int k = 0; k < n; k++){
     		S[k] = S_0[k]/(sigma_v0*sigma_v0);
     		if (S_0[k] > 1e-10){
     			gamma += S[k]/(S[k] + 1.0/(sigma_w0*sigma_w0));
     		}
     	}
-t4 = MPI_Wtime();
 #ifdef DEBUG 
-		printf("Gamma calculation took %.3f s.\n", t4 - t3); 
     	printf("Iter number: %d\n",count);
     	printf("Gamma: %f\n",gamma);
-
 #endif
     	if (mlff_str->print_mlff_flag == 1 && rank ==0){
-			fprintf(fp_mlff, "Gamma calculation done! It took %.3f s.\n", t4 - t3);
 			fprintf(fp_mlff, "Iter number: %d\n",count);
 			fprintf(fp_mlff, "Gamma: %f\n",gamma);
 		}
-t3 = MPI_Wtime();
-
-    	for (int i = 0; i < mlff_str->n_cols*mlff_str->n_cols; i++ ){
-    		AtA_h[i] = AtA[i];
-    	}
-
-    	for (int i =0; i <mlff_str->n_cols; i++){
-    		AtA_h[i*mlff_str->n_cols+i] +=  (sigma_v0*sigma_v0)/(sigma_w0*sigma_w0);
-    	}
-
-t4 = MPI_Wtime();
-#ifdef DEBUG 
-	printf("Copying AtA and regularizing took %.3f s.\n", t4 - t3);
-#endif 
-	if (mlff_str->print_mlff_flag == 1 && rank ==0){
-		fprintf(fp_mlff, "Copying AtA and regularizing took %.3f s.\n", t4 - t3);
-	}
-    	// info = LAPACKE_dsysv(LAPACK_COL_MAJOR, 'U', mlff_str->n_cols, 1, AtA_h, mlff_str->n_cols, &ipiv[0], Atb_h, mlff_str->n_cols);
-
-t3 = MPI_Wtime();
-    	LAPACKE_dgelsd(LAPACK_COL_MAJOR, mlff_str->n_cols, mlff_str->n_cols, 1, AtA_h,
-    	 mlff_str->n_cols, Atb_h, mlff_str->n_cols, s_loop, -1.0, &matrank);
-
-t4 = MPI_Wtime();
-#ifdef DEBUG
-	printf("Linear system solving took %.3f s.\n", t4 - t3);
-#endif 
-	if (mlff_str->print_mlff_flag == 1 && rank ==0){
-		fprintf(fp_mlff, "Linear system solving took %.3f s.\n", t4 - t3);
-	}
-t3 = MPI_Wtime();
 
-    	for (int i=0; i <mlff_str->n_cols; i++){
-    		weights[i] = Atb_h[i];
+    	// (AtA + alpha*I) w = Atb in the eigenbasis, components below the solver cutoff are dropped
+    	double alpha = (sigma_v0*sigma_v0)/(sigma_w0*sigma_w0);
+    	double tol = 2.2204460492503131e-16 * (lambda_max + alpha);
+    	double norm_w2 = 0.0, term2 = 0.0, term3 = 0.0;
+    	for (int k = 0; k < n; k++){
+    		double d = lambda[k] + alpha;
+    		y[k] = fabs(d) > tol ? c[k]/d : 0.0;
+    		norm_w2 += y[k] * y[k];
+    		term2 += y[k] * c[k];
+    		term3 += lambda[k] * y[k] * y[k];
     	}
 
-    	 for (int i =0; i <mlff_str->n_cols; i++) {
-    	 	Atb_h[i] = Atb[i];
-    	 }
-
-    	double norm_w2 = dotProduct(weights, weights, mlff_str->n_cols);
-
-t4 = MPI_Wtime();
-#ifdef DEBUG
-	printf("Copying weights and calculating norm_w2 took %.3f s.\n", t4 - t3);
-#endif 
-	if (mlff_str->print_mlff_flag == 1 && rank ==0){
-		fprintf(fp_mlff, "Copying weights and calculating norm_w2 took %.3f s.\n", t4 - t3);
-	}
-t3 = MPI_Wtime();
-
-    	cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, 
-                1, 1, mlff_str->n_cols, 1.0, weights, mlff_str->n_cols,
-                 Atb, mlff_str->n_cols, 0.0, term2, 1);
-
-    	cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, 
-                mlff_str->n_cols, 1, mlff_str->n_cols, 1.0, AtA, 
-                mlff_str->n_cols, weights, mlff_str->n_cols, 0.0, AtAw, mlff_str->n_cols);
-
-    	cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, 
-                1, 1, mlff_str->n_cols, 1.0, weights, mlff_str->n_cols, 
-                AtAw, mlff_str->n_cols, 0.0, term3, 1);
-
-    	double norm_er2 = btb_reduced - 2*term2[0] + term3[0];
-
-    	// printf("term2: %f, term3: %f, btb_reduced: %f\n",term2[0], term3[0],btb_reduced);
+    	double norm_er2 = btb_reduced - 2*term2 + term3;
 
     	sigma_w = sqrt(norm_w2/gamma);
     	sigma_v = sqrt(norm_er2/(M_total_rows - gamma));
@@ -709,6 +766,9 @@ t4 = MPI_Wtime();
 
     }
 
+    // weights from the last solve of the loop
+    cblas_dgemv(CblasColMajor, CblasNoTrans, n, n, 1.0, V, n, y, 1, 0.0, mlff_str->weights, 1);
+
 t2 = MPI_Wtime();
 #ifdef DEBUG
 	printf("Hyperparameter SCF loop took %.3f s.\n", t2 - t1); 
@@ -719,10 +779,6 @@ t2 = MPI_Wtime();
     mlff_str->sigma_w = sigma_w;
     mlff_str->sigma_v = sigma_v;
 
-	for (int i=0; i < mlff_str->n_cols; i++){
-		mlff_str->weights[i] = weights[i];
-	}
-
 	if (error_w< error_tol_w &&  error_v < error_tol_v){
 #ifdef DEBUG
 	    printf("sigma_v and sigma_w converged in %d iteration\n",count);
@@ -735,59 +791,257 @@ t2 = MPI_Wtime();
 	    printf("WARNING: sigma_v and sigma_w did not converge and error was %10.9f, %10.9f\n",error_v, error_w);
 	}
 
-	// if (mlff_str->print_mlff_flag == 1 && rank ==0){
-	// 	fclose(fp_mlff);
-	// }
-
-	free(AtA_h);
-	free(Atb_h);
-	free(weights);
-	free(Ax);
-	free(e);
+	free(V);
+	free(lambda);
 	free(S_0);
 	free(S);
-	free(u);
-	free(vt);
-	free(superb);
-	free(s_loop);
-	free(term2);
-	free(term3);
-	free(AtAw);
+	free(c);
+	free(y);
+}
+
+/*
+Cholesky factorization of the regularized K'K, R'R = K'K + regul*I (upper triangle in R)
+
+Input:
+1. AtA: K'K
+2. regul: regularization (sigma_v/sigma_w)^2
+3. n: size of K'K
+
+Output:
+1. R: Cholesky factor, the strict lower triangle is set to zero
+2. returns the info of dpotrf
+*/
+int factorize_AtA_regularized(double *AtA, double regul, int n, double *R){
+	for (int j = 0; j < n; j++){
+		for (int i = 0; i < n; i++){
+			R[j*n+i] = i <= j ? AtA[j*n+i] : 0.0;
+		}
+		R[j*n+j] += regul;
+	}
+	return LAPACKE_dpotrf(LAPACK_COL_MAJOR, 'U', n, R, n);
+}
+
+/*
+Update the Cholesky factor of K'K + regul*I of the last training for the rows and columns added since
+
+With the row scales and the old columns unchanged, the change of the old n0 x n0 block of K'K only
+comes from the new rows. It is positive semidefinite with the rank of the new rows, and the rows of
+its pivoted Cholesky factor are applied to R11 as rank-1 updates by Givens rotations. The new columns
+are added by bordering, R12 = R11^-T (K'K)_12 and R22'R22 = (K'K)_22 + regul*I - R12'R12.
+
+Input:
+1. AtA_old: K'K of the last training (n0 x n0)
+2. AtA: K'K (n x n), its first n0 columns are the columns of AtA_old
+3. regul: regularization (sigma_v/sigma_w)^2
+4. n0, n: size of AtA_old and AtA
+5. R_old: Cholesky factor of AtA_old + regul*I
+
+Output:
+1. R: Cholesky factor of AtA + regul*I, the strict lower triangle is set to zero
+2. returns 0 on success, 1 if the update is not cheaper than a new factorization, fails or does not reproduce
+   the diagonal of AtA + regul*I
+*/
+int update_AtA_chol(double *AtA_old, double *AtA, double regul, int n0, int n, double *R_old, double *R){
+	int k = n - n0;
+
+	// pivoted Cholesky factor of the change of the old block, P'DP = U'U, up to the rounding of K'K
+	double *D = (double *) malloc(sizeof(double)*n0*n0);
+	int *piv = (int *) malloc(sizeof(int)*n0);
+	double diag_max = 0.0;
+	for (int j = 0; j < n0; j++){
+		for (int i = 0; i < n0; i++){
+			D[j*n0+i] = AtA[j*n+i] - AtA_old[j*n0+i];
+		}
+		diag_max = max(diag_max, AtA[j*n+j]);
+	}
+	int rank_D = 0;
+	int info = LAPACKE_dpstrf(LAPACK_COL_MAJOR, 'U', n0, D, n0, piv, &rank_D, n0*DBL_EPSILON*diag_max);
+	// each rank-1 update costs about 2*n0^2 flops against n^3/3 for the factorization
+	if (info < 0 || 6.0*rank_D*n0*n0 > (double)n*n*n){
+		free(D); free(piv);
+		return 1;
+	}
+
+	for (int i = 0; i < n*n; i++){
+		R[i] = 0.0;
+	}
+	for (int j = 0; j < n0; j++){
+		for (int i = 0; i <= j; i++){
+			R[j*n+i] = R_old[j*n0+i];
+		}
+	}
 
+	// R11'R11 + v*v' for each row v of U*P'
+	double *v = (double *) malloc(sizeof(double)*n0);
+	for (int r = 0; r < rank_D; r++){
+		for (int i = 0; i < n0; i++){
+			v[i] = 0.0;
+		}
+		for (int j = r; j < n0; j++){
+			v[piv[j]-1] = D[j*n0+r];
+		}
+		for (int i = 0; i < n0; i++){
+			if (v[i] == 0.0) continue;
+			double a = R[i*n+i], b = v[i], c, s;
+			cblas_drotg(&a, &b, &c, &s);
+			R[i*n+i] = a;
+			cblas_drot(n0-i-1, R+(i+1)*n+i, n, v+i+1, 1, c, s);
+			if (a < 0.0){
+				R[i*n+i] = -a;
+				cblas_dscal(n0-i-1, -1.0, R+(i+1)*n+i, n);
+			}
+		}
+	}
+	free(v); free(D); free(piv);
+
+	// bordering with the new columns
+	info = 0;
+	if (k > 0){
+		double *R12 = R + n0*n, *R22 = R + n0*n + n0;
+		for (int j = 0; j < k; j++){
+			for (int i = 0; i < n0; i++){
+				R12[j*n+i] = AtA[(n0+j)*n+i];
+			}
+			for (int i = 0; i <= j; i++){
+				R22[j*n+i] = AtA[(n0+j)*n+n0+i];
+			}
+			R22[j*n+j] += regul;
+		}
+		cblas_dtrsm(CblasColMajor, CblasLeft, CblasUpper, CblasTrans, CblasNonUnit, n0, k, 1.0, R, n, R12, n);
+		cblas_dsyrk(CblasColMajor, CblasUpper, CblasTrans, k, n0, -1.0, R12, n, 1.0, R22, n);
+		info = LAPACKE_dpotrf(LAPACK_COL_MAJOR, 'U', k, R22, n);
+	}
+	if (info != 0) return 1;
+
+	// the diagonal of R'R has to be that of K'K + regul*I, otherwise the old block changed by more than the new rows
+	for (int j = 0; j < n; j++){
+		double d = AtA[j*n+j] + regul;
+		if (fabs(cblas_ddot(j+1, R+j*n, 1, R+j*n, 1) - d) > 1e-8*d) return 1;
+	}
+	return 0;
+}
+
+/*
+Check if the hyperparameters drifted away from the maximum of the evidence
+
+One fixed-point update of the hyperparameter loop is done at the current sigma_v and sigma_w
+with the Cholesky factor of K'K + (sigma_v/sigma_w)^2*I instead of the eigendecomposition,
+gamma = n - regul*trace((K'K + regul*I)^-1). The trace is estimated from MLFF_HYPER_NPROBE random
+sign vectors z, trace((R'R)^-1) ~ mean of ||R^-T z||^2, and is exact (unit vectors) for smaller n.
+The factor and the weights at the current hyperparameters are stored in mlff_str.
+
+Input:
+1. btb_reduced: b'b
+2. AtA, Atb: K'K and K'b
+3. M_total_rows: total number of rows
+4. condK_min: Minimum conition number of K'K allowed after regularization
+5. R_valid: 1 if mlff_str->AtA_chol already holds the factor at the current sigma_v and sigma_w
+
+Output:
+1. mlff_str: MLFF structure (AtA_chol, weights)
+2. returns 1 if the update changes sigma_v or sigma_w by more than the relative tolerance
+   MLFF_HYPER_TOL, or if the current regularization is too small for the updated K'K
+*/
+int hyperparameter_drift(double btb_reduced, double *AtA, double *Atb, MLFF_Obj *mlff_str, int M_total_rows, double condK_min, int R_valid){
+	int n = mlff_str->n_cols;
+	double sigma_v = mlff_str->sigma_v, sigma_w = mlff_str->sigma_w;
+	double regul = (sigma_v*sigma_v)/(sigma_w*sigma_w);
+	double *R = mlff_str->AtA_chol, *w = mlff_str->weights;
+
+	// largest eigenvalue of K'K by power iteration, for the minimum regularization
+	double *x = (double *) malloc(n*sizeof(double));
+	double *y = (double *) malloc(n*sizeof(double));
+	double lambda[2] = {0.0, 0.0};
+	for (int i = 0; i < n; i++){
+		x[i] = 1.0/sqrt(n);
+	}
+	for (int it = 0; it < 30; it++){
+		cblas_dsymv(CblasColMajor, CblasUpper, n, 1.0, AtA, n, x, 1, 0.0, y, 1);
+		lambda[1] = cblas_dnrm2(n, y, 1);
+		if (lambda[1] == 0.0) break;
+		for (int i = 0; i < n; i++){
+			x[i] = y[i]/lambda[1];
+		}
+	}
+	free(x); free(y);
+	double regul_min = get_regularization_min(lambda, 2, condK_min);
+	if (regul < regul_min || (!R_valid && factorize_AtA_regularized(AtA, regul, n, R) != 0)){
+		return 1;
+	}
+
+	// weights, (R'R) w = K'b
+	for (int i = 0; i < n; i++){
+		w[i] = Atb[i];
+	}
+	cblas_dtrsv(CblasColMajor, CblasUpper, CblasTrans, CblasNonUnit, n, R, n, w, 1);
+	cblas_dtrsv(CblasColMajor, CblasUpper, CblasNoTrans, CblasNonUnit, n, R, n, w, 1);
+
+	// trace((R'R)^-1) from ||R^-T z||^2 for the probe vectors z
+	int exact = n <= MLFF_HYPER_NPROBE, nprobe = exact ? n : MLFF_HYPER_NPROBE;
+	double *Z = (double *) malloc(n*nprobe*sizeof(double));
+	srand(1);
+	for (int j = 0; j < nprobe; j++){
+		for (int i = 0; i < n; i++){
+			if (exact){
+				Z[j*n+i] = (i == j) ? 1.0 : 0.0;
+			} else {
+				Z[j*n+i] = (rand() < RAND_MAX/2) ? -1.0 : 1.0;
+			}
+		}
+	}
+	cblas_dtrsm(CblasColMajor, CblasLeft, CblasUpper, CblasTrans, CblasNonUnit, n, nprobe, 1.0, R, n, Z, n);
+	double trace_inv = 0.0;
+	for (int i = 0; i < n*nprobe; i++){
+		trace_inv += Z[i]*Z[i];
+	}
+	if (!exact) trace_inv /= nprobe;
+	free(Z);
+
+	double gamma = n - regul*trace_inv;
+	double norm_w2 = cblas_ddot(n, w, 1, w, 1);
+	double norm_er2 = btb_reduced - cblas_ddot(n, w, 1, Atb, 1) - regul*norm_w2;
+	double sigma_w_new = sqrt(norm_w2/gamma);
+	double sigma_v_new = sqrt(norm_er2/(M_total_rows - gamma));
+	if ((sigma_v_new*sigma_v_new)/(sigma_w_new*sigma_w_new) < regul_min){
+		sigma_w_new = sqrt(sigma_v_new*sigma_v_new/regul_min);
+	}
+	// relative changes, sigma_w is often 1e3 or more and the absolute tolerances of the
+	// optimization loop would re-optimize after every new structure
+	double error_v = fabs(sigma_v_new/sigma_v - 1.0), error_w = fabs(sigma_w_new/sigma_w - 1.0);
+#ifdef DEBUG
+	printf("Hyperparameter drift: sigma_v %f -> %f, sigma_w %f -> %f\n", sigma_v, sigma_v_new, sigma_w, sigma_w_new);
+#endif
+	if (mlff_str->print_mlff_flag == 1){
+		fprintf(mlff_str->fp_mlff, "Hyperparameter drift: sigma_v %f -> %f, sigma_w %f -> %f\n", sigma_v, sigma_v_new, sigma_w, sigma_w_new);
+	}
+	return !(error_v <= mlff_str->hyper_tol && error_w <= mlff_str->hyper_tol);
 }
 
 /*
 Finding regularization constant to satisfy the condK_min
 
 Input:
-1. A: The K_train matrix
+1. lambda: eigenvalues of K'K
 2. size: size of K'K matrix
 3. condK_min: Minimum conition number of K'K allowed after regularization
 
 Output:
 1. reg_final: Regularization constant
 */
-double get_regularization_min(double *A, int size, double condK_min){
-	double *a_copy;
-	int ipiv[size], info;
-	double rcond, norm;
+double get_regularization_min(double *lambda, int size, double condK_min){
+	double rcond;
 	double reg_final;
-	a_copy = (double*)malloc(size*size*sizeof(double));
+	double lambda_min = lambda[0], lambda_max = lambda[0];
+	for (int i = 1; i < size; i++){
+		lambda_min = min(lambda_min, lambda[i]);
+		lambda_max = max(lambda_max, lambda[i]);
+	}
 
 	double reg_temp[16] = {1e-16, 1e-15, 1e-14, 1e-13, 1e-12, 1e-11, 1e-10, 1e-9, 1e-8, 1e-7, 1e-6, 1e-5, 1e-4, 1e-3, 1e-2, 1e-1};
 	reg_final = 1e-16;
 	for (int k=0; k < 16; k++){
-		for (int i=0; i < size*size; i++){
-			a_copy[i] =A[i];
-		}
-
-		for (int i=0; i < size; i++){
-			a_copy[i+size*i] += reg_temp[k];
-		}
-
-		norm = LAPACKE_dlange(LAPACK_COL_MAJOR, 'I', size, size, a_copy, size);
-		info = LAPACKE_dgetrf(LAPACK_COL_MAJOR, size, size, a_copy, size, &ipiv[0]);
-		LAPACKE_dgecon(LAPACK_COL_MAJOR, 'I', size, a_copy, size, norm, &rcond);
+		// reciprocal 2-norm condition number of K'K + reg*I
+		rcond = fabs(lambda_min + reg_temp[k])/fabs(lambda_max + reg_temp[k]);
 #ifdef DEBUG
 		printf("Regularization: 1e-%f, Condition number reciprocal: 1e%f\n",log10(reg_temp[k]), log10(rcond) );
 #endif
@@ -796,7 +1050,6 @@ double get_regularization_min(double *A, int size, double condK_min){
 			 break;
 		}
 	}
-	free(a_copy);
 	return reg_final;
 
 }
@@ -817,7 +1070,6 @@ Output:
 void mlff_predict(double *K_predict, MLFF_Obj *mlff_str, double *E,  double* F, double *stress, double* error_bayesian, int natoms ){
 	int rank;
 	int quot;
-	double regul;
 	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 	int rows, cols;
 
@@ -835,25 +1087,6 @@ t1 = MPI_Wtime();
 
 	double *b_predict;
 	b_predict = (double *) malloc(rows *sizeof(double));
-	double *KV = (double *) malloc(rows *cols* sizeof(double));
-	double *DiagMat = (double *) malloc(cols *cols* sizeof(double));
-	double *KV_times_DiagMat = (double *) malloc(rows *cols* sizeof(double));
-	double *KV_times_DiagMat_times_Ut = (double *) malloc(rows *cols* sizeof(double));
-	double *KV_times_DiagMat_times_Ut_times_Kt = (double *) malloc(rows *rows* sizeof(double));
-
-	if((mlff_str->mlff_flag == 1) || (mlff_str->mlff_flag == 22)){
-		for (int i = 0; i < cols *cols; i++){
-			DiagMat[i] = 0.0;
-		}
-
-		regul = (mlff_str->sigma_v*mlff_str->sigma_v)/(mlff_str->sigma_w*mlff_str->sigma_w);
-		double tol_pinv = 1e-15 * mlff_str->n_cols * largest(mlff_str->AtA_SingVal, mlff_str->n_cols);
-		for (int i = 0; i < cols; i++){
-			if (mlff_str->AtA_SingVal[i]> tol_pinv)
-				DiagMat[i*cols +i] = 1.0/(regul + mlff_str->AtA_SingVal[i]);
-		}
-	}
-	
 
 	if (rows > 0){
 	    cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, 
@@ -869,40 +1102,42 @@ t2 = MPI_Wtime();
 t1 = MPI_Wtime();
 
 	if((mlff_str->mlff_flag == 1) || (mlff_str->mlff_flag == 22)){
+		// variance of the prediction, sigma_v^2 * k'(K'K + regul*I)^-1 k = sigma_v^2 * ||R^-T k||^2 for each row k of K_predict
+		double *KRinv = (double *) malloc(rows *cols* sizeof(double));
+		double *var = (double *) calloc(rows, sizeof(double));
 		if (rows > 0){
-			cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, 
-			rows, cols, cols, 1.0, K_predict, rows, mlff_str->AtA_SVD_Vt, cols, 0.0, KV, rows);
-
-			cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, 
-			rows, cols, cols, 1.0, KV, rows, DiagMat, cols, 0.0, KV_times_DiagMat, rows);
-
-			cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, 
-			rows, cols, cols, 1.0, KV_times_DiagMat, rows, mlff_str->AtA_SVD_U, cols, 0.0, KV_times_DiagMat_times_Ut, rows);
-
-			cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, 
-			rows, rows, cols, 1.0, KV_times_DiagMat_times_Ut, rows, K_predict, rows, 0.0, KV_times_DiagMat_times_Ut_times_Kt, rows);
-
-			for (int i = 0; i < rows *rows; i++){
-				KV_times_DiagMat_times_Ut_times_Kt[i] = KV_times_DiagMat_times_Ut_times_Kt[i] * (mlff_str->sigma_v*mlff_str->sigma_v);
+			for (int i = 0; i < rows*cols; i++){
+				KRinv[i] = K_predict[i];
+			}
+			cblas_dtrsm(CblasColMajor, CblasRight, CblasUpper, CblasNoTrans, CblasNonUnit, 
+				rows, cols, 1.0, mlff_str->AtA_chol, cols, KRinv, rows);
+			for (int j = 0; j < cols; j++){
+				for (int i = 0; i < rows; i++){
+					var[i] += KRinv[j*rows+i] * KRinv[j*rows+i];
+				}
+			}
+			for (int i = 0; i < rows; i++){
+				var[i] *= mlff_str->sigma_v*mlff_str->sigma_v;
 			}
 		}
 
 		if (rank==0){
 			for (int i=0; i<rows; i++){
 				if (i==0){
-					error_bayesian[i] = (mlff_str->std_E)*sqrt(mlff_str->sigma_v*mlff_str->sigma_v +KV_times_DiagMat_times_Ut_times_Kt[i*rows+i]);
+					error_bayesian[i] = (mlff_str->std_E)*sqrt(mlff_str->sigma_v*mlff_str->sigma_v + var[i]);
 				} else if (i > 0 && i < 1+mlff_str->stress_len){
-					error_bayesian[i] = (1.0/mlff_str->relative_scale_stress[i-1])*(mlff_str->std_stress[i-1])*sqrt(mlff_str->sigma_v*mlff_str->sigma_v + KV_times_DiagMat_times_Ut_times_Kt[i*rows+i]);
+					error_bayesian[i] = (1.0/mlff_str->relative_scale_stress[i-1])*(mlff_str->std_E/mlff_str->stress_scale[i-1])*sqrt(mlff_str->sigma_v*mlff_str->sigma_v + var[i]);
 				} else{
-					error_bayesian[i] = (1.0/mlff_str->relative_scale_F)*(mlff_str->std_F)*sqrt(mlff_str->sigma_v*mlff_str->sigma_v+KV_times_DiagMat_times_Ut_times_Kt[i*rows+i]);
+					error_bayesian[i] = (1.0/mlff_str->relative_scale_F)*(mlff_str->std_E/mlff_str->F_scale)*sqrt(mlff_str->sigma_v*mlff_str->sigma_v + var[i]);
 				}
 			}
 		} else {
 			for (int i=0; i<rows; i++){
-				error_bayesian[i] = (1.0/mlff_str->relative_scale_F)*(mlff_str->std_F)*sqrt(mlff_str->sigma_v*mlff_str->sigma_v + KV_times_DiagMat_times_Ut_times_Kt[i*rows+i]);
+				error_bayesian[i] = (1.0/mlff_str->relative_scale_F)*(mlff_str->std_E/mlff_str->F_scale)*sqrt(mlff_str->sigma_v*mlff_str->sigma_v + var[i]);
 			}
 		}
-
+		free(KRinv);
+		free(var);
 	}
 
 t2 = MPI_Wtime();
@@ -916,11 +1151,11 @@ t1 = MPI_Wtime();
 	if (rank==0){
 		E[0] = b_predict[0] * mlff_str->std_E + mlff_str->mu_E;
 		for (int istress = 0; istress < mlff_str->stress_len; istress++){
-			stress[istress] = b_predict[1+istress] * mlff_str->std_stress[istress] * (1.0/mlff_str->relative_scale_stress[istress]);
+			stress[istress] = b_predict[1+istress] * (mlff_str->std_E/mlff_str->stress_scale[istress]) * (1.0/mlff_str->relative_scale_stress[istress]);
 		}
 		for (int i=0; i<mlff_str->natom_domain; i++){
 	  		for (int j=0; j<3; j++){
-	    		F[i*3+j] = b_predict[i*3+j+1+mlff_str->stress_len] * mlff_str->std_F * (1.0/mlff_str->relative_scale_F);
+	    		F[i*3+j] = b_predict[i*3+j+1+mlff_str->stress_len] * (mlff_str->std_E/mlff_str->F_scale) * (1.0/mlff_str->relative_scale_F);
 	  		}
 		}
 	} else {
@@ -930,7 +1165,7 @@ t1 = MPI_Wtime();
 		}
 		for (int i=0; i<mlff_str->natom_domain; i++){
 	  		for (int j=0; j<3; j++){
-	    		F[i*3+j] = b_predict[i*3+j] * mlff_str->std_F * (1.0/mlff_str->relative_scale_F);
+	    		F[i*3+j] = b_predict[i*3+j] * (mlff_str->std_E/mlff_str->F_scale) * (1.0/mlff_str->relative_scale_F);
 	  		}
 		}
 	}
@@ -941,10 +1176,5 @@ t2 = MPI_Wtime();
 	}
 #endif
 	free(b_predict);
-	free(KV);
-	free(DiagMat);
-	free(KV_times_DiagMat);
-	free(KV_times_DiagMat_times_Ut);
-	free(KV_times_DiagMat_times_Ut_times_Kt);
 
 }
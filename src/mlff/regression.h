@@ -3,6 +3,13 @@
 
 #include "mlff_types.h"
 
+// Number of random sign vectors for trace((K'K + regul*I)^-1) in the drift check. The
+// estimate only decides whether to re-optimize; its standard deviation is sqrt(2/32) = 0.25
+// times the Frobenius norm of the off-diagonal part of the inverse, and the n^2*32 flops
+// of the triangular solves stay well below the n^3 of the eigendecomposition it avoids.
+// Smaller systems (n <= MLFF_HYPER_NPROBE) use the exact trace.
+#define MLFF_HYPER_NPROBE 32
+
 
 /*
 Sparsification of columns in the training dataset
@@ -30,6 +37,32 @@ void mlff_train_Bayesian(MLFF_Obj *mlff_str);
 
 
 
+/*
+Update K'K and K'b of the force rows for the rows and columns added to K_train since the last call
+
+Input:
+1. mlff_str: MLFF structure
+
+Output:
+1. mlff_str: MLFF structure
+2. returns the number of columns kept from the last call (0: rebuilt from scratch)
+*/
+int update_AtA_force(MLFF_Obj *mlff_str);
+
+
+/*
+Remove a column of K_train from the accumulated K'K and K'b of the force rows
+
+Input:
+1. mlff_str: MLFF structure
+2. col_ID: ID of the local confiugration removed from the training dataset
+
+Output:
+1. mlff_str: MLFF structure
+*/
+void remove_AtA_force_col(MLFF_Obj *mlff_str, int col_ID);
+
+
 /*
 Hyperparameter optimization (noise parameter and the prior on w)
 
@@ -45,18 +78,69 @@ Output:
 void hyperparameter_Bayesian(double btb_reduced, double *AtA, double *Atb, MLFF_Obj *mlff_str, int M, double condK_min);
 
 
+/*
+Cholesky factorization of the regularized K'K, R'R = K'K + regul*I (upper triangle in R)
+
+Input:
+1. AtA: K'K
+2. regul: regularization (sigma_v/sigma_w)^2
+3. n: size of K'K
+
+Output:
+1. R: Cholesky factor
+2. returns the info of dpotrf
+*/
+int factorize_AtA_regularized(double *AtA, double regul, int n, double *R);
+
+
+/*
+Update the Cholesky factor of K'K + regul*I of the last training for the new rows (rank-k update
+of the old block) and the new columns (bordering)
+
+Input:
+1. AtA_old: K'K of the last training (n0 x n0)
+2. AtA: K'K (n x n), its first n0 columns are the columns of AtA_old
+3. regul: regularization (sigma_v/sigma_w)^2
+4. n0, n: size of AtA_old and AtA
+5. R_old: Cholesky factor of AtA_old + regul*I
+
+Output:
+1. R: Cholesky factor of AtA + regul*I
+2. returns 0 on success, 1 if a new factorization is needed
+*/
+int update_AtA_chol(double *AtA_old, double *AtA, double regul, int n0, int n, double *R_old, double *R);
+
+
+/*
+Check if the hyperparameters drifted away from the maximum of the evidence, from one
+fixed-point update of the hyperparameter loop using the Cholesky factor of K'K + regul*I
+
+Input:
+1. btb_reduced: b'b
+2. AtA, Atb: K'K and K'b
+3. M_total_rows: total number of rows
+4. condK_min: Minimum conition number of K'K allowed after regularization
+5. R_valid: 1 if mlff_str->AtA_chol already holds the factor at the current hyperparameters
+
+Output:
+1. mlff_str: MLFF structure (AtA_chol, weights at the current hyperparameters)
+2. returns 1 if the hyperparameters have to be re-optimized
+*/
+int hyperparameter_drift(double btb_reduced, double *AtA, double *Atb, MLFF_Obj *mlff_str, int M_total_rows, double condK_min, int R_valid);
+
+
 /*
 Finding regularization constant to satisfy the condK_min
 
 Input:
-1. A: The K_train matrix
+1. lambda: eigenvalues of K'K
 2. size: size of K'K matrix
 3. condK_min: Minimum conition number of K'K allowed after regularization
 
 Output:
 1. reg_final: Regularization constant
 */
-double get_regularization_min(double *A, int size, double condK_min);
+double get_regularization_min(double *lambda, int size, double condK_min);
 
 
 /*
@@ -187,6 +187,287 @@ int lin_search(int *arr, int n, int x)
     return -1;
 }
 
+/*
+nlist_cartesian_dist function computes the cartesian components of the vector from atom i to atom j (image included)
+for the cell types supported by the neighbor list.
+*/
+static void nlist_cartesian_dist(int cell_typ, double *LatUVec, double twist, double xi, double yi, double zi,
+				double xj, double yj, double zj, double *dx, double *dy, double *dz) {
+	*dx = 0.0; *dy = 0.0; *dz = 0.0;
+	if (cell_typ > 20 && cell_typ < 30) {
+		get_cartesian_dist_cyclix(xi, yi, zi, xj, yj, zj, twist, dx, dy, dz);
+	} else if (cell_typ > 10 && cell_typ < 20){
+		double dx1 = xj - xi;
+		double dx2 = yj - yi;
+		double dx3 = zj - zi;
+		*dx = LatUVec[0] * dx1 + LatUVec[3] * dx2 + LatUVec[6] * dx3;
+		*dy = LatUVec[1] * dx1 + LatUVec[4] * dx2 + LatUVec[7] * dx3;
+		*dz = LatUVec[2] * dx1 + LatUVec[5] * dx2 + LatUVec[8] * dx3;
+	} else if (cell_typ == 0) { // add for nonorthogonal
+		*dx = xj - xi;
+		*dy = yj - yi;
+		*dz = zj - zi;
+	}
+}
+
+/*
+get_img_range_nlist function finds the range of periodic images of the cell to be searched for neighbours of an atom,
+same as the image range used by the all-pairs search.
+*/
+static void get_img_range_nlist(int cell_typ, int *BC, double *cell_len, double rcut, double *geometric_ratio,
+				double xi, double yi, double zi, int *img_n, int *img_p) {
+	double L1 = cell_len[0];
+	double L2 = cell_len[1];
+	double L3 = cell_len[2];
+	double rcut_x = rcut;
+	double rcut_y = rcut * geometric_ratio[0];
+	double rcut_z = rcut * geometric_ratio[1];
+	for (int d = 0; d < 3; d++) {
+		img_n[d] = 0; img_p[d] = 0;
+	}
+	if (BC[0] == 0) {
+		img_p[0] = max(0,ceil((rcut_x - L1 + xi) /L1));
+		img_n[0] = max(0,ceil((rcut_x - xi) /L1));
+	}
+	if (BC[1] == 0) {
+		img_p[1] = max(0,ceil((rcut_y - L2 + yi) /L2));
+		img_n[1] = max(0,ceil((rcut_y - yi) /L2));    
+	}
+	if (BC[2] == 0) {
+		img_p[2] = max(0,ceil((rcut_z - L3 + zi) /L3));
+		img_n[2] = max(0,ceil((rcut_z - zi) /L3));
+	}
+	if (cell_typ > 20 && cell_typ < 30) {
+		get_img_cyclix(L2, temp_tol, &img_n[1], &img_p[1]);
+		// img_ny = 0;
+		// img_py = floor(2*M_PI/L2+temp_tol) - 1; // all atoms and images in cyclic direction
+	}
+}
+
+static int cmp_candidate(const void *a, const void *b) {
+	const int *ca = (const int *) a, *cb = (const int *) b;
+	for (int d = 0; d < 4; d++) {
+		if (ca[d] != cb[d]) return (ca[d] < cb[d]) ? -1 : 1;
+	}
+	return 0;
+}
+
+static int floor_div(int a, int b) {
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+/*
+find_candidates_nlist function finds, for each local atom, all atoms and images within a distance rc using a linked-cell list.
+
+The atoms are binned in the (non-cartesian) coordinates of the cell. A sphere of radius rc spans at most h[d] in the
+coordinate d, where h[d] = rc for orthogonal cells and the cyclix radial and axial directions, and h[d] = rc*|G_d| for
+non-orthogonal cells, G being the inverse of the matrix of lattice unit vectors. The cyclic direction of cyclix systems
+is not binned, all of its images are searched. The candidates (j, img_x, img_y, img_z) of each atom are sorted, i.e.,
+they are in the same order as in an all-pairs search over atoms and images.
+
+[Input]
+1. rc: search radius (bohr)
+2. atompos, cell_typ, BC, cell_len, LatUVec, twist, geometric_ratio, natom_domain, atom_idx_domain: same as build_nlist
+[Output]
+1. candidates: dynamic array for each local atom, 4 entries per candidate
+*/
+static void find_candidates_nlist(const double rc, const int natom, const double * const atompos, int cell_typ, int *BC,
+				double *cell_len, double *LatUVec, double twist, double *geometric_ratio,
+				const int natom_domain, int *atom_idx_domain, dyArray *candidates) {
+	double h[3];
+	int binned[3] = {1, 1, 1};
+	h[0] = h[1] = h[2] = rc;
+	if (cell_typ > 10 && cell_typ < 20) {
+		// A[c][k] = LatUVec[3k+c], rows of inv(A) bound the change of coordinates within a sphere
+		double A[9], G[9];
+		for (int k = 0; k < 3; k++)
+			for (int c = 0; c < 3; c++) A[3*c+k] = LatUVec[3*k+c];
+		double det = A[0]*(A[4]*A[8]-A[5]*A[7]) - A[1]*(A[3]*A[8]-A[5]*A[6]) + A[2]*(A[3]*A[7]-A[4]*A[6]);
+		G[0] = (A[4]*A[8]-A[5]*A[7])/det; G[1] = (A[2]*A[7]-A[1]*A[8])/det; G[2] = (A[1]*A[5]-A[2]*A[4])/det;
+		G[3] = (A[5]*A[6]-A[3]*A[8])/det; G[4] = (A[0]*A[8]-A[2]*A[6])/det; G[5] = (A[2]*A[3]-A[0]*A[5])/det;
+		G[6] = (A[3]*A[7]-A[4]*A[6])/det; G[7] = (A[1]*A[6]-A[0]*A[7])/det; G[8] = (A[0]*A[4]-A[1]*A[3])/det;
+		for (int d = 0; d < 3; d++)
+			h[d] = rc * sqrt(G[3*d]*G[3*d] + G[3*d+1]*G[3*d+1] + G[3*d+2]*G[3*d+2]);
+	} else if (cell_typ > 20 && cell_typ < 30) {
+		binned[1] = 0;
+	} else if (cell_typ != 0) {
+		binned[0] = binned[1] = binned[2] = 0;
+	}
+
+	// set up the bins in each direction, periodic directions are binned over the cell, others over the atoms
+	int nb[3], periodic[3];
+	double w[3], origin[3];
+	for (int d = 0; d < 3; d++) {
+		h[d] = h[d] * (1.0 + 1e-10) + temp_tol; // bins slightly larger than needed, a superset of candidates is harmless
+		periodic[d] = (BC[d] == 0) || (d == 1 && cell_typ > 20 && cell_typ < 30);
+		nb[d] = 1; w[d] = 1.0; origin[d] = 0.0;
+		if (!binned[d]) continue;
+		if (periodic[d]) {
+			nb[d] = max(1, min(256, (int) floor(cell_len[d] / h[d])));
+			w[d] = cell_len[d] / nb[d];
+		} else {
+			double umin = atompos[d], umax = atompos[d];
+			for (int j = 1; j < natom; j++) {
+				umin = min(umin, atompos[3*j+d]);
+				umax = max(umax, atompos[3*j+d]);
+			}
+			nb[d] = max(1, min(256, (int) floor((umax - umin) / h[d])));
+			w[d] = max((umax - umin) / nb[d], temp_tol);
+			origin[d] = umin;
+		}
+	}
+
+	// linked-cell list, atom j is in the base bin bin_j (bin index modulo nb) and shifted by shift_j cells
+	int nbins = nb[0] * nb[1] * nb[2];
+	int *head = (int *) malloc(sizeof(int) * nbins);
+	int *next = (int *) malloc(sizeof(int) * natom);
+	int *shift = (int *) malloc(sizeof(int) * 3 * natom);
+	for (int b = 0; b < nbins; b++) head[b] = -1;
+	for (int j = natom - 1; j >= 0; j--) {
+		int bj[3];
+		for (int d = 0; d < 3; d++) {
+			if (!binned[d]) {
+				bj[d] = 0; shift[3*j+d] = 0;
+			} else if (periodic[d]) {
+				int cj = (int) floor((atompos[3*j+d] - origin[d]) / w[d]);
+				bj[d] = cj - floor_div(cj, nb[d]) * nb[d];
+				shift[3*j+d] = floor_div(cj, nb[d]);
+			} else {
+				bj[d] = min(nb[d]-1, max(0, (int) floor((atompos[3*j+d] - origin[d]) / w[d])));
+				shift[3*j+d] = 0;
+			}
+		}
+		int b = bj[0] + nb[0] * (bj[1] + nb[1] * bj[2]);
+		next[j] = head[b];
+		head[b] = j;
+	}
+
+	double rc2 = rc * rc;
+	for (int i = 0; i < natom_domain; i++) {
+		int atm_idx = atom_idx_domain[i];
+		double xi = atompos[3*atm_idx];
+		double yi = atompos[3*atm_idx+1];
+		double zi = atompos[3*atm_idx+2];
+		// the images are not restricted to the range of build_nlist here since it depends on the position of atom i
+		int img_n[3], img_p[3];
+		get_img_range_nlist(cell_typ, BC, cell_len, rc, geometric_ratio, xi, yi, zi, img_n, img_p);
+
+		// range of (unwrapped) bins to be searched in each direction
+		int blo[3], bhi[3];
+		double ui[3] = {xi, yi, zi};
+		for (int d = 0; d < 3; d++) {
+			if (!binned[d]) {
+				blo[d] = -img_n[d]; bhi[d] = img_p[d]; // loop over images directly
+			} else if (periodic[d]) {
+				blo[d] = (int) floor((ui[d] - h[d] - origin[d]) / w[d]);
+				bhi[d] = (int) floor((ui[d] + h[d] - origin[d]) / w[d]);
+			} else {
+				blo[d] = max(0, (int) floor((ui[d] - h[d] - origin[d]) / w[d]));
+				bhi[d] = min(nb[d]-1, (int) floor((ui[d] + h[d] - origin[d]) / w[d]));
+			}
+		}
+
+		dyArray cand;
+		init_dyarray(&cand);
+		for (int b2 = blo[2]; b2 <= bhi[2]; b2++) {
+			int base2 = binned[2] ? b2 - floor_div(b2, nb[2]) * nb[2] : 0;
+			int m2 = binned[2] ? floor_div(b2, nb[2]) : b2;
+			for (int b1 = blo[1]; b1 <= bhi[1]; b1++) {
+				int base1 = binned[1] ? b1 - floor_div(b1, nb[1]) * nb[1] : 0;
+				int m1 = binned[1] ? floor_div(b1, nb[1]) : b1;
+				for (int b0 = blo[0]; b0 <= bhi[0]; b0++) {
+					int base0 = binned[0] ? b0 - floor_div(b0, nb[0]) * nb[0] : 0;
+					int m0 = binned[0] ? floor_div(b0, nb[0]) : b0;
+					for (int j = head[base0 + nb[0] * (base1 + nb[1] * base2)]; j >= 0; j = next[j]) {
+						int img[3];
+						img[0] = binned[0] ? m0 - shift[3*j] : m0;
+						img[1] = binned[1] ? m1 - shift[3*j+1] : m1;
+						img[2] = binned[2] ? m2 - shift[3*j+2] : m2;
+						if ((j==atm_idx) && (img[0]==0) && (img[1]==0) && (img[2]==0)) continue;
+						double dx, dy, dz;
+						nlist_cartesian_dist(cell_typ, LatUVec, twist, xi, yi, zi, atompos[3*j] + img[0]*cell_len[0],
+							atompos[3*j+1] + img[1]*cell_len[1], atompos[3*j+2] + img[2]*cell_len[2], &dx, &dy, &dz);
+						if (dx*dx + dy*dy + dz*dz >= rc2) continue;
+						append_dyarray(&cand, j);
+						append_dyarray(&cand, img[0]);
+						append_dyarray(&cand, img[1]);
+						append_dyarray(&cand, img[2]);
+					}
+				}
+			}
+		}
+		qsort(cand.array, cand.len / 4, 4 * sizeof(int), cmp_candidate);
+		candidates[i] = cand;
+	}
+
+	free(head);
+	free(next);
+	free(shift);
+}
+
+/*
+init_nlist_cache function initializes the Verlet list reused by build_nlist across MD steps.
+
+[Input]
+1. skin: Verlet skin (bohr), the list is not reused if skin <= 0
+[Output]
+1. cache: pointer to NeighListCache structure
+*/
+void init_nlist_cache(NeighListCache *cache, double skin) {
+	cache->skin = skin;
+	cache->valid = 0;
+	cache->natom = 0;
+	cache->natom_domain = 0;
+	cache->atompos_ref = NULL;
+	cache->atom_idx_domain = NULL;
+	cache->candidates = NULL;
+}
+
+/*
+free_nlist_cache function frees the memory dynamically allocated for NeighListCache.
+*/
+void free_nlist_cache(NeighListCache *cache) {
+	if (cache->candidates != NULL) {
+		for (int i = 0; i < cache->natom_domain; i++)
+			delete_dyarray(cache->candidates + i);
+		free(cache->candidates);
+	}
+	free(cache->atompos_ref);
+	free(cache->atom_idx_domain);
+	cache->atompos_ref = NULL;
+	cache->atom_idx_domain = NULL;
+	cache->candidates = NULL;
+	cache->valid = 0;
+}
+
+/*
+if_reuse_nlist_cache function checks if the candidates in the cache contain all neighbours of the current structure,
+i.e., same system and no atom has moved more than half of the skin since the candidates were built.
+*/
+static int if_reuse_nlist_cache(NeighListCache *cache, const double rcut, const int natom, const double * const atompos,
+				int cell_typ, int *BC, double *cell_len, double *LatUVec, double twist, const int natom_domain, int *atom_idx_domain) {
+	if (!cache->valid || cache->natom != natom || cache->natom_domain != natom_domain || cache->cell_typ != cell_typ
+		|| cache->rcut != rcut || cache->twist != twist) return 0;
+	for (int d = 0; d < 3; d++) {
+		if (cache->BC[d] != BC[d] || cache->cell_len[d] != cell_len[d]) return 0;
+	}
+	for (int d = 0; d < 9; d++) {
+		if (cache->LatUVec[d] != LatUVec[d]) return 0;
+	}
+	for (int i = 0; i < natom_domain; i++) {
+		if (cache->atom_idx_domain[i] != atom_idx_domain[i]) return 0;
+	}
+	// atoms wrapped back into the cell show a jump of a cell length and trigger a rebuild
+	double lim2 = 0.25 * cache->skin * cache->skin;
+	for (int j = 0; j < natom; j++) {
+		double dx, dy, dz;
+		nlist_cartesian_dist(cell_typ, LatUVec, twist, cache->atompos_ref[3*j], cache->atompos_ref[3*j+1], cache->atompos_ref[3*j+2],
+			atompos[3*j], atompos[3*j+1], atompos[3*j+2], &dx, &dy, &dz);
+		if (dx*dx + dy*dy + dz*dz >= lim2) return 0;
+	}
+	return 1;
+}
+
 /*
 build_nlist function calculate the list of neighbours for each atoms in the structure.
 
@@ -198,6 +479,7 @@ build_nlist function calculate the list of neighbours for each atoms in the stru
 5. atomtyp: Pointer to the array containing the element type of the atoms in the fundamental cell (stored RowMajor format)
 6. BC[]: Boundary condition (0 for Dirchelet, 1 for Periodic) [Not used currently, add later]
 7. cell: 3*1 array to store the length of fundamental cell. [Currently only orthogonal cells are implemented]
+8. cache: Verlet list kept across MD steps, NULL if the structure is not part of a trajectory
 
 [Output]
 1. nlist: pointer to Neighlist structure
@@ -205,7 +487,8 @@ build_nlist function calculate the list of neighbours for each atoms in the stru
 
 //TODO: Replace geometric ratio!
 void build_nlist(const double rcut, const int nelem, const int natom, const double * const atompos,
-				 int * atomtyp, int cell_typ, int *BC, double *cell_len, double *LatUVec, double twist, double *geometric_ratio, NeighList* nlist, const int natom_domain, int *atom_idx_domain, int *el_idx_domain) {
+				 int * atomtyp, int cell_typ, int *BC, double *cell_len, double *LatUVec, double twist, double *geometric_ratio, NeighList* nlist, const int natom_domain, int *atom_idx_domain, int *el_idx_domain,
+				 NeighListCache *cache) {
 	int rank, nprocs;
 	MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
 	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -213,15 +496,46 @@ void build_nlist(const double rcut, const int nelem, const int natom, const doub
 	double L1 = cell_len[0];
 	double L2 = cell_len[1];
 	double L3 = cell_len[2];
-	double rcut_x = rcut;
-	double rcut_y = rcut * geometric_ratio[0];
-	double rcut_z = rcut * geometric_ratio[1];
 	initialize_nlist(nlist, cell_typ, BC, cell_len, LatUVec, twist, natom, rcut, nelem, natom_domain, atom_idx_domain, el_idx_domain);	
 
     	
 	for (int i=0; i<natom; i++){
 		nlist->natom_elem[atomtyp[i]] = nlist->natom_elem[atomtyp[i]] +1;
 	}
+
+	// candidate neighbours from the linked-cell list, reused across MD steps when a Verlet skin is given
+	dyArray *candidates;
+	int use_cache = (cache != NULL && cache->skin > 0);
+	if (use_cache) {
+		if (!if_reuse_nlist_cache(cache, rcut, natom, atompos, cell_typ, BC, cell_len, LatUVec, twist, natom_domain, atom_idx_domain)) {
+			double skin = cache->skin;
+			free_nlist_cache(cache);
+			init_nlist_cache(cache, skin);
+			cache->natom = natom;
+			cache->natom_domain = natom_domain;
+			cache->cell_typ = cell_typ;
+			cache->rcut = rcut;
+			cache->twist = twist;
+			for (int d = 0; d < 3; d++) {
+				cache->BC[d] = BC[d];
+				cache->cell_len[d] = cell_len[d];
+			}
+			for (int d = 0; d < 9; d++) cache->LatUVec[d] = LatUVec[d];
+			cache->atompos_ref = (double *) malloc(sizeof(double) * 3 * natom);
+			cache->atom_idx_domain = (int *) malloc(sizeof(int) * natom_domain);
+			cache->candidates = (dyArray *) malloc(sizeof(dyArray) * natom_domain);
+			for (int j = 0; j < 3*natom; j++) cache->atompos_ref[j] = atompos[j];
+			for (int i = 0; i < natom_domain; i++) cache->atom_idx_domain[i] = atom_idx_domain[i];
+			find_candidates_nlist(rcut + skin, natom, atompos, cell_typ, BC, cell_len, LatUVec, twist, geometric_ratio,
+				natom_domain, atom_idx_domain, cache->candidates);
+			cache->valid = 1;
+		}
+		candidates = cache->candidates;
+	} else {
+		candidates = (dyArray *) malloc(sizeof(dyArray) * natom_domain);
+		find_candidates_nlist(rcut, natom, atompos, cell_typ, BC, cell_len, LatUVec, twist, geometric_ratio,
+			natom_domain, atom_idx_domain, candidates);
+	}
 	
 	for (int i = 0; i < natom_domain; i++){
 		int atm_idx = atom_idx_domain[i];
@@ -230,117 +544,76 @@ void build_nlist(const double rcut, const int nelem, const int natom, const doub
 		double yi = atompos[3*atm_idx+1];
 		double zi = atompos[3*atm_idx+2];
 
-		int img_px = 0;
-		int img_nx = 0;
-		int img_py = 0;
-		int img_ny = 0;
-		int img_pz = 0;
-		int img_nz = 0;
-
-
-		if (BC[0] == 0) {
-			img_px = max(0,ceil((rcut_x - L1 + xi) /L1));
-			img_nx = max(0,ceil((rcut_x - xi) /L1));
-        }
-        if (BC[1] == 0) {
-			img_py = max(0,ceil((rcut_y - L2 + yi) /L2));
-			img_ny = max(0,ceil((rcut_y - yi) /L2));    
-        }
-        if (BC[2] == 0) {
-			img_pz = max(0,ceil((rcut_z - L3 + zi) /L3));
-			img_nz = max(0,ceil((rcut_z - zi) /L3));
-		}
-
-		if (cell_typ > 20 && cell_typ < 30) {
-			get_img_cyclix(L2, temp_tol, &img_ny, &img_py);
-			// img_ny = 0;
-			// img_py = floor(2*M_PI/L2+temp_tol) - 1; // all atoms and images in cyclic direction
-		}
-		
-		// count_neighs = 0;
-		for (int j = 0; j < natom; j++){
-			int count_unique=0;
-			double xj_u = atompos[3*j];
-			double yj_u = atompos[3*j+1];
-			double zj_u = atompos[3*j+2];
-			// if (j==atm_idx) continue;
-			for (int img_x = -img_nx; img_x <= img_px; img_x++){
-				double xj = xj_u + img_x*L1;	
-				//if (fabs( xj - xi) >= rcut_x) continue;
-				for (int img_y = -img_ny; img_y <= img_py; img_y++){
-					double yj = yj_u + img_y*L2;
-					//if ((cell_typ > 20 && cell_typ < 30) ? (fabs( yj - yi + twist*(zj-zi)) >= rcut_y && (2*M_PI - fabs( yj - yi + twist*(zj-zi))) >= rcut_y) : fabs( yj - yi) >= rcut_y) continue;
-					for (int img_z = -img_nz; img_z <= img_pz; img_z++){
-						double zj = zj_u + img_z*L3;
-						//if (fabs(zj - zi) >= rcut_z) continue;
-						if ((j==atm_idx) && (img_x==0) && (img_y==0) && (img_z==0)) continue;
-
-						double dx = 0.0;
-						double dy = 0.0;
-						double dz = 0.0;
-						double dr = 0.0;
-						
-						if (cell_typ > 20 && cell_typ < 30) {
-							// dx = xj*cos(yj+twist*zj) - xi*cos(yi+twist*zi);
-							// dy = xj*sin(yj+twist*zj) - xi*sin(yi+twist*zi);
-							// dz = zj - zi;
-							get_cartesian_dist_cyclix(xi, yi, zi, xj, yj, zj, twist, &dx, &dy, &dz);
-						} else if (cell_typ > 10 && cell_typ < 20){
-							double dx1 = xj - xi;
-							double dx2 = yj - yi;
-							double dx3 = zj - zi;
-					        dx = LatUVec[0] * dx1 + LatUVec[3] * dx2 + LatUVec[6] * dx3;
-					        dy = LatUVec[1] * dx1 + LatUVec[4] * dx2 + LatUVec[7] * dx3;
-					        dz = LatUVec[2] * dx1 + LatUVec[5] * dx2 + LatUVec[8] * dx3;
-						} else if (cell_typ == 0) { // add for nonorthogonal
-							dx = xj - xi;
-							dy = yj - yi;
-							dz = zj - zi;
-						} 
-						
-						dr = sqrt(dx*dx + dy*dy + dz*dz);
-						if (dr >= rcut || dr ==0) continue;
-
-						if (j == atm_idx){
-							nlist->if_self_image[i] = 1;
-						}
-
-						nlist->Nneighbors[i] += 1;
-						nlist->Nneighbors_elemWise[i][atomtyp[j]] += 1;
+		// image range of the current positions, candidates of a reused list may lie outside
+		int img_n[3], img_p[3];
+		get_img_range_nlist(cell_typ, BC, cell_len, rcut, geometric_ratio, xi, yi, zi, img_n, img_p);
+
+		int count_unique=0;
+		int j_prev = -1;
+		int ncand = candidates[i].len / 4;
+		for (int c = 0; c < ncand; c++){
+			int j = candidates[i].array[4*c];
+			int img_x = candidates[i].array[4*c+1];
+			int img_y = candidates[i].array[4*c+2];
+			int img_z = candidates[i].array[4*c+3];
+			if (img_x < -img_n[0] || img_x > img_p[0] || img_y < -img_n[1] || img_y > img_p[1]
+				|| img_z < -img_n[2] || img_z > img_p[2]) continue;
+			if (j != j_prev) {
+				count_unique = 0;
+				j_prev = j;
+			}
+			double xj = atompos[3*j] + img_x*L1;
+			double yj = atompos[3*j+1] + img_y*L2;
+			double zj = atompos[3*j+2] + img_z*L3;
 
-						if (count_unique==0) {
-							if (j !=atm_idx){
-								nlist->unique_Nneighbors[i] += 1;
-								nlist->unique_Nneighbors_elemWise[i][atomtyp[j]] += 1;
-								append_dyarray(nlist->unique_neighborList + i, j);
-								append_dyarray(&(nlist->unique_neighborList_elemWise[i][atomtyp[j]]), j);
-							}
-						}
+			double dx = 0.0;
+			double dy = 0.0;
+			double dz = 0.0;
+			double dr = 0.0;
+			nlist_cartesian_dist(cell_typ, LatUVec, twist, xi, yi, zi, xj, yj, zj, &dx, &dy, &dz);
+			
+			dr = sqrt(dx*dx + dy*dy + dz*dz);
+			if (dr >= rcut || dr ==0) continue;
 
-	
+			if (j == atm_idx){
+				nlist->if_self_image[i] = 1;
+			}
 
-						append_dyarray(&(nlist->neighborList_elemWise_imgX[i][atomtyp[j]]), img_x);
-						append_dyarray(&(nlist->neighborList_elemWise_imgY[i][atomtyp[j]]), img_y);
-						append_dyarray(&(nlist->neighborList_elemWise_imgZ[i][atomtyp[j]]), img_z);
+			nlist->Nneighbors[i] += 1;
+			nlist->Nneighbors_elemWise[i][atomtyp[j]] += 1;
 
-						append_dyarray(nlist->neighborList + i, j);
-						append_dyarray(&(nlist->neighborList_elemWise[i][atomtyp[j]]), j);
+			if (count_unique==0) {
+				if (j !=atm_idx){
+					nlist->unique_Nneighbors[i] += 1;
+					nlist->unique_Nneighbors_elemWise[i][atomtyp[j]] += 1;
+					append_dyarray(nlist->unique_neighborList + i, j);
+					append_dyarray(&(nlist->unique_neighborList_elemWise[i][atomtyp[j]]), j);
+				}
+			}
 
+			append_dyarray(&(nlist->neighborList_elemWise_imgX[i][atomtyp[j]]), img_x);
+			append_dyarray(&(nlist->neighborList_elemWise_imgY[i][atomtyp[j]]), img_y);
+			append_dyarray(&(nlist->neighborList_elemWise_imgZ[i][atomtyp[j]]), img_z);
 
+			append_dyarray(nlist->neighborList + i, j);
+			append_dyarray(&(nlist->neighborList_elemWise[i][atomtyp[j]]), j);
 
-						append_dyarray(nlist->neighborList_imgX + i, img_x);
-						append_dyarray(nlist->neighborList_imgY + i, img_y);
-						append_dyarray(nlist->neighborList_imgZ + i, img_z);
+			append_dyarray(nlist->neighborList_imgX + i, img_x);
+			append_dyarray(nlist->neighborList_imgY + i, img_y);
+			append_dyarray(nlist->neighborList_imgZ + i, img_z);
 
-						append_dyarray(nlist->neighborAtmTyp+i, atomtyp[j]);
+			append_dyarray(nlist->neighborAtmTyp+i, atomtyp[j]);
 
-						count_unique++;
-					}
-				}
-			} 	
+			count_unique++;
 		}
 	}
 
+	if (!use_cache) {
+		for (int i = 0; i < natom_domain; i++)
+			delete_dyarray(candidates + i);
+		free(candidates);
+	}
+
 	
 
 
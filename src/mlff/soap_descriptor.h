@@ -47,12 +47,29 @@ build_nlist function calculate the list of neighbours for each atoms in the stru
 5. atomtyp: Pointer to the array containing the element type of the atoms in the fundamental cell (stored RowMajor format)
 6. BC[]: Boundary condition (0 for Dirchelet, 1 for Periodic) [Not used currently, add later]
 7. cell: 3*1 array to store the length of fundamental cell. [Currently only orthogonal cells are implemented]
+8. cache: Verlet list kept across MD steps, NULL if the structure is not part of a trajectory
 
 [Output]
 1. nlist: pointer to Neighlist structure
 */
 void build_nlist(const double rcut, const int nelem, const int natom, const double * const atompos,
-				 int * atomtyp, int cell_typ, int *BC, double *cell_len, double *LatUVec, double twist, double *geometric_ratio, NeighList* nlist, const int natom_domain, int *atom_idx_domain, int *el_idx_domain);
+				 int * atomtyp, int cell_typ, int *BC, double *cell_len, double *LatUVec, double twist, double *geometric_ratio, NeighList* nlist, const int natom_domain, int *atom_idx_domain, int *el_idx_domain,
+				 NeighListCache *cache);
+
+/*
+init_nlist_cache function initializes the Verlet list reused by build_nlist across MD steps.
+
+[Input]
+1. skin: Verlet skin (bohr), the list is not reused if skin <= 0
+[Output]
+1. cache: pointer to NeighListCache structure
+*/
+void init_nlist_cache(NeighListCache *cache, double skin);
+
+/*
+free_nlist_cache function frees the memory dynamically allocated for NeighListCache.
+*/
+void free_nlist_cache(NeighListCache *cache);
 
 
 /*
@@ -93,6 +93,7 @@ void init_MLFF(SPARC_OBJ *pSPARC) {
 	mlff_str->Lmax = pSPARC->L_max_SOAP;
 	mlff_str->rcut = pSPARC->rcut_SOAP;
 	mlff_str->sigma_atom = pSPARC->sigma_atom_SOAP;
+	init_nlist_cache(&mlff_str->nlist_cache, pSPARC->nlist_skin_MLFF);
 
 
 	if (pSPARC->descriptor_typ_MLFF < 2) {
@@ -275,10 +276,16 @@ void init_MLFF(SPARC_OBJ *pSPARC) {
 
 	// initialized the arrays to be used in regression
 	mlff_str->cov_train = (double *) malloc(1*sizeof(double));
-	mlff_str->AtA_SVD_U = (double *) malloc(1*sizeof(double));
-	mlff_str->AtA_SVD_Vt = (double *) malloc(1*sizeof(double));
-	mlff_str->AtA_SingVal = (double *) malloc(1*sizeof(double));
+	mlff_str->AtA_chol = (double *) malloc(1*sizeof(double));
+	mlff_str->AtA_chol_ncols = 0;
+	mlff_str->n_str_hyper = -1;
+	mlff_str->hyper_nstr = pSPARC->hyper_nstr_MLFF;
+	mlff_str->hyper_tol = pSPARC->hyper_tol_MLFF;
 	mlff_str->AtA = (double *) malloc(1*sizeof(double));
+	mlff_str->AtA_F = NULL;
+	mlff_str->Atb_F = NULL;
+	mlff_str->AtA_F_nrows = 0;
+	mlff_str->AtA_F_ncols = 0;
 	mlff_str->natm_train_elemwise = (int *) malloc(nelem * sizeof(int));
 	for (int i=0; i<nelem; i++){
 		mlff_str->natm_train_elemwise[i] = 0;
@@ -352,6 +359,7 @@ void free_MLFF(MLFF_Obj *mlff_str){
 
 	int natom = mlff_str->natom, K_size_row = mlff_str->n_str_max*(3*mlff_str->natom_domain + 1 + mlff_str->stress_len), nelem = mlff_str->nelem;
 
+	free_nlist_cache(&mlff_str->nlist_cache);
 	free(mlff_str->Znucl);
 	free(mlff_str->atom_idx_domain);
 	free(mlff_str->el_idx_domain);
@@ -363,10 +371,10 @@ void free_MLFF(MLFF_Obj *mlff_str){
 
 	free(mlff_str->stress_store);
 	free(mlff_str->cov_train);
-	free(mlff_str->AtA_SVD_U);
-	free(mlff_str->AtA_SVD_Vt);
-	free(mlff_str->AtA_SingVal);
+	free(mlff_str->AtA_chol);
 	free(mlff_str->AtA);
+	free(mlff_str->AtA_F);
+	free(mlff_str->Atb_F);
 	free(mlff_str->natm_train_elemwise);
 	free(mlff_str->natm_typ_train);
 	for (int i = 0; i < (mlff_str->n_str_max * (3*mlff_str->natom_domain + 1+mlff_str->stress_len)); i++){
@@ -730,6 +738,8 @@ void pretrain_MLFF_model(
 	MPI_Bcast(natom_data, n_str, MPI_INT, 0, MPI_COMM_WORLD);
 	
 	mlff_str->n_rows = 0;
+	mlff_str->AtA_F_nrows = 0;
+	mlff_str->AtA_F_ncols = 0;
 	for (int i = 0; i < n_str; i++){
 		apos = (double *) malloc(sizeof(double)*3*natom_data[i]);
 		F = (double *) malloc(sizeof(double)*3*natom_data[i]);
@@ -794,7 +804,7 @@ void pretrain_MLFF_model(
 		geometric_ratio[1] = pSPARC->CUTOFF_z[0]/pSPARC->CUTOFF_x[0];
 
 t1 = MPI_Wtime();
-		build_nlist(mlff_str->rcut, pSPARC->Ntypes, natom_data[i], apos, atomtyp, pSPARC->cell_typ, BC, cell, LatUVec, pSPARC->twist, geometric_ratio, nlist, natom_domain, atom_idx_domain, el_idx_domain);
+		build_nlist(mlff_str->rcut, pSPARC->Ntypes, natom_data[i], apos, atomtyp, pSPARC->cell_typ, BC, cell, LatUVec, pSPARC->twist, geometric_ratio, nlist, natom_domain, atom_idx_domain, el_idx_domain, NULL);
 t2 = MPI_Wtime();
 		if (pSPARC->print_mlff_flag == 1 && rank ==0){
 			fprintf(fp_mlff, "Neighbor list done. Time taken: %.3f s\n", t2-t1);
@@ -1364,7 +1374,7 @@ t3 = MPI_Wtime();
 
 t1 = MPI_Wtime();
 	NeighList *nlist = (NeighList *) malloc(sizeof(NeighList)*1);
-	build_nlist(mlff_str->rcut, pSPARC->Ntypes, pSPARC->n_atom, pSPARC->atom_pos, atomtyp, pSPARC->cell_typ, BC, cell, pSPARC->LatUVec, pSPARC->twist, geometric_ratio, nlist, mlff_str->natom_domain, mlff_str->atom_idx_domain, mlff_str->el_idx_domain);
+	build_nlist(mlff_str->rcut, pSPARC->Ntypes, pSPARC->n_atom, pSPARC->atom_pos, atomtyp, pSPARC->cell_typ, BC, cell, pSPARC->LatUVec, pSPARC->twist, geometric_ratio, nlist, mlff_str->natom_domain, mlff_str->atom_idx_domain, mlff_str->el_idx_domain, &mlff_str->nlist_cache);
 	DescriptorObj *desc_str = (DescriptorObj *) malloc(sizeof(DescriptorObj)*1);
 	build_descriptor(desc_str, nlist, mlff_str, pSPARC->atom_pos);
 
@@ -1497,7 +1507,7 @@ t3 = MPI_Wtime();
 
 t1 = MPI_Wtime();
 
-	build_nlist(mlff_str->rcut, pSPARC->Ntypes, pSPARC->n_atom, pSPARC->atom_pos, atomtyp, pSPARC->cell_typ, BC, cell, pSPARC->LatUVec, pSPARC->twist, geometric_ratio, nlist, mlff_str->natom_domain, mlff_str->atom_idx_domain, mlff_str->el_idx_domain);
+	build_nlist(mlff_str->rcut, pSPARC->Ntypes, pSPARC->n_atom, pSPARC->atom_pos, atomtyp, pSPARC->cell_typ, BC, cell, pSPARC->LatUVec, pSPARC->twist, geometric_ratio, nlist, mlff_str->natom_domain, mlff_str->atom_idx_domain, mlff_str->el_idx_domain, &mlff_str->nlist_cache);
 
 	build_descriptor(desc_str, nlist, mlff_str, pSPARC->atom_pos);
 
@@ -1735,7 +1745,7 @@ t3 = MPI_Wtime();
 	}
 
 t1 = MPI_Wtime();
-	build_nlist(mlff_str->rcut, pSPARC->Ntypes, pSPARC->n_atom, pSPARC->atom_pos, atomtyp, pSPARC->cell_typ, BC, cell, pSPARC->LatUVec, pSPARC->twist, geometric_ratio, nlist, mlff_str->natom_domain, mlff_str->atom_idx_domain, mlff_str->el_idx_domain);
+	build_nlist(mlff_str->rcut, pSPARC->Ntypes, pSPARC->n_atom, pSPARC->atom_pos, atomtyp, pSPARC->cell_typ, BC, cell, pSPARC->LatUVec, pSPARC->twist, geometric_ratio, nlist, mlff_str->natom_domain, mlff_str->atom_idx_domain, mlff_str->el_idx_domain, &mlff_str->nlist_cache);
 	build_descriptor(desc_str, nlist, mlff_str, pSPARC->atom_pos);
 t2 = MPI_Wtime();
 
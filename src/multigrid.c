@@ -0,0 +1,611 @@
+/**
+ * @file    multigrid.c
+ * @brief   This file contains the geometric multigrid preconditioner for the
+ *          Poisson equation in the phi-domain.
+ *
+ *          The finest level uses the high-order Laplacian (Lap_vec_mult) on the
+ *          phi-domain decomposition. Coarser levels use a 4th-order re-discretization
+ *          (including the mixed derivatives for non-orthogonal cells) on grids that
+ *          are distributed over the same Cartesian process grid. Grid transfer is
+ *          done by tensor-product linear interpolation and its transpose, which
+ *          works for any number of grid points and for periodic, Dirichlet and
+ *          mixed boundary conditions. Chebyshev polynomials are used as smoother
+ *          and as coarsest level solver.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <mpi.h>
+
+#include "multigrid.h"
+#include "lapVecRoutines.h"
+#include "isddft.h"
+
+#define min(x,y) ((x)<(y)?(x):(y))
+#define max(x,y) ((x)>(y)?(x):(y))
+
+#define MG_MAX_LEVEL 12     // maximum number of levels
+#define MG_MIN_N 4          // minimum global number of grid points in a direction to be coarsened
+#define MG_MIN_NLOC 2       // minimum local number of coarse grid points in each direction
+#define MG_HALO 2           // halo width needed by the restriction and the coarse stencil
+#define MG_RWIDTH 4         // maximum number of fine points restricted to a coarse point per direction
+#define MG_SMOOTH_DEG 2     // degree of the Chebyshev smoother
+#define MG_SMOOTH_LO 0.1    // lower end of the smoothing interval relative to eig_max
+#define MG_SMOOTH_HI 1.1    // upper end of the smoothing interval relative to eig_max
+#define MG_COARSE_MAXDEG 40 // maximum degree of the Chebyshev coarsest level solver
+#define MG_EIG_ITER 15      // number of power iterations for estimating eig_max on the finest level
+
+
+/**
+ * @brief   Floor and ceiling of integer division for positive denominator.
+ */
+static int floor_div(int a, int b) {
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+static int ceil_div(int a, int b) {
+    return -floor_div(-a, b);
+}
+
+
+
+/**
+ * @brief   Exchange halo of width w for a vector distributed on level lv.
+ *
+ *          The result is stored in lv->ex, with x running fastest. The exchange
+ *          is done direction by direction including the halo of the previous
+ *          directions, so that edges and corners are filled too. Points outside
+ *          a Dirichlet boundary are set to zero.
+ */
+static void mg_halo_exchange(MG_LEVEL_OBJ *lv, int w, const double *x, MPI_Comm comm)
+{
+    int ext[3], st[3], d, j, k;
+    for (d = 0; d < 3; d++) ext[d] = lv->n[d] + 2 * w;
+    st[0] = 1; st[1] = ext[0]; st[2] = ext[0] * ext[1];
+    double *ex = lv->ex;
+
+    memset(ex, 0, sizeof(double) * ext[0] * ext[1] * ext[2]);
+    for (k = 0; k < lv->n[2]; k++) {
+        for (j = 0; j < lv->n[1]; j++) {
+            memcpy(ex + w + (j + w) * st[1] + (k + w) * st[2],
+                   x + j * lv->n[0] + k * lv->n[0] * lv->n[1], sizeof(double) * lv->n[0]);
+        }
+    }
+
+    for (d = 0; d < 3; d++) {
+        int d1 = (d + 1) % 3, d2 = (d + 2) % 3;
+        int cnt = w * ext[d1] * ext[d2];
+        int lower, upper, dir, c0, c1, c2, count;
+        MPI_Cart_shift(comm, d, 1, &lower, &upper);
+        for (dir = 0; dir < 2; dir++) {
+            // dir = 0: send top layers to upper, receive into lower halo
+            // dir = 1: send bottom layers to lower, receive into upper halo
+            int send_start = dir ? w : lv->n[d];
+            int recv_start = dir ? lv->n[d] + w : 0;
+            int dest = dir ? lower : upper;
+            int src  = dir ? upper : lower;
+            count = 0;
+            for (c2 = 0; c2 < ext[d2]; c2++)
+                for (c1 = 0; c1 < ext[d1]; c1++)
+                    for (c0 = send_start; c0 < send_start + w; c0++)
+                        lv->sendbuf[count++] = ex[c0 * st[d] + c1 * st[d1] + c2 * st[d2]];
+            MPI_Sendrecv(lv->sendbuf, cnt, MPI_DOUBLE, dest, 111 + dir,
+                         lv->recvbuf, cnt, MPI_DOUBLE, src, 111 + dir, comm, MPI_STATUS_IGNORE);
+            if (src == MPI_PROC_NULL) continue;
+            count = 0;
+            for (c2 = 0; c2 < ext[d2]; c2++)
+                for (c1 = 0; c1 < ext[d1]; c1++)
+                    for (c0 = recv_start; c0 < recv_start + w; c0++)
+                        ex[c0 * st[d] + c1 * st[d1] + c2 * st[d2]] = lv->recvbuf[count++];
+        }
+    }
+}
+
+
+
+/**
+ * @brief   4th-order central approximation of h_1 * h_2 * d^2 f / (dx_1 dx_2), where s1 and
+ *          s2 are the strides of the two directions.
+ */
+static inline double mixed_deriv(const double *f, int s1, int s2, double a1, double a2)
+{
+    double d1 = f[s1+s2] - f[s1-s2] - f[-s1+s2] + f[-s1-s2];
+    double d2 = f[2*s1+2*s2] - f[2*s1-2*s2] - f[-2*s1+2*s2] + f[-2*s1-2*s2];
+    double d12 = f[s1+2*s2] - f[s1-2*s2] - f[-s1+2*s2] + f[-s1-2*s2]
+               + f[2*s1+s2] - f[2*s1-s2] - f[-2*s1+s2] + f[-2*s1-s2];
+    return a1 * a1 * d1 + a2 * a2 * d2 + a1 * a2 * d12;
+}
+
+
+
+/**
+ * @brief   Apply the operator -(Lap + c) on level l, y = A * x.
+ *
+ *          The finest level uses the high-order Laplacian of the phi-domain, the
+ *          coarse levels use the 4th-order stencil (with mixed derivatives for non-orthogonal cells).
+ */
+static void mg_apply_op(SPARC_OBJ *pSPARC, int l, double c, double *x, double *y, MPI_Comm comm)
+{
+    MG_LEVEL_OBJ *lv = pSPARC->MG_levels + l;
+    int i, j, k;
+
+    if (l == 0) {
+        Lap_vec_mult(pSPARC, lv->nd, pSPARC->DMVertices, 1, c, x, lv->nd, y, lv->nd, comm);
+        for (i = 0; i < lv->nd; i++) y[i] = -y[i];
+        return;
+    }
+
+    mg_halo_exchange(lv, MG_HALO, x, comm);
+    int nx = lv->n[0], ny = lv->n[1], nz = lv->n[2];
+    int sy = nx + 2 * MG_HALO, sz = sy * (ny + 2 * MG_HALO);
+    double cxx = lv->coef[0], cyy = lv->coef[1], czz = lv->coef[2];
+    double cxy = lv->coef[3], cxz = lv->coef[4], cyz = lv->coef[5];
+    // 4th-order weights of the second and first derivatives
+    const double w1 = 4.0 / 3.0, w2 = -1.0 / 12.0, a1 = 2.0 / 3.0, a2 = -1.0 / 12.0;
+    double c0 = 2.5 * (cxx + cyy + czz);
+    int nonorth = (cxy != 0.0 || cxz != 0.0 || cyz != 0.0);
+    const double *ex = lv->ex;
+
+    #pragma omp parallel for private(i, j) schedule(static)
+    for (k = 0; k < nz; k++) {
+        for (j = 0; j < ny; j++) {
+            const double *e = ex + MG_HALO + (j + MG_HALO) * sy + (k + MG_HALO) * sz;
+            double *yy = y + j * nx + k * nx * ny;
+            for (i = 0; i < nx; i++) {
+                const double *ei = e + i;
+                double val = c0 * ei[0]
+                           - cxx * (w1 * (ei[1] + ei[-1]) + w2 * (ei[2] + ei[-2]))
+                           - cyy * (w1 * (ei[sy] + ei[-sy]) + w2 * (ei[2*sy] + ei[-2*sy]))
+                           - czz * (w1 * (ei[sz] + ei[-sz]) + w2 * (ei[2*sz] + ei[-2*sz]));
+                if (nonorth) {
+                    val -= cxy * mixed_deriv(ei, 1, sy, a1, a2)
+                         + cxz * mixed_deriv(ei, 1, sz, a1, a2)
+                         + cyz * mixed_deriv(ei, sy, sz, a1, a2);
+                }
+                yy[i] = val - c * ei[0];
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Chebyshev iteration for A x = b on level l, targeting the eigenvalues in [lo, hi].
+ *
+ *          If zero_guess is nonzero, the initial guess is x = 0.
+ */
+static void mg_chebyshev(SPARC_OBJ *pSPARC, int l, double c, double lo, double hi,
+                         int deg, int zero_guess, MPI_Comm comm)
+{
+    MG_LEVEL_OBJ *lv = pSPARC->MG_levels + l;
+    int i, k, nd = lv->nd;
+    double *x = lv->x, *b = lv->b, *r = lv->r, *d = lv->d, *w = lv->w;
+    double theta = 0.5 * (hi + lo), delta = 0.5 * (hi - lo);
+    double sigma = theta / delta, rho = 1.0 / sigma, rho_new;
+
+    if (zero_guess) {
+        for (i = 0; i < nd; i++) { x[i] = 0.0; r[i] = b[i]; }
+    } else {
+        mg_apply_op(pSPARC, l, c, x, w, comm);
+        for (i = 0; i < nd; i++) r[i] = b[i] - w[i];
+    }
+    for (i = 0; i < nd; i++) d[i] = r[i] / theta;
+
+    for (k = 1; k <= deg; k++) {
+        for (i = 0; i < nd; i++) x[i] += d[i];
+        if (k == deg) break;
+        mg_apply_op(pSPARC, l, c, d, w, comm);
+        rho_new = 1.0 / (2.0 * sigma - rho);
+        for (i = 0; i < nd; i++) {
+            r[i] -= w[i];
+            d[i] = rho_new * rho * d[i] + 2.0 * rho_new / delta * r[i];
+        }
+        rho = rho_new;
+    }
+}
+
+
+
+/**
+ * @brief   Restrict the residual of level l-1 (fine) to the right hand side of level l.
+ */
+static void mg_restrict(SPARC_OBJ *pSPARC, int l, MPI_Comm comm)
+{
+    MG_LEVEL_OBJ *lf = pSPARC->MG_levels + l - 1;
+    MG_LEVEL_OBJ *lc = pSPARC->MG_levels + l;
+    int ic, jc, kc, a, b, c;
+
+    mg_halo_exchange(lf, MG_HALO, lf->r, comm);
+    int sy = lf->n[0] + 2 * MG_HALO, sz = sy * (lf->n[1] + 2 * MG_HALO);
+    const double *ex = lf->ex;
+
+    #pragma omp parallel for private(ic, jc, a, b, c) schedule(static)
+    for (kc = 0; kc < lc->n[2]; kc++) {
+        for (jc = 0; jc < lc->n[1]; jc++) {
+            for (ic = 0; ic < lc->n[0]; ic++) {
+                double sum = 0.0;
+                for (c = 0; c < MG_RWIDTH; c++) {
+                    double wz = lc->R_wt[2][kc * MG_RWIDTH + c];
+                    if (wz == 0.0) continue;
+                    int kk = lc->R_idx[2][kc] + c + MG_HALO;
+                    for (b = 0; b < MG_RWIDTH; b++) {
+                        double wyz = wz * lc->R_wt[1][jc * MG_RWIDTH + b];
+                        if (wyz == 0.0) continue;
+                        int jj = lc->R_idx[1][jc] + b + MG_HALO;
+                        const double *e = ex + jj * sy + kk * sz + lc->R_idx[0][ic] + MG_HALO;
+                        for (a = 0; a < MG_RWIDTH; a++)
+                            sum += wyz * lc->R_wt[0][ic * MG_RWIDTH + a] * e[a];
+                    }
+                }
+                lc->b[ic + jc * lc->n[0] + kc * lc->n[0] * lc->n[1]] = sum;
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Interpolate the solution of level l and add it to the solution of level l-1.
+ */
+static void mg_prolong(SPARC_OBJ *pSPARC, int l, MPI_Comm comm)
+{
+    MG_LEVEL_OBJ *lf = pSPARC->MG_levels + l - 1;
+    MG_LEVEL_OBJ *lc = pSPARC->MG_levels + l;
+    int i, j, k;
+
+    mg_halo_exchange(lc, 1, lc->x, comm);
+    int sy = lc->n[0] + 2, sz = sy * (lc->n[1] + 2);
+    const double *ex = lc->ex;
+
+    #pragma omp parallel for private(i, j) schedule(static)
+    for (k = 0; k < lf->n[2]; k++) {
+        double wz0 = lc->P_wt[2][k], wz1 = 1.0 - wz0;
+        int kk = lc->P_idx[2][k] + 1;
+        for (j = 0; j < lf->n[1]; j++) {
+            double wy0 = lc->P_wt[1][j], wy1 = 1.0 - wy0;
+            const double *e = ex + (lc->P_idx[1][j] + 1) * sy + kk * sz + 1;
+            double *xf = lf->x + j * lf->n[0] + k * lf->n[0] * lf->n[1];
+            for (i = 0; i < lf->n[0]; i++) {
+                const double *ei = e + lc->P_idx[0][i];
+                double wx0 = lc->P_wt[0][i], wx1 = 1.0 - wx0;
+                xf[i] += wz0 * (wy0 * (wx0 * ei[0]       + wx1 * ei[1])
+                              + wy1 * (wx0 * ei[sy]      + wx1 * ei[sy+1]))
+                       + wz1 * (wy0 * (wx0 * ei[sz]      + wx1 * ei[sz+1])
+                              + wy1 * (wx0 * ei[sy+sz]   + wx1 * ei[sy+sz+1]));
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Multigrid V-cycle for A x = b starting from level l with zero initial guess.
+ */
+static void mg_vcycle(SPARC_OBJ *pSPARC, int l, double c, MPI_Comm comm)
+{
+    MG_LEVEL_OBJ *lv = pSPARC->MG_levels + l;
+    int i;
+
+    // eigenvalues of -Lap are shifted by -c
+    double hi = MG_SMOOTH_HI * lv->eig_max - c;
+    double lo = MG_SMOOTH_LO * lv->eig_max - c;
+
+    if (l == pSPARC->MG_nlevels - 1) {
+        double eig_min = lv->eig_min - c;
+        // with periodic BC in all directions the constant vector has eigenvalue -c
+        if (!lv->off[0] && !lv->off[1] && !lv->off[2] && c < 0.0) eig_min = -c;
+        int deg = (int) ceil(1.5 * sqrt(hi / eig_min));
+        deg = max(MG_SMOOTH_DEG, min(MG_COARSE_MAXDEG, deg));
+        mg_chebyshev(pSPARC, l, c, eig_min, hi, deg, 1, comm);
+        return;
+    }
+
+    // pre-smoothing
+    mg_chebyshev(pSPARC, l, c, lo, hi, MG_SMOOTH_DEG, 1, comm);
+    // residual
+    mg_apply_op(pSPARC, l, c, lv->x, lv->w, comm);
+    for (i = 0; i < lv->nd; i++) lv->r[i] = lv->b[i] - lv->w[i];
+    // coarse grid correction
+    mg_restrict(pSPARC, l + 1, comm);
+    mg_vcycle(pSPARC, l + 1, c, comm);
+    mg_prolong(pSPARC, l + 1, comm);
+    // post-smoothing
+    mg_chebyshev(pSPARC, l, c, lo, hi, MG_SMOOTH_DEG, 0, comm);
+}
+
+
+
+/**
+ * @brief   Allocate the vectors of a level.
+ */
+static void mg_alloc_level(MG_LEVEL_OBJ *lv)
+{
+    int d, nex = 1, nface = 0;
+    for (d = 0; d < 3; d++) nex *= lv->n[d] + 2 * MG_HALO;
+    for (d = 0; d < 3; d++) nface = max(nface, nex / (lv->n[d] + 2 * MG_HALO));
+    lv->nd = lv->n[0] * lv->n[1] * lv->n[2];
+    lv->x = (double *)malloc(lv->nd * sizeof(double));
+    lv->b = (double *)malloc(lv->nd * sizeof(double));
+    lv->r = (double *)malloc(lv->nd * sizeof(double));
+    lv->d = (double *)malloc(lv->nd * sizeof(double));
+    lv->w = (double *)malloc(lv->nd * sizeof(double));
+    lv->ex = (double *)malloc(nex * sizeof(double));
+    lv->sendbuf = (double *)malloc(MG_HALO * nface * sizeof(double));
+    lv->recvbuf = (double *)malloc(MG_HALO * nface * sizeof(double));
+    assert(lv->x != NULL && lv->b != NULL && lv->r != NULL && lv->d != NULL && lv->w != NULL
+        && lv->ex != NULL && lv->sendbuf != NULL && lv->recvbuf != NULL);
+    for (d = 0; d < 3; d++) {
+        lv->P_idx[d] = NULL; lv->P_wt[d] = NULL;
+        lv->R_idx[d] = NULL; lv->R_wt[d] = NULL;
+    }
+}
+
+
+
+/**
+ * @brief   Set up the transfer operators between level lf (fine) and lc (coarse) in direction d.
+ *
+ *          Fine point i and coarse point I are located at (i+off)*hf and (I+off)*hc,
+ *          where (N+off)*h is the same on both levels. Prolongation is linear
+ *          interpolation, restriction is its transpose scaled by hf/hc.
+ */
+static void mg_setup_transfer(MG_LEVEL_OBJ *lf, MG_LEVEL_OBJ *lc, int d)
+{
+    int off = lf->off[d];
+    int Nfo = lf->N[d] + off, Nco = lc->N[d] + off;
+    int i, ic, c;
+
+    lc->P_idx[d] = (int *)malloc(lf->n[d] * sizeof(int));
+    lc->P_wt[d] = (double *)malloc(lf->n[d] * sizeof(double));
+    lc->R_idx[d] = (int *)malloc(lc->n[d] * sizeof(int));
+    lc->R_wt[d] = (double *)malloc(lc->n[d] * MG_RWIDTH * sizeof(double));
+    assert(lc->P_idx[d] != NULL && lc->P_wt[d] != NULL && lc->R_idx[d] != NULL && lc->R_wt[d] != NULL);
+
+    for (i = 0; i < lf->n[d]; i++) {
+        // coarse coordinate of fine point i is (i+off)*Nco/Nfo
+        long num = (long)(lf->s[d] + i + off) * Nco;
+        int ig = (int)(num / Nfo) - off;
+        lc->P_idx[d][i] = ig - lc->s[d];
+        lc->P_wt[d][i] = 1.0 - (double)(num % Nfo) / Nfo;
+        assert(lc->P_idx[d][i] >= -1 && lc->P_idx[d][i] < lc->n[d]);
+    }
+
+    for (ic = 0; ic < lc->n[d]; ic++) {
+        // fine coordinate of coarse point ic is A/Nco, fine points within Nfo/Nco of it contribute
+        int A = (lc->s[d] + ic + off) * Nfo;
+        int m_lo = floor_div(A - Nfo, Nco) + 1;
+        lc->R_idx[d][ic] = m_lo - off - lf->s[d];
+        for (c = 0; c < MG_RWIDTH; c++) {
+            int dist = abs((m_lo + c) * Nco - A);
+            double wt = (dist < Nfo) ? (double)(Nfo - dist) * Nco / ((double)Nfo * Nfo) : 0.0;
+            lc->R_wt[d][ic * MG_RWIDTH + c] = wt;
+            if (wt != 0.0)
+                assert(lc->R_idx[d][ic] + c >= -MG_HALO && lc->R_idx[d][ic] + c < lf->n[d] + MG_HALO);
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Set the stencil coefficients and eigenvalue estimates of a coarse level.
+ */
+static void mg_set_coarse_coefs(SPARC_OBJ *pSPARC, MG_LEVEL_OBJ *lv)
+{
+    double T[9] = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+    int d;
+    if (pSPARC->cell_typ != 0) memcpy(T, pSPARC->lapcT, 9 * sizeof(double));
+    double *h = lv->h;
+    lv->coef[0] = T[0] / (h[0] * h[0]);
+    lv->coef[1] = T[4] / (h[1] * h[1]);
+    lv->coef[2] = T[8] / (h[2] * h[2]);
+    lv->coef[3] = 2.0 * T[1] / (h[0] * h[1]);
+    lv->coef[4] = 2.0 * T[2] / (h[0] * h[2]);
+    lv->coef[5] = 2.0 * T[5] / (h[1] * h[2]);
+    // Gershgorin bound of the 4th-order stencil
+    lv->eig_max = 16.0 / 3.0 * (lv->coef[0] + lv->coef[1] + lv->coef[2])
+                + 2.25 * (fabs(lv->coef[3]) + fabs(lv->coef[4]) + fabs(lv->coef[5]));
+    lv->eig_max /= MG_SMOOTH_HI;
+    // smallest (nonzero) eigenvalue, using the 2nd-order Laplacian as estimate
+    double eig_dir = 0.0, eig_per = 0.0;
+    int has_dir = 0;
+    for (d = 0; d < 3; d++) {
+        if (lv->off[d]) {
+            has_dir = 1;
+            eig_dir += 4.0 * lv->coef[d] * pow(sin(M_PI / (2.0 * (lv->N[d] + 1))), 2);
+        } else {
+            double e = 4.0 * lv->coef[d] * pow(sin(M_PI / lv->N[d]), 2);
+            eig_per = (eig_per == 0.0) ? e : min(eig_per, e);
+        }
+    }
+    lv->eig_min = has_dir ? eig_dir : eig_per;
+}
+
+
+
+/**
+ * @brief   Estimate the maximum eigenvalue of the finest level operator by power iteration.
+ */
+static void mg_estimate_eig_max(SPARC_OBJ *pSPARC, MPI_Comm comm)
+{
+    MG_LEVEL_OBJ *lv = pSPARC->MG_levels;
+    int i, j, k, it, count = 0;
+    double norm, lambda = 0.0;
+    for (k = 0; k < lv->n[2]; k++) {
+        for (j = 0; j < lv->n[1]; j++) {
+            for (i = 0; i < lv->n[0]; i++) {
+                unsigned int g = (unsigned int)(((k + lv->s[2]) * lv->N[1] + j + lv->s[1]) * lv->N[0] + i + lv->s[0]);
+                g = g * 1103515245u + 12345u;
+                lv->x[count++] = (double)((g >> 16) & 0x7fff) / 32768.0 - 0.5;
+            }
+        }
+    }
+    for (it = 0; it < MG_EIG_ITER; it++) {
+        norm = 0.0;
+        for (i = 0; i < lv->nd; i++) norm += lv->x[i] * lv->x[i];
+        MPI_Allreduce(MPI_IN_PLACE, &norm, 1, MPI_DOUBLE, MPI_SUM, comm);
+        norm = sqrt(norm);
+        for (i = 0; i < lv->nd; i++) lv->x[i] /= norm;
+        mg_apply_op(pSPARC, 0, 0.0, lv->x, lv->w, comm);
+        lambda = 0.0;
+        for (i = 0; i < lv->nd; i++) lambda += lv->x[i] * lv->w[i];
+        MPI_Allreduce(MPI_IN_PLACE, &lambda, 1, MPI_DOUBLE, MPI_SUM, comm);
+        memcpy(lv->x, lv->w, lv->nd * sizeof(double));
+    }
+    lv->eig_max = lambda;
+}
+
+
+
+/**
+ * @brief   Set up the multigrid hierarchy on the phi-domain.
+ */
+void Setup_multigrid(SPARC_OBJ *pSPARC, MPI_Comm comm)
+{
+    int d, BC[3] = {pSPARC->BCx, pSPARC->BCy, pSPARC->BCz};
+    MG_LEVEL_OBJ levels[MG_MAX_LEVEL], *lf, *lc;
+
+#ifdef DEBUG
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    double t1 = MPI_Wtime();
+#endif
+
+    lf = levels;
+    lf->N[0] = pSPARC->Nx; lf->N[1] = pSPARC->Ny; lf->N[2] = pSPARC->Nz;
+    lf->h[0] = pSPARC->delta_x; lf->h[1] = pSPARC->delta_y; lf->h[2] = pSPARC->delta_z;
+    for (d = 0; d < 3; d++) {
+        lf->s[d] = pSPARC->DMVertices[2*d];
+        lf->n[d] = pSPARC->DMVertices[2*d+1] - pSPARC->DMVertices[2*d] + 1;
+        lf->off[d] = BC[d];
+    }
+    mg_alloc_level(lf);
+    for (d = 0; d < 6; d++) lf->coef[d] = 0.0;
+
+    // the restriction from the finest level needs at least MG_HALO local points
+    int nmin[3];
+    for (d = 0; d < 3; d++) nmin[d] = lf->n[d];
+    MPI_Allreduce(MPI_IN_PLACE, nmin, 3, MPI_INT, MPI_MIN, comm);
+    int can_coarsen = (nmin[0] >= MG_HALO && nmin[1] >= MG_HALO && nmin[2] >= MG_HALO);
+
+    int nlevels = 1;
+    while (can_coarsen && nlevels < MG_MAX_LEVEL) {
+        lf = levels + nlevels - 1;
+        lc = levels + nlevels;
+        double hmin = min(lf->h[0], min(lf->h[1], lf->h[2]));
+        int coarsen[3], any = 0;
+        for (d = 0; d < 3; d++) {
+            // semi-coarsening: only coarsen directions that are not much coarser than the finest one
+            coarsen[d] = (lf->N[d] >= MG_MIN_N && lf->h[d] < 1.5 * hmin);
+            int off = lf->off[d];
+            // coarse spacing is at most twice the fine spacing
+            lc->N[d] = coarsen[d] ? (off ? lf->N[d] / 2 : (lf->N[d] + 1) / 2) : lf->N[d];
+            lc->off[d] = off;
+            lc->s[d] = ceil_div((lf->s[d] + off) * (lc->N[d] + off), lf->N[d] + off) - off;
+            lc->n[d] = ceil_div((lf->s[d] + lf->n[d] + off) * (lc->N[d] + off), lf->N[d] + off) - off - lc->s[d];
+            nmin[d] = lc->n[d];
+        }
+        MPI_Allreduce(MPI_IN_PLACE, nmin, 3, MPI_INT, MPI_MIN, comm);
+        for (d = 0; d < 3; d++) {
+            if (coarsen[d] && nmin[d] < MG_MIN_NLOC) {
+                coarsen[d] = 0;
+                lc->N[d] = lf->N[d];
+                lc->s[d] = lf->s[d];
+                lc->n[d] = lf->n[d];
+            }
+            any += coarsen[d];
+            lc->h[d] = lf->h[d] * (lf->N[d] + lf->off[d]) / (double)(lc->N[d] + lc->off[d]);
+        }
+        if (!any) break;
+        mg_alloc_level(lc);
+        for (d = 0; d < 3; d++) mg_setup_transfer(lf, lc, d);
+        mg_set_coarse_coefs(pSPARC, lc);
+        nlevels++;
+    }
+
+    pSPARC->MG_nlevels = nlevels;
+    pSPARC->MG_levels = (MG_LEVEL_OBJ *)malloc(nlevels * sizeof(MG_LEVEL_OBJ));
+    assert(pSPARC->MG_levels != NULL);
+    memcpy(pSPARC->MG_levels, levels, nlevels * sizeof(MG_LEVEL_OBJ));
+
+    // eigenvalue estimates on the finest level
+    mg_estimate_eig_max(pSPARC, comm);
+    if (nlevels == 1) {
+        // no coarse level, the Chebyshev solver on the finest level needs eig_min
+        MG_LEVEL_OBJ tmp = pSPARC->MG_levels[0];
+        mg_set_coarse_coefs(pSPARC, &tmp);
+        pSPARC->MG_levels[0].eig_min = tmp.eig_min;
+    }
+
+#ifdef DEBUG
+    if (rank == 0) {
+        printf("Multigrid setup took %.3f ms, %d levels:\n", (MPI_Wtime() - t1) * 1e3, nlevels);
+        for (int l = 0; l < nlevels; l++)
+            printf("  level %d: %d x %d x %d, eig_max = %.3e\n", l, pSPARC->MG_levels[l].N[0],
+                pSPARC->MG_levels[l].N[1], pSPARC->MG_levels[l].N[2], pSPARC->MG_levels[l].eig_max);
+    }
+#endif
+}
+
+
+
+/**
+ * @brief   Free the multigrid hierarchy.
+ */
+void Free_multigrid(SPARC_OBJ *pSPARC)
+{
+    int l, d;
+    for (l = 0; l < pSPARC->MG_nlevels; l++) {
+        MG_LEVEL_OBJ *lv = pSPARC->MG_levels + l;
+        free(lv->x);
+        free(lv->b);
+        free(lv->r);
+        free(lv->d);
+        free(lv->w);
+        free(lv->ex);
+        free(lv->sendbuf);
+        free(lv->recvbuf);
+        for (d = 0; d < 3; d++) {
+            free(lv->P_idx[d]);
+            free(lv->P_wt[d]);
+            free(lv->R_idx[d]);
+            free(lv->R_wt[d]);
+        }
+    }
+    free(pSPARC->MG_levels);
+    pSPARC->MG_levels = NULL;
+    pSPARC->MG_nlevels = 0;
+}
+
+
+
+/**
+ * @brief   Multigrid preconditioner for the Poisson equation, f = inv(M) * r,
+ *          where M approximates -(Lap + c * I).
+ *
+ *          One V-cycle is applied. The hierarchy is set up at the first call
+ *          and again whenever the mesh size changes (e.g., NPT MD or cell relaxation).
+ */
+void Multigrid_preconditioner(SPARC_OBJ *pSPARC, int N, double c, double *r, double *f, MPI_Comm comm)
+{
+    if (pSPARC->MG_nlevels > 0) {
+        MG_LEVEL_OBJ *lv = pSPARC->MG_levels;
+        if (lv->h[0] != pSPARC->delta_x || lv->h[1] != pSPARC->delta_y || lv->h[2] != pSPARC->delta_z)
+            Free_multigrid(pSPARC);
+    }
+    if (pSPARC->MG_nlevels == 0) Setup_multigrid(pSPARC, comm);
+
+    MG_LEVEL_OBJ *lv = pSPARC->MG_levels;
+    assert(lv->nd == N);
+    memcpy(lv->b, r, N * sizeof(double));
+    mg_vcycle(pSPARC, 0, c, comm);
+    memcpy(f, lv->x, N * sizeof(double));
+}
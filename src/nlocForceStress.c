@@ -0,0 +1,625 @@
+/**
+ * @file    nlocForceStress.c
+ * @brief   This file contains the functions for calculating the nonlocal forces
+ *          together with the nonlocal and kinetic stress.
+ *
+ *          When both forces and stress are required, the orbital gradients
+ *          are only computed once. The orbitals are processed in band tiles,
+ *          so the gradients never take more memory than the work array Yorb.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#include <complex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include <assert.h>
+/* BLAS routines */
+#ifdef USE_MKL
+    #include <mkl.h>
+#else
+    #include <cblas.h>
+#endif
+
+#include "nlocForceStress.h"
+#include "forces.h"
+#include "stress.h"
+#include "gradVecRoutines.h"
+#include "gradVecRoutinesKpt.h"
+#include "tools.h"
+#include "isddft.h"
+
+#define max(a,b) ((a)>(b)?(a):(b))
+#define min(a,b) ((a)<(b)?(a):(b))
+
+
+/**
+ * @brief   Sum the nonlocal and kinetic stress over all processes and store
+ *          them in pSPARC->stress_nl and pSPARC->stress_k.
+ */
+static void finalize_nonlocal_kinetic_stress(SPARC_OBJ *pSPARC, double *stress_nl, double *stress_k, double energy_nl)
+{
+    int i, rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    for(i = 0; i < 6; i++)
+        stress_nl[i] *= pSPARC->occfac * 2.0;
+
+    energy_nl *= pSPARC->occfac/pSPARC->dV;
+
+    pSPARC->stress_nl[0] = stress_nl[0] - energy_nl;
+    pSPARC->stress_nl[1] = stress_nl[1];
+    pSPARC->stress_nl[2] = stress_nl[2];
+    pSPARC->stress_nl[3] = stress_nl[3] - energy_nl;
+    pSPARC->stress_nl[4] = stress_nl[4];
+    pSPARC->stress_nl[5] = stress_nl[5] - energy_nl;
+    for(i = 0; i < 6; i++)
+        pSPARC->stress_k[i] = stress_k[i];
+
+    // sum over all spin
+    if (pSPARC->npspin > 1) {
+        MPI_Allreduce(MPI_IN_PLACE, pSPARC->stress_nl, 6, MPI_DOUBLE, MPI_SUM, pSPARC->spin_bridge_comm);
+        MPI_Allreduce(MPI_IN_PLACE, pSPARC->stress_k, 6, MPI_DOUBLE, MPI_SUM, pSPARC->spin_bridge_comm);
+    }
+
+    // sum over all kpoints
+    if (pSPARC->npkpt > 1) {
+        MPI_Allreduce(MPI_IN_PLACE, pSPARC->stress_nl, 6, MPI_DOUBLE, MPI_SUM, pSPARC->kpt_bridge_comm);
+        MPI_Allreduce(MPI_IN_PLACE, pSPARC->stress_k, 6, MPI_DOUBLE, MPI_SUM, pSPARC->kpt_bridge_comm);
+    }
+
+    // sum over all bands
+    if (pSPARC->npband > 1) {
+        MPI_Allreduce(MPI_IN_PLACE, pSPARC->stress_nl, 6, MPI_DOUBLE, MPI_SUM, pSPARC->blacscomm);
+        MPI_Allreduce(MPI_IN_PLACE, pSPARC->stress_k, 6, MPI_DOUBLE, MPI_SUM, pSPARC->blacscomm);
+    }
+
+    if (!rank) {
+        // Define measure of unit cell
+        double cell_measure = pSPARC->Jacbdet;
+        if(pSPARC->BCx == 0)
+            cell_measure *= pSPARC->range_x;
+        if(pSPARC->BCy == 0)
+            cell_measure *= pSPARC->range_y;
+        if(pSPARC->BCz == 0)
+            cell_measure *= pSPARC->range_z;
+
+        for(i = 0; i < 6; i++) {
+            pSPARC->stress_nl[i] /= cell_measure;
+            pSPARC->stress_k[i] /= cell_measure;
+        }
+    }
+
+#ifdef DEBUG
+    if (!rank){
+        printf("\nNon-local contribution to stress");
+        PrintStress(pSPARC, pSPARC->stress_nl, NULL);
+        printf("\nKinetic contribution to stress");
+        PrintStress(pSPARC, pSPARC->stress_k, NULL);
+    }
+#endif
+}
+
+
+/**
+ * @brief   Sum the nonlocal forces over all processes and add them to pSPARC->forces.
+ */
+static void finalize_nonlocal_forces(SPARC_OBJ *pSPARC, double *force_nloc)
+{
+    int i, rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // sum over all spin
+    if (pSPARC->npspin > 1) {
+        MPI_Allreduce(MPI_IN_PLACE, force_nloc, 3 * pSPARC->n_atom, MPI_DOUBLE, MPI_SUM, pSPARC->spin_bridge_comm);
+    }
+
+    // sum over all kpoints
+    if (pSPARC->npkpt > 1) {
+        MPI_Allreduce(MPI_IN_PLACE, force_nloc, 3 * pSPARC->n_atom, MPI_DOUBLE, MPI_SUM, pSPARC->kpt_bridge_comm);
+    }
+
+    // sum over all bands
+    if (pSPARC->npband > 1) {
+        MPI_Allreduce(MPI_IN_PLACE, force_nloc, 3 * pSPARC->n_atom, MPI_DOUBLE, MPI_SUM, pSPARC->blacscomm);
+    }
+
+#ifdef DEBUG
+    if (!rank) {
+        printf("force_nloc = \n");
+        for (i = 0; i < pSPARC->n_atom; i++) {
+            printf("%18.14f %18.14f %18.14f\n", force_nloc[i*3], force_nloc[i*3+1], force_nloc[i*3+2]);
+        }
+    }
+#endif
+
+    if (!rank) {
+        for (i = 0; i < 3 * pSPARC->n_atom; i++) {
+            pSPARC->forces[i] += force_nloc[i];
+        }
+    }
+}
+
+
+/**
+ * @brief   Number of bands in one tile of the fused force/stress pass.
+ */
+int nloc_force_stress_tile_size(int ncol)
+{
+    return max(ncol / 3, 1);
+}
+
+
+/**
+ * @brief   Calculate nonlocal forces and nonlocal + kinetic stress in one pass
+ *          over the orbitals - gamma point.
+ */
+void Calculate_nonlocal_forces_stress_linear(SPARC_OBJ *pSPARC)
+{
+    pSPARC->nlocStressReady = 1;
+    if (pSPARC->spincomm_index < 0 || pSPARC->kptcomm_index < 0 || pSPARC->bandcomm_index < 0 || pSPARC->dmcomm == MPI_COMM_NULL) return;
+
+#ifdef DEBUG
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (!rank) printf("Start calculating nonlocal forces and stress contributions from kinetic and nonlocal psp.\n");
+#endif
+
+    int i, n0, nt, nb, ncol, DMnd, DMndsp, Nspinor, spinor;
+    int dim, dim2, count, nIP, ld;
+    ncol = pSPARC->Nband_bandcomm; // number of bands assigned
+    DMnd = pSPARC->Nd_d_dmcomm;
+    Nspinor = pSPARC->Nspinor_spincomm;
+    DMndsp = DMnd * Nspinor;
+    nIP = pSPARC->IP_displ[pSPARC->n_atom] * ncol * Nspinor; // size of one block of integrals
+
+    double *force_nloc, *alpha_f, *alpha_s, *dpsi_tile, *dpsi_x1, *dpsi_x2, *dpsi_x3;
+    double energy_nl, stress_k[6], stress_nl[6];
+    for (i = 0; i < 6; i++) stress_nl[i] = stress_k[i] = 0;
+
+    force_nloc = (double *)calloc(3 * pSPARC->n_atom, sizeof(double));
+    // integrals for forces: <Chi, psi>, <Chi, dpsi_x>, <Chi, dpsi_y>, <Chi, dpsi_z>
+    alpha_f = (double *)calloc(nIP * 4, sizeof(double));
+    // integrals for stress: <Chi, psi>, <Chi, dpsi_i.(x-R_J)_j> for j >= i
+    alpha_s = (double *)calloc(nIP * 7, sizeof(double));
+    assert(force_nloc != NULL && alpha_f != NULL && alpha_s != NULL);
+
+    // gradients of one band tile in all three directions, stored in Yorb if it fits
+    nb = nloc_force_stress_tile_size(ncol);
+    ld = nb * DMndsp;
+    dpsi_tile = (3 * nb <= ncol) ? pSPARC->Yorb : (double *)malloc(3 * ld * sizeof(double));
+    assert(dpsi_tile != NULL);
+    dpsi_x1 = dpsi_tile;
+    dpsi_x2 = dpsi_tile + ld;
+    dpsi_x3 = dpsi_tile + 2 * ld;
+
+    for (n0 = 0; n0 < ncol; n0 += nb) {
+        nt = min(nb, ncol - n0);
+        for (dim = 0; dim < 3; dim++) {
+            for (spinor = 0; spinor < Nspinor; spinor++) {
+                // find dPsi in direction dim (along lattice vectors for non-orthogonal cells)
+                Gradient_vectors_dir(pSPARC, DMnd, pSPARC->DMVertices_dmcomm, nt, 0.0, pSPARC->Xorb+n0*DMndsp+spinor*DMnd, DMndsp,
+                                    dpsi_tile+dim*ld+spinor*DMnd, DMndsp, dim, pSPARC->dmcomm);
+            }
+            /* find inner product <Chi_Jlm, dPsi_n> */
+            Compute_Integral_Chi_Dpsi_tile(pSPARC, dpsi_tile+dim*ld, nt, n0, alpha_f+nIP*(dim+1), -1);
+        }
+
+        // find dPsi in cartesian coordinates
+        if (pSPARC->cell_typ != 0) {
+            double d1, d2, d3;
+            for (i = 0; i < nt * DMndsp; i++) {
+                d1 = dpsi_x1[i]; d2 = dpsi_x2[i]; d3 = dpsi_x3[i];
+                dpsi_x1[i] = pSPARC->gradT[0]*d1 + pSPARC->gradT[3]*d2 + pSPARC->gradT[6]*d3;
+                dpsi_x2[i] = pSPARC->gradT[1]*d1 + pSPARC->gradT[4]*d2 + pSPARC->gradT[7]*d3;
+                dpsi_x3[i] = pSPARC->gradT[2]*d1 + pSPARC->gradT[5]*d2 + pSPARC->gradT[8]*d3;
+            }
+        }
+
+        /* find inner product <Chi_Jlm, dPsi_n.(x-R_J)> */
+        count = 1;
+        for (dim = 0; dim < 3; dim++) {
+            for (dim2 = dim; dim2 < 3; dim2++) {
+                Compute_Integral_Chi_Dpsi_tile(pSPARC, dpsi_tile+dim*ld, nt, n0, alpha_s+nIP*count, dim2);
+                count ++;
+            }
+        }
+
+        // Kinetic stress
+        Compute_stress_tensor_kinetic_tile(pSPARC, dpsi_tile, ld, nt, n0, stress_k);
+    }
+    if (dpsi_tile != pSPARC->Yorb) free(dpsi_tile);
+
+    // find <chi_Jlm, psi>
+    Compute_Integral_psi_Chi(pSPARC, alpha_f, pSPARC->Xorb);
+
+    if (pSPARC->npNd > 1) {
+        MPI_Allreduce(MPI_IN_PLACE, alpha_f, nIP * 4, MPI_DOUBLE, MPI_SUM, pSPARC->dmcomm);
+        MPI_Allreduce(MPI_IN_PLACE, alpha_s + nIP, nIP * 6, MPI_DOUBLE, MPI_SUM, pSPARC->dmcomm);
+        MPI_Allreduce(MPI_IN_PLACE, stress_k, 6, MPI_DOUBLE, MPI_SUM, pSPARC->dmcomm);
+    }
+    memcpy(alpha_s, alpha_f, nIP * sizeof(double));
+
+    /* calculate nonlocal force */
+    Compute_force_nloc_by_integrals(pSPARC, force_nloc, alpha_f);
+    free(alpha_f);
+
+    /* calculate nonlocal stress and energy */
+    Compute_stress_tensor_nloc_by_integrals(pSPARC, stress_nl, alpha_s);
+    energy_nl = Compute_Nonlocal_Energy_by_integrals(pSPARC, alpha_s);
+    free(alpha_s);
+
+    finalize_nonlocal_forces(pSPARC, force_nloc);
+    free(force_nloc);
+
+    finalize_nonlocal_kinetic_stress(pSPARC, stress_nl, stress_k, energy_nl);
+}
+
+
+/**
+ * @brief   Calculate <Chi_Jlm, DPsi_n> or <Chi_Jlm, ST(x-RJ')_dim2 DPsi_n> for
+ *          one band tile - gamma point.
+ */
+void Compute_Integral_Chi_Dpsi_tile(SPARC_OBJ *pSPARC, double *dpsi, int nt, int n0, double *beta, int dim2)
+{
+    int i, n, ndc, ityp, iat, ncol, DMnd, atom_index;
+    int spinor, Nspinor, DMndsp, spinorshift;
+    int indx, i_DM, j_DM, k_DM, DMnx, DMny;
+    ncol = pSPARC->Nband_bandcomm; // number of bands assigned
+    DMnd = pSPARC->Nd_d_dmcomm;
+    DMnx = pSPARC->Nx_d_dmcomm;
+    DMny = pSPARC->Ny_d_dmcomm;
+    Nspinor = pSPARC->Nspinor_spincomm;
+    DMndsp = DMnd * Nspinor;
+
+    double *dx_rc, *dx_ptr, *dx_rc_ptr;
+    double R1, R2, R3, x1_R1, x2_R2, x3_R3, StXmRjp;
+
+    for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+        int nproj = pSPARC->nlocProj[ityp].nproj;
+        if (! nproj) continue; // this is typical for hydrogen
+        for (iat = 0; iat < pSPARC->Atom_Influence_nloc[ityp].n_atom; iat++) {
+            R1 = pSPARC->Atom_Influence_nloc[ityp].coords[iat*3];
+            R2 = pSPARC->Atom_Influence_nloc[ityp].coords[iat*3+1];
+            R3 = pSPARC->Atom_Influence_nloc[ityp].coords[iat*3+2];
+            ndc = pSPARC->Atom_Influence_nloc[ityp].ndc[iat];
+            int *grid_pos = pSPARC->Atom_Influence_nloc[ityp].grid_pos[iat];
+            dx_rc = (double *)malloc( ndc * nt * sizeof(double));
+            assert(dx_rc != NULL);
+            atom_index = pSPARC->Atom_Influence_nloc[ityp].atom_index[iat];
+            for (spinor = 0; spinor < Nspinor; spinor++) {
+                for (n = 0; n < nt; n++) {
+                    dx_ptr = dpsi + n * DMndsp + spinor * DMnd;
+                    dx_rc_ptr = dx_rc + n * ndc;
+                    if (dim2 < 0) {
+                        for (i = 0; i < ndc; i++) {
+                            *(dx_rc_ptr + i) = *(dx_ptr + grid_pos[i]);
+                        }
+                    } else {
+                        for (i = 0; i < ndc; i++) {
+                            indx = grid_pos[i];
+                            k_DM = indx / (DMnx * DMny);
+                            j_DM = (indx - k_DM * (DMnx * DMny)) / DMnx;
+                            i_DM = indx % DMnx;
+                            x1_R1 = (i_DM + pSPARC->DMVertices_dmcomm[0]) * pSPARC->delta_x - R1;
+                            x2_R2 = (j_DM + pSPARC->DMVertices_dmcomm[2]) * pSPARC->delta_y - R2;
+                            x3_R3 = (k_DM + pSPARC->DMVertices_dmcomm[4]) * pSPARC->delta_z - R3;
+                            StXmRjp = pSPARC->LatUVec[0+dim2] * x1_R1 + pSPARC->LatUVec[3+dim2] * x2_R2 + pSPARC->LatUVec[6+dim2] * x3_R3;
+                            *(dx_rc_ptr + i) = *(dx_ptr + indx) * StXmRjp;
+                        }
+                    }
+                }
+                spinorshift = pSPARC->IP_displ[pSPARC->n_atom] * ncol * spinor;
+                cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, nproj, nt, ndc, 1.0, pSPARC->nlocProj[ityp].Chi[iat], ndc,
+                            dx_rc, ndc, 1.0, beta+spinorshift+pSPARC->IP_displ[atom_index]*ncol+n0*nproj, nproj);
+            }
+            free(dx_rc);
+        }
+    }
+}
+
+
+/**
+ * @brief   Add the kinetic stress of one band tile - gamma point.
+ */
+void Compute_stress_tensor_kinetic_tile(SPARC_OBJ *pSPARC, double *dpsi_full, int ld, int nt, int n0, double *stress_k)
+{
+    int DMnd, Ns, Nspinor, DMndsp;
+    DMnd = pSPARC->Nd_d_dmcomm;
+    Nspinor = pSPARC->Nspinor_spincomm;
+    DMndsp = DMnd * Nspinor;
+    Ns = pSPARC->Nstates;
+
+    double *dpsi_xi, *dpsi_xj, *dpsi_xi_ptr, *dpsi_xj_ptr;
+    int count, dim, dim2, n, spinor, i;
+
+    count = 0;
+    for (dim = 0; dim < 3; dim++) {
+        dpsi_xi = dpsi_full + dim * ld;
+        for (dim2 = dim; dim2 < 3; dim2++) {
+            dpsi_xj = dpsi_full + dim2 * ld;
+            double temp_k = 0;
+            for(n = 0; n < nt; n++){
+                for (spinor = 0; spinor < Nspinor; spinor++) {
+                    double dpsii_dpsij = 0;
+                    dpsi_xi_ptr = dpsi_xi + n * DMndsp + spinor * DMnd; // dpsi_xi
+                    dpsi_xj_ptr = dpsi_xj + n * DMndsp + spinor * DMnd; // dpsi_xj
+
+                    for(i = 0; i < DMnd; i++){
+                        dpsii_dpsij += *(dpsi_xi_ptr + i) * *(dpsi_xj_ptr + i);
+                    }
+                    double *occ = pSPARC->occ;
+                    if (pSPARC->spin_typ == 1) occ += spinor * Ns;
+                    double g_nk = occ[n0 + n + pSPARC->band_start_indx];
+                    temp_k += dpsii_dpsij * g_nk;
+                }
+            }
+            stress_k[count] -= pSPARC->occfac * temp_k;
+            count ++;
+        }
+    }
+}
+
+
+/**
+ * @brief   Calculate nonlocal forces and nonlocal + kinetic stress in one pass
+ *          over the orbitals - k-points.
+ */
+void Calculate_nonlocal_forces_stress_kpt(SPARC_OBJ *pSPARC)
+{
+    pSPARC->nlocStressReady = 1;
+    if (pSPARC->spincomm_index < 0 || pSPARC->kptcomm_index < 0 || pSPARC->bandcomm_index < 0 || pSPARC->dmcomm == MPI_COMM_NULL) return;
+
+#ifdef DEBUG
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (!rank) printf("Start calculating nonlocal forces and stress contributions from kinetic and nonlocal psp.\n");
+#endif
+
+    int i, n0, nt, nb, ncol, DMnd, DMndsp, Nspinor, spinor, Nk, kpt, size_k;
+    int dim, dim2, count, ld, iopt, nopt, nIP[3];
+    ncol = pSPARC->Nband_bandcomm; // number of bands assigned
+    DMnd = pSPARC->Nd_d_dmcomm;
+    Nspinor = pSPARC->Nspinor_spincomm;
+    DMndsp = DMnd * Nspinor;
+    Nk = pSPARC->Nkpts_kptcomm;
+    size_k = DMndsp * ncol;
+
+    // scalar relativistic part, and the two spin-orbit coupling parts if required
+    char *options[3] = {"SC", "SO1", "SO2"};
+    nopt = (pSPARC->SOC_Flag == 1) ? 3 : 1;
+    nIP[0] = pSPARC->IP_displ[pSPARC->n_atom] * ncol * Nspinor; // size of one block of integrals
+    nIP[1] = nIP[2] = (pSPARC->SOC_Flag == 1) ? pSPARC->IP_displ_SOC[pSPARC->n_atom] * ncol * Nspinor : 0;
+
+    double _Complex *alpha_f[3], *alpha_s[3], *dpsi_tile, *dpsi_x1, *dpsi_x2, *dpsi_x3;
+    double *force_nloc, energy_nl, stress_k[6], stress_nl[6], kpt_vec;
+    for (i = 0; i < 6; i++) stress_nl[i] = stress_k[i] = 0;
+
+    force_nloc = (double *)calloc(3 * pSPARC->n_atom, sizeof(double));
+    assert(force_nloc != NULL);
+    // alpha stores integrals in order: Nstate, image, type, spin, kpt, block
+    for (iopt = 0; iopt < nopt; iopt++) {
+        alpha_f[iopt] = (double _Complex *)calloc(nIP[iopt] * Nk * 4, sizeof(double _Complex));
+        alpha_s[iopt] = (double _Complex *)calloc(nIP[iopt] * Nk * 7, sizeof(double _Complex));
+        assert(alpha_f[iopt] != NULL && alpha_s[iopt] != NULL);
+    }
+
+    // gradients of one band tile in all three directions, stored in Yorb_kpt if it fits
+    nb = nloc_force_stress_tile_size(ncol);
+    ld = nb * DMndsp;
+    dpsi_tile = (3 * nb <= ncol) ? pSPARC->Yorb_kpt : (double _Complex *)malloc(3 * ld * sizeof(double _Complex));
+    assert(dpsi_tile != NULL);
+    dpsi_x1 = dpsi_tile;
+    dpsi_x2 = dpsi_tile + ld;
+    dpsi_x3 = dpsi_tile + 2 * ld;
+
+    for (kpt = 0; kpt < Nk; kpt++) {
+        for (n0 = 0; n0 < ncol; n0 += nb) {
+            nt = min(nb, ncol - n0);
+            for (dim = 0; dim < 3; dim++) {
+                kpt_vec = (dim == 0) ? pSPARC->k1_loc[kpt] : ((dim == 1) ? pSPARC->k2_loc[kpt] : pSPARC->k3_loc[kpt]);
+                for (spinor = 0; spinor < Nspinor; spinor++) {
+                    // find dPsi in direction dim (along lattice vectors for non-orthogonal cells)
+                    Gradient_vectors_dir_kpt(pSPARC, DMnd, pSPARC->DMVertices_dmcomm, nt, 0.0, pSPARC->Xorb_kpt+kpt*size_k+n0*DMndsp+spinor*DMnd, DMndsp,
+                                            dpsi_tile+dim*ld+spinor*DMnd, DMndsp, dim, &kpt_vec, pSPARC->dmcomm);
+                }
+                /* find inner product <Chi_Jlm, dPsi_n> */
+                for (iopt = 0; iopt < nopt; iopt++) {
+                    Compute_Integral_Chi_Dpsi_tile_kpt(pSPARC, dpsi_tile+dim*ld, nt, n0, alpha_f[iopt]+nIP[iopt]*(Nk*(dim+1)+kpt), kpt, -1, options[iopt]);
+                }
+            }
+
+            // find dPsi in cartesian coordinates
+            if (pSPARC->cell_typ != 0) {
+                double _Complex d1, d2, d3;
+                for (i = 0; i < nt * DMndsp; i++) {
+                    d1 = dpsi_x1[i]; d2 = dpsi_x2[i]; d3 = dpsi_x3[i];
+                    dpsi_x1[i] = pSPARC->gradT[0]*d1 + pSPARC->gradT[3]*d2 + pSPARC->gradT[6]*d3;
+                    dpsi_x2[i] = pSPARC->gradT[1]*d1 + pSPARC->gradT[4]*d2 + pSPARC->gradT[7]*d3;
+                    dpsi_x3[i] = pSPARC->gradT[2]*d1 + pSPARC->gradT[5]*d2 + pSPARC->gradT[8]*d3;
+                }
+            }
+
+            /* find inner product <Chi_Jlm, dPsi_n.(x-R_J)> */
+            count = 1;
+            for (dim = 0; dim < 3; dim++) {
+                for (dim2 = dim; dim2 < 3; dim2++) {
+                    for (iopt = 0; iopt < nopt; iopt++) {
+                        Compute_Integral_Chi_Dpsi_tile_kpt(pSPARC, dpsi_tile+dim*ld, nt, n0, alpha_s[iopt]+nIP[iopt]*(Nk*count+kpt), kpt, dim2, options[iopt]);
+                    }
+                    count ++;
+                }
+            }
+
+            // Kinetic stress
+            Compute_stress_tensor_kinetic_tile_kpt(pSPARC, dpsi_tile, ld, nt, n0, kpt, stress_k);
+        }
+
+        // find <chi_Jlm, psi>
+        for (iopt = 0; iopt < nopt; iopt++) {
+            Compute_Integral_psi_Chi_kpt(pSPARC, alpha_f[iopt]+nIP[iopt]*kpt, pSPARC->Xorb_kpt+kpt*size_k, kpt, options[iopt]);
+        }
+    }
+    if (dpsi_tile != pSPARC->Yorb_kpt) free(dpsi_tile);
+
+    if (pSPARC->npNd > 1) {
+        for (iopt = 0; iopt < nopt; iopt++) {
+            MPI_Allreduce(MPI_IN_PLACE, alpha_f[iopt], nIP[iopt] * Nk * 4, MPI_DOUBLE_COMPLEX, MPI_SUM, pSPARC->dmcomm);
+            MPI_Allreduce(MPI_IN_PLACE, alpha_s[iopt] + nIP[iopt] * Nk, nIP[iopt] * Nk * 6, MPI_DOUBLE_COMPLEX, MPI_SUM, pSPARC->dmcomm);
+        }
+        MPI_Allreduce(MPI_IN_PLACE, stress_k, 6, MPI_DOUBLE, MPI_SUM, pSPARC->dmcomm);
+    }
+
+    energy_nl = 0.0;
+    for (iopt = 0; iopt < nopt; iopt++) {
+        memcpy(alpha_s[iopt], alpha_f[iopt], nIP[iopt] * Nk * sizeof(double _Complex));
+        /* calculate nonlocal force */
+        Compute_force_nloc_by_integrals_kpt(pSPARC, force_nloc, alpha_f[iopt], options[iopt]);
+        /* calculate nonlocal stress and energy */
+        Compute_stress_tensor_nloc_by_integrals_kpt(pSPARC, stress_nl, alpha_s[iopt], options[iopt]);
+        energy_nl += Compute_Nonlocal_Energy_by_integrals_kpt(pSPARC, alpha_s[iopt], options[iopt]);
+        free(alpha_f[iopt]);
+        free(alpha_s[iopt]);
+    }
+
+    finalize_nonlocal_forces(pSPARC, force_nloc);
+    free(force_nloc);
+
+    finalize_nonlocal_kinetic_stress(pSPARC, stress_nl, stress_k, energy_nl);
+}
+
+
+/**
+ * @brief   Calculate <Chi_Jlm, DPsi_n> or <Chi_Jlm, ST(x-RJ')_dim2 DPsi_n> for
+ *          one band tile - k-points.
+ *
+ *          Note: avail options are "SC", "SO1", "SO2"
+ */
+void Compute_Integral_Chi_Dpsi_tile_kpt(SPARC_OBJ *pSPARC, double _Complex *dpsi, int nt, int n0,
+                                        double _Complex *beta, int kpt, int dim2, char *option)
+{
+    int i, n, ndc, ityp, iat, ncol, DMnd, atom_index;
+    int spinor, Nspinor, DMndsp, spinorshift, nproj, ispinor, *IP_displ;
+    int indx, i_DM, j_DM, k_DM, DMnx, DMny;
+    ncol = pSPARC->Nband_bandcomm; // number of bands assigned
+    DMnd = pSPARC->Nd_d_dmcomm;
+    DMnx = pSPARC->Nx_d_dmcomm;
+    DMny = pSPARC->Ny_d_dmcomm;
+    Nspinor = pSPARC->Nspinor_spincomm;
+    DMndsp = DMnd * Nspinor;
+
+    double _Complex *dx_rc, *dx_ptr, *dx_rc_ptr;
+    double Lx = pSPARC->range_x;
+    double Ly = pSPARC->range_y;
+    double Lz = pSPARC->range_z;
+    double k1, k2, k3, theta, R1, R2, R3, x1_R1, x2_R2, x3_R3, StXmRjp;
+    double _Complex bloch_fac, b, **Chi = NULL;
+
+    k1 = pSPARC->k1_loc[kpt];
+    k2 = pSPARC->k2_loc[kpt];
+    k3 = pSPARC->k3_loc[kpt];
+
+    IP_displ = !strcmpi(option, "SC") ? pSPARC->IP_displ : pSPARC->IP_displ_SOC;
+
+    for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+        nproj = !strcmpi(option, "SC") ? pSPARC->nlocProj[ityp].nproj : pSPARC->nlocProj[ityp].nprojso_ext;
+        if (!strcmpi(option, "SC"))
+            Chi = pSPARC->nlocProj[ityp].Chi_c;
+        else if (!strcmpi(option, "SO1"))
+            Chi = pSPARC->nlocProj[ityp].Chisowt0;
+
+        if (! nproj) continue; // this is typical for hydrogen
+        for (iat = 0; iat < pSPARC->Atom_Influence_nloc[ityp].n_atom; iat++) {
+            R1 = pSPARC->Atom_Influence_nloc[ityp].coords[iat*3];
+            R2 = pSPARC->Atom_Influence_nloc[ityp].coords[iat*3+1];
+            R3 = pSPARC->Atom_Influence_nloc[ityp].coords[iat*3+2];
+            theta = -k1 * (floor(R1/Lx) * Lx) - k2 * (floor(R2/Ly) * Ly) - k3 * (floor(R3/Lz) * Lz);
+            bloch_fac = cos(theta) + sin(theta) * I;
+            b = 1.0;
+            ndc = pSPARC->Atom_Influence_nloc[ityp].ndc[iat];
+            int *grid_pos = pSPARC->Atom_Influence_nloc[ityp].grid_pos[iat];
+            dx_rc = (double _Complex *)malloc( ndc * nt * sizeof(double _Complex));
+            assert(dx_rc != NULL);
+            atom_index = pSPARC->Atom_Influence_nloc[ityp].atom_index[iat];
+            for (spinor = 0; spinor < Nspinor; spinor++) {
+                if (!strcmpi(option, "SO2"))
+                    Chi = (spinor == 0) ? pSPARC->nlocProj[ityp].Chisowtnl : pSPARC->nlocProj[ityp].Chisowtl;
+                ispinor = !strcmpi(option, "SO2") ? (1 - spinor) : spinor;
+
+                for (n = 0; n < nt; n++) {
+                    dx_ptr = dpsi + n * DMndsp + ispinor * DMnd;
+                    dx_rc_ptr = dx_rc + n * ndc;
+                    if (dim2 < 0) {
+                        for (i = 0; i < ndc; i++) {
+                            *(dx_rc_ptr + i) = *(dx_ptr + grid_pos[i]);
+                        }
+                    } else {
+                        for (i = 0; i < ndc; i++) {
+                            indx = grid_pos[i];
+                            k_DM = indx / (DMnx * DMny);
+                            j_DM = (indx - k_DM * (DMnx * DMny)) / DMnx;
+                            i_DM = indx % DMnx;
+                            x1_R1 = (i_DM + pSPARC->DMVertices_dmcomm[0]) * pSPARC->delta_x - R1;
+                            x2_R2 = (j_DM + pSPARC->DMVertices_dmcomm[2]) * pSPARC->delta_y - R2;
+                            x3_R3 = (k_DM + pSPARC->DMVertices_dmcomm[4]) * pSPARC->delta_z - R3;
+                            StXmRjp = pSPARC->LatUVec[0+dim2] * x1_R1 + pSPARC->LatUVec[3+dim2] * x2_R2 + pSPARC->LatUVec[6+dim2] * x3_R3;
+                            *(dx_rc_ptr + i) = *(dx_ptr + indx) * StXmRjp;
+                        }
+                    }
+                }
+
+                spinorshift = IP_displ[pSPARC->n_atom] * ncol * spinor;
+                cblas_zgemm(CblasColMajor, CblasConjTrans, CblasNoTrans, nproj, nt, ndc, &bloch_fac, Chi[iat], ndc,
+                            dx_rc, ndc, &b, beta+spinorshift+IP_displ[atom_index]*ncol+n0*nproj, nproj);
+            }
+            free(dx_rc);
+        }
+    }
+}
+
+
+/**
+ * @brief   Add the kinetic stress of one band tile - k-points.
+ */
+void Compute_stress_tensor_kinetic_tile_kpt(SPARC_OBJ *pSPARC, double _Complex *dpsi_full, int ld, int nt, int n0,
+                                            int kpt, double *stress_k)
+{
+    int DMnd, Ns, Nspinor, DMndsp, Nk;
+    DMnd = pSPARC->Nd_d_dmcomm;
+    Nspinor = pSPARC->Nspinor_spincomm;
+    DMndsp = DMnd * Nspinor;
+    Nk = pSPARC->Nkpts_kptcomm;
+    Ns = pSPARC->Nstates;
+
+    double _Complex *dpsi_xi, *dpsi_xj, *dpsi_xi_ptr, *dpsi_xj_ptr;
+    int count, dim, dim2, n, spinor, i;
+
+    count = 0;
+    for (dim = 0; dim < 3; dim++) {
+        dpsi_xi = dpsi_full + dim * ld;
+        for (dim2 = dim; dim2 < 3; dim2++) {
+            dpsi_xj = dpsi_full + dim2 * ld;
+            double temp_k = 0;
+            for(n = 0; n < nt; n++){
+                for (spinor = 0; spinor < Nspinor; spinor++) {
+                    double dpsii_dpsij = 0;
+                    dpsi_xi_ptr = dpsi_xi + n * DMndsp + spinor * DMnd; // dpsi_xi
+                    dpsi_xj_ptr = dpsi_xj + n * DMndsp + spinor * DMnd; // dpsi_xj
+
+                    for(i = 0; i < DMnd; i++){
+                        dpsii_dpsij += creal(*(dpsi_xi_ptr + i)) * creal(*(dpsi_xj_ptr + i)) + cimag(*(dpsi_xi_ptr + i)) * cimag(*(dpsi_xj_ptr + i));
+                    }
+                    double *occ = pSPARC->occ + kpt*Ns;
+                    if (pSPARC->spin_typ == 1) occ += spinor * Nk * Ns;
+                    double g_nk = occ[n0 + n + pSPARC->band_start_indx];
+                    temp_k += dpsii_dpsij * g_nk;
+                }
+            }
+            stress_k[count] -= pSPARC->occfac * pSPARC->kptWts_loc[kpt] / pSPARC->Nkpts * temp_k;
+            count ++;
+        }
+    }
+}
@@ -14,7 +14,9 @@
 #include <complex.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <assert.h>
 #include <mpi.h>
 /* BLAS routines */
 #ifdef USE_MKL
@@ -28,6 +30,8 @@
 #include "isddft.h"
 #include "initialization.h"
 #include "cyclix_tools.h"
+#include "timing.h"
+#include "incrementalUpdate.h"
 
 #define TEMP_TOL 1e-12
 
@@ -67,8 +71,11 @@ void GetInfluencingAtoms_nloc(SPARC_OBJ *pSPARC, ATOM_NLOC_INFLUENCE_OBJ **Atom_
     int count_overlap_nloc, count_overlap_nloc_sphere, ityp, i, j, k, count, i_DM, j_DM, k_DM, 
         iat, atmcount, atmcount2, DMnx, DMny;
     int pp, qq, rr, ppmin, ppmax, qqmin, qqmax, rrmin, rrmax;
-    int rc_xl, rc_xr, rc_yl, rc_yr, rc_zl, rc_zr, ndc;
+    int rc_xl, rc_xr, rc_yl, rc_yr, rc_zl, rc_zr, ndc, cursor, jprev;
     
+    // influence list of the last step, if the incremental update is on
+    ATOM_NLOC_INFLUENCE_OBJ *AI_prev = IncrementalUpdate_nloc_prev(pSPARC, comm);
+
     Lx = pSPARC->range_x;
     Ly = pSPARC->range_y;
     Lz = pSPARC->range_z;
@@ -198,6 +205,7 @@ void GetInfluencingAtoms_nloc(SPARC_OBJ *pSPARC, ATOM_NLOC_INFLUENCE_OBJ **Atom_
         // loop over atoms of this type again to find overlapping region and atom info
         count_overlap_nloc = 0;
         count_overlap_nloc_sphere = 0;
+        cursor = 0;
         for (iat = 0; iat < pSPARC->nAtomv[ityp]; iat++) {
             // get atom positions
             x0 = pSPARC->atom_pos[3*atmcount2];
@@ -279,6 +287,29 @@ void GetInfluencingAtoms_nloc(SPARC_OBJ *pSPARC, ATOM_NLOC_INFLUENCE_OBJ **Atom_
                             * (Atom_Influence_nloc_temp.ye[count_overlap_nloc] - Atom_Influence_nloc_temp.ys[count_overlap_nloc] + 1)
                             * (Atom_Influence_nloc_temp.ze[count_overlap_nloc] - Atom_Influence_nloc_temp.zs[count_overlap_nloc] + 1);
                         
+                        // take over the rc-region of the last step if the atom has not moved
+                        jprev = -1;
+                        if (AI_prev != NULL && AI_prev[ityp].n_atom > 0) {
+                            jprev = IncrementalUpdate_find_image(pSPARC, AI_prev[ityp].n_atom, AI_prev[ityp].atom_index, 
+                                AI_prev[ityp].coords, atmcount2-1, &Atom_Influence_nloc_temp.coords[count_overlap_nloc*3], &cursor);
+                            if (jprev >= 0 && (AI_prev[ityp].xs[jprev] != Atom_Influence_nloc_temp.xs[count_overlap_nloc] ||
+                                               AI_prev[ityp].xe[jprev] != Atom_Influence_nloc_temp.xe[count_overlap_nloc] ||
+                                               AI_prev[ityp].ys[jprev] != Atom_Influence_nloc_temp.ys[count_overlap_nloc] ||
+                                               AI_prev[ityp].ye[jprev] != Atom_Influence_nloc_temp.ye[count_overlap_nloc] ||
+                                               AI_prev[ityp].zs[jprev] != Atom_Influence_nloc_temp.zs[count_overlap_nloc] ||
+                                               AI_prev[ityp].ze[jprev] != Atom_Influence_nloc_temp.ze[count_overlap_nloc]))
+                                jprev = -1;
+                        }
+                        if (jprev >= 0) {
+                            Atom_Influence_nloc_temp.grid_pos[count_overlap_nloc] = AI_prev[ityp].grid_pos[jprev];
+                            AI_prev[ityp].grid_pos[jprev] = NULL;
+                            count = AI_prev[ityp].ndc[jprev];
+                            Atom_Influence_nloc_temp.ndc[count_overlap_nloc] = count;
+                            count_overlap_nloc++;
+                            count_overlap_nloc_sphere++;
+                            continue;
+                        }
+
                         // first allocate memory for the rectangular rc-region, resize later to the spherical rc-region
                         Atom_Influence_nloc_temp.grid_pos[count_overlap_nloc] = (int *)malloc(sizeof(int) * ndc);
                         count = 0;
@@ -358,10 +389,8 @@ void GetInfluencingAtoms_nloc(SPARC_OBJ *pSPARC, ATOM_NLOC_INFLUENCE_OBJ **Atom_
                 (*Atom_Influence_nloc)[ityp].ye[count] = Atom_Influence_nloc_temp.ye[i];
                 (*Atom_Influence_nloc)[ityp].ze[count] = Atom_Influence_nloc_temp.ze[i];
                 (*Atom_Influence_nloc)[ityp].ndc[count] = Atom_Influence_nloc_temp.ndc[i];
-                (*Atom_Influence_nloc)[ityp].grid_pos[count] = (int *)malloc(sizeof(int) * ndc);
-                for (j = 0; j < ndc; j++) {
-                    (*Atom_Influence_nloc)[ityp].grid_pos[count][j] = Atom_Influence_nloc_temp.grid_pos[i][j];
-                }
+                (*Atom_Influence_nloc)[ityp].grid_pos[count] = (int *)realloc(Atom_Influence_nloc_temp.grid_pos[i], sizeof(int) * ndc);
+                Atom_Influence_nloc_temp.grid_pos[i] = NULL;
                 count++;
             }
             free(Atom_Influence_nloc_temp.grid_pos[i]);
@@ -416,6 +445,11 @@ void CalculateNonlocalProjectors(SPARC_OBJ *pSPARC, NLOC_PROJ_OBJ **nlocProj,
     DMnx = DMVertices[1] - DMVertices[0] + 1;
     DMny = DMVertices[3] - DMVertices[2] + 1;
 
+    // projectors of the last step, if the incremental update is on
+    ATOM_NLOC_INFLUENCE_OBJ *AI_prev = IncrementalUpdate_nloc_prev(pSPARC, comm);
+    NLOC_PROJ_OBJ *nlocProj_prev = IncrementalUpdate_proj_prev(pSPARC, comm);
+    int cursor, jprev;
+
     (*nlocProj) = (NLOC_PROJ_OBJ *)malloc( sizeof(NLOC_PROJ_OBJ) * pSPARC->Ntypes ); // TODO: deallocate!!
     double *Intgwt = NULL;
     double y0, z0, xi, yi, zi, ty, tz;
@@ -430,6 +464,8 @@ void CalculateNonlocalProjectors(SPARC_OBJ *pSPARC, NLOC_PROJ_OBJ **nlocProj,
     for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) { 
         // allocate memory for projectors
         (*nlocProj)[ityp].Chi = (double **)malloc( sizeof(double *) * Atom_Influence_nloc[ityp].n_atom);
+        (*nlocProj)[ityp].Chi_sp = NULL;
+        (*nlocProj)[ityp].Chi_c_sp = NULL;
         if (pSPARC->CyclixFlag) {
             (*nlocProj)[ityp].Chi_cyclix = (double **)malloc( sizeof(double *) * Atom_Influence_nloc[ityp].n_atom);
         }
@@ -443,6 +479,7 @@ void CalculateNonlocalProjectors(SPARC_OBJ *pSPARC, NLOC_PROJ_OBJ **nlocProj,
             (*nlocProj)[ityp].nproj += pSPARC->psd[ityp].ppl[l] * (2 * l + 1);
         }
         if (! (*nlocProj)[ityp].nproj) continue;
+        cursor = 0;
         for (iat = 0; iat < Atom_Influence_nloc[ityp].n_atom; iat++) {
             // store coordinates of the overlapping atom
             x0_i = Atom_Influence_nloc[ityp].coords[iat*3  ];
@@ -450,6 +487,16 @@ void CalculateNonlocalProjectors(SPARC_OBJ *pSPARC, NLOC_PROJ_OBJ **nlocProj,
             z0_i = Atom_Influence_nloc[ityp].coords[iat*3+2];
             // grid nodes in (spherical) rc-domain
             ndc = Atom_Influence_nloc[ityp].ndc[iat]; 
+            // take over the projectors of the last step if the atom has not moved
+            if (nlocProj_prev != NULL && AI_prev[ityp].n_atom > 0) {
+                jprev = IncrementalUpdate_find_image(pSPARC, AI_prev[ityp].n_atom, AI_prev[ityp].atom_index, 
+                    AI_prev[ityp].coords, Atom_Influence_nloc[ityp].atom_index[iat], &Atom_Influence_nloc[ityp].coords[iat*3], &cursor);
+                if (jprev >= 0 && AI_prev[ityp].ndc[jprev] == ndc) {
+                    (*nlocProj)[ityp].Chi[iat] = nlocProj_prev[ityp].Chi[jprev];
+                    nlocProj_prev[ityp].Chi[jprev] = NULL;
+                    continue;
+                }
+            }
             (*nlocProj)[ityp].Chi[iat] = (double *)malloc( sizeof(double) * ndc * (*nlocProj)[ityp].nproj); 
             if (pSPARC->CyclixFlag) {
                 (*nlocProj)[ityp].Chi_cyclix[iat] = (double *)malloc( sizeof(double) * ndc * (*nlocProj)[ityp].nproj);
@@ -528,8 +575,8 @@ void CalculateNonlocalProjectors(SPARC_OBJ *pSPARC, NLOC_PROJ_OBJ **nlocProj,
                 for (np = 0; np < pSPARC->psd[ityp].ppl[l]; np++) {
                     // find UdV using spline interpolation
 					if (pSPARC->psd[ityp].is_r_uniform == 1) {
-						SplineInterpUniform(pSPARC->psd[ityp].RadialGrid, pSPARC->psd[ityp].UdV+lcount2*psd_len, psd_len, 
-						                    rc_pos_r, UdV_sort, ndc, pSPARC->psd[ityp].SplineFitUdV+lcount*psd_len);
+						SplineInterpUniformTable(pSPARC->psd[ityp].RadialGrid, psd_len, pSPARC->psd[ityp].SplineTabUdV+lcount*4*(psd_len-1), 
+						                         rc_pos_r, UdV_sort, ndc);
 					} else {
 						SplineInterpNonuniform(pSPARC->psd[ityp].RadialGrid, pSPARC->psd[ityp].UdV+lcount2*psd_len, psd_len, 
 						                       rc_pos_r, UdV_sort, ndc, pSPARC->psd[ityp].SplineFitUdV+lcount*psd_len); 
@@ -599,6 +646,11 @@ void CalculateNonlocalProjectors_kpt(SPARC_OBJ *pSPARC, NLOC_PROJ_OBJ **nlocProj
     // number of nodes in the local distributed domain
     DMnx = DMVertices[1] - DMVertices[0] + 1;
     DMny = DMVertices[3] - DMVertices[2] + 1;
+
+    // projectors of the last step, if the incremental update is on
+    ATOM_NLOC_INFLUENCE_OBJ *AI_prev = IncrementalUpdate_nloc_prev(pSPARC, comm);
+    NLOC_PROJ_OBJ *nlocProj_prev = IncrementalUpdate_proj_prev(pSPARC, comm);
+    int cursor, jprev;
     
     double *Intgwt = NULL;   
     double y0, z0, xi, yi, zi, ty, tz;
@@ -615,6 +667,8 @@ void CalculateNonlocalProjectors_kpt(SPARC_OBJ *pSPARC, NLOC_PROJ_OBJ **nlocProj
     for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) { 
         // allocate memory for projectors
         (*nlocProj)[ityp].Chi_c = (double _Complex **)malloc( sizeof(double _Complex *) * Atom_Influence_nloc[ityp].n_atom);
+        (*nlocProj)[ityp].Chi_sp = NULL;
+        (*nlocProj)[ityp].Chi_c_sp = NULL;
         if (pSPARC->CyclixFlag) {
             (*nlocProj)[ityp].Chi_c_cyclix = (double _Complex **)malloc( sizeof(double _Complex *) * Atom_Influence_nloc[ityp].n_atom);
         }
@@ -629,6 +683,7 @@ void CalculateNonlocalProjectors_kpt(SPARC_OBJ *pSPARC, NLOC_PROJ_OBJ **nlocProj
             (*nlocProj)[ityp].nproj += pSPARC->psd[ityp].ppl[l] * (2 * l + 1);
         }
         if (! (*nlocProj)[ityp].nproj) continue;
+        cursor = 0;
         for (iat = 0; iat < Atom_Influence_nloc[ityp].n_atom; iat++) {
             // store coordinates of the overlapping atom
             x0_i = Atom_Influence_nloc[ityp].coords[iat*3  ];
@@ -636,6 +691,16 @@ void CalculateNonlocalProjectors_kpt(SPARC_OBJ *pSPARC, NLOC_PROJ_OBJ **nlocProj
             z0_i = Atom_Influence_nloc[ityp].coords[iat*3+2];
             // grid nodes in (spherical) rc-domain
             ndc = Atom_Influence_nloc[ityp].ndc[iat]; 
+            // take over the projectors of the last step if the atom has not moved
+            if (nlocProj_prev != NULL && AI_prev[ityp].n_atom > 0) {
+                jprev = IncrementalUpdate_find_image(pSPARC, AI_prev[ityp].n_atom, AI_prev[ityp].atom_index, 
+                    AI_prev[ityp].coords, Atom_Influence_nloc[ityp].atom_index[iat], &Atom_Influence_nloc[ityp].coords[iat*3], &cursor);
+                if (jprev >= 0 && AI_prev[ityp].ndc[jprev] == ndc) {
+                    (*nlocProj)[ityp].Chi_c[iat] = nlocProj_prev[ityp].Chi_c[jprev];
+                    nlocProj_prev[ityp].Chi_c[jprev] = NULL;
+                    continue;
+                }
+            }
             (*nlocProj)[ityp].Chi_c[iat] = (double _Complex *)malloc( sizeof(double _Complex) * ndc * (*nlocProj)[ityp].nproj);
             if (pSPARC->CyclixFlag) {
                 (*nlocProj)[ityp].Chi_c_cyclix[iat] = (double _Complex *)malloc( sizeof(double _Complex) * ndc * (*nlocProj)[ityp].nproj);
@@ -714,8 +779,8 @@ void CalculateNonlocalProjectors_kpt(SPARC_OBJ *pSPARC, NLOC_PROJ_OBJ **nlocProj
                 for (np = 0; np < pSPARC->psd[ityp].ppl[l]; np++) {
                     // find UdV using spline interpolation
                     if (pSPARC->psd[ityp].is_r_uniform == 1) {
-						SplineInterpUniform(pSPARC->psd[ityp].RadialGrid, pSPARC->psd[ityp].UdV+lcount2*psd_len, psd_len, 
-						                    rc_pos_r, UdV_sort, ndc, pSPARC->psd[ityp].SplineFitUdV+lcount*psd_len);
+						SplineInterpUniformTable(pSPARC->psd[ityp].RadialGrid, psd_len, pSPARC->psd[ityp].SplineTabUdV+lcount*4*(psd_len-1), 
+						                         rc_pos_r, UdV_sort, ndc);
 					} else {
 						SplineInterpNonuniform(pSPARC->psd[ityp].RadialGrid, pSPARC->psd[ityp].UdV+lcount2*psd_len, psd_len, 
 						                       rc_pos_r, UdV_sort, ndc, pSPARC->psd[ityp].SplineFitUdV+lcount*psd_len); 
@@ -793,54 +858,158 @@ void CalculateNonlocalInnerProductIndex(SPARC_OBJ *pSPARC)
 
 
 /**
- * @brief   Calculate Vnl times vectors in a matrix-free way.
+ * @brief   Get the nonlocal workspace of at least len bytes behind the inner 
+ *          products reserved by Vnl_inner_product_workspace. The workspace is
+ *          kept in pSPARC and only grows, so that no memory is allocated per
+ *          atom or per call.
  */
-void Vnl_vec_mult(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
-                  NLOC_PROJ_OBJ *nlocProj, int ncol, double *x, int ldi, double *Hx, int ldo, MPI_Comm comm)
+static void *Vnl_workspace(const SPARC_OBJ *pSPARC, size_t len)
 {
-    int i, n, np, count;
-    /* compute nonlocal operator times vector(s) */
-    int ityp, iat, l, m, ldispl, lmax, ndc, atom_index;
-    double *alpha, *x_rc, *Vnlx;
-    alpha = (double *)calloc( pSPARC->IP_displ[pSPARC->n_atom] * ncol, sizeof(double));
-    //first find inner product
+    SPARC_OBJ *p = (SPARC_OBJ *)pSPARC;
+    len += p->Vnl_work_ip;
+    if (len > p->Vnl_work_len) {
+        free(p->Vnl_work);
+        p->Vnl_work = malloc(len);
+        assert(p->Vnl_work != NULL);
+        p->Vnl_work_len = len;
+    }
+    return (char *)p->Vnl_work + p->Vnl_work_ip;
+}
+
+
+
+/**
+ * @brief   Find the offsets of the images of one atom type in the packed
+ *          (image after image) rc-domain buffers, displ[n_atom] is the total
+ *          number of rc-domain nodes.
+ */
+static void Vnl_image_displ(const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, size_t *displ)
+{
+    displ[0] = 0;
+    for (int iat = 0; iat < Atom_Influence_nloc->n_atom; iat++)
+        displ[iat+1] = displ[iat] + Atom_Influence_nloc->ndc[iat];
+}
+
+
+
+/**
+ * @brief   Number of elements (per vector) of the nonlocal workspace: the packed
+ *          rc-domain nodes of the largest atom type, plus the inner products of
+ *          all its images if with_ip is 1.
+ */
+static size_t Vnl_workspace_len(const SPARC_OBJ *pSPARC, const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                                const NLOC_PROJ_OBJ *nlocProj, int with_ip)
+{
+    size_t len = 0;
+    for (int ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+        if (! nlocProj[ityp].nproj) continue;
+        size_t len_typ = with_ip ? (size_t) Atom_Influence_nloc[ityp].n_atom * nlocProj[ityp].nproj : 0;
+        for (int iat = 0; iat < Atom_Influence_nloc[ityp].n_atom; iat++)
+            len_typ += Atom_Influence_nloc[ityp].ndc[iat];
+        if (len_typ > len) len = len_typ;
+    }
+    return len;
+}
+
+
+
+/**
+ * @brief   Bytes of the packed part of the nonlocal workspace for ncol vectors with 
+ *          elements of elem bytes (see Vnl_workspace_len for with_ip), made of 
+ *          the image offsets of one atom type and the packed rc-domain buffer.
+ */
+static size_t Vnl_packed_bytes(const SPARC_OBJ *pSPARC, const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                               const NLOC_PROJ_OBJ *nlocProj, int ncol, size_t elem, int with_ip, size_t *displ_bytes)
+{
+    int max_img = 0;
+    for (int ityp = 0; ityp < pSPARC->Ntypes; ityp++)
+        if (Atom_Influence_nloc[ityp].n_atom > max_img) max_img = Atom_Influence_nloc[ityp].n_atom;
+    // the packed buffer after the offsets stays aligned for complex entries
+    *displ_bytes = ((max_img + 1) * sizeof(size_t) + 15) / 16 * 16;
+    return *displ_bytes + Vnl_workspace_len(pSPARC, Atom_Influence_nloc, nlocProj, with_ip) * ncol * elem;
+}
+
+
+
+/**
+ * @brief   Get the packed rc-domain buffer of the nonlocal workspace for ncol 
+ *          vectors with elements of elem bytes (see Vnl_workspace_len for 
+ *          with_ip), and the storage for the image offsets of one atom type.
+ */
+void *Vnl_workspace_packed(const SPARC_OBJ *pSPARC, const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                           const NLOC_PROJ_OBJ *nlocProj, int ncol, size_t elem, int with_ip, size_t **displ)
+{
+    size_t displ_bytes;
+    size_t len = Vnl_packed_bytes(pSPARC, Atom_Influence_nloc, nlocProj, ncol, elem, with_ip, &displ_bytes);
+    char *work = (char *) Vnl_workspace(pSPARC, len);
+    *displ = (size_t *) work;
+    return work + displ_bytes;
+}
+
+
+
+/**
+ * @brief   Get zeroed storage for the inner products of nalpha concurrent calls 
+ *          of Vnl_vec_mult_begin/end from the front of the nonlocal workspace.
+ *          The workspace is sized for the packed buffers of these calls as well,
+ *          so that it does not move while the inner products are reduced.
+ */
+void *Vnl_inner_product_workspace(const SPARC_OBJ *pSPARC, const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                                  const NLOC_PROJ_OBJ *nlocProj, int ncol, size_t elem, int nalpha)
+{
+    SPARC_OBJ *p = (SPARC_OBJ *)pSPARC;
+    size_t displ_bytes;
+    size_t ip_bytes = ((size_t) nalpha * pSPARC->IP_displ[pSPARC->n_atom] * ncol * elem + 15) / 16 * 16;
+    size_t len = Vnl_packed_bytes(pSPARC, Atom_Influence_nloc, nlocProj, ncol, elem, 1, &displ_bytes);
+    p->Vnl_work_ip = 0;
+    void *alpha = Vnl_workspace(pSPARC, ip_bytes + len);
+    p->Vnl_work_ip = ip_bytes;
+    memset(alpha, 0, ip_bytes);
+    return alpha;
+}
+
+
+
+/**
+ * @brief   Multiply the inner products by gamma_Jl.
+ */
+static void Vnl_scale_inner_product(const SPARC_OBJ *pSPARC, int ncol, double *alpha)
+{
+    int ityp, iat, n, l, np, m, ldispl, lmax, lloc, count = 0;
     for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
-        //int lloc = pSPARC->localPsd[ityp];
-        //lmax = pSPARC->psd[ityp].lmax;
-        if (! nlocProj[ityp].nproj) continue; // this is typical for hydrogen
-        for (iat = 0; iat < Atom_Influence_nloc[ityp].n_atom; iat++) {
-            ndc = Atom_Influence_nloc[ityp].ndc[iat]; 
-            x_rc = (double *)malloc( ndc * ncol * sizeof(double));
-            atom_index = Atom_Influence_nloc[ityp].atom_index[iat];
+        lloc = pSPARC->localPsd[ityp];
+        lmax = pSPARC->psd[ityp].lmax;
+        for (iat = 0; iat < pSPARC->nAtomv[ityp]; iat++) {
             for (n = 0; n < ncol; n++) {
-                for (i = 0; i < ndc; i++) {
-                    x_rc[n*ndc+i] = x[n*ldi + Atom_Influence_nloc[ityp].grid_pos[iat][i]];
+                ldispl = 0;
+                for (l = 0; l <= lmax; l++) {
+                    // skip the local l
+                    if (l == lloc) {
+                        ldispl += pSPARC->psd[ityp].ppl[l];
+                        continue;
+                    }
+                    for (np = 0; np < pSPARC->psd[ityp].ppl[l]; np++) {
+                        for (m = -l; m <= l; m++) {
+                            alpha[count++] *= pSPARC->psd[ityp].Gamma[ldispl+np];
+                        }
+                    }
+                    ldispl += pSPARC->psd[ityp].ppl[l];
                 }
             }
-            if (pSPARC->CyclixFlag) {
-                cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, nlocProj[ityp].nproj, ncol, ndc, 
-                    1.0, nlocProj[ityp].Chi_cyclix[iat], ndc, x_rc, ndc, 1.0, 
-                    alpha+pSPARC->IP_displ[atom_index]*ncol, nlocProj[ityp].nproj);
-            } else {
-                cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, nlocProj[ityp].nproj, ncol, ndc, 
-                    pSPARC->dV, nlocProj[ityp].Chi[iat], ndc, x_rc, ndc, 1.0, 
-                    alpha+pSPARC->IP_displ[atom_index]*ncol, nlocProj[ityp].nproj);          
-            }
-            free(x_rc);
         }
     }
+}
 
-    // if there are domain parallelization over each band, we need to sum over all processes over domain comm
-    int commsize;
-    MPI_Comm_size(comm, &commsize);
-    if (commsize > 1) {
-        MPI_Allreduce(MPI_IN_PLACE, alpha, pSPARC->IP_displ[pSPARC->n_atom] * ncol, MPI_DOUBLE, MPI_SUM, comm);
-    }
-    
-    // go over all atoms and multiply gamma_Jl to the inner product
-    count = 0;
+
+
+/**
+ * @brief   Multiply the inner products by gamma_Jl (complex inner products).
+ */
+static void Vnl_scale_inner_product_kpt(const SPARC_OBJ *pSPARC, int ncol, double _Complex *alpha)
+{
+    int ityp, iat, n, l, np, m, ldispl, lmax, lloc, count = 0;
     for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
-        int lloc = pSPARC->localPsd[ityp];
+        lloc = pSPARC->localPsd[ityp];
         lmax = pSPARC->psd[ityp].lmax;
         for (iat = 0; iat < pSPARC->nAtomv[ityp]; iat++) {
             for (n = 0; n < ncol; n++) {
@@ -861,139 +1030,451 @@ void Vnl_vec_mult(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *At
             }
         }
     }
+}
 
-    // multiply the inner product and the nonlocal projector
-    for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
-        if (! nlocProj[ityp].nproj) continue; // this is typical for hydrogen
-        for (iat = 0; iat < Atom_Influence_nloc[ityp].n_atom; iat++) {
-            ndc = Atom_Influence_nloc[ityp].ndc[iat]; 
-            atom_index = Atom_Influence_nloc[ityp].atom_index[iat];
-            Vnlx = (double *)malloc( ndc * ncol * sizeof(double));
-            cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, ndc, ncol, nlocProj[ityp].nproj, 1.0, nlocProj[ityp].Chi[iat], ndc, 
-                        alpha+pSPARC->IP_displ[atom_index]*ncol, nlocProj[ityp].nproj, 0.0, Vnlx, ndc); 
+
+
+/**
+ * @brief   Gather the vectors on the rc-domains of all images of one atom type, 
+ *          packed image after image, in one parallel region.
+ */
+static void Vnl_gather(const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, const size_t *displ, 
+    int ncol, const double *x, int ldi, double *x_rc, int nthreads)
+{
+    int n, i, iat;
+    int n_img = Atom_Influence_nloc->n_atom;
+    #pragma omp parallel for collapse(2) private(n, i, iat) schedule(static) if (nthreads > 1)
+    for (iat = 0; iat < n_img; iat++) {
+        for (n = 0; n < ncol; n++) {
+            int ndc = Atom_Influence_nloc->ndc[iat];
+            const int *grid_pos = Atom_Influence_nloc->grid_pos[iat];
+            const double *x_n = x + (size_t) n * ldi;
+            double *x_rc_n = x_rc + displ[iat] * ncol + (size_t) n * ndc;
+            #pragma omp simd
+            for (i = 0; i < ndc; i++) {
+                x_rc_n[i] = x_n[grid_pos[i]];
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Find the inner products of the projectors of one image with its 
+ *          gathered vectors, alpha_img = beta * alpha_img + Chi^T x_rc. 
+ */
+static void Vnl_image_inner_product(
+    const SPARC_OBJ *pSPARC, const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, const NLOC_PROJ_OBJ *nlocProj, 
+    int iat, int ncol, const double *x_rc, double beta, double *alpha_img)
+{
+    int ndc = Atom_Influence_nloc->ndc[iat];
+    if (pSPARC->CyclixFlag) {
+        cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, nlocProj->nproj, ncol, ndc, 
+            1.0, nlocProj->Chi_cyclix[iat], ndc, x_rc, ndc, beta, alpha_img, nlocProj->nproj);
+    } else {
+        cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, nlocProj->nproj, ncol, ndc, 
+            pSPARC->dV, nlocProj->Chi[iat], ndc, x_rc, ndc, beta, alpha_img, nlocProj->nproj);
+    }
+}
+
+
+
+/**
+ * @brief   Scatter the projections of all images of one atom type, packed image 
+ *          after image, back to the grid in one parallel region. Images of the 
+ *          same atom type may overlap, so for many columns the threads go over 
+ *          the columns and each thread adds all images, otherwise the threads 
+ *          split each image (grid_pos has no repeated entries within one image) 
+ *          and wait for each other before the next one.
+ */
+static void Vnl_scatter(const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, const size_t *displ, 
+    int ncol, const double *Vnlx, double *Hx, int ldo, int nthreads)
+{
+    int n, i, iat;
+    int n_img = Atom_Influence_nloc->n_atom;
+    if (ncol >= nthreads) {
+        #pragma omp parallel for private(n, i, iat) schedule(static) if (nthreads > 1)
+        for (n = 0; n < ncol; n++) {
+            double *Hx_n = Hx + (size_t) n * ldo;
+            for (iat = 0; iat < n_img; iat++) {
+                int ndc = Atom_Influence_nloc->ndc[iat];
+                const int *grid_pos = Atom_Influence_nloc->grid_pos[iat];
+                const double *Vnlx_n = Vnlx + displ[iat] * ncol + (size_t) n * ndc;
+                #pragma omp simd
+                for (i = 0; i < ndc; i++) {
+                    Hx_n[grid_pos[i]] += Vnlx_n[i];
+                }
+            }
+        }
+    } else {
+        #pragma omp parallel private(n, i, iat)
+        for (iat = 0; iat < n_img; iat++) {
+            int ndc = Atom_Influence_nloc->ndc[iat];
+            const int *grid_pos = Atom_Influence_nloc->grid_pos[iat];
+            const double *Vnlx_img = Vnlx + displ[iat] * ncol;
+            #pragma omp for collapse(2) schedule(static)
             for (n = 0; n < ncol; n++) {
                 for (i = 0; i < ndc; i++) {
-                    Hx[n*ldo + Atom_Influence_nloc[ityp].grid_pos[iat][i]] += Vnlx[n*ndc+i];
+                    Hx[(size_t) n * ldo + grid_pos[i]] += Vnlx_img[(size_t) n * ndc + i];
                 }
-            }     
-            free(Vnlx);
+            }
         }
     }
-    free(alpha);
 }
 
 
+
 /**
- * @brief   Calculate Vnl times vectors in a matrix-free way with Bloch factor
+ * @brief   Start the nonlocal operator: find the inner products of the projectors
+ *          with the vectors and start their reduction over the domain comm.
  */
-void Vnl_vec_mult_kpt(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
-                      NLOC_PROJ_OBJ *nlocProj, int ncol, double _Complex *x, int ldi, double _Complex *Hx, int ldo, int kpt, MPI_Comm comm)
+void Vnl_vec_mult_begin(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                        NLOC_PROJ_OBJ *nlocProj, int ncol, double *x, int ldi, double *alpha, 
+                        MPI_Request *request, MPI_Comm comm)
 {
-    int i, n, np, count;
-    /* compute nonlocal operator times vector(s) */
-    int ityp, iat, l, m, ldispl, lmax, ndc, atom_index;
-    double x0_i, y0_i, z0_i;
-    double _Complex *alpha, *x_rc, *Vnlx;
-    alpha = (double _Complex *) calloc( pSPARC->IP_displ[pSPARC->n_atom] * ncol, sizeof(double _Complex));
-    double Lx = pSPARC->range_x;
-    double Ly = pSPARC->range_y;
-    double Lz = pSPARC->range_z;
-    double k1 = pSPARC->k1_loc[kpt];
-    double k2 = pSPARC->k2_loc[kpt];
-    double k3 = pSPARC->k3_loc[kpt];
-    double theta;
-    double _Complex bloch_fac, a, b;
-    
+    int ityp, iat, j;
+    int nthreads = pSPARC->num_omp_threads;
+    timing_region_begin("Vnl_vec_mult");
+
+    size_t *displ;
+    double *work = (double *) Vnl_workspace_packed(pSPARC, Atom_Influence_nloc, nlocProj, ncol, sizeof(double), 1, &displ);
+
     //first find inner product
     for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
-        if (! nlocProj[ityp].nproj) continue; // this is typical for hydrogen
-        for (iat = 0; iat < Atom_Influence_nloc[ityp].n_atom; iat++) {
-            x0_i = Atom_Influence_nloc[ityp].coords[iat*3  ];
-            y0_i = Atom_Influence_nloc[ityp].coords[iat*3+1];
-            z0_i = Atom_Influence_nloc[ityp].coords[iat*3+2];
-            theta = -k1 * (floor(x0_i/Lx) * Lx) - k2 * (floor(y0_i/Ly) * Ly) - k3 * (floor(z0_i/Lz) * Lz);
-            bloch_fac = cos(theta) + sin(theta) * I;
-            if (pSPARC->CyclixFlag) {
-                a = bloch_fac;
-            } else {
-                a = bloch_fac * pSPARC->dV;
+        int nproj = nlocProj[ityp].nproj;
+        int n_img = Atom_Influence_nloc[ityp].n_atom;
+        if (! nproj || ! n_img) continue; // this is typical for hydrogen
+        Vnl_image_displ(&Atom_Influence_nloc[ityp], displ);
+        double *x_rc = work;
+        Vnl_gather(&Atom_Influence_nloc[ityp], displ, ncol, x, ldi, x_rc, nthreads);
+        // many small GEMMs are run concurrently, one image per thread, few large ones use threaded BLAS
+        if (nthreads > 1 && n_img >= nthreads) {
+            // images of the same atom are summed after the parallel loop
+            double *alpha_img = work + displ[n_img] * ncol;
+            #pragma omp parallel for private(iat) schedule(dynamic)
+            for (iat = 0; iat < n_img; iat++) {
+                Vnl_image_inner_product(pSPARC, &Atom_Influence_nloc[ityp], &nlocProj[ityp], iat, ncol, 
+                    x_rc + displ[iat] * ncol, 0.0, alpha_img + (size_t) iat * nproj * ncol);
             }
-            b = 1.0;
-            ndc = Atom_Influence_nloc[ityp].ndc[iat]; 
-            x_rc = (double _Complex *)malloc( ndc * ncol * sizeof(double _Complex));
-            atom_index = Atom_Influence_nloc[ityp].atom_index[iat];
-            for (n = 0; n < ncol; n++) {
-                for (i = 0; i < ndc; i++) {
-                    x_rc[n*ndc+i] = x[n*ldi + Atom_Influence_nloc[ityp].grid_pos[iat][i]];
-                }
+            for (iat = 0; iat < n_img; iat++) {
+                double *alpha_J = alpha + pSPARC->IP_displ[Atom_Influence_nloc[ityp].atom_index[iat]] * ncol;
+                const double *alpha_J_img = alpha_img + (size_t) iat * nproj * ncol;
+                for (j = 0; j < nproj * ncol; j++) alpha_J[j] += alpha_J_img[j];
+            }
+        } else {
+            for (iat = 0; iat < n_img; iat++) {
+                double *alpha_J = alpha + pSPARC->IP_displ[Atom_Influence_nloc[ityp].atom_index[iat]] * ncol;
+                Vnl_image_inner_product(pSPARC, &Atom_Influence_nloc[ityp], &nlocProj[ityp], iat, ncol, 
+                    x_rc + displ[iat] * ncol, 1.0, alpha_J);
             }
-            if (pSPARC->CyclixFlag) {
-                cblas_zgemm(CblasColMajor, CblasTrans, CblasNoTrans, nlocProj[ityp].nproj, ncol, ndc, 
-                    &a, nlocProj[ityp].Chi_c_cyclix[iat], ndc, x_rc, ndc, &b, 
-                    alpha+pSPARC->IP_displ[atom_index]*ncol, nlocProj[ityp].nproj);
-            } else {
-                cblas_zgemm(CblasColMajor, CblasTrans, CblasNoTrans, nlocProj[ityp].nproj, ncol, ndc, 
-                    &a, nlocProj[ityp].Chi_c[iat], ndc, x_rc, ndc, &b, 
-                    alpha+pSPARC->IP_displ[atom_index]*ncol, nlocProj[ityp].nproj);
-            }
-            free(x_rc);
         }
+        // inner product and projection back to the grid
+        timing_add_counts(0.0, 4.0 * displ[n_img] * nproj * ncol);
     }
 
     // if there are domain parallelization over each band, we need to sum over all processes over domain comm
+    *request = MPI_REQUEST_NULL;
     int commsize;
     MPI_Comm_size(comm, &commsize);
     if (commsize > 1) {
-        MPI_Allreduce(MPI_IN_PLACE, alpha, pSPARC->IP_displ[pSPARC->n_atom] * ncol, MPI_DOUBLE_COMPLEX, MPI_SUM, comm);
+        MPI_Iallreduce(MPI_IN_PLACE, alpha, pSPARC->IP_displ[pSPARC->n_atom] * ncol, MPI_DOUBLE, MPI_SUM, comm, request);
+        timing_add_counts(sizeof(double) * pSPARC->IP_displ[pSPARC->n_atom] * ncol, 0.0);
     }
-    
+    timing_region_end("Vnl_vec_mult");
+}
+
+
+
+/**
+ * @brief   Finish the nonlocal operator: wait for the inner products, and add
+ *          the projectors times the scaled inner products to Hx.
+ */
+void Vnl_vec_mult_end(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                      NLOC_PROJ_OBJ *nlocProj, int ncol, double *alpha, MPI_Request *request, double *Hx, int ldo)
+{
+    int ityp, iat;
+    int nthreads = pSPARC->num_omp_threads;
+    timing_region_begin("Vnl_vec_mult");
+    MPI_Wait(request, MPI_STATUS_IGNORE);
+
     // go over all atoms and multiply gamma_Jl to the inner product
-    count = 0;
+    Vnl_scale_inner_product(pSPARC, ncol, alpha);
+
+    size_t *displ;
+    double *Vnlx = (double *) Vnl_workspace_packed(pSPARC, Atom_Influence_nloc, nlocProj, ncol, sizeof(double), 0, &displ);
+
+    // multiply the inner product and the nonlocal projector
     for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
-        int lloc = pSPARC->localPsd[ityp];
-        lmax = pSPARC->psd[ityp].lmax;
-        for (iat = 0; iat < pSPARC->nAtomv[ityp]; iat++) {
+        int nproj = nlocProj[ityp].nproj;
+        int n_img = Atom_Influence_nloc[ityp].n_atom;
+        if (! nproj || ! n_img) continue; // this is typical for hydrogen
+        Vnl_image_displ(&Atom_Influence_nloc[ityp], displ);
+        if (nthreads > 1 && n_img >= nthreads) {
+            #pragma omp parallel for private(iat) schedule(dynamic)
+            for (iat = 0; iat < n_img; iat++) {
+                int ndc = Atom_Influence_nloc[ityp].ndc[iat];
+                int atom_index = Atom_Influence_nloc[ityp].atom_index[iat];
+                cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, ndc, ncol, nproj, 1.0, nlocProj[ityp].Chi[iat], ndc, 
+                            alpha+pSPARC->IP_displ[atom_index]*ncol, nproj, 0.0, Vnlx + displ[iat] * ncol, ndc); 
+            }
+        } else {
+            for (iat = 0; iat < n_img; iat++) {
+                int ndc = Atom_Influence_nloc[ityp].ndc[iat];
+                int atom_index = Atom_Influence_nloc[ityp].atom_index[iat];
+                cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, ndc, ncol, nproj, 1.0, nlocProj[ityp].Chi[iat], ndc, 
+                            alpha+pSPARC->IP_displ[atom_index]*ncol, nproj, 0.0, Vnlx + displ[iat] * ncol, ndc); 
+            }
+        }
+        Vnl_scatter(&Atom_Influence_nloc[ityp], displ, ncol, Vnlx, Hx, ldo, nthreads);
+    }
+    timing_region_end("Vnl_vec_mult");
+}
+
+
+
+/**
+ * @brief   Calculate Vnl times vectors in a matrix-free way.
+ */
+void Vnl_vec_mult(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                  NLOC_PROJ_OBJ *nlocProj, int ncol, double *x, int ldi, double *Hx, int ldo, MPI_Comm comm)
+{
+    MPI_Request request;
+    double *alpha = (double *) Vnl_inner_product_workspace(pSPARC, Atom_Influence_nloc, nlocProj, ncol, sizeof(double), 1);
+    Vnl_vec_mult_begin(pSPARC, DMnd, Atom_Influence_nloc, nlocProj, ncol, x, ldi, alpha, &request, comm);
+    Vnl_vec_mult_end(pSPARC, DMnd, Atom_Influence_nloc, nlocProj, ncol, alpha, &request, Hx, ldo);
+}
+
+
+
+/**
+ * @brief   Bloch factor of an image atom.
+ */
+static double _Complex Vnl_bloch_fac(const SPARC_OBJ *pSPARC, const double *coords, int kpt)
+{
+    double Lx = pSPARC->range_x;
+    double Ly = pSPARC->range_y;
+    double Lz = pSPARC->range_z;
+    double theta = -pSPARC->k1_loc[kpt] * (floor(coords[0]/Lx) * Lx) 
+                   -pSPARC->k2_loc[kpt] * (floor(coords[1]/Ly) * Ly) 
+                   -pSPARC->k3_loc[kpt] * (floor(coords[2]/Lz) * Lz);
+    return cos(theta) + sin(theta) * I;
+}
+
+
+
+/**
+ * @brief   Gather the vectors on the rc-domains of all images of one atom type 
+ *          (complex vectors).
+ */
+static void Vnl_gather_kpt(const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, const size_t *displ, 
+    int ncol, const double _Complex *x, int ldi, double _Complex *x_rc, int nthreads)
+{
+    int n, i, iat;
+    int n_img = Atom_Influence_nloc->n_atom;
+    #pragma omp parallel for collapse(2) private(n, i, iat) schedule(static) if (nthreads > 1)
+    for (iat = 0; iat < n_img; iat++) {
+        for (n = 0; n < ncol; n++) {
+            int ndc = Atom_Influence_nloc->ndc[iat];
+            const int *grid_pos = Atom_Influence_nloc->grid_pos[iat];
+            const double _Complex *x_n = x + (size_t) n * ldi;
+            double _Complex *x_rc_n = x_rc + displ[iat] * ncol + (size_t) n * ndc;
+            #pragma omp simd
+            for (i = 0; i < ndc; i++) {
+                x_rc_n[i] = x_n[grid_pos[i]];
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Find the inner products of the projectors of one image with its 
+ *          gathered vectors (with Bloch factor), 
+ *          alpha_img = beta * alpha_img + a * Chi^T x_rc. 
+ */
+static void Vnl_image_inner_product_kpt(
+    const SPARC_OBJ *pSPARC, const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, const NLOC_PROJ_OBJ *nlocProj, 
+    int iat, int ncol, int kpt, const double _Complex *x_rc, double _Complex beta, double _Complex *alpha_img)
+{
+    int ndc = Atom_Influence_nloc->ndc[iat];
+    double _Complex a, b = beta;
+    a = Vnl_bloch_fac(pSPARC, &Atom_Influence_nloc->coords[iat*3], kpt);
+    if (! pSPARC->CyclixFlag) a *= pSPARC->dV;
+    if (pSPARC->CyclixFlag) {
+        cblas_zgemm(CblasColMajor, CblasTrans, CblasNoTrans, nlocProj->nproj, ncol, ndc, 
+            &a, nlocProj->Chi_c_cyclix[iat], ndc, x_rc, ndc, &b, alpha_img, nlocProj->nproj);
+    } else {
+        cblas_zgemm(CblasColMajor, CblasTrans, CblasNoTrans, nlocProj->nproj, ncol, ndc, 
+            &a, nlocProj->Chi_c[iat], ndc, x_rc, ndc, &b, alpha_img, nlocProj->nproj);
+    }
+}
+
+
+
+/**
+ * @brief   Scatter the projections of all images of one atom type, packed image 
+ *          after image, back to the grid (complex vectors).
+ */
+static void Vnl_scatter_kpt(const ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, const size_t *displ, 
+    int ncol, const double _Complex *Vnlx, double _Complex *Hx, int ldo, int nthreads)
+{
+    int n, i, iat;
+    int n_img = Atom_Influence_nloc->n_atom;
+    if (ncol >= nthreads) {
+        #pragma omp parallel for private(n, i, iat) schedule(static) if (nthreads > 1)
+        for (n = 0; n < ncol; n++) {
+            double _Complex *Hx_n = Hx + (size_t) n * ldo;
+            for (iat = 0; iat < n_img; iat++) {
+                int ndc = Atom_Influence_nloc->ndc[iat];
+                const int *grid_pos = Atom_Influence_nloc->grid_pos[iat];
+                const double _Complex *Vnlx_n = Vnlx + displ[iat] * ncol + (size_t) n * ndc;
+                for (i = 0; i < ndc; i++) {
+                    Hx_n[grid_pos[i]] += Vnlx_n[i];
+                }
+            }
+        }
+    } else {
+        #pragma omp parallel private(n, i, iat)
+        for (iat = 0; iat < n_img; iat++) {
+            int ndc = Atom_Influence_nloc->ndc[iat];
+            const int *grid_pos = Atom_Influence_nloc->grid_pos[iat];
+            const double _Complex *Vnlx_img = Vnlx + displ[iat] * ncol;
+            #pragma omp for collapse(2) schedule(static)
             for (n = 0; n < ncol; n++) {
-                ldispl = 0;
-                for (l = 0; l <= lmax; l++) {
-                    // skip the local l
-                    if (l == lloc) {
-                        ldispl += pSPARC->psd[ityp].ppl[l];
-                        continue;
-                    }
-                    for (np = 0; np < pSPARC->psd[ityp].ppl[l]; np++) {
-                        for (m = -l; m <= l; m++) {
-                            alpha[count++] *= pSPARC->psd[ityp].Gamma[ldispl+np];
-                        }
-                    }
-                    ldispl += pSPARC->psd[ityp].ppl[l];
+                for (i = 0; i < ndc; i++) {
+                    Hx[(size_t) n * ldo + grid_pos[i]] += Vnlx_img[(size_t) n * ndc + i];
                 }
             }
         }
     }
-        
+}
+
+
+
+/**
+ * @brief   Start the nonlocal operator with Bloch factor: find the inner products 
+ *          and start their reduction over the domain comm.
+ */
+void Vnl_vec_mult_kpt_begin(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                            NLOC_PROJ_OBJ *nlocProj, int ncol, double _Complex *x, int ldi, int kpt, 
+                            double _Complex *alpha, MPI_Request *request, MPI_Comm comm)
+{
+    int ityp, iat, j;
+    int nthreads = pSPARC->num_omp_threads;
+    timing_region_begin("Vnl_vec_mult_kpt");
+
+    size_t *displ;
+    double _Complex *work = (double _Complex *) Vnl_workspace_packed(pSPARC, Atom_Influence_nloc, nlocProj, 
+        ncol, sizeof(double _Complex), 1, &displ);
+
+    //first find inner product
+    for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
+        int nproj = nlocProj[ityp].nproj;
+        int n_img = Atom_Influence_nloc[ityp].n_atom;
+        if (! nproj || ! n_img) continue; // this is typical for hydrogen
+        Vnl_image_displ(&Atom_Influence_nloc[ityp], displ);
+        double _Complex *x_rc = work;
+        Vnl_gather_kpt(&Atom_Influence_nloc[ityp], displ, ncol, x, ldi, x_rc, nthreads);
+        if (nthreads > 1 && n_img >= nthreads) {
+            // images of the same atom are summed after the parallel loop
+            double _Complex *alpha_img = work + displ[n_img] * ncol;
+            #pragma omp parallel for private(iat) schedule(dynamic)
+            for (iat = 0; iat < n_img; iat++) {
+                Vnl_image_inner_product_kpt(pSPARC, &Atom_Influence_nloc[ityp], &nlocProj[ityp], iat, ncol, kpt,
+                    x_rc + displ[iat] * ncol, 0.0, alpha_img + (size_t) iat * nproj * ncol);
+            }
+            for (iat = 0; iat < n_img; iat++) {
+                double _Complex *alpha_J = alpha + pSPARC->IP_displ[Atom_Influence_nloc[ityp].atom_index[iat]] * ncol;
+                const double _Complex *alpha_J_img = alpha_img + (size_t) iat * nproj * ncol;
+                for (j = 0; j < nproj * ncol; j++) alpha_J[j] += alpha_J_img[j];
+            }
+        } else {
+            for (iat = 0; iat < n_img; iat++) {
+                double _Complex *alpha_J = alpha + pSPARC->IP_displ[Atom_Influence_nloc[ityp].atom_index[iat]] * ncol;
+                Vnl_image_inner_product_kpt(pSPARC, &Atom_Influence_nloc[ityp], &nlocProj[ityp], iat, ncol, kpt,
+                    x_rc + displ[iat] * ncol, 1.0, alpha_J);
+            }
+        }
+        // inner product and projection back to the grid
+        timing_add_counts(0.0, 16.0 * displ[n_img] * nproj * ncol);
+    }
+
+    // if there are domain parallelization over each band, we need to sum over all processes over domain comm
+    *request = MPI_REQUEST_NULL;
+    int commsize;
+    MPI_Comm_size(comm, &commsize);
+    if (commsize > 1) {
+        MPI_Iallreduce(MPI_IN_PLACE, alpha, pSPARC->IP_displ[pSPARC->n_atom] * ncol, MPI_DOUBLE_COMPLEX, MPI_SUM, comm, request);
+        timing_add_counts(sizeof(double _Complex) * pSPARC->IP_displ[pSPARC->n_atom] * ncol, 0.0);
+    }
+    timing_region_end("Vnl_vec_mult_kpt");
+}
+
+
+
+/**
+ * @brief   Finish the nonlocal operator with Bloch factor.
+ */
+void Vnl_vec_mult_kpt_end(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                          NLOC_PROJ_OBJ *nlocProj, int ncol, int kpt, double _Complex *alpha, MPI_Request *request, 
+                          double _Complex *Hx, int ldo)
+{
+    int ityp, iat;
+    int nthreads = pSPARC->num_omp_threads;
+    timing_region_begin("Vnl_vec_mult_kpt");
+    MPI_Wait(request, MPI_STATUS_IGNORE);
+
+    // go over all atoms and multiply gamma_Jl to the inner product
+    Vnl_scale_inner_product_kpt(pSPARC, ncol, alpha);
+
+    size_t *displ;
+    double _Complex *Vnlx = (double _Complex *) Vnl_workspace_packed(pSPARC, Atom_Influence_nloc, nlocProj, 
+        ncol, sizeof(double _Complex), 0, &displ);
+
     // multiply the inner product and the nonlocal projector
     for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
-        if (! nlocProj[ityp].nproj) continue; // this is typical for hydrogen
-        for (iat = 0; iat < Atom_Influence_nloc[ityp].n_atom; iat++) {
-            x0_i = Atom_Influence_nloc[ityp].coords[iat*3  ];
-            y0_i = Atom_Influence_nloc[ityp].coords[iat*3+1];
-            z0_i = Atom_Influence_nloc[ityp].coords[iat*3+2];
-            theta = -k1 * (floor(x0_i/Lx) * Lx) - k2 * (floor(y0_i/Ly) * Ly) - k3 * (floor(z0_i/Lz) * Lz);
-            bloch_fac = cos(theta) - sin(theta) * I;
-            b = 0.0;
-            ndc = Atom_Influence_nloc[ityp].ndc[iat]; 
-            atom_index = Atom_Influence_nloc[ityp].atom_index[iat];
-            Vnlx = (double _Complex *)malloc( ndc * ncol * sizeof(double _Complex));
-            cblas_zgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, ndc, ncol, nlocProj[ityp].nproj, &bloch_fac, nlocProj[ityp].Chi_c[iat], ndc, 
-                          alpha+pSPARC->IP_displ[atom_index]*ncol, nlocProj[ityp].nproj, &b, Vnlx, ndc); 
-            for (n = 0; n < ncol; n++) {
-                for (i = 0; i < ndc; i++) {
-                    Hx[n*ldo + Atom_Influence_nloc[ityp].grid_pos[iat][i]] += Vnlx[n*ndc+i];
-                }
+        int nproj = nlocProj[ityp].nproj;
+        int n_img = Atom_Influence_nloc[ityp].n_atom;
+        if (! nproj || ! n_img) continue; // this is typical for hydrogen
+        Vnl_image_displ(&Atom_Influence_nloc[ityp], displ);
+        if (nthreads > 1 && n_img >= nthreads) {
+            #pragma omp parallel for private(iat) schedule(dynamic)
+            for (iat = 0; iat < n_img; iat++) {
+                int ndc = Atom_Influence_nloc[ityp].ndc[iat];
+                int atom_index = Atom_Influence_nloc[ityp].atom_index[iat];
+                double _Complex bloch_fac = conj(Vnl_bloch_fac(pSPARC, &Atom_Influence_nloc[ityp].coords[iat*3], kpt));
+                double _Complex b = 0.0;
+                cblas_zgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, ndc, ncol, nproj, &bloch_fac, nlocProj[ityp].Chi_c[iat], ndc, 
+                            alpha+pSPARC->IP_displ[atom_index]*ncol, nproj, &b, Vnlx + displ[iat] * ncol, ndc); 
+            }
+        } else {
+            for (iat = 0; iat < n_img; iat++) {
+                int ndc = Atom_Influence_nloc[ityp].ndc[iat];
+                int atom_index = Atom_Influence_nloc[ityp].atom_index[iat];
+                double _Complex bloch_fac = conj(Vnl_bloch_fac(pSPARC, &Atom_Influence_nloc[ityp].coords[iat*3], kpt));
+                double _Complex b = 0.0;
+                cblas_zgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, ndc, ncol, nproj, &bloch_fac, nlocProj[ityp].Chi_c[iat], ndc, 
+                            alpha+pSPARC->IP_displ[atom_index]*ncol, nproj, &b, Vnlx + displ[iat] * ncol, ndc); 
             }
-            free(Vnlx);
         }
+        Vnl_scatter_kpt(&Atom_Influence_nloc[ityp], displ, ncol, Vnlx, Hx, ldo, nthreads);
     }
-    free(alpha);
+    timing_region_end("Vnl_vec_mult_kpt");
+}
+
+
+
+/**
+ * @brief   Calculate Vnl times vectors in a matrix-free way with Bloch factor
+ */
+void Vnl_vec_mult_kpt(const SPARC_OBJ *pSPARC, int DMnd, ATOM_NLOC_INFLUENCE_OBJ *Atom_Influence_nloc, 
+                      NLOC_PROJ_OBJ *nlocProj, int ncol, double _Complex *x, int ldi, double _Complex *Hx, int ldo, int kpt, MPI_Comm comm)
+{
+    MPI_Request request;
+    double _Complex *alpha = (double _Complex *) Vnl_inner_product_workspace(pSPARC, Atom_Influence_nloc, nlocProj, 
+        ncol, sizeof(double _Complex), 1);
+    Vnl_vec_mult_kpt_begin(pSPARC, DMnd, Atom_Influence_nloc, nlocProj, ncol, x, ldi, kpt, alpha, &request, comm);
+    Vnl_vec_mult_kpt_end(pSPARC, DMnd, Atom_Influence_nloc, nlocProj, ncol, kpt, alpha, &request, Hx, ldo);
 }
@@ -15,10 +15,13 @@
 #include <math.h>
 #include <mpi.h>
 #include <string.h> 
-/* LAPACK, LAPACKE routines */
+#include <complex.h>
+#include <assert.h>
+/* BLAS, LAPACK, LAPACKE routines */
 #ifdef USE_MKL
     #include <mkl.h>
 #else
+    #include <cblas.h>
     #include <lapacke.h>
 #endif
 
@@ -28,14 +31,17 @@
 #include "electronDensity.h"
 #include "parallelization.h"
 #include "readfiles.h"
+#include "parallelIO.h"
 #define max(x,y) ((x)>(y)?(x):(y))
+#define min(x,y) ((x)<(y)?(x):(y))
 
 
 /**
- * @brief Read vector(s) from Cube file(s) and distribute in comm.
+ * @brief Read vector(s) from Cube (or binary) file(s) and distribute in comm.
+ *        The files are read collectively, see read_vec_par.
  * 
  * @param pSPARC 
- * @param filenames An array of n file names.
+ * @param filenames An array of n file names (only needed on rank 0 of comm).
  * @param data_dist The pointer to the final distributed vector.
  * @param n Number of files (also number of columns of data_dist).
  * @param DMverts Domain vertices of the local distributed domain.
@@ -46,55 +52,14 @@ void read_cube_and_dist_vec(
     int DMverts[6], MPI_Comm comm)
 {
     if (comm == MPI_COMM_NULL) return;
-    int rank;
-    MPI_Comm_rank(comm, &rank);
-
-    // initialize D2D for distributing the vectors from root to comm
-    MPI_Comm send_comm;
-    if (rank != 0) {
-        send_comm = MPI_COMM_NULL;
-    } else {
-        int dims[3] = {1,1,1}, periods[3] = {1,1,1};
-        // create a cartesian topology on one process (rank 0)
-        MPI_Cart_create(MPI_COMM_SELF, 3, dims, periods, 0, &send_comm);
-    }
-    int gridsizes[3];
-    gridsizes[0] = pSPARC->Nx;
-    gridsizes[1] = pSPARC->Ny;
-    gridsizes[2] = pSPARC->Nz;
-    int sdims[3], sVert[6], rdims[3], periods[3], coords[3];
-    sdims[0] = sdims[1] = sdims[2] = 1;
-    sVert[0] = 0; sVert[1] = gridsizes[0] - 1;
-    sVert[2] = 0; sVert[3] = gridsizes[1] - 1;
-    sVert[4] = 0; sVert[5] = gridsizes[2] - 1;
-
-    MPI_Cart_get(comm, 3, rdims, periods, coords);
-    D2D_OBJ d2d_sender, d2d_recvr;
-    Set_D2D_Target(&d2d_sender, &d2d_recvr, gridsizes, sVert, DMverts, send_comm, sdims, comm, rdims, comm);
-
     int DMnx = DMverts[1] - DMverts[0] + 1;
     int DMny = DMverts[3] - DMverts[2] + 1;
     int DMnz = DMverts[5] - DMverts[4] + 1;
     int DMnd = DMnx * DMny * DMnz;
 
-    double *vec_in = NULL;
     // loop over the n filenames
     for (int i = 0; i < n; i++) {
-        // let root process read the density from file
-        if (rank == 0) {
-            vec_in = read_vec_cube(pSPARC, filenames[i]);
-        }
-
-        // distribute the density from root to comm
-        D2D(&d2d_sender, &d2d_recvr, gridsizes, sVert, vec_in, DMverts, data_dist+i*DMnd, send_comm, sdims, comm, rdims, comm, sizeof(double));
-
-        if (rank == 0) free(vec_in);
-    }
-
-    Free_D2D_Target(&d2d_sender, &d2d_recvr, send_comm, comm);
-
-    if (rank == 0) {
-        MPI_Comm_free(&send_comm);
+        read_vec_par(pSPARC, filenames[i], data_dist+i*DMnd, DMverts, comm);
     }
 }
 
@@ -131,6 +96,8 @@ void Init_electronDensity(SPARC_OBJ *pSPARC) {
                     pSPARC, inputDensFnames, pSPARC->electronDens, nFileToRead,
                     pSPARC->DMVertices, pSPARC->dmcomm_phi
                 );
+            } else if (pSPARC->SCFRestartRead == 1) {
+                // electron density and magnetization have been read from the SCF restart file
             } else {
                 // TODO: implement restart based on previous MD electron density. Things to consider:
                 // 1) Each processor stores the density in its memory in a separate file at the end of MD (same frequency as the main restart file).
@@ -204,7 +171,7 @@ void Init_electronDensity(SPARC_OBJ *pSPARC) {
  * @ref   Ab initio molecular dynamics, a simple algorithm for charge extrapolation
  */
 // TODO: Check if the FtF matrix is singular and if it is then decide on how to do extrapolation or not to do at all
-void elecDensExtrapolation(SPARC_OBJ *pSPARC) {
+static void elecDensExtrapolation_phi(SPARC_OBJ *pSPARC, double *coeffs) {
 	// processors that are not in the dmcomm_phi will remain idle
     if (pSPARC->dmcomm_phi == MPI_COMM_NULL) {
         return; 
@@ -265,6 +232,9 @@ void elecDensExtrapolation(SPARC_OBJ *pSPARC) {
         LAPACKE_dgelsd(LAPACK_COL_MAJOR, 2, 2, 1, FtF, 2, Ftf, 2, s, -1.0, &matrank);
         alpha = Ftf[0];
         beta = Ftf[1];
+        coeffs[0] = alpha;
+        coeffs[1] = beta;
+        coeffs[2] = 1.0;
         // Extrapolation 
         for (nd = 0; nd < pSPARC->Nd_d; nd++)
             pSPARC->delectronDens[nd] = (1 + alpha) * pSPARC->delectronDens_0dt[nd] + (beta - alpha) * pSPARC->delectronDens_1dt[nd] - beta * pSPARC->delectronDens_2dt[nd];
@@ -280,6 +250,182 @@ void elecDensExtrapolation(SPARC_OBJ *pSPARC) {
 }
 
 
+/*
+ * @brief   Add coef * X * (X^H * X0) to W for one k-point and spin.
+ *
+ *          X, X0 and W are Nrow-by-Nband_bandcomm blocks with leading dimension ld.
+ *          The bands of X are distributed over blacscomm (band_displs gives the
+ *          first band of each process), so the blocks of X are passed around the
+ *          ring in blacscomm twice, first to form X^H * X0 and then to apply it.
+ */
+static void add_projected_orbitals(
+    SPARC_OBJ *pSPARC, int isComplex, void *X, void *X0, int ld, int Nrow,
+    double coef, void *W, int *band_displs)
+{
+    MPI_Comm blacscomm = pSPARC->blacscomm;
+    int nproc, rank, r, n, shift, pass;
+    MPI_Comm_size(blacscomm, &nproc);
+    MPI_Comm_rank(blacscomm, &rank);
+    int Ns = pSPARC->Nstates;
+    int Nb = pSPARC->Nband_bandcomm;
+    size_t unit_size = isComplex ? sizeof(double _Complex) : sizeof(double);
+    MPI_Datatype dtype = isComplex ? MPI_DOUBLE_COMPLEX : MPI_DOUBLE;
+    int rneighbor = (rank + 1) % nproc;
+    int lneighbor = (rank - 1 + nproc) % nproc;
+
+    int NB_max = 0;
+    for (r = 0; r < nproc; r++) NB_max = max(NB_max, band_displs[r+1] - band_displs[r]);
+
+    char *blk = (char *) malloc(unit_size * Nrow * NB_max);
+    char *blk_recv = (char *) malloc(unit_size * Nrow * NB_max);
+    char *S = (char *) calloc((size_t) Ns * Nb, unit_size); // X^H * X0, Ns x Nb
+    assert(blk != NULL && blk_recv != NULL && S != NULL);
+    double _Complex one = 1.0, zero = 0.0, zcoef = coef;
+    MPI_Request reqs[2];
+
+    for (pass = 0; pass < 2; pass++) {
+        for (n = 0; n < Nb; n++)
+            memcpy(blk + unit_size * Nrow * n, (char *) X + unit_size * ld * n, unit_size * Nrow);
+        for (shift = 0; shift < nproc; shift++) {
+            int src = (rank - shift + nproc) % nproc;        // owner of the block in blk
+            int src_next = (src - 1 + nproc) % nproc;         // owner of the next block
+            int nb = band_displs[src+1] - band_displs[src];
+            if (shift < nproc - 1) {
+                MPI_Irecv(blk_recv, Nrow * (band_displs[src_next+1] - band_displs[src_next]), dtype, 
+                          lneighbor, 112, blacscomm, &reqs[1]);
+                MPI_Isend(blk, Nrow * nb, dtype, rneighbor, 112, blacscomm, &reqs[0]);
+            }
+            char *S_src = S + unit_size * band_displs[src];
+            if (nb > 0 && pass == 0) {
+                if (isComplex)
+                    cblas_zgemm(CblasColMajor, CblasConjTrans, CblasNoTrans, nb, Nb, Nrow, 
+                                &one, blk, Nrow, X0, ld, &zero, S_src, Ns);
+                else
+                    cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, nb, Nb, Nrow, 
+                                1.0, (double *) blk, Nrow, (double *) X0, ld, 0.0, (double *) S_src, Ns);
+            } else if (nb > 0) {
+                if (isComplex)
+                    cblas_zgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, Nrow, Nb, nb, 
+                                &zcoef, blk, Nrow, S_src, Ns, &one, W, ld);
+                else
+                    cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, Nrow, Nb, nb, 
+                                coef, (double *) blk, Nrow, (double *) S_src, Ns, 1.0, (double *) W, ld);
+            }
+            if (shift < nproc - 1) {
+                MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+                char *tmp = blk; blk = blk_recv; blk_recv = tmp;
+            }
+        }
+        // sum over the domain
+        if (pass == 0)
+            MPI_Allreduce(MPI_IN_PLACE, S, Ns * Nb, dtype, MPI_SUM, pSPARC->dmcomm);
+    }
+
+    free(blk);
+    free(blk_recv);
+    free(S);
+}
+
+
+/*
+ * @brief   Extrapolate the Kohn-Sham orbitals to the new atomic positions.
+ *
+ *          With P_1 and P_2 the projectors onto the subspaces spanned by the orbitals
+ *          of the last two steps, the orbitals X_0 of the current step are replaced by
+ *              (1+alpha) X_0 + (beta-alpha) P_1 X_0 - beta P_2 X_0,
+ *          i.e. the density matrix is extrapolated with the coefficients of the
+ *          density extrapolation and applied to X_0. P_j X_0 is the previous subspace
+ *          aligned to X_0, so rotations among the orbitals between steps do not
+ *          enter. X_0 is then stored for the next step.
+ */
+static void orbitalExtrapolation(SPARC_OBJ *pSPARC, double alpha, double beta, int isFit)
+{
+    pSPARC->OrbExtrapStep = (isFit && pSPARC->OrbExtrapCount == 2);
+    if (pSPARC->dmcomm == MPI_COMM_NULL || pSPARC->bandcomm_index < 0) return;
+
+    int isComplex = (pSPARC->isGammaPoint != 1);
+    size_t unit_size = isComplex ? sizeof(double _Complex) : sizeof(double);
+    int DMnd = pSPARC->Nd_d_dmcomm;
+    int DMndsp = DMnd * pSPARC->Nspinor_spincomm;
+    int Nrow = DMnd * pSPARC->Nspinor_eig;
+    size_t size_k = (size_t) DMndsp * pSPARC->Nband_bandcomm;
+    size_t len_tot = size_k * pSPARC->Nkpts_kptcomm;
+    int k, spn_i;
+    size_t i;
+
+    char *X0 = isComplex ? (char *) pSPARC->Xorb_kpt : (char *) pSPARC->Xorb;
+    char *X1 = isComplex ? (char *) pSPARC->Xorb_kpt_1dt : (char *) pSPARC->Xorb_1dt;
+    char *X2 = isComplex ? (char *) pSPARC->Xorb_kpt_2dt : (char *) pSPARC->Xorb_2dt;
+
+    // W = (beta-alpha) P_1 X_0 - beta P_2 X_0
+    char *W = NULL;
+    if (isFit && pSPARC->OrbExtrapCount == 2) {
+        int nproc_blacscomm;
+        MPI_Comm_size(pSPARC->blacscomm, &nproc_blacscomm);
+        int *band_displs = (int *) malloc(sizeof(int) * (nproc_blacscomm + 1));
+        W = (char *) calloc(len_tot, unit_size);
+        assert(band_displs != NULL && W != NULL);
+        MPI_Allgather(&pSPARC->band_start_indx, 1, MPI_INT, band_displs, 1, MPI_INT, pSPARC->blacscomm);
+        band_displs[nproc_blacscomm] = pSPARC->Nstates;
+
+        for (k = 0; k < pSPARC->Nkpts_kptcomm; k++) {
+            for (spn_i = 0; spn_i < pSPARC->Nspin_spincomm; spn_i++) {
+                size_t shift = unit_size * (k * size_k + spn_i * DMnd);
+                add_projected_orbitals(pSPARC, isComplex, X1 + shift, X0 + shift, DMndsp, Nrow,
+                                       beta - alpha, W + shift, band_displs);
+                add_projected_orbitals(pSPARC, isComplex, X2 + shift, X0 + shift, DMndsp, Nrow,
+                                       -beta, W + shift, band_displs);
+            }
+        }
+        free(band_displs);
+    }
+
+    // shift the history, X_2 <- X_1 <- X_0
+    char *X_new = X2;
+    if (pSPARC->OrbExtrapCount < 2) {
+        X_new = (char *) malloc(len_tot * unit_size);
+        assert(X_new != NULL);
+    }
+    X2 = X1;
+    X1 = X_new;
+    memcpy(X1, X0, len_tot * unit_size);
+    pSPARC->OrbExtrapCount = min(pSPARC->OrbExtrapCount + 1, 2);
+    if (isComplex) {
+        pSPARC->Xorb_kpt_1dt = (double _Complex *) X1;
+        pSPARC->Xorb_kpt_2dt = (double _Complex *) X2;
+    } else {
+        pSPARC->Xorb_1dt = (double *) X1;
+        pSPARC->Xorb_2dt = (double *) X2;
+    }
+
+    if (W != NULL) {
+        if (isComplex) {
+            for (i = 0; i < len_tot; i++)
+                pSPARC->Xorb_kpt[i] = (1 + alpha) * pSPARC->Xorb_kpt[i] + ((double _Complex *) W)[i];
+        } else {
+            for (i = 0; i < len_tot; i++)
+                pSPARC->Xorb[i] = (1 + alpha) * pSPARC->Xorb[i] + ((double *) W)[i];
+        }
+        free(W);
+    }
+}
+
+
+/*
+ * @brief   Extrapolate the electron density, and the orbitals if ORBITAL_EXTRAPOLATION
+ *          is on, to provide a better initial guess for the next relax/MD step.
+ */
+void elecDensExtrapolation(SPARC_OBJ *pSPARC) {
+    // alpha, beta and 1 if they have been fitted
+    double coeffs[3] = {0.0, 0.0, 0.0};
+    elecDensExtrapolation_phi(pSPARC, coeffs);
+    if (pSPARC->OrbExtrapFlag == 1) {
+        MPI_Bcast(coeffs, 3, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        orbitalExtrapolation(pSPARC, coeffs[0], coeffs[1], coeffs[2] > 0.5);
+    }
+}
+
+
 /**
  * @brief   initialize Kohn-Sham orbitals.
  */
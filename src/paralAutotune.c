@@ -0,0 +1,398 @@
+/**
+ * @file    paralAutotune.c
+ * @brief   This file contains the measured-cost autotuner of the default
+ *          process grid.
+ *
+ *          dims_divide_skbd ranks the spin/k-point/band/domain layouts with a
+ *          model of the load balance and of the parallel efficiency. Here the
+ *          best few layouts of that model are timed on a probe that runs the
+ *          dominant kernels of an SCF step over the band and domain
+ *          distribution of each layout, and the fastest one is kept. The probe
+ *          is real-valued and uses stand-ins for the kernels that need the
+ *          setup of the chosen layout, see paral_autotune_probe_group. It only
+ *          times the orthogonal stencil, Setup_Comms turns the autotuner off for
+ *          the other cell types and for complex orbitals.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <assert.h>
+#include <mpi.h>
+/* BLAS routines */
+#ifdef USE_MKL
+    #include <mkl.h>
+#else
+    #include <cblas.h>
+#endif
+
+#include "paralAutotune.h"
+#include "parallelization.h"
+#include "lapVecRoutines.h"
+#include "tools.h"
+#include "timing.h"
+#include "isddft.h"
+
+#define min(x,y) ((x)<(y)?(x):(y))
+
+#define PARAL_AUTOTUNE_NKEY 11  // number of integers in the key of a cache entry
+
+typedef struct _PARAL_LAYOUT {
+    int nps, npk, npb;  // number of spin, k-point and band groups
+    int dims[3];        // domain decomposition
+    double eff;         // skbd_weighted_efficiency of the layout
+} PARAL_LAYOUT;
+
+
+
+/**
+ * @brief   Sort layouts by decreasing efficiency.
+ */
+static int layout_cmp(const void *a, const void *b)
+{
+    double ea = ((const PARAL_LAYOUT *) a)->eff, eb = ((const PARAL_LAYOUT *) b)->eff;
+    return (ea < eb) - (ea > eb);
+}
+
+
+
+/**
+ * @brief   Find the ncand layouts to be timed. cand[0] is the given layout,
+ *          the others use all processes and are the best ones according to
+ *          skbd_weighted_efficiency.
+ *
+ * @return  Number of layouts found, at most ncand.
+ */
+static int paral_autotune_candidates(SPARC_OBJ *pSPARC, int nproc, PARAL_LAYOUT *cand, int ncand)
+{
+    int gridsizes[3] = {pSPARC->Nx, pSPARC->Ny, pSPARC->Nz};
+    int minsize = pSPARC->order / 2;
+    int Nspin = pSPARC->Nspin, Nk = pSPARC->Nkpts_sym, Ns = pSPARC->Nstates;
+    int isfock = pSPARC->usefock;
+    int npd0 = cand[0].dims[0] * cand[0].dims[1] * cand[0].dims[2];
+
+    // all divisions of nproc into spin, k-point, band and domain groups
+    int nlist = 0, maxlist = 64;
+    PARAL_LAYOUT *list = (PARAL_LAYOUT *) malloc(maxlist * sizeof(PARAL_LAYOUT));
+    assert(list != NULL);
+    for (int nps = 1; nps <= min(Nspin, nproc); nps++) {
+        if (nproc % nps) continue;
+        for (int npk = 1; npk <= min(Nk, nproc / nps); npk++) {
+            if ((nproc / nps) % npk) continue;
+            for (int npb = 1; npb <= min(Ns, nproc / (nps * npk)); npb++) {
+                if ((nproc / (nps * npk)) % npb) continue;
+                int npd = nproc / (nps * npk * npb);
+                if (nps == cand[0].nps && npk == cand[0].npk && npb == cand[0].npb && npd == npd0) continue;
+                if (nlist == maxlist) {
+                    maxlist *= 2;
+                    list = (PARAL_LAYOUT *) realloc(list, maxlist * sizeof(PARAL_LAYOUT));
+                    assert(list != NULL);
+                }
+                list[nlist].nps = nps;
+                list[nlist].npk = npk;
+                list[nlist].npb = npb;
+                list[nlist].dims[0] = npd; // total, split into dims below
+                list[nlist].eff = skbd_weighted_efficiency(Nspin, Nk, Ns, gridsizes, nproc,
+                                                           nps, npk, npb, npd, isfock);
+                nlist++;
+            }
+        }
+    }
+    qsort(list, nlist, sizeof(PARAL_LAYOUT), layout_cmp);
+
+    int count = 1;
+    for (int i = 0; i < nlist && count < ncand; i++) {
+        int ierr, dims[3] = {0, 0, 0};
+        SPARC_Dims_create(list[i].dims[0], 3, gridsizes, minsize, dims, &ierr);
+        if (ierr) continue; // domain too small for this many processes
+        cand[count] = list[i];
+        cand[count].dims[0] = dims[0];
+        cand[count].dims[1] = dims[1];
+        cand[count].dims[2] = dims[2];
+        count++;
+    }
+    free(list);
+    return count;
+}
+
+
+
+/**
+ * @brief   Time the probe in one group of processes working on the same spin
+ *          and k-point, laid out as npb band groups of npd domain processes.
+ *
+ *          The real Project_Hamiltonian and Subspace_Rotation work on BLACS
+ *          contexts and orbital descriptors, and the nonlocal part of
+ *          Hamiltonian_vectors_mult on the influence of the atoms on the local
+ *          domain. All of these are set up from the layout that is being
+ *          chosen here, after Setup_Comms, so the probe uses stand-ins with the
+ *          same local work and communication per process:
+ *          - the stencil part is the real Lap_plus_diag_vec_mult_orth, with
+ *            the same halo exchange. The nonlocal part, a dot product and an
+ *            axpy per projector and band, grows like the stencil with the local
+ *            number of grid points and bands when the atoms are spread over
+ *            the cell, and would only add the same factor to each layout;
+ *          - the projection X' * Y and the rotation X * Q use a ring over the
+ *            band groups: each process multiplies its own band block with
+ *            the npb blocks of X in turn. This is the flop count and data
+ *            volume of pdgemm on the 1 x npband grid of the orbitals; the
+ *            redistribution to the block-cyclic grid of the subspace
+ *            eigensolver does not depend on the layout of the bands.
+ *
+ *          Only X and Y, the two blocks that exist during the SCF anyway,
+ *          are allocated; the ring passes X itself around, its content is
+ *          synthetic.
+ *
+ * @return  Time of one SCF step of the probe, ChebDegree applications of the
+ *          Hamiltonian, one projection and one rotation, best of the repetitions.
+ */
+static double paral_autotune_probe_group(SPARC_OBJ *pSPARC, const PARAL_LAYOUT *lay, MPI_Comm grpcomm)
+{
+    int rank_grp, rank_dmcomm, coords[3];
+    int npb = lay->npb;
+    int npd = lay->dims[0] * lay->dims[1] * lay->dims[2];
+    int dims[3] = {lay->dims[0], lay->dims[1], lay->dims[2]};
+    int periods[3] = {1 - pSPARC->BCx, 1 - pSPARC->BCy, 1 - pSPARC->BCz};
+    int gridsizes[3] = {pSPARC->Nx, pSPARC->Ny, pSPARC->Nz};
+    MPI_Comm bandcomm, dmcomm, blacscomm;
+
+    // same assignment of the processes as in Setup_Comms
+    MPI_Comm_rank(grpcomm, &rank_grp);
+    int bandcomm_index = rank_grp % npb;
+    MPI_Comm_split(grpcomm, bandcomm_index, 0, &bandcomm);
+    MPI_Cart_create(bandcomm, 3, dims, periods, 1, &dmcomm);
+    MPI_Comm_rank(dmcomm, &rank_dmcomm);
+    MPI_Cart_coords(dmcomm, rank_dmcomm, 3, coords);
+    // processes owning the same subdomain in different band groups
+    MPI_Comm_split(grpcomm, rank_dmcomm, bandcomm_index, &blacscomm);
+
+    int DMVertices[6], DMnd = 1;
+    for (int d = 0; d < 3; d++) {
+        int n = block_decompose(gridsizes[d], dims[d], coords[d]);
+        DMVertices[2*d] = block_decompose_nstart(gridsizes[d], dims[d], coords[d]);
+        DMVertices[2*d+1] = DMVertices[2*d] + n - 1;
+        DMnd *= n;
+    }
+    // the band group with the most bands dominates
+    int NB = ceil_div(pSPARC->Nstates, npb);
+    int len = DMnd * NB;
+
+    double *X  = (double *) malloc(len * sizeof(double));
+    double *Y  = (double *) malloc(len * sizeof(double));
+    double *v  = (double *) malloc(DMnd * sizeof(double));
+    double *Hp = (double *) malloc(NB * NB * npb * sizeof(double));
+    double *Q  = (double *) malloc(NB * NB * sizeof(double));
+    assert(X != NULL && Y != NULL && v != NULL && Hp != NULL && Q != NULL);
+    for (int i = 0; i < len; i++) X[i] = 0.5 - (double) ((i * 7919) % 1000) / 1000.0;
+    for (int i = 0; i < DMnd; i++) v[i] = -(double) (i % 97) / 97.0;
+    for (int i = 0; i < NB * NB; i++) Q[i] = (double) ((i * 31) % 101) / 101.0 / NB;
+
+    int left = (bandcomm_index + npb - 1) % npb;
+    int right = (bandcomm_index + 1) % npb;
+    double t_best = DBL_MAX;
+    // the first pass is a warm-up, it also sets up the halo exchange
+    for (int rep = 0; rep <= PARAL_AUTOTUNE_NREP; rep++) {
+        MPI_Barrier(grpcomm);
+        double t0 = MPI_Wtime();
+
+        // stencil part of Hamiltonian_vectors_mult
+        Lap_plus_diag_vec_mult_orth(pSPARC, DMnd, DMVertices, NB, -0.5, 1.0, 0.0, v,
+                                    X, DMnd, Y, DMnd, dmcomm, dims);
+        double t1 = MPI_Wtime();
+
+        // Project_Hamiltonian: Hp = X' * Y, the band blocks of X go around the band groups
+        for (int s = 0; s < npb; s++) {
+            int blk = (bandcomm_index + s) % npb;
+            cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, NB, NB, DMnd,
+                        1.0, X, DMnd, Y, DMnd, 0.0, Hp + blk * NB * NB, NB);
+            if (s < npb - 1)
+                MPI_Sendrecv_replace(X, len, MPI_DOUBLE, left, 0, right, 0, blacscomm, MPI_STATUS_IGNORE);
+        }
+        if (npd > 1)
+            MPI_Allreduce(MPI_IN_PLACE, Hp, NB * NB * npb, MPI_DOUBLE, MPI_SUM, dmcomm);
+
+        // Subspace_Rotation: Y = X * Q, with the same ring
+        for (int s = 0; s < npb; s++) {
+            cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, DMnd, NB, NB,
+                        1.0, X, DMnd, Q, NB, (s > 0) ? 1.0 : 0.0, Y, DMnd);
+            if (s < npb - 1)
+                MPI_Sendrecv_replace(X, len, MPI_DOUBLE, left, 0, right, 0, blacscomm, MPI_STATUS_IGNORE);
+        }
+        double t2 = MPI_Wtime();
+
+        double t = pSPARC->ChebDegree * (t1 - t0) + (t2 - t1);
+        if (rep > 0 && t < t_best) t_best = t;
+    }
+
+    free(X); free(Y); free(v); free(Hp); free(Q);
+    MPI_Comm_free(&blacscomm);
+    MPI_Comm_free(&dmcomm);
+    MPI_Comm_free(&bandcomm);
+    return t_best;
+}
+
+
+
+/**
+ * @brief   Time the probe for a layout, all spin and k-point groups run at the
+ *          same time.
+ *
+ * @return  Estimated time of one SCF step, the same on all processes.
+ */
+static double paral_autotune_probe(SPARC_OBJ *pSPARC, const PARAL_LAYOUT *lay)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    int size_grp = lay->npb * lay->dims[0] * lay->dims[1] * lay->dims[2];
+    int ngrp = lay->nps * lay->npk;
+
+    MPI_Comm grpcomm;
+    int color = (rank < ngrp * size_grp) ? rank / size_grp : MPI_UNDEFINED;
+    MPI_Comm_split(MPI_COMM_WORLD, color, 0, &grpcomm);
+    double t = 0.0;
+    if (grpcomm != MPI_COMM_NULL) {
+        t = paral_autotune_probe_group(pSPARC, lay, grpcomm);
+        MPI_Comm_free(&grpcomm);
+    }
+    // each group works through its spins and k-points one after the other
+    t *= ceil_div(pSPARC->Nspin, lay->nps) * ceil_div(pSPARC->Nkpts_sym, lay->npk);
+    MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    return t;
+}
+
+
+
+/**
+ * @brief   Look up a layout in the cache file, the last matching entry is used.
+ *
+ * @return  1 if found, 0 otherwise.
+ */
+static int paral_autotune_cache_read(const char *fname, const int *key, int nproc, PARAL_LAYOUT *lay)
+{
+    FILE *fp = fopen(fname, "r");
+    if (fp == NULL) return 0;
+    char line[512];
+    int found = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        int k[PARAL_AUTOTUNE_NKEY], l[6];
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d",
+                   k, k+1, k+2, k+3, k+4, k+5, k+6, k+7, k+8, k+9, k+10,
+                   l, l+1, l+2, l+3, l+4, l+5) != PARAL_AUTOTUNE_NKEY + 6) continue;
+        if (memcmp(k, key, sizeof(k))) continue;
+        if (l[0] < 1 || l[1] < 1 || l[2] < 1 || l[3] < 1 || l[4] < 1 || l[5] < 1 ||
+            l[0] * l[1] * l[2] * l[3] * l[4] * l[5] > nproc) continue;
+        lay->nps = l[0]; lay->npk = l[1]; lay->npb = l[2];
+        lay->dims[0] = l[3]; lay->dims[1] = l[4]; lay->dims[2] = l[5];
+        found = 1;
+    }
+    fclose(fp);
+    return found;
+}
+
+
+
+/**
+ * @brief   Append a layout to the cache file.
+ */
+static void paral_autotune_cache_write(const char *fname, const int *key, const PARAL_LAYOUT *lay, double t)
+{
+    FILE *fp = fopen(fname, "a");
+    if (fp == NULL) {
+        printf("WARNING: cannot write the autotuned parallelization to %s\n", fname);
+        return;
+    }
+    if (ftell(fp) == 0) {
+        fprintf(fp, "# Nx Ny Nz Nstates Nspin Nkpts isGamma usefock nproc nnode nthread"
+                    " : npspin npkpt npband npNdx npNdy npNdz time(s)\n");
+    }
+    for (int i = 0; i < PARAL_AUTOTUNE_NKEY; i++) fprintf(fp, "%d ", key[i]);
+    fprintf(fp, "  %d %d %d %d %d %d   %.4E\n", lay->nps, lay->npk, lay->npb,
+            lay->dims[0], lay->dims[1], lay->dims[2], t);
+    fclose(fp);
+}
+
+
+
+/**
+ * @brief   Choose npspin, npkpt, npband and npNdx/y/z by timing the layouts.
+ */
+void Paral_autotune(SPARC_OBJ *pSPARC)
+{
+    int nproc, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    // the kernels of the probe are reported under this region
+    timing_region_begin("Paral_autotune");
+
+    // number of nodes, one process per node has rank 0 in the shared memory comm
+    MPI_Comm shmcomm;
+    int rank_shm, nnode;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &shmcomm);
+    MPI_Comm_rank(shmcomm, &rank_shm);
+    nnode = (rank_shm == 0);
+    MPI_Allreduce(MPI_IN_PLACE, &nnode, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Comm_free(&shmcomm);
+
+    int key[PARAL_AUTOTUNE_NKEY] = {pSPARC->Nx, pSPARC->Ny, pSPARC->Nz, pSPARC->Nstates,
+        pSPARC->Nspin, pSPARC->Nkpts_sym, pSPARC->isGammaPoint, pSPARC->usefock,
+        nproc, nnode, pSPARC->num_omp_threads};
+    char path[L_STRING], fname[L_STRING];
+    extract_path_from_file(pSPARC->filename, path, L_STRING);
+    combine_path_filename(path, PARAL_AUTOTUNE_FNAME, fname, L_STRING);
+
+    PARAL_LAYOUT best;
+    int found = 0;
+    if (rank == 0) found = paral_autotune_cache_read(fname, key, nproc, &best);
+    MPI_Bcast(&found, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (found) {
+        MPI_Bcast(&best, 6, MPI_INT, 0, MPI_COMM_WORLD); // nps, npk, npb and dims
+        if (rank == 0) printf("Autotuned parallelization read from %s\n", fname);
+    } else {
+        int ncand = pSPARC->paral_autotune;
+        PARAL_LAYOUT *cand = (PARAL_LAYOUT *) malloc(ncand * sizeof(PARAL_LAYOUT));
+        assert(cand != NULL);
+        cand[0].nps = pSPARC->npspin;
+        cand[0].npk = pSPARC->npkpt;
+        cand[0].npb = pSPARC->npband;
+        cand[0].dims[0] = pSPARC->npNdx;
+        cand[0].dims[1] = pSPARC->npNdy;
+        cand[0].dims[2] = pSPARC->npNdz;
+        ncand = paral_autotune_candidates(pSPARC, nproc, cand, ncand);
+
+        double t_best = DBL_MAX;
+        for (int i = 0; i < ncand; i++) {
+            double t = paral_autotune_probe(pSPARC, cand + i);
+#ifdef DEBUG
+            if (rank == 0) printf("Autotune layout %d: npspin %d, npkpt %d, npband %d, npNd %d %d %d, %.3f ms\n",
+                                  i, cand[i].nps, cand[i].npk, cand[i].npb,
+                                  cand[i].dims[0], cand[i].dims[1], cand[i].dims[2], t*1e3);
+#endif
+            if (t < t_best) {
+                t_best = t;
+                best = cand[i];
+            }
+        }
+        free(cand);
+        if (rank == 0) {
+            printf("Autotuned parallelization: %d layouts timed\n", ncand);
+            paral_autotune_cache_write(fname, key, &best, t_best);
+        }
+    }
+
+    pSPARC->npspin = best.nps;
+    pSPARC->npkpt = best.npk;
+    pSPARC->npband = best.npb;
+    pSPARC->npNdx = best.dims[0];
+    pSPARC->npNdy = best.dims[1];
+    pSPARC->npNdz = best.dims[2];
+    timing_region_end("Paral_autotune");
+#ifdef DEBUG
+    if (rank == 0) printf("npspin = %d, npkpt = %d, npband = %d, npNd = %d %d %d\n",
+                          best.nps, best.npk, best.npb, best.dims[0], best.dims[1], best.dims[2]);
+#endif
+}
@@ -0,0 +1,514 @@
+/**
+ * @file    parallelIO.c
+ * @brief   This file contains the collective MPI-IO writers and readers of
+ *          distributed grid vectors (densities and Kohn-Sham orbitals).
+ *
+ *          Binary files are written and read directly from the subdomains
+ *          through subarray file views. Cube files are text with the values in
+ *          x-major order (z running fastest), so the vector is first moved to
+ *          slabs along x with D2D, then each process formats or parses its
+ *          chunk of the file. No process ever holds the whole grid.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <assert.h>
+#include <mpi.h>
+
+#include "parallelIO.h"
+#include "parallelization.h"
+#include "printing.h"
+#include "readfiles.h"
+#include "isddft.h"
+
+#define max(x,y) ((x)>(y)?(x):(y))
+#define min(x,y) ((x)<(y)?(x):(y))
+
+#define IO_CHUNK (1 << 30)    // largest number of bytes passed to one MPI-IO call
+#define CUBE_TOKEN_MAX 64     // upper bound on the length of a number in a cube file
+#define CUBE_VALUE_MAX 18     // upper bound on the length of "  %.6E" plus a newline
+
+
+
+/**
+ * @brief   Open a file collectively, abort if it cannot be opened.
+ */
+static void file_open(MPI_Comm comm, char *fname, int amode, MPI_File *fh)
+{
+    if (MPI_File_open(comm, fname, amode, MPI_INFO_NULL, fh) != MPI_SUCCESS) {
+        int rank;
+        MPI_Comm_rank(comm, &rank);
+        if (rank == 0) printf("\nCannot open file \"%s\"\n", fname);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+
+
+/**
+ * @brief   Collective write of len bytes at offset, split into calls of at most
+ *          IO_CHUNK bytes.
+ */
+static void file_write_at_all(MPI_File fh, MPI_Offset offset, char *buf, MPI_Offset len, MPI_Comm comm)
+{
+    MPI_Offset nchunk = (len + IO_CHUNK - 1) / IO_CHUNK, nchunk_max;
+    MPI_Allreduce(&nchunk, &nchunk_max, 1, MPI_OFFSET, MPI_MAX, comm);
+    for (MPI_Offset c = 0; c < nchunk_max; c++) {
+        MPI_Offset pos = min(c * IO_CHUNK, len);
+        int n = (int) min(len - pos, IO_CHUNK);
+        MPI_File_write_at_all(fh, offset + pos, buf + pos, n, MPI_CHAR, MPI_STATUS_IGNORE);
+    }
+}
+
+
+
+/**
+ * @brief   Collective read of len bytes at offset, split into calls of at most
+ *          IO_CHUNK bytes.
+ */
+static void file_read_at_all(MPI_File fh, MPI_Offset offset, char *buf, MPI_Offset len, MPI_Comm comm)
+{
+    MPI_Offset nchunk = (len + IO_CHUNK - 1) / IO_CHUNK, nchunk_max;
+    MPI_Allreduce(&nchunk, &nchunk_max, 1, MPI_OFFSET, MPI_MAX, comm);
+    for (MPI_Offset c = 0; c < nchunk_max; c++) {
+        MPI_Offset pos = min(c * IO_CHUNK, len);
+        int n = (int) min(len - pos, IO_CHUNK);
+        MPI_File_read_at_all(fh, offset + pos, buf + pos, n, MPI_CHAR, MPI_STATUS_IGNORE);
+    }
+}
+
+
+
+/**
+ * @brief   Create the file type of a subdomain of ncomp grid vectors stored one
+ *          after the other, each with x running fastest.
+ */
+static void subarray_type(int *gridsizes, int *DMVertices, int ncomp, MPI_Datatype type, MPI_Datatype *filetype)
+{
+    int sizes[4], subsizes[4], starts[4];
+    sizes[0] = ncomp; subsizes[0] = ncomp; starts[0] = 0;
+    for (int n = 0; n < 3; n++) {
+        sizes[3-n] = gridsizes[n];
+        subsizes[3-n] = DMVertices[2*n+1] - DMVertices[2*n] + 1;
+        starts[3-n] = DMVertices[2*n];
+    }
+    MPI_Type_create_subarray(4, sizes, subsizes, starts, MPI_ORDER_C, type, filetype);
+    MPI_Type_commit(filetype);
+}
+
+
+
+/**
+ * @brief   Create the decomposition of the grid into slabs along x over the first
+ *          min(nproc, Nx) processes of comm. slab_comm is MPI_COMM_NULL and the
+ *          slab is empty on the other processes.
+ */
+static void slab_create(MPI_Comm comm, int *gridsizes, MPI_Comm *slab_comm, int *slab_dims, int *slabVert)
+{
+    int nproc, periods[3] = {1,1,1};
+    MPI_Comm_size(comm, &nproc);
+    slab_dims[0] = min(nproc, gridsizes[0]);
+    slab_dims[1] = slab_dims[2] = 1;
+    // no reordering, the ranks of slab_comm are the first slab_dims[0] ranks of comm
+    MPI_Cart_create(comm, 3, slab_dims, periods, 0, slab_comm);
+    if (*slab_comm != MPI_COMM_NULL) {
+        int rank;
+        MPI_Comm_rank(*slab_comm, &rank);
+        slabVert[0] = block_decompose_nstart(gridsizes[0], slab_dims[0], rank);
+        slabVert[1] = slabVert[0] + block_decompose(gridsizes[0], slab_dims[0], rank) - 1;
+    } else {
+        slabVert[0] = 0; slabVert[1] = -1;
+    }
+    slabVert[2] = 0; slabVert[3] = gridsizes[1] - 1;
+    slabVert[4] = 0; slabVert[5] = gridsizes[2] - 1;
+}
+
+
+
+/**
+ * @brief   Move a vector from the subdomains of comm to the slabs (to_slab = 1)
+ *          or from the slabs to the subdomains (to_slab = 0).
+ */
+static void slab_redistribute(
+    int *gridsizes, MPI_Comm comm, int *DMVertices, double *x,
+    MPI_Comm slab_comm, int *slab_dims, int *slabVert, double *x_slab, int to_slab)
+{
+    int dims[3], periods[3], coords[3];
+    MPI_Cart_get(comm, 3, dims, periods, coords);
+    D2D_OBJ d2d_sender, d2d_recvr;
+    if (to_slab) {
+        Set_D2D_Target(&d2d_sender, &d2d_recvr, gridsizes, DMVertices, slabVert, comm,
+                       dims, slab_comm, slab_dims, comm);
+        D2D(&d2d_sender, &d2d_recvr, gridsizes, DMVertices, x, slabVert, x_slab, comm,
+            dims, slab_comm, slab_dims, comm, sizeof(double));
+        Free_D2D_Target(&d2d_sender, &d2d_recvr, comm, slab_comm);
+    } else {
+        Set_D2D_Target(&d2d_sender, &d2d_recvr, gridsizes, slabVert, DMVertices, slab_comm,
+                       slab_dims, comm, dims, comm);
+        D2D(&d2d_sender, &d2d_recvr, gridsizes, slabVert, x_slab, DMVertices, x, slab_comm,
+            slab_dims, comm, dims, comm, sizeof(double));
+        Free_D2D_Target(&d2d_sender, &d2d_recvr, slab_comm, comm);
+    }
+}
+
+
+
+/**
+ * @brief   Pack the header of a binary vector file.
+ */
+static void vec_header_pack(SPARC_OBJ *pSPARC, char *header)
+{
+    int info[4] = {1, pSPARC->Nx, pSPARC->Ny, pSPARC->Nz}; // version, Nx, Ny, Nz
+    double delta[3] = {pSPARC->delta_x, pSPARC->delta_y, pSPARC->delta_z};
+    double latvecs[9];
+    for (int n = 0; n < 3; n++) {
+        for (int m = 0; m < 3; m++)
+            latvecs[3*n+m] = info[n+1] * pSPARC->LatUVec[3*n+m] * delta[n];
+    }
+    memset(header, 0, SPARC_VEC_HEADER_SIZE);
+    memcpy(header, SPARC_VEC_MAGIC, 8);
+    memcpy(header + 8, info, sizeof(info));
+    memcpy(header + 24, latvecs, sizeof(latvecs));
+}
+
+
+
+/**
+ * @brief   Write a distributed vector into a text file in cube format.
+ */
+void write_vec_cube_par(SPARC_OBJ *pSPARC, double *x, int *DMVertices, MPI_Comm comm,
+                        char *fname, char *vecname)
+{
+    if (comm == MPI_COMM_NULL) return;
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    int gridsizes[3] = {pSPARC->Nx, pSPARC->Ny, pSPARC->Nz};
+    int Ny = gridsizes[1], Nz = gridsizes[2];
+
+    MPI_Comm slab_comm;
+    int slab_dims[3], slabVert[6];
+    slab_create(comm, gridsizes, &slab_comm, slab_dims, slabVert);
+    int nx = slabVert[1] - slabVert[0] + 1;
+    size_t nd_slab = (size_t) nx * Ny * Nz;
+    double *x_slab = (double *) malloc(max(nd_slab, 1) * sizeof(double));
+    assert(x_slab != NULL);
+    slab_redistribute(gridsizes, comm, DMVertices, x, slab_comm, slab_dims, slabVert, x_slab, 1);
+
+    // the header goes in front of the chunk of rank 0
+    char *header = NULL;
+    size_t len_header = 0;
+    if (rank == 0) {
+        header = format_cube_header(pSPARC, vecname);
+        len_header = strlen(header);
+    }
+    char *buf = (char *) malloc(len_header + nd_slab * CUBE_VALUE_MAX + (size_t) nx * Ny + 1);
+    assert(buf != NULL);
+    char *p = buf;
+    if (rank == 0) {
+        memcpy(p, header, len_header);
+        p += len_header;
+        free(header);
+    }
+    for (int i = 0; i < nx; i++) {
+        for (int j = 0; j < Ny; j++) {
+            for (int k = 0; k < Nz; k++) {
+                p += sprintf(p, "  %.6E", x_slab[i + j*nx + k*nx*Ny]);
+                if (k % 6 == 5) *p++ = '\n';
+            }
+            *p++ = '\n';
+        }
+    }
+    free(x_slab);
+
+    // the chunks are in the order of the ranks
+    MPI_Offset len = p - buf, offset = 0;
+    MPI_Exscan(&len, &offset, 1, MPI_OFFSET, MPI_SUM, comm);
+    if (rank == 0) offset = 0;
+
+    MPI_File fh;
+    file_open(comm, fname, MPI_MODE_CREATE | MPI_MODE_WRONLY, &fh);
+    MPI_File_set_size(fh, 0);
+    file_write_at_all(fh, offset, buf, len, comm);
+    MPI_File_close(&fh);
+
+    free(buf);
+    if (slab_comm != MPI_COMM_NULL) MPI_Comm_free(&slab_comm);
+}
+
+
+
+/**
+ * @brief   Write a distributed vector into a binary file.
+ */
+void write_vec_bin_par(SPARC_OBJ *pSPARC, double *x, int *DMVertices, MPI_Comm comm, char *fname)
+{
+    if (comm == MPI_COMM_NULL) return;
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    int gridsizes[3] = {pSPARC->Nx, pSPARC->Ny, pSPARC->Nz};
+    int DMnd = (DMVertices[1] - DMVertices[0] + 1) * (DMVertices[3] - DMVertices[2] + 1)
+             * (DMVertices[5] - DMVertices[4] + 1);
+
+    MPI_File fh;
+    file_open(comm, fname, MPI_MODE_CREATE | MPI_MODE_WRONLY, &fh);
+    MPI_File_set_size(fh, 0);
+    if (rank == 0) {
+        char header[SPARC_VEC_HEADER_SIZE];
+        vec_header_pack(pSPARC, header);
+        MPI_File_write_at(fh, 0, header, SPARC_VEC_HEADER_SIZE, MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+
+    MPI_Datatype filetype;
+    subarray_type(gridsizes, DMVertices, 1, MPI_DOUBLE, &filetype);
+    MPI_File_set_view(fh, SPARC_VEC_HEADER_SIZE, MPI_DOUBLE, filetype, "native", MPI_INFO_NULL);
+    MPI_File_write_all(fh, x, DMnd, MPI_DOUBLE, MPI_STATUS_IGNORE);
+    MPI_Type_free(&filetype);
+    MPI_File_close(&fh);
+}
+
+
+
+/**
+ * @brief   Write a distributed density-like vector in the format(s) selected by
+ *          PRINT_DENSITY_FORMAT.
+ */
+void write_dens_par(SPARC_OBJ *pSPARC, double *x, int *DMVertices, MPI_Comm comm,
+                    char *fname, char *vecname)
+{
+    if (comm == MPI_COMM_NULL) return;
+    if (pSPARC->PrintDensFormat != 1) {
+        write_vec_cube_par(pSPARC, x, DMVertices, comm, fname, vecname);
+    }
+    if (pSPARC->PrintDensFormat != 0) {
+        char fname_bin[L_STRING+4];
+        snprintf(fname_bin, sizeof(fname_bin), "%s.bin", fname);
+        write_vec_bin_par(pSPARC, x, DMVertices, comm, fname_bin);
+    }
+}
+
+
+
+/**
+ * @brief   Parse the values of a cube file collectively and distribute them.
+ *
+ *          Each process reads an equal share of the bytes after the header and
+ *          parses the numbers that start in it. The numbers are then moved to
+ *          the x-slabs (they are in x-major order in the file) and from there to
+ *          the subdomains.
+ */
+static void read_cube_values_par(
+    SPARC_OBJ *pSPARC, MPI_File fh, MPI_Offset data_start, char *fname,
+    double *x, int *DMVertices, MPI_Comm comm)
+{
+    int rank, nproc;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nproc);
+    int gridsizes[3] = {pSPARC->Nx, pSPARC->Ny, pSPARC->Nz};
+    int Nx = gridsizes[0], Ny = gridsizes[1], Nz = gridsizes[2];
+
+    MPI_Offset fsize;
+    MPI_File_get_size(fh, &fsize);
+    MPI_Offset L = fsize - data_start;
+    MPI_Offset a = data_start + L * rank / nproc;
+    MPI_Offset b = data_start + L * (rank + 1) / nproc;
+    // one byte before the share tells if a number starts at a, the tail holds the
+    // rest of the last number
+    MPI_Offset lo = max(a - 1, data_start), hi = min(b + CUBE_TOKEN_MAX, fsize);
+    char *buf = (char *) malloc(hi - lo + 1);
+    assert(buf != NULL);
+    file_read_at_all(fh, lo, buf, hi - lo, comm);
+    buf[hi - lo] = '\0';
+
+    // a number belongs to the process whose share holds its first character
+    int nval = 0;
+    double *val = (double *) malloc(((b - a) / 2 + 1) * sizeof(double));
+    assert(val != NULL);
+    for (MPI_Offset pos = a; pos < b; pos++) {
+        char *c = buf + (pos - lo);
+        if (isspace((unsigned char) *c)) continue;
+        if (pos > data_start && !isspace((unsigned char) c[-1])) continue;
+        val[nval++] = strtod(c, NULL);
+    }
+    free(buf);
+
+    int *nvals = (int *) malloc(nproc * sizeof(int));
+    int *val_start = (int *) malloc((nproc + 1) * sizeof(int));
+    assert(nvals != NULL && val_start != NULL);
+    MPI_Allgather(&nval, 1, MPI_INT, nvals, 1, MPI_INT, comm);
+    val_start[0] = 0;
+    for (int q = 0; q < nproc; q++) val_start[q+1] = val_start[q] + nvals[q];
+    if (val_start[nproc] != Nx * Ny * Nz) {
+        if (rank == 0)
+            printf("\n[FATAL] Incorrect CUBE file (%s): expected %d values, found %d!\n",
+                   fname, Nx * Ny * Nz, val_start[nproc]);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    MPI_Comm slab_comm;
+    int slab_dims[3], slabVert[6];
+    slab_create(comm, gridsizes, &slab_comm, slab_dims, slabVert);
+    int nx = slabVert[1] - slabVert[0] + 1;
+    int nd_slab = nx * Ny * Nz;
+
+    // the values of the slab of q are [slab_start[q], slab_start[q+1]) in the file
+    int *slab_start = (int *) malloc((nproc + 1) * sizeof(int));
+    int *scounts = (int *) malloc(nproc * sizeof(int));
+    int *sdispls = (int *) malloc(nproc * sizeof(int));
+    int *rcounts = (int *) malloc(nproc * sizeof(int));
+    int *rdispls = (int *) malloc(nproc * sizeof(int));
+    assert(slab_start != NULL && scounts != NULL && sdispls != NULL && rcounts != NULL && rdispls != NULL);
+    for (int q = 0; q <= nproc; q++) {
+        int xs = (q < slab_dims[0]) ? block_decompose_nstart(Nx, slab_dims[0], q) : Nx;
+        slab_start[q] = xs * Ny * Nz;
+    }
+    int s = val_start[rank], e = val_start[rank+1];
+    int ms = slab_start[rank], me = slab_start[rank+1];
+    for (int q = 0; q < nproc; q++) {
+        int lo_s = max(s, slab_start[q]), hi_s = min(e, slab_start[q+1]);
+        scounts[q] = max(hi_s - lo_s, 0);
+        sdispls[q] = max(lo_s - s, 0);
+        int lo_r = max(val_start[q], ms), hi_r = min(val_start[q+1], me);
+        rcounts[q] = max(hi_r - lo_r, 0);
+        rdispls[q] = max(lo_r - ms, 0);
+    }
+    double *val_slab = (double *) malloc(max(nd_slab, 1) * sizeof(double));
+    assert(val_slab != NULL);
+    MPI_Alltoallv(val, scounts, sdispls, MPI_DOUBLE, val_slab, rcounts, rdispls, MPI_DOUBLE, comm);
+    free(val);
+
+    // reorder the slab from z running fastest to x running fastest
+    double *x_slab = (double *) malloc(max(nd_slab, 1) * sizeof(double));
+    assert(x_slab != NULL);
+    for (int i = 0; i < nx; i++) {
+        for (int j = 0; j < Ny; j++) {
+            for (int k = 0; k < Nz; k++)
+                x_slab[i + j*nx + k*nx*Ny] = val_slab[(i*Ny + j)*Nz + k];
+        }
+    }
+    free(val_slab);
+
+    slab_redistribute(gridsizes, comm, DMVertices, x, slab_comm, slab_dims, slabVert, x_slab, 0);
+
+    free(x_slab);
+    free(nvals); free(val_start); free(slab_start);
+    free(scounts); free(sdispls); free(rcounts); free(rdispls);
+    if (slab_comm != MPI_COMM_NULL) MPI_Comm_free(&slab_comm);
+}
+
+
+
+/**
+ * @brief   Read a vector from a binary or cube file and distribute it over comm.
+ */
+void read_vec_par(SPARC_OBJ *pSPARC, char *fname, double *x, int *DMVertices, MPI_Comm comm)
+{
+    if (comm == MPI_COMM_NULL) return;
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    int gridsizes[3] = {pSPARC->Nx, pSPARC->Ny, pSPARC->Nz};
+
+    char filename[L_STRING+L_PSD];
+    if (rank == 0) snprintf(filename, L_STRING+L_PSD, "%s", fname);
+    MPI_Bcast(filename, L_STRING+L_PSD, MPI_CHAR, 0, comm);
+
+    // rank 0 reads and checks the header, info = {is_binary, data_start}
+    long long info[2] = {0, 0};
+    if (rank == 0) {
+        FILE *fp = fopen(filename, "rb");
+        if (fp == NULL) {
+            printf("Cannot open file \"%s\"\n", filename);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        int file_gridsizes[3];
+        double file_latvecs[9];
+        char header[SPARC_VEC_HEADER_SIZE];
+        if (fread(header, 1, SPARC_VEC_HEADER_SIZE, fp) == SPARC_VEC_HEADER_SIZE &&
+            memcmp(header, SPARC_VEC_MAGIC, 8) == 0) {
+            memcpy(file_gridsizes, header + 12, 3 * sizeof(int));
+            memcpy(file_latvecs, header + 24, 9 * sizeof(double));
+            info[0] = 1;
+            info[1] = SPARC_VEC_HEADER_SIZE;
+        } else {
+            rewind(fp);
+            readDens_cube_header(fp, file_gridsizes, file_latvecs);
+            info[1] = ftell(fp);
+        }
+        fclose(fp);
+
+        if (check_lattice(file_latvecs, pSPARC->LatVec, pSPARC->latvec_scale_x,
+            pSPARC->latvec_scale_y, pSPARC->latvec_scale_z, 1e-4) == 1) {
+            printf("\n[FATAL] Incorrect CUBE file (%s): inconsistent lattice vectors!\n", filename);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (file_gridsizes[0] != gridsizes[0] || file_gridsizes[1] != gridsizes[1] ||
+            file_gridsizes[2] != gridsizes[2]) {
+            printf("\n[FATAL] Incorrect CUBE file (%s): inconsistent grid sizes!\n", filename);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Bcast(info, 2, MPI_LONG_LONG, 0, comm);
+
+    MPI_File fh;
+    file_open(comm, filename, MPI_MODE_RDONLY, &fh);
+    if (info[0] == 1) {
+        int DMnd = (DMVertices[1] - DMVertices[0] + 1) * (DMVertices[3] - DMVertices[2] + 1)
+                 * (DMVertices[5] - DMVertices[4] + 1);
+        MPI_Datatype filetype;
+        subarray_type(gridsizes, DMVertices, 1, MPI_DOUBLE, &filetype);
+        MPI_File_set_view(fh, info[1], MPI_DOUBLE, filetype, "native", MPI_INFO_NULL);
+        MPI_File_read_all(fh, x, DMnd, MPI_DOUBLE, MPI_STATUS_IGNORE);
+        MPI_Type_free(&filetype);
+    } else {
+        read_cube_values_par(pSPARC, fh, info[1], filename, x, DMVertices, comm);
+    }
+    MPI_File_close(&fh);
+}
+
+
+
+/**
+ * @brief   Write one Kohn-Sham orbital record of a .psi file.
+ */
+void write_orbital_par(
+    void *x, int unit_size, int *gridsizes, int *DMVertices, double dV, int Nspinor,
+    MPI_File fh, MPI_Offset offset, int spin_index, int kpt_index, double *kpt_vec,
+    int band_index, MPI_Comm comm)
+{
+    if (comm == MPI_COMM_NULL) return;
+    assert(unit_size == sizeof(double) || unit_size == 2 * sizeof(double));
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    int DMnd = (DMVertices[1] - DMVertices[0] + 1) * (DMVertices[3] - DMVertices[2] + 1)
+             * (DMVertices[5] - DMVertices[4] + 1);
+
+    // scale psi to make it L2-norm = 1
+    int len = DMnd * Nspinor * (unit_size / sizeof(double));
+    double *x_scaled = (double *) malloc(len * sizeof(double));
+    assert(x_scaled != NULL);
+    double sqrt_dV = sqrt(dV);
+    for (int i = 0; i < len; i++) x_scaled[i] = ((double *) x)[i] / sqrt_dV;
+
+    // record header
+    MPI_File_set_view(fh, 0, MPI_BYTE, MPI_BYTE, "native", MPI_INFO_NULL);
+    if (rank == 0) {
+        char record[PSI_RECORD_HEADER_SIZE];
+        memcpy(record, &spin_index, sizeof(int));
+        memcpy(record + 4, &kpt_index, sizeof(int));
+        memcpy(record + 8, kpt_vec, 3 * sizeof(double));
+        memcpy(record + 32, &band_index, sizeof(int));
+        MPI_File_write_at(fh, offset, record, PSI_RECORD_HEADER_SIZE, MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+
+    MPI_Datatype type = (unit_size == sizeof(double)) ? MPI_DOUBLE : MPI_C_DOUBLE_COMPLEX;
+    MPI_Datatype filetype;
+    subarray_type(gridsizes, DMVertices, Nspinor, type, &filetype);
+    MPI_File_set_view(fh, offset + PSI_RECORD_HEADER_SIZE, type, filetype, "native", MPI_INFO_NULL);
+    MPI_File_write_all(fh, x_scaled, DMnd * Nspinor, type, MPI_STATUS_IGNORE);
+    MPI_Type_free(&filetype);
+    free(x_scaled);
+}
@@ -39,6 +39,7 @@
 #endif
 
 #include "parallelization.h"
+#include "paralAutotune.h"
 #include "tools.h"
 #include "isddft.h"
 #include "initialization.h"
@@ -81,6 +82,15 @@ void Setup_Comms(SPARC_OBJ *pSPARC) {
         pSPARC->npNdy = dims[1];
         pSPARC->npNdz = dims[2];
         pSPARC->useDefaultParalFlag = 1;
+        // replace the layout of the model by the fastest measured one. The probe
+        // times the real stencil of an orthogonal cell, it would not rank the
+        // layouts of non-orthogonal, Cyclix or complex (k-point, spinor) cases.
+        if (pSPARC->paral_autotune > 0 &&
+            (pSPARC->cell_typ != 0 || pSPARC->isGammaPoint == 0 || pSPARC->Nspinor > 1)) {
+            if (!rank) printf("WARNING: PARAL_AUTOTUNE only supports orthogonal cells with real orbitals (Gamma point, no spinors), it is turned off.\n");
+            pSPARC->paral_autotune = 0;
+        }
+        if (pSPARC->paral_autotune > 0) Paral_autotune(pSPARC);
     } else {
         if (!rank) printf("WARNING: Default parallelization not used. This could result in degradation of performance.\n");
         pSPARC->useDefaultParalFlag = 0;
@@ -756,6 +766,8 @@ void Setup_Comms(SPARC_OBJ *pSPARC) {
     // the subspace eigenproblem in serial
     // int MAX_NS = 2000;
     int MAX_NS = pSPARC->eig_serial_maxns;
+    // the CS mode only has a serial solver, which is much cheaper than the full one
+    if (pSPARC->CSFlag == 1) MAX_NS = max(MAX_NS, CS_SERIAL_MAXNS);
     pSPARC->useLAPACK = (pSPARC->Nstates <= MAX_NS) ? 1 : 0;
 
     int mbQ, nbQ, lldaQ;
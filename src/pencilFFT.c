@@ -0,0 +1,527 @@
+/**
+ * @file    pencilFFT.c
+ * @brief   This file contains the pencil-decomposed parallel 3D FFT with
+ *          persistent plans.
+ *
+ *          The input and output are in the block (domain) decomposition of a
+ *          Cartesian communicator, so no process ever holds a complete grid.
+ *          The forward transform goes through 3 transposes,
+ *              domain -> x-pencils -> y-pencils -> z-pencils,
+ *          each followed by batched 1D transforms along the pencil direction.
+ *          The x-pencils split the local y range among the processes of the
+ *          same (y,z) block, the y-pencils split x among the processes of the
+ *          same z block and the z-pencils split y among the processes of the
+ *          same x range, so every transpose only involves a subgroup of processes.
+ *          The subgroups are Cartesian sub-communicators of the plan, created
+ *          once with MPI_Cart_sub, and each transpose is one MPI_Alltoallv on
+ *          the sub-communicator of its stage.
+ *          All columns are transposed together and the 1D transforms of all
+ *          columns are done by one batched call. Buffers and 1D plans are kept
+ *          in the plan object and reused by every call.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <mpi.h>
+#include <complex.h>
+#ifdef USE_MKL
+    #define MKL_Complex16 double _Complex
+    #include <mkl.h>
+#endif
+#ifdef USE_FFTW
+    #include <fftw3.h>
+#endif
+
+#include "pencilFFT.h"
+#include "parallelization.h"
+#include "isddft.h"
+
+#define max(a,b) ((a)>(b)?(a):(b))
+#define min(a,b) ((a)<(b)?(a):(b))
+
+// data layouts
+#define PFFT_DM 0   // domain decomposition
+#define PFFT_XR 1   // x-pencils in real space (N[0] points in x)
+#define PFFT_XF 2   // x-pencils in frequency space (Nxf points in x)
+#define PFFT_Y  3   // y-pencils
+#define PFFT_Z  4   // z-pencils
+
+
+/**
+ * @brief   Local box (start and size in x, y, z) of a layout on process p.
+ */
+static void pencil_box(const PENCIL_FFT_OBJ *plan, int layout, int p, int *box) {
+    const int *src;
+    switch (layout) {
+        case PFFT_DM: src = plan->dm_box; break;
+        case PFFT_Y:  src = plan->yp_box; break;
+        case PFFT_Z:  src = plan->zp_box; break;
+        default:      src = plan->xp_box; break;
+    }
+    memcpy(box, src + 6*p, 6 * sizeof(int));
+    if (layout == PFFT_XF) box[1] = plan->Nxf;
+}
+
+
+/**
+ * @brief   Strides of x, y, z in the local storage of a layout.
+ *
+ *          The direction of the pencil always runs fastest so that the 1D
+ *          transforms are done on contiguous data.
+ */
+static void pencil_strides(int layout, const int *box, int *st) {
+    int nx = box[1], ny = box[3], nz = box[5];
+    if (layout == PFFT_Y) {
+        st[0] = ny; st[1] = 1; st[2] = nx * ny;
+    } else if (layout == PFFT_Z) {
+        st[0] = nz; st[1] = nx * nz; st[2] = 1;
+    } else {
+        st[0] = 1; st[1] = nx; st[2] = nx * ny;
+    }
+}
+
+
+/**
+ * @brief   Intersection of two boxes, returns the number of grid points in it.
+ */
+static int box_intersect(const int *a, const int *b, int *c) {
+    int d, s, e, nd = 1;
+    for (d = 0; d < 3; d++) {
+        s = max(a[2*d], b[2*d]);
+        e = min(a[2*d] + a[2*d+1], b[2*d] + b[2*d+1]);
+        c[2*d] = s;
+        c[2*d+1] = max(e - s, 0);
+        nd *= c[2*d+1];
+    }
+    return nd;
+}
+
+
+/**
+ * @brief   Copy the sub-box of ncol columns between the local storage x and a
+ *          contiguous buffer (z, y, x order). pack = 1 copies x to buf.
+ *
+ * @param esz   Number of doubles per grid point (1 for real, 2 for complex).
+ */
+static void pencil_copy_box(double *x, const int *box, const int *st, int nd, const int *sub,
+                            int esz, int ncol, double *buf, int pack)
+{
+    int n, i, j, k, e, idx, base;
+    size_t count = 0;
+    for (n = 0; n < ncol; n++) {
+        double *xn = x + (size_t) n * nd * esz;
+        for (k = sub[4]; k < sub[4] + sub[5]; k++) {
+            for (j = sub[2]; j < sub[2] + sub[3]; j++) {
+                base = (j - box[2]) * st[1] + (k - box[4]) * st[2];
+                for (i = sub[0]; i < sub[0] + sub[1]; i++) {
+                    idx = (base + (i - box[0]) * st[0]) * esz;
+                    if (pack) {
+                        for (e = 0; e < esz; e++) buf[count++] = xn[idx+e];
+                    } else {
+                        for (e = 0; e < esz; e++) xn[idx+e] = buf[count++];
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief   Transpose ncol columns from one layout to another.
+ *
+ *          stage 0: domain <-> x-pencils, stage 1: x-pencils <-> y-pencils,
+ *          stage 2: y-pencils <-> z-pencils.
+ */
+static void pencil_transpose(PENCIL_FFT_OBJ *plan, int stage, int forward, double *src, double *dst, int ncol)
+{
+    static const int lay_a[3] = {PFFT_DM, PFFT_XF, PFFT_Y};
+    static const int lay_b[3] = {PFFT_XR, PFFT_Y, PFFT_Z};
+    int s, p, nd_src, nd_dst, lrank, nsub = plan->sub_nproc[stage];
+    const int *ranks = plan->sub_ranks[stage];
+    int lsrc = forward ? lay_a[stage] : lay_b[stage];
+    int ldst = forward ? lay_b[stage] : lay_a[stage];
+    int esz = (stage == 0 && !plan->is_complex) ? 1 : 2;
+    int box_src[6], box_dst[6], st_src[3], st_dst[3], box_p[6], sub[6];
+    double *recvbuf;
+
+    MPI_Comm_rank(plan->comm, &lrank);
+    pencil_box(plan, lsrc, lrank, box_src);
+    pencil_box(plan, ldst, lrank, box_dst);
+    pencil_strides(lsrc, box_src, st_src);
+    pencil_strides(ldst, box_dst, st_dst);
+    nd_src = box_src[1] * box_src[3] * box_src[5];
+    nd_dst = box_dst[1] * box_dst[3] * box_dst[5];
+
+    // pack the data going to each process of the sub-communicator
+    plan->sdispls[0] = 0;
+    for (s = 0; s < nsub; s++) {
+        p = ranks[s];
+        pencil_box(plan, ldst, p, box_p);
+        plan->sendcounts[s] = box_intersect(box_src, box_p, sub) * ncol * esz;
+        if (s < nsub - 1) plan->sdispls[s+1] = plan->sdispls[s] + plan->sendcounts[s];
+        if (plan->sendcounts[s])
+            pencil_copy_box(src, box_src, st_src, nd_src, sub, esz, ncol, plan->sendbuf + plan->sdispls[s], 1);
+    }
+
+    plan->rdispls[0] = 0;
+    for (s = 0; s < nsub; s++) {
+        p = ranks[s];
+        pencil_box(plan, lsrc, p, box_p);
+        plan->recvcounts[s] = box_intersect(box_p, box_dst, sub) * ncol * esz;
+        if (s < nsub - 1) plan->rdispls[s+1] = plan->rdispls[s] + plan->recvcounts[s];
+    }
+
+    if (nsub > 1) {
+        MPI_Alltoallv(plan->sendbuf, plan->sendcounts, plan->sdispls, MPI_DOUBLE,
+                      plan->recvbuf, plan->recvcounts, plan->rdispls, MPI_DOUBLE, plan->sub_comm[stage]);
+        recvbuf = plan->recvbuf;
+    } else {
+        recvbuf = plan->sendbuf;
+    }
+
+    // unpack the data received from each process
+    for (s = 0; s < nsub; s++) {
+        if (!plan->recvcounts[s]) continue;
+        pencil_box(plan, lsrc, ranks[s], box_p);
+        box_intersect(box_p, box_dst, sub);
+        pencil_copy_box(dst, box_dst, st_dst, nd_dst, sub, esz, ncol, recvbuf + plan->rdispls[s], 0);
+    }
+}
+
+
+/**
+ * @brief   Number of local 1D transforms along direction d for one column.
+ */
+static int pencil_lines(const PENCIL_FFT_OBJ *plan, int d) {
+    int lrank;
+    const int *box;
+    MPI_Comm_rank(plan->comm, &lrank);
+    if (d == 0) {
+        box = plan->xp_box + 6*lrank;
+        return box[3] * box[5];
+    } else if (d == 1) {
+        box = plan->yp_box + 6*lrank;
+        return box[1] * box[5];
+    } else {
+        box = plan->zp_box + 6*lrank;
+        return box[1] * box[3];
+    }
+}
+
+
+/**
+ * @brief   Create a batched 1D transform along direction d.
+ */
+static void *pencil_plan_1d(PENCIL_FFT_OBJ *plan, int d, int forward, int howmany)
+{
+    if (howmany == 0) return NULL;
+#if defined(USE_MKL) || defined(USE_FFTW)
+    int n = plan->N[d];
+    int is_real = (d == 0 && !plan->is_complex);
+    int nf = is_real ? plan->Nxf : n;
+#endif
+#if defined(USE_MKL)
+    DFTI_DESCRIPTOR_HANDLE desc = NULL;
+    MKL_LONG status;
+    status = DftiCreateDescriptor(&desc, DFTI_DOUBLE, is_real ? DFTI_REAL : DFTI_COMPLEX, 1, (MKL_LONG) n);
+    if (is_real)
+        status = DftiSetValue(desc, DFTI_CONJUGATE_EVEN_STORAGE, DFTI_COMPLEX_COMPLEX);
+    status = DftiSetValue(desc, DFTI_PLACEMENT, DFTI_NOT_INPLACE);
+    status = DftiSetValue(desc, DFTI_NUMBER_OF_TRANSFORMS, (MKL_LONG) howmany);
+    status = DftiSetValue(desc, DFTI_INPUT_DISTANCE, (MKL_LONG) (forward ? n : nf));
+    status = DftiSetValue(desc, DFTI_OUTPUT_DISTANCE, (MKL_LONG) (forward ? nf : n));
+    status = DftiCommitDescriptor(desc);
+    if (status && !DftiErrorClass(status, DFTI_NO_ERROR)) {
+        printf("Error: %s\n", DftiErrorMessage(status));
+    }
+    return (void *) desc;
+#elif defined(USE_FFTW)
+    fftw_plan p;
+    unsigned flags = FFTW_ESTIMATE | FFTW_UNALIGNED;
+    if (is_real && forward) {
+        p = fftw_plan_many_dft_r2c(1, &n, howmany, plan->work1, NULL, 1, n,
+                                   (fftw_complex *) plan->work2, NULL, 1, nf, flags);
+    } else if (is_real) {
+        p = fftw_plan_many_dft_c2r(1, &n, howmany, (fftw_complex *) plan->work2, NULL, 1, nf,
+                                   plan->work1, NULL, 1, n, flags);
+    } else {
+        p = fftw_plan_many_dft(1, &n, howmany, (fftw_complex *) plan->work1, NULL, 1, n,
+                               (fftw_complex *) plan->work2, NULL, 1, n,
+                               forward ? FFTW_FORWARD : FFTW_BACKWARD, flags);
+    }
+    return (void *) p;
+#else
+    return NULL;
+#endif
+}
+
+
+/**
+ * @brief   Execute a batched 1D transform.
+ */
+static void pencil_execute_1d(void *p, int is_real, int forward, double *in, double *out)
+{
+#if defined(USE_MKL)
+    MKL_LONG status;
+    if (forward)
+        status = DftiComputeForward((DFTI_DESCRIPTOR_HANDLE) p, in, out);
+    else
+        status = DftiComputeBackward((DFTI_DESCRIPTOR_HANDLE) p, in, out);
+    if (status && !DftiErrorClass(status, DFTI_NO_ERROR)) {
+        printf("Error: %s\n", DftiErrorMessage(status));
+    }
+#elif defined(USE_FFTW)
+    if (is_real && forward)
+        fftw_execute_dft_r2c((fftw_plan) p, in, (fftw_complex *) out);
+    else if (is_real)
+        fftw_execute_dft_c2r((fftw_plan) p, (fftw_complex *) in, out);
+    else
+        fftw_execute_dft((fftw_plan) p, (fftw_complex *) in, (fftw_complex *) out);
+#endif
+}
+
+
+/**
+ * @brief   Free a batched 1D transform.
+ */
+static void pencil_destroy_1d(void *p)
+{
+    if (p == NULL) return;
+#if defined(USE_MKL)
+    DFTI_DESCRIPTOR_HANDLE desc = (DFTI_DESCRIPTOR_HANDLE) p;
+    DftiFreeDescriptor(&desc);
+#elif defined(USE_FFTW)
+    fftw_destroy_plan((fftw_plan) p);
+#endif
+}
+
+
+/**
+ * @brief   1D transforms along direction d for ncol columns.
+ *
+ *          Columns are processed ncol_max at a time with the batched plan, the
+ *          remaining ones with the single column plan.
+ */
+static void pencil_fft_1d(PENCIL_FFT_OBJ *plan, int d, int forward, double *in, double *out, int ncol)
+{
+    int c, nb, lines = pencil_lines(plan, d);
+    if (lines == 0) return;
+    int is_real = (d == 0 && !plan->is_complex);
+    int nf = is_real ? plan->Nxf : plan->N[d];
+    // number of doubles per column in the real/complex space
+    size_t len_r = (size_t) lines * plan->N[d] * (is_real ? 1 : 2);
+    size_t len_f = (size_t) lines * nf * 2;
+    size_t len_in = forward ? len_r : len_f;
+    size_t len_out = forward ? len_f : len_r;
+    void **plan_b = forward ? plan->fwd_plan : plan->bwd_plan;
+    void **plan_1 = forward ? plan->fwd_plan1 : plan->bwd_plan1;
+
+    nb = ncol / plan->ncol_max;
+    for (c = 0; c < nb; c++) {
+        pencil_execute_1d(plan_b[d], is_real, forward,
+            in + c * plan->ncol_max * len_in, out + c * plan->ncol_max * len_out);
+    }
+    for (c = nb * plan->ncol_max; c < ncol; c++) {
+        pencil_execute_1d(plan_1[d], is_real, forward, in + c * len_in, out + c * len_out);
+    }
+}
+
+
+/**
+ * @brief   Free buffers and 1D plans of the batch.
+ */
+static void pencil_free_batch(PENCIL_FFT_OBJ *plan)
+{
+    int d;
+    for (d = 0; d < 3; d++) {
+        pencil_destroy_1d(plan->fwd_plan[d]);
+        pencil_destroy_1d(plan->bwd_plan[d]);
+        pencil_destroy_1d(plan->fwd_plan1[d]);
+        pencil_destroy_1d(plan->bwd_plan1[d]);
+        plan->fwd_plan[d] = plan->bwd_plan[d] = plan->fwd_plan1[d] = plan->bwd_plan1[d] = NULL;
+    }
+    free(plan->sendbuf);
+    free(plan->recvbuf);
+    free(plan->work1);
+    free(plan->work2);
+    plan->sendbuf = plan->recvbuf = plan->work1 = plan->work2 = NULL;
+    plan->ncol_max = 0;
+}
+
+
+/**
+ * @brief   Allocate buffers and create 1D plans for ncol columns.
+ */
+static void pencil_setup_batch(PENCIL_FFT_OBJ *plan, int ncol)
+{
+    int d, lines;
+    size_t len;
+    pencil_free_batch(plan);
+    plan->ncol_max = max(ncol, 1);
+    len = (size_t) 2 * plan->nd_max * plan->ncol_max;
+    plan->sendbuf = (double *) malloc(len * sizeof(double));
+    plan->recvbuf = (double *) malloc(len * sizeof(double));
+    plan->work1 = (double *) malloc(len * sizeof(double));
+    plan->work2 = (double *) malloc(len * sizeof(double));
+    assert(plan->sendbuf != NULL && plan->recvbuf != NULL &&
+           plan->work1 != NULL && plan->work2 != NULL);
+
+    for (d = 0; d < 3; d++) {
+        lines = pencil_lines(plan, d);
+        plan->fwd_plan[d] = pencil_plan_1d(plan, d, 1, lines * plan->ncol_max);
+        plan->bwd_plan[d] = pencil_plan_1d(plan, d, 0, lines * plan->ncol_max);
+        plan->fwd_plan1[d] = pencil_plan_1d(plan, d, 1, lines);
+        plan->bwd_plan1[d] = pencil_plan_1d(plan, d, 0, lines);
+    }
+}
+
+
+/**
+ * @brief   Create a persistent parallel FFT plan on a Cartesian communicator.
+ */
+void Pencil_FFT_init(PENCIL_FFT_OBJ *plan, const int *gridsizes, int is_complex, int ncol, MPI_Comm comm)
+{
+    // processes exchanging data in each transpose: x lines, xy planes, z lines of the process grid
+    static const int remain[3][3] = {{1,0,0}, {1,1,0}, {0,0,1}};
+    int p, d, q, Q, lrank, dims[3], periods[3], coords[3], *box, *dm;
+    MPI_Group group, sub_group;
+
+#if !defined(USE_MKL) && !defined(USE_FFTW)
+    printf(RED "ERROR: the parallel FFT requires MKL or FFTW, please turn on USE_MKL or USE_FFTW in makefile!\n" RESET);
+    exit(EXIT_FAILURE);
+#endif
+
+    memset(plan, 0, sizeof(PENCIL_FFT_OBJ));
+    plan->comm = comm;
+    plan->is_complex = is_complex;
+    for (d = 0; d < 3; d++) plan->N[d] = gridsizes[d];
+    plan->Nxf = is_complex ? gridsizes[0] : gridsizes[0]/2 + 1;
+    MPI_Comm_size(comm, &plan->nproc);
+    MPI_Comm_rank(comm, &lrank);
+    MPI_Cart_get(comm, 3, dims, periods, coords);
+    Q = dims[0] * dims[1];
+
+    plan->dm_box = (int *) malloc(sizeof(int) * 6 * plan->nproc);
+    plan->xp_box = (int *) malloc(sizeof(int) * 6 * plan->nproc);
+    plan->yp_box = (int *) malloc(sizeof(int) * 6 * plan->nproc);
+    plan->zp_box = (int *) malloc(sizeof(int) * 6 * plan->nproc);
+    plan->sendcounts = (int *) malloc(sizeof(int) * plan->nproc);
+    plan->sdispls = (int *) malloc(sizeof(int) * plan->nproc);
+    plan->recvcounts = (int *) malloc(sizeof(int) * plan->nproc);
+    plan->rdispls = (int *) malloc(sizeof(int) * plan->nproc);
+    assert(plan->dm_box != NULL && plan->xp_box != NULL && plan->yp_box != NULL &&
+           plan->zp_box != NULL && plan->sendcounts != NULL && plan->sdispls != NULL &&
+           plan->recvcounts != NULL && plan->rdispls != NULL);
+
+    for (p = 0; p < plan->nproc; p++) {
+        MPI_Cart_coords(comm, p, 3, coords);
+        // domain decomposition, same as in parallelization.c
+        dm = plan->dm_box + 6*p;
+        for (d = 0; d < 3; d++) {
+            dm[2*d] = block_decompose_nstart(gridsizes[d], dims[d], coords[d]);
+            dm[2*d+1] = block_decompose(gridsizes[d], dims[d], coords[d]);
+        }
+        // x-pencils: local y range split among the processes along x
+        box = plan->xp_box + 6*p;
+        box[0] = 0; box[1] = gridsizes[0];
+        box[2] = dm[2] + block_decompose_nstart(dm[3], dims[0], coords[0]);
+        box[3] = block_decompose(dm[3], dims[0], coords[0]);
+        box[4] = dm[4]; box[5] = dm[5];
+        // y-pencils: x frequencies split among the processes in the same z block
+        q = coords[0] + coords[1] * dims[0];
+        box = plan->yp_box + 6*p;
+        box[0] = block_decompose_nstart(plan->Nxf, Q, q);
+        box[1] = block_decompose(plan->Nxf, Q, q);
+        box[2] = 0; box[3] = gridsizes[1];
+        box[4] = dm[4]; box[5] = dm[5];
+        // z-pencils: y split among the processes with the same x frequencies
+        box = plan->zp_box + 6*p;
+        box[0] = plan->yp_box[6*p]; box[1] = plan->yp_box[6*p+1];
+        box[2] = block_decompose_nstart(gridsizes[1], dims[2], coords[2]);
+        box[3] = block_decompose(gridsizes[1], dims[2], coords[2]);
+        box[4] = 0; box[5] = gridsizes[2];
+    }
+
+    // sub-communicators of the transposes, sub_ranks maps their ranks to ranks in comm
+    MPI_Comm_group(comm, &group);
+    for (d = 0; d < 3; d++) {
+        MPI_Cart_sub(comm, remain[d], &plan->sub_comm[d]);
+        MPI_Comm_size(plan->sub_comm[d], &plan->sub_nproc[d]);
+        MPI_Comm_group(plan->sub_comm[d], &sub_group);
+        plan->sub_ranks[d] = (int *) malloc(sizeof(int) * plan->sub_nproc[d]);
+        assert(plan->sub_ranks[d] != NULL);
+        for (p = 0; p < plan->sub_nproc[d]; p++) plan->sendcounts[p] = p;
+        MPI_Group_translate_ranks(sub_group, plan->sub_nproc[d], plan->sendcounts, group, plan->sub_ranks[d]);
+        MPI_Group_free(&sub_group);
+    }
+    MPI_Group_free(&group);
+
+    plan->nd_max = 0;
+    for (d = PFFT_DM; d <= PFFT_Z; d++) {
+        int b[6];
+        pencil_box(plan, d, lrank, b);
+        plan->nd_max = max(plan->nd_max, b[1] * b[3] * b[5]);
+    }
+
+    pencil_setup_batch(plan, ncol);
+}
+
+
+/**
+ * @brief   Free a parallel FFT plan.
+ */
+void Pencil_FFT_free(PENCIL_FFT_OBJ *plan)
+{
+    pencil_free_batch(plan);
+    free(plan->dm_box);
+    free(plan->xp_box);
+    free(plan->yp_box);
+    free(plan->zp_box);
+    free(plan->sendcounts);
+    free(plan->sdispls);
+    free(plan->recvcounts);
+    free(plan->rdispls);
+    for (int d = 0; d < 3; d++) {
+        free(plan->sub_ranks[d]);
+        MPI_Comm_free(&plan->sub_comm[d]);
+    }
+}
+
+
+/**
+ * @brief   Forward 3D FFT of ncol columns in the domain decomposition.
+ */
+void Pencil_FFT_forward(PENCIL_FFT_OBJ *plan, void *in, int ncol)
+{
+    if (ncol > plan->ncol_max) pencil_setup_batch(plan, ncol);
+
+    pencil_transpose(plan, 0, 1, (double *) in, plan->work1, ncol);
+    pencil_fft_1d(plan, 0, 1, plan->work1, plan->work2, ncol);
+    pencil_transpose(plan, 1, 1, plan->work2, plan->work1, ncol);
+    pencil_fft_1d(plan, 1, 1, plan->work1, plan->work2, ncol);
+    pencil_transpose(plan, 2, 1, plan->work2, plan->work1, ncol);
+    pencil_fft_1d(plan, 2, 1, plan->work1, plan->work2, ncol);
+}
+
+
+/**
+ * @brief   Backward 3D FFT of ncol columns stored in plan->work2 (z-pencil layout)
+ *          to the domain decomposition.
+ */
+void Pencil_FFT_backward(PENCIL_FFT_OBJ *plan, void *out, int ncol)
+{
+    assert(ncol <= plan->ncol_max);
+
+    pencil_fft_1d(plan, 2, 0, plan->work2, plan->work1, ncol);
+    pencil_transpose(plan, 2, 0, plan->work1, plan->work2, ncol);
+    pencil_fft_1d(plan, 1, 0, plan->work2, plan->work1, ncol);
+    pencil_transpose(plan, 1, 0, plan->work1, plan->work2, ncol);
+    pencil_fft_1d(plan, 0, 0, plan->work2, plan->work1, ncol);
+    pencil_transpose(plan, 0, 0, plan->work1, (double *) out, ncol);
+}
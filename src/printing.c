@@ -28,6 +28,7 @@
 #include "exactExchangeEnergyDensity.h"
 #include "mGGAtauTransferTauVxc.h"
 #include "initialization.h"
+#include "parallelIO.h"
 
 
 /**
@@ -35,114 +36,29 @@
  */
 void printElecDens(SPARC_OBJ *pSPARC) {
     if (pSPARC->dmcomm_phi == MPI_COMM_NULL) return;
-    int nproc_dmcomm_phi, rank_dmcomm_phi, DMnd;
-    MPI_Comm_size(pSPARC->dmcomm_phi, &nproc_dmcomm_phi);
-    MPI_Comm_rank(pSPARC->dmcomm_phi, &rank_dmcomm_phi);
-    
-    int Nd = pSPARC->Nd;
-    DMnd = pSPARC->Nd_d;
-    
-    double *rho_at, *rho, *mag, *mag_at, *b_ref, *b;
-    rho_at = rho = mag = mag_at = b_ref = b = NULL;
+    int DMnd = pSPARC->Nd_d;
     // TODO: add printing mag and mag_at etc as followed
-    
-    if (nproc_dmcomm_phi > 1) { // if there's more than one process, need to collect rho first
-        // use DD2DD to collect distributed data
-        int gridsizes[3], sdims[3], rdims[3], rDMVert[6];
-        MPI_Comm recv_comm;
-        if (rank_dmcomm_phi) {
-            recv_comm = MPI_COMM_NULL;
-        } else {
-            int dims[3] = {1,1,1}, periods[3] = {1,1,1};
-            // create a cartesian topology on one process (rank 0)
-            MPI_Cart_create(MPI_COMM_SELF, 3, dims, periods, 0, &recv_comm);
-        }
-        D2D_OBJ d2d_sender, d2d_recvr;
-        gridsizes[0] = pSPARC->Nx;
-        gridsizes[1] = pSPARC->Ny;
-        gridsizes[2] = pSPARC->Nz;
-        sdims[0] = pSPARC->npNdx_phi;
-        sdims[1] = pSPARC->npNdy_phi;
-        sdims[2] = pSPARC->npNdz_phi;
-        rdims[0] = rdims[1] = rdims[2] = 1;
-        rDMVert[0] = 0; rDMVert[1] = pSPARC->Nx-1;
-        rDMVert[2] = 0; rDMVert[3] = pSPARC->Ny-1;
-        rDMVert[4] = 0; rDMVert[5] = pSPARC->Nz-1;
-        
-        // set up D2D targets
-        Set_D2D_Target(&d2d_sender, &d2d_recvr, gridsizes, pSPARC->DMVertices, rDMVert, pSPARC->dmcomm_phi, 
-                       sdims, recv_comm, rdims, pSPARC->dmcomm_phi);
-        if (rank_dmcomm_phi == 0) {
-            rho_at = (double*)malloc(pSPARC->Nd * sizeof(double));
-            rho    = (double*)malloc(pSPARC->Nd * pSPARC->Nspdentd * sizeof(double));
-            b_ref  = (double*)malloc(pSPARC->Nd * sizeof(double));
-            b      = (double*)malloc(pSPARC->Nd * sizeof(double));
-        }
-        // send rho_at, rho and b_ref
-        D2D(&d2d_sender, &d2d_recvr, gridsizes, pSPARC->DMVertices, pSPARC->electronDens_at, rDMVert, 
-            rho_at, pSPARC->dmcomm_phi, sdims, recv_comm, rdims, pSPARC->dmcomm_phi, sizeof(double));
-
-        D2D(&d2d_sender, &d2d_recvr, gridsizes, pSPARC->DMVertices, pSPARC->electronDens, rDMVert, 
-            rho, pSPARC->dmcomm_phi, sdims, recv_comm, rdims, pSPARC->dmcomm_phi, sizeof(double));
-        
-        if (pSPARC->Nspdentd > 1) { // send rho_up, rho_down
-            D2D(&d2d_sender, &d2d_recvr, gridsizes, pSPARC->DMVertices, pSPARC->electronDens+DMnd, rDMVert, 
-                rho+Nd, pSPARC->dmcomm_phi, sdims, recv_comm, rdims, pSPARC->dmcomm_phi, sizeof(double));
-            D2D(&d2d_sender, &d2d_recvr, gridsizes, pSPARC->DMVertices, pSPARC->electronDens+2*DMnd, rDMVert, 
-                rho+2*Nd, pSPARC->dmcomm_phi, sdims, recv_comm, rdims, pSPARC->dmcomm_phi, sizeof(double));
-        }
 
-        D2D(&d2d_sender, &d2d_recvr, gridsizes, pSPARC->DMVertices, pSPARC->psdChrgDens_ref, rDMVert, 
-            b_ref, pSPARC->dmcomm_phi, sdims, recv_comm, rdims, pSPARC->dmcomm_phi, sizeof(double));
-        
-        D2D(&d2d_sender, &d2d_recvr, gridsizes, pSPARC->DMVertices, pSPARC->psdChrgDens, rDMVert, 
-            b, pSPARC->dmcomm_phi, sdims, recv_comm, rdims, pSPARC->dmcomm_phi, sizeof(double));
-        
-        // free D2D targets
-        Free_D2D_Target(&d2d_sender, &d2d_recvr, pSPARC->dmcomm_phi, recv_comm);
-        if (rank_dmcomm_phi == 0) 
-            MPI_Comm_free(&recv_comm);
+    if (pSPARC->Nspdentd == 1) {
+        // printing total electron density in cube format
+        write_dens_par(pSPARC, pSPARC->electronDens, pSPARC->DMVertices, pSPARC->dmcomm_phi,
+                       pSPARC->DensTCubFilename, "Electron density");
     } else {
-        rho_at = pSPARC->electronDens_at;
-        rho    = pSPARC->electronDens;
-        b_ref  = pSPARC->psdChrgDens_ref;
-        b      = pSPARC->psdChrgDens;
-    }
-    
-    if (rank_dmcomm_phi == 0) {
-        if (pSPARC->Nspdentd == 1) {
-            // printing total electron density in cube format
-            printDens_cube(pSPARC, rho, pSPARC->DensTCubFilename, "Electron density");
-        } else {
-            // printing total, spin-up and spin-down electron density in cube format
-            printDens_cube(pSPARC, rho, pSPARC->DensTCubFilename, "Total electron density");
-            printDens_cube(pSPARC, rho+Nd, pSPARC->DensUCubFilename, "Spin-up electron density");
-            printDens_cube(pSPARC, rho+2*Nd, pSPARC->DensDCubFilename, "Spin-down electron density");
-        }
-    }
-
-    // free the collected data after printing to file
-    if (nproc_dmcomm_phi > 1) {
-        if (rank_dmcomm_phi == 0) {
-            free(rho_at);
-            free(rho);
-            free(b_ref);
-            free(b);
-        }
+        // printing total, spin-up and spin-down electron density in cube format
+        write_dens_par(pSPARC, pSPARC->electronDens, pSPARC->DMVertices, pSPARC->dmcomm_phi,
+                       pSPARC->DensTCubFilename, "Total electron density");
+        write_dens_par(pSPARC, pSPARC->electronDens + DMnd, pSPARC->DMVertices, pSPARC->dmcomm_phi,
+                       pSPARC->DensUCubFilename, "Spin-up electron density");
+        write_dens_par(pSPARC, pSPARC->electronDens + 2*DMnd, pSPARC->DMVertices, pSPARC->dmcomm_phi,
+                       pSPARC->DensDCubFilename, "Spin-down electron density");
     }
 }
 
 /**
- * @brief   Print converged density in cube format.
+ * @brief   Format the header of a cube file (title lines, grid and atoms).
+ *          The returned string is allocated here and freed by the caller.
  */
-void printDens_cube(SPARC_OBJ *pSPARC, double *rho, char *fname, char *rhoname) {
-#define rho(i,j,k) rho[(i)+(j)*Nx+(k)*Nx*Ny]
-    
-    FILE *output_fp = fopen(fname,"w");
-    if (output_fp == NULL) {
-        printf("\nCannot open file \"%s\"\n",fname);
-        exit(EXIT_FAILURE);
-    }    
+char *format_cube_header(SPARC_OBJ *pSPARC, char *rhoname) {
     int Nx = pSPARC->Nx;
     int Ny = pSPARC->Ny;
     int Nz = pSPARC->Nz;
@@ -150,22 +66,25 @@ void printDens_cube(SPARC_OBJ *pSPARC, double *rho, char *fname, char *rhoname)
     double dy = pSPARC->delta_y;
     double dz = pSPARC->delta_z;
 
-    // printing headers
+    char *header = (char *)malloc(strlen(rhoname) + 512 + 128 * pSPARC->n_atom);
+    assert(header != NULL);
+    char *p = header;
+
     time_t current_time;
     time(&current_time);
     char *c_time_str = ctime(&current_time);
     // ctime includes a newline char '\n', remove manually
     if (c_time_str[strlen(c_time_str)-1] == '\n') 
         c_time_str[strlen(c_time_str)-1] = '\0'; 
-    fprintf(output_fp, "%s in Cube format printed by SPARC-X (Print time: %s)\n", rhoname, c_time_str);
-    fprintf(output_fp, "Cell length: %.6f %.6f %.6f, boundary condition: %s %s %s.\n", pSPARC->range_x,pSPARC->range_y,pSPARC->range_z, 
+    p += sprintf(p, "%s in Cube format printed by SPARC-X (Print time: %s)\n", rhoname, c_time_str);
+    p += sprintf(p, "Cell length: %.6f %.6f %.6f, boundary condition: %s %s %s.\n", pSPARC->range_x,pSPARC->range_y,pSPARC->range_z, 
         pSPARC->BCx == 0 ? "P" : "D", pSPARC->BCy == 0 ? "P" : "D", pSPARC->BCz == 0 ? "P" : "D");
-    fprintf(output_fp, "%5d %11.6f  %11.6f  %11.6f\n", pSPARC->n_atom, 0.0, 0.0, 0.0);
-    fprintf(output_fp, "%5d %11.6f  %11.6f  %11.6f\n", Nx, pSPARC->LatUVec[0]*dx, pSPARC->LatUVec[1]*dx, pSPARC->LatUVec[2]*dx);
-    fprintf(output_fp, "%5d %11.6f  %11.6f  %11.6f\n", Ny, pSPARC->LatUVec[3]*dy, pSPARC->LatUVec[4]*dy, pSPARC->LatUVec[5]*dy);
-    fprintf(output_fp, "%5d %11.6f  %11.6f  %11.6f\n", Nz, pSPARC->LatUVec[6]*dz, pSPARC->LatUVec[7]*dz, pSPARC->LatUVec[8]*dz);
+    p += sprintf(p, "%5d %11.6f  %11.6f  %11.6f\n", pSPARC->n_atom, 0.0, 0.0, 0.0);
+    p += sprintf(p, "%5d %11.6f  %11.6f  %11.6f\n", Nx, pSPARC->LatUVec[0]*dx, pSPARC->LatUVec[1]*dx, pSPARC->LatUVec[2]*dx);
+    p += sprintf(p, "%5d %11.6f  %11.6f  %11.6f\n", Ny, pSPARC->LatUVec[3]*dy, pSPARC->LatUVec[4]*dy, pSPARC->LatUVec[5]*dy);
+    p += sprintf(p, "%5d %11.6f  %11.6f  %11.6f\n", Nz, pSPARC->LatUVec[6]*dz, pSPARC->LatUVec[7]*dz, pSPARC->LatUVec[8]*dz);
     
-    int atmcount = 0, i, j, k, ityp;
+    int atmcount = 0, i, ityp;
     for (ityp = 0; ityp < pSPARC->Ntypes; ityp++) {
         int zatom = pSPARC->Zatom[ityp];
         int zion = pSPARC->Znucl[ityp];
@@ -178,9 +97,32 @@ void printDens_cube(SPARC_OBJ *pSPARC, double *rho, char *fname, char *rhoname)
                 nonCart2Cart_coord(pSPARC, &x0, &y0, &z0);	
             }
             atmcount++;
-            fprintf(output_fp, "%5d %11.6f %11.6f  %11.6f  %11.6f\n", zatom, (double)zion, x0, y0, z0);
+            p += sprintf(p, "%5d %11.6f %11.6f  %11.6f  %11.6f\n", zatom, (double)zion, x0, y0, z0);
         }
     }
+    return header;
+}
+
+/**
+ * @brief   Print converged density in cube format.
+ */
+void printDens_cube(SPARC_OBJ *pSPARC, double *rho, char *fname, char *rhoname) {
+#define rho(i,j,k) rho[(i)+(j)*Nx+(k)*Nx*Ny]
+    
+    FILE *output_fp = fopen(fname,"w");
+    if (output_fp == NULL) {
+        printf("\nCannot open file \"%s\"\n",fname);
+        exit(EXIT_FAILURE);
+    }    
+    int Nx = pSPARC->Nx;
+    int Ny = pSPARC->Ny;
+    int Nz = pSPARC->Nz;
+    int i, j, k;
+
+    // printing headers
+    char *header = format_cube_header(pSPARC, rhoname);
+    fputs(header, output_fp);
+    free(header);
 
     // printing rho
     for (i = 0; i < Nx; i++) {
@@ -530,6 +472,9 @@ void print_orbitals(SPARC_OBJ *pSPARC) {
 
     char fname[L_STRING];
     snprintf(fname,  L_STRING, "%s", pSPARC->OrbitalsFilename);
+    int nspin = spin_end - spin_start + 1;
+    int nkpt = kpt_end - kpt_start + 1;
+    int nband = band_end - band_start + 1;
     if (rank == 0) {
         FILE *output_fp = fopen(fname,"wb");
         if (output_fp == NULL) {
@@ -548,14 +493,22 @@ void print_orbitals(SPARC_OBJ *pSPARC) {
         fwrite(&pSPARC->Nspinor_eig, sizeof(int), 1, output_fp);      // Nspinor_eig
         fwrite(&pSPARC->isGammaPoint, sizeof(int), 1, output_fp);     // isGamma
         // number of spin, kpt and band
-        int nspin = spin_end - spin_start + 1;
         fwrite(&nspin, sizeof(int), 1, output_fp);
-        int nkpt = kpt_end - kpt_start + 1;
         fwrite(&nkpt, sizeof(int), 1, output_fp);
-        int nband = band_end - band_start + 1;
         fwrite(&nband, sizeof(int), 1, output_fp);
         fclose(output_fp);
     }
+    MPI_Barrier(alldmcomm);
+
+    // each record is at a fixed offset, so every dmcomm writes its own records
+    // into the file at the same time
+    int unit_size = pSPARC->isGammaPoint ? sizeof(double) : sizeof(double _Complex);
+    MPI_Offset record_size = PSI_RECORD_HEADER_SIZE + (MPI_Offset) Nd * pSPARC->Nspinor_eig * unit_size;
+    MPI_File fh;
+    if (MPI_File_open(pSPARC->dmcomm, fname, MPI_MODE_WRONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        printf("\nCannot open file \"%s\"\n",fname);
+        exit(EXIT_FAILURE);
+    }
 
     for (int kpt = kpt_start; kpt <= kpt_end; kpt++) {
         int kpt_flag = (pSPARC->kpt_start_indx <= kpt && kpt <= pSPARC->kpt_end_indx);
@@ -573,212 +526,21 @@ void print_orbitals(SPARC_OBJ *pSPARC) {
                     double kpt_vec[3] = {pSPARC->k1_loc[kpt_shift]*pSPARC->range_x/(2.0*M_PI),
                                             pSPARC->k2_loc[kpt_shift]*pSPARC->range_y/(2.0*M_PI),
                                             pSPARC->k3_loc[kpt_shift]*pSPARC->range_z/(2.0*M_PI) };
-                    if (pSPARC->isGammaPoint) {
-                        print_orbital_real(pSPARC->Xorb + band_shift*DMndsp + kpt_shift*size_k + spin_shift*DMnd, gridsizes, 
-                            pSPARC->DMVertices_dmcomm, pSPARC->dV, pSPARC->Nspinor_eig, fname, spin, kpt, kpt_vec, band, pSPARC->dmcomm);
-                    } else {
-                        print_orbital_complex(pSPARC->Xorb_kpt + band_shift*DMndsp + kpt_shift*size_k + spin_shift*DMnd, gridsizes, 
-                            pSPARC->DMVertices_dmcomm, pSPARC->dV, pSPARC->Nspinor_eig, fname, spin, kpt, kpt_vec, band, pSPARC->dmcomm);
-                    }
+                    int record = ((kpt - kpt_start) * nband + (band - band_start)) * nspin + (spin - spin_start);
+                    MPI_Offset offset = PSI_HEADER_SIZE + record * record_size;
+                    void *x = pSPARC->isGammaPoint ? 
+                        (void *) (pSPARC->Xorb + band_shift*DMndsp + kpt_shift*size_k + spin_shift*DMnd) :
+                        (void *) (pSPARC->Xorb_kpt + band_shift*DMndsp + kpt_shift*size_k + spin_shift*DMnd);
+                    write_orbital_par(x, unit_size, gridsizes, pSPARC->DMVertices_dmcomm, pSPARC->dV, 
+                        pSPARC->Nspinor_eig, fh, offset, spin, kpt, kpt_vec, band, pSPARC->dmcomm);
                 }
             }
-            MPI_Barrier(alldmcomm);
         }
     }
+    MPI_File_close(&fh);
     MPI_Comm_free(&alldmcomm);
 }
 
-/**
- * @brief   Print real Kohn-Sham orbitals
- */
-void print_orbital_real(
-    double *x, int *gridsizes, int *DMVertices, double dV, int Nspinor, 
-    char *fname, int spin_index, int kpt_index, double *kpt_vec, int band_index, MPI_Comm comm
-) 
-{
-    if (comm == MPI_COMM_NULL) return;
-    assert(Nspinor == 1 || Nspinor == 2);
-    int nproc_comm, rank_comm;
-    MPI_Comm_size(comm, &nproc_comm);
-    MPI_Comm_rank(comm, &rank_comm);
-
-    // global size of the vector
-    int Nx = gridsizes[0];
-    int Ny = gridsizes[1];
-    int Nz = gridsizes[2];
-    int Nd = Nx * Ny * Nz;
-    double *x_global = NULL;
-    if (rank_comm == 0) {
-        x_global = (double*)malloc(Nd * Nspinor * sizeof(double));
-    }
-
-    int DMnx = DMVertices[1] - DMVertices[0] + 1;
-    int DMny = DMVertices[3] - DMVertices[2] + 1;
-    int DMnz = DMVertices[5] - DMVertices[4] + 1;
-    int DMnd = DMnx * DMny * DMnz;
-
-    if (nproc_comm > 1) { // if there's more than one process, need to collect x first
-        int sdims[3], periods[3], my_coords[3];
-        MPI_Cart_get(comm, 3, sdims, periods, my_coords);
-        /* use DD2DD to collect distributed data */
-        // create a cartesian topology on one process (rank 0)
-        int rdims[3] = {1,1,1}, rDMVert[6];
-        MPI_Comm recv_comm;
-        if (rank_comm) {
-            recv_comm = MPI_COMM_NULL;
-        } else {
-            int rperiods[3] = {1,1,1};
-            // create a cartesian topology on one process (rank 0)
-            MPI_Cart_create(MPI_COMM_SELF, 3, rdims, rperiods, 0, &recv_comm);
-        }
-        
-        D2D_OBJ d2d_sender, d2d_recvr;
-        rDMVert[0] = 0; rDMVert[1] = Nx-1;
-        rDMVert[2] = 0; rDMVert[3] = Ny-1;
-        rDMVert[4] = 0; rDMVert[5] = Nz-1;
-        
-        // set up D2D targets, note that this is time consuming if 
-        // number of processes is large (> 1000), in that case, do
-        // this step only once and keep the d2d target objects
-        Set_D2D_Target(
-            &d2d_sender, &d2d_recvr, gridsizes, DMVertices, 
-            rDMVert, comm, sdims, recv_comm, rdims, comm
-        );
-        
-        // collect vector to one process   
-        for (int spinor = 0; spinor < Nspinor; spinor ++) {
-            D2D(&d2d_sender, &d2d_recvr, gridsizes, DMVertices, x + DMnd*spinor, rDMVert, 
-                x_global + Nd*spinor, comm, sdims, recv_comm, rdims, comm, sizeof(double));
-        }
-        
-        // free D2D targets
-        Free_D2D_Target(&d2d_sender, &d2d_recvr, comm, recv_comm);
-
-        if (!rank_comm) MPI_Comm_free(&recv_comm);
-    } else {
-        memcpy(x_global, x, sizeof(double)*Nd*Nspinor);
-    }
-
-    if (rank_comm == 0) {
-        // scale psi to make it L2-norm = 1
-        for (int i = 0; i < Nd*Nspinor; i++) x_global[i] /= sqrt(dV);
-
-        FILE *output_fp = fopen(fname,"ab");
-        if (output_fp == NULL) {
-            printf("\nCannot open file \"%s\"\n",fname);
-            exit(EXIT_FAILURE);
-        }
-
-        fwrite(&spin_index, sizeof(int), 1, output_fp);
-        fwrite(&kpt_index, sizeof(int), 1, output_fp);
-        fwrite(kpt_vec, 3, sizeof(double) , output_fp);
-        fwrite(&band_index, sizeof(int), 1, output_fp);
-        fwrite(x_global, Nd*Nspinor, sizeof(double) , output_fp);
-        fclose(output_fp);
-    }
-    
-    // free the collected data after printing to file
-    if (rank_comm == 0) {
-        free(x_global);
-    }
-}
-
-
-/**
- * @brief   Print complex Kohn-Sham orbitals
- */
-void print_orbital_complex(
-    double complex *x, int *gridsizes, int *DMVertices, double dV, int Nspinor, 
-    char *fname, int spin_index, int kpt_index, double *kpt_vec, int band_index, MPI_Comm comm
-) 
-{
-    if (comm == MPI_COMM_NULL) return;
-    int nproc_comm, rank_comm;
-    MPI_Comm_size(comm, &nproc_comm);
-    MPI_Comm_rank(comm, &rank_comm);
-
-    // global size of the vector
-    int Nx = gridsizes[0];
-    int Ny = gridsizes[1];
-    int Nz = gridsizes[2];
-    int Nd = Nx * Ny * Nz;
-    double complex *x_global = NULL;
-
-    if (rank_comm == 0) {
-        x_global = (double complex *)malloc(Nd * Nspinor * sizeof(double complex));
-    }
-
-    int DMnx = DMVertices[1] - DMVertices[0] + 1;
-    int DMny = DMVertices[3] - DMVertices[2] + 1;
-    int DMnz = DMVertices[5] - DMVertices[4] + 1;
-    int DMnd = DMnx * DMny * DMnz;    
-
-    if (nproc_comm > 1) { // if there's more than one process, need to collect x first
-        int sdims[3], periods[3], my_coords[3];
-        MPI_Cart_get(comm, 3, sdims, periods, my_coords);
-        /* use DD2DD to collect distributed data */
-        // create a cartesian topology on one process (rank 0)
-        int rdims[3] = {1,1,1}, rDMVert[6];
-        MPI_Comm recv_comm;
-        if (rank_comm) {
-            recv_comm = MPI_COMM_NULL;
-        } else {
-            int rperiods[3] = {1,1,1};
-            // create a cartesian topology on one process (rank 0)
-            MPI_Cart_create(MPI_COMM_SELF, 3, rdims, rperiods, 0, &recv_comm);
-        }
-        
-        D2D_OBJ d2d_sender, d2d_recvr;
-        rDMVert[0] = 0; rDMVert[1] = Nx-1;
-        rDMVert[2] = 0; rDMVert[3] = Ny-1;
-        rDMVert[4] = 0; rDMVert[5] = Nz-1;
-        
-        // set up D2D targets, note that this is time consuming if 
-        // number of processes is large (> 1000), in that case, do
-        // this step only once and keep the d2d target objects
-        Set_D2D_Target(
-            &d2d_sender, &d2d_recvr, gridsizes, DMVertices, 
-            rDMVert, comm, sdims, recv_comm, rdims, comm
-        );
-        
-        // collect vector to one process   
-        for (int spinor = 0; spinor < Nspinor; spinor ++) {
-            D2D(&d2d_sender, &d2d_recvr, gridsizes, DMVertices, x + DMnd*spinor, rDMVert, 
-                x_global + Nd*spinor, comm, sdims, recv_comm, rdims, comm, sizeof(double _Complex));            
-        }
-        
-        // free D2D targets
-        Free_D2D_Target(&d2d_sender, &d2d_recvr, comm, recv_comm);
-        
-        if (!rank_comm) MPI_Comm_free(&recv_comm);
-    } else {
-        memcpy(x_global, x, sizeof(double complex) * Nd * Nspinor);
-    }
-    
-    if (rank_comm == 0) {
-        // scale psi to make it L2-norm = 1
-        for (int i = 0; i < Nd*Nspinor; i++) x_global[i] /= sqrt(dV);
-
-        FILE *output_fp = fopen(fname,"ab");
-        if (output_fp == NULL) {
-            printf("\nCannot open file \"%s\"\n",fname);
-            exit(EXIT_FAILURE);
-        }
-
-        fwrite(&spin_index, sizeof(int), 1, output_fp);
-        fwrite(&kpt_index, sizeof(int), 1, output_fp);
-        fwrite(kpt_vec, 3, sizeof(double) , output_fp);
-        fwrite(&band_index, sizeof(int), 1, output_fp);
-        fwrite( x_global, Nd*Nspinor, sizeof(double complex) , output_fp );
-        fclose(output_fp);
-    }
-    
-    // free the collected data after printing to file
-    if (rank_comm == 0) {
-        free(x_global);
-    }
-}
-
 
 
 /**
@@ -786,13 +548,8 @@ void print_orbital_complex(
  */
 void printEnergyDensity(SPARC_OBJ *pSPARC)
 {
-    int rank, nproc_dmcomm, rank_dmcomm, nproc_dmcomm_phi, rank_dmcomm_phi;
-    int DMnd, Nd;
-    double *KineticRho, *ExxRho, *ExcRho;
-    KineticRho = ExxRho = ExcRho = NULL;
-
+    int rank, DMnd;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    Nd = pSPARC->Nd;
     DMnd = pSPARC->Nd_d_dmcomm;
 
 #ifdef DEBUG
@@ -825,92 +582,28 @@ if (rank == 0) printf("Time for calculating exchange correlation energy density:
 #endif
     }
 
-    // start printing
-    int n_rho = 1;
-    if(pSPARC->Nspin > 1) { // for spin polarized systems
-        n_rho = 3; // rho, rho_up, rho_down
-    }
+    // the kinetic and exact exchange energy densities are complete on the dmcomm
+    // with spin, kpt and band index 0, the xc energy density is on dmcomm_phi
+    MPI_Comm dmcomm_rho = (pSPARC->spincomm_index == 0 && pSPARC->kptcomm_index == 0 
+                           && pSPARC->bandcomm_index == 0) ? pSPARC->dmcomm : MPI_COMM_NULL;
+    int *DMVert = pSPARC->DMVertices_dmcomm;
 
-    // Assume rank-0 core has spin, kpt, band index = 0 and rank_dmcomm = 0
-    if (rank == 0) {
-        if ((pSPARC->spincomm_index == 0 && pSPARC->kptcomm_index == 0 
-            && pSPARC->bandcomm_index == 0 && rank_dmcomm == 0) == 0) {
-            if (rank != 0) {
-                printf("ERROR: Assumption that rank-0 core has spin, kpt, band index = 0 and rank_dmcomm = 0 failed!\n"
-                    "       Further implementation is required!\n");
-                exit(EXIT_FAILURE);
-            }
-        }
-    }
-
-    if (pSPARC->dmcomm != MPI_COMM_NULL) {
-        MPI_Comm_size(pSPARC->dmcomm, &nproc_dmcomm);
-        MPI_Comm_rank(pSPARC->dmcomm, &rank_dmcomm);
+    // print in cube format
+    if (pSPARC->Nspin == 1) {
+        write_dens_par(pSPARC, pSPARC->KineticRho, DMVert, dmcomm_rho, pSPARC->KinEnDensTCubFilename, "Kinetic energy density");
     } else {
-        nproc_dmcomm = 0;
-        rank_dmcomm = -1;
-    }
-
-    // gather densities in dmcomm
-    if (rank == 0) {
-        KineticRho = (double*)malloc(Nd * n_rho * sizeof(double));
-        ExcRho = (double*)malloc(Nd * sizeof(double));
-        if (pSPARC->usefock > 0) {
-            ExxRho = (double*)malloc(Nd * n_rho * sizeof(double));
-        }
-    }
-    
-    GatherEnergyDensity_dmcomm(pSPARC, pSPARC->KineticRho, KineticRho);
-    if (pSPARC->Nspin > 1) {
-        GatherEnergyDensity_dmcomm(pSPARC, pSPARC->KineticRho + DMnd, KineticRho + Nd);
-        GatherEnergyDensity_dmcomm(pSPARC, pSPARC->KineticRho + 2*DMnd, KineticRho + 2*Nd);
+        write_dens_par(pSPARC, pSPARC->KineticRho, DMVert, dmcomm_rho, pSPARC->KinEnDensTCubFilename, "Total kinetic energy density");
+        write_dens_par(pSPARC, pSPARC->KineticRho + DMnd, DMVert, dmcomm_rho, pSPARC->KinEnDensUCubFilename, "Spin-up kinetic energy density");
+        write_dens_par(pSPARC, pSPARC->KineticRho + 2*DMnd, DMVert, dmcomm_rho, pSPARC->KinEnDensDCubFilename, "Spin-down kinetic energy density");
     }
+    write_dens_par(pSPARC, pSPARC->ExcRho, pSPARC->DMVertices, pSPARC->dmcomm_phi, pSPARC->XcEnDensCubFilename, "Exchange correlation energy density (without hybrid contribution)");
     if (pSPARC->usefock > 0) {
-        GatherEnergyDensity_dmcomm(pSPARC, pSPARC->ExxRho, ExxRho);
-        if (pSPARC->Nspin > 1) {
-            GatherEnergyDensity_dmcomm(pSPARC, pSPARC->ExxRho + DMnd, ExxRho + Nd);
-            GatherEnergyDensity_dmcomm(pSPARC, pSPARC->ExxRho + 2*DMnd, ExxRho + 2*Nd);
-        }
-    }
-
-    // gather densities in dmcomm_phi
-    if (pSPARC->dmcomm_phi != MPI_COMM_NULL) {
-        MPI_Comm_size(pSPARC->dmcomm_phi, &nproc_dmcomm_phi);
-        MPI_Comm_rank(pSPARC->dmcomm_phi, &rank_dmcomm_phi);
-    } else {
-        nproc_dmcomm_phi = 0;
-        rank_dmcomm_phi = -1;
-    }
-    
-    // Assume rank-0 core has rank_dmcomm_phi = 0
-    GatherEnergyDensity_dmcomm_phi(pSPARC, pSPARC->ExcRho, ExcRho);
-    
-    if (rank == 0) {
-        // print in cube format
         if (pSPARC->Nspin == 1) {
-            printDens_cube(pSPARC, KineticRho, pSPARC->KinEnDensTCubFilename, "Kinetic energy density");
+            write_dens_par(pSPARC, pSPARC->ExxRho, DMVert, dmcomm_rho, pSPARC->ExxEnDensTCubFilename, "Exact exchange energy density");
         } else {
-            printDens_cube(pSPARC, KineticRho, pSPARC->KinEnDensTCubFilename, "Total kinetic energy density");
-            printDens_cube(pSPARC, KineticRho + Nd, pSPARC->KinEnDensUCubFilename, "Spin-up kinetic energy density");
-            printDens_cube(pSPARC, KineticRho + 2*Nd, pSPARC->KinEnDensDCubFilename, "Spin-down kinetic energy density");
-        }
-        printDens_cube(pSPARC, ExcRho, pSPARC->XcEnDensCubFilename, "Exchange correlation energy density (without hybrid contribution)");
-        if (pSPARC->usefock > 0) {
-            if (pSPARC->Nspin == 1) {
-                printDens_cube(pSPARC, ExxRho, pSPARC->ExxEnDensTCubFilename, "Exact exchange energy density");
-            } else {
-                printDens_cube(pSPARC, ExxRho, pSPARC->ExxEnDensTCubFilename, "Total Exact exchange energy density");
-                printDens_cube(pSPARC, ExxRho + Nd, pSPARC->ExxEnDensUCubFilename, "Spin-up exact exchange energy density");
-                printDens_cube(pSPARC, ExxRho + 2*Nd, pSPARC->ExxEnDensDCubFilename, "Spin-down exact exchange energy density");
-            }
-        }
-    }
-
-    if (rank == 0) {
-        free(KineticRho);
-        free(ExcRho);
-        if (pSPARC->usefock > 0) {
-            free(ExxRho);
+            write_dens_par(pSPARC, pSPARC->ExxRho, DMVert, dmcomm_rho, pSPARC->ExxEnDensTCubFilename, "Total Exact exchange energy density");
+            write_dens_par(pSPARC, pSPARC->ExxRho + DMnd, DMVert, dmcomm_rho, pSPARC->ExxEnDensUCubFilename, "Spin-up exact exchange energy density");
+            write_dens_par(pSPARC, pSPARC->ExxRho + 2*DMnd, DMVert, dmcomm_rho, pSPARC->ExxEnDensDCubFilename, "Spin-down exact exchange energy density");
         }
     }
 
@@ -920,113 +613,3 @@ if (rank == 0) printf("Time for calculating exchange correlation energy density:
         free(pSPARC->ExxRho);
     }
 }
-
-
-/**
- * @brief   Gather Energy Density from dmcomm
- */
-void GatherEnergyDensity_dmcomm(SPARC_OBJ *pSPARC, double *rho_send, double *rho_recv)
-{
-    if (!(pSPARC->spincomm_index == 0 && pSPARC->kptcomm_index == 0 && pSPARC->bandcomm_index == 0 && pSPARC->dmcomm != MPI_COMM_NULL)) {
-        return;
-    }
-
-    int rank, nproc_dmcomm, rank_dmcomm, i;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(pSPARC->dmcomm, &nproc_dmcomm);
-    MPI_Comm_rank(pSPARC->dmcomm, &rank_dmcomm);
-
-    if (nproc_dmcomm > 1) {
-        int gridsizes[3], sdims[3], rdims[3], rDMVert[6];
-        MPI_Comm recv_comm;
-        if (rank_dmcomm) {
-            recv_comm = MPI_COMM_NULL;
-        } else {
-            int dims[3] = {1,1,1}, periods[3] = {1,1,1};
-            // create a cartesian topology on one process (rank 0)
-            MPI_Cart_create(MPI_COMM_SELF, 3, dims, periods, 0, &recv_comm);
-        }
-        D2D_OBJ d2d_sender, d2d_recvr;
-        gridsizes[0] = pSPARC->Nx;
-        gridsizes[1] = pSPARC->Ny;
-        gridsizes[2] = pSPARC->Nz;
-        sdims[0] = pSPARC->npNdx;
-        sdims[1] = pSPARC->npNdy;
-        sdims[2] = pSPARC->npNdz;
-        rdims[0] = rdims[1] = rdims[2] = 1;
-        rDMVert[0] = 0; rDMVert[1] = pSPARC->Nx-1;
-        rDMVert[2] = 0; rDMVert[3] = pSPARC->Ny-1;
-        rDMVert[4] = 0; rDMVert[5] = pSPARC->Nz-1;
-        
-        // set up D2D targets
-        Set_D2D_Target(&d2d_sender, &d2d_recvr, gridsizes, pSPARC->DMVertices_dmcomm, rDMVert, pSPARC->dmcomm, 
-                       sdims, recv_comm, rdims, pSPARC->dmcomm);
-
-        // send Kinetic energy density
-        D2D(&d2d_sender, &d2d_recvr, gridsizes, pSPARC->DMVertices_dmcomm, rho_send, rDMVert, 
-            rho_recv, pSPARC->dmcomm, sdims, recv_comm, rdims, pSPARC->dmcomm, sizeof(double));
-        
-        // free D2D targets
-        Free_D2D_Target(&d2d_sender, &d2d_recvr, pSPARC->dmcomm, recv_comm);
-        if (rank_dmcomm == 0) 
-            MPI_Comm_free(&recv_comm);
-    } else {
-        for (i = 0; i < pSPARC->Nd; i++) {
-            rho_recv[i] = rho_send[i];
-        }
-    }
-}
-
-
-/**
- * @brief   Gather Energy Density from dmcomm_phi
- */
-void GatherEnergyDensity_dmcomm_phi(SPARC_OBJ *pSPARC, double *rho_send, double *rho_recv)
-{
-    if (pSPARC->dmcomm_phi == MPI_COMM_NULL) return;
-
-    int rank, nproc_dmcomm_phi, rank_dmcomm_phi, i;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(pSPARC->dmcomm_phi, &nproc_dmcomm_phi);
-    MPI_Comm_rank(pSPARC->dmcomm_phi, &rank_dmcomm_phi);
-
-    if (nproc_dmcomm_phi > 1) {
-        int gridsizes[3], sdims[3], rdims[3], rDMVert[6];
-        MPI_Comm recv_comm;
-        if (rank_dmcomm_phi) {
-            recv_comm = MPI_COMM_NULL;
-        } else {
-            int dims[3] = {1,1,1}, periods[3] = {1,1,1};
-            // create a cartesian topology on one process (rank 0)
-            MPI_Cart_create(MPI_COMM_SELF, 3, dims, periods, 0, &recv_comm);
-        }
-        D2D_OBJ d2d_sender, d2d_recvr;
-        gridsizes[0] = pSPARC->Nx;
-        gridsizes[1] = pSPARC->Ny;
-        gridsizes[2] = pSPARC->Nz;
-        sdims[0] = pSPARC->npNdx_phi;
-        sdims[1] = pSPARC->npNdy_phi;
-        sdims[2] = pSPARC->npNdz_phi;
-        rdims[0] = rdims[1] = rdims[2] = 1;
-        rDMVert[0] = 0; rDMVert[1] = pSPARC->Nx-1;
-        rDMVert[2] = 0; rDMVert[3] = pSPARC->Ny-1;
-        rDMVert[4] = 0; rDMVert[5] = pSPARC->Nz-1;
-        
-        // set up D2D targets
-        Set_D2D_Target(&d2d_sender, &d2d_recvr, gridsizes, pSPARC->DMVertices, rDMVert, pSPARC->dmcomm_phi, 
-                       sdims, recv_comm, rdims, pSPARC->dmcomm_phi);
-
-        // send Exchange correlation energy density
-        D2D(&d2d_sender, &d2d_recvr, gridsizes, pSPARC->DMVertices, rho_send, rDMVert, 
-            rho_recv, pSPARC->dmcomm_phi, sdims, recv_comm, rdims, pSPARC->dmcomm_phi, sizeof(double));
-
-        // free D2D targets
-        Free_D2D_Target(&d2d_sender, &d2d_recvr, pSPARC->dmcomm_phi, recv_comm);
-        if (rank_dmcomm_phi == 0) 
-            MPI_Comm_free(&recv_comm);
-    } else {
-        for (i = 0; i < pSPARC->Nd; i++) {
-            rho_recv[i] = rho_send[i];
-        }
-    }
-}
@@ -182,6 +182,12 @@ void read_input(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
             fscanf(input_fp,"%d", &pSPARC_Input->npNdy_phi);
             fscanf(input_fp,"%d", &pSPARC_Input->npNdz_phi);
             fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"NUM_OMP_THREADS:") == 0) {
+            fscanf(input_fp,"%d", &pSPARC_Input->num_omp_threads);
+            fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"PARAL_AUTOTUNE:") == 0) {
+            fscanf(input_fp,"%d", &pSPARC_Input->paral_autotune);
+            fscanf(input_fp, "%*[^\n]\n");
         } else if (strcmpi(str,"EIG_SERIAL_MAXNS:") == 0) {
             fscanf(input_fp,"%d", &pSPARC_Input->eig_serial_maxns);
             fscanf(input_fp, "%*[^\n]\n");
@@ -277,6 +283,17 @@ void read_input(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
                 exit(EXIT_FAILURE);
             }
             fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"POISSON_PRECOND:") == 0){
+            fscanf(input_fp,"%s",temp);
+            if (strcmpi(temp,"jacobi") == 0) {
+                pSPARC_Input->Poisson_precond = 0;
+            } else if (strcmpi(temp,"multigrid") == 0 || strcmpi(temp,"mg") == 0) {
+                pSPARC_Input->Poisson_precond = 1;
+            } else {
+                printf("Cannot recognize Poisson preconditioner: %s\n", temp);
+                exit(EXIT_FAILURE);
+            }
+            fscanf(input_fp, "%*[^\n]\n");
         } else if (strcmpi(str,"FD_ORDER:") == 0) {
             fscanf(input_fp,"%d",&pSPARC_Input->order);
             fscanf(input_fp, "%*[^\n]\n");
@@ -354,6 +371,18 @@ void read_input(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
         } else if (strcmpi(str,"CHEFSI_OPTMZ:") == 0) {
             fscanf(input_fp,"%d",&pSPARC_Input->CheFSI_Optmz);
             fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"CHEFSI_MIXED_PREC:") == 0) {
+            fscanf(input_fp,"%d",&pSPARC_Input->CheFSI_MixedPrec);
+            fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"TOL_CHEFSI_MIXED_PREC:") == 0) {
+            fscanf(input_fp,"%lf",&pSPARC_Input->TOL_CheFSI_MixedPrec);
+            fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"CS_FLAG:") == 0) {
+            fscanf(input_fp,"%d",&pSPARC_Input->CSFlag);
+            fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"CS_NTOP:") == 0) {
+            fscanf(input_fp,"%d",&pSPARC_Input->CS_Ntop);
+            fscanf(input_fp, "%*[^\n]\n");
         } else if (strcmpi(str,"CHEFSI_BOUND_FLAG:") == 0) {
             fscanf(input_fp,"%d",&pSPARC_Input->chefsibound_flag);
             fscanf(input_fp, "%*[^\n]\n");
@@ -537,6 +566,15 @@ void read_input(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
             // convert to upper case
             strupr(pSPARC_Input->MDMeth);
             fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"INCREMENTAL_UPDATE:") == 0) {
+            fscanf(input_fp,"%d",&pSPARC_Input->IncrUpdateFlag);
+            fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"ORBITAL_EXTRAPOLATION:") == 0) {
+            fscanf(input_fp,"%d",&pSPARC_Input->OrbExtrapFlag);
+            fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"TOL_INCREMENTAL_UPDATE:") == 0) {
+            fscanf(input_fp,"%lf",&pSPARC_Input->IncrUpdateTol);
+            fscanf(input_fp, "%*[^\n]\n");
         } else if (strcmpi(str,"MD_TIMESTEP:") == 0) {
             fscanf(input_fp,"%lf",&pSPARC_Input->MD_dt);
             fscanf(input_fp, "%*[^\n]\n");
@@ -617,6 +655,9 @@ void read_input(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
         } else if (strcmpi(str,"PRINT_RESTART_FQ:") == 0) {
             fscanf(input_fp,"%d",&pSPARC_Input->Printrestart_fq);
             fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"PRINT_RESTART_SCF:") == 0) {
+            fscanf(input_fp,"%d",&pSPARC_Input->Printrestart_scf);
+            fscanf(input_fp, "%*[^\n]\n");
         } else if(strcmpi(str,"PRINT_ORBITAL:") == 0) {
             fscanf(input_fp,"%d",&pSPARC_Input->PrintPsiFlag[0]);
             if (pSPARC_Input->PrintPsiFlag[0] == 1) {
@@ -634,6 +675,9 @@ void read_input(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
         } else if(strcmpi(str,"PRINT_ENERGY_DENSITY:") == 0) {
             fscanf(input_fp,"%d",&pSPARC_Input->PrintEnergyDensFlag);
             fscanf(input_fp, "%*[^\n]\n");
+        } else if(strcmpi(str,"PRINT_DENSITY_FORMAT:") == 0) {
+            fscanf(input_fp,"%d",&pSPARC_Input->PrintDensFormat);
+            fscanf(input_fp, "%*[^\n]\n");
         } else if(strcmpi(str,"MLFF_FLAG:") == 0) {
             // pSPARC->mlff_flag == 1 means on-the-fly MD from scratch, pSPARC->mlff_flag == 21 means only prediction using a known model, pSPARC->mlff_flag == 22 on-the-fly MD starting from a known model
             fscanf(input_fp,"%d",&pSPARC_Input->mlff_flag);
@@ -686,6 +730,9 @@ void read_input(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
         } else if(strcmpi(str,"MLFF_RCUT_SOAP:") == 0) {
             fscanf(input_fp,"%lf",&pSPARC_Input->rcut_SOAP);
             fscanf(input_fp, "%*[^\n]\n");
+        } else if(strcmpi(str,"MLFF_NLIST_SKIN:") == 0) {
+            fscanf(input_fp,"%lf",&pSPARC_Input->nlist_skin_MLFF);
+            fscanf(input_fp, "%*[^\n]\n");
         } else if(strcmpi(str,"MLFF_SIGMA_ATOM_SOAP:") == 0) {
             fscanf(input_fp,"%lf",&pSPARC_Input->sigma_atom_SOAP);
             fscanf(input_fp, "%*[^\n]\n");
@@ -717,9 +764,15 @@ void read_input(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
             fscanf(input_fp,"%lf %lf %lf %lf %lf %lf", &pSPARC_Input->stress_rel_scale[0], &pSPARC_Input->stress_rel_scale[1], &pSPARC_Input->stress_rel_scale[2],
                                                        &pSPARC_Input->stress_rel_scale[3], &pSPARC_Input->stress_rel_scale[4], &pSPARC_Input->stress_rel_scale[5]);
             fscanf(input_fp, "%*[^\n]\n");
-        } else if (strcmpi(str,"MLFF_DFT_FQ:") == 0) {    // MLFF end
+        } else if (strcmpi(str,"MLFF_DFT_FQ:") == 0) {
             fscanf(input_fp,"%d", &pSPARC_Input->MLFF_DFT_fq);
             fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"MLFF_HYPER_NSTR:") == 0) {
+            fscanf(input_fp,"%d", &pSPARC_Input->hyper_nstr_MLFF);
+            fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"MLFF_HYPER_TOL:") == 0) {    // MLFF end
+            fscanf(input_fp,"%lf", &pSPARC_Input->hyper_tol_MLFF);
+            fscanf(input_fp, "%*[^\n]\n");
         } else if (strcmpi(str,"EXCHANGE_CORRELATION:") == 0) {
             fscanf(input_fp,"%s",pSPARC_Input->XC);  
             fscanf(input_fp, "%*[^\n]\n");
@@ -810,6 +863,9 @@ void read_input(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
         } else if(strcmpi(str,"PRINT_EIGEN:") == 0) {
             fscanf(input_fp,"%d",&pSPARC_Input->PrintEigenFlag);
             fscanf(input_fp, "%*[^\n]\n");
+        } else if(strcmpi(str,"PRINT_TIMING:") == 0) {
+            fscanf(input_fp,"%d",&pSPARC_Input->PrintTimingFlag);
+            fscanf(input_fp, "%*[^\n]\n");
         } else if(strcmpi(str,"PRINT_DENSITY:") == 0) {
             fscanf(input_fp,"%d",&pSPARC_Input->PrintElecDensFlag);
             fscanf(input_fp, "%*[^\n]\n");
@@ -847,6 +903,12 @@ void read_input(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
         } else if (strcmpi(str,"EXX_ACE_VALENCE_STATES:") == 0) {
             fscanf(input_fp,"%d",&pSPARC_Input->EXXACEVal_state);
             fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"EXX_ISDF_FLAG:") == 0) {
+            fscanf(input_fp,"%d",&pSPARC_Input->ISDFFlag);
+            fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"EXX_ISDF_RATIO:") == 0) {
+            fscanf(input_fp,"%lf",&pSPARC_Input->EXXISDF_ratio);
+            fscanf(input_fp, "%*[^\n]\n");
         } else if (strcmpi(str,"EXX_DOWNSAMPLING:") == 0) {
             fscanf(input_fp,"%d %d %d",&pSPARC_Input->EXXDownsampling[0],
                     &pSPARC_Input->EXXDownsampling[1],&pSPARC_Input->EXXDownsampling[2]);
@@ -871,6 +933,9 @@ void read_input(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
         } else if (strcmpi(str,"EXX_RANGE_PBE:") == 0) {    
             fscanf(input_fp,"%lf",&pSPARC_Input->hyb_range_pbe);
             fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"EXX_SR_TABLE_TOL:") == 0) {    
+            fscanf(input_fp,"%lf",&pSPARC_Input->exx_sr_table_tol);
+            fscanf(input_fp, "%*[^\n]\n");
         } else if (strcmpi(str,"EXX_FRAC:") == 0) {    
             fscanf(input_fp,"%lf",&pSPARC_Input->exx_frac);
             fscanf(input_fp, "%*[^\n]\n");
@@ -896,6 +961,9 @@ void read_input(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
         } else if (strcmpi(str,"SQ_NPL_G:") == 0) {
             fscanf(input_fp,"%d",&pSPARC_Input->SQ_npl_g);
             fscanf(input_fp, "%*[^\n]\n");
+        } else if (strcmpi(str,"SQ_BLOCK_SIZE:") == 0) {
+            fscanf(input_fp,"%d",&pSPARC_Input->SQ_block_size);
+            fscanf(input_fp, "%*[^\n]\n");
         } else if (strcmpi(str,"SQ_RCUT:") == 0) {
             fscanf(input_fp,"%lf",&pSPARC_Input->SQ_rcut);
             fscanf(input_fp, "%*[^\n]\n");
@@ -1201,24 +1269,14 @@ void read_input(SPARC_INPUT_OBJ *pSPARC_Input, SPARC_OBJ *pSPARC) {
 
 
 /**
- * @brief Read density in cube format.
+ * @brief Read the header of a cube file, including the atom lines. The file
+ * is left at the first value of the data.
  * 
- * @param filename Name of the density file in cube format.
- * @param dens_gridsizes (OUTPUT) Grid sizes (in 3-dim) of the density read.
- * @param dens_latvecs (OUTPUT) Lattice vectors (scaled) read.
- * @return double* (OUTPUT) Density array.
+ * @param dens_fp Cube file opened for reading.
+ * @param dens_gridsizes (OUTPUT) Grid sizes (in 3-dim) of the density.
+ * @param dens_latvecs (OUTPUT) Lattice vectors (scaled).
  */
-double* readDens_cube(char *filename, int dens_gridsizes[3], double dens_latvecs[9]) {
-#ifdef DEBUG
-    printf("Reading CUBE file: %s ...\n", filename);
-#endif
-
-    FILE *dens_fp = fopen(filename, "r");
-    if (dens_fp == NULL) {
-        printf("Cannot open file \"%s\"\n", filename);
-        exit(EXIT_FAILURE);
-    }
-
+void readDens_cube_header(FILE *dens_fp, int dens_gridsizes[3], double dens_latvecs[9]) {
     int n_atom,cube_size_x,cube_size_y,cube_size_z;
     double x1,x2,x3;
     double y1,y2,y3;
@@ -1262,11 +1320,7 @@ double* readDens_cube(char *filename, int dens_gridsizes[3], double dens_latvecs
     dens_gridsizes[1] = cube_size_y;
     dens_gridsizes[2] = cube_size_z;
 
-    int len = cube_size_x * cube_size_y * cube_size_z;
-    double *dens = malloc(len * sizeof(double));
-    assert(dens != NULL);
-
-    // read density data and save it in dens
+    // skip the atom lines
 	for(int i = 0; i < n_atom; i++) {
 		fscanf(dens_fp, "%lf",&tempval);
 		fscanf(dens_fp, "%lf",&tempval);
@@ -1274,7 +1328,38 @@ double* readDens_cube(char *filename, int dens_gridsizes[3], double dens_latvecs
 		fscanf(dens_fp, "%lf",&tempval);
 		fscanf(dens_fp, "%lf",&tempval);
 	}
-	
+}
+
+
+/**
+ * @brief Read density in cube format.
+ * 
+ * @param filename Name of the density file in cube format.
+ * @param dens_gridsizes (OUTPUT) Grid sizes (in 3-dim) of the density read.
+ * @param dens_latvecs (OUTPUT) Lattice vectors (scaled) read.
+ * @return double* (OUTPUT) Density array.
+ */
+double* readDens_cube(char *filename, int dens_gridsizes[3], double dens_latvecs[9]) {
+#ifdef DEBUG
+    printf("Reading CUBE file: %s ...\n", filename);
+#endif
+
+    FILE *dens_fp = fopen(filename, "r");
+    if (dens_fp == NULL) {
+        printf("Cannot open file \"%s\"\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    readDens_cube_header(dens_fp, dens_gridsizes, dens_latvecs);
+    int cube_size_x = dens_gridsizes[0];
+    int cube_size_y = dens_gridsizes[1];
+    int cube_size_z = dens_gridsizes[2];
+
+    int len = cube_size_x * cube_size_y * cube_size_z;
+    double *dens = malloc(len * sizeof(double));
+    assert(dens != NULL);
+
+    // read density data and save it in dens
 	for (int i = 0; i < cube_size_x; i++) 
 	{
 		for (int j = 0; j < cube_size_y; j++) 
@@ -1286,6 +1371,7 @@ double* readDens_cube(char *filename, int dens_gridsizes[3], double dens_latvecs
 		}
 	}
 
+    fclose(dens_fp);
     return dens;
 }
 
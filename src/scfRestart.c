@@ -0,0 +1,267 @@
+/**
+ * @file    scfRestart.c
+ * @brief   This file contains the functions for writing and reading the SCF
+ *          restart file, used as the initial guess of the SCF when an MD or
+ *          relaxation is restarted.
+ *
+ *          File layout (native binary):
+ *              "SPARCSCF", int[12] {version, Nx, Ny, Nz, Nspin, Nspinor, Nkpts,
+ *              Nstates, isGammaPoint, Nspdentd, Nmag, 0}, double Efermi,
+ *              eigenvalues [spin][kpt][band], occupations [spin][kpt][band],
+ *              electron density [Nspdentd][Nd], magnetization [Nmag][Nd],
+ *              orbitals [kpt][band][spinor][Nd] (real or complex).
+ *          Grid vectors are in the global ordering (x fastest), each process
+ *          reads/writes its own block through an MPI-IO file view.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <complex.h>
+#include <unistd.h>
+#include <mpi.h>
+
+#include "scfRestart.h"
+#include "tools.h"
+
+#define SCF_RESTART_VERSION 1
+#define SCF_RESTART_NHDR 12
+#define SCF_RESTART_HDR_SIZE (8 + SCF_RESTART_NHDR*sizeof(int) + sizeof(double))
+
+
+/**
+ * @brief   Fill the header of the SCF restart file for the current system.
+ */
+static void set_header_SCF_restart(SPARC_OBJ *pSPARC, int *hdr) {
+    hdr[0] = SCF_RESTART_VERSION;
+    hdr[1] = pSPARC->Nx;
+    hdr[2] = pSPARC->Ny;
+    hdr[3] = pSPARC->Nz;
+    hdr[4] = pSPARC->Nspin;
+    hdr[5] = pSPARC->Nspinor;
+    hdr[6] = pSPARC->Nkpts;
+    hdr[7] = pSPARC->Nstates;
+    hdr[8] = pSPARC->isGammaPoint;
+    hdr[9] = pSPARC->Nspdentd;
+    hdr[10] = pSPARC->Nmag;
+    hdr[11] = 0;
+}
+
+
+/**
+ * @brief   Collectively read or write nvec grid vectors of the local domain.
+ *
+ *          The i-th local vector is stored at byte offset disp + vec_disp[i] in
+ *          the file, in the global ordering of the grid. Processes without data
+ *          call this with nvec = 0.
+ *
+ * @param rw    0 - read, 1 - write.
+ */
+static void rw_grid_vectors(
+    MPI_File fh, MPI_Offset disp, int *gridsizes, int *DMVert, int nvec,
+    MPI_Aint *vec_disp, MPI_Datatype etype, void *buf, int rw)
+{
+    MPI_Datatype subarray, filetype;
+    int count = 0;
+    if (nvec > 0) {
+        int sizes[3] = {gridsizes[2], gridsizes[1], gridsizes[0]};
+        int subsizes[3] = {DMVert[5]-DMVert[4]+1, DMVert[3]-DMVert[2]+1, DMVert[1]-DMVert[0]+1};
+        int starts[3] = {DMVert[4], DMVert[2], DMVert[0]};
+        MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C, etype, &subarray);
+        MPI_Type_create_hindexed_block(nvec, 1, vec_disp, subarray, &filetype);
+        MPI_Type_commit(&filetype);
+        MPI_Type_free(&subarray);
+        count = nvec * subsizes[0] * subsizes[1] * subsizes[2];
+    } else {
+        MPI_Type_dup(etype, &filetype);
+    }
+
+    MPI_File_set_view(fh, disp, etype, filetype, "native", MPI_INFO_NULL);
+    if (rw == 1)
+        MPI_File_write_all(fh, buf, count, etype, MPI_STATUS_IGNORE);
+    else
+        MPI_File_read_all(fh, buf, count, etype, MPI_STATUS_IGNORE);
+    MPI_File_set_view(fh, 0, MPI_BYTE, MPI_BYTE, "native", MPI_INFO_NULL);
+    MPI_Type_free(&filetype);
+}
+
+
+/**
+ * @brief   Read or write everything after the header of the SCF restart file.
+ *
+ * @param rw    0 - read, 1 - write.
+ */
+static void rw_data_SCF_restart(SPARC_OBJ *pSPARC, MPI_File fh, int rw) {
+    int gridsizes[3] = {pSPARC->Nx, pSPARC->Ny, pSPARC->Nz};
+    MPI_Aint Nd = pSPARC->Nd;
+    int Ns = pSPARC->Nstates;
+    MPI_Offset Neig = (MPI_Offset) pSPARC->Nspin * pSPARC->Nkpts * Ns;
+    MPI_Offset off_eig = SCF_RESTART_HDR_SIZE;
+    MPI_Offset off_occ = off_eig + Neig * sizeof(double);
+    MPI_Offset off_rho = off_occ + Neig * sizeof(double);
+    MPI_Offset off_mag = off_rho + pSPARC->Nspdentd * Nd * sizeof(double);
+    MPI_Offset off_psi = off_mag + pSPARC->Nmag * Nd * sizeof(double);
+
+    int no_psi = pSPARC->spincomm_index < 0 || pSPARC->kptcomm_index < 0
+              || pSPARC->bandcomm_index < 0 || pSPARC->dmcomm == MPI_COMM_NULL;
+
+    // eigenvalues and occupations, contiguous over the k-points of a kptcomm
+    if (pSPARC->spincomm_index >= 0 && pSPARC->kptcomm_index >= 0) {
+        int rank_dmcomm = -1;
+        if (!no_psi) MPI_Comm_rank(pSPARC->dmcomm, &rank_dmcomm);
+        int size_s = pSPARC->Nkpts_kptcomm * Ns;
+        for (int spn_i = 0; spn_i < pSPARC->Nspin_spincomm; spn_i++) {
+            int sg = pSPARC->spin_start_indx + spn_i;
+            MPI_Offset shift = ((MPI_Offset) sg * pSPARC->Nkpts + pSPARC->kpt_start_indx) * Ns * sizeof(double);
+            if (rw == 1) {
+                if (pSPARC->bandcomm_index == 0 && rank_dmcomm == 0) {
+                    MPI_File_write_at(fh, off_eig + shift, pSPARC->lambda + spn_i*size_s, size_s, MPI_DOUBLE, MPI_STATUS_IGNORE);
+                    MPI_File_write_at(fh, off_occ + shift, pSPARC->occ + spn_i*size_s, size_s, MPI_DOUBLE, MPI_STATUS_IGNORE);
+                }
+            } else {
+                MPI_File_read_at(fh, off_eig + shift, pSPARC->lambda + spn_i*size_s, size_s, MPI_DOUBLE, MPI_STATUS_IGNORE);
+                MPI_File_read_at(fh, off_occ + shift, pSPARC->occ + spn_i*size_s, size_s, MPI_DOUBLE, MPI_STATUS_IGNORE);
+            }
+        }
+        if (rw == 0 && pSPARC->CyclixFlag) {
+            for (int i = 0; i < pSPARC->Nspin_spincomm * pSPARC->Nkpts_kptcomm; i++) {
+                memcpy(pSPARC->lambda_sorted + i*Ns, pSPARC->lambda + i*Ns, Ns * sizeof(double));
+                qsort(pSPARC->lambda_sorted + i*Ns, Ns, sizeof(double), cmp);
+                memcpy(pSPARC->occ_sorted + i*Ns, pSPARC->occ + i*Ns, Ns * sizeof(double));
+            }
+        }
+    }
+
+    // electron density and magnetization in dmcomm_phi
+    int has_phi = (pSPARC->dmcomm_phi != MPI_COMM_NULL);
+    int ncol_phi = pSPARC->Nspdentd > pSPARC->Nmag ? pSPARC->Nspdentd : pSPARC->Nmag;
+    MPI_Aint *col_disp = (MPI_Aint *) malloc(ncol_phi * sizeof(MPI_Aint));
+    for (int i = 0; i < ncol_phi; i++) col_disp[i] = i * Nd * sizeof(double);
+    rw_grid_vectors(fh, off_rho, gridsizes, pSPARC->DMVertices, has_phi ? pSPARC->Nspdentd : 0,
+                    col_disp, MPI_DOUBLE, pSPARC->electronDens, rw);
+    rw_grid_vectors(fh, off_mag, gridsizes, pSPARC->DMVertices, has_phi ? pSPARC->Nmag : 0,
+                    col_disp, MPI_DOUBLE, pSPARC->mag, rw);
+    free(col_disp);
+
+    // orbitals in the band/domain decomposition, local layout [kpt][band][spinor][DMnd]
+    int nvec = no_psi ? 0 : pSPARC->Nkpts_kptcomm * pSPARC->Nband_bandcomm * pSPARC->Nspinor_spincomm;
+    MPI_Aint elem = pSPARC->isGammaPoint ? sizeof(double) : sizeof(double _Complex);
+    MPI_Aint *vec_disp = (MPI_Aint *) malloc((nvec > 0 ? nvec : 1) * sizeof(MPI_Aint));
+    int count = 0;
+    for (int k = 0; k < pSPARC->Nkpts_kptcomm && nvec > 0; k++) {
+        int kg = pSPARC->kpt_start_indx + k;
+        for (int n = 0; n < pSPARC->Nband_bandcomm; n++) {
+            int ng = pSPARC->band_start_indx + n;
+            for (int spinor = 0; spinor < pSPARC->Nspinor_spincomm; spinor++) {
+                int spinorg = pSPARC->spinor_start_indx + spinor;
+                vec_disp[count++] = (((MPI_Aint) kg * Ns + ng) * pSPARC->Nspinor + spinorg) * Nd * elem;
+            }
+        }
+    }
+    if (pSPARC->isGammaPoint)
+        rw_grid_vectors(fh, off_psi, gridsizes, pSPARC->DMVertices_dmcomm, nvec, vec_disp,
+                        MPI_DOUBLE, pSPARC->Xorb, rw);
+    else
+        rw_grid_vectors(fh, off_psi, gridsizes, pSPARC->DMVertices_dmcomm, nvec, vec_disp,
+                        MPI_C_DOUBLE_COMPLEX, pSPARC->Xorb_kpt, rw);
+    free(vec_disp);
+}
+
+
+/**
+ * @brief   Write the converged orbitals, eigenvalues, occupations and electron
+ *          density into the binary SCF restart file.
+ */
+void write_restart_SCF(SPARC_OBJ *pSPARC) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#ifdef DEBUG
+    double t1 = MPI_Wtime();
+#endif
+
+    // write into a temporary file first, so a previous restart file is never left half-written
+    char tmpname[L_STRING+8];
+    snprintf(tmpname, L_STRING+8, "%s-tmp", pSPARC->SCFRestartFilename);
+
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, tmpname, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                      MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        if (!rank) printf("WARNING: Cannot open file \"%s\", SCF restart file is not written!\n", tmpname);
+        return;
+    }
+    MPI_File_set_size(fh, 0);
+
+    if (rank == 0) {
+        int hdr[SCF_RESTART_NHDR];
+        set_header_SCF_restart(pSPARC, hdr);
+        MPI_File_write_at(fh, 0, "SPARCSCF", 8, MPI_CHAR, MPI_STATUS_IGNORE);
+        MPI_File_write_at(fh, 8, hdr, SCF_RESTART_NHDR, MPI_INT, MPI_STATUS_IGNORE);
+        MPI_File_write_at(fh, 8 + SCF_RESTART_NHDR*sizeof(int), &pSPARC->Efermi, 1, MPI_DOUBLE, MPI_STATUS_IGNORE);
+    }
+
+    rw_data_SCF_restart(pSPARC, fh, 1);
+    MPI_File_close(&fh);
+
+    if (rank == 0) rename(tmpname, pSPARC->SCFRestartFilename);
+#ifdef DEBUG
+    if (rank == 0) printf("Writing SCF restart file took %.3f ms\n", (MPI_Wtime() - t1)*1e3);
+#endif
+}
+
+
+/**
+ * @brief   Read the SCF restart file and use it as the initial guess of the first SCF.
+ */
+int read_restart_SCF(SPARC_OBJ *pSPARC) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#ifdef DEBUG
+    double t1 = MPI_Wtime();
+#endif
+
+    // check if the file exists and belongs to the same system
+    int match = 0;
+    double Efermi = 0.0;
+    if (rank == 0) {
+        FILE *fp = NULL;
+        char tag[8];
+        int hdr_file[SCF_RESTART_NHDR], hdr[SCF_RESTART_NHDR];
+        set_header_SCF_restart(pSPARC, hdr);
+        if (access(pSPARC->SCFRestartFilename, F_OK) == -1) {
+            printf("WARNING: SCF restart file \"%s\" is not found, "
+                   "using the default initial guess!\n", pSPARC->SCFRestartFilename);
+        } else if ((fp = fopen(pSPARC->SCFRestartFilename, "rb")) == NULL ||
+                   fread(tag, sizeof(char), 8, fp) != 8 || strncmp(tag, "SPARCSCF", 8) != 0 ||
+                   fread(hdr_file, sizeof(int), SCF_RESTART_NHDR, fp) != SCF_RESTART_NHDR ||
+                   fread(&Efermi, sizeof(double), 1, fp) != 1) {
+            printf("WARNING: SCF restart file \"%s\" cannot be read or is not an SCF restart file, "
+                   "using the default initial guess!\n", pSPARC->SCFRestartFilename);
+        } else if (memcmp(hdr, hdr_file, SCF_RESTART_NHDR*sizeof(int)) != 0) {
+            printf("WARNING: SCF restart file \"%s\" does not match the current system, "
+                   "using the default initial guess!\n", pSPARC->SCFRestartFilename);
+        } else {
+            match = 1;
+        }
+        if (fp != NULL) fclose(fp);
+    }
+    MPI_Bcast(&match, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (!match) return 0;
+    MPI_Bcast(&Efermi, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, pSPARC->SCFRestartFilename, MPI_MODE_RDONLY,
+                      MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        return 0;
+    }
+    rw_data_SCF_restart(pSPARC, fh, 0);
+    MPI_File_close(&fh);
+
+    pSPARC->Efermi = Efermi;
+    pSPARC->SCFRestartRead = 1;
+#ifdef DEBUG
+    if (rank == 0) printf("Reading SCF restart file took %.3f ms\n", (MPI_Wtime() - t1)*1e3);
+#endif
+    return 1;
+}
@@ -1058,6 +1058,11 @@ void Calculate_local_stress(SPARC_OBJ *pSPARC) {
  * @brief    Calculate nonlocal stress components.
  */
 void Calculate_nonlocal_kinetic_stress(SPARC_OBJ *pSPARC) {
+    // already computed together with the nonlocal forces, see Calculate_nonlocal_forces
+    if (pSPARC->nlocStressReady == 1) {
+        pSPARC->nlocStressReady = 0;
+        return;
+    }
     if (pSPARC->SQFlag == 1) {
         Calculate_nonlocal_kinetic_stress_SQ(pSPARC);   
     } else if (pSPARC->isGammaPoint) {
@@ -0,0 +1,271 @@
+/**
+ * @file    timing.c
+ * @brief   This file contains the functions for the per-phase timing and
+ *          counter report.
+ *
+ *          The regions of one process are kept in a small table. A region is
+ *          identified by its name and its parent region, so opening a region
+ *          costs a short search of the table and one call to MPI_Wtime. No
+ *          communication is done until the report is written.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <assert.h>
+#include <mpi.h>
+
+#include "timing.h"
+#include "isddft.h"
+
+#define TIMING_MAX_REGIONS 256
+#define TIMING_MAX_DEPTH   32
+#define TIMING_PATH_LEN    256
+
+typedef struct _TIMING_REGION {
+    const char *name;   // name of the region
+    int parent;         // index of the parent region, -1 for top level regions
+    double calls;       // number of times the region was closed
+    double t_start;     // time the region was last opened
+    double time;        // accumulated time in the region
+    double bytes;       // accumulated bytes communicated in the region
+    double flops;       // accumulated floating point operations in the region
+} TIMING_REGION;
+
+static TIMING_REGION timing_regions[TIMING_MAX_REGIONS];
+static int timing_nregions = 0;
+static int timing_stack[TIMING_MAX_DEPTH];
+static int timing_depth = 0;
+static int timing_skipped = 0; // number of open regions that are not recorded
+static int timing_nreports = 0;
+
+
+
+/**
+ * @brief   Open the region called name inside the currently open region.
+ */
+void timing_region_begin(const char *name)
+{
+    if (timing_skipped || timing_depth == TIMING_MAX_DEPTH) {
+        timing_skipped++;
+        return;
+    }
+    int parent = timing_depth ? timing_stack[timing_depth-1] : -1;
+    int r;
+    for (r = 0; r < timing_nregions; r++) {
+        if (timing_regions[r].parent == parent &&
+            (timing_regions[r].name == name || strcmp(timing_regions[r].name, name) == 0))
+            break;
+    }
+    if (r == timing_nregions) {
+        if (r == TIMING_MAX_REGIONS) {
+            timing_skipped++;
+            return;
+        }
+        memset(&timing_regions[r], 0, sizeof(TIMING_REGION));
+        timing_regions[r].name = name;
+        timing_regions[r].parent = parent;
+        timing_nregions++;
+    }
+    timing_stack[timing_depth++] = r;
+    timing_regions[r].t_start = MPI_Wtime();
+}
+
+
+
+/**
+ * @brief   Close the innermost open region.
+ */
+void timing_region_end(const char *name)
+{
+    double t = MPI_Wtime();
+    if (timing_skipped) {
+        timing_skipped--;
+        return;
+    }
+    if (timing_depth == 0) return;
+    TIMING_REGION *reg = &timing_regions[timing_stack[--timing_depth]];
+#ifdef DEBUG
+    if (strcmp(reg->name, name) != 0)
+        printf("WARNING: timing region \"%s\" is closed as \"%s\"\n", reg->name, name);
+#endif
+    reg->time += t - reg->t_start;
+    reg->calls += 1.0;
+}
+
+
+
+/**
+ * @brief   Add the bytes communicated and the floating point operations done
+ *          by this process to the innermost open region.
+ */
+void timing_add_counts(double bytes, double flops)
+{
+    if (timing_skipped || timing_depth == 0) return;
+    TIMING_REGION *reg = &timing_regions[timing_stack[timing_depth-1]];
+    reg->bytes += bytes;
+    reg->flops += flops;
+}
+
+
+
+/**
+ * @brief   Full name of a region, i.e., the names of the region and its parents
+ *          separated by '/'.
+ */
+static void timing_region_path(int r, char *path)
+{
+    int len;
+    if (timing_regions[r].parent < 0) {
+        len = snprintf(path, TIMING_PATH_LEN, "%s", timing_regions[r].name);
+    } else {
+        char parent_path[TIMING_PATH_LEN];
+        timing_region_path(timing_regions[r].parent, parent_path);
+        len = snprintf(path, TIMING_PATH_LEN, "%s/%s", parent_path, timing_regions[r].name);
+    }
+    // a truncated path could be merged with another region over the processes
+    if (len >= TIMING_PATH_LEN) {
+        printf("ERROR: timing region path \"%s\" is longer than %d characters!\n", path, TIMING_PATH_LEN-1);
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+
+static int cmp_path(const void *a, const void *b)
+{
+    return strcmp((const char *)a, (const char *)b);
+}
+
+
+
+/**
+ * @brief   Write the timings and counters collected since the last report into
+ *          the .timing file and reset them.
+ */
+void write_timing_report(SPARC_OBJ *pSPARC)
+{
+    int r, u;
+    if (pSPARC->PrintTimingFlag == 1 && timing_depth == 0) {
+        int rank, nproc;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+        // collect the names of the regions of all processes in rank 0
+        char *paths = (char *)malloc((timing_nregions + 1) * TIMING_PATH_LEN * sizeof(char));
+        assert(paths != NULL);
+        for (r = 0; r < timing_nregions; r++) timing_region_path(r, paths + r*TIMING_PATH_LEN);
+        int nlocal = timing_nregions * TIMING_PATH_LEN;
+        int *recvcounts = NULL, *displs = NULL;
+        char *all_paths = NULL;
+        if (rank == 0) {
+            recvcounts = (int *)malloc(nproc * sizeof(int));
+            displs = (int *)malloc(nproc * sizeof(int));
+            assert(recvcounts != NULL && displs != NULL);
+        }
+        MPI_Gather(&nlocal, 1, MPI_INT, recvcounts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        int nunion = 0;
+        if (rank == 0) {
+            int ntot = 0;
+            for (r = 0; r < nproc; r++) {
+                displs[r] = ntot;
+                ntot += recvcounts[r];
+            }
+            all_paths = (char *)malloc((ntot + TIMING_PATH_LEN) * sizeof(char));
+            assert(all_paths != NULL);
+        }
+        MPI_Gatherv(paths, nlocal, MPI_CHAR, all_paths, recvcounts, displs, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+        // sorting the full names puts every region right after its parent
+        if (rank == 0) {
+            int ntot = displs[nproc-1] + recvcounts[nproc-1];
+            int n = ntot / TIMING_PATH_LEN;
+            qsort(all_paths, n, TIMING_PATH_LEN, cmp_path);
+            for (r = 0; r < n; r++) {
+                if (nunion > 0 && strcmp(all_paths + r*TIMING_PATH_LEN, all_paths + (nunion-1)*TIMING_PATH_LEN) == 0)
+                    continue;
+                if (r != nunion) memcpy(all_paths + nunion*TIMING_PATH_LEN, all_paths + r*TIMING_PATH_LEN, TIMING_PATH_LEN);
+                nunion++;
+            }
+            free(recvcounts);
+            free(displs);
+        }
+        MPI_Bcast(&nunion, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        if (rank != 0) all_paths = (char *)malloc((nunion + 1) * TIMING_PATH_LEN * sizeof(char));
+        assert(all_paths != NULL);
+        MPI_Bcast(all_paths, nunion * TIMING_PATH_LEN, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+        // values of the regions of this process in the order of the union
+        double *vsum = (double *)calloc(4 * nunion + 1, sizeof(double)); // time, bytes, flops, entered
+        double *vmax = (double *)calloc(2 * nunion + 1, sizeof(double)); // time, calls
+        double *vmin = (double *)malloc((nunion + 1) * sizeof(double));  // time
+        assert(vsum != NULL && vmax != NULL && vmin != NULL);
+        for (u = 0; u < nunion; u++) vmin[u] = DBL_MAX;
+        for (r = 0; r < timing_nregions; r++) {
+            char *p = bsearch(paths + r*TIMING_PATH_LEN, all_paths, nunion, TIMING_PATH_LEN, cmp_path);
+            if (p == NULL || timing_regions[r].calls == 0.0) continue;
+            u = (p - all_paths) / TIMING_PATH_LEN;
+            vsum[4*u  ] = timing_regions[r].time;
+            vsum[4*u+1] = timing_regions[r].bytes;
+            vsum[4*u+2] = timing_regions[r].flops;
+            vsum[4*u+3] = 1.0;
+            vmax[2*u  ] = timing_regions[r].time;
+            vmax[2*u+1] = timing_regions[r].calls;
+            vmin[u]     = timing_regions[r].time;
+        }
+        MPI_Reduce(rank ? vsum : MPI_IN_PLACE, vsum, 4*nunion, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(rank ? vmax : MPI_IN_PLACE, vmax, 2*nunion, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        MPI_Reduce(rank ? vmin : MPI_IN_PLACE, vmin, nunion, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+
+        if (rank == 0) {
+            int step;
+            if (pSPARC->MDFlag == 1)
+                step = pSPARC->MDCount + pSPARC->restartCount + (pSPARC->RestartFlag == 0);
+            else if (pSPARC->RelaxFlag >= 1)
+                step = pSPARC->RelaxCount + pSPARC->restartCount + (pSPARC->RestartFlag == 0);
+            else
+                step = 1;
+
+            FILE *timing_fp = fopen(pSPARC->TimingFilename, timing_nreports ? "a" : "w");
+            if (timing_fp == NULL) {
+                printf("\nCannot open file \"%s\"\n", pSPARC->TimingFilename);
+                exit(EXIT_FAILURE);
+            }
+            if (timing_nreports == 0) {
+                fprintf(timing_fp, "# Timings and counters of each region, reduced over all processes that entered it.\n");
+                fprintf(timing_fp, "# Regions are nested with '/'. Time is in seconds, bytes and flops are the totals\n");
+                fprintf(timing_fp, "# over all processes, calls is the maximum over the processes.\n");
+            }
+            fprintf(timing_fp, ":STEP: %d\n", step);
+            fprintf(timing_fp, ":NPROC: %d\n", nproc);
+            fprintf(timing_fp, ":NREGION: %d\n", nunion);
+            fprintf(timing_fp, ":COLUMNS: region calls nproc t_min t_avg t_max bytes flops\n");
+            for (u = 0; u < nunion; u++) {
+                int nentered = (int)(vsum[4*u+3] + 0.5);
+                if (nentered == 0) continue;
+                fprintf(timing_fp, "%s %.0f %d %.6E %.6E %.6E %.6E %.6E\n",
+                        all_paths + u*TIMING_PATH_LEN, vmax[2*u+1], nentered,
+                        vmin[u], vsum[4*u] / nentered, vmax[2*u], vsum[4*u+1], vsum[4*u+2]);
+            }
+            fclose(timing_fp);
+        }
+        timing_nreports++;
+
+        free(vsum);
+        free(vmax);
+        free(vmin);
+        free(all_paths);
+        free(paths);
+    }
+
+    // start a new record
+    for (r = 0; r < timing_nregions; r++) {
+        timing_regions[r].calls = 0.0;
+        timing_regions[r].time  = 0.0;
+        timing_regions[r].bytes = 0.0;
+        timing_regions[r].flops = 0.0;
+    }
+}
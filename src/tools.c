@@ -592,6 +592,53 @@ void SplineInterpUniform(
 
 
 
+/**
+ * @brief   Tabulate the cubic spline coefficients of all intervals of a
+ *          uniform grid X1, tab[4*j..4*j+3] = A0, A1, A2, A3 of (X1[j],X1[j+1]).
+ */
+void SplineTableUniform(double *X1, double *Y1, int len1, double *YD, double *tab)
+{
+	int j;
+	double dx, dy;
+	for (j = 0; j < len1-1; j++) {
+		dx = 1.0 / (X1[j+1] - X1[j]);
+		dy = (Y1[j+1] - Y1[j]) * dx;
+		tab[4*j  ] = Y1[j];
+		tab[4*j+1] = YD[j];
+		tab[4*j+2] = dx * (3.0 * dy - 2.0 * YD[j] - YD[j+1]);
+		tab[4*j+3] = dx * dx * (-2.0*dy + YD[j] + YD[j+1]);
+	}
+}
+
+
+
+/**
+ * @brief   Cubic spline evaluation from the coefficient table created by
+ *          SplineTableUniform. Same result as SplineInterpUniform, points
+ *          beyond X1[len1-1] are left untouched.
+ */
+void SplineInterpUniformTable(
+	const double *X1, int len1, const double *tab, const double *X2, double *Y2, int len2
+)
+{
+	if (len2 <= 0 || len1 < 2) return;
+	const double X1_min = X1[0], X1_max = X1[len1-1];
+	const double delta_x1 = X1[1] - X1[0];
+	const int jmax = len1 - 2;
+	#pragma omp simd
+	for (int i = 0; i < len2; i++) {
+		double p2 = X2[i];
+		int j = (int) floor((p2 - X1_min) / delta_x1);
+		j = j < 0 ? 0 : (j > jmax ? jmax : j);
+		const double *A = tab + 4*j;
+		double x = p2 - X1[j];
+		double y = ((A[3]*x + A[2]) * x + A[1]) * x + A[0];
+		Y2[i] = (p2 > X1_max) ? Y2[i] : y;
+	}
+}
+
+
+
 /**
  * @brief   Cubic spline evaluation from precalculated data. This function
  *          assumes X1 is a monotically increasing grid (but not necessarily
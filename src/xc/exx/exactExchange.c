@@ -43,10 +43,12 @@
 #include "lapVecRoutines.h"
 #include "linearSolver.h"
 #include "exactExchangeKpt.h"
+#include "exactExchangeISDF.h"
 #include "tools.h"
 #include "parallelization.h"
 #include "electronicGroundState.h"
 #include "exchangeCorrelation.h"
+#include "pencilFFT.h"
 
 #define max(a,b) ((a)>(b)?(a):(b))
 #define min(a,b) ((a)<(b)?(a):(b))
@@ -136,6 +138,15 @@ void Exact_Exchange_loop(SPARC_OBJ *pSPARC) {
                 if(!rank) 
                     printf("\nGathering all bands of psi_outer to each dmcomm took : %.3f ms\n", (t2-t1)*1e3);
                 #endif 
+                if (pSPARC->ISDFFlag == 1) {
+                    t1 = MPI_Wtime();
+                    ISDF_exchange_operator(pSPARC, pSPARC->psi_outer, pSPARC->occ_outer);
+                    t2 = MPI_Wtime();
+                    #ifdef DEBUG
+                    if(!rank) 
+                        printf("\nCreating ISDF exact exchange operator took : %.3f ms\n", (t2-t1)*1e3);
+                    #endif 
+                }
             } else {
                 // Gathering all outer orbitals and outer occ
                 t1 = MPI_Wtime();
@@ -298,7 +309,11 @@ void exact_exchange_potential(SPARC_OBJ *pSPARC, double *X, int ldx, int ncol, i
         }
         occ = (pSPARC->spin_typ == 1) ? (pSPARC->occ_outer + spin * occ_outer_shift) : pSPARC->occ_outer;
         double *psi_outer = (Lanczos_flag == 0) ? pSPARC->psi_outer + spin* DMnd : pSPARC->psi_outer_kptcomm_topo + spin* DMnd;
-        evaluate_exact_exchange_potential(pSPARC, X, ldx, ncol, DMnd, dims, occ, psi_outer, DMndsp, Hx, ldhx, comm);
+        // ISDF operator only lives in dmcomm, Lanczos in kptcomm_topo uses all pairs
+        if (pSPARC->ISDFFlag == 1 && Lanczos_flag == 0)
+            ISDF_exchange_apply(pSPARC, X, ldx, ncol, spin, -pSPARC->exx_frac, Hx, ldhx);
+        else
+            evaluate_exact_exchange_potential(pSPARC, X, ldx, ncol, DMnd, dims, occ, psi_outer, DMndsp, Hx, ldhx, comm);
     } else {
         Xi = (Lanczos_flag == 0) ? pSPARC->Xi + spin * DMnd : pSPARC->Xi_kptcomm_topo + spin * DMnd;
         evaluate_exact_exchange_potential_ACE(pSPARC, X, ldx, ncol, DMnd, Xi, DMndsp, Hx, ldhx, comm);
@@ -495,6 +510,15 @@ void evaluate_exact_exchange_energy(SPARC_OBJ *pSPARC) {
             occ_outer = (pSPARC->spin_typ == 1) ? (pSPARC->occ_outer + spinor * Ns) : pSPARC->occ_outer;
             psi = pSPARC->Xorb + spinor * DMnd;
 
+            if (pSPARC->ISDFFlag == 1) {
+                temp = 0.0;
+                ISDF_exchange_pair_terms(pSPARC, spinor, psi_outer, DMndsp, occ_outer, ISDF_ENERGY, &temp);
+                if (size > 1)
+                    MPI_Allreduce(MPI_IN_PLACE, &temp, 1,  MPI_DOUBLE, MPI_SUM, pSPARC->dmcomm);
+                pSPARC->Eexx += temp;
+                continue;
+            }
+
             // Find the number of Poisson's equation required to be solved
             // Using the occupation threshold 1e-6
             int count = 0;
@@ -627,6 +651,11 @@ void poissonSolve(SPARC_OBJ *pSPARC, double *rhs, double *pois_FFT_const,
     rhs_loc = Vi_loc = rhs_loc_order = Vi_loc_order = f = NULL;
     DMVertices = NULL;
 
+    if (pSPARC->EXXMeth_Flag == 0) {                                                // Solve in Fourier Space
+        pois_fft(pSPARC, rhs, pois_FFT_const, ncol, Vi, comm);
+        return;
+    }
+
     MPI_Comm_size(comm, &lsize);
     MPI_Comm_rank(comm, &lrank);    
     Nd = pSPARC->Nd;
@@ -710,15 +739,12 @@ void poissonSolve(SPARC_OBJ *pSPARC, double *rhs, double *pois_FFT_const,
         Vi_loc = Vi;
     }   
 
-    if (pSPARC->EXXMeth_Flag == 0) {                                                // Solve in Fourier Space
-        pois_fft(pSPARC, rhs_loc_order, pois_FFT_const, ncolp, Vi_loc);
-    } else {
-        f = malloc(sizeof(double) * ncolp * Nd);
-        assert(f != NULL);
-        poisson_RHS_local(pSPARC, rhs_loc_order, f, Nd, ncolp);
-        pois_linearsolver(pSPARC, f, ncolp, Vi_loc);                                // Solve in Real Space
-        free(f);
-    }
+    // Solve in Real Space
+    f = malloc(sizeof(double) * ncolp * Nd);
+    assert(f != NULL);
+    poisson_RHS_local(pSPARC, rhs_loc_order, f, Nd, ncolp);
+    pois_linearsolver(pSPARC, f, ncolp, Vi_loc);
+    free(f);
     
     if (lsize > 1)  
         free(rhs_loc_order);
@@ -774,56 +800,77 @@ void poisson_RHS_local(SPARC_OBJ *pSPARC, double *rhs, double *f, int Nd, int nc
 /**
  * @brief   Solve Poisson's equation using FFT in Fourier Space
  * 
- * @param rhs_loc_order     complete RHS of poisson's equations without parallelization. 
+ * @param rhs               RHS of poisson's equations in the domain decomposition of comm. 
  * @param pois_FFT_const    constant for solving possion's equations
- * @param ncolp             Number of poisson's equations to be solved.
- * @param Vi_loc            complete solutions of poisson's equations without parallelization. 
- * Note:                    This function is complete localized. 
+ * @param ncol              Number of poisson's equations to be solved.
+ * @param Vi                solutions of poisson's equations in the domain decomposition of comm. 
+ * Note:                    All equations are solved together by the parallel FFT over comm. 
  */
-void pois_fft(SPARC_OBJ *pSPARC, double *rhs_loc_order, double *pois_FFT_const, int ncolp, double *Vi_loc) {
-    if (ncolp == 0) return;
-    int i, j, Nd, Nx, Ny, Nz, Ndc;
+void pois_fft(SPARC_OBJ *pSPARC, double *rhs, double *pois_FFT_const, int ncol, double *Vi, MPI_Comm comm) {
+    if (ncol == 0) return;
+    int i, j, k, n, lrank, Nx, Ny, Nz, Nxc, nd, *box;
+    double scale;
     double _Complex *rhs_bar;
+    PENCIL_FFT_OBJ *plan;
 
-    Nd = pSPARC->Nd;
     Nx = pSPARC->Nx; Ny = pSPARC->Ny; Nz = pSPARC->Nz; 
-    Ndc = Nz * Ny * (Nx/2+1);
-    rhs_bar = (double _Complex*) malloc(sizeof(double _Complex) * Ndc * ncolp);
-    assert(rhs_bar != NULL);
+    Nxc = Nx/2+1;
+    scale = 1.0 / pSPARC->Nd;                                               // normalization of iFFT
+    MPI_Comm_rank(comm, &lrank);
     /********************************************************************/
 
-    // FFT
-#if defined(USE_MKL)
-    MKL_LONG dim_sizes[3] = {Nz, Ny, Nx};
-    MKL_LONG strides_out[4] = {0, Ny*(Nx/2+1), Nx/2+1, 1}; 
-
-    for (i = 0; i < ncolp; i++)
-        MKL_MDFFT_real(rhs_loc_order + i * Nd, dim_sizes, strides_out, rhs_bar + i * Ndc);
-#elif defined(USE_FFTW)
-    int dim_sizes[3] = {Nz, Ny, Nx};
-
-    for (i = 0; i < ncolp; i++)
-        FFTW_MDFFT_real(dim_sizes, rhs_loc_order + i * Nd, rhs_bar + i * Ndc);
-#endif
+    plan = get_exx_fft_plan(pSPARC, comm, 0, ncol);
 
-    // multiplied by alpha
-    for (j = 0; j < ncolp; j++) {
-        for (i = 0; i < Ndc; i++) {
-            rhs_bar[i + j*Ndc] = creal(rhs_bar[i + j*Ndc]) * pois_FFT_const[i] 
-                                + (cimag(rhs_bar[i + j*Ndc]) * pois_FFT_const[i]) * I;
+    // FFT
+    Pencil_FFT_forward(plan, rhs, ncol);
+
+    // multiplied by alpha, the local frequencies are stored as z-pencils
+    box = plan->zp_box + 6*lrank;
+    nd = box[1] * box[3] * box[5];
+    rhs_bar = (double _Complex *) plan->work2;
+    for (n = 0; n < ncol; n++) {
+        for (j = 0; j < box[3]; j++) {
+            for (i = 0; i < box[1]; i++) {
+                double _Complex *rhs_line = rhs_bar + n*nd + (j*box[1] + i)*Nz;
+                double *alpha = pois_FFT_const + (j+box[2])*Nxc + i+box[0];
+                for (k = 0; k < Nz; k++) {
+                    rhs_line[k] *= alpha[k*Ny*Nxc] * scale;
+                }
+            }
         }
     }
 
     // iFFT
-#if defined(USE_MKL)
-    for (i = 0; i < ncolp; i++)
-        MKL_MDiFFT_real(rhs_bar + i * Ndc, dim_sizes, strides_out, Vi_loc + i * Nd);
-#elif defined(USE_FFTW)
-    for (i = 0; i < ncolp; i++)
-        FFTW_MDiFFT_real(dim_sizes, rhs_bar + i * Ndc, Vi_loc + i * Nd);
-#endif
+    Pencil_FFT_backward(plan, Vi, ncol);
+}
+
 
-    free(rhs_bar);
+/**
+ * @brief   Find the persistent parallel FFT plan on comm for the transform type 
+ *          is_complex and the current grid, create it if it doesn't exist
+ *
+ *          Plans are kept for at most 2 communicators (dmcomm and kptcomm_topo).
+ *          A plan on the same comm for another transform type or grid is replaced.
+ */
+PENCIL_FFT_OBJ *get_exx_fft_plan(SPARC_OBJ *pSPARC, MPI_Comm comm, int is_complex, int ncol) {
+    int i, gridsizes[3];
+    gridsizes[0] = pSPARC->Nx; gridsizes[1] = pSPARC->Ny; gridsizes[2] = pSPARC->Nz;
+    for (i = 0; i < 2; i++) {
+        PENCIL_FFT_OBJ *plan = pSPARC->ExxFFT[i];
+        if (plan != NULL && plan->comm == comm && plan->is_complex == is_complex
+            && plan->N[0] == gridsizes[0] && plan->N[1] == gridsizes[1] && plan->N[2] == gridsizes[2])
+            return plan;
+    }
+    if (pSPARC->ExxFFT[0] == NULL || pSPARC->ExxFFT[0]->comm == comm) i = 0;
+    else i = 1;
+    if (pSPARC->ExxFFT[i] != NULL) {
+        Pencil_FFT_free(pSPARC->ExxFFT[i]);
+    } else {
+        pSPARC->ExxFFT[i] = (PENCIL_FFT_OBJ *) malloc(sizeof(PENCIL_FFT_OBJ));
+        assert(pSPARC->ExxFFT[i] != NULL);
+    }
+    Pencil_FFT_init(pSPARC->ExxFFT[i], gridsizes, is_complex, ncol, comm);
+    return pSPARC->ExxFFT[i];
 }
 
 
@@ -13,6 +13,7 @@
 #include <mpi.h>
 
 #include "exactExchangeFinalization.h"
+#include "pencilFFT.h"
 
 /**
  * @brief   Memory free of all variables for exact exchange.
@@ -59,6 +60,10 @@ void free_exx(SPARC_OBJ *pSPARC) {
         }
     }
 
+    free(pSPARC->ISDF_pts);
+    free(pSPARC->ISDF_W);
+    free(pSPARC->wpbe_tab);
+
     if (pSPARC->EXXMeth_Flag == 0) {
         if (pSPARC->dmcomm != MPI_COMM_NULL || pSPARC->kptcomm_topo != MPI_COMM_NULL) {
             free(pSPARC->pois_FFT_const);
@@ -73,6 +78,13 @@ void free_exx(SPARC_OBJ *pSPARC) {
         }
     }
 
+    for (int i = 0; i < 2; i++) {
+        if (pSPARC->ExxFFT[i] != NULL) {
+            Pencil_FFT_free(pSPARC->ExxFFT[i]);
+            free(pSPARC->ExxFFT[i]);
+        }
+    }
+
     if (pSPARC->Nkpts_shift > 1) {
         free(pSPARC->neg_phase);
         free(pSPARC->pos_phase);
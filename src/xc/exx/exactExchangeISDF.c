@@ -0,0 +1,598 @@
+/***
+ * @file    exactExchangeISDF.c
+ * @brief   This file contains the functions for the interpolative separable
+ *          density fitting (ISDF) of exact exchange.
+ *
+ *          The pair products psi_i(r) * psi_j(r) are approximated by
+ *          sum_mu zeta_mu(r) psi_i(r_mu) psi_j(r_mu) on a set of N_mu interpolation
+ *          points r_mu, so only N_mu Poisson's equations are solved instead of
+ *          one for each pair of orbitals.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <mpi.h>
+/** BLAS and LAPACK routines */
+#ifdef USE_MKL
+    #include <mkl.h>
+#else
+    #include <cblas.h>
+    #include <lapacke.h>
+#endif
+
+#include "exactExchange.h"
+#include "exactExchangeISDF.h"
+#include "gradVecRoutines.h"
+#include "tools.h"
+#include "parallelization.h"
+
+#define max(a,b) ((a)>(b)?(a):(b))
+#define min(a,b) ((a)<(b)?(a):(b))
+
+#define ISDF_OVERSAMPLE (16)        // extra columns of the random sketch
+#define ISDF_QRCP_TOL (1e-14)       // relative tolerance of the squared column norms in QRCP
+#define ISDF_PINV_TOL (1e-12)       // relative tolerance of eigenvalues in the pseudo-inverse
+#define ISDF_SEED (1)               // seed of the random sketch, same on all processes
+
+
+/**
+ * @brief   Find the local index of a global grid index in the domain DMVertices, -1 if not owned
+ */
+static int ISDF_local_index(SPARC_OBJ *pSPARC, int *DMVertices, int gidx)
+{
+    int Nx = pSPARC->Nx, Ny = pSPARC->Ny;
+    int gi = gidx % Nx;
+    int gj = (gidx / Nx) % Ny;
+    int gk = gidx / (Nx * Ny);
+    if (gi < DMVertices[0] || gi > DMVertices[1] ||
+        gj < DMVertices[2] || gj > DMVertices[3] ||
+        gk < DMVertices[4] || gk > DMVertices[5]) return -1;
+    int nx = DMVertices[1] - DMVertices[0] + 1;
+    int ny = DMVertices[3] - DMVertices[2] + 1;
+    return (gi - DMVertices[0]) + (gj - DMVertices[2]) * nx + (gk - DMVertices[4]) * nx * ny;
+}
+
+
+/**
+ * @brief   Find the values of X at the interpolation points, Xmu is ISDF_Npts x ncol in all dmcomm
+ */
+static void ISDF_point_values(SPARC_OBJ *pSPARC, double *X, int ldx, int ncol, double *Xmu)
+{
+    int mu, n, l, size, Nmu = pSPARC->ISDF_Npts;
+    MPI_Comm_size(pSPARC->dmcomm, &size);
+
+    memset(Xmu, 0, sizeof(double) * Nmu * ncol);
+    for (mu = 0; mu < Nmu; mu++) {
+        l = ISDF_local_index(pSPARC, pSPARC->DMVertices_dmcomm, pSPARC->ISDF_pts[mu]);
+        if (l < 0) continue;
+        for (n = 0; n < ncol; n++)
+            Xmu[mu + n*Nmu] = X[l + n*ldx];
+    }
+    if (size > 1)
+        MPI_Allreduce(MPI_IN_PLACE, Xmu, Nmu * ncol, MPI_DOUBLE, MPI_SUM, pSPARC->dmcomm);
+}
+
+
+/**
+ * @brief   Fit the interpolation vectors zeta of the pair products X_i * psi_j
+ *
+ *          The pairs are weighted by wX_i * w_j. zeta = (D_X .* D_psi) * C^+ where
+ *          D_X = X diag(wX) Xmu' and C = (Xmu diag(wX) Xmu') .* (psimu diag(w) psimu').
+ *          C is copied into CC if it is not NULL.
+ */
+static void ISDF_fit(SPARC_OBJ *pSPARC, double *X, int ldx, double *Xmu, double *wX, int nX,
+    double *psi, int ldp, double *psimu, double *w, int np, double *zeta, double *CC)
+{
+    int i, mu, DMnd, Nmu;
+    double *Xmuw, *psimuw, *DX, *C, *Cp, *lambda;
+
+    DMnd = pSPARC->Nd_d_dmcomm;
+    Nmu = pSPARC->ISDF_Npts;
+
+    Xmuw = (double *) malloc(sizeof(double) * Nmu * nX);
+    psimuw = (double *) malloc(sizeof(double) * Nmu * np);
+    DX = (double *) malloc(sizeof(double) * DMnd * Nmu);
+    C = (double *) malloc(sizeof(double) * Nmu * Nmu);
+    Cp = (double *) malloc(sizeof(double) * Nmu * Nmu);
+    lambda = (double *) malloc(sizeof(double) * Nmu);
+    assert(Xmuw != NULL && psimuw != NULL && DX != NULL && C != NULL && Cp != NULL && lambda != NULL);
+
+    for (i = 0; i < nX; i++)
+        for (mu = 0; mu < Nmu; mu++)
+            Xmuw[mu + i*Nmu] = Xmu[mu + i*Nmu] * wX[i];
+    for (i = 0; i < np; i++)
+        for (mu = 0; mu < Nmu; mu++)
+            psimuw[mu + i*Nmu] = psimu[mu + i*Nmu] * w[i];
+
+    // Z * C' = (X diag(wX) Xmu') .* (psi diag(w) psimu')
+    cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, DMnd, Nmu, nX,
+                1.0, X, ldx, Xmuw, Nmu, 0.0, DX, DMnd);
+    cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, DMnd, Nmu, np,
+                1.0, psi, ldp, psimuw, Nmu, 0.0, zeta, DMnd);
+    for (i = 0; i < DMnd * Nmu; i++) zeta[i] *= DX[i];
+
+    // C * C' = (Xmu diag(wX) Xmu') .* (psimu diag(w) psimu')
+    cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, Nmu, Nmu, nX,
+                1.0, Xmuw, Nmu, Xmu, Nmu, 0.0, C, Nmu);
+    cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, Nmu, Nmu, np,
+                1.0, psimuw, Nmu, psimu, Nmu, 0.0, Cp, Nmu);
+    for (i = 0; i < Nmu * Nmu; i++) C[i] *= Cp[i];
+    if (CC != NULL) memcpy(CC, C, sizeof(double) * Nmu * Nmu);
+
+    // zeta = (Z * C') * (C * C')^+, with the pseudo-inverse from the eigendecomposition
+    LAPACKE_dsyevd(LAPACK_COL_MAJOR, 'V', 'U', Nmu, C, Nmu, lambda);
+    cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, DMnd, Nmu, Nmu,
+                1.0, zeta, DMnd, C, Nmu, 0.0, DX, DMnd);
+    for (mu = 0; mu < Nmu; mu++) {
+        double scale = (lambda[mu] > ISDF_PINV_TOL * lambda[Nmu-1]) ? 1.0 / lambda[mu] : 0.0;
+        for (i = 0; i < DMnd; i++) DX[i + mu*DMnd] *= scale;
+    }
+    cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, DMnd, Nmu, Nmu,
+                1.0, DX, DMnd, C, Nmu, 0.0, zeta, DMnd);
+
+    free(Xmuw);
+    free(psimuw);
+    free(DX);
+    free(C);
+    free(Cp);
+    free(lambda);
+}
+
+
+/**
+ * @brief   Solve Poisson's equations of ncol right hand sides in dmcomm in batches
+ */
+static void ISDF_poisson(SPARC_OBJ *pSPARC, double *rhs, double *pois_FFT_const, int ncol, double *V)
+{
+    int base, nb, batch, dims[3], DMnd = pSPARC->Nd_d_dmcomm;
+    dims[0] = pSPARC->npNdx; dims[1] = pSPARC->npNdy; dims[2] = pSPARC->npNdz;
+    batch = pSPARC->EXXMem_batch == 0 ? ncol : pSPARC->EXXMem_batch * pSPARC->npNd;
+    for (base = 0; base < ncol; base += batch) {
+        nb = min(batch, ncol - base);
+        poissonSolve(pSPARC, rhs + base*DMnd, pois_FFT_const, nb, DMnd, dims, V + base*DMnd, pSPARC->dmcomm);
+    }
+}
+
+
+/**
+ * @brief   Find the interpolation vectors assigned to current process in blacscomm
+ */
+static void ISDF_blacs_split(SPARC_OBJ *pSPARC, int *nstart, int *nloc)
+{
+    int rank = 0, size = 1, Nmu = pSPARC->ISDF_Npts;
+    if (pSPARC->blacscomm != MPI_COMM_NULL) {
+        MPI_Comm_rank(pSPARC->blacscomm, &rank);
+        MPI_Comm_size(pSPARC->blacscomm, &size);
+    }
+    *nstart = block_decompose_nstart(Nmu, size, rank);
+    *nloc = block_decompose(Nmu, size, rank);
+}
+
+
+/**
+ * @brief   Column-pivoted QR of A (m x ncand), at most nsel pivots are kept
+ *
+ *          A is overwritten. Columns whose squared norm drops below
+ *          ISDF_QRCP_TOL times the largest one are not selected.
+ *
+ * @return  Number of selected columns, their indices are in piv
+ */
+static int ISDF_qrcp(double *A, int m, int ncand, int nsel, int *piv)
+{
+    int j, k, p, n;
+    double *norms, *c, *u, max0;
+
+    if (ncand == 0 || nsel == 0) return 0;
+    norms = (double *) malloc(sizeof(double) * ncand);
+    c = (double *) malloc(sizeof(double) * ncand);
+    u = (double *) malloc(sizeof(double) * m);
+    assert(norms != NULL && c != NULL && u != NULL);
+    for (j = 0; j < ncand; j++) {
+        norms[j] = 0.0;
+        for (k = 0; k < m; k++)
+            norms[j] += A[k + j*m] * A[k + j*m];
+    }
+
+    max0 = 0.0;
+    for (n = 0; n < nsel; n++) {
+        p = 0;
+        for (j = 1; j < ncand; j++)
+            if (norms[j] > norms[p]) p = j;
+        if (n == 0) max0 = norms[p];
+        if (norms[p] <= ISDF_QRCP_TOL * max0 || norms[p] <= 0.0) break;
+        piv[n] = p;
+
+        // remove the pivot direction from all columns and downdate the norms
+        for (k = 0; k < m; k++) u[k] = A[k + p*m] / sqrt(norms[p]);
+        cblas_dgemv(CblasColMajor, CblasTrans, m, ncand, 1.0, A, m, u, 1, 0.0, c, 1);
+        cblas_dger(CblasColMajor, m, ncand, -1.0, u, 1, c, 1, A, m);
+        for (j = 0; j < ncand; j++) norms[j] -= c[j] * c[j];
+        norms[p] = -1.0;
+    }
+
+    free(norms);
+    free(c);
+    free(u);
+    return n;
+}
+
+
+/**
+ * @brief   Keep the candidate columns of cand (ld x ncand) selected by ISDF_qrcp
+ *
+ *          The last row of each candidate is its global grid index and is not
+ *          part of the factorization.
+ *
+ * @return  Number of candidates kept in the leading columns of cand
+ */
+static int ISDF_qrcp_candidates(double *cand, int ld, int ncand, int nsel)
+{
+    int j, n, *piv;
+    double *A, *keep;
+
+    if (ncand == 0) return 0;
+    A = (double *) malloc(sizeof(double) * (ld-1) * ncand);
+    piv = (int *) malloc(sizeof(int) * nsel);
+    assert(A != NULL && piv != NULL);
+    for (j = 0; j < ncand; j++)
+        memcpy(A + j*(ld-1), cand + j*ld, sizeof(double) * (ld-1));
+    n = ISDF_qrcp(A, ld-1, ncand, nsel, piv);
+    free(A);
+
+    keep = (double *) malloc(sizeof(double) * ld * max(1, n));
+    assert(keep != NULL);
+    for (j = 0; j < n; j++)
+        memcpy(keep + j*ld, cand + piv[j]*ld, sizeof(double) * ld);
+    memcpy(cand, keep, sizeof(double) * ld * n);
+    free(keep);
+    free(piv);
+    return n;
+}
+
+
+/**
+ * @brief   Select the ISDF interpolation points from the orbitals psi.
+ */
+void ISDF_select_points(SPARC_OBJ *pSPARC, double *psi, double *occ)
+{
+    int i, j, k, n, r, s, rank, size, step, DMnd, DMndsp, Ns, Nspinor, Nocc, Nmu, q, ncolM, ld, ncand;
+    int nx, ny, *DMV;
+    double *G1, *G2, *A, *B, *M, *cand;
+
+    DMnd = pSPARC->Nd_d_dmcomm;
+    DMndsp = DMnd * pSPARC->Nspinor_spincomm;
+    Ns = pSPARC->Nstates;
+    Nspinor = pSPARC->Nspinor_spincomm;
+    DMV = pSPARC->DMVertices_dmcomm;
+    nx = DMV[1] - DMV[0] + 1;
+    ny = DMV[3] - DMV[2] + 1;
+    MPI_Comm_rank(pSPARC->dmcomm, &rank);
+    MPI_Comm_size(pSPARC->dmcomm, &size);
+
+    // number of points from the number of occupied states
+    Nocc = 0;
+    for (s = 0; s < Nspinor; s++) {
+        double *occ_s = (pSPARC->spin_typ == 1) ? (occ + s*Ns) : occ;
+        for (n = 0, j = 0; j < Ns; j++)
+            if (occ_s[j] > 1e-6) n++;
+        Nocc = max(Nocc, n);
+    }
+    Nmu = (int) ceil(pSPARC->EXXISDF_ratio * Nocc);
+    Nmu = min(Nmu, Nocc * Ns);
+    Nmu = min(Nmu, pSPARC->Nd);
+
+    free(pSPARC->ISDF_pts);
+    pSPARC->ISDF_pts = (int *) malloc(sizeof(int) * max(1, Nmu));
+    assert(pSPARC->ISDF_pts != NULL);
+    pSPARC->ISDF_Npts = 0;
+    if (Nmu == 0) return;
+
+    // random sketch of the pair products, M(r,:) = (psi(r,:) * G1) .* (psi(r,:) * diag(sqrt(occ)) * G2)
+    q = Nmu + ISDF_OVERSAMPLE;
+    ncolM = q * Nspinor;
+    G1 = (double *) malloc(sizeof(double) * Ns * q);
+    G2 = (double *) malloc(sizeof(double) * Ns * q);
+    A = (double *) malloc(sizeof(double) * DMnd * q);
+    B = (double *) malloc(sizeof(double) * DMnd * q);
+    M = (double *) malloc(sizeof(double) * DMnd * ncolM);
+    assert(G1 != NULL && G2 != NULL && A != NULL && B != NULL && M != NULL);
+
+    srand(ISDF_SEED);
+    for (s = 0; s < Nspinor; s++) {
+        double *occ_s = (pSPARC->spin_typ == 1) ? (occ + s*Ns) : occ;
+        for (i = 0; i < Ns * q; i++) G1[i] = 2.0 * ((double) rand() / RAND_MAX) - 1.0;
+        for (i = 0; i < Ns * q; i++) G2[i] = 2.0 * ((double) rand() / RAND_MAX) - 1.0;
+        for (k = 0; k < q; k++)
+            for (j = 0; j < Ns; j++)
+                G2[j + k*Ns] *= (occ_s[j] > 1e-6) ? sqrt(occ_s[j]) : 0.0;
+
+        cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, DMnd, q, Ns,
+                    1.0, psi + s*DMnd, DMndsp, G1, Ns, 0.0, A, DMnd);
+        cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, DMnd, q, Ns,
+                    1.0, psi + s*DMnd, DMndsp, G2, Ns, 0.0, B, DMnd);
+        for (i = 0; i < DMnd * q; i++)
+            M[i + s*DMnd*q] = A[i] * B[i];
+    }
+    free(G1); free(G2); free(A); free(B);
+
+    // each grid point is a candidate column of M', followed by its global grid index
+    ld = ncolM + 1;
+    cand = (double *) malloc(sizeof(double) * ld * max(DMnd, 2*Nmu));
+    assert(cand != NULL);
+    for (r = 0; r < DMnd; r++) {
+        for (k = 0; k < ncolM; k++)
+            cand[k + r*ld] = M[r + k*DMnd];
+        i = r % nx; j = (r / nx) % ny; k = r / (nx * ny);
+        cand[ncolM + r*ld] = (i + DMV[0]) + (j + DMV[2]) * pSPARC->Nx + (k + DMV[4]) * pSPARC->Nx * pSPARC->Ny;
+    }
+    free(M);
+
+    // tournament pivoting: QRCP of the local points, then pairwise merges of
+    // the selected candidates up a binary tree over dmcomm
+    ncand = ISDF_qrcp_candidates(cand, ld, DMnd, Nmu);
+    for (step = 1; step < size; step *= 2) {
+        if (rank % (2*step) == step) {
+            MPI_Send(&ncand, 1, MPI_INT, rank - step, 0, pSPARC->dmcomm);
+            MPI_Send(cand, ld * ncand, MPI_DOUBLE, rank - step, 1, pSPARC->dmcomm);
+            break;
+        } else if (rank % (2*step) == 0 && rank + step < size) {
+            MPI_Recv(&n, 1, MPI_INT, rank + step, 0, pSPARC->dmcomm, MPI_STATUS_IGNORE);
+            MPI_Recv(cand + ld * ncand, ld * n, MPI_DOUBLE, rank + step, 1, pSPARC->dmcomm, MPI_STATUS_IGNORE);
+            ncand = ISDF_qrcp_candidates(cand, ld, ncand + n, Nmu);
+        }
+    }
+    if (rank == 0) {
+        for (n = 0; n < ncand; n++)
+            pSPARC->ISDF_pts[n] = (int) cand[ncolM + n*ld];
+        pSPARC->ISDF_Npts = ncand;
+    }
+    free(cand);
+    if (size > 1) {
+        MPI_Bcast(&pSPARC->ISDF_Npts, 1, MPI_INT, 0, pSPARC->dmcomm);
+        MPI_Bcast(pSPARC->ISDF_pts, pSPARC->ISDF_Npts, MPI_INT, 0, pSPARC->dmcomm);
+    }
+
+    // all band groups use the same points
+    if (pSPARC->npband > 1 && pSPARC->blacscomm != MPI_COMM_NULL) {
+        MPI_Bcast(&pSPARC->ISDF_Npts, 1, MPI_INT, 0, pSPARC->blacscomm);
+        MPI_Bcast(pSPARC->ISDF_pts, pSPARC->ISDF_Npts, MPI_INT, 0, pSPARC->blacscomm);
+    }
+
+#ifdef DEBUG
+    int grank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &grank);
+    if (!grank) printf("ISDF: selected %d interpolation points for %d occupied states.\n", pSPARC->ISDF_Npts, Nocc);
+#endif
+}
+
+
+/**
+ * @brief   Create the ISDF exact exchange operator from the orbitals psi.
+ */
+void ISDF_exchange_operator(SPARC_OBJ *pSPARC, double *psi, double *occ)
+{
+    if (pSPARC->spincomm_index < 0 || pSPARC->bandcomm_index < 0 || pSPARC->dmcomm == MPI_COMM_NULL) return;
+    int i, j, mu, s, DMnd, DMndsp, Ns, Nmu, nstart, nloc, blacs_size;
+    int *recvcounts, *displs;
+    double *psimu, *w, *ones, *zeta, *V, *W;
+
+    DMnd = pSPARC->Nd_d_dmcomm;
+    DMndsp = DMnd * pSPARC->Nspinor_spincomm;
+    Ns = pSPARC->Nstates;
+
+    ISDF_select_points(pSPARC, psi, occ);
+    Nmu = pSPARC->ISDF_Npts;
+
+    free(pSPARC->ISDF_W);
+    pSPARC->ISDF_W = (double *) calloc(DMndsp * max(1, Nmu), sizeof(double));
+    assert(pSPARC->ISDF_W != NULL);
+    if (Nmu == 0) return;
+
+    blacs_size = 1;
+    if (pSPARC->blacscomm != MPI_COMM_NULL)
+        MPI_Comm_size(pSPARC->blacscomm, &blacs_size);
+    ISDF_blacs_split(pSPARC, &nstart, &nloc);
+    recvcounts = (int *) malloc(sizeof(int) * blacs_size);
+    displs = (int *) malloc(sizeof(int) * blacs_size);
+    assert(recvcounts != NULL && displs != NULL);
+    for (i = 0; i < blacs_size; i++) {
+        recvcounts[i] = block_decompose(Nmu, blacs_size, i) * DMnd;
+        displs[i] = block_decompose_nstart(Nmu, blacs_size, i) * DMnd;
+    }
+
+    psimu = (double *) malloc(sizeof(double) * Nmu * Ns);
+    w = (double *) malloc(sizeof(double) * Ns);
+    ones = (double *) malloc(sizeof(double) * Ns);
+    zeta = (double *) malloc(sizeof(double) * DMnd * Nmu);
+    V = (double *) malloc(sizeof(double) * DMnd * Nmu);
+    assert(psimu != NULL && w != NULL && ones != NULL && zeta != NULL && V != NULL);
+
+    for (s = 0; s < pSPARC->Nspinor_spincomm; s++) {
+        double *occ_s = (pSPARC->spin_typ == 1) ? (occ + s*Ns) : occ;
+        int count = 0;
+        for (j = 0; j < Ns; j++) {
+            w[j] = (occ_s[j] > 1e-6) ? occ_s[j] : 0.0;
+            ones[j] = 1.0;
+            if (occ_s[j] > 1e-6) count++;
+        }
+        if (count == 0) continue;
+
+        // fit the pairs of all orbitals with the occupied orbitals
+        ISDF_point_values(pSPARC, psi + s*DMnd, DMndsp, Ns, psimu);
+        ISDF_fit(pSPARC, psi + s*DMnd, DMndsp, psimu, ones, Ns,
+                 psi + s*DMnd, DMndsp, psimu, w, Ns, zeta, NULL);
+
+        // V = K zeta, the Poisson's equations are split over band groups
+        ISDF_poisson(pSPARC, zeta + nstart*DMnd, pSPARC->pois_FFT_const, nloc, V + nstart*DMnd);
+        if (blacs_size > 1)
+            MPI_Allgatherv(MPI_IN_PLACE, 1, MPI_DOUBLE, V, recvcounts, displs, MPI_DOUBLE, pSPARC->blacscomm);
+
+        // W = V .* (psi diag(occ) psimu')
+        for (j = 0; j < Ns; j++)
+            for (mu = 0; mu < Nmu; mu++)
+                psimu[mu + j*Nmu] *= w[j];
+        cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, DMnd, Nmu, Ns,
+                    1.0, psi + s*DMnd, DMndsp, psimu, Nmu, 0.0, zeta, DMnd);
+        W = pSPARC->ISDF_W + s*DMnd;
+        for (mu = 0; mu < Nmu; mu++)
+            for (i = 0; i < DMnd; i++)
+                W[i + mu*DMndsp] = V[i + mu*DMnd] * zeta[i + mu*DMnd];
+    }
+
+    free(psimu);
+    free(w);
+    free(ones);
+    free(zeta);
+    free(V);
+    free(recvcounts);
+    free(displs);
+}
+
+
+/**
+ * @brief   Apply the ISDF exact exchange operator to X in dmcomm
+ */
+void ISDF_exchange_apply(SPARC_OBJ *pSPARC, double *X, int ldx, int ncol,
+    int spinor, double alpha, double *Hx, int ldhx)
+{
+    int DMnd, DMndsp, Nmu;
+    double *Xmu;
+
+    DMnd = pSPARC->Nd_d_dmcomm;
+    DMndsp = DMnd * pSPARC->Nspinor_spincomm;
+    Nmu = pSPARC->ISDF_Npts;
+    if (Nmu == 0 || ncol == 0) return;
+
+    Xmu = (double *) malloc(sizeof(double) * Nmu * ncol);
+    assert(Xmu != NULL);
+    ISDF_point_values(pSPARC, X, ldx, ncol, Xmu);
+
+    cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, DMnd, ncol, Nmu,
+                alpha / pSPARC->dV, pSPARC->ISDF_W + spinor*DMnd, DMndsp, Xmu, Nmu, 1.0, Hx, ldhx);
+    free(Xmu);
+}
+
+
+/**
+ * @brief   Evaluate the pair terms of energy, stress or pressure using ISDF
+ */
+void ISDF_exchange_pair_terms(SPARC_OBJ *pSPARC, int spinor, double *psi_outer, int ldpo,
+    double *occ, int type, double *out)
+{
+    if (pSPARC->spincomm_index < 0 || pSPARC->bandcomm_index < 0 || pSPARC->dmcomm == MPI_COMM_NULL) return;
+    int i, j, n, a, b, base, nb, batch, DMnd, DMndsp, Ns, Nmu, nstart, nloc, ldp, count;
+    double *X, *psi, *Xmu, *psimu, *w, *zeta, *CC, *phi, *Z, *Dzeta, *Dphi;
+
+    DMnd = pSPARC->Nd_d_dmcomm;
+    DMndsp = DMnd * pSPARC->Nspinor_spincomm;
+    Ns = pSPARC->Nstates;
+    Nmu = pSPARC->ISDF_Npts;
+    if (Nmu == 0) return;
+
+    w = (double *) malloc(sizeof(double) * Ns);
+    assert(w != NULL);
+    count = 0;
+    for (j = 0; j < Ns; j++) {
+        w[j] = (occ[j] > 1e-6) ? occ[j] : 0.0;
+        if (occ[j] > 1e-6) count++;
+    }
+    if (count == 0) {
+        free(w);
+        return;
+    }
+
+    // gather all bands of current orbitals
+    X = (double *) malloc(sizeof(double) * DMnd * Ns);
+    Xmu = (double *) malloc(sizeof(double) * Nmu * Ns);
+    assert(X != NULL && Xmu != NULL);
+    copy_mat_blk(sizeof(double), pSPARC->Xorb + spinor*DMnd, DMndsp, DMnd, pSPARC->Nband_bandcomm,
+                 X + pSPARC->band_start_indx*DMnd, DMnd);
+    gather_blacscomm(pSPARC, DMnd, Ns, X);
+    ISDF_point_values(pSPARC, X, DMnd, Ns, Xmu);
+
+    if (psi_outer != NULL) {
+        psi = psi_outer;
+        ldp = ldpo;
+        psimu = (double *) malloc(sizeof(double) * Nmu * Ns);
+        assert(psimu != NULL);
+        ISDF_point_values(pSPARC, psi, ldp, Ns, psimu);
+    } else {
+        psi = X;
+        ldp = DMnd;
+        psimu = Xmu;
+    }
+
+    zeta = (double *) malloc(sizeof(double) * DMnd * Nmu);
+    CC = (double *) malloc(sizeof(double) * Nmu * Nmu);
+    assert(zeta != NULL && CC != NULL);
+    ISDF_fit(pSPARC, X, DMnd, Xmu, w, Ns, psi, ldp, psimu, w, Ns, zeta, CC);
+
+    free(X);
+    free(Xmu);
+    if (psi_outer != NULL) free(psimu);
+    free(w);
+
+    // sum_ij occ_i occ_j (rho_ij, K rho_ij) = sum_{mu,nu} CC(mu,nu) (zeta_mu, K zeta_nu)
+    ISDF_blacs_split(pSPARC, &nstart, &nloc);
+    batch = pSPARC->EXXMem_batch == 0 ? max(1, nloc) : pSPARC->EXXMem_batch * pSPARC->npNd;
+    phi = (double *) malloc(sizeof(double) * DMnd * batch);
+    Z = (double *) malloc(sizeof(double) * Nmu * batch);
+    assert(phi != NULL && Z != NULL);
+
+    Dzeta = Dphi = NULL;
+    if (type == ISDF_STRESS) {
+        Dzeta = (double *) malloc(sizeof(double) * 3 * DMnd * Nmu);
+        Dphi = (double *) malloc(sizeof(double) * DMnd * batch);
+        assert(Dzeta != NULL && Dphi != NULL);
+        for (a = 0; a < 3; a++)
+            Gradient_vectors_dir(pSPARC, DMnd, pSPARC->DMVertices_dmcomm, Nmu, 0.0, zeta, DMnd,
+                                 Dzeta + a*DMnd*Nmu, DMnd, a, pSPARC->dmcomm);
+    }
+
+    for (base = 0; base < nloc; base += batch) {
+        nb = min(batch, nloc - base);
+        double *zeta_nu = zeta + (nstart + base)*DMnd;
+        double *CC_nu = CC + (nstart + base)*Nmu;
+
+        if (type == ISDF_ENERGY || type == ISDF_PRESSURE) {
+            double *pois_const = (type == ISDF_ENERGY) ? pSPARC->pois_FFT_const : pSPARC->pois_FFT_const_press;
+            ISDF_poisson(pSPARC, zeta_nu, pois_const, nb, phi);
+            cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, Nmu, nb, DMnd,
+                        1.0, zeta, DMnd, phi, DMnd, 0.0, Z, Nmu);
+            for (i = 0; i < Nmu * nb; i++) out[0] += CC_nu[i] * Z[i];
+        } else {
+            // (d_a rho, d_b phi) for the components xx, xy, xz, yy, yz, zz
+            ISDF_poisson(pSPARC, zeta_nu, pSPARC->pois_FFT_const_stress, nb, phi);
+            for (b = 0; b < 3; b++) {
+                Gradient_vectors_dir(pSPARC, DMnd, pSPARC->DMVertices_dmcomm, nb, 0.0, phi, DMnd,
+                                     Dphi, DMnd, b, pSPARC->dmcomm);
+                for (a = 0; a <= b; a++) {
+                    cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, Nmu, nb, DMnd,
+                                1.0, Dzeta + a*DMnd*Nmu, DMnd, Dphi, DMnd, 0.0, Z, Nmu);
+                    n = 3*a - a*(a-1)/2 + (b - a);
+                    for (i = 0; i < Nmu * nb; i++) out[n] += CC_nu[i] * Z[i];
+                }
+            }
+            // additional term for spherical truncation
+            if (pSPARC->EXXDiv_Flag == 0) {
+                ISDF_poisson(pSPARC, zeta_nu, pSPARC->pois_FFT_const_stress2, nb, phi);
+                cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, Nmu, nb, DMnd,
+                            1.0, zeta, DMnd, phi, DMnd, 0.0, Z, Nmu);
+                for (i = 0; i < Nmu * nb; i++) out[6] += CC_nu[i] * Z[i];
+            }
+        }
+    }
+    free(zeta);
+    free(CC);
+    free(phi);
+    free(Z);
+    if (type == ISDF_STRESS) {
+        free(Dzeta);
+        free(Dphi);
+    }
+}
@@ -17,6 +17,7 @@
 #include <complex.h>
 
 #include "exactExchangeInitialization.h"
+#include "exchangeCorrelation.h"
 #include "tools.h"
 
 
@@ -75,9 +76,16 @@ void init_exx(SPARC_OBJ *pSPARC) {
         }
     }
     
+    pSPARC->ISDF_Npts = 0;
+    pSPARC->ISDF_pts = NULL;
+    pSPARC->ISDF_W = NULL;
+
     find_k_shift(pSPARC);
     kshift_phasefactor(pSPARC);
 
+    // parallel FFT plans are created at the first Poisson solve on each communicator
+    pSPARC->ExxFFT[0] = pSPARC->ExxFFT[1] = NULL;
+
     if (pSPARC->EXXMeth_Flag == 0) {
         if (pSPARC->EXXDiv_Flag == 1) 
             auxiliary_constant(pSPARC);
@@ -99,6 +107,10 @@ void init_exx(SPARC_OBJ *pSPARC) {
 
     // initialize Eexx
     pSPARC->Eexx = 0;
+
+    // tabulate the short-range PBE exchange enhancement factor of HSE
+    if (strcmpi(pSPARC->XC, "HSE") == 0 && pSPARC->exx_sr_table_tol > 0.0)
+        wpbe_table_create(pSPARC);
 }
 
 
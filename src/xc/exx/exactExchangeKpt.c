@@ -40,6 +40,7 @@
 #endif
 
 #include "exactExchange.h"
+#include "pencilFFT.h"
 #include "exactExchangeKpt.h"
 #include "tools.h"
 #include "parallelization.h"
@@ -724,139 +725,11 @@ if(!grank)
 void poissonSolve_kpt(SPARC_OBJ *pSPARC, double _Complex *rhs, double *pois_FFT_const, int ncol, int DMnd, 
                 int *dims, double _Complex *Vi, int *kpt_k_list, int *kpt_q_list, MPI_Comm comm) 
 {
-    int i, k, lsize, lrank, ncolp;
-    int *sendcounts, *sdispls, *recvcounts, *rdispls, **DMVertices, *ncolpp;
-    int coord_comm[3], gridsizes[3], DNx, DNy, DNz, Nd, Nx, Ny, Nz, kq_shift;
-    double _Complex *rhs_loc, *Vi_loc, *rhs_loc_order, *Vi_loc_order, *f;
-    sendcounts = sdispls = recvcounts = rdispls = ncolpp = NULL;
-    rhs_loc = Vi_loc = rhs_loc_order = Vi_loc_order = f = NULL;
-    DMVertices = NULL;
-
-    MPI_Comm_size(comm, &lsize);
-    MPI_Comm_rank(comm, &lrank);
-    Nd = pSPARC->Nd;
-    Nx = pSPARC->Nx; Ny = pSPARC->Ny; Nz = pSPARC->Nz; 
-    ncolp = ncol / lsize + ((lrank < ncol % lsize) ? 1 : 0);
-    kq_shift = 0;                                                           // start index for k&q for each process
-    /********************************************************************/
-
-    if (lsize > 1){
-        // variables for RHS storage
-        rhs_loc = (double _Complex *) malloc(sizeof(double _Complex) * ncolp * Nd);
-        rhs_loc_order = (double _Complex *) malloc(sizeof(double _Complex) * Nd * ncolp);
-
-        // number of columns per proc
-        ncolpp = (int*) malloc(sizeof(int) * lsize);
-
-        // variables for alltoallv
-        sendcounts = (int*) malloc(sizeof(int)*lsize);
-        sdispls = (int*) malloc(sizeof(int)*lsize);
-        recvcounts = (int*) malloc(sizeof(int)*lsize);
-        rdispls = (int*) malloc(sizeof(int)*lsize);
-        DMVertices = (int**) malloc(sizeof(int*)*lsize);
-        assert(rhs_loc != NULL && rhs_loc_order != NULL && ncolpp != NULL && 
-               sendcounts != NULL && sdispls != NULL && recvcounts != NULL && 
-               rdispls != NULL && DMVertices!= NULL);
-
-        for (k = 0; k < lsize; k++) {
-            DMVertices[k] = (int*) malloc(sizeof(int)*6);
-            assert(DMVertices[k] != NULL);
-        }
-        /********************************************************************/
-        
-        // separate equations to different processes in the dmcomm or kptcomm_topo                 
-        for (i = 0; i < lsize; i++) {
-            ncolpp[i] = ncol / lsize + ((i < ncol % lsize) ? 1 : 0);
-        }
-
-        for (i = 0; i < lrank; i++) 
-            kq_shift += ncolpp[i];
-
-        // this part of codes copied from parallelization.c
-        gridsizes[0] = Nx; gridsizes[1] = Ny; gridsizes[2] = Nz;
-        // compute variables required by gatherv and scatterv
-        for (i = 0; i < lsize; i++) {
-            MPI_Cart_coords(comm, i, 3, coord_comm);
-            // find size of distributed domain over comm
-            DNx = block_decompose(gridsizes[0], dims[0], coord_comm[0]);
-            DNy = block_decompose(gridsizes[1], dims[1], coord_comm[1]);
-            DNz = block_decompose(gridsizes[2], dims[2], coord_comm[2]);            
-            // Here DMVertices [1][3][5] is not the same as they are in parallelization
-            DMVertices[i][0] = block_decompose_nstart(gridsizes[0], dims[0], coord_comm[0]);
-            DMVertices[i][1] = DNx;                                                                                     // stores number of nodes instead of coordinates of end nodes
-            DMVertices[i][2] = block_decompose_nstart(gridsizes[1], dims[1], coord_comm[1]);
-            DMVertices[i][3] = DNy;                                                                                     // stores number of nodes instead of coordinates of end nodes
-            DMVertices[i][4] = block_decompose_nstart(gridsizes[2], dims[2], coord_comm[2]);
-            DMVertices[i][5] = DNz;                                                                                     // stores number of nodes instead of coordinates of end nodes
-        }
-
-        sdispls[0] = 0;
-        rdispls[0] = 0;
-        for (i = 0; i < lsize; i++) {
-            sendcounts[i] = ncolpp[i] * DMnd;
-            recvcounts[i] = ncolp * DMVertices[i][1] * DMVertices[i][3] * DMVertices[i][5];
-            if (i < lsize - 1) {
-                sdispls[i+1] = sdispls[i] + sendcounts[i];
-                rdispls[i+1] = rdispls[i] + recvcounts[i];
-            }
-        }
-        /********************************************************************/
-
-        MPI_Alltoallv(rhs, sendcounts, sdispls, MPI_DOUBLE_COMPLEX, 
-                        rhs_loc, recvcounts, rdispls, MPI_DOUBLE_COMPLEX, comm);
-
-        // rhs_full needs rearrangement
-        block_dp_to_cart((void *) rhs_loc, ncolp, DMVertices, rdispls, lsize, 
-                        Nx, Ny, Nd, (void *) rhs_loc_order, sizeof(double _Complex));
-
-        free(rhs_loc);
-        // variable for local result Vi
-        Vi_loc = (double _Complex *) malloc(sizeof(double _Complex) * Nd * ncolp);
-        assert(Vi_loc != NULL);
-    } else {
-        // if the size of comm is 1, there is no need to scatter and rearrange the results
-        // when applying phase factor, rhs will be changed. So get a copy. 
-        rhs_loc_order = (double _Complex *) malloc(sizeof(double _Complex) * Nd * ncolp);
-        assert(rhs_loc_order != NULL);
-        for (i = 0; i < Nd * ncolp; i++)
-            rhs_loc_order[i] = rhs[i];
-        Vi_loc = Vi;
-    }   
-
     if (pSPARC->EXXMeth_Flag == 0) {                                                // Solve in Fourier Space
-        pois_fft_kpt(pSPARC, rhs_loc_order, pois_FFT_const, ncolp, Vi_loc, kpt_k_list + kq_shift, kpt_q_list + kq_shift);
+        pois_fft_kpt(pSPARC, rhs, pois_FFT_const, ncol, DMnd, Vi, kpt_k_list, kpt_q_list, comm);
     } else {
         // TODO: Add method for solving in real space.
     }
-    
-    free(rhs_loc_order);
-
-    if (lsize > 1) {
-        Vi_loc_order = (double _Complex *) malloc(sizeof(double _Complex)* Nd * ncolp);
-        assert(Vi_loc_order != NULL);
-
-        // Vi_loc needs rearrangement
-        cart_to_block_dp((void *) Vi_loc, ncolp, DMVertices, lsize, 
-                        Nx, Ny, Nd, (void *) Vi_loc_order, sizeof(double _Complex));
-
-        MPI_Alltoallv(Vi_loc_order, recvcounts, rdispls, MPI_DOUBLE_COMPLEX, 
-                    Vi, sendcounts, sdispls, MPI_DOUBLE_COMPLEX, comm);
-
-        free(Vi_loc_order);
-    }
-
-    /********************************************************************/
-    if (lsize > 1){
-        free(Vi_loc);
-        free(ncolpp);
-        free(sendcounts);
-        free(sdispls);
-        free(recvcounts);
-        free(rdispls);
-        for (k = 0; k < lsize; k++) 
-            free(DMVertices[k]);
-        free(DMVertices);
-    }
 }
 
 
@@ -864,74 +737,73 @@ void poissonSolve_kpt(SPARC_OBJ *pSPARC, double _Complex *rhs, double *pois_FFT_
 /**
  * @brief   Solve Poisson's equation using FFT in Fourier Space - in k-point case. 
  * 
- * @param rhs_loc_order     complete RHS of poisson's equations without parallelization. 
+ * @param rhs               RHS of poisson's equations in the domain decomposition of comm. 
  * @param pois_FFT_const    constant for solving possion's equations
- * @param ncolp             Number of poisson's equations to be solved.
- * @param Vi_loc            complete solutions of poisson's equations without parallelization. 
+ * @param ncol              Number of poisson's equations to be solved.
+ * @param DMnd              Number of local grid points in the domain decomposition.
+ * @param Vi                solutions of poisson's equations in the domain decomposition of comm. 
  * @param kpt_k_list        List of global index of k Bloch wave vector
  * @param kpt_q_list        List of global index of q Bloch wave vector
  * Note:                    Assuming the RHS is periodic with Bloch wave vector (k - q). 
- * Note:                    This function is complete localized. 
+ * Note:                    All equations are solved together by the parallel FFT over comm. 
  */
-void pois_fft_kpt(SPARC_OBJ *pSPARC, double _Complex *rhs_loc_order, double *pois_FFT_const, 
-                    int ncolp, double _Complex *Vi_loc, int *kpt_k_list, int *kpt_q_list) 
+void pois_fft_kpt(SPARC_OBJ *pSPARC, double _Complex *rhs, double *pois_FFT_const, int ncol, int DMnd, 
+                    double _Complex *Vi, int *kpt_k_list, int *kpt_q_list, MPI_Comm comm) 
 {
 #define Kptshift_map(i,j) Kptshift_map[i+j*pSPARC->Nkpts_sym]
-    if (ncolp == 0) return;
-    int i, j, l, Nd, Nx, Ny, Nz;
+    if (ncol == 0) return;
+    int i, j, k, l, n, lrank, Nd, Nx, Ny, Nz, nd, *box;
     int *Kptshift_map;
-    double *alpha;
-    double _Complex *rhs_bar;
+    double *alpha, scale;
+    double _Complex *rhs_phase, *rhs_bar;
+    PENCIL_FFT_OBJ *plan;
 
     Nd = pSPARC->Nd;
     Nx = pSPARC->Nx; Ny = pSPARC->Ny; Nz = pSPARC->Nz; 
-    rhs_bar = (double _Complex*) malloc(sizeof(double _Complex) * Nd * ncolp);
-    assert(rhs_bar != NULL);
+    scale = 1.0 / Nd;                                                       // normalization of iFFT
     Kptshift_map = pSPARC->Kptshift_map;
+    MPI_Comm_rank(comm, &lrank);
     /********************************************************************/
-    
-    apply_phase_factor(pSPARC, rhs_loc_order, ncolp, "N", kpt_k_list, kpt_q_list);
-    
-    // FFT
-#if defined(USE_MKL)
-    MKL_LONG dim_sizes[3] = {Nz, Ny, Nx};
-    MKL_LONG strides_out[4] = {0, Ny*Nx, Nx, 1};
 
-    for (i = 0; i < ncolp; i++)
-        MKL_MDFFT(rhs_loc_order + i * Nd, dim_sizes, strides_out, rhs_bar + i * Nd);
-#elif defined(USE_FFTW)
-    int dim_sizes[3] = {Nz, Ny, Nx};
+    plan = get_exx_fft_plan(pSPARC, comm, 1, ncol);
 
-    for (i = 0; i < ncolp; i++)
-        FFTW_MDFFT(dim_sizes, rhs_loc_order + i * Nd, rhs_bar + i * Nd);
-#endif
-
-    // multiplied by alpha
-    for (j = 0; j < ncolp; j++) {
-        l = Kptshift_map(kpt_k_list[j], kpt_q_list[j]);
+    // when applying phase factor, rhs will be changed. So get a copy. 
+    rhs_phase = (double _Complex *) malloc(sizeof(double _Complex) * DMnd * ncol);
+    assert(rhs_phase != NULL);
+    for (i = 0; i < DMnd * ncol; i++)
+        rhs_phase[i] = rhs[i];
+    apply_phase_factor(pSPARC, rhs_phase, ncol, DMnd, plan->dm_box + 6*lrank, "N", kpt_k_list, kpt_q_list);
+    
+    // FFT
+    Pencil_FFT_forward(plan, rhs_phase, ncol);
+    free(rhs_phase);
+
+    // multiplied by alpha, the local frequencies are stored as z-pencils
+    box = plan->zp_box + 6*lrank;
+    nd = box[1] * box[3] * box[5];
+    rhs_bar = (double _Complex *) plan->work2;
+    for (n = 0; n < ncol; n++) {
+        l = Kptshift_map(kpt_k_list[n], kpt_q_list[n]);
         if (!l) {
             alpha = pois_FFT_const + Nd * (pSPARC->Nkpts_shift - 1);
         } else {
             alpha = pois_FFT_const + Nd * (l - 1);
         }
-        for (i = 0; i < Nd; i++) {
-            rhs_bar[i + j*Nd] = creal(rhs_bar[i + j*Nd]) * alpha[i] 
-                                + (cimag(rhs_bar[i + j*Nd]) * alpha[i]) * I;
+        for (j = 0; j < box[3]; j++) {
+            for (i = 0; i < box[1]; i++) {
+                double _Complex *rhs_line = rhs_bar + n*nd + (j*box[1] + i)*Nz;
+                double *alpha_line = alpha + (j+box[2])*Nx + i+box[0];
+                for (k = 0; k < Nz; k++) {
+                    rhs_line[k] *= alpha_line[k*Ny*Nx] * scale;
+                }
+            }
         }
     }
 
     // iFFT
-#if defined(USE_MKL)
-    for (i = 0; i < ncolp; i++)
-        MKL_MDiFFT(rhs_bar + i * Nd, dim_sizes, strides_out, Vi_loc + i * Nd);
-#elif defined(USE_FFTW)
-    for (i = 0; i < ncolp; i++)
-        FFTW_MDiFFT(dim_sizes, rhs_bar + i * Nd, Vi_loc + i * Nd);
-#endif
-
-    apply_phase_factor(pSPARC, Vi_loc, ncolp, "P", kpt_k_list, kpt_q_list);
+    Pencil_FFT_backward(plan, Vi, ncol);
 
-    free(rhs_bar);
+    apply_phase_factor(pSPARC, Vi, ncol, DMnd, plan->dm_box + 6*lrank, "P", kpt_k_list, kpt_q_list);
 #undef Kptshift_map
 }
 
@@ -1046,16 +918,19 @@ void gather_psi_occ_outer_kpt(SPARC_OBJ *pSPARC, double _Complex *psi_outer_kpt,
  * 
  * @param vec           vectors to be applied phase factors
  * @param ncol          number of columns of vectors
+ * @param DMnd          number of local grid points of each column
+ * @param box           start and number of grid points in x, y, z of the local domain
  * @param NorP          "N" is for negative phase factor, "P" is for positive.
  * @param kpt_k_list    list of global k-point index for k
  * @param kpt_q_list    list of global k-point index for q
  * Note:                Assuming the shifts is introduced by wave vector (k - q)
  */
-void apply_phase_factor(SPARC_OBJ *pSPARC, double _Complex *vec, int ncol, char *NorP, int *kpt_k_list, int *kpt_q_list) 
+void apply_phase_factor(SPARC_OBJ *pSPARC, double _Complex *vec, int ncol, int DMnd, int *box, 
+    char *NorP, int *kpt_k_list, int *kpt_q_list) 
 {
 #define Kptshift_map(i,j) Kptshift_map[i+j*pSPARC->Nkpts_sym]
 
-    int i, l, col, Nd, rank;
+    int i, j, k, l, col, Nd, rank, count;
     int *Kptshift_map;
     double _Complex *phase;
 
@@ -1075,8 +950,15 @@ void apply_phase_factor(SPARC_OBJ *pSPARC, double _Complex *vec, int ncol, char
     for (col = 0; col < ncol; col ++) {
         l = Kptshift_map(kpt_k_list[col], kpt_q_list[col]);
         if (!l) continue;                           // nothing for 0 shift
-        for (i = 0; i < Nd; i++) 
-            vec[i + col * Nd] *= phase[i + (l-1) * Nd];
+        double _Complex *phase_l = phase + (l-1) * Nd;
+        count = col * DMnd;
+        for (k = box[4]; k < box[4] + box[5]; k++) {
+            for (j = box[2]; j < box[2] + box[3]; j++) {
+                for (i = box[0]; i < box[0] + box[1]; i++) {
+                    vec[count++] *= phase_l[i + j * pSPARC->Nx + k * pSPARC->Nx * pSPARC->Ny];
+                }
+            }
+        }
     }
 
 #undef Kptshift_map
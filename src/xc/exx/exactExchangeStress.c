@@ -20,6 +20,7 @@
 #include "exactExchange.h"
 #include "exactExchangeKpt.h"
 #include "exactExchangeStress.h"
+#include "exactExchangeISDF.h"
 #include "gradVecRoutines.h"
 #include "gradVecRoutinesKpt.h"
 #include "stress.h"
@@ -66,7 +67,12 @@ void Calculate_exact_exchange_stress_linear(SPARC_OBJ *pSPARC)
     MPI_Comm_size(comm, &size);
 
     for (spinor = 0; spinor < pSPARC->Nspinor_spincomm; spinor++) {
-        if (pSPARC->ACEFlag == 0) {            
+        if (pSPARC->ISDFFlag == 1) {
+            psi_outer = (pSPARC->ACEFlag == 0) ? (pSPARC->psi_outer + spinor * DMnd) : NULL;
+            occ_outer = (pSPARC->ACEFlag == 0) ? pSPARC->occ_outer : pSPARC->occ;
+            occ_outer += (pSPARC->spin_typ == 1) ? spinor * Ns : 0;
+            ISDF_exchange_pair_terms(pSPARC, spinor, psi_outer, DMndsp, occ_outer, ISDF_STRESS, stress_exx);
+        } else if (pSPARC->ACEFlag == 0) {            
             psi = pSPARC->Xorb + spinor * DMnd;
             psi_outer = pSPARC->psi_outer + spinor * DMnd;
             occ_outer = (pSPARC->spin_typ == 1) ? (pSPARC->occ_outer + spinor * Ns) : pSPARC->occ_outer;
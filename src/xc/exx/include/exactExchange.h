@@ -78,13 +78,21 @@ void poisson_RHS_local(SPARC_OBJ *pSPARC, double *rhs, double *f, int Nd, int nc
 /**
  * @brief   Solve Poisson's equation using FFT in Fourier Space
  * 
- * @param rhs_loc_order     complete RHS of poisson's equations without parallelization. 
+ * @param rhs               RHS of poisson's equations in the domain decomposition of comm. 
  * @param pois_FFT_const    constant for solving possion's equations
- * @param ncolp             Number of poisson's equations to be solved.
- * @param Vi_loc            complete solutions of poisson's equations without parallelization. 
- * Note:                    This function is complete localized. 
+ * @param ncol              Number of poisson's equations to be solved.
+ * @param Vi                solutions of poisson's equations in the domain decomposition of comm. 
+ * Note:                    All equations are solved together by the parallel FFT over comm. 
  */
-void pois_fft(SPARC_OBJ *pSPARC, double *rhs_loc_order, double *pois_FFT_const, int ncolp, double *Vi_loc);
+void pois_fft(SPARC_OBJ *pSPARC, double *rhs, double *pois_FFT_const, int ncol, double *Vi, MPI_Comm comm);
+
+/**
+ * @brief   Find the persistent parallel FFT plan on comm for the transform type 
+ *          is_complex and the current grid, create it if it doesn't exist
+ *
+ *          Plans are kept for at most 2 communicators (dmcomm and kptcomm_topo).
+ */
+PENCIL_FFT_OBJ *get_exx_fft_plan(SPARC_OBJ *pSPARC, MPI_Comm comm, int is_complex, int ncol);
 
 /**
  * @brief   Solve Poisson's equation using linear solver (e.g. CG) in Real Space
@@ -0,0 +1,72 @@
+/***
+ * @file    exactExchangeISDF.h
+ * @brief   This file contains the function declarations for the interpolative
+ *          separable density fitting (ISDF) of exact exchange.
+ *
+ * Copyright (c) 2020 Material Physics & Mechanics Group, Georgia Tech.
+ */
+
+
+#ifndef EXACTEXCHANGEISDF_H
+#define EXACTEXCHANGEISDF_H
+
+#include "isddft.h"
+
+#define ISDF_ENERGY   0     // out[0]   = sum occ_i occ_j (rho_ij, K rho_ij)
+#define ISDF_STRESS   1     // out[0:6] = sum occ_i occ_j (d_a rho_ij, d_b K_s rho_ij), out[6] with K_s2
+#define ISDF_PRESSURE 2     // out[0]   = sum occ_i occ_j (rho_ij, K_p rho_ij)
+
+
+/**
+ * @brief   Select the ISDF interpolation points from the orbitals psi.
+ *
+ *          The points are the pivots of a column-pivoted QR factorization of a
+ *          random sketch of the pair products psi_i(r) * psi_j(r), with psi_j
+ *          occupied. Each process in dmcomm pivots its own grid points, then the
+ *          selected candidates are merged pairwise up a binary tree (tournament
+ *          pivoting), so only log2(npNd) messages are exchanged.
+ *
+ * @param psi       Full set of orbitals (all bands, all local spinors) in dmcomm
+ * @param occ       Occupations of psi
+ */
+void ISDF_select_points(SPARC_OBJ *pSPARC, double *psi, double *occ);
+
+/**
+ * @brief   Create the ISDF exact exchange operator from the orbitals psi.
+ *
+ *          The pair products psi_j(r) * psi_i(r) are fitted as
+ *          sum_mu zeta_mu(r) psi_j(r_mu) psi_i(r_mu), so only one Poisson's
+ *          equation per interpolation point is solved. The operator is saved as
+ *          W(r,mu) = (K zeta_mu)(r) * sum_j occ_j psi_j(r) psi_j(r_mu).
+ *
+ * @param psi       Full set of orbitals (all bands, all local spinors) in dmcomm
+ * @param occ       Occupations of psi
+ */
+void ISDF_exchange_operator(SPARC_OBJ *pSPARC, double *psi, double *occ);
+
+/**
+ * @brief   Apply the ISDF exact exchange operator to X in dmcomm
+ *
+ *          Hx += alpha/dV * W * X(r_mu, :)
+ *
+ * @param spinor    Local spinor index
+ */
+void ISDF_exchange_apply(SPARC_OBJ *pSPARC, double *X, int ldx, int ncol,
+    int spinor, double alpha, double *Hx, int ldhx);
+
+/**
+ * @brief   Evaluate the pair terms of energy, stress or pressure using ISDF
+ *
+ *          rho_ij = psi_i * psi_outer_j, where psi is the current orbitals Xorb.
+ *          The interpolation vectors are split over blacscomm, thus the result
+ *          is the local part of both dmcomm and blacscomm, and it is added to out.
+ *
+ * @param spinor        Local spinor index
+ * @param psi_outer     Full set of outer orbitals of the spinor, NULL to use Xorb
+ * @param occ           Occupations of the spinor
+ * @param type          ISDF_ENERGY, ISDF_STRESS or ISDF_PRESSURE
+ */
+void ISDF_exchange_pair_terms(SPARC_OBJ *pSPARC, int spinor, double *psi_outer, int ldpo,
+    double *occ, int type, double *out);
+
+#endif // EXACTEXCHANGEISDF_H
@@ -89,17 +89,18 @@ void poissonSolve_kpt(SPARC_OBJ *pSPARC, double _Complex *rhs, double *pois_FFT_
 /**
  * @brief   Solve Poisson's equation using FFT in Fourier Space - in k-point case. 
  * 
- * @param rhs_loc_order     complete RHS of poisson's equations without parallelization. 
+ * @param rhs               RHS of poisson's equations in the domain decomposition of comm. 
  * @param pois_FFT_const    constant for solving possion's equations
- * @param ncolp             Number of poisson's equations to be solved.
- * @param Vi_loc            complete solutions of poisson's equations without parallelization. 
+ * @param ncol              Number of poisson's equations to be solved.
+ * @param DMnd              Number of local grid points in the domain decomposition.
+ * @param Vi                solutions of poisson's equations in the domain decomposition of comm. 
  * @param kpt_k_list        List of global index of k Bloch wave vector
  * @param kpt_q_list        List of global index of q Bloch wave vector
  * Note:                    Assuming the RHS is periodic with Bloch wave vector (k - q). 
- * Note:                    This function is complete localized. 
+ * Note:                    All equations are solved together by the parallel FFT over comm. 
  */
-void pois_fft_kpt(SPARC_OBJ *pSPARC, double _Complex *rhs_loc_order, double *pois_FFT_const, 
-                    int ncolp, double _Complex *Vi_loc, int *kpt_k_list, int *kpt_q_list);
+void pois_fft_kpt(SPARC_OBJ *pSPARC, double _Complex *rhs, double *pois_FFT_const, int ncol, int DMnd, 
+                    double _Complex *Vi, int *kpt_k_list, int *kpt_q_list, MPI_Comm comm);
 
 
 
@@ -117,12 +118,15 @@ void gather_psi_occ_outer_kpt(SPARC_OBJ *pSPARC, double _Complex *psi_outer_kpt,
  * 
  * @param vec           vectors to be applied phase factors
  * @param ncol          number of columns of vectors
+ * @param DMnd          number of local grid points of each column
+ * @param box           start and number of grid points in x, y, z of the local domain
  * @param NorP          "N" is for negative phase factor, "P" is for positive.
  * @param kpt_k_list    list of global k-point index for k
  * @param kpt_q_list    list of global k-point index for q
  * Note:                Assuming the shifts is introduced by wave vector (k - q)
  */
-void apply_phase_factor(SPARC_OBJ *pSPARC, double _Complex *vec, int ncol, char *NorP, int *kpt_k_list, int *kpt_q_list);
+void apply_phase_factor(SPARC_OBJ *pSPARC, double _Complex *vec, int ncol, int DMnd, int *box, 
+    char *NorP, int *kpt_k_list, int *kpt_q_list);
 
 /**
  * @brief   Allocate memory space for ACE operator and check its size for each outer loop
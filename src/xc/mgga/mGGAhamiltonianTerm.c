@@ -19,6 +19,44 @@
 #include "parallelization.h"
 #include "gradVecRoutines.h"
 #include "gradVecRoutinesKpt.h"
+#include "haloExchange.h"
+
+
+/**
+ * @brief   Halo of the fused metaGGA term -1/2 * \nabla*(vxcMGGA3 * \nabla x).
+ *
+ *          The divergence of the gradient reaches 2*FDn points across the faces.
+ *          In non-orthogonal cells the gradient is transformed with lapcT before
+ *          the divergence is taken, so the edges are needed too, FDn deep in both
+ *          directions. The corners are never used. In a direction where the
+ *          process is its own neighbor, the part of vxcMGGA3 * \nabla x beyond
+ *          the local domain is copied from the local domain instead, and FDn is
+ *          deep enough.
+ */
+typedef struct _MGGA_HALO_OBJ {
+    MPI_Comm comm;      // neighbor communicator, Cartesian (6) or distributed graph (26)
+    int nproc;          // number of processes in comm
+    int nnbr;           // number of neighbors, 6 or 26
+    int FDn;            // radius of the first derivative stencil
+    int H;              // depth of the extended domain, 2*FDn
+    int DMn[3];         // size of the local domain
+    int DMn_ex[3];      // size of the extended domain, DMn + 2*H
+    int DMn_r[3];       // size of the domain where the gradient is needed, DMn + 2*FDn
+    int periods[3];     // periodic (1) or non-periodic (0) BC in each direction
+    int wrap[3];        // whether the process is its own neighbor in each direction
+    int offs[26][3];    // direction (-1, 0, 1) of each neighbor
+    int snd[26][6];     // halo sent to each neighbor, in the local domain (also the source of the local copy if nproc = 1)
+    int rcv[26][6];     // halo received from each neighbor, in the extended domain
+    int nbr_size[26];   // number of halo values per column for each neighbor
+    int isperiodic[26]; // whether the halo of a neighbor is copied from the local domain if nproc = 1
+    int isout[26][3];   // whether the halo of a neighbor is outside the global domain in each direction
+} MGGA_HALO_OBJ;
+
+static int mGGA_fused_halo(const SPARC_OBJ *pSPARC, const int *DMVertices, MPI_Comm comm, MGGA_HALO_OBJ *hi);
+static void mGGA_term_fused(const SPARC_OBJ *pSPARC, const MGGA_HALO_OBJ *hi, const double *x, int ldx, int ncol,
+    const double *vxcMGGA3_dm, double *Hx, int ldhx);
+static void mGGA_term_fused_kpt(const SPARC_OBJ *pSPARC, const MGGA_HALO_OBJ *hi, const double _Complex *x, int ldx, int ncol,
+    const double *vxcMGGA3_dm, double _Complex *Hx, int ldhx, int kpt);
 
 
 
@@ -28,7 +66,11 @@ void mGGA_potential(const SPARC_OBJ *pSPARC, double *x, int ldx, int ncol, int D
     int sg = pSPARC->spin_start_indx + spin;
     double *vxcMGGA3_dm = (Lanczos_flag == 1) ? pSPARC->vxcMGGA3_loc_kptcomm : (pSPARC->vxcMGGA3_loc_dmcomm + sg*pSPARC->Nd_d_dmcomm);    
     
-    compute_mGGA_term_hamil(pSPARC, x, ldx, ncol, DMnd, DMVertices, vxcMGGA3_dm, Hx, ldhx, comm);    
+    MGGA_HALO_OBJ hi;
+    if (mGGA_fused_halo(pSPARC, DMVertices, comm, &hi))
+        mGGA_term_fused(pSPARC, &hi, x, ldx, ncol, vxcMGGA3_dm, Hx, ldhx);
+    else
+        compute_mGGA_term_hamil(pSPARC, x, ldx, ncol, DMnd, DMVertices, vxcMGGA3_dm, Hx, ldhx, comm);    
 }
 
 void mGGA_potential_kpt(const SPARC_OBJ *pSPARC, double _Complex *x, int ldx, int ncol, int DMnd, int *DMVertices, double _Complex *Hx, int ldhx, int spin, int kpt, MPI_Comm comm)
@@ -37,7 +79,11 @@ void mGGA_potential_kpt(const SPARC_OBJ *pSPARC, double _Complex *x, int ldx, in
     int sg = pSPARC->spin_start_indx + spin;
     double *vxcMGGA3_dm = (Lanczos_flag == 1) ? pSPARC->vxcMGGA3_loc_kptcomm : (pSPARC->vxcMGGA3_loc_dmcomm + sg*pSPARC->Nd_d_dmcomm);
     
-    compute_mGGA_term_hamil_kpt(pSPARC, x, ldx, ncol, DMnd, DMVertices, vxcMGGA3_dm, Hx, ldhx, kpt, comm);
+    MGGA_HALO_OBJ hi;
+    if (mGGA_fused_halo(pSPARC, DMVertices, comm, &hi))
+        mGGA_term_fused_kpt(pSPARC, &hi, x, ldx, ncol, vxcMGGA3_dm, Hx, ldhx, kpt);
+    else
+        compute_mGGA_term_hamil_kpt(pSPARC, x, ldx, ncol, DMnd, DMVertices, vxcMGGA3_dm, Hx, ldhx, kpt, comm);
 }
 
 /**
@@ -199,4 +245,684 @@ void compute_mGGA_term_hamil_kpt(const SPARC_OBJ *pSPARC, double _Complex *x, in
     
     free(Dx_x_kpt); free(Dx_y_kpt); free(Dx_z_kpt);
     free(Dvxc3Dx_x_kpt); free(Dvxc3Dx_y_kpt); free(Dvxc3Dx_z_kpt);
-}
\ No newline at end of file
+}
+
+
+/**
+ * @brief   Set up the halo of the fused metaGGA term for the local domain.
+ *
+ * @return  1 if the fused term can be used, 0 otherwise (cyclix, a domain of the
+ *          decomposition thinner than 2*FDn or a communicator without neighbor
+ *          topology), in which case the derivatives are taken one at a time.
+ */
+static int mGGA_fused_halo(const SPARC_OBJ *pSPARC, const int *DMVertices, MPI_Comm comm, MGGA_HALO_OBJ *hi)
+{
+    int nonorth = (pSPARC->cell_typ > 10 && pSPARC->cell_typ < 20);
+    if (pSPARC->CyclixFlag || (pSPARC->cell_typ != 0 && nonorth == 0)) return 0;
+
+    int FDn = pSPARC->order / 2;
+    int H = 2 * FDn;
+    int gridsizes[3] = {pSPARC->Nx, pSPARC->Ny, pSPARC->Nz};
+    int periods[3] = {1 - pSPARC->BCx, 1 - pSPARC->BCy, 1 - pSPARC->BCz};
+    int dims[3], cart_periods[3], my_coords[3];
+    int d, n, i, j, k;
+
+    MPI_Comm_size(comm, &hi->nproc);
+    if (hi->nproc > 1)
+        MPI_Cart_get(comm, 3, dims, cart_periods, my_coords);
+    else
+        dims[0] = dims[1] = dims[2] = 1;
+
+    // every domain has to hold the 2*FDn layers it sends to its neighbors
+    for (d = 0; d < 3; d++) {
+        if ((dims[d] > 1 || periods[d]) && gridsizes[d] / dims[d] < H) return 0;
+    }
+
+    hi->comm = comm;
+    if (nonorth && hi->nproc > 1) {
+        if (comm == pSPARC->kptcomm_topo)
+            hi->comm = pSPARC->kptcomm_topo_dist_graph;
+        else if (comm == pSPARC->dmcomm)
+            hi->comm = pSPARC->comm_dist_graph_psi;
+        else
+            return 0;
+    }
+
+    hi->nnbr = nonorth ? 26 : 6;
+    hi->FDn = FDn;
+    hi->H = H;
+    for (d = 0; d < 3; d++) {
+        hi->DMn[d] = DMVertices[2*d+1] - DMVertices[2*d] + 1;
+        hi->DMn_ex[d] = hi->DMn[d] + 2 * H;
+        hi->DMn_r[d] = hi->DMn[d] + 2 * FDn;
+        hi->periods[d] = periods[d];
+        hi->wrap[d] = (dims[d] == 1);
+    }
+
+    // neighbors in the order of the communicator, xl, xr, yl, yr, zl, zr for the
+    // Cartesian topology and the 3x3x3 block without its center for the graph
+    if (nonorth) {
+        n = 0;
+        for (k = -1; k <= 1; k++) {
+            for (j = -1; j <= 1; j++) {
+                for (i = -1; i <= 1; i++) {
+                    if (i == 0 && j == 0 && k == 0) continue;
+                    hi->offs[n][0] = i; hi->offs[n][1] = j; hi->offs[n][2] = k;
+                    n++;
+                }
+            }
+        }
+    } else {
+        for (n = 0; n < 6; n++) {
+            hi->offs[n][0] = hi->offs[n][1] = hi->offs[n][2] = 0;
+            hi->offs[n][n/2] = 2 * (n % 2) - 1;
+        }
+    }
+
+    for (n = 0; n < hi->nnbr; n++) {
+        const int *o = hi->offs[n];
+        int nnz = (o[0] != 0) + (o[1] != 0) + (o[2] != 0);
+        int nwrap = (o[0] != 0 && hi->wrap[0]) + (o[1] != 0 && hi->wrap[1]) + (o[2] != 0 && hi->wrap[2]);
+        // faces are 2*FDn deep (FDn if wrapped), edges FDn deep in both directions
+        // (empty if wrapped in both), corners are empty
+        int h = 0;
+        if (nnz == 1) h = nwrap ? FDn : H;
+        if (nnz == 2 && nwrap < 2) h = FDn;
+        hi->nbr_size[n] = 1;
+        hi->isperiodic[n] = (h > 0);
+        for (d = 0; d < 3; d++) {
+            int DMn = hi->DMn[d];
+            // if dims[d] < 3 and periods[d] == 1, the left and right neighbors are the
+            // same process, switch the send buffer for left and right neighbors
+            int os = (dims[d] < 3 && periods[d]) ? -o[d] : o[d];
+            hi->snd[n][2*d]   = (os > 0) ? DMn - h : 0;
+            hi->snd[n][2*d+1] = (os < 0) ? h : DMn;
+            hi->rcv[n][2*d]   = (o[d] < 0) ? H - h : ((o[d] > 0) ? H + DMn : H);
+            hi->rcv[n][2*d+1] = (o[d] < 0) ? H : ((o[d] > 0) ? H + DMn + h : H + DMn);
+            hi->nbr_size[n] *= (o[d] == 0) ? DMn : h;
+            if (o[d] != 0 && periods[d] == 0) hi->isperiodic[n] = 0;
+            hi->isout[n][d] = (o[d] < 0 && DMVertices[2*d] == 0) ||
+                              (o[d] > 0 && DMVertices[2*d+1] == gridsizes[d] - 1);
+        }
+    }
+    return 1;
+}
+
+
+
+/**
+ * @brief   Copy a column of the local domain into the extended domain.
+ */
+static void mGGA_copy_local(const MGGA_HALO_OBJ *hi, const double *xn, double *x_ex)
+{
+    int i, j, k, H = hi->H, count = 0;
+    int nx_ex = hi->DMn_ex[0], nxny_ex = nx_ex * hi->DMn_ex[1];
+    for (k = H; k < H + hi->DMn[2]; k++)
+        for (j = H; j < H + hi->DMn[1]; j++)
+            for (i = H; i < H + hi->DMn[0]; i++)
+                x_ex[k*nxny_ex + j*nx_ex + i] = xn[count++];
+}
+
+
+
+/**
+ * @brief   Copy the halo of column n into the extended domain, from the receive
+ *          buffer of the plan, or from the column itself if there is no plan.
+ */
+static void mGGA_copy_halo(const MGGA_HALO_OBJ *hi, const HALO_PLAN_OBJ *halo, int n, const double *xn, double *x_ex)
+{
+    int nbr, i, j, k, ip, jp, kp, count;
+    int nx = hi->DMn[0], nxny = nx * hi->DMn[1];
+    int nx_ex = hi->DMn_ex[0], nxny_ex = nx_ex * hi->DMn_ex[1];
+    for (nbr = 0; nbr < hi->nnbr; nbr++) {
+        const int *r = hi->rcv[nbr], *s = hi->snd[nbr];
+        if (halo != NULL) {
+            const double *x_in = (const double *) halo->recvbuf + halo->displs[nbr] + n * hi->nbr_size[nbr];
+            count = 0;
+            for (kp = r[4]; kp < r[5]; kp++)
+                for (jp = r[2]; jp < r[3]; jp++)
+                    for (ip = r[0]; ip < r[1]; ip++)
+                        x_ex[kp*nxny_ex + jp*nx_ex + ip] = x_in[count++];
+        } else if (hi->isperiodic[nbr]) {
+            for (k = s[4], kp = r[4]; kp < r[5]; k++, kp++)
+                for (j = s[2], jp = r[2]; jp < r[3]; j++, jp++)
+                    for (i = s[0], ip = r[0]; ip < r[1]; i++, ip++)
+                        x_ex[kp*nxny_ex + jp*nx_ex + ip] = xn[k*nxny + j*nx + i];
+        }
+    }
+}
+
+
+
+/**
+ * @brief   F_a = vxcMGGA3 * (lapcT * \nabla x)_a on a block of the local domain
+ *          extended by FDn, [st, en) in the coordinates of the extended domain.
+ *
+ * @param dir   Direction a of F_a to find, -1 for all three with lapcT.
+ */
+static void mGGA_v3_grad_block(const SPARC_OBJ *pSPARC, const MGGA_HALO_OBJ *hi, const double *x_ex, const double *v_ex,
+    double *F, const int *st, const int *en, const int dir)
+{
+    int FDn = hi->FDn;
+    int nx_ex = hi->DMn_ex[0], nxny_ex = nx_ex * hi->DMn_ex[1];
+    int nx_r = hi->DMn_r[0], nxny_r = nx_r * hi->DMn_r[1], nd_r = nxny_r * hi->DMn_r[2];
+    const int sx = 1, sy = nx_ex, sz = nxny_ex;
+    const double *cx = pSPARC->D1_stencil_coeffs_x;
+    const double *cy = pSPARC->D1_stencil_coeffs_y;
+    const double *cz = pSPARC->D1_stencil_coeffs_z;
+    const double *T = pSPARC->lapcT;
+    const int ni = en[0] - st[0];
+    int i, j, k, p;
+
+    #pragma omp parallel for private(i, j, p) schedule(static)
+    for (k = st[2]; k < en[2]; k++) {
+        for (j = st[1]; j < en[1]; j++) {
+            int ind = (k+FDn)*nxny_ex + (j+FDn)*nx_ex + st[0]+FDn;
+            int ind_r = k*nxny_r + j*nx_r + st[0];
+            const double *xk = x_ex + ind;
+            const double *vk = v_ex + ind;
+            if (dir >= 0) {
+                const int s = (dir == 0) ? sx : ((dir == 1) ? sy : sz);
+                const double *c = (dir == 0) ? cx : ((dir == 1) ? cy : cz);
+                double *Fk = F + dir*nd_r + ind_r;
+                #pragma omp simd
+                for (i = 0; i < ni; i++) {
+                    double temp = 0.0;
+                    for (p = 1; p <= FDn; p++)
+                        temp += (xk[i+p*s] - xk[i-p*s]) * c[p];
+                    Fk[i] = temp * vk[i];
+                }
+            } else {
+                double *F0 = F + ind_r, *F1 = F + nd_r + ind_r, *F2 = F + 2*nd_r + ind_r;
+                #pragma omp simd
+                for (i = 0; i < ni; i++) {
+                    double g0 = 0.0, g1 = 0.0, g2 = 0.0;
+                    for (p = 1; p <= FDn; p++) {
+                        g0 += (xk[i+p*sx] - xk[i-p*sx]) * cx[p];
+                        g1 += (xk[i+p*sy] - xk[i-p*sy]) * cy[p];
+                        g2 += (xk[i+p*sz] - xk[i-p*sz]) * cz[p];
+                    }
+                    F0[i] = (g0 * T[0] + g1 * T[1] + g2 * T[2]) * vk[i];
+                    F1[i] = (g0 * T[3] + g1 * T[4] + g2 * T[5]) * vk[i];
+                    F2[i] = (g0 * T[6] + g1 * T[7] + g2 * T[8]) * vk[i];
+                }
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Copy the two slabs of F_a beyond the local domain in the direction a
+ *          from the local domain, where the process is its own neighbor. They
+ *          are zero for non-periodic BC.
+ */
+static void mGGA_wrap_slabs(const MGGA_HALO_OBJ *hi, double *Fa, const int a)
+{
+    int FDn = hi->FDn;
+    int nx_r = hi->DMn_r[0], nxny_r = nx_r * hi->DMn_r[1];
+    int stride[3] = {1, nx_r, nxny_r};
+    int shift = hi->DMn[a] * stride[a];
+    int st[3], en[3], d, i, j, k, side;
+    for (d = 0; d < 3; d++) {
+        st[d] = FDn; en[d] = FDn + hi->DMn[d];
+    }
+    for (side = 0; side < 2; side++) {
+        st[a] = side ? FDn + hi->DMn[a] : 0;
+        en[a] = side ? hi->DMn_r[a] : FDn;
+        int sgn = side ? -1 : 1;
+        for (k = st[2]; k < en[2]; k++) {
+            for (j = st[1]; j < en[1]; j++) {
+                double *Fk = Fa + k*nxny_r + j*nx_r;
+                for (i = st[0]; i < en[0]; i++)
+                    Fk[i] = hi->periods[a] ? Fk[i + sgn*shift] : 0.0;
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   F_a = vxcMGGA3 * (lapcT * \nabla x)_a where its divergence needs it,
+ *          i.e. on the local domain extended by FDn in the direction a.
+ */
+static void mGGA_v3_grad(const SPARC_OBJ *pSPARC, const MGGA_HALO_OBJ *hi, const double *x_ex, const double *v_ex, double *F)
+{
+    int FDn = hi->FDn, nd_r = hi->DMn_r[0] * hi->DMn_r[1] * hi->DMn_r[2];
+    int st[3], en[3], a, d, side;
+    for (d = 0; d < 3; d++) {
+        st[d] = FDn; en[d] = FDn + hi->DMn[d];
+    }
+    // all three components on the local domain at once for non-orthogonal cells
+    if (hi->nnbr == 26)
+        mGGA_v3_grad_block(pSPARC, hi, x_ex, v_ex, F, st, en, -1);
+    for (a = 0; a < 3; a++) {
+        if (hi->nnbr == 6 && hi->wrap[a]) {
+            mGGA_v3_grad_block(pSPARC, hi, x_ex, v_ex, F, st, en, a);
+        } else if (hi->nnbr == 6) {
+            st[a] = 0; en[a] = hi->DMn_r[a];
+            mGGA_v3_grad_block(pSPARC, hi, x_ex, v_ex, F, st, en, a);
+        } else if (hi->wrap[a] == 0) {
+            for (side = 0; side < 2; side++) {
+                st[a] = side ? FDn + hi->DMn[a] : 0;
+                en[a] = side ? hi->DMn_r[a] : FDn;
+                mGGA_v3_grad_block(pSPARC, hi, x_ex, v_ex, F, st, en, -1);
+            }
+        }
+        st[a] = FDn; en[a] = FDn + hi->DMn[a];
+        if (hi->wrap[a]) mGGA_wrap_slabs(hi, F + a*nd_r, a);
+    }
+}
+
+
+
+/**
+ * @brief   Hx -= 1/2 * \nabla*F on the local domain.
+ */
+static void mGGA_div(const SPARC_OBJ *pSPARC, const MGGA_HALO_OBJ *hi, const double *F, double *Hx)
+{
+    int FDn = hi->FDn;
+    int nx = hi->DMn[0], nxny = nx * hi->DMn[1];
+    int nx_r = hi->DMn_r[0], nxny_r = nx_r * hi->DMn_r[1], nd_r = nxny_r * hi->DMn_r[2];
+    const int sy = nx_r, sz = nxny_r;
+    const double *cx = pSPARC->D1_stencil_coeffs_x;
+    const double *cy = pSPARC->D1_stencil_coeffs_y;
+    const double *cz = pSPARC->D1_stencil_coeffs_z;
+    int i, j, k, p;
+
+    #pragma omp parallel for private(i, j, p) schedule(static)
+    for (k = 0; k < hi->DMn[2]; k++) {
+        for (j = 0; j < hi->DMn[1]; j++) {
+            int ind_r = (k+FDn)*nxny_r + (j+FDn)*nx_r + FDn;
+            const double *F0 = F + ind_r, *F1 = F + nd_r + ind_r, *F2 = F + 2*nd_r + ind_r;
+            double *Hk = Hx + k*nxny + j*nx;
+            #pragma omp simd
+            for (i = 0; i < nx; i++) {
+                double D0 = 0.0, D1 = 0.0, D2 = 0.0;
+                for (p = 1; p <= FDn; p++) {
+                    D0 += (F0[i+p] - F0[i-p]) * cx[p];
+                    D1 += (F1[i+p*sy] - F1[i-p*sy]) * cy[p];
+                    D2 += (F2[i+p*sz] - F2[i-p*sz]) * cz[p];
+                }
+                Hk[i] -= 0.5*(D0 + D1 + D2);
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Fused metaGGA term in Hamiltonian, Hx -= 1/2 * \nabla*(vxcMGGA3 * \nabla x).
+ *
+ *          The halos of all the columns and of vxcMGGA3 are exchanged once, 2*FDn
+ *          deep, so that vxcMGGA3 * \nabla x is found on the local domain extended
+ *          by FDn and its divergence is taken without another exchange. One column
+ *          of the extended domain is kept at a time.
+ */
+static void mGGA_term_fused(const SPARC_OBJ *pSPARC, const MGGA_HALO_OBJ *hi, const double *x, int ldx, int ncol,
+    const double *vxcMGGA3_dm, double *Hx, int ldhx)
+{
+#ifdef DEBUG_SCAN
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    double t1 = MPI_Wtime();
+#endif
+
+    int nbr, n, i, j, k, count;
+    int nx = hi->DMn[0], nxny = nx * hi->DMn[1];
+    int nd_ex = hi->DMn_ex[0] * hi->DMn_ex[1] * hi->DMn_ex[2];
+    int nd_r = hi->DMn_r[0] * hi->DMn_r[1] * hi->DMn_r[2];
+
+    HALO_PLAN_OBJ *halo = NULL;
+    if (hi->nproc > 1) {
+        // vxcMGGA3 is exchanged with the columns of x as the last column
+        halo = Halo_plan_get(hi->comm, MPI_DOUBLE, hi->nnbr, hi->nbr_size, ncol+1);
+        double *x_out = (double *) halo->sendbuf;
+        count = 0;
+        for (nbr = 0; nbr < hi->nnbr; nbr++) {
+            const int *s = hi->snd[nbr];
+            for (n = 0; n <= ncol; n++) {
+                const double *xn = (n < ncol) ? x + n*(size_t)ldx : vxcMGGA3_dm;
+                for (k = s[4]; k < s[5]; k++)
+                    for (j = s[2]; j < s[3]; j++)
+                        for (i = s[0]; i < s[1]; i++)
+                            x_out[count++] = xn[k*nxny + j*nx + i];
+            }
+        }
+        Halo_plan_start(halo); // non-blocking
+    }
+
+    // the halos that are never received (non-periodic BC) stay zero
+    double *x_ex = (double *) calloc(nd_ex, sizeof(double));
+    double *v_ex = (double *) calloc(nd_ex, sizeof(double));
+    double *F = (double *) malloc(3 * nd_r * sizeof(double));
+    assert(x_ex != NULL && v_ex != NULL && F != NULL);
+
+    mGGA_copy_local(hi, vxcMGGA3_dm, v_ex);
+    if (hi->nproc > 1) Halo_plan_wait(halo);
+    mGGA_copy_halo(hi, halo, ncol, vxcMGGA3_dm, v_ex);
+
+    for (n = 0; n < ncol; n++) {
+        const double *xn = x + n*(size_t)ldx;
+        mGGA_copy_local(hi, xn, x_ex);
+        mGGA_copy_halo(hi, halo, n, xn, x_ex);
+        mGGA_v3_grad(pSPARC, hi, x_ex, v_ex, F);
+        mGGA_div(pSPARC, hi, F, Hx + n*(size_t)ldhx);
+    }
+
+    if (hi->nproc > 1) Halo_plan_release(halo);
+    free(x_ex); free(v_ex); free(F);
+
+#ifdef DEBUG_SCAN
+    double t2 = MPI_Wtime();
+    if (rank == 0) printf("end of Calculating fused mGGA term in Hamiltonian, took %.3f ms\n", (t2 - t1)*1000);
+#endif
+}
+
+
+
+/**
+ * @brief   Copy a column of the local domain into the extended domain (k-point).
+ */
+static void mGGA_copy_local_kpt(const MGGA_HALO_OBJ *hi, const double _Complex *xn, double _Complex *x_ex)
+{
+    int i, j, k, H = hi->H, count = 0;
+    int nx_ex = hi->DMn_ex[0], nxny_ex = nx_ex * hi->DMn_ex[1];
+    for (k = H; k < H + hi->DMn[2]; k++)
+        for (j = H; j < H + hi->DMn[1]; j++)
+            for (i = H; i < H + hi->DMn[0]; i++)
+                x_ex[k*nxny_ex + j*nx_ex + i] = xn[count++];
+}
+
+
+
+/**
+ * @brief   Copy the halo of column n into the extended domain (k-point), with the
+ *          Bloch phase factor of the halos outside the global domain.
+ */
+static void mGGA_copy_halo_kpt(const MGGA_HALO_OBJ *hi, const HALO_PLAN_OBJ *halo, int n, const double _Complex *xn,
+    const double _Complex *phase_factors, double _Complex *x_ex)
+{
+    int nbr, i, j, k, ip, jp, kp, count;
+    int nx = hi->DMn[0], nxny = nx * hi->DMn[1];
+    int nx_ex = hi->DMn_ex[0], nxny_ex = nx_ex * hi->DMn_ex[1];
+    for (nbr = 0; nbr < hi->nnbr; nbr++) {
+        const int *r = hi->rcv[nbr], *s = hi->snd[nbr];
+        const double _Complex phase_factor = phase_factors[nbr];
+        if (halo != NULL) {
+            const double _Complex *x_in = (const double _Complex *) halo->recvbuf + halo->displs[nbr] + n * hi->nbr_size[nbr];
+            count = 0;
+            for (kp = r[4]; kp < r[5]; kp++)
+                for (jp = r[2]; jp < r[3]; jp++)
+                    for (ip = r[0]; ip < r[1]; ip++)
+                        x_ex[kp*nxny_ex + jp*nx_ex + ip] = x_in[count++] * phase_factor;
+        } else if (hi->isperiodic[nbr]) {
+            for (k = s[4], kp = r[4]; kp < r[5]; k++, kp++)
+                for (j = s[2], jp = r[2]; jp < r[3]; j++, jp++)
+                    for (i = s[0], ip = r[0]; ip < r[1]; i++, ip++)
+                        x_ex[kp*nxny_ex + jp*nx_ex + ip] = xn[k*nxny + j*nx + i] * phase_factor;
+        }
+    }
+}
+
+
+
+/**
+ * @brief   F_a = vxcMGGA3 * (lapcT * \nabla x)_a on a block of the local domain
+ *          extended by FDn (k-point).
+ *
+ * @param dir   Direction a of F_a to find, -1 for all three with lapcT.
+ */
+static void mGGA_v3_grad_block_kpt(const SPARC_OBJ *pSPARC, const MGGA_HALO_OBJ *hi, const double _Complex *x_ex, const double *v_ex,
+    double _Complex *F, const int *st, const int *en, const int dir)
+{
+    int FDn = hi->FDn;
+    int nx_ex = hi->DMn_ex[0], nxny_ex = nx_ex * hi->DMn_ex[1];
+    int nx_r = hi->DMn_r[0], nxny_r = nx_r * hi->DMn_r[1], nd_r = nxny_r * hi->DMn_r[2];
+    const int sx = 1, sy = nx_ex, sz = nxny_ex;
+    const double *cx = pSPARC->D1_stencil_coeffs_x;
+    const double *cy = pSPARC->D1_stencil_coeffs_y;
+    const double *cz = pSPARC->D1_stencil_coeffs_z;
+    const double *T = pSPARC->lapcT;
+    const int ni = en[0] - st[0];
+    int i, j, k, p;
+
+    #pragma omp parallel for private(i, j, p) schedule(static)
+    for (k = st[2]; k < en[2]; k++) {
+        for (j = st[1]; j < en[1]; j++) {
+            int ind = (k+FDn)*nxny_ex + (j+FDn)*nx_ex + st[0]+FDn;
+            int ind_r = k*nxny_r + j*nx_r + st[0];
+            const double _Complex *xk = x_ex + ind;
+            const double *vk = v_ex + ind;
+            if (dir >= 0) {
+                const int s = (dir == 0) ? sx : ((dir == 1) ? sy : sz);
+                const double *c = (dir == 0) ? cx : ((dir == 1) ? cy : cz);
+                double _Complex *Fk = F + dir*nd_r + ind_r;
+                #pragma omp simd
+                for (i = 0; i < ni; i++) {
+                    double _Complex temp = 0.0;
+                    for (p = 1; p <= FDn; p++)
+                        temp += (xk[i+p*s] - xk[i-p*s]) * c[p];
+                    Fk[i] = temp * vk[i];
+                }
+            } else {
+                double _Complex *F0 = F + ind_r, *F1 = F + nd_r + ind_r, *F2 = F + 2*nd_r + ind_r;
+                #pragma omp simd
+                for (i = 0; i < ni; i++) {
+                    double _Complex g0 = 0.0, g1 = 0.0, g2 = 0.0;
+                    for (p = 1; p <= FDn; p++) {
+                        g0 += (xk[i+p*sx] - xk[i-p*sx]) * cx[p];
+                        g1 += (xk[i+p*sy] - xk[i-p*sy]) * cy[p];
+                        g2 += (xk[i+p*sz] - xk[i-p*sz]) * cz[p];
+                    }
+                    F0[i] = (g0 * T[0] + g1 * T[1] + g2 * T[2]) * vk[i];
+                    F1[i] = (g0 * T[3] + g1 * T[4] + g2 * T[5]) * vk[i];
+                    F2[i] = (g0 * T[6] + g1 * T[7] + g2 * T[8]) * vk[i];
+                }
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Copy the two slabs of F_a beyond the local domain in the direction a
+ *          from the local domain with the Bloch phase factor (k-point).
+ *
+ * @param phase_fac_l   e^{-i k_a L_a}, phase factor of the slab on the left
+ */
+static void mGGA_wrap_slabs_kpt(const MGGA_HALO_OBJ *hi, double _Complex *Fa, const int a, const double _Complex phase_fac_l)
+{
+    int FDn = hi->FDn;
+    int nx_r = hi->DMn_r[0], nxny_r = nx_r * hi->DMn_r[1];
+    int stride[3] = {1, nx_r, nxny_r};
+    int shift = hi->DMn[a] * stride[a];
+    int st[3], en[3], d, i, j, k, side;
+    for (d = 0; d < 3; d++) {
+        st[d] = FDn; en[d] = FDn + hi->DMn[d];
+    }
+    for (side = 0; side < 2; side++) {
+        st[a] = side ? FDn + hi->DMn[a] : 0;
+        en[a] = side ? hi->DMn_r[a] : FDn;
+        int sgn = side ? -1 : 1;
+        const double _Complex phase_factor = side ? conj(phase_fac_l) : phase_fac_l;
+        for (k = st[2]; k < en[2]; k++) {
+            for (j = st[1]; j < en[1]; j++) {
+                double _Complex *Fk = Fa + k*nxny_r + j*nx_r;
+                for (i = st[0]; i < en[0]; i++)
+                    Fk[i] = hi->periods[a] ? Fk[i + sgn*shift] * phase_factor : 0.0;
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   F_a = vxcMGGA3 * (lapcT * \nabla x)_a where its divergence needs it (k-point).
+ */
+static void mGGA_v3_grad_kpt(const SPARC_OBJ *pSPARC, const MGGA_HALO_OBJ *hi, const double _Complex *x_ex, const double *v_ex,
+    double _Complex *F, const double _Complex *phase_fac_l)
+{
+    int FDn = hi->FDn, nd_r = hi->DMn_r[0] * hi->DMn_r[1] * hi->DMn_r[2];
+    int st[3], en[3], a, d, side;
+    for (d = 0; d < 3; d++) {
+        st[d] = FDn; en[d] = FDn + hi->DMn[d];
+    }
+    // all three components on the local domain at once for non-orthogonal cells
+    if (hi->nnbr == 26)
+        mGGA_v3_grad_block_kpt(pSPARC, hi, x_ex, v_ex, F, st, en, -1);
+    for (a = 0; a < 3; a++) {
+        if (hi->nnbr == 6 && hi->wrap[a]) {
+            mGGA_v3_grad_block_kpt(pSPARC, hi, x_ex, v_ex, F, st, en, a);
+        } else if (hi->nnbr == 6) {
+            st[a] = 0; en[a] = hi->DMn_r[a];
+            mGGA_v3_grad_block_kpt(pSPARC, hi, x_ex, v_ex, F, st, en, a);
+        } else if (hi->wrap[a] == 0) {
+            for (side = 0; side < 2; side++) {
+                st[a] = side ? FDn + hi->DMn[a] : 0;
+                en[a] = side ? hi->DMn_r[a] : FDn;
+                mGGA_v3_grad_block_kpt(pSPARC, hi, x_ex, v_ex, F, st, en, -1);
+            }
+        }
+        st[a] = FDn; en[a] = FDn + hi->DMn[a];
+        if (hi->wrap[a]) mGGA_wrap_slabs_kpt(hi, F + a*nd_r, a, phase_fac_l[a]);
+    }
+}
+
+
+
+/**
+ * @brief   Hx -= 1/2 * \nabla*F on the local domain (k-point).
+ */
+static void mGGA_div_kpt(const SPARC_OBJ *pSPARC, const MGGA_HALO_OBJ *hi, const double _Complex *F, double _Complex *Hx)
+{
+    int FDn = hi->FDn;
+    int nx = hi->DMn[0], nxny = nx * hi->DMn[1];
+    int nx_r = hi->DMn_r[0], nxny_r = nx_r * hi->DMn_r[1], nd_r = nxny_r * hi->DMn_r[2];
+    const int sy = nx_r, sz = nxny_r;
+    const double *cx = pSPARC->D1_stencil_coeffs_x;
+    const double *cy = pSPARC->D1_stencil_coeffs_y;
+    const double *cz = pSPARC->D1_stencil_coeffs_z;
+    int i, j, k, p;
+
+    #pragma omp parallel for private(i, j, p) schedule(static)
+    for (k = 0; k < hi->DMn[2]; k++) {
+        for (j = 0; j < hi->DMn[1]; j++) {
+            int ind_r = (k+FDn)*nxny_r + (j+FDn)*nx_r + FDn;
+            const double _Complex *F0 = F + ind_r, *F1 = F + nd_r + ind_r, *F2 = F + 2*nd_r + ind_r;
+            double _Complex *Hk = Hx + k*nxny + j*nx;
+            #pragma omp simd
+            for (i = 0; i < nx; i++) {
+                double _Complex D0 = 0.0, D1 = 0.0, D2 = 0.0;
+                for (p = 1; p <= FDn; p++) {
+                    D0 += (F0[i+p] - F0[i-p]) * cx[p];
+                    D1 += (F1[i+p*sy] - F1[i-p*sy]) * cy[p];
+                    D2 += (F2[i+p*sz] - F2[i-p*sz]) * cz[p];
+                }
+                Hk[i] -= 0.5*(D0 + D1 + D2);
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Fused metaGGA term in Hamiltonian with a Bloch wavevector,
+ *          Hx -= 1/2 * \nabla*(vxcMGGA3 * \nabla x).
+ *
+ *          Same as mGGA_term_fused, vxcMGGA3 is exchanged as the last column
+ *          without the phase factor.
+ */
+static void mGGA_term_fused_kpt(const SPARC_OBJ *pSPARC, const MGGA_HALO_OBJ *hi, const double _Complex *x, int ldx, int ncol,
+    const double *vxcMGGA3_dm, double _Complex *Hx, int ldhx, int kpt)
+{
+#ifdef DEBUG_SCAN
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    double t1 = MPI_Wtime();
+#endif
+
+    int nbr, n, i, j, k, d, count;
+    int nx = hi->DMn[0], nxny = nx * hi->DMn[1];
+    int nx_ex = hi->DMn_ex[0], nxny_ex = nx_ex * hi->DMn_ex[1];
+    int nd_ex = nxny_ex * hi->DMn_ex[2];
+    int nd_r = hi->DMn_r[0] * hi->DMn_r[1] * hi->DMn_r[2];
+
+    HALO_PLAN_OBJ *halo = NULL;
+    if (hi->nproc > 1) {
+        // vxcMGGA3 is exchanged with the columns of x as the last column
+        halo = Halo_plan_get(hi->comm, MPI_DOUBLE_COMPLEX, hi->nnbr, hi->nbr_size, ncol+1);
+        double _Complex *x_out = (double _Complex *) halo->sendbuf;
+        count = 0;
+        for (nbr = 0; nbr < hi->nnbr; nbr++) {
+            const int *s = hi->snd[nbr];
+            for (n = 0; n <= ncol; n++) {
+                for (k = s[4]; k < s[5]; k++)
+                    for (j = s[2]; j < s[3]; j++)
+                        for (i = s[0]; i < s[1]; i++)
+                            x_out[count++] = (n < ncol) ? x[n*(size_t)ldx + k*nxny + j*nx + i] : vxcMGGA3_dm[k*nxny + j*nx + i];
+            }
+        }
+        Halo_plan_start(halo); // non-blocking
+    }
+
+    // phase factor of the halo of each neighbor, e^{i k L} for the directions
+    // in which the halo is outside the global domain
+    double kL[3];
+    kL[0] = pSPARC->k1_loc[kpt] * pSPARC->range_x;
+    kL[1] = pSPARC->k2_loc[kpt] * pSPARC->range_y;
+    kL[2] = pSPARC->k3_loc[kpt] * pSPARC->range_z;
+    double _Complex phase_factors[26], phase_fac_l[3];
+    for (d = 0; d < 3; d++)
+        phase_fac_l[d] = cos(kL[d]) - sin(kL[d]) * I;
+    for (nbr = 0; nbr < hi->nnbr; nbr++) {
+        double theta = 0.0;
+        for (d = 0; d < 3; d++)
+            theta += hi->isout[nbr][d] * hi->offs[nbr][d] * kL[d];
+        phase_factors[nbr] = cos(theta) + sin(theta) * I;
+    }
+
+    // the halos that are never received (non-periodic BC) stay zero
+    double _Complex *x_ex = (double _Complex *) calloc(nd_ex, sizeof(double _Complex));
+    double *v_ex = (double *) calloc(nd_ex, sizeof(double));
+    double _Complex *F = (double _Complex *) malloc(3 * nd_r * sizeof(double _Complex));
+    assert(x_ex != NULL && v_ex != NULL && F != NULL);
+
+    mGGA_copy_local(hi, vxcMGGA3_dm, v_ex);
+    if (hi->nproc > 1) {
+        Halo_plan_wait(halo);
+        for (nbr = 0; nbr < hi->nnbr; nbr++) {
+            const int *r = hi->rcv[nbr];
+            const double _Complex *x_in = (const double _Complex *) halo->recvbuf + halo->displs[nbr] + ncol * hi->nbr_size[nbr];
+            count = 0;
+            for (k = r[4]; k < r[5]; k++)
+                for (j = r[2]; j < r[3]; j++)
+                    for (i = r[0]; i < r[1]; i++)
+                        v_ex[k*nxny_ex + j*nx_ex + i] = creal(x_in[count++]);
+        }
+    } else {
+        mGGA_copy_halo(hi, NULL, 0, vxcMGGA3_dm, v_ex);
+    }
+
+    for (n = 0; n < ncol; n++) {
+        const double _Complex *xn = x + n*(size_t)ldx;
+        mGGA_copy_local_kpt(hi, xn, x_ex);
+        mGGA_copy_halo_kpt(hi, halo, n, xn, phase_factors, x_ex);
+        mGGA_v3_grad_kpt(pSPARC, hi, x_ex, v_ex, F, phase_fac_l);
+        mGGA_div_kpt(pSPARC, hi, F, Hx + n*(size_t)ldhx);
+    }
+
+    if (hi->nproc > 1) Halo_plan_release(halo);
+    free(x_ex); free(v_ex); free(F);
+
+#ifdef DEBUG_SCAN
+    double t2 = MPI_Wtime();
+    if (rank == 0) printf("end of Calculating fused mGGA term in Hamiltonian, took %.3f ms\n", (t2 - t1)*1000);
+#endif
+}
@@ -63,20 +63,23 @@ void basic_r2scanx_variables(int length, double *rho, double *normDrho, double *
     double threeMPi2_1o3 = pow(3.0*M_PI*M_PI, 1.0/3.0);
     double threeMPi2_2o3 = threeMPi2_1o3*threeMPi2_1o3;
     double eta = 0.001;
+    #pragma omp parallel for schedule(static)
     for (i = 0; i < length; i++) {
-        double s = normDrho[i] / (2.0 * threeMPi2_1o3 * pow(rho[i], 4.0/3.0));
+        double rho_1o3 = cbrt(rho[i]), rho_2o3 = rho_1o3*rho_1o3;
+        double rho_4o3 = rho[i]*rho_1o3, rho_5o3 = rho_4o3*rho_1o3, rho_7o3 = rho_4o3*rho[i];
+        double s = normDrho[i] / (2.0 * threeMPi2_1o3 * rho_4o3);
         p_dpdn_dpddn[0][i] = s*s;
         double tauw = normDrho[i]*normDrho[i] / (8*rho[i]);
-        double tauUnif = 3.0/10.0 * threeMPi2_2o3 * pow(rho[i], 5.0/3.0);
+        double tauUnif = 3.0/10.0 * threeMPi2_2o3 * rho_5o3;
         alpha_dadn_daddn_dadtau[0][i] = (tau[i] - tauw) / (tauUnif + eta*tauw);
 
-        double dsdn = -2.0*normDrho[i] / (3.0 * threeMPi2_1o3 * pow(rho[i], 7.0/3.0)); // ds/dn
+        double dsdn = -2.0*normDrho[i] / (3.0 * threeMPi2_1o3 * rho_7o3); // ds/dn
         p_dpdn_dpddn[1][i] = 2*s*dsdn;
-        double dsddn = 1.0 / (2.0 * threeMPi2_1o3 * pow(rho[i], 4.0/3.0)); // ds/d|\nabla n|
+        double dsddn = 1.0 / (2.0 * threeMPi2_1o3 * rho_4o3); // ds/d|\nabla n|
         p_dpdn_dpddn[2][i] = 2*s*dsddn;
         double DtauwDn = -normDrho[i]*normDrho[i] / (8*rho[i]*rho[i]);
         double DtauwDDn = normDrho[i] / (4*rho[i]);
-        double DtauUnifDn = threeMPi2_2o3 / 2.0 * pow(rho[i], 2.0/3.0);
+        double DtauUnifDn = threeMPi2_2o3 / 2.0 * rho_2o3;
         alpha_dadn_daddn_dadtau[1][i] = (-DtauwDn*(tauUnif + eta*tauw) - (tau[i] - tauw)*(DtauUnifDn + eta*DtauwDn)) / ((tauUnif + eta*tauw)*(tauUnif + eta*tauw)); // d\alpha/dn
         alpha_dadn_daddn_dadtau[2][i] = (-DtauwDDn*(tauUnif + eta*tauw) - (tau[i] - tauw)*eta*DtauwDDn) / ((tauUnif + eta*tauw)*(tauUnif + eta*tauw)); // d\alpha/d|\nabla n|
         alpha_dadn_daddn_dadtau[3][i] = 1.0 / (tauUnif + eta*tauw); // d\alpha/d\tau
@@ -100,13 +103,16 @@ void Calculate_r2scanx(int length, double *rho, double **p_dpdn_dpddn, double **
     double dx = 1.24;
     // constants for Fx, which is mixing of h_x^0 and h_x^1
     double a1 = 4.9479;
+    double dp2_4 = pow(dp2, 4.0);
     int i;
+    #pragma omp parallel for schedule(static)
     for (i = 0; i < length; i++) {
-        double epsilon_xUnif = -3.0/(4.0*M_PI) * pow(3.0*M_PI*M_PI * rho[i], 1.0/3.0);
+        double epsilon_xUnif = -3.0/(4.0*M_PI) * cbrt(3.0*M_PI*M_PI * rho[i]);
         // compose h_x^1
         double p = p_dpdn_dpddn[0][i];
-        double p14 = pow(p, 0.25);
-        double x = (Ceta*C2*exp(-p_dpdn_dpddn[0][i]*p_dpdn_dpddn[0][i] / pow(dp2, 4.0)) + mu_ak) * p_dpdn_dpddn[0][i];
+        double p14 = sqrt(sqrt(p));
+        double exp_p2 = exp(-p*p / dp2_4);
+        double x = (Ceta*C2*exp_p2 + mu_ak) * p;
         double hx1 = 1.0 + k1 - k1/(1.0 + x/k1);
         // interpolate and extrapolate h_x to get F_x
         // switching function f_x
@@ -125,23 +131,24 @@ void Calculate_r2scanx(int length, double *rho, double **p_dpdn_dpddn, double **
         else {
             fx = exp(-c1x*alpha / (1.0 - alpha));
         }
-        double gx = 1.0 - exp(-a1/p14);
+        double exp_a1p = exp(-a1/p14);
+        double gx = 1.0 - exp_a1p;
         double Fx = (hx1 + fx*(hx0 - hx1))*gx;
         epsilonx[i] = epsilon_xUnif*Fx;
 
-        double DxDp = (Ceta*C2 * exp(-p*p / pow(dp2, 4.0)) + mu_ak) + Ceta*C2*exp(-p*p / pow(dp2, 4.0))*(-2.0*p/ pow(dp2, 4.0)) * p;
+        double DxDp = (Ceta*C2 * exp_p2 + mu_ak) + Ceta*C2*exp_p2*(-2.0*p/ dp2_4) * p;
         double DxDn = DxDp*p_dpdn_dpddn[1][i];
         double DxDDn = DxDp*p_dpdn_dpddn[2][i];
 
-        double DgxDn = -exp(-a1/p14)*(a1/4.0/p14/p)*p_dpdn_dpddn[1][i];
-        double DgxDDn = -exp(-a1/p14)*(a1/4.0/p14/p)*p_dpdn_dpddn[2][i];
+        double DgxDn = -exp_a1p*(a1/4.0/p14/p)*p_dpdn_dpddn[1][i];
+        double DgxDDn = -exp_a1p*(a1/4.0/p14/p)*p_dpdn_dpddn[2][i];
         double Dhx1Dx = 1.0 / ((1.0 + x/k1)*(1.0 + x/k1));
         double Dhx1Dn = DxDn * Dhx1Dx;
         double Dhx1DDn = DxDDn * Dhx1Dx;
 
         double DfxDalpha;
         if (alpha > 2.5) {
-            DfxDalpha = -dx*exp(c2x/(1.0 - alpha)) * (c2x/(1.0 - alpha)/(1.0 - alpha));
+            DfxDalpha = fx * (c2x/(1.0 - alpha)/(1.0 - alpha));
         }
         else if (alpha > 0.0) {
             double alpha2 = alpha *alpha; double alpha3 = alpha2*alpha;
@@ -151,7 +158,7 @@ void Calculate_r2scanx(int length, double *rho, double **p_dpdn_dpddn, double **
                 + (-0.887998041597)*alpha4*5.0 + 0.234528941479*alpha5*6.0 + (-0.023185843322)*alpha6*7.0;
         }
         else {
-            DfxDalpha = exp(-c1x*alpha/(1.0 - alpha)) * (-c1x/(1.0 - alpha)/(1 - alpha));
+            DfxDalpha = fx * (-c1x/(1.0 - alpha)/(1.0 - alpha));
         }
         double DfxDn = DfxDalpha*alpha_dadn_daddn_dadtau[1][i];
         double DfxDDn = DfxDalpha*alpha_dadn_daddn_dadtau[2][i];
@@ -160,7 +167,7 @@ void Calculate_r2scanx(int length, double *rho, double **p_dpdn_dpddn, double **
         double DFxDDn = (hx1 + fx*(hx0 - hx1))*DgxDDn + gx*(1.0 - fx)*Dhx1DDn + gx*(hx0 - hx1)*DfxDDn;
         double DFxDtau = gx*(hx0 - hx1)*DfxDtau;
 
-        double Depsilon_xUnifDn = -pow(3.0*M_PI*M_PI, 1.0/3.0) / (4.0*M_PI) * pow(rho[i], -2.0/3.0);
+        double Depsilon_xUnifDn = epsilon_xUnif / (3.0*rho[i]);
         vx[i] = (epsilon_xUnif + rho[i]*Depsilon_xUnifDn)*Fx + rho[i]*epsilon_xUnif*DFxDn;
         v2x[i] = rho[i]*epsilon_xUnif*DFxDDn;
         v3x[i] = rho[i]*epsilon_xUnif*DFxDtau;
@@ -218,23 +225,26 @@ void basic_r2scanc_variables(int length, double *rho, double *normDrho, double *
     double threeMPi2_1o3 = pow(3.0*M_PI*M_PI, 1.0/3.0);
     double threeMPi2_2o3 = threeMPi2_1o3*threeMPi2_1o3;
     double eta = 0.001;
+    #pragma omp parallel for schedule(static)
     for (i = 0; i < length; i++) {
-        double s = normDrho[i] / (2.0 * threeMPi2_1o3 * pow(rho[i], 4.0/3.0));
+        double rho_1o3 = cbrt(rho[i]), rho_2o3 = rho_1o3*rho_1o3;
+        double rho_4o3 = rho[i]*rho_1o3, rho_5o3 = rho_4o3*rho_1o3, rho_7o3 = rho_4o3*rho[i];
+        double s = normDrho[i] / (2.0 * threeMPi2_1o3 * rho_4o3);
         s_dsdn_dsddn[0][i] = s;
         p_dpdn_dpddn[0][i] = s*s;
         double tauw = normDrho[i]*normDrho[i] / (8*rho[i]);
-        double tauUnif = 3.0/10.0 * threeMPi2_2o3 * pow(rho[i], 5.0/3.0);
+        double tauUnif = 3.0/10.0 * threeMPi2_2o3 * rho_5o3;
         alpha_dadn_daddn_dadtau[0][i] = (tau[i] - tauw) / (tauUnif + eta*tauw);
 
-        double dsdn = -2.0*normDrho[i] / (3.0 * threeMPi2_1o3 * pow(rho[i], 7.0/3.0)); // ds/dn
+        double dsdn = -2.0*normDrho[i] / (3.0 * threeMPi2_1o3 * rho_7o3); // ds/dn
         s_dsdn_dsddn[1][i] = dsdn;
         p_dpdn_dpddn[1][i] = 2*s*dsdn;
-        double dsddn = 1.0 / (2.0 * threeMPi2_1o3 * pow(rho[i], 4.0/3.0)); // ds/d|\nabla n|
+        double dsddn = 1.0 / (2.0 * threeMPi2_1o3 * rho_4o3); // ds/d|\nabla n|
         s_dsdn_dsddn[2][i] = dsddn;
         p_dpdn_dpddn[2][i] = 2*s*dsddn;
         double DtauwDn = -normDrho[i]*normDrho[i] / (8*rho[i]*rho[i]);
         double DtauwDDn = normDrho[i] / (4*rho[i]);
-        double DtauUnifDn = threeMPi2_2o3 / 2.0 * pow(rho[i], 2.0/3.0);
+        double DtauUnifDn = threeMPi2_2o3 / 2.0 * rho_2o3;
         alpha_dadn_daddn_dadtau[1][i] = (-DtauwDn*(tauUnif + eta*tauw) - (tau[i] - tauw)*(DtauUnifDn + eta*DtauwDn)) / ((tauUnif + eta*tauw)*(tauUnif + eta*tauw)); // d\alpha/dn
         alpha_dadn_daddn_dadtau[2][i] = (-DtauwDDn*(tauUnif + eta*tauw) - (tau[i] - tauw)*eta*DtauwDDn) / ((tauUnif + eta*tauw)*(tauUnif + eta*tauw)); // d\alpha/d|\nabla n|
         alpha_dadn_daddn_dadtau[3][i] = 1.0 / (tauUnif + eta*tauw); // d\alpha/d\tau
@@ -264,22 +274,31 @@ void Calculate_r2scanc(int length, double *rho, double **s_dsdn_dsddn, double **
     double c1c = 0.64;
     double c2c = 1.5;
     double dc = 0.7;
+    // quantities depending only on zeta, which is 0 without spin
+    double zeta = 0.0;
+    double phi = 1.0;
+    double dx = 1.0;
+    double cx0 = -3.0/(4.0*M_PI) * pow(9.0*M_PI/4.0, 1.0/3.0);
+    double Gc = 1.0;
+    double chiInf0 = pow(3.0*M_PI*M_PI/16.0, 2.0/3.0) * (betaRsInf*1.0/(cx0 - f0)); // \xi_{r_s->\inf}(\zeta=0), 0.128026
+    double tConst = pow(3.0*M_PI*M_PI/16.0, 1.0/3.0);
+    double dp2_4 = pow(dp2, 4.0);
+    double DzetaDn = 0.0; // no spin
+    double DdxDn = (4.0/3.0*pow(1.0 + zeta, 1.0/3.0) - 4.0/3.0*pow(1.0 - zeta, 1.0/3.0))*DzetaDn; // when there is no spin, it should be 0
+    double DGcDn = -2.3631*DdxDn*(1.0 - pow(zeta, 12.0)) + (1.0 - 2.3631*(dx - 1))*(12.0*pow(zeta, 11.0)*DzetaDn); // when there is no spin, it should be 0
+    double DphiDn = 0.5*(2.0/3.0*pow(1.0 + zeta, -1.0/3.0) - 2.0/3.0*pow(1.0 - zeta, -1.0/3.0)) * DzetaDn; // no spin, it should be 0
     int i;
+    #pragma omp parallel for schedule(static)
     for (i = 0; i < length; i++) {
-        double zeta = 0.0;
-        double phi = 1.0;
-        double dx = 1.0;
         double s = s_dsdn_dsddn[0][i];
         double p = p_dpdn_dpddn[0][i];
         double alpha = alpha_dadn_daddn_dadtau[0][i];
-        double rs = pow(0.75/(M_PI*rho[i]), 1.0/3.0);
+        double rs = cbrt(0.75/(M_PI*rho[i]));
         // epsilon_c^0 (\alpha approach 0)
         double ecLDA0 = -b1c / (1.0 + b2c*sqrt(rs) + b3c*rs);
-        double cx0 = -3.0/(4.0*M_PI) * pow(9.0*M_PI/4.0, 1.0/3.0);
-        double Gc = 1.0;
         double w0 = exp(-ecLDA0/b1c) - 1.0;
-        double chiInf0 = pow(3.0*M_PI*M_PI/16.0, 2.0/3.0) * (betaRsInf*1.0/(cx0 - f0)); // \xi_{r_s->\inf}(\zeta=0), 0.128026
-        double gInf0s = pow(1.0 + 4.0*chiInf0*s*s, -0.25);
+        double gInf0sBase = 1.0 + 4.0*chiInf0*s*s;
+        double gInf0s = pow(gInf0sBase, -0.25);
         double H0 = b1c*log(1.0 + w0*(1.0 - gInf0s));
         double ec0 = (ecLDA0 + H0)*Gc;
         // epsilon_c^1 (\alpha approach 1)
@@ -296,7 +315,7 @@ void Calculate_r2scanc(int length, double *rho, double **s_dsdn_dsddn, double **
         // H1
         double rPhi3 = r*phi*phi*phi;
         double w1 = exp(-ec_lsda1/rPhi3) - 1.0;
-        double t = pow(3.0*M_PI*M_PI/16.0, 1.0/3.0) * s/(phi*sqrRs);
+        double t = tConst * s/(phi*sqrRs);
         double y = beta/(r*w1) * t*t;
         double deltafc2 = 1.0*(-0.64) + 2.0*(-0.4352) + 3.0*(-1.535685604549) + 4.0*3.061560252175 
             + 5.0*(-1.915710236206) + 6.0*0.516884468372 + 7.0*(-0.051848879792);
@@ -305,10 +324,12 @@ void Calculate_r2scanc(int length, double *rho, double **s_dsdn_dsddn, double **
 
         double deltayPart1 = deltafc2 / (27.0*r*w1);
         double deltayPart2 = 20.0*rs*(declsda0_drs - declsda1_drs) - 45.0*eta*(ec_lsda0 - ec_lsda1);
-        double deltayPart3 = p*exp(-p*p / pow(dp2, 4.0));
+        double exp_p2 = exp(-p*p / dp2_4);
+        double deltayPart3 = p*exp_p2;
         double deltay = deltayPart1 * deltayPart2 * deltayPart3;
 
-        double g = pow(1.0 + 4.0*(y - deltay), -0.25);
+        double gBase = 1.0 + 4.0*(y - deltay);
+        double g = pow(gBase, -0.25);
         double H1 = rPhi3 * log(1.0 + w1*(1.0 - g));
         double ec1 = ec_lsda1 + H1;
         // interpolate and extrapolate epsilon_c
@@ -328,11 +349,8 @@ void Calculate_r2scanc(int length, double *rho, double **s_dsdn_dsddn, double **
         }
         epsilonc[i] = ec1 + fc*(ec0 - ec1);
         // compute variation of epsilon_c^0
-        double DzetaDn = 0.0; // no spin
-        double DrsDn = -4.0*M_PI/9.0 * pow(4.0*M_PI/3.0*rho[i], -4.0/3.0);
-        double DdxDn = (4.0/3.0*pow(1.0 + zeta, 1.0/3.0) - 4.0/3.0*pow(1.0 - zeta, 1.0/3.0))*DzetaDn; // when there is no spin, it should be 0
-        double DGcDn = -2.3631*DdxDn*(1.0 - pow(zeta, 12.0)) + (1.0 - 2.3631*(dx - 1))*(12.0*pow(zeta, 11.0)*DzetaDn); // when there is no spin, it should be 0
-        double DgInf0sDs = -0.25*pow(1.0 + 4.0*chiInf0*s*s, -1.25) * (4.0*chiInf0*2.0*s);
+        double DrsDn = -rs/(3.0*rho[i]);
+        double DgInf0sDs = -0.25*gInf0s/gInf0sBase * (4.0*chiInf0*2.0*s);
         double DgInf0sDn = DgInf0sDs * s_dsdn_dsddn[1][i];
         double DgInf0sDDn = DgInf0sDs * s_dsdn_dsddn[2][i];
         double DecLDA0Dn = b1c*(0.5*b2c/sqrRs + b3c) / pow(1.0 + b2c*sqrRs + b3c*rs, 2.0) * DrsDn;
@@ -352,8 +370,7 @@ void Calculate_r2scanc(int length, double *rho, double **s_dsdn_dsddn, double **
         double Ddeclsda1_drsDn = d2eclsda1_drs2*DrsDn;
         double Dec_lsda1Dn = (-rs * 1.0/3.0 * declsda1_drs) / rho[i];
         double DbetaDn = 0.066725*(0.1*(1.0+0.1778*rs) - 0.1778*(1.0+0.1*rs)) / pow(1.0+0.1778*rs, 2.0) * DrsDn;
-        double DphiDn = 0.5*(2.0/3.0*pow(1.0 + zeta, -1.0/3.0) - 2.0/3.0*pow(1.0 - zeta, -1.0/3.0)) * DzetaDn; // no spin, it should be 0
-        double DtDn = pow(3.0*M_PI*M_PI/16.0, 1.0/3.0) * (phi*sqrRs*s_dsdn_dsddn[1][i] - s*(DphiDn*sqrRs + phi*DrsDn/(2.0*sqrRs))) / (phi*phi*rs);
+        double DtDn = tConst * (phi*sqrRs*s_dsdn_dsddn[1][i] - s*(DphiDn*sqrRs + phi*DrsDn/(2.0*sqrRs))) / (phi*phi*rs);
         double DtDDn = t*s_dsdn_dsddn[2][i]/s;
         double Dw1Dn = (w1 + 1.0) * (-(rPhi3*Dec_lsda1Dn - r*ec_lsda1*(3.0*phi*phi*DphiDn)) / rPhi3 / rPhi3);
         double DyDn = (w1*DbetaDn - beta*Dw1Dn) / (r*w1*w1) * (t*t) + beta/(r*w1) * (2*t)*DtDn;
@@ -367,13 +384,13 @@ void Calculate_r2scanc(int length, double *rho, double **s_dsdn_dsddn, double **
         double d_deltayPart1_dn = 0.0 + 0.0 + deltafc2 / (27.0*r) * (-1.0)/w1/w1 * Dw1Dn;
         double d_deltayPart2_dn = 20.0*(declsda0_drs - declsda1_drs)*DrsDn + 20.0*rs*(Ddeclsda0_drsDn - Ddeclsda1_drsDn)
             - 45.0*eta*(Declsda0Dn - Dec_lsda1Dn);
-        double d_deltayPart3_dp = exp(-p*p/pow(dp2, 4.0)) + p*exp(-p*p/pow(dp2, 4.0))*(-2.0*p/pow(dp2, 4.0));
+        double d_deltayPart3_dp = exp_p2 + p*exp_p2*(-2.0*p/dp2_4);
         double DdeltayDn = d_deltayPart1_dn*deltayPart2*deltayPart3 + deltayPart1*d_deltayPart2_dn*deltayPart3
             + deltayPart1*deltayPart2*d_deltayPart3_dp*p_dpdn_dpddn[1][i];
         double DdeltayDDn = deltayPart1*deltayPart2*d_deltayPart3_dp*p_dpdn_dpddn[2][i];
 
-        double DgDn = -0.25*pow(1.0 + 4.0*(y - deltay), -1.25) * (4.0*(DyDn - DdeltayDn));
-        double DgDDn = -0.25*pow(1.0 + 4.0*(y - deltay), -1.25) * (4.0*(DyDDn - DdeltayDDn));
+        double DgDn = -0.25*g/gBase * (4.0*(DyDn - DdeltayDn));
+        double DgDDn = -0.25*g/gBase * (4.0*(DyDDn - DdeltayDDn));
         double DH1Dn = 3*r*phi*phi*DphiDn*log(1.0 + w1*(1.0 - g)) + rPhi3*(Dw1Dn*(1.0 - g) - w1*DgDn) / (1.0 + w1*(1.0 - g));
         double DH1DDn = rPhi3*(-w1*DgDDn) / (1.0 + w1*(1.0 - g));
         double Dec1Dn = Dec_lsda1Dn + DH1Dn;
@@ -521,18 +538,20 @@ void basic_r2scanc_spin_variables(int length, double *rho, double *normDrho, dou
         theRho = rho[i];
         theNormDrho = normDrho[i];
         theTau = tau[i];
-        s_dsdn_dsddn[0][i] = theNormDrho / (2.0 * threeMPi2_1o3 * pow(theRho, 4.0/3.0));
+        double rho_1o3 = cbrt(theRho), rho_2o3 = rho_1o3*rho_1o3;
+        double rho_4o3 = theRho*rho_1o3, rho_5o3 = rho_4o3*rho_1o3, rho_7o3 = rho_4o3*theRho;
+        s_dsdn_dsddn[0][i] = theNormDrho / (2.0 * threeMPi2_1o3 * rho_4o3);
         p_dpdn_dpddn[0][i] = s_dsdn_dsddn[0][i]*s_dsdn_dsddn[0][i];
         zeta_dzetadnup_dzetadndn[0][i] = (rho[length+i] - rho[length*2+i]) / theRho;
         theZeta = zeta_dzetadnup_dzetadndn[0][i];
         tauw = theNormDrho*theNormDrho / (8.0*theRho);
         ds = (pow(1.0+theZeta, 5.0/3.0) + pow(1-theZeta, 5.0/3.0)) / 2.0;
-        tauUnif = 3.0/10.0 * threeMPi2_2o3 * pow(theRho, 5.0/3.0) * ds;
+        tauUnif = 3.0/10.0 * threeMPi2_2o3 * rho_5o3 * ds;
         alpha_dadnup_dadndn_daddn_dadtau[0][i] = (tau[i] - tauw) / (tauUnif + eta*tauw);
 
-        s_dsdn_dsddn[1][i] = -2.0*theNormDrho / (3.0 * threeMPi2_1o3 * pow(theRho, 7.0/3.0)); // ds/dn
+        s_dsdn_dsddn[1][i] = -2.0*theNormDrho / (3.0 * threeMPi2_1o3 * rho_7o3); // ds/dn
         p_dpdn_dpddn[1][i] = 2*s_dsdn_dsddn[0][i]*s_dsdn_dsddn[1][i];
-        s_dsdn_dsddn[2][i] = 1.0 / (2.0 * threeMPi2_1o3 * pow(theRho, 4.0/3.0)); // ds/d|\nabla n|
+        s_dsdn_dsddn[2][i] = 1.0 / (2.0 * threeMPi2_1o3 * rho_4o3); // ds/d|\nabla n|
         p_dpdn_dpddn[2][i] = 2*s_dsdn_dsddn[0][i]*s_dsdn_dsddn[2][i];
         zeta_dzetadnup_dzetadndn[1][i] = 2.0*rho[length*2+i] / (theRho*theRho);
         zeta_dzetadnup_dzetadndn[2][i] = -2.0*rho[length+i] / (theRho*theRho);
@@ -540,8 +559,8 @@ void basic_r2scanc_spin_variables(int length, double *rho, double *normDrho, dou
         DtauwDDn = theNormDrho / (4*theRho);
         DdsDnup = 5.0/3.0 * (pow(1.0+theZeta, 2.0/3.0) - pow(1.0-theZeta, 2.0/3.0)) * zeta_dzetadnup_dzetadndn[1][i] / 2.0;
         DdsDndn = 5.0/3.0 * (pow(1.0+theZeta, 2.0/3.0) - pow(1.0-theZeta, 2.0/3.0)) * zeta_dzetadnup_dzetadndn[2][i] / 2.0;
-        DtauUnifDnup = threeMPi2_2o3 / 2.0 * pow(theRho, 2.0/3.0) * ds + 3.0/10.0 * threeMPi2_2o3 * pow(theRho, 5.0/3.0) * DdsDnup;
-        DtauUnifDndn = threeMPi2_2o3 / 2.0 * pow(theRho, 2.0/3.0) * ds + 3.0/10.0 * threeMPi2_2o3 * pow(theRho, 5.0/3.0) * DdsDndn;
+        DtauUnifDnup = threeMPi2_2o3 / 2.0 * rho_2o3 * ds + 3.0/10.0 * threeMPi2_2o3 * rho_5o3 * DdsDnup;
+        DtauUnifDndn = threeMPi2_2o3 / 2.0 * rho_2o3 * ds + 3.0/10.0 * threeMPi2_2o3 * rho_5o3 * DdsDndn;
         alpha_dadnup_dadndn_daddn_dadtau[1][i] = (-DtauwDn*(tauUnif + eta*tauw) - (theTau - tauw)*(DtauUnifDnup + eta*DtauwDn)) / ((tauUnif + eta*tauw)*(tauUnif + eta*tauw)); // d\alpha/dn
         alpha_dadnup_dadndn_daddn_dadtau[2][i] = (-DtauwDn*(tauUnif + eta*tauw) - (theTau - tauw)*(DtauUnifDndn + eta*DtauwDn)) / ((tauUnif + eta*tauw)*(tauUnif + eta*tauw)); // d\alpha/dn
         alpha_dadnup_dadndn_daddn_dadtau[3][i] = (-DtauwDDn*(tauUnif + eta*tauw) - (theTau - tauw)*eta*DtauwDDn) / ((tauUnif + eta*tauw)*(tauUnif + eta*tauw)); // d\alpha/d|\nabla n|
@@ -585,7 +604,12 @@ void Calculate_r2scanc_spin(int length, double *rho, double **s_dsdn_dsddn, doub
     double c1c = 0.64;
     double c2c = 1.5;
     double dc = 0.7;
+    double tConst = pow(3.0*M_PI*M_PI/16.0, 1.0/3.0);
+    double cx0 = -3.0/(4.0*M_PI) * pow(9.0*M_PI/4.0, 1.0/3.0);
+    double xiInf0 = pow(3.0*M_PI*M_PI/16.0, 2.0/3.0) * (betaRsInf*1.0/(cx0 - f0)); // \xi_{r_s->\inf}(\zeta=0), 0.128026
+    double dp2_4 = pow(dp2, 4.0);
     int i;
+    #pragma omp parallel for schedule(static)
     for (i = 0; i < length; i++) {
         double zeta, phi, dx, s, p, alpha, rs;
         zeta = zeta_dzetadnup_dzetadndn[0][i];
@@ -594,15 +618,14 @@ void Calculate_r2scanc_spin(int length, double *rho, double **s_dsdn_dsddn, doub
         s = s_dsdn_dsddn[0][i];
         p = p_dpdn_dpddn[0][i];
         alpha = alpha_dadnup_dadndn_daddn_dadtau[0][i];
-        rs = pow(0.75/(M_PI*rho[i]), 1.0/3.0);
+        rs = cbrt(0.75/(M_PI*rho[i]));
         // epsilon_c^0 (\alpha approach 0)
-        double ecLDA0, cx0, Gc, w0, xiInf0, gInf0s, H0, ec0;
+        double ecLDA0, Gc, w0, gInf0s, H0, ec0;
         ecLDA0 = -b1c / (1.0 + b2c*sqrt(rs) + b3c*rs);
-        cx0 = -3.0/(4.0*M_PI) * pow(9.0*M_PI/4.0, 1.0/3.0);
         Gc = (1.0 - 2.3631*(dx - 1.0)) * (1.0 - pow(zeta, 12.0));
         w0 = exp(-ecLDA0/b1c) - 1.0;
-        xiInf0 = pow(3.0*M_PI*M_PI/16.0, 2.0/3.0) * (betaRsInf*1.0/(cx0 - f0)); // \xi_{r_s->\inf}(\zeta=0), 0.128026
-        gInf0s = pow(1.0 + 4.0*xiInf0*s*s, -0.25);
+        double gInf0sBase = 1.0 + 4.0*xiInf0*s*s;
+        gInf0s = pow(gInf0sBase, -0.25);
         H0 = b1c*log(1.0 + w0*(1.0 - gInf0s));
         ec0 = (ecLDA0 + H0)*Gc;
         // epsilon_c^1 (\alpha approach 1)
@@ -644,7 +667,7 @@ void Calculate_r2scanc_spin(int length, double *rho, double **s_dsdn_dsddn, doub
         double rPhi3, w1, t, y, deltafc2, ds, ec_lsda0, declsda0_drs;
         rPhi3 = r*phi*phi*phi;
         w1 = exp(-ec_lsda1/rPhi3) - 1.0;
-        t = pow(3.0*M_PI*M_PI/16.0, 1.0/3.0) * s/(phi*sqrRs);
+        t = tConst * s/(phi*sqrRs);
         y = beta / (r*w1) * t*t;
         deltafc2 = 1.0*(-0.64) + 2.0*(-0.4352) + 3.0*(-1.535685604549) + 4.0*3.061560252175 
             + 5.0*(-1.915710236206) + 6.0*0.516884468372 + 7.0*(-0.051848879792);
@@ -654,10 +677,12 @@ void Calculate_r2scanc_spin(int length, double *rho, double **s_dsdn_dsddn, doub
         double deltayPart1, deltayPart2, deltayPart3, deltay, g, H1, ec1;
         deltayPart1 = deltafc2 / (27.0*r*ds*pow(phi, 3.0)*w1);
         deltayPart2 = 20.0*rs*(declsda0_drs - declsda1_drs) - 45.0*eta*(ec_lsda0 - ec_lsda1);
-        deltayPart3 = p*exp(-p*p / pow(dp2, 4.0));
+        double exp_p2 = exp(-p*p / dp2_4);
+        deltayPart3 = p*exp_p2;
         deltay = deltayPart1 * deltayPart2 * deltayPart3;
 
-        g = pow(1.0 + 4.0*(y - deltay), -0.25);
+        double gBase = 1.0 + 4.0*(y - deltay);
+        g = pow(gBase, -0.25);
         H1 = rPhi3 * log(1.0 + w1*(1.0 - g));
         ec1 = ec_lsda1 + H1;
         // interpolate and extrapolate epsilon_c
@@ -681,7 +706,7 @@ void Calculate_r2scanc_spin(int length, double *rho, double **s_dsdn_dsddn, doub
         double DzetaDnup, DzetaDndn, DrsDn, DdxDnup, DdxDndn, DGcDnup, DGcDndn, DgInf0sDs, DgInf0sDn, DgInf0sDDn, DecLDA0Dn, Dw0Dn, DH0Dn, DH0DDn, Dec0Dnup, Dec0Dndn, Dec0DDn;
         DzetaDnup = zeta_dzetadnup_dzetadndn[1][i];
         DzetaDndn = zeta_dzetadnup_dzetadndn[2][i];
-        DrsDn = -4.0*M_PI/9.0 * pow(4.0*M_PI/3.0*rho[i], -4.0/3.0);
+        DrsDn = -rs/(3.0*rho[i]);
         DdxDnup = (4.0/3.0*pow(1.0 + zeta, 1.0/3.0) - 4.0/3.0*pow(1.0 - zeta, 1.0/3.0))/2.0 * DzetaDnup;
         DdxDndn = (4.0/3.0*pow(1.0 + zeta, 1.0/3.0) - 4.0/3.0*pow(1.0 - zeta, 1.0/3.0))/2.0 * DzetaDndn;
         DGcDnup = -2.3631*DdxDnup*(1.0 - pow(zeta, 12.0)) + (1.0 - 2.3631*(dx - 1))*(-12.0*pow(zeta, 11.0)*DzetaDnup);
@@ -689,7 +714,7 @@ void Calculate_r2scanc_spin(int length, double *rho, double **s_dsdn_dsddn, doub
         //     printf("point 4, DdxDnup %10.8f, DzetaDnup %10.8f\n", DdxDnup, DzetaDnup);
         // }
         DGcDndn = -2.3631*DdxDndn*(1.0 - pow(zeta, 12.0)) + (1.0 - 2.3631*(dx - 1))*(-12.0*pow(zeta, 11.0)*DzetaDndn);
-        DgInf0sDs = -0.25*pow(1.0 + 4.0*xiInf0*s*s, -1.25) * (4.0*xiInf0*2.0*s);
+        DgInf0sDs = -0.25*gInf0s/gInf0sBase * (4.0*xiInf0*2.0*s);
         DgInf0sDn = DgInf0sDs * s_dsdn_dsddn[1][i];
         DgInf0sDDn = DgInf0sDs * s_dsdn_dsddn[2][i];
         DecLDA0Dn = b1c*(0.5*b2c/sqrRs + b3c) / pow(1.0 + b2c*sqrRs + b3c*rs, 2.0) * DrsDn;
@@ -743,8 +768,8 @@ void Calculate_r2scanc_spin(int length, double *rho, double **s_dsdn_dsddn, doub
         DbetaDn = 0.066725*(0.1*(1.0 + 0.1778*rs) - 0.1778*(1.0 + 0.1*rs)) / (1.0 + 0.1778*rs) / (1.0 + 0.1778*rs) * DrsDn;
         DphiDnup = 0.5*(2.0/3.0*pow(1.0 + zeta, -1.0/3.0) - 2.0/3.0*pow(1.0 - zeta, -1.0/3.0)) * DzetaDnup;
         DphiDndn = 0.5*(2.0/3.0*pow(1.0 + zeta, -1.0/3.0) - 2.0/3.0*pow(1.0 - zeta, -1.0/3.0)) * DzetaDndn;
-        DtDnup = pow(3.0*M_PI*M_PI/16.0, 1.0/3.0) * (phi*sqrRs*s_dsdn_dsddn[1][i] - s*(DphiDnup*sqrRs + phi*DrsDn/(2.0*sqrRs))) / (phi*phi*rs);
-        DtDndn = pow(3.0*M_PI*M_PI/16.0, 1.0/3.0) * (phi*sqrRs*s_dsdn_dsddn[1][i] - s*(DphiDndn*sqrRs + phi*DrsDn/(2.0*sqrRs))) / (phi*phi*rs);
+        DtDnup = tConst * (phi*sqrRs*s_dsdn_dsddn[1][i] - s*(DphiDnup*sqrRs + phi*DrsDn/(2.0*sqrRs))) / (phi*phi*rs);
+        DtDndn = tConst * (phi*sqrRs*s_dsdn_dsddn[1][i] - s*(DphiDndn*sqrRs + phi*DrsDn/(2.0*sqrRs))) / (phi*phi*rs);
         DtDDn = t*s_dsdn_dsddn[2][i]/s;
         Dw1Dnup = (w1 + 1.0) * (-(rPhi3*Dec_lsda1Dnup - r*ec_lsda1*(3.0*phi*phi*DphiDnup)) / rPhi3 / rPhi3);
         Dw1Dndn = (w1 + 1.0) * (-(rPhi3*Dec_lsda1Dndn - r*ec_lsda1*(3.0*phi*phi*DphiDndn)) / rPhi3 / rPhi3);
@@ -773,7 +798,7 @@ void Calculate_r2scanc_spin(int length, double *rho, double **s_dsdn_dsddn, doub
         d_deltayPart2_dndn = 20.0*(declsda0_drs - declsda1_drs)*DrsDn 
             + 20.0*rs*(Ddeclsda0_drsDndn - Ddeclsda1_drsDndn) 
             - 45.0*eta*(Declsda0Dndn - Dec_lsda1Dndn);
-        d_deltayPart3_dp = exp(-p*p/pow(dp2, 4.0)) + p*exp(-p*p/pow(dp2, 4.0))*(-2*p/pow(dp2, 4.0));
+        d_deltayPart3_dp = exp_p2 + p*exp_p2*(-2*p/dp2_4);
         DdeltayDnup = d_deltayPart1_dnup*deltayPart2*deltayPart3 
             + deltayPart1*d_deltayPart2_dnup*deltayPart3 
             + deltayPart1*deltayPart2*d_deltayPart3_dp*p_dpdn_dpddn[1][i]; // new variable
@@ -782,9 +807,9 @@ void Calculate_r2scanc_spin(int length, double *rho, double **s_dsdn_dsddn, doub
             + deltayPart1*deltayPart2*d_deltayPart3_dp*p_dpdn_dpddn[1][i]; // new variable
         DdeltayDDn = deltayPart1*deltayPart2*d_deltayPart3_dp*p_dpdn_dpddn[2][i];
         double DgDnup, DgDndn, DgDDn, DH1Dnup, DH1Dndn, DH1DDn, Dec1Dnup, Dec1Dndn, Dec1DDn;
-        DgDnup = -0.25*pow(1.0 + 4.0*(y - deltay), -1.25) * (4.0*(DyDnup - DdeltayDnup)); // new formula
-        DgDndn = -0.25*pow(1.0 + 4.0*(y - deltay), -1.25) * (4.0*(DyDndn - DdeltayDndn));
-        DgDDn = -0.25*pow(1.0 + 4.0*(y - deltay), -1.25) * (4.0*(DyDDn - DdeltayDDn));
+        DgDnup = -0.25*g/gBase * (4.0*(DyDnup - DdeltayDnup)); // new formula
+        DgDndn = -0.25*g/gBase * (4.0*(DyDndn - DdeltayDndn));
+        DgDDn = -0.25*g/gBase * (4.0*(DyDDn - DdeltayDDn));
         DH1Dnup = 3*r*phi*phi*DphiDnup*log(1.0 + w1*(1.0 - g)) + rPhi3*(Dw1Dnup*(1.0 - g) - w1*DgDnup) / (1.0 + w1*(1.0 - g));
         DH1Dndn = 3*r*phi*phi*DphiDndn*log(1.0 + w1*(1.0 - g)) + rPhi3*(Dw1Dndn*(1.0 - g) - w1*DgDndn) / (1.0 + w1*(1.0 - g));
         DH1DDn = rPhi3*(-w1*DgDDn) / (1.0 + w1*(1.0 - g));
@@ -19,6 +19,7 @@
 
 #include "mGGAscan.h"
 #include "isddft.h"
+#include "exchangeCorrelation.h"
 
 
 void scanx(int DMnd, double *rho, double *sigma, double *tau, double *ex, double *vx, double *v2x, double *v3x) {
@@ -62,17 +63,20 @@ void basic_MGGA_variables(int length, double *rho, double *normDrho, double *tau
     int i;
     double threeMPi2_1o3 = pow(3.0*M_PI*M_PI, 1.0/3.0);
     double threeMPi2_2o3 = threeMPi2_1o3*threeMPi2_1o3;
+    #pragma omp parallel for schedule(static)
     for (i = 0; i < length; i++) {
-        s_dsdn_dsddn[0][i] = normDrho[i] / (2.0 * threeMPi2_1o3 * pow(rho[i], 4.0/3.0));
+        double rho_1o3 = cbrt(rho[i]), rho_2o3 = rho_1o3*rho_1o3;
+        double rho_4o3 = rho[i]*rho_1o3, rho_5o3 = rho_4o3*rho_1o3, rho_7o3 = rho_4o3*rho[i];
+        s_dsdn_dsddn[0][i] = normDrho[i] / (2.0 * threeMPi2_1o3 * rho_4o3);
         double tauw = normDrho[i]*normDrho[i] / (8*rho[i]);
-        double tauUnif = 3.0/10.0 * threeMPi2_2o3 * pow(rho[i], 5.0/3.0);
+        double tauUnif = 3.0/10.0 * threeMPi2_2o3 * rho_5o3;
         alpha_dadn_daddn_dadtau[0][i] = (tau[i] - tauw) / tauUnif;
 
-        s_dsdn_dsddn[1][i] = -2.0*normDrho[i] / (3.0 * threeMPi2_1o3 * pow(rho[i], 7.0/3.0)); // ds/dn
-        s_dsdn_dsddn[2][i] = 1.0 / (2.0 * threeMPi2_1o3 * pow(rho[i], 4.0/3.0)); // ds/d|\nabla n|
+        s_dsdn_dsddn[1][i] = -2.0*normDrho[i] / (3.0 * threeMPi2_1o3 * rho_7o3); // ds/dn
+        s_dsdn_dsddn[2][i] = 1.0 / (2.0 * threeMPi2_1o3 * rho_4o3); // ds/d|\nabla n|
         double DtauwDn = -normDrho[i]*normDrho[i] / (8*rho[i]*rho[i]);
         double DtauwDDn = normDrho[i] / (4*rho[i]);
-        double DtauUnifDn = threeMPi2_2o3 / 2.0 * pow(rho[i], 2.0/3.0);
+        double DtauUnifDn = threeMPi2_2o3 / 2.0 * rho_2o3;
         alpha_dadn_daddn_dadtau[1][i] = (-DtauwDn*tauUnif - (tau[i] - tauw)*DtauUnifDn) / (tauUnif*tauUnif); // d\alpha/dn
         alpha_dadn_daddn_dadtau[2][i] = (-DtauwDDn) / tauUnif; // d\alpha/d|\nabla n|
         alpha_dadn_daddn_dadtau[3][i] = 1.0 / tauUnif; // d\alpha/d\tau
@@ -100,66 +104,100 @@ void Calculate_scanx(int length, double *rho, double **s_dsdn_dsddn, double **al
     double dx = 1.24;
     // constants for Fx, which is mixing of h_x^0 and h_x^1
     double a1 = 4.9479;
-    int i;
-    for (i = 0; i < length; i++) {
-        double epsilon_xUnif = -3.0/(4.0*M_PI) * pow(3.0*M_PI*M_PI * rho[i], 1.0/3.0);
-        // compose h_x^1
-        double s = s_dsdn_dsddn[0][i];
-        double s2 = s*s;
-        double alpha = alpha_dadn_daddn_dadtau[0][i];
-        double term1 = 1.0 + b4*s2/mu_ak*exp(-fabs(b4)*s2/mu_ak);
-        double xFir = mu_ak*s2 * term1;
-        double term3 = 2.0*(b1*s2 + b2*(1.0 - alpha)*exp(-b3*(1.0 - alpha)*(1.0 - alpha)));
-        double xSec = (term3/2.0)*(term3/2.0);
-        double hx1 = 1.0 + k1 - k1/(1.0 + (xFir + xSec)/k1); // x = xFir + xSec
-        double fx;
-        if (alpha > 1.0) {
-            fx = -dx*exp(c2x / (1.0 - alpha));
+    int nchunk = (length + XC_CHUNK - 1) / XC_CHUNK;
+    #pragma omp parallel for schedule(static)
+    for (int ic = 0; ic < nchunk; ic++) {
+        double cbrt_rho[XC_CHUNK], exp_b4s2_[XC_CHUNK], exp_b3a2_[XC_CHUNK], exp_fx[XC_CHUNK];
+        double sqrt_s_[XC_CHUNK], exp_a1s_[XC_CHUNK];
+        int i0 = ic * XC_CHUNK;
+        int len = (length - i0 < XC_CHUNK) ? length - i0 : XC_CHUNK;
+        // transcendental functions of the chunk, each in its own loop
+        for (int k = 0; k < len; k++)
+            cbrt_rho[k] = cbrt(3.0*M_PI*M_PI * rho[i0+k]);
+        for (int k = 0; k < len; k++) {
+            double s = s_dsdn_dsddn[0][i0+k];
+            exp_b4s2_[k] = exp(-fabs(b4)*(s*s)/mu_ak);
         }
-        else {
-            fx = exp(-c1x*alpha / (1.0 - alpha));
-        } // when \alpha == 1.0, fx should be 0.0
-        double sqrt_s = sqrt(s);
-        double gx = 1.0 - exp(-a1/sqrt_s);
-        double Fx = (hx1 + fx*(hx0 - hx1))*gx;
-        epsilonx[i] = epsilon_xUnif*Fx;
-
-        double term2 = s2*(b4/mu_ak*exp(-fabs(b4)*s2/mu_ak) + b4*s2/mu_ak*exp(-fabs(b4)*s2/mu_ak)*(-fabs(b4)/mu_ak));
-        double term4 = b2*(-exp(-b3*(1.0 - alpha)*(1.0 - alpha)) + (1.0 - alpha)*exp(-b3*(1.0 - alpha)*(1.0 - alpha))*(2*b3*(1.0 - alpha)));
-        // printf("point %3d, term1 %.7E, term2 %.7E, term3 %.7E, term4 %.7E\n", i, term1, term2, term3, term4);
-        double DxDs = 2*s*(mu_ak*(term1 + term2) + b1*term3);
-        double DxDalpha = term3*term4;
-        double DxDn = s_dsdn_dsddn[1][i]*DxDs + alpha_dadn_daddn_dadtau[1][i]*DxDalpha;
-        double DxDDn = s_dsdn_dsddn[2][i]*DxDs + alpha_dadn_daddn_dadtau[2][i]*DxDalpha;
-        double DxDtau = alpha_dadn_daddn_dadtau[3][i]*DxDalpha;
-        // printf("point %3d, DxDn %.7E, DxDDn %.7E, DxDtau %.7E\n", i, DxDn, DxDDn, DxDtau);
-
-        double DgxDn = -exp(-a1/sqrt_s)*(a1/2.0/sqrt_s/s)*s_dsdn_dsddn[1][i];
-        double DgxDDn = -exp(-a1/sqrt_s)*(a1/2.0/sqrt_s/s)*s_dsdn_dsddn[2][i];
-        double Dhx1Dx = 1.0 / (1.0 + (xFir + xSec)/k1) / (1.0 + (xFir + xSec)/k1);
-        double Dhx1Dn = DxDn*Dhx1Dx;
-        double Dhx1DDn = DxDDn*Dhx1Dx;
-        double Dhx1Dtau = DxDtau*Dhx1Dx;
-        // printf("point %3d, Dhx1Dn %.7E, Dhx1DDn %.7E, Dhx1Dtau %.7E\n", i, Dhx1Dn, Dhx1DDn, Dhx1Dtau);
-        double DfxDalpha;
-        if (alpha > 1.0) {
-            DfxDalpha = -dx*exp(c2x/(1.0 - alpha)) * (c2x/(1.0 - alpha)/(1.0 - alpha));
+        for (int k = 0; k < len; k++) {
+            double oneMalpha = 1.0 - alpha_dadn_daddn_dadtau[0][i0+k];
+            exp_b3a2_[k] = exp(-b3*oneMalpha*oneMalpha);
         }
-        else {
-            DfxDalpha = exp(-c1x*alpha/(1.0 - alpha)) * (-c1x/(1.0 - alpha)/(1 - alpha));
+        for (int k = 0; k < len; k++) {
+            double alpha = alpha_dadn_daddn_dadtau[0][i0+k];
+            exp_fx[k] = (alpha > 1.0) ? c2x / (1.0 - alpha) : -c1x*alpha / (1.0 - alpha);
+        }
+        for (int k = 0; k < len; k++)
+            exp_fx[k] = exp(exp_fx[k]);
+        for (int k = 0; k < len; k++)
+            sqrt_s_[k] = sqrt(s_dsdn_dsddn[0][i0+k]);
+        for (int k = 0; k < len; k++)
+            exp_a1s_[k] = exp(-a1/sqrt_s_[k]);
+
+        for (int k = 0; k < len; k++) {
+            int i = i0 + k;
+            double epsilon_xUnif = -3.0/(4.0*M_PI) * cbrt_rho[k];
+            // compose h_x^1
+            double s = s_dsdn_dsddn[0][i];
+            double s2 = s*s;
+            double alpha = alpha_dadn_daddn_dadtau[0][i];
+            double exp_b4s2 = exp_b4s2_[k];
+            double oneMalpha = 1.0 - alpha;
+            double exp_b3a2 = exp_b3a2_[k];
+            double term1 = 1.0 + b4*s2/mu_ak*exp_b4s2;
+            double xFir = mu_ak*s2 * term1;
+            double term3 = 2.0*(b1*s2 + b2*oneMalpha*exp_b3a2);
+            double xSec = (term3/2.0)*(term3/2.0);
+            double hx1 = 1.0 + k1 - k1/(1.0 + (xFir + xSec)/k1); // x = xFir + xSec
+            double fx;
+            if (alpha > 1.0) {
+                fx = -dx*exp_fx[k];
+            }
+            else {
+                fx = exp_fx[k];
+            } // when \alpha == 1.0, fx should be 0.0
+            double sqrt_s = sqrt_s_[k];
+            double exp_a1s = exp_a1s_[k];
+            double gx = 1.0 - exp_a1s;
+            double Fx = (hx1 + fx*(hx0 - hx1))*gx;
+            epsilonx[i] = epsilon_xUnif*Fx;
+
+            double term2 = s2*(b4/mu_ak*exp_b4s2 + b4*s2/mu_ak*exp_b4s2*(-fabs(b4)/mu_ak));
+            double term4 = b2*(-exp_b3a2 + oneMalpha*exp_b3a2*(2*b3*oneMalpha));
+            // printf("point %3d, term1 %.7E, term2 %.7E, term3 %.7E, term4 %.7E\n", i, term1, term2, term3, term4);
+            double DxDs = 2*s*(mu_ak*(term1 + term2) + b1*term3);
+            double DxDalpha = term3*term4;
+            double DxDn = s_dsdn_dsddn[1][i]*DxDs + alpha_dadn_daddn_dadtau[1][i]*DxDalpha;
+            double DxDDn = s_dsdn_dsddn[2][i]*DxDs + alpha_dadn_daddn_dadtau[2][i]*DxDalpha;
+            double DxDtau = alpha_dadn_daddn_dadtau[3][i]*DxDalpha;
+            // printf("point %3d, DxDn %.7E, DxDDn %.7E, DxDtau %.7E\n", i, DxDn, DxDDn, DxDtau);
+
+            double DgxDn = -exp_a1s*(a1/2.0/sqrt_s/s)*s_dsdn_dsddn[1][i];
+            double DgxDDn = -exp_a1s*(a1/2.0/sqrt_s/s)*s_dsdn_dsddn[2][i];
+            double Dhx1Dx = 1.0 / (1.0 + (xFir + xSec)/k1) / (1.0 + (xFir + xSec)/k1);
+            double Dhx1Dn = DxDn*Dhx1Dx;
+            double Dhx1DDn = DxDDn*Dhx1Dx;
+            double Dhx1Dtau = DxDtau*Dhx1Dx;
+            // printf("point %3d, Dhx1Dn %.7E, Dhx1DDn %.7E, Dhx1Dtau %.7E\n", i, Dhx1Dn, Dhx1DDn, Dhx1Dtau);
+            double DfxDalpha;
+            if (alpha > 1.0) {
+                DfxDalpha = fx * (c2x/oneMalpha/oneMalpha);
+            }
+            else {
+                DfxDalpha = fx * (-c1x/oneMalpha/oneMalpha);
+            }
+            double DfxDn = DfxDalpha*alpha_dadn_daddn_dadtau[1][i];
+            double DfxDDn = DfxDalpha*alpha_dadn_daddn_dadtau[2][i];
+            double DfxDtau = DfxDalpha*alpha_dadn_daddn_dadtau[3][i];
+            double DFxDn = (hx1 + fx*(hx0 - hx1))*DgxDn + gx*(1.0 - fx)*Dhx1Dn + gx*(hx0 - hx1)*DfxDn;
+            double DFxDDn = (hx1 + fx*(hx0 - hx1))*DgxDDn + gx*(1.0 - fx)*Dhx1DDn + gx*(hx0 - hx1)*DfxDDn;
+            double DFxDtau = gx*(1.0 - fx)*Dhx1Dtau + gx*(hx0 - hx1)*DfxDtau;
+            // printf("point %3d, DFxDn %.7E, DFxDDn %.7E, DFxDtau %.7E\n", i, DFxDn, DFxDDn, DFxDtau);
+            // solve variant of n*epsilon_x^{unif}*F_x
+            double Depsilon_xUnifDn = epsilon_xUnif / (3.0*rho[i]);
+            vx1[i] = (epsilon_xUnif + rho[i]*Depsilon_xUnifDn)*Fx + rho[i]*epsilon_xUnif*DFxDn;
+            vx2[i] = rho[i]*epsilon_xUnif*DFxDDn;
+            vx3[i] = rho[i]*epsilon_xUnif*DFxDtau;
         }
-        double DfxDn = DfxDalpha*alpha_dadn_daddn_dadtau[1][i];
-        double DfxDDn = DfxDalpha*alpha_dadn_daddn_dadtau[2][i];
-        double DfxDtau = DfxDalpha*alpha_dadn_daddn_dadtau[3][i];
-        double DFxDn = (hx1 + fx*(hx0 - hx1))*DgxDn + gx*(1.0 - fx)*Dhx1Dn + gx*(hx0 - hx1)*DfxDn;
-        double DFxDDn = (hx1 + fx*(hx0 - hx1))*DgxDDn + gx*(1.0 - fx)*Dhx1DDn + gx*(hx0 - hx1)*DfxDDn;
-        double DFxDtau = gx*(1.0 - fx)*Dhx1Dtau + gx*(hx0 - hx1)*DfxDtau;
-        // printf("point %3d, DFxDn %.7E, DFxDDn %.7E, DFxDtau %.7E\n", i, DFxDn, DFxDDn, DFxDtau);
-        // solve variant of n*epsilon_x^{unif}*F_x
-        double Depsilon_xUnifDn = -pow(3.0*M_PI*M_PI, 1.0/3.0) / (4.0*M_PI) * pow(rho[i], -2.0/3.0);
-        vx1[i] = (epsilon_xUnif + rho[i]*Depsilon_xUnifDn)*Fx + rho[i]*epsilon_xUnif*DFxDn;
-        vx2[i] = rho[i]*epsilon_xUnif*DFxDDn;
-        vx3[i] = rho[i]*epsilon_xUnif*DFxDtau;
     }
     // for (i = 0; i < length; i++) {
     //     printf("point %3d, epsilon_x %.7E, vx1 %.7E, vx2 %.7E, vx3 %.7E\n", i, epsilonx[i], vx1[i], vx2[i], vx3[i]);
@@ -225,102 +263,151 @@ void Calculate_scanc(int length, double *rho, double **s_dsdn_dsddn, double **al
     double c1c = 0.64;
     double c2c = 1.5;
     double dc = 0.7;
-    int i;
-    for (i = 0; i < length; i++) {
-        double zeta = 0; // now SCAN does not contain spin
-        double phi = (pow(1.0 + zeta, 2.0/3.0) + pow(1.0 - zeta, 2.0/3.0)) / 2.0; // Since there is no spin, phi should be equal to 1
-        double dx = (pow(1.0 + zeta, 4.0/3.0) + pow(1.0 - zeta, 4.0/3.0)) / 2.0; // Since there is no spin, dx should be equal to 1
-        double s = s_dsdn_dsddn[0][i];
-        double alpha = alpha_dadn_daddn_dadtau[0][i];
-        double rs = pow(0.75/(M_PI*rho[i]), 1.0/3.0);
-        // epsilon_c^0 (\alpha approach 0)
-        double ecLDA0 = -b1c / (1.0 + b2c*sqrt(rs) + b3c*rs);
-        double cx0 = -3.0/(4.0*M_PI) * pow(9.0*M_PI/4.0, 1.0/3.0);
-        double Gc = (1.0 - 2.3631*(dx - 1.0)) * (1.0 - pow(zeta, 12.0));
-        double w0 = exp(-ecLDA0/b1c) - 1.0;
-        double xiInf0 = pow(3.0*M_PI*M_PI/16.0, 2.0/3.0) * (betaRsInf*1.0/(cx0 - f0)); // \xi_{r_s->\inf}(\zeta=0), 0.128026
-        double gInf0s = pow(1.0 + 4.0*xiInf0*s*s, -0.25);
-        double H0 = b1c*log(1.0 + w0*(1.0 - gInf0s));
-        double ec0 = (ecLDA0 + H0)*Gc;
-        // epsilon_c^1 (\alpha approach 1)
-        double sqrRs = sqrt(rs);
-        double beta = betaConst * (1.0 + 0.1*rs) / (1.0 + 0.1778*rs);
-        // epsilon_c LSDA1
-        double ec_q0 = -2.0*AA*(1.0 + alpha1*rs);
-        double ec_q1 = 2.0*AA*(beta1*sqrRs + beta2*rs + beta3*rs*sqrRs + beta4*rs*rs);
-        double ec_den = 1.0 / (ec_q1*ec_q1 + ec_q1);
-        double ec_log = -log(ec_q1*ec_q1*ec_den);
-        double ec_lsda1 = ec_q0*ec_log;
-        // H1
-        double rPhi3 = r*phi*phi*phi;
-        double w1 = exp(-ec_lsda1/rPhi3) - 1.0;
-        double A = beta / (r*w1);
-        double t = pow(3.0*M_PI*M_PI/16.0, 1.0/3.0) * s/(phi*sqrRs);
-        double g = pow(1.0 + 4.0*A*t*t, -0.25);
-        double H1 = rPhi3 * log(1.0 + w1*(1.0 - g));
-        double ec1 = ec_lsda1 + H1;
-        // printf("point %3d, ec0 %.7E, ec1 %.7E\n", i, ec0, ec1);
-        // interpolate and extrapolate epsilon_c
-        double fc;
-        if (alpha > 1.0) {
-            fc = -dc*exp(c2c / (1.0 - alpha));
+    // quantities depending only on zeta, which is 0 since SCAN here does not contain spin
+    double zeta = 0;
+    double phi = (pow(1.0 + zeta, 2.0/3.0) + pow(1.0 - zeta, 2.0/3.0)) / 2.0; // Since there is no spin, phi should be equal to 1
+    double dx = (pow(1.0 + zeta, 4.0/3.0) + pow(1.0 - zeta, 4.0/3.0)) / 2.0; // Since there is no spin, dx should be equal to 1
+    double cx0 = -3.0/(4.0*M_PI) * pow(9.0*M_PI/4.0, 1.0/3.0);
+    double Gc = (1.0 - 2.3631*(dx - 1.0)) * (1.0 - pow(zeta, 12.0));
+    double xiInf0 = pow(3.0*M_PI*M_PI/16.0, 2.0/3.0) * (betaRsInf*1.0/(cx0 - f0)); // \xi_{r_s->\inf}(\zeta=0), 0.128026
+    double tConst = pow(3.0*M_PI*M_PI/16.0, 1.0/3.0);
+    double DzetaDn = 0.0; // no spin
+    double DdxDn = (4.0/3.0*pow(1.0 + zeta, 1.0/3.0) - 4.0/3.0*pow(1.0 - zeta, 1.0/3.0))*DzetaDn; // when there is no spin, it should be 0
+    double DGcDn = -2.3631*DdxDn*(1.0 - pow(zeta, 12.0)) + (1.0 - 2.3631*(dx - 1))*(12.0*pow(zeta, 11.0)*DzetaDn);
+    double DphiDn = 0.5*(2.0/3.0*pow(1.0 + zeta, -1.0/3.0) - 2.0/3.0*pow(1.0 - zeta, -1.0/3.0)) * DzetaDn; // no spin, it should be 0
+    int nchunk = (length + XC_CHUNK - 1) / XC_CHUNK;
+    #pragma omp parallel for schedule(static)
+    for (int ic = 0; ic < nchunk; ic++) {
+        double rs_[XC_CHUNK], sqrRs_[XC_CHUNK], gInf0s_[XC_CHUNK], w0_[XC_CHUNK], ec_log_[XC_CHUNK];
+        double w1_[XC_CHUNK], g_[XC_CHUNK], logH0[XC_CHUNK], logH1[XC_CHUNK], fc_[XC_CHUNK];
+        int i0 = ic * XC_CHUNK;
+        int len = (length - i0 < XC_CHUNK) ? length - i0 : XC_CHUNK;
+        // transcendental functions of the chunk, each in its own loop
+        for (int k = 0; k < len; k++)
+            rs_[k] = cbrt(0.75/(M_PI*rho[i0+k]));
+        for (int k = 0; k < len; k++)
+            sqrRs_[k] = sqrt(rs_[k]);
+        for (int k = 0; k < len; k++) {
+            double s = s_dsdn_dsddn[0][i0+k];
+            gInf0s_[k] = pow(1.0 + 4.0*xiInf0*s*s, -0.25);
         }
-        else {
-            fc = exp(-c1c*alpha / (1.0 - alpha));
+        for (int k = 0; k < len; k++) {
+            double ecLDA0 = -b1c / (1.0 + b2c*sqrRs_[k] + b3c*rs_[k]);
+            w0_[k] = exp(-ecLDA0/b1c) - 1.0;
         }
-        epsilonc[i] = ec1 + fc*(ec0 - ec1);
-        // compute variation of epsilon_c^0
-        double DzetaDn = 0.0; // no spin
-        double DrsDn = -4.0*M_PI/9.0 * pow(4.0*M_PI/3.0*rho[i], -4.0/3.0);
-        double DdxDn = (4.0/3.0*pow(1.0 + zeta, 1.0/3.0) - 4.0/3.0*pow(1.0 - zeta, 1.0/3.0))*DzetaDn; // when there is no spin, it should be 0
-        double DGcDn = -2.3631*DdxDn*(1.0 - pow(zeta, 12.0)) + (1.0 - 2.3631*(dx - 1))*(12.0*pow(zeta, 11.0)*DzetaDn);
-        double DgInf0sDs = -0.25*pow(1.0 + 4.0*xiInf0*s*s, -1.25) * (4.0*xiInf0*2.0*s);
-        double DgInf0sDn = DgInf0sDs * s_dsdn_dsddn[1][i];
-        double DgInf0sDDn = DgInf0sDs * s_dsdn_dsddn[2][i];
-        double DecLDA0Dn = b1c*(0.5*b2c/sqrRs + b3c) / pow(1.0 + b2c*sqrRs + b3c*rs, 2.0) * DrsDn;
-        double Dw0Dn = (w0 + 1.0) * (-DecLDA0Dn/b1c);
-        double DH0Dn = b1c*(Dw0Dn*(1.0 - gInf0s) - w0*DgInf0sDn) / (1.0 + w0*(1.0 - gInf0s));
-        double DH0DDn = b1c*(-w0*DgInf0sDDn) / (1.0 + w0*(1.0 - gInf0s));
-        double Dec0Dn = (DecLDA0Dn + DH0Dn)*Gc + (ecLDA0 + H0)*DGcDn;
-        double Dec0DDn = DH0DDn*Gc;
-        // compute variation of epsilon_c^1
-
-        double denominatorInLogLSDA1 = 2.0*AA*(beta1*sqrRs + beta2*rs + beta3*sqrRs*rs + beta4*pow(rs, p + 1.0));
-        double Dec_lsda1Dn = -(rs/rho[i]/3.0) * (-2.0*AA*alpha1*log(1.0 + 1.0/denominatorInLogLSDA1)
-            -((-2.0*AA*(1.0 + alpha1*rs))*(AA*(beta1/sqrRs + 2.0*beta2 + 3.0*beta3*sqrRs + 2.0*(p + 1.0)*beta4*pow(rs, p))))
-            / (denominatorInLogLSDA1*denominatorInLogLSDA1 + denominatorInLogLSDA1)); // from LDA_PW. If spin is added, the formula needs to be modified!
-        // printf("point %3d, epsilonc %.7E, Dec0Dn %.7E, Dec_lsda1Dn %.7E\n", i, epsilonc[i], Dec0Dn, Dec_lsda1Dn);
-        double DbetaDn = 0.066725*(0.1*(1.0 + 0.1778*rs) - 0.1778*(1.0 + 0.1*rs)) / (1.0 + 0.1778*rs) / (1.0 + 0.1778*rs) * DrsDn;
-        double DphiDn = 0.5*(2.0/3.0*pow(1.0 + zeta, -1.0/3.0) - 2.0/3.0*pow(1.0 - zeta, -1.0/3.0)) * DzetaDn; // no spin, it should be 0
-        double DtDn = pow(3.0*M_PI*M_PI/16.0, 1.0/3.0) * (phi*sqrRs*s_dsdn_dsddn[1][i] - s*(DphiDn*sqrRs + phi*DrsDn/(2.0*sqrRs))) / (phi*phi*rs);
-        double DtDDn = t*s_dsdn_dsddn[2][i]/s;
-        double Dw1Dn = (w1 + 1.0) * (-(rPhi3*Dec_lsda1Dn - r*ec_lsda1*(3.0*phi*phi*DphiDn)) / rPhi3 / rPhi3);
-        double DADn = (w1*DbetaDn - beta*Dw1Dn) / (r*w1*w1);
-        double DgDn = -0.25*pow(1.0 + 4.0*A*t*t, -1.25) * (4.0*(DADn*t*t + 2.0*A*t*DtDn));
-        double DgDDn = -0.25*pow(1.0 + 4.0*A*t*t, -1.25) * (4.0*2.0*A*t*DtDDn);
-        double DH1Dn = 3*r*phi*phi*DphiDn*log(1.0 + w1*(1.0 - g)) + rPhi3*(Dw1Dn*(1.0 - g) - w1*DgDn) / (1.0 + w1*(1.0 - g));
-        double DH1DDn = rPhi3*(-w1*DgDDn) / (1.0 + w1*(1.0 - g));
-        double Dec1Dn = Dec_lsda1Dn + DH1Dn;
-        double Dec1DDn = DH1DDn;
-        // printf("point %3d, DH1Dn %.7E, DH1DDn %.7E\n", i, DH1Dn, DH1DDn);
-
-        // compute variation of f_c and epsilon_c
-        double DfcDalpha;
-        if (alpha > 1.0) {
-            DfcDalpha = fc*(c2c/(1.0 - alpha)/(1.0 - alpha));
+        for (int k = 0; k < len; k++) {
+            double rs = rs_[k], sqrRs = sqrRs_[k];
+            double ec_q1 = 2.0*AA*(beta1*sqrRs + beta2*rs + beta3*rs*sqrRs + beta4*rs*rs);
+            double ec_den = 1.0 / (ec_q1*ec_q1 + ec_q1);
+            ec_log_[k] = -log(ec_q1*ec_q1*ec_den);
         }
-        else {
-            DfcDalpha = fc*(-c1c/(1.0 - alpha)/(1.0 - alpha));
+        for (int k = 0; k < len; k++) {
+            double ec_lsda1 = -2.0*AA*(1.0 + alpha1*rs_[k])*ec_log_[k];
+            w1_[k] = exp(-ec_lsda1/(r*phi*phi*phi)) - 1.0;
+        }
+        for (int k = 0; k < len; k++) {
+            double beta = betaConst * (1.0 + 0.1*rs_[k]) / (1.0 + 0.1778*rs_[k]);
+            double A = beta / (r*w1_[k]);
+            double t = tConst * s_dsdn_dsddn[0][i0+k]/(phi*sqrRs_[k]);
+            g_[k] = pow(1.0 + 4.0*A*t*t, -0.25);
+        }
+        for (int k = 0; k < len; k++)
+            logH0[k] = log(1.0 + w0_[k]*(1.0 - gInf0s_[k]));
+        for (int k = 0; k < len; k++)
+            logH1[k] = log(1.0 + w1_[k]*(1.0 - g_[k]));
+        for (int k = 0; k < len; k++) {
+            double alpha = alpha_dadn_daddn_dadtau[0][i0+k];
+            fc_[k] = (alpha > 1.0) ? c2c / (1.0 - alpha) : -c1c*alpha / (1.0 - alpha);
+        }
+        for (int k = 0; k < len; k++)
+            fc_[k] = exp(fc_[k]);
+
+        for (int k = 0; k < len; k++) {
+            int i = i0 + k;
+            double s = s_dsdn_dsddn[0][i];
+            double alpha = alpha_dadn_daddn_dadtau[0][i];
+            double rs = rs_[k];
+            // epsilon_c^0 (\alpha approach 0)
+            double ecLDA0 = -b1c / (1.0 + b2c*sqrRs_[k] + b3c*rs);
+            double w0 = w0_[k];
+            double gInf0sBase = 1.0 + 4.0*xiInf0*s*s;
+            double gInf0s = gInf0s_[k];
+            double H0 = b1c*logH0[k];
+            double ec0 = (ecLDA0 + H0)*Gc;
+            // epsilon_c^1 (\alpha approach 1)
+            double sqrRs = sqrRs_[k];
+            double beta = betaConst * (1.0 + 0.1*rs) / (1.0 + 0.1778*rs);
+            // epsilon_c LSDA1
+            double ec_q0 = -2.0*AA*(1.0 + alpha1*rs);
+            double ec_lsda1 = ec_q0*ec_log_[k];
+            // H1
+            double rPhi3 = r*phi*phi*phi;
+            double w1 = w1_[k];
+            double A = beta / (r*w1);
+            double t = tConst * s/(phi*sqrRs);
+            double gBase = 1.0 + 4.0*A*t*t;
+            double g = g_[k];
+            double H1 = rPhi3 * logH1[k];
+            double ec1 = ec_lsda1 + H1;
+            // printf("point %3d, ec0 %.7E, ec1 %.7E\n", i, ec0, ec1);
+            // interpolate and extrapolate epsilon_c
+            double fc;
+            if (alpha > 1.0) {
+                fc = -dc*fc_[k];
+            }
+            else {
+                fc = fc_[k];
+            }
+            epsilonc[i] = ec1 + fc*(ec0 - ec1);
+            // compute variation of epsilon_c^0
+            double DrsDn = -rs/(3.0*rho[i]);
+            double DgInf0sDs = -0.25*gInf0s/gInf0sBase * (4.0*xiInf0*2.0*s);
+            double DgInf0sDn = DgInf0sDs * s_dsdn_dsddn[1][i];
+            double DgInf0sDDn = DgInf0sDs * s_dsdn_dsddn[2][i];
+            double DecLDA0Dn = b1c*(0.5*b2c/sqrRs + b3c) / pow(1.0 + b2c*sqrRs + b3c*rs, 2.0) * DrsDn;
+            double Dw0Dn = (w0 + 1.0) * (-DecLDA0Dn/b1c);
+            double DH0Dn = b1c*(Dw0Dn*(1.0 - gInf0s) - w0*DgInf0sDn) / (1.0 + w0*(1.0 - gInf0s));
+            double DH0DDn = b1c*(-w0*DgInf0sDDn) / (1.0 + w0*(1.0 - gInf0s));
+            double Dec0Dn = (DecLDA0Dn + DH0Dn)*Gc + (ecLDA0 + H0)*DGcDn;
+            double Dec0DDn = DH0DDn*Gc;
+            // compute variation of epsilon_c^1
+
+            double denominatorInLogLSDA1 = 2.0*AA*(beta1*sqrRs + beta2*rs + beta3*sqrRs*rs + beta4*pow(rs, p + 1.0));
+            double Dec_lsda1Dn = -(rs/rho[i]/3.0) * (-2.0*AA*alpha1*log(1.0 + 1.0/denominatorInLogLSDA1)
+                -((-2.0*AA*(1.0 + alpha1*rs))*(AA*(beta1/sqrRs + 2.0*beta2 + 3.0*beta3*sqrRs + 2.0*(p + 1.0)*beta4*pow(rs, p))))
+                / (denominatorInLogLSDA1*denominatorInLogLSDA1 + denominatorInLogLSDA1)); // from LDA_PW. If spin is added, the formula needs to be modified!
+            // printf("point %3d, epsilonc %.7E, Dec0Dn %.7E, Dec_lsda1Dn %.7E\n", i, epsilonc[i], Dec0Dn, Dec_lsda1Dn);
+            double DbetaDn = 0.066725*(0.1*(1.0 + 0.1778*rs) - 0.1778*(1.0 + 0.1*rs)) / (1.0 + 0.1778*rs) / (1.0 + 0.1778*rs) * DrsDn;
+            double DtDn = tConst * (phi*sqrRs*s_dsdn_dsddn[1][i] - s*(DphiDn*sqrRs + phi*DrsDn/(2.0*sqrRs))) / (phi*phi*rs);
+            double DtDDn = t*s_dsdn_dsddn[2][i]/s;
+            double Dw1Dn = (w1 + 1.0) * (-(rPhi3*Dec_lsda1Dn - r*ec_lsda1*(3.0*phi*phi*DphiDn)) / rPhi3 / rPhi3);
+            double DADn = (w1*DbetaDn - beta*Dw1Dn) / (r*w1*w1);
+            double DgDn = -0.25*g/gBase * (4.0*(DADn*t*t + 2.0*A*t*DtDn));
+            double DgDDn = -0.25*g/gBase * (4.0*2.0*A*t*DtDDn);
+            double DH1Dn = 3*r*phi*phi*DphiDn*logH1[k] + rPhi3*(Dw1Dn*(1.0 - g) - w1*DgDn) / (1.0 + w1*(1.0 - g));
+            double DH1DDn = rPhi3*(-w1*DgDDn) / (1.0 + w1*(1.0 - g));
+            double Dec1Dn = Dec_lsda1Dn + DH1Dn;
+            double Dec1DDn = DH1DDn;
+            // printf("point %3d, DH1Dn %.7E, DH1DDn %.7E\n", i, DH1Dn, DH1DDn);
+
+            // compute variation of f_c and epsilon_c
+            double DfcDalpha;
+            if (alpha > 1.0) {
+                DfcDalpha = fc*(c2c/(1.0 - alpha)/(1.0 - alpha));
+            }
+            else {
+                DfcDalpha = fc*(-c1c/(1.0 - alpha)/(1.0 - alpha));
+            }
+            double DfcDn = DfcDalpha*alpha_dadn_daddn_dadtau[1][i];
+            double DfcDDn = DfcDalpha*alpha_dadn_daddn_dadtau[2][i];
+            double DfcDtau = DfcDalpha*alpha_dadn_daddn_dadtau[3][i];
+            double DepsiloncDn = Dec1Dn + fc*(Dec0Dn - Dec1Dn) + DfcDn*(ec0 - ec1);
+            double DepsiloncDDn = Dec1DDn + fc*(Dec0DDn -Dec1DDn) + DfcDDn*(ec0 - ec1);
+            double DepsiloncDtau = DfcDtau*(ec0 - ec1);
+            vc1[i] = epsilonc[i] + rho[i]*DepsiloncDn;
+            vc2[i] = rho[i]*DepsiloncDDn;
+            vc3[i] = rho[i]*DepsiloncDtau;
         }
-        double DfcDn = DfcDalpha*alpha_dadn_daddn_dadtau[1][i];
-        double DfcDDn = DfcDalpha*alpha_dadn_daddn_dadtau[2][i];
-        double DfcDtau = DfcDalpha*alpha_dadn_daddn_dadtau[3][i];
-        double DepsiloncDn = Dec1Dn + fc*(Dec0Dn - Dec1Dn) + DfcDn*(ec0 - ec1);
-        double DepsiloncDDn = Dec1DDn + fc*(Dec0DDn -Dec1DDn) + DfcDDn*(ec0 - ec1);
-        double DepsiloncDtau = DfcDtau*(ec0 - ec1);
-        vc1[i] = epsilonc[i] + rho[i]*DepsiloncDn;
-        vc2[i] = rho[i]*DepsiloncDDn;
-        vc3[i] = rho[i]*DepsiloncDtau;
     }
     // for (i = 0; i < length; i++) {
     //     printf("point %3d, epsilon_c %.7E, vc1 %.7E, vc2 %.7E, vc3 %.7E\n", i, epsilonc[i], vc1[i], vc2[i], vc3[i]);
@@ -372,20 +459,23 @@ void basic_MGSGA_variables_exchange(int length, double *rho, double *normDrho, d
     double threeMPi2_1o3 = pow(3.0*M_PI*M_PI, 1.0/3.0);
     double threeMPi2_2o3 = threeMPi2_1o3*threeMPi2_1o3;
     double theRho, theNormDrho, theTau;
+    #pragma omp parallel for private(theRho, theNormDrho, theTau) schedule(static)
     for (i = 0; i < 2*length; i++) {
         theRho = 2*rho[i];
         theNormDrho = 2*normDrho[i];
         theTau = 2*tau[i];
-        s_dsdn_dsddn[0][i] = theNormDrho / (2.0 * threeMPi2_1o3 * pow(theRho, 4.0/3.0));
+        double rho_1o3 = cbrt(theRho), rho_2o3 = rho_1o3*rho_1o3;
+        double rho_4o3 = theRho*rho_1o3, rho_5o3 = rho_4o3*rho_1o3, rho_7o3 = rho_4o3*theRho;
+        s_dsdn_dsddn[0][i] = theNormDrho / (2.0 * threeMPi2_1o3 * rho_4o3);
         double tauw = theNormDrho*theNormDrho / (8*theRho);
-        double tauUnif = 3.0/10.0 * threeMPi2_2o3 * pow(theRho, 5.0/3.0);
+        double tauUnif = 3.0/10.0 * threeMPi2_2o3 * rho_5o3;
         alpha_dadn_daddn_dadtau[0][i] = (theTau - tauw) / tauUnif;
 
-        s_dsdn_dsddn[1][i] = -2.0*theNormDrho / (3.0 * threeMPi2_1o3 * pow(theRho, 7.0/3.0)); // ds/dn
-        s_dsdn_dsddn[2][i] = 1.0 / (2.0 * threeMPi2_1o3 * pow(theRho, 4.0/3.0)); // ds/d|\nabla n|
+        s_dsdn_dsddn[1][i] = -2.0*theNormDrho / (3.0 * threeMPi2_1o3 * rho_7o3); // ds/dn
+        s_dsdn_dsddn[2][i] = 1.0 / (2.0 * threeMPi2_1o3 * rho_4o3); // ds/d|\nabla n|
         double DtauwDn = -theNormDrho*theNormDrho / (8*theRho*theRho);
         double DtauwDDn = theNormDrho / (4*theRho);
-        double DtauUnifDn = threeMPi2_2o3 / 2.0 * pow(theRho, 2.0/3.0);
+        double DtauUnifDn = threeMPi2_2o3 / 2.0 * rho_2o3;
         alpha_dadn_daddn_dadtau[1][i] = (-DtauwDn*tauUnif - (theTau - tauw)*DtauUnifDn) / (tauUnif*tauUnif); // d\alpha/dn
         alpha_dadn_daddn_dadtau[2][i] = (-DtauwDDn) / tauUnif; // d\alpha/d|\nabla n|
         alpha_dadn_daddn_dadtau[3][i] = 1.0 / tauUnif; // d\alpha/d\tau
@@ -416,16 +506,20 @@ void Calculate_scanx_spin(int length, double *rho, double **s_dsdn_dsddn, double
     int i;
     double theRho;
     double *epsilonx_updn = (double*)malloc(2*length * sizeof(double));
+    #pragma omp parallel for private(theRho) schedule(static)
     for (i = 0; i < 2*length; i++) { // compute both up and down in a for loop
         theRho = rho[i + length]*2.0;
-        double epsilon_xUnif = -3.0/(4.0*M_PI) * pow(3.0*M_PI*M_PI * theRho, 1.0/3.0);
+        double epsilon_xUnif = -3.0/(4.0*M_PI) * cbrt(3.0*M_PI*M_PI * theRho);
         // compose h_x^1
         double s = s_dsdn_dsddn[0][i];
         double s2 = s*s;
         double alpha = alpha_dadn_daddn_dadtau[0][i];
-        double term1 = 1.0 + b4*s2/mu_ak*exp(-fabs(b4)*s2/mu_ak);
+        double exp_b4s2 = exp(-fabs(b4)*s2/mu_ak);
+        double oneMalpha = 1.0 - alpha;
+        double exp_b3a2 = exp(-b3*oneMalpha*oneMalpha);
+        double term1 = 1.0 + b4*s2/mu_ak*exp_b4s2;
         double xFir = mu_ak*s2 * term1;
-        double term3 = 2.0*(b1*s2 + b2*(1.0 - alpha)*exp(-b3*(1.0 - alpha)*(1.0 - alpha)));
+        double term3 = 2.0*(b1*s2 + b2*oneMalpha*exp_b3a2);
         double xSec = (term3/2.0)*(term3/2.0);
         double hx1 = 1.0 + k1 - k1/(1.0 + (xFir + xSec)/k1); // x = xFir + xSec
         double fx;
@@ -436,12 +530,13 @@ void Calculate_scanx_spin(int length, double *rho, double **s_dsdn_dsddn, double
             fx = exp(-c1x*alpha / (1.0 - alpha));
         } // when \alpha == 1.0, fx should be 0.0
         double sqrt_s = sqrt(s);
-        double gx = 1.0 - exp(-a1/sqrt_s);
+        double exp_a1s = exp(-a1/sqrt_s);
+        double gx = 1.0 - exp_a1s;
         double Fx = (hx1 + fx*(hx0 - hx1))*gx;
         epsilonx_updn[i] = epsilon_xUnif*Fx;
 
-        double term2 = s2*(b4/mu_ak*exp(-fabs(b4)*s2/mu_ak) + b4*s2/mu_ak*exp(-fabs(b4)*s2/mu_ak)*(-fabs(b4)/mu_ak));
-        double term4 = b2*(-exp(-b3*(1.0 - alpha)*(1.0 - alpha)) + (1.0 - alpha)*exp(-b3*(1.0 - alpha)*(1.0 - alpha))*(2*b3*(1.0 - alpha)));
+        double term2 = s2*(b4/mu_ak*exp_b4s2 + b4*s2/mu_ak*exp_b4s2*(-fabs(b4)/mu_ak));
+        double term4 = b2*(-exp_b3a2 + oneMalpha*exp_b3a2*(2*b3*oneMalpha));
         // printf("point %3d, term1 %.7E, term2 %.7E, term3 %.7E, term4 %.7E\n", i, term1, term2, term3, term4);
         double DxDs = 2*s*(mu_ak*(term1 + term2) + b1*term3);
         double DxDalpha = term3*term4;
@@ -450,8 +545,8 @@ void Calculate_scanx_spin(int length, double *rho, double **s_dsdn_dsddn, double
         double DxDtau = alpha_dadn_daddn_dadtau[3][i]*DxDalpha;
         // printf("point %3d, DxDn %.7E, DxDDn %.7E, DxDtau %.7E\n", i, DxDn, DxDDn, DxDtau);
 
-        double DgxDn = -exp(-a1/sqrt_s)*(a1/2.0/sqrt_s/s)*s_dsdn_dsddn[1][i];
-        double DgxDDn = -exp(-a1/sqrt_s)*(a1/2.0/sqrt_s/s)*s_dsdn_dsddn[2][i];
+        double DgxDn = -exp_a1s*(a1/2.0/sqrt_s/s)*s_dsdn_dsddn[1][i];
+        double DgxDDn = -exp_a1s*(a1/2.0/sqrt_s/s)*s_dsdn_dsddn[2][i];
         double Dhx1Dx = 1.0 / (1.0 + (xFir + xSec)/k1) / (1.0 + (xFir + xSec)/k1);
         double Dhx1Dn = DxDn*Dhx1Dx;
         double Dhx1DDn = DxDDn*Dhx1Dx;
@@ -459,10 +554,10 @@ void Calculate_scanx_spin(int length, double *rho, double **s_dsdn_dsddn, double
         // printf("point %3d, Dhx1Dn %.7E, Dhx1DDn %.7E, Dhx1Dtau %.7E\n", i, Dhx1Dn, Dhx1DDn, Dhx1Dtau);
         double DfxDalpha;
         if (alpha > 1.0) {
-            DfxDalpha = -dx*exp(c2x/(1.0 - alpha)) * (c2x/(1.0 - alpha)/(1.0 - alpha));
+            DfxDalpha = fx * (c2x/oneMalpha/oneMalpha);
         }
         else {
-            DfxDalpha = exp(-c1x*alpha/(1.0 - alpha)) * (-c1x/(1.0 - alpha)/(1 - alpha));
+            DfxDalpha = fx * (-c1x/oneMalpha/oneMalpha);
         }
         double DfxDn = DfxDalpha*alpha_dadn_daddn_dadtau[1][i];
         double DfxDDn = DfxDalpha*alpha_dadn_daddn_dadtau[2][i];
@@ -472,7 +567,7 @@ void Calculate_scanx_spin(int length, double *rho, double **s_dsdn_dsddn, double
         double DFxDtau = gx*(1.0 - fx)*Dhx1Dtau + gx*(hx0 - hx1)*DfxDtau;
         // printf("point %3d, DFxDn %.7E, DFxDDn %.7E, DFxDtau %.7E\n", i, DFxDn, DFxDDn, DFxDtau);
         // solve variant of n*epsilon_x^{unif}*F_x
-        double Depsilon_xUnifDn = -pow(3.0*M_PI*M_PI, 1.0/3.0) / (4.0*M_PI) * pow(theRho, -2.0/3.0);
+        double Depsilon_xUnifDn = epsilon_xUnif / (3.0*theRho);
         vx1[i] = (epsilon_xUnif + theRho*Depsilon_xUnifDn)*Fx + theRho*epsilon_xUnif*DFxDn;
         vx2[i] = theRho*epsilon_xUnif*DFxDDn;
         vx3[i] = theRho*epsilon_xUnif*DFxDtau;
@@ -546,24 +641,26 @@ void basic_MGSGA_variables_correlation(int length, double *rho, double *normDrho
         theRho = rho[i];
         theNormDrho = normDrho[i];
         theTau = tau[i];
-        s_dsdn_dsddn[0][i] = theNormDrho / (2.0 * threeMPi2_1o3 * pow(theRho, 4.0/3.0));
+        double rho_1o3 = cbrt(theRho), rho_2o3 = rho_1o3*rho_1o3;
+        double rho_4o3 = theRho*rho_1o3, rho_5o3 = rho_4o3*rho_1o3, rho_7o3 = rho_4o3*theRho;
+        s_dsdn_dsddn[0][i] = theNormDrho / (2.0 * threeMPi2_1o3 * rho_4o3);
         zeta_dzetadnup_dzetadndn[0][i] = (rho[length+i] - rho[length*2+i]) / theRho;
         theZeta = zeta_dzetadnup_dzetadndn[0][i];
         tauw = theNormDrho*theNormDrho / (8.0*theRho);
         ds = (pow(1.0+theZeta, 5.0/3.0) + pow(1-theZeta, 5.0/3.0)) / 2.0;
-        tauUnif = 3.0/10.0 * threeMPi2_2o3 * pow(theRho, 5.0/3.0) * ds;
+        tauUnif = 3.0/10.0 * threeMPi2_2o3 * rho_5o3 * ds;
         alpha_dadnup_dadndn_daddn_dadtau[0][i] = (theTau - tauw) / tauUnif;
 
-        s_dsdn_dsddn[1][i] = -2.0*theNormDrho / (3.0 * threeMPi2_1o3 * pow(theRho, 7.0/3.0)); // ds/dn
-        s_dsdn_dsddn[2][i] = 1.0 / (2.0 * threeMPi2_1o3 * pow(theRho, 4.0/3.0)); // ds/d|\nabla n|
+        s_dsdn_dsddn[1][i] = -2.0*theNormDrho / (3.0 * threeMPi2_1o3 * rho_7o3); // ds/dn
+        s_dsdn_dsddn[2][i] = 1.0 / (2.0 * threeMPi2_1o3 * rho_4o3); // ds/d|\nabla n|
         zeta_dzetadnup_dzetadndn[1][i] = 2.0*rho[length*2+i] / (theRho*theRho);
         zeta_dzetadnup_dzetadndn[2][i] = -2.0*rho[length+i] / (theRho*theRho);
         DtauwDn = -theNormDrho*theNormDrho / (8*theRho*theRho);
         DtauwDDn = theNormDrho / (4*theRho);
         DdsDnup = 5.0/3.0 * (pow(1.0+theZeta, 2.0/3.0) - pow(1.0-theZeta, 2.0/3.0)) * zeta_dzetadnup_dzetadndn[1][i] / 2.0;
         DdsDndn = 5.0/3.0 * (pow(1.0+theZeta, 2.0/3.0) - pow(1.0-theZeta, 2.0/3.0)) * zeta_dzetadnup_dzetadndn[2][i] / 2.0;
-        DtauUnifDnup = threeMPi2_2o3 / 2.0 * pow(theRho, 2.0/3.0) * ds + 3.0/10.0 * threeMPi2_2o3 * pow(theRho, 5.0/3.0) * DdsDnup;
-        DtauUnifDndn = threeMPi2_2o3 / 2.0 * pow(theRho, 2.0/3.0) * ds + 3.0/10.0 * threeMPi2_2o3 * pow(theRho, 5.0/3.0) * DdsDndn;
+        DtauUnifDnup = threeMPi2_2o3 / 2.0 * rho_2o3 * ds + 3.0/10.0 * threeMPi2_2o3 * rho_5o3 * DdsDnup;
+        DtauUnifDndn = threeMPi2_2o3 / 2.0 * rho_2o3 * ds + 3.0/10.0 * threeMPi2_2o3 * rho_5o3 * DdsDndn;
         alpha_dadnup_dadndn_daddn_dadtau[1][i] = (-DtauwDn*tauUnif - (theTau - tauw)*DtauUnifDnup) / (tauUnif*tauUnif); // d\alpha/dn
         alpha_dadnup_dadndn_daddn_dadtau[2][i] = (-DtauwDn*tauUnif - (theTau - tauw)*DtauUnifDndn) / (tauUnif*tauUnif); // d\alpha/dn
         alpha_dadnup_dadndn_daddn_dadtau[3][i] = (-DtauwDDn) / tauUnif; // d\alpha/d|\nabla n|
@@ -621,6 +718,9 @@ void Calculate_scanc_spin(int length, double *rho, double **s_dsdn_dsddn, double
     double DgcrsDrs, Dec_lsda1_Drs, Dfzeta4_Dzeta, Dec_lsda1_Dzeta, Dec_lsda1Dnup, Dec_lsda1Dndn;
     double DbetaDn, DphiDnup, DphiDndn, DtDnup, DtDndn, DtDDn, Dw1Dnup, Dw1Dndn, DADnup, DADndn, DgDnup, DgDndn, DgDDn, DH1Dnup, DH1Dndn, DH1DDn, Dec1Dnup, Dec1Dndn, Dec1DDn;
     double DfcDnup, DfcDndn, DfcDDn, DfcDtau, DepsiloncDnup, DepsiloncDndn, DepsiloncDDn, DepsiloncDtau;
+    double tConst = pow(3.0*M_PI*M_PI/16.0, 1.0/3.0);
+    cx0 = -3.0/(4.0*M_PI) * pow(9.0*M_PI/4.0, 1.0/3.0);
+    xiInf0 = pow(3.0*M_PI*M_PI/16.0, 2.0/3.0) * (betaRsInf*1.0/(cx0 - f0)); // \xi_{r_s->\inf}(\zeta=0), 0.128026
     int i;
     for (i = 0; i < length; i++) {
         zeta = zeta_dzetadnup_dzetadndn[0][i];
@@ -628,14 +728,13 @@ void Calculate_scanc_spin(int length, double *rho, double **s_dsdn_dsddn, double
         dx = (pow(1.0 + zeta, 4.0/3.0) + pow(1.0 - zeta, 4.0/3.0)) / 2.0;
         s = s_dsdn_dsddn[0][i];
         alpha = alpha_dadnup_dadndn_daddn_dadtau[0][i];
-        rs = pow(0.75/(M_PI*rho[i]), 1.0/3.0);
+        rs = cbrt(0.75/(M_PI*rho[i]));
         // epsilon_c^0 (\alpha approach 0)
         ecLDA0 = -b1c / (1.0 + b2c*sqrt(rs) + b3c*rs);
-        cx0 = -3.0/(4.0*M_PI) * pow(9.0*M_PI/4.0, 1.0/3.0);
         Gc = (1.0 - 2.3631*(dx - 1.0)) * (1.0 - pow(zeta, 12.0));
         w0 = exp(-ecLDA0/b1c) - 1.0;
-        xiInf0 = pow(3.0*M_PI*M_PI/16.0, 2.0/3.0) * (betaRsInf*1.0/(cx0 - f0)); // \xi_{r_s->\inf}(\zeta=0), 0.128026
-        gInf0s = pow(1.0 + 4.0*xiInf0*s*s, -0.25);
+        double gInf0sBase = 1.0 + 4.0*xiInf0*s*s;
+        gInf0s = pow(gInf0sBase, -0.25);
         H0 = b1c*log(1.0 + w0*(1.0 - gInf0s));
         ec0 = (ecLDA0 + H0)*Gc;
         // epsilon_c^1 (\alpha approach 1)
@@ -676,8 +775,9 @@ void Calculate_scanc_spin(int length, double *rho, double **s_dsdn_dsddn, double
         rPhi3 = r*phi*phi*phi;
         w1 = exp(-ec_lsda1/rPhi3) - 1.0;
         A = beta / (r*w1);
-        t = pow(3.0*M_PI*M_PI/16.0, 1.0/3.0) * s/(phi*sqrRs);
-        g = pow(1.0 + 4.0*A*t*t, -0.25);
+        t = tConst * s/(phi*sqrRs);
+        double gBase = 1.0 + 4.0*A*t*t;
+        g = pow(gBase, -0.25);
         H1 = rPhi3 * log(1.0 + w1*(1.0 - g));
         ec1 = ec_lsda1 + H1;
         // printf("point %3d, ec0 %.7E, ec1 %.7E\n", i, ec0, ec1);
@@ -693,7 +793,7 @@ void Calculate_scanc_spin(int length, double *rho, double **s_dsdn_dsddn, double
         // compute variation of epsilon_c^0
         DzetaDnup = zeta_dzetadnup_dzetadndn[1][i];
         DzetaDndn = zeta_dzetadnup_dzetadndn[2][i];
-        DrsDn = -4.0*M_PI/9.0 * pow(4.0*M_PI/3.0*rho[i], -4.0/3.0);
+        DrsDn = -rs/(3.0*rho[i]);
         DdxDnup = (4.0/3.0*pow(1.0 + zeta, 1.0/3.0) - 4.0/3.0*pow(1.0 - zeta, 1.0/3.0))/2.0 * DzetaDnup;
         DdxDndn = (4.0/3.0*pow(1.0 + zeta, 1.0/3.0) - 4.0/3.0*pow(1.0 - zeta, 1.0/3.0))/2.0 * DzetaDndn;
         DGcDnup = -2.3631*DdxDnup*(1.0 - pow(zeta, 12.0)) + (1.0 - 2.3631*(dx - 1))*(-12.0*pow(zeta, 11.0)*DzetaDnup);
@@ -701,7 +801,7 @@ void Calculate_scanc_spin(int length, double *rho, double **s_dsdn_dsddn, double
         //     printf("point 4, DdxDnup %10.8f, DzetaDnup %10.8f\n", DdxDnup, DzetaDnup);
         // }
         DGcDndn = -2.3631*DdxDndn*(1.0 - pow(zeta, 12.0)) + (1.0 - 2.3631*(dx - 1))*(-12.0*pow(zeta, 11.0)*DzetaDndn);
-        DgInf0sDs = -0.25*pow(1.0 + 4.0*xiInf0*s*s, -1.25) * (4.0*xiInf0*2.0*s);
+        DgInf0sDs = -0.25*gInf0s/gInf0sBase * (4.0*xiInf0*2.0*s);
         DgInf0sDn = DgInf0sDs * s_dsdn_dsddn[1][i];
         DgInf0sDDn = DgInf0sDs * s_dsdn_dsddn[2][i];
         DecLDA0Dn = b1c*(0.5*b2c/sqrRs + b3c) / pow(1.0 + b2c*sqrRs + b3c*rs, 2.0) * DrsDn;
@@ -736,16 +836,16 @@ void Calculate_scanc_spin(int length, double *rho, double **s_dsdn_dsddn, double
         DbetaDn = 0.066725*(0.1*(1.0 + 0.1778*rs) - 0.1778*(1.0 + 0.1*rs)) / (1.0 + 0.1778*rs) / (1.0 + 0.1778*rs) * DrsDn;
         DphiDnup = 0.5*(2.0/3.0*pow(1.0 + zeta, -1.0/3.0) - 2.0/3.0*pow(1.0 - zeta, -1.0/3.0)) * DzetaDnup;
         DphiDndn = 0.5*(2.0/3.0*pow(1.0 + zeta, -1.0/3.0) - 2.0/3.0*pow(1.0 - zeta, -1.0/3.0)) * DzetaDndn;
-        DtDnup = pow(3.0*M_PI*M_PI/16.0, 1.0/3.0) * (phi*sqrRs*s_dsdn_dsddn[1][i] - s*(DphiDnup*sqrRs + phi*DrsDn/(2.0*sqrRs))) / (phi*phi*rs);
-        DtDndn = pow(3.0*M_PI*M_PI/16.0, 1.0/3.0) * (phi*sqrRs*s_dsdn_dsddn[1][i] - s*(DphiDndn*sqrRs + phi*DrsDn/(2.0*sqrRs))) / (phi*phi*rs);
+        DtDnup = tConst * (phi*sqrRs*s_dsdn_dsddn[1][i] - s*(DphiDnup*sqrRs + phi*DrsDn/(2.0*sqrRs))) / (phi*phi*rs);
+        DtDndn = tConst * (phi*sqrRs*s_dsdn_dsddn[1][i] - s*(DphiDndn*sqrRs + phi*DrsDn/(2.0*sqrRs))) / (phi*phi*rs);
         DtDDn = t*s_dsdn_dsddn[2][i]/s;
         Dw1Dnup = (w1 + 1.0) * (-(rPhi3*Dec_lsda1Dnup - r*ec_lsda1*(3.0*phi*phi*DphiDnup)) / rPhi3 / rPhi3);
         Dw1Dndn = (w1 + 1.0) * (-(rPhi3*Dec_lsda1Dndn - r*ec_lsda1*(3.0*phi*phi*DphiDndn)) / rPhi3 / rPhi3);
         DADnup = (w1*DbetaDn - beta*Dw1Dnup) / (r*w1*w1);
         DADndn = (w1*DbetaDn - beta*Dw1Dndn) / (r*w1*w1);
-        DgDnup = -0.25*pow(1.0 + 4.0*A*t*t, -1.25) * (4.0*(DADnup*t*t + 2.0*A*t*DtDnup));
-        DgDndn = -0.25*pow(1.0 + 4.0*A*t*t, -1.25) * (4.0*(DADndn*t*t + 2.0*A*t*DtDndn));
-        DgDDn = -0.25*pow(1.0 + 4.0*A*t*t, -1.25) * (4.0*2.0*A*t*DtDDn);
+        DgDnup = -0.25*g/gBase * (4.0*(DADnup*t*t + 2.0*A*t*DtDnup));
+        DgDndn = -0.25*g/gBase * (4.0*(DADndn*t*t + 2.0*A*t*DtDndn));
+        DgDDn = -0.25*g/gBase * (4.0*2.0*A*t*DtDDn);
         DH1Dnup = 3*r*phi*phi*DphiDnup*log(1.0 + w1*(1.0 - g)) + rPhi3*(Dw1Dnup*(1.0 - g) - w1*DgDnup) / (1.0 + w1*(1.0 - g));
         DH1Dndn = 3*r*phi*phi*DphiDndn*log(1.0 + w1*(1.0 - g)) + rPhi3*(Dw1Dndn*(1.0 - g) - w1*DgDndn) / (1.0 + w1*(1.0 - g));
         DH1DDn = rPhi3*(-w1*DgDDn) / (1.0 + w1*(1.0 - g));
@@ -53,43 +53,203 @@ double solve_cos(double latF1, double latF2, double latF3, double latS1, double
     return cos;
 }
 
-void d3_CN(SPARC_OBJ *pSPARC, double K1) {
-    int i, j, x, y, z;
-    int imageNumber = (pSPARC->nImageCN[0]*2 + 1) * (pSPARC->nImageCN[1]*2 + 1) * (pSPARC->nImageCN[2]*2 + 1);
-    int imageIndex = 0;
-    double *imageVec = (double*)malloc(sizeof(double) * imageNumber * 3);
-    for (x = -(pSPARC->nImageCN[0]); x < pSPARC->nImageCN[0] + 1; x++) {
-        for (y = -(pSPARC->nImageCN[1]); y < pSPARC->nImageCN[1] + 1; y++) {
-            for (z = -(pSPARC->nImageCN[2]); z < pSPARC->nImageCN[2] + 1; z++) {
-                imageVec[imageIndex*3 + 0] = x*(pSPARC->lattice[0]) + y*(pSPARC->lattice[3]) + z*(pSPARC->lattice[6]);
-                imageVec[imageIndex*3 + 1] = x*(pSPARC->lattice[1]) + y*(pSPARC->lattice[4]) + z*(pSPARC->lattice[7]);
-                imageVec[imageIndex*3 + 2] = x*(pSPARC->lattice[2]) + y*(pSPARC->lattice[5]) + z*(pSPARC->lattice[8]);
-                imageIndex++;
+/**
+ * @brief build the cell list of all atoms. The atoms are binned in fractional coordinates, the bins are no smaller than rCut
+ */
+void d3_build_cell_list(D3_CELL_LIST *cellList, double *atomPosition, int natom, double *Lattice, int *periodicType, double rCut) {
+    int i, d;
+    // reciprocal vectors (without 2*pi), the fractional coordinate d of a point r is recipVec[d] . r
+    double volume = Lattice[0]*(Lattice[4]*Lattice[8] - Lattice[5]*Lattice[7])
+                  - Lattice[1]*(Lattice[3]*Lattice[8] - Lattice[5]*Lattice[6])
+                  + Lattice[2]*(Lattice[3]*Lattice[7] - Lattice[4]*Lattice[6]);
+    for (d = 0; d < 3; d++) {
+        double *b = Lattice + ((d+1)%3)*3, *c = Lattice + ((d+2)%3)*3;
+        cellList->recipVec[d*3 + 0] = (b[1]*c[2] - b[2]*c[1]) / volume;
+        cellList->recipVec[d*3 + 1] = (b[2]*c[0] - b[0]*c[2]) / volume;
+        cellList->recipVec[d*3 + 2] = (b[0]*c[1] - b[1]*c[0]) / volume;
+    }
+    cellList->natom = natom;
+    cellList->frac = (double*)malloc(sizeof(double) * natom * 3);
+    for (i = 0; i < natom; i++) {
+        for (d = 0; d < 3; d++) {
+            cellList->frac[i*3 + d] = cellList->recipVec[d*3 + 0]*atomPosition[i*3 + 0] 
+                                    + cellList->recipVec[d*3 + 1]*atomPosition[i*3 + 1] 
+                                    + cellList->recipVec[d*3 + 2]*atomPosition[i*3 + 2];
+        }
+    }
+    for (d = 0; d < 3; d++) {
+        // a sphere of radius rCut spans rCut*|recipVec[d]| in the fractional coordinate d
+        double span = rCut * sqrt(pow(cellList->recipVec[d*3], 2.0) + pow(cellList->recipVec[d*3 + 1], 2.0) + pow(cellList->recipVec[d*3 + 2], 2.0));
+        cellList->periodic[d] = periodicType[d];
+        if (periodicType[d] == 1) {
+            cellList->origin[d] = 0.0;
+            cellList->nBin[d] = max(1, min(128, (int)floor(1.0 / span)));
+            cellList->width[d] = 1.0 / cellList->nBin[d];
+        } else {
+            double fmin = cellList->frac[d], fmax = cellList->frac[d];
+            for (i = 1; i < natom; i++) {
+                fmin = min(fmin, cellList->frac[i*3 + d]);
+                fmax = max(fmax, cellList->frac[i*3 + d]);
             }
+            cellList->origin[d] = fmin;
+            cellList->nBin[d] = max(1, min(128, (int)floor((fmax - fmin) / span)));
+            cellList->width[d] = max((fmax - fmin) / cellList->nBin[d], 1e-12);
         }
     }
-    double iCoord[3]; double jCoord[3]; double relativeVec[3];
-    double dist, rr;
+    // linked list of atoms in every bin; shift records the cell holding the atom in periodic directions
+    int nBinTotal = cellList->nBin[0] * cellList->nBin[1] * cellList->nBin[2];
+    cellList->head = (int*)malloc(sizeof(int) * nBinTotal);
+    cellList->next = (int*)malloc(sizeof(int) * natom);
+    cellList->shift = (int*)malloc(sizeof(int) * natom * 3);
+    for (i = 0; i < nBinTotal; i++) cellList->head[i] = -1;
+    for (i = natom - 1; i >= 0; i--) {
+        int bin[3];
+        for (d = 0; d < 3; d++) {
+            int b = (int)floor((cellList->frac[i*3 + d] - cellList->origin[d]) / cellList->width[d]);
+            if (cellList->periodic[d] == 1) {
+                cellList->shift[i*3 + d] = d3_floor_div(b, cellList->nBin[d]);
+                bin[d] = b - cellList->shift[i*3 + d] * cellList->nBin[d];
+            } else {
+                cellList->shift[i*3 + d] = 0;
+                bin[d] = max(0, min(cellList->nBin[d] - 1, b));
+            }
+        }
+        int binIndex = bin[0] + cellList->nBin[0] * (bin[1] + cellList->nBin[1] * bin[2]);
+        cellList->next[i] = cellList->head[binIndex];
+        cellList->head[binIndex] = i;
+    }
+}
+
+void d3_free_cell_list(D3_CELL_LIST *cellList) {
+    free(cellList->frac);
+    free(cellList->head);
+    free(cellList->next);
+    free(cellList->shift);
+}
+
+int d3_floor_div(int a, int b) {
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+/**
+ * @brief append all images of atoms within rCut of atom atomI to the neighbor list.
+ *        If halfList == 1, only atoms with index no larger than atomI are included.
+ */
+void d3_find_neighbors(D3_CELL_LIST *cellList, double *atomPosition, double *Lattice, int atomI, double rCut, int halfList, D3_NEIGHBOR_LIST *neighborList) {
+    int d, bin[3], binLow[3], binHigh[3], m[3], image[3];
+    double rCut2 = rCut * rCut;
+    for (d = 0; d < 3; d++) {
+        double span = rCut * sqrt(pow(cellList->recipVec[d*3], 2.0) + pow(cellList->recipVec[d*3 + 1], 2.0) + pow(cellList->recipVec[d*3 + 2], 2.0));
+        span = span * (1.0 + 1e-10) + 1e-12;
+        double fi = cellList->frac[atomI*3 + d] - cellList->origin[d];
+        binLow[d] = (int)floor((fi - span) / cellList->width[d]);
+        binHigh[d] = (int)floor((fi + span) / cellList->width[d]);
+        if (cellList->periodic[d] == 0) {
+            binLow[d] = max(0, binLow[d]);
+            binHigh[d] = min(cellList->nBin[d] - 1, binHigh[d]);
+        }
+    }
+    for (bin[2] = binLow[2]; bin[2] <= binHigh[2]; bin[2]++) {
+        for (bin[1] = binLow[1]; bin[1] <= binHigh[1]; bin[1]++) {
+            for (bin[0] = binLow[0]; bin[0] <= binHigh[0]; bin[0]++) {
+                int baseBin[3];
+                for (d = 0; d < 3; d++) {
+                    m[d] = cellList->periodic[d] ? d3_floor_div(bin[d], cellList->nBin[d]) : 0;
+                    baseBin[d] = bin[d] - m[d] * cellList->nBin[d];
+                }
+                int j = cellList->head[baseBin[0] + cellList->nBin[0] * (baseBin[1] + cellList->nBin[1] * baseBin[2])];
+                for (; j >= 0; j = cellList->next[j]) {
+                    if (halfList && j > atomI) continue;
+                    image[0] = m[0] - cellList->shift[j*3 + 0];
+                    image[1] = m[1] - cellList->shift[j*3 + 1];
+                    image[2] = m[2] - cellList->shift[j*3 + 2];
+                    if (j == atomI && image[0] == 0 && image[1] == 0 && image[2] == 0) continue;
+                    double vec[3];
+                    for (d = 0; d < 3; d++) {
+                        vec[d] = atomPosition[j*3 + d] - atomPosition[atomI*3 + d]
+                               + image[0]*Lattice[d] + image[1]*Lattice[3 + d] + image[2]*Lattice[6 + d];
+                    }
+                    double dist2 = vec[0]*vec[0] + vec[1]*vec[1] + vec[2]*vec[2];
+                    if (dist2 > rCut2) continue;
+                    if (neighborList->n == neighborList->capacity) {
+                        neighborList->capacity = max(64, 2 * neighborList->capacity);
+                        neighborList->list = (D3_NEIGHBOR*)realloc(neighborList->list, sizeof(D3_NEIGHBOR) * neighborList->capacity);
+                    }
+                    D3_NEIGHBOR *nb = neighborList->list + neighborList->n;
+                    nb->atom = j;
+                    nb->vec[0] = vec[0]; nb->vec[1] = vec[1]; nb->vec[2] = vec[2];
+                    nb->dist2 = dist2;
+                    neighborList->n++;
+                }
+            }
+        }
+    }
+}
+
+static int d3_compare_neighbor(const void *a, const void *b) {
+    const D3_NEIGHBOR *na = (const D3_NEIGHBOR *)a, *nb = (const D3_NEIGHBOR *)b;
+    if (na->atom != nb->atom) return (na->atom < nb->atom) ? -1 : 1;
+    if (na->dist2 != nb->dist2) return (na->dist2 < nb->dist2) ? -1 : 1;
+    return 0;
+}
+
+/**
+ * @brief calculate CNs of the atoms atomStart, ..., atomEnd-1 and gather CNs of all atoms.
+ *        The neighbors (index no larger than the center atom) within the CN cutoff are saved into cnList, sorted by atom index, 
+ *        cnListOffset[i-atomStart] is the first neighbor of atom i.
+ */
+void d3_CN(SPARC_OBJ *pSPARC, D3_CELL_LIST *cellList, int atomStart, int atomEnd, D3_NEIGHBOR_LIST *cnList, int *cnListOffset, double K1) {
+    int i, j, n, nproc;
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
     double CNrCutoff = sqrt(pSPARC->d3Cn_thr);
-    double *atomPosition = pSPARC->atom_pos;
-    for (i = 0; i < pSPARC->n_atom; i++) {
+    double dist, rr;
+    D3_NEIGHBOR_LIST fullList = {0, 0, NULL};
+    cnList->n = 0;
+    for (i = atomStart; i < atomEnd; i++) {
         pSPARC->atomCN[i] = 0.0;
-        iCoord[0] = *(atomPosition + i*3 + 0); iCoord[1] = *(atomPosition + i*3 + 1); iCoord[2] = *(atomPosition + i*3 + 2);
-        for (j = 0; j < pSPARC->n_atom; j++) {
-            jCoord[0] = *(atomPosition + j*3 + 0); jCoord[1] = *(atomPosition + j*3 + 1); jCoord[2] = *(atomPosition + j*3 + 2);
-            for (imageIndex = 0; imageIndex < imageNumber; imageIndex++) {
-                relativeVec[0] = iCoord[0] - jCoord[0] - imageVec[imageIndex*3 + 0];
-                relativeVec[1] = iCoord[1] - jCoord[1] - imageVec[imageIndex*3 + 1];
-                relativeVec[2] = iCoord[2] - jCoord[2] - imageVec[imageIndex*3 + 2];
-                dist = sqrt(pow(relativeVec[0], 2) + pow(relativeVec[1], 2) + pow(relativeVec[2], 2));
-                if ((dist < CNrCutoff) && (dist > 1e-10)) {
-                    rr = (pSPARC->atomScaledRcov[i] + pSPARC->atomScaledRcov[j]) / dist;
-                    pSPARC->atomCN[i] += 1.0 / (1.0 + exp(-K1 * (rr - 1.0)));
+        fullList.n = 0;
+        d3_find_neighbors(cellList, pSPARC->atom_pos, pSPARC->lattice, i, CNrCutoff, 0, &fullList);
+        cnListOffset[i - atomStart] = cnList->n;
+        for (n = 0; n < fullList.n; n++) {
+            D3_NEIGHBOR *nb = fullList.list + n;
+            j = nb->atom;
+            dist = sqrt(nb->dist2);
+            if ((dist < CNrCutoff) && (dist > 1e-10)) {
+                rr = (pSPARC->atomScaledRcov[i] + pSPARC->atomScaledRcov[j]) / dist;
+                pSPARC->atomCN[i] += 1.0 / (1.0 + exp(-K1 * (rr - 1.0)));
+            }
+            if ((j <= i) && (nb->dist2 <= pSPARC->d3Cn_thr) && (nb->dist2 >= 1e-15)) {
+                if (cnList->n == cnList->capacity) {
+                    cnList->capacity = max(64, 2 * cnList->capacity);
+                    cnList->list = (D3_NEIGHBOR*)realloc(cnList->list, sizeof(D3_NEIGHBOR) * cnList->capacity);
                 }
+                cnList->list[cnList->n++] = *nb;
             }
         }
+        qsort(cnList->list + cnListOffset[i - atomStart], cnList->n - cnListOffset[i - atomStart], sizeof(D3_NEIGHBOR), d3_compare_neighbor);
     }
-    free(imageVec);
+    cnListOffset[atomEnd - atomStart] = cnList->n;
+    free(fullList.list);
+
+    // gather CNs of all atoms
+    int *recvcounts = (int*)malloc(sizeof(int) * nproc);
+    int *displs = (int*)malloc(sizeof(int) * nproc);
+    for (n = 0; n < nproc; n++) {
+        d3_atom_range(pSPARC->n_atom, nproc, n, &displs[n], &recvcounts[n]);
+        recvcounts[n] -= displs[n];
+    }
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, pSPARC->atomCN, recvcounts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
+    free(recvcounts);
+    free(displs);
+}
+
+/**
+ * @brief atoms atomStart, ..., atomEnd-1 are assigned to process rank
+ */
+void d3_atom_range(int natom, int nproc, int rank, int *atomStart, int *atomEnd) {
+    int nLocal = natom / nproc, rem = natom % nproc;
+    *atomStart = rank * nLocal + min(rank, rem);
+    *atomEnd = *atomStart + nLocal + (rank < rem ? 1 : 0);
 }
 
 double d3_getC6(int *atomMaxci, int *atomicNumbers, double *CN, int atomI, int atomJ, double *****c6ab, double k3) {
@@ -186,10 +346,12 @@ void d3_comp_dC6_dCNij(double *C6dC6pairIJ, int *atomMaxci, int *atomicNumbers,
 
 /**
  * @brief The main function of DFT-D3. D3 energy, force are computed here. Called by Calculate_electronicGroundState in electronicGroundState.c
+ *        Atoms are distributed over all processes, the neighbors of every atom are found with a cell list.
  */
 void d3_energy_gradient(SPARC_OBJ *pSPARC) {
-    int rank;
+    int rank, nproc;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nproc);
 
     int inputMaxci[95] = {0,
         2,1,2,3,5,5,4,3,2,1,
@@ -217,12 +379,12 @@ void d3_energy_gradient(SPARC_OBJ *pSPARC) {
     double K1 = 16.0;
     double K3 = -4.0;
     double cn_thr = pSPARC->d3Cn_thr;
-    double *sqrtC6matrix = (double*)malloc(sizeof(double) * natom * natom);
+    double rthr = pSPARC->d3Rthr;
 
     
     // find the number of cells to be checked in periodic directions
     double cell[3] = {pSPARC->range_x, pSPARC->range_y, pSPARC->range_z};
-    int row, col;
+    int row;
     for (row = 0; row < 3; row++) {
         pSPARC->lattice[row*3] = pSPARC->LatUVec[row*3] * cell[row];
         pSPARC->lattice[row*3 + 1] = pSPARC->LatUVec[row*3 + 1] * cell[row];
@@ -246,289 +408,293 @@ void d3_energy_gradient(SPARC_OBJ *pSPARC) {
     } 
     #endif
 
-    int atm;
+    int atm, i, j, k, n, n1, n2, thisAtomNumber;
     // at first, transfer non-cartesian coordinates to cartesian coordinates
     for (atm = 0; atm < pSPARC->n_atom; atm++) {
         nonCart2Cart_coord(pSPARC, &pSPARC->atom_pos[atm*3], &pSPARC->atom_pos[atm*3 + 1], &pSPARC->atom_pos[atm*3 + 2]);
     }
-    
-    d3_CN(pSPARC, K1);
+    double *Lattice = pSPARC->lattice;
+    double *atomPosition = pSPARC->atom_pos;
+    int periodicType[3];
+    for (row = 0; row < 3; row++) 
+        periodicType[row] = (pSPARC->periodicBCFlag == 0) ? 0 : pSPARC->BCtype[row];
+
+    // atoms atomStart, ..., atomEnd-1 are the center atoms of pairs and triplets computed by this process
+    int atomStart, atomEnd;
+    d3_atom_range(natom, nproc, rank, &atomStart, &atomEnd);
+    int natomLocal = atomEnd - atomStart;
+
+    // R0 of all pairs of elements in the system
+    double *r0abTable = (double*)calloc(95 * 95, sizeof(double));
+    int atomI = 0, atomJ, Zi, Zj;
+    for (n1 = 0; n1 < pSPARC->Ntypes; atomI += pSPARC->nAtomv[n1], n1++) {
+        atomJ = 0;
+        for (n2 = 0; n2 < pSPARC->Ntypes; atomJ += pSPARC->nAtomv[n2], n2++) {
+            if (atomI >= natom || atomJ >= natom) continue;
+            Zi = pSPARC->atomicNumbers[atomI]; Zj = pSPARC->atomicNumbers[atomJ];
+            r0abTable[Zi*95 + Zj] = find_r0ab(Zi, Zj);
+        }
+    }
+
+    D3_CELL_LIST cellList;
+    d3_build_cell_list(&cellList, atomPosition, natom, Lattice, periodicType, sqrt(cn_thr));
+    D3_NEIGHBOR_LIST cnList = {0, 0, NULL};
+    int *cnListOffset = (int*)malloc(sizeof(int) * (natomLocal + 1));
+    d3_CN(pSPARC, &cellList, atomStart, atomEnd, &cnList, cnListOffset, K1);
 
-    // self C6 test
-    double *selfAtomC6 = (double*)malloc(sizeof(double) * pSPARC->n_atom);
-    int thisAtomNumber;
     for (atm = 0; atm < pSPARC->n_atom; atm++) {
-     thisAtomNumber = pSPARC->atomicNumbers[atm];
+        thisAtomNumber = pSPARC->atomicNumbers[atm];
         pSPARC->atomMaxci[atm] = inputMaxci[thisAtomNumber]; // maybe there is mistake
         pSPARC->d3Grads[atm*3 + 0] = 0.0; pSPARC->d3Grads[atm*3 + 1] = 0.0; pSPARC->d3Grads[atm*3 + 2] = 0.0;
-        selfAtomC6[atm] = d3_getC6(pSPARC->atomMaxci, pSPARC->atomicNumbers, pSPARC->atomCN, atm, atm, pSPARC->c6ab, K3);
-    }
-
-    int *numImageEG = pSPARC->nImageEG;
-    int imageNumberEG = (numImageEG[0]*2 + 1) * (numImageEG[1]*2 + 1) * (numImageEG[2]*2 + 1);
-    double *imageVecEG = (double*)malloc(sizeof(double) * imageNumberEG * 3);
-    double ***drij = (double***)malloc(sizeof(double**) * imageNumberEG);
-    int imageIndex, i, j;
-    for (imageIndex = 0; imageIndex < imageNumberEG; imageIndex++) {
-        *(drij + imageIndex) = (double**)malloc(sizeof(double*) * natom);
-        for (i = 0; i < natom; i++) {
-            *(*(drij + imageIndex) + i) = (double*)calloc(natom, sizeof(double));
+    }
+
+    // C6 and dC6/dCN of atom pairs within the CN cutoff, which are needed by the 3-atom terms of all processes
+    // row i saves atoms j <= i in ascending order; every process computes its own rows, then all rows are gathered
+    int *c6RowOffset = (int*)calloc(natom + 1, sizeof(int));
+    for (i = atomStart; i < atomEnd; i++) {
+        for (n = cnListOffset[i - atomStart]; n < cnListOffset[i - atomStart + 1]; n++) {
+            if (n == cnListOffset[i - atomStart] || cnList.list[n].atom != cnList.list[n-1].atom) c6RowOffset[i+1]++;
         }
     }
-    double *dC6ij = (double*)malloc(sizeof(double*) * natom * natom);
-    double *FdivR6mulDC6 = (double*)calloc(natom, sizeof(double));
-    
-    // below is the code computing D3 energy and its analytical gradient in 2-atom pairs
-    int imageX, imageY, imageZ;
-    double *Lattice = pSPARC->lattice;
-    double *atomPosition = pSPARC->atom_pos;
-    imageIndex = 0;
-    for (imageX = -numImageEG[0]; imageX < numImageEG[0] + 1; imageX++) {
-        for (imageY = -numImageEG[1]; imageY < numImageEG[1] + 1; imageY++) {
-            for (imageZ = -numImageEG[2]; imageZ < numImageEG[2] + 1; imageZ++) {
-                imageVecEG[imageIndex*3 + 0] = imageX*Lattice[0] + imageY*Lattice[3] + imageZ*Lattice[6];
-                imageVecEG[imageIndex*3 + 1] = imageX*Lattice[1] + imageY*Lattice[4] + imageZ*Lattice[7];
-                imageVecEG[imageIndex*3 + 2] = imageX*Lattice[2] + imageY*Lattice[5] + imageZ*Lattice[8];
-                imageIndex++;
-            }
+    int *recvcounts = (int*)malloc(sizeof(int) * nproc);
+    int *displs = (int*)malloc(sizeof(int) * nproc);
+    for (n = 0; n < nproc; n++) {
+        d3_atom_range(natom, nproc, n, &displs[n], &recvcounts[n]);
+        recvcounts[n] -= displs[n];
+    }
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, c6RowOffset + 1, recvcounts, displs, MPI_INT, MPI_COMM_WORLD);
+    for (i = 0; i < natom; i++) c6RowOffset[i+1] += c6RowOffset[i];
+    int nc6Pair = c6RowOffset[natom];
+    int *c6Col = (int*)malloc(sizeof(int) * max(nc6Pair, 1));
+    double *c6Val = (double*)malloc(sizeof(double) * 3 * max(nc6Pair, 1));
+    int count = c6RowOffset[atomStart];
+    for (i = atomStart; i < atomEnd; i++) {
+        for (n = cnListOffset[i - atomStart]; n < cnListOffset[i - atomStart + 1]; n++) {
+            if (n != cnListOffset[i - atomStart] && cnList.list[n].atom == cnList.list[n-1].atom) continue;
+            c6Col[count] = cnList.list[n].atom;
+            d3_comp_dC6_dCNij(c6Val + count*3, pSPARC->atomMaxci, pSPARC->atomicNumbers, pSPARC->atomCN, i, c6Col[count], pSPARC->c6ab, K3);
+            count++;
         }
     }
+    for (n = 0; n < nproc; n++) {
+        int rowStart = displs[n], rowEnd = displs[n] + recvcounts[n];
+        displs[n] = c6RowOffset[rowStart];
+        recvcounts[n] = c6RowOffset[rowEnd] - c6RowOffset[rowStart];
+    }
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, c6Col, recvcounts, displs, MPI_INT, MPI_COMM_WORLD);
+    for (n = 0; n < nproc; n++) {
+        displs[n] *= 3; recvcounts[n] *= 3;
+    }
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, c6Val, recvcounts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
+    free(recvcounts);
+    free(displs);
+
+    // gradients and stress are accumulated locally and summed over processes at the end
+    double *FdivR6mulDC6 = (double*)calloc(natom, sizeof(double));
+    double *d3Sigma = pSPARC->d3Sigma;
+    for (row = 0; row < 9; row++) d3Sigma[row] = 0.0;
     
-    double setC6dC6pairIJ[3]; double *C6dC6pairIJ = setC6dC6pairIJ;
-    double c6, r0abNow, mulR2R4, rr, t6, t8, damp6, damp8, de6dr, de8dr, FdivR6;
+    // below is the code computing D3 energy and its analytical gradient in 2-atom pairs
+    D3_NEIGHBOR_LIST egList = {0, 0, NULL};
+    int *c6Stamp = (int*)malloc(sizeof(int) * natom);
+    double *c6Cache = (double*)malloc(sizeof(double) * 3 * natom);
+    for (j = 0; j < natom; j++) c6Stamp[j] = -1;
+    double *C6dC6pairIJ;
+    double c6, r0abNow, mulR2R4, rr, t6, t8, damp6, damp8, de6dr, de8dr, FdivR6, drij;
     double iDist2, iDist, iDist6, iDist7, iDist8, iDist9; 
-    for (i = 0; i < natom; i++) {
-        for (j = 0; j < i + 1; j++) {
-            d3_comp_dC6_dCNij(C6dC6pairIJ, pSPARC->atomMaxci, pSPARC->atomicNumbers, pSPARC->atomCN, i, j, pSPARC->c6ab, K3);
+    for (i = atomStart; i < atomEnd; i++) {
+        egList.n = 0;
+        d3_find_neighbors(&cellList, atomPosition, Lattice, i, sqrt(rthr), 1, &egList);
+        for (n = 0; n < egList.n; n++) {
+            j = egList.list[n].atom;
+            iDist2 = egList.list[n].dist2;
+            if ((iDist2 > rthr) || (iDist2 < 1e-15)) continue;
+            if (c6Stamp[j] != i) { // C6 of the atom pair, from the table if it is within the CN cutoff
+                double *c6Saved = d3_find_pair_C6(c6RowOffset, c6Col, c6Val, i, j);
+                if (c6Saved != NULL) 
+                    memcpy(c6Cache + j*3, c6Saved, sizeof(double) * 3);
+                else
+                    d3_comp_dC6_dCNij(c6Cache + j*3, pSPARC->atomMaxci, pSPARC->atomicNumbers, pSPARC->atomCN, i, j, pSPARC->c6ab, K3);
+                c6Stamp[j] = i;
+            }
+            C6dC6pairIJ = c6Cache + j*3;
             c6 = C6dC6pairIJ[0];
-
+            r0abNow = r0abTable[pSPARC->atomicNumbers[i]*95 + pSPARC->atomicNumbers[j]];
+            mulR2R4 = pSPARC->atomScaledR2R4[i] * pSPARC->atomScaledR2R4[j];
+            iDist = sqrt(iDist2);
+            iDist6 = pow(iDist2, 3.0);
+            iDist7 = iDist6 * iDist;
+            iDist8 = iDist6 * iDist2;
+            iDist9 = iDist8 * iDist;
+            rr = r0abNow / iDist;
+            t6 = pow((rs6*rr), alp6);
+            t8 = pow((rs8*rr), alp8);
+            damp6 = 1.0 / (1.0 + 6 * t6);
+            damp8 = 1.0 / (1.0 + 6 * t8);
+            de6dr = s6 * 6 * damp6 * c6 / iDist7;
+            de8dr = s8 * 6 * c6 * mulR2R4 * damp8 / iDist9;
+            
             if (i == j) {
-                dC6ij[i*natom + i] = C6dC6pairIJ[1];
-                sqrtC6matrix[i*natom + i] = sqrt(C6dC6pairIJ[0]);
+                drij = -(de6dr + 4 * de8dr) / 2.0;
+                drij += (de6dr*alp6*t6*damp6 + 3*de8dr*alp8*t8*damp8) / 2.0;
+                FdivR6 = (s6 / iDist6 * damp6 + 3 * s8 * mulR2R4 / iDist8 * damp8) / 2.0;
+                e6 -= s6 / iDist6 * damp6 * c6 / 2.0;
+                e8 -= 3 * s8 * mulR2R4 / iDist8 * damp8 * c6 / 2.0;
+                FdivR6mulDC6[i] += FdivR6 * (C6dC6pairIJ[1] + C6dC6pairIJ[2]);
             }
             else {
-                dC6ij[i*natom + j] = C6dC6pairIJ[1];
-                dC6ij[j*natom + i] = C6dC6pairIJ[2];
-                sqrtC6matrix[i*natom + j] = sqrt(C6dC6pairIJ[0]);
-                sqrtC6matrix[j*natom + i] = sqrtC6matrix[i*natom + j];
-            }
-            r0abNow = find_r0ab(pSPARC->atomicNumbers[i], pSPARC->atomicNumbers[j]);
-            mulR2R4 = pSPARC->atomScaledR2R4[i] * pSPARC->atomScaledR2R4[j];
-            for (imageIndex = 0; imageIndex < imageNumberEG; imageIndex++) {
-                iDist2 = pow(atomPosition[i*3 + 0] - atomPosition[j*3 + 0] - imageVecEG[imageIndex*3 + 0], 2.0)
-                        +pow(atomPosition[i*3 + 1] - atomPosition[j*3 + 1] - imageVecEG[imageIndex*3 + 1], 2.0)
-                        +pow(atomPosition[i*3 + 2] - atomPosition[j*3 + 2] - imageVecEG[imageIndex*3 + 2], 2.0);
-                if ((iDist2 > pSPARC->d3Rthr) || (iDist2 < 1e-15)) continue;
-                iDist = sqrt(iDist2);
-                iDist6 = pow(iDist2, 3.0);
-                iDist7 = iDist6 * iDist;
-                iDist8 = iDist6 * iDist2;
-                iDist9 = iDist8 * iDist;
-                rr = r0abNow / iDist;
-                t6 = pow((rs6*rr), alp6);
-                t8 = pow((rs8*rr), alp8);
-                damp6 = 1.0 / (1.0 + 6 * t6);
-                damp8 = 1.0 / (1.0 + 6 * t8);
-                de6dr = s6 * 6 * damp6 * c6 / iDist7;
-                de8dr = s8 * 6 * c6 * mulR2R4 * damp8 / iDist9;
-                
-                if (i == j) {
-                    drij[imageIndex][i][j] -= (de6dr + 4 * de8dr) / 2.0;
-                    drij[imageIndex][i][j] += (de6dr*alp6*t6*damp6 + 3*de8dr*alp8*t8*damp8) / 2.0;
-                    FdivR6 = (s6 / iDist6 * damp6 + 3 * s8 * mulR2R4 / iDist8 * damp8) / 2.0;
-                    e6 -= s6 / iDist6 * damp6 * c6 / 2.0;
-                    e8 -= 3 * s8 * mulR2R4 / iDist8 * damp8 * c6 / 2.0;
-                    FdivR6mulDC6[i] += FdivR6 * (C6dC6pairIJ[1] + C6dC6pairIJ[2]);
-                }
-                else {
-                    drij[imageIndex][i][j] -= de6dr + 4 * de8dr;
-                    drij[imageIndex][i][j] += de6dr*alp6*t6*damp6 + 3*de8dr*alp8*t8*damp8;
-                    drij[imageIndex][j][i] = drij[imageIndex][i][j];
-                    FdivR6 = (s6 / iDist6 * damp6 + 3 * s8 * mulR2R4 / iDist8 * damp8);
-                    e6 -= s6 / iDist6 * damp6 * c6;
-                    e8 -= 3 * s8 * mulR2R4 / iDist8 * damp8 * c6;
-                    FdivR6mulDC6[i] += FdivR6 * C6dC6pairIJ[1];
-                    FdivR6mulDC6[j] += FdivR6 * C6dC6pairIJ[2];
-                }
+                drij = -(de6dr + 4 * de8dr);
+                drij += de6dr*alp6*t6*damp6 + 3*de8dr*alp8*t8*damp8;
+                FdivR6 = (s6 / iDist6 * damp6 + 3 * s8 * mulR2R4 / iDist8 * damp8);
+                e6 -= s6 / iDist6 * damp6 * c6;
+                e8 -= 3 * s8 * mulR2R4 / iDist8 * damp8 * c6;
+                FdivR6mulDC6[i] += FdivR6 * C6dC6pairIJ[1];
+                FdivR6mulDC6[j] += FdivR6 * C6dC6pairIJ[2];
             }
+            d3_pair_gradient(i, j, egList.list[n].vec, iDist2, drij, rthr, pSPARC->d3Grads, d3Sigma);
         }
     }
+    free(egList.list);
+    free(c6Stamp);
+    free(c6Cache);
     
     // below is the code computing D3 energy and its analytical gradient in 3-atom pairs
-    int *numImageCN = pSPARC->nImageCN;
-    int imageNumberCN = (numImageCN[0]*2 + 1) * (numImageCN[1]*2 + 1) * (numImageCN[2]*2 + 1);
-    double *imageVecCN = (double*)malloc(sizeof(double) * imageNumberCN * 3); // the array saves the vector from center cell to the (imageX, imageY, imageZ) image cell
-    int *imageIndexCN = (int*)malloc(sizeof(int) * imageNumberCN * 3); // the array saves the indexes of the (imageX, imageY, imageZ) image cell
-    imageIndex = 0;
-    for (imageX = -numImageCN[0]; imageX < numImageCN[0] + 1; imageX++) {
-        for (imageY = -numImageCN[1]; imageY < numImageCN[1] + 1; imageY++) {
-            for (imageZ = -numImageCN[2]; imageZ < numImageCN[2] + 1; imageZ++) {
-                imageVecCN[imageIndex*3 + 0] = imageX*Lattice[0] + imageY*Lattice[3] + imageZ*Lattice[6];
-                imageVecCN[imageIndex*3 + 1] = imageX*Lattice[1] + imageY*Lattice[4] + imageZ*Lattice[7];
-                imageVecCN[imageIndex*3 + 2] = imageX*Lattice[2] + imageY*Lattice[5] + imageZ*Lattice[8];
-                imageIndexCN[imageIndex*3 + 0] = imageX;
-                imageIndexCN[imageIndex*3 + 1] = imageY;
-                imageIndexCN[imageIndex*3 + 2] = imageZ;
-                imageIndex++;
-            }
-        }
-    }
+    // triplets i >= j >= k are computed by the process of atom i, from the neighbors of atom i within the CN cutoff
     double ijVec[3]; double ikVec[3]; double jkVec[3]; 
-    int scopeImageIK[3][2]; // the array saves the scope of image cells of the 3rd atom k. If a cell out of the scope, we will not compute interactions between the atom i, j and any atom in this cell
     double ijDist, ikDist, jkDist, ijDist2, ikDist2, jkDist2, r0abij, r0abik, r0abjk, rr0ij, rr0ik, rr0jk;
-    double c9, geoMean, damp3, t1, t2, t3, tDenomin, ang;
-    int k, imageIJindex, imageIKindex, imageIndexEsIJ, imageIndexEsJK, imageIndexEsIK;
+    double c9, geoMean, damp3, t1, t2, t3, tDenomin, ang, weight;
     double dFdamp, dAngIJ, dAngJK, dAngIK, dC9i, dC9j, dC9k;
-    for (i = 0; i < natom; i++) {
-        for (j = 0; j < i + 1; j++) {
-            ijVec[0] = atomPosition[j*3 + 0] - atomPosition[i*3 + 0];
-            ijVec[1] = atomPosition[j*3 + 1] - atomPosition[i*3 + 1];
-            ijVec[2] = atomPosition[j*3 + 2] - atomPosition[i*3 + 2];
-            r0abij = find_r0ab(pSPARC->atomicNumbers[i], pSPARC->atomicNumbers[j]);
-            for (imageIJindex = 0; imageIJindex < imageNumberCN; imageIJindex++) {
-                ijDist2 = pow(ijVec[0] + imageVecCN[imageIJindex*3 + 0], 2.0)
-                        + pow(ijVec[1] + imageVecCN[imageIJindex*3 + 1], 2.0)
-                        + pow(ijVec[2] + imageVecCN[imageIJindex*3 + 2], 2.0);
-                ijDist = sqrt(ijDist2);
-                if ((ijDist2 > cn_thr)|| (ijDist2 < 1e-15)) continue; //
-                rr0ij = ijDist / r0abij;
-                scopeImageIK[0][0] = max(-numImageCN[0], imageIndexCN[imageIJindex*3 + 0] - numImageCN[0]);
-                scopeImageIK[0][1] = min( numImageCN[0], imageIndexCN[imageIJindex*3 + 0] + numImageCN[0]);
-                scopeImageIK[1][0] = max(-numImageCN[1], imageIndexCN[imageIJindex*3 + 1] - numImageCN[1]);
-                scopeImageIK[1][1] = min( numImageCN[1], imageIndexCN[imageIJindex*3 + 1] + numImageCN[1]);
-                scopeImageIK[2][0] = max(-numImageCN[2], imageIndexCN[imageIJindex*3 + 2] - numImageCN[2]);
-                scopeImageIK[2][1] = min( numImageCN[2], imageIndexCN[imageIJindex*3 + 2] + numImageCN[2]);
-                int imageNumberIK = (scopeImageIK[0][1] - scopeImageIK[0][0] + 1) * 
-                (scopeImageIK[1][1] - scopeImageIK[1][0] + 1) * (scopeImageIK[2][1] - scopeImageIK[2][0] + 1);
-                double *imageVecIK = (double*)malloc(sizeof(double) * imageNumberIK * 3);
-                int *imageIndexIK = (int*)malloc(sizeof(int) * imageNumberIK * 3);
-                imageIndex = 0;
-                for (imageX = scopeImageIK[0][0]; imageX < scopeImageIK[0][1] + 1; imageX++) {
-                    for (imageY = scopeImageIK[1][0]; imageY < scopeImageIK[1][1] + 1; imageY++) {
-                        for (imageZ = scopeImageIK[2][0]; imageZ < scopeImageIK[2][1] + 1; imageZ++) {
-                            imageVecIK[imageIndex*3 + 0] = imageX*Lattice[0] + imageY*Lattice[3] + imageZ*Lattice[6];
-                            imageVecIK[imageIndex*3 + 1] = imageX*Lattice[1] + imageY*Lattice[4] + imageZ*Lattice[7];
-                            imageVecIK[imageIndex*3 + 2] = imageX*Lattice[2] + imageY*Lattice[5] + imageZ*Lattice[8];
-                            imageIndexIK[imageIndex*3 + 0] = imageX;
-                            imageIndexIK[imageIndex*3 + 1] = imageY;
-                            imageIndexIK[imageIndex*3 + 2] = imageZ;
-                            imageIndex++;
-                        }
-                    }
+    double *c6ij, *c6ik, *c6jk, c6jkNew[3];
+    // position of C6 of the pairs (i, neighbor) and (j, k) in the table
+    int *c6IndexIK = NULL, c6IndexCapacity = 0;
+    int *c6IndexJK = (int*)malloc(sizeof(int) * natom);
+    int *c6StampJK = (int*)malloc(sizeof(int) * natom);
+    for (k = 0; k < natom; k++) c6StampJK[k] = -1;
+    int stamp = 0;
+    for (i = atomStart; i < atomEnd; i++) {
+        D3_NEIGHBOR *neighbors = cnList.list + cnListOffset[i - atomStart];
+        int nNeighbor = cnListOffset[i - atomStart + 1] - cnListOffset[i - atomStart];
+        if (nNeighbor > c6IndexCapacity) {
+            c6IndexCapacity = nNeighbor;
+            c6IndexIK = (int*)realloc(c6IndexIK, sizeof(int) * c6IndexCapacity);
+        }
+        for (n = 0; n < nNeighbor; n++) 
+            c6IndexIK[n] = (d3_find_pair_C6(c6RowOffset, c6Col, c6Val, i, neighbors[n].atom) - c6Val) / 3;
+        for (n1 = 0; n1 < nNeighbor; n1++) {
+            j = neighbors[n1].atom;
+            ijVec[0] = neighbors[n1].vec[0]; ijVec[1] = neighbors[n1].vec[1]; ijVec[2] = neighbors[n1].vec[2];
+            ijDist2 = neighbors[n1].dist2;
+            ijDist = sqrt(ijDist2);
+            r0abij = r0abTable[pSPARC->atomicNumbers[i]*95 + pSPARC->atomicNumbers[j]];
+            rr0ij = ijDist / r0abij;
+            c6ij = c6Val + c6IndexIK[n1]*3;
+            if (n1 == 0 || neighbors[n1-1].atom != j) {
+                stamp++;
+                for (n = c6RowOffset[j]; n < c6RowOffset[j+1]; n++) {
+                    c6IndexJK[c6Col[n]] = n;
+                    c6StampJK[c6Col[n]] = stamp;
                 }
-                for (k = 0; k < j + 1; k++) {
-                    ikVec[0] = atomPosition[k*3 + 0] - atomPosition[i*3 + 0];
-                    ikVec[1] = atomPosition[k*3 + 1] - atomPosition[i*3 + 1];
-                    ikVec[2] = atomPosition[k*3 + 2] - atomPosition[i*3 + 2];
-                    jkVec[0] = atomPosition[k*3 + 0] - atomPosition[j*3 + 0] - imageVecCN[imageIJindex*3 + 0];
-                    jkVec[1] = atomPosition[k*3 + 1] - atomPosition[j*3 + 1] - imageVecCN[imageIJindex*3 + 1];
-                    jkVec[2] = atomPosition[k*3 + 2] - atomPosition[j*3 + 2] - imageVecCN[imageIJindex*3 + 2];
-                    c9 = sqrtC6matrix[i*natom + j] * sqrtC6matrix[i*natom + k] * sqrtC6matrix[j*natom + k];
-                    r0abik = find_r0ab(pSPARC->atomicNumbers[i], pSPARC->atomicNumbers[k]);
-                    r0abjk = find_r0ab(pSPARC->atomicNumbers[j], pSPARC->atomicNumbers[k]);
-                    for (imageIKindex = 0; imageIKindex < imageNumberIK; imageIKindex++) {
-                        ikDist2 = pow(ikVec[0] + imageVecIK[imageIKindex*3 + 0], 2.0)
-                                + pow(ikVec[1] + imageVecIK[imageIKindex*3 + 1], 2.0)
-                                + pow(ikVec[2] + imageVecIK[imageIKindex*3 + 2], 2.0);
-                        ikDist = sqrt(ikDist2);
-                        jkDist2 = pow(jkVec[0] + imageVecIK[imageIKindex*3 + 0], 2.0)
-                                + pow(jkVec[1] + imageVecIK[imageIKindex*3 + 1], 2.0)
-                                + pow(jkVec[2] + imageVecIK[imageIKindex*3 + 2], 2.0);
-                        jkDist = sqrt(jkDist2);
-                        if ((ikDist2 > cn_thr) || (ikDist2 < 1e-15)) continue; //
-                        if ((jkDist2 > cn_thr) || (jkDist2 < 1e-15)) continue; //
-                        rr0ik = ikDist / r0abik;
-                        rr0jk = jkDist / r0abjk;
-                        geoMean = pow(rr0ij*rr0ik*rr0jk, (1.0/3.0));
-                        damp3 = 1.0 / (1.0 + 6 * pow((4.0/3.0) / geoMean, alp8));
-                        t1 = ijDist2 + jkDist2 - ikDist2;
-                        t2 = ijDist2 + ikDist2 - jkDist2;
-                        t3 = ikDist2 + jkDist2 - ijDist2;
-                        tDenomin = ijDist2 * jkDist2 * ikDist2;
-                        ang = (0.375*t1*t2*t3/tDenomin + 1.0) / pow(tDenomin, 1.5);
-                        if ((i == j) && (i == k))
-                            e63 -= damp3*c9*ang/6.0;
-                        else if ((i == j) || (j == k))
-                            e63 -= damp3*c9*ang/2.0;
-                        else
-                            e63 -= damp3*c9*ang;
-                        
-                        // now compute the derivatives
-                        dFdamp = -2.0*alp8 * pow((4.0/3.0)/geoMean, alp8) * pow(damp3, 2.0); //d(f_dmp)/d(r_ij)
-                        // derivative of i, j
-                        dAngIJ = d3_dAng(ijDist2, jkDist2, ikDist2, tDenomin);
-                        imageIndexEsIJ = d3_count_image(imageIndexCN[imageIJindex*3 + 0], 
-                                                    imageIndexCN[imageIJindex*3 + 1], 
-                                                    imageIndexCN[imageIJindex*3 + 2], numImageEG);
-                        // derivative of j, k
-                        dAngJK = d3_dAng(jkDist2, ikDist2, ijDist2, tDenomin);
-                        imageIndexEsJK = d3_count_image(imageIndexIK[imageIKindex*3 + 0] - imageIndexCN[imageIJindex*3 + 0], 
-                                                    imageIndexIK[imageIKindex*3 + 1] - imageIndexCN[imageIJindex*3 + 1], 
-                                                    imageIndexIK[imageIKindex*3 + 2] - imageIndexCN[imageIJindex*3 + 2], numImageEG);
-                        // derivative of i, k
-                        dAngIK = d3_dAng(ikDist2, jkDist2, ijDist2, tDenomin);
-                        imageIndexEsIK = d3_count_image(imageIndexIK[imageIKindex*3 + 0],
-                                                    imageIndexIK[imageIKindex*3 + 1], 
-                                                    imageIndexIK[imageIKindex*3 + 2], numImageEG);
-                        //dC9/dCN
-                        dC9i = -0.5*c9*(dC6ij[i*natom + j]/(sqrtC6matrix[i*natom + j]*sqrtC6matrix[i*natom + j]) + dC6ij[i*natom + k]/(sqrtC6matrix[i*natom + k]*sqrtC6matrix[i*natom + k]));
-                        dC9j = -0.5*c9*(dC6ij[j*natom + i]/(sqrtC6matrix[i*natom + j]*sqrtC6matrix[i*natom + j]) + dC6ij[j*natom + k]/(sqrtC6matrix[j*natom + k]*sqrtC6matrix[j*natom + k]));
-                        dC9k = -0.5*c9*(dC6ij[k*natom + i]/(sqrtC6matrix[i*natom + k]*sqrtC6matrix[i*natom + k]) + dC6ij[k*natom + j]/(sqrtC6matrix[j*natom + k]*sqrtC6matrix[j*natom + k]));
-
-                        if ((i == j) && (i == k)) { // three image atoms injecting to the same atom in the cell
-                            drij[imageIndexEsIJ][i][j] += dFdamp / ijDist * c9 * ang / 6.0;
-                            drij[imageIndexEsIJ][i][j] -= dAngIJ * c9 * damp3 / 6.0;
-                            // drij[imageIndexEsIJ][j][i] = drij[imageIndexEsIJ][i][j];
-
-                            drij[imageIndexEsJK][j][k] += dFdamp / jkDist * c9 * ang / 6.0;
-                            drij[imageIndexEsJK][j][k] -= dAngJK * c9 * damp3 / 6.0;
-                            // drij[imageIndexEsJK][k][j] = drij[imageIndexEsJK][k][j];
-
-                            drij[imageIndexEsIK][i][k] += dFdamp / ikDist * c9 * ang / 6.0;
-                            drij[imageIndexEsIK][i][k] -= dAngIK * c9 * damp3 / 6.0;
-                            // drij[imageIndexEsIK][k][i] = drij[imageIndexEsIK][i][k];
-                            FdivR6 = ang * damp3 / 6.0; 
-                        }
-                        else if ((i == j) || (j == k)) { // two of three image atoms injecting to the same atom in the cell
-                            drij[imageIndexEsIJ][i][j] += dFdamp / ijDist * c9 * ang / 2.0;
-                            drij[imageIndexEsIJ][i][j] -= dAngIJ * c9 * damp3 / 2.0;
-                            drij[imageIndexEsIJ][j][i] = drij[imageIndexEsIJ][i][j];
-
-                            drij[imageIndexEsJK][j][k] += dFdamp / jkDist * c9 * ang / 2.0;
-                            drij[imageIndexEsJK][j][k] -= dAngJK * c9 * damp3 / 2.0;
-                            drij[imageIndexEsJK][k][j] = drij[imageIndexEsJK][k][j];
-
-                            drij[imageIndexEsIK][i][k] += dFdamp / ikDist * c9 * ang / 2.0;
-                            drij[imageIndexEsIK][i][k] -= dAngIK * c9 * damp3 / 2.0;
-                            drij[imageIndexEsIK][k][i] = drij[imageIndexEsIK][i][k];
-
-                            FdivR6 = ang * damp3 / 2.0; 
-                        }
-                        else {
-                            drij[imageIndexEsIJ][i][j] += dFdamp / ijDist * c9 * ang;
-                            drij[imageIndexEsIJ][i][j] -= dAngIJ * c9 * damp3;
-                            drij[imageIndexEsIJ][j][i] = drij[imageIndexEsIJ][i][j];
-
-                            drij[imageIndexEsJK][j][k] += dFdamp / jkDist * c9 * ang;
-                            drij[imageIndexEsJK][j][k] -= dAngJK * c9 * damp3;
-                            drij[imageIndexEsJK][k][j] = drij[imageIndexEsJK][k][j];
-
-                            drij[imageIndexEsIK][i][k] += dFdamp / ikDist * c9 * ang;
-                            drij[imageIndexEsIK][i][k] -= dAngIK * c9 * damp3;
-                            drij[imageIndexEsIK][k][i] = drij[imageIndexEsIK][i][k];
-
-                            FdivR6 = ang * damp3; 
-                        }
-                        FdivR6mulDC6[i] += FdivR6*dC9i;
-                        FdivR6mulDC6[j] += FdivR6*dC9j;
-                        FdivR6mulDC6[k] += FdivR6*dC9k;
-                    }  
+            }
+            for (n2 = 0; n2 < nNeighbor && neighbors[n2].atom <= j; n2++) {
+                k = neighbors[n2].atom;
+                ikVec[0] = neighbors[n2].vec[0]; ikVec[1] = neighbors[n2].vec[1]; ikVec[2] = neighbors[n2].vec[2];
+                jkVec[0] = ikVec[0] - ijVec[0];
+                jkVec[1] = ikVec[1] - ijVec[1];
+                jkVec[2] = ikVec[2] - ijVec[2];
+                jkDist2 = jkVec[0]*jkVec[0] + jkVec[1]*jkVec[1] + jkVec[2]*jkVec[2];
+                if ((jkDist2 > cn_thr) || (jkDist2 < 1e-15)) continue; //
+                ikDist2 = neighbors[n2].dist2;
+                ikDist = sqrt(ikDist2);
+                jkDist = sqrt(jkDist2);
+                c6ik = c6Val + c6IndexIK[n2]*3;
+                if (c6StampJK[k] == stamp) {
+                    c6jk = c6Val + c6IndexJK[k]*3;
+                } else { // distance j-k at the CN cutoff, rounded differently on the process of atom j
+                    d3_comp_dC6_dCNij(c6jkNew, pSPARC->atomMaxci, pSPARC->atomicNumbers, pSPARC->atomCN, j, k, pSPARC->c6ab, K3);
+                    c6jk = c6jkNew;
                 }
-                free(imageVecIK);
-                free(imageIndexIK);
+                c9 = sqrt(c6ij[0]) * sqrt(c6ik[0]) * sqrt(c6jk[0]);
+                r0abik = r0abTable[pSPARC->atomicNumbers[i]*95 + pSPARC->atomicNumbers[k]];
+                r0abjk = r0abTable[pSPARC->atomicNumbers[j]*95 + pSPARC->atomicNumbers[k]];
+                rr0ik = ikDist / r0abik;
+                rr0jk = jkDist / r0abjk;
+                geoMean = pow(rr0ij*rr0ik*rr0jk, (1.0/3.0));
+                damp3 = 1.0 / (1.0 + 6 * pow((4.0/3.0) / geoMean, alp8));
+                t1 = ijDist2 + jkDist2 - ikDist2;
+                t2 = ijDist2 + ikDist2 - jkDist2;
+                t3 = ikDist2 + jkDist2 - ijDist2;
+                tDenomin = ijDist2 * jkDist2 * ikDist2;
+                ang = (0.375*t1*t2*t3/tDenomin + 1.0) / pow(tDenomin, 1.5);
+                if ((i == j) && (i == k))
+                    weight = 1.0/6.0; // three image atoms injecting to the same atom in the cell
+                else if ((i == j) || (j == k))
+                    weight = 0.5; // two of three image atoms injecting to the same atom in the cell
+                else
+                    weight = 1.0;
+                e63 -= damp3*c9*ang*weight;
+                
+                // now compute the derivatives
+                dFdamp = -2.0*alp8 * pow((4.0/3.0)/geoMean, alp8) * pow(damp3, 2.0); //d(f_dmp)/d(r_ij)
+                // derivative of i, j
+                dAngIJ = d3_dAng(ijDist2, jkDist2, ikDist2, tDenomin);
+                d3_pair_gradient(i, j, ijVec, ijDist2, (dFdamp / ijDist * c9 * ang - dAngIJ * c9 * damp3) * weight, rthr, pSPARC->d3Grads, d3Sigma);
+                // derivative of j, k
+                dAngJK = d3_dAng(jkDist2, ikDist2, ijDist2, tDenomin);
+                d3_pair_gradient(j, k, jkVec, jkDist2, (dFdamp / jkDist * c9 * ang - dAngJK * c9 * damp3) * weight, rthr, pSPARC->d3Grads, d3Sigma);
+                // derivative of i, k
+                dAngIK = d3_dAng(ikDist2, jkDist2, ijDist2, tDenomin);
+                d3_pair_gradient(i, k, ikVec, ikDist2, (dFdamp / ikDist * c9 * ang - dAngIK * c9 * damp3) * weight, rthr, pSPARC->d3Grads, d3Sigma);
+                //dC9/dCN, the table saves C6 and dC6/dCN of both atoms of the pair (larger index first)
+                dC9i = -0.5*c9*(c6ij[1]/c6ij[0] + c6ik[1]/c6ik[0]);
+                dC9j = -0.5*c9*((i == j ? c6ij[1] : c6ij[2])/c6ij[0] + c6jk[1]/c6jk[0]);
+                dC9k = -0.5*c9*((i == k ? c6ik[1] : c6ik[2])/c6ik[0] + (j == k ? c6jk[1] : c6jk[2])/c6jk[0]);
+
+                FdivR6 = ang * damp3 * weight;
+                FdivR6mulDC6[i] += FdivR6*dC9i;
+                FdivR6mulDC6[j] += FdivR6*dC9j;
+                FdivR6mulDC6[k] += FdivR6*dC9k;
             }
         }
     } 
+    free(c6IndexIK);
+    free(c6IndexJK);
+    free(c6StampJK);
+    MPI_Allreduce(MPI_IN_PLACE, FdivR6mulDC6, natom, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    // below is the gradient of D3 energy through CNs of atoms
+    double rcovij, expterm, dCN, xi;
+    for (i = atomStart; i < atomEnd; i++) {
+        D3_NEIGHBOR *neighbors = cnList.list + cnListOffset[i - atomStart];
+        int nNeighbor = cnListOffset[i - atomStart + 1] - cnListOffset[i - atomStart];
+        for (n = 0; n < nNeighbor; n++) {
+            j = neighbors[n].atom;
+            iDist2 = neighbors[n].dist2;
+            if (iDist2 >= cn_thr) continue;
+            rcovij = pSPARC->atomScaledRcov[i] + pSPARC->atomScaledRcov[j];
+            iDist = sqrt(iDist2);
+            expterm = exp(-K1*(rcovij/iDist - 1));
+            dCN = -K1*rcovij*expterm / pow(iDist*(expterm + 1), 2.0);
+            if (i != j) {
+                xi = dCN*(FdivR6mulDC6[i] + FdivR6mulDC6[j]);
+            }
+            else {
+                xi = dCN*FdivR6mulDC6[i];
+            }
+            d3_pair_gradient(i, j, neighbors[n].vec, iDist2, xi, rthr, pSPARC->d3Grads, d3Sigma);
+        }
+    }
+
+    // sum energies, gradients and stress over all processes
+    double *d3Sum = (double*)malloc(sizeof(double) * (3*natom + 12));
+    memcpy(d3Sum, pSPARC->d3Grads, sizeof(double) * 3 * natom);
+    memcpy(d3Sum + 3*natom, d3Sigma, sizeof(double) * 9);
+    d3Sum[3*natom + 9] = e6; d3Sum[3*natom + 10] = e8; d3Sum[3*natom + 11] = e63;
+    MPI_Allreduce(MPI_IN_PLACE, d3Sum, 3*natom + 12, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    memcpy(pSPARC->d3Grads, d3Sum, sizeof(double) * 3 * natom);
+    memcpy(d3Sigma, d3Sum + 3*natom, sizeof(double) * 9);
+    e6 = d3Sum[3*natom + 9]; e8 = d3Sum[3*natom + 10]; e63 = d3Sum[3*natom + 11];
+    free(d3Sum);
+
     e = e6 + e8 - e63;
     pSPARC->d3Energy[0] = e; // totalD3energy
     pSPARC->d3Energy[1] = e6; // e6
@@ -537,67 +703,6 @@ void d3_energy_gradient(SPARC_OBJ *pSPARC) {
     #ifdef DEBUG
     if (rank == 0) printf("d3 energy %12.9f, inside e6 %12.9f, e8 %12.9f, e63 %12.9f\n", pSPARC->d3Energy[0], pSPARC->d3Energy[1], pSPARC->d3Energy[2], pSPARC->d3Energy[3]);
     #endif
-    // summary: gradient for all atoms and pressure of space
-    
-    for (row = 0; row < 3; row++) {
-        for (col = 0; col < 3; col++) {
-            pSPARC->d3Sigma[row*3 + col] = 0;
-        }
-    }
-    double gi[3]; double iCoord[3]; double jCoord[3]; double initialijImageVecs[3]; double ijImageVecs[3]; double vec[3];
-    double rcovij, expterm, dCN, xi;
-    for (i = 0; i < natom; i++) {
-        pSPARC->d3Grads[i*3 + 0] = 0.0; pSPARC->d3Grads[i*3 + 1] = 0.0; pSPARC->d3Grads[i*3 + 2] = 0.0;
-    }
-    for (i = 0; i < natom; i++) {
-        gi[0] = 0.0; gi[1] = 0.0; gi[2] = 0.0;
-        for (j = 0; j <= i; j++) {
-            iCoord[0] = atomPosition[i*3 + 0]; iCoord[1] = atomPosition[i*3 + 1]; iCoord[2] = atomPosition[i*3 + 2];
-            jCoord[0] = atomPosition[j*3 + 0]; jCoord[1] = atomPosition[j*3 + 1]; jCoord[2] = atomPosition[j*3 + 2];
-            initialijImageVecs[0] = jCoord[0] - iCoord[0]; initialijImageVecs[1] = jCoord[1] - iCoord[1]; initialijImageVecs[2] = jCoord[2] - iCoord[2];
-            for (imageIndex = 0; imageIndex < imageNumberEG; imageIndex++) {
-                ijImageVecs[0] = initialijImageVecs[0] + imageVecEG[imageIndex*3 + 0];
-                ijImageVecs[1] = initialijImageVecs[1] + imageVecEG[imageIndex*3 + 1];
-                ijImageVecs[2] = initialijImageVecs[2] + imageVecEG[imageIndex*3 + 2];
-                rcovij = pSPARC->atomScaledRcov[i] + pSPARC->atomScaledRcov[j];
-                iDist2 = ijImageVecs[0]*ijImageVecs[0] + ijImageVecs[1]*ijImageVecs[1] + ijImageVecs[2]*ijImageVecs[2];
-                if (i != j) {
-                    if ((iDist2 > pSPARC->d3Rthr) || (iDist2 < 0.5)) continue;
-                }
-                else {
-                    if (iDist2 < 1e-15) continue; // need tp discuss
-                }
-                iDist = sqrt(iDist2);
-                if ((iDist2 < cn_thr) && (iDist2 > 1e-15)) {
-                    expterm = exp(-K1*(rcovij/iDist - 1));
-                    dCN = -K1*rcovij*expterm / pow(iDist*(expterm + 1), 2.0);
-                }
-                else {
-                    dCN=0.0;
-                }
-                // imageIndexEs = count_image(imageIndex(imagej, 1), imageIndex(imagej, 2), imageIndex(imagej, 3), nImageEG);
-                if (i != j) {
-                    xi = drij[imageIndex][i][j] + dCN*(FdivR6mulDC6[i] + FdivR6mulDC6[j]);
-                }
-                else {
-                    xi = drij[imageIndex][i][j] + dCN*FdivR6mulDC6[i];
-                }
-                vec[0] = xi * ijImageVecs[0] / iDist;
-                vec[1] = xi * ijImageVecs[1] / iDist;
-                vec[2] = xi * ijImageVecs[2] / iDist;
-                if (i != j) {
-                    gi[0] += vec[0]; gi[1] += vec[1]; gi[2] += vec[2];
-                    pSPARC->d3Grads[j*3 + 0] -= vec[0]; pSPARC->d3Grads[j*3 + 1] -= vec[1]; pSPARC->d3Grads[j*3 + 2] -= vec[2]; 
-                }
-                for (row = 0; row < 3; row++) {
-                    for (col = 0; col < 3; col++) {
-                        pSPARC->d3Sigma[row*3 + col] += vec[row]*ijImageVecs[col];
-                    }
-                }
-            }
-        }
-        pSPARC->d3Grads[i*3 + 0] += gi[0]; pSPARC->d3Grads[i*3 + 1] += gi[1]; pSPARC->d3Grads[i*3 + 2] += gi[2];
-    }
     
     pSPARC->Etot += e; // add total d3 energy onto total energy
     #ifdef DEBUG
@@ -614,21 +719,58 @@ void d3_energy_gradient(SPARC_OBJ *pSPARC) {
         Cart2nonCart_coord(pSPARC, &pSPARC->atom_pos[atm*3], &pSPARC->atom_pos[atm*3 + 1], &pSPARC->atom_pos[atm*3 + 2]);
     }
 
-    free(selfAtomC6);
+    d3_free_cell_list(&cellList);
+    free(cnList.list);
+    free(cnListOffset);
+    free(c6RowOffset);
+    free(c6Col);
+    free(c6Val);
+    free(r0abTable);
+    free(FdivR6mulDC6);
+}
 
-    free(sqrtC6matrix);
-    free(imageVecEG);
-    for (imageIndex = 0; imageIndex < imageNumberEG; imageIndex++) {
-        for (i = 0; i < natom; i++) {
-            free(*(*(drij + imageIndex) + i));
+/**
+ * @brief find C6, dC6/dCN of atom a and atom b of the pair (a, b) in the table of pairs within the CN cutoff. 
+ *        Returns NULL if the pair is not in the table
+ */
+double *d3_find_pair_C6(int *c6RowOffset, int *c6Col, double *c6Val, int atomA, int atomB) {
+    int row = max(atomA, atomB), colAtom = min(atomA, atomB);
+    int low = c6RowOffset[row], high = c6RowOffset[row+1] - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        if (c6Col[mid] == colAtom) return c6Val + mid*3;
+        if (c6Col[mid] < colAtom) low = mid + 1;
+        else high = mid - 1;
+    }
+    return NULL;
+}
+
+/**
+ * @brief add the gradient dE/d|r_ab| * r_ab/|r_ab| of the pair (atomA, atomB) onto the atomic gradients and the stress.
+ *        vec is the vector from atom a to the image of atom b
+ */
+void d3_pair_gradient(int atomA, int atomB, double *vec, double dist2, double dEdr, double rthr, double *grads, double *sigma) {
+    int row, col;
+    if (atomA != atomB) {
+        if ((dist2 > rthr) || (dist2 < 0.5)) return;
+    }
+    else {
+        if (dist2 < 1e-15) return; // need tp discuss
+    }
+    double dist = sqrt(dist2);
+    double gradVec[3];
+    gradVec[0] = dEdr * vec[0] / dist;
+    gradVec[1] = dEdr * vec[1] / dist;
+    gradVec[2] = dEdr * vec[2] / dist;
+    if (atomA != atomB) {
+        grads[atomA*3 + 0] += gradVec[0]; grads[atomA*3 + 1] += gradVec[1]; grads[atomA*3 + 2] += gradVec[2];
+        grads[atomB*3 + 0] -= gradVec[0]; grads[atomB*3 + 1] -= gradVec[1]; grads[atomB*3 + 2] -= gradVec[2]; 
+    }
+    for (row = 0; row < 3; row++) {
+        for (col = 0; col < 3; col++) {
+            sigma[row*3 + col] += gradVec[row]*vec[col];
         }
-        free(*(drij + imageIndex));
     }
-    free(drij);
-    free(dC6ij);
-    free(FdivR6mulDC6);
-    free(imageVecCN);
-    free(imageIndexCN);
 }
 
 double d3_dAng(double abDist2, double bcDist2, double acDist2, double tDenomin) {
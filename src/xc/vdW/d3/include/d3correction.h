@@ -14,6 +14,37 @@
 #ifndef D3_CORRECTION
 #define D3_CORRECTION 
 
+/**
+ * @brief cell list of all atoms, binned in fractional coordinates
+ */
+typedef struct _D3_CELL_LIST {
+    int natom;
+    int nBin[3];          // number of bins in each direction
+    int periodic[3];      // 1: periodic direction, images of atoms are searched; 0: no image
+    double recipVec[9];   // reciprocal vectors (without 2*pi), fractional coordinate d of point r is recipVec[3d:3d+2] . r
+    double origin[3];     // lower bound of fractional coordinates of bins
+    double width[3];      // width of bins in fractional coordinates
+    double *frac;         // fractional coordinates of atoms
+    int *head;            // first atom in each bin, -1 if empty
+    int *next;            // next atom in the same bin, -1 at the end
+    int *shift;           // index of the periodic cell holding the atom
+} D3_CELL_LIST;
+
+/**
+ * @brief an image of a neighbor atom
+ */
+typedef struct _D3_NEIGHBOR {
+    int atom;             // index of the neighbor atom
+    double vec[3];        // vector from the center atom to the image of the neighbor atom
+    double dist2;         // squared distance
+} D3_NEIGHBOR;
+
+typedef struct _D3_NEIGHBOR_LIST {
+    int n;                // number of neighbors saved
+    int capacity;
+    D3_NEIGHBOR *list;
+} D3_NEIGHBOR_LIST;
+
 /**
  * @brief calculate how many image cells need to be considered
  * @param rLimit  cut-off radius of a calculation
@@ -27,9 +58,33 @@ void d3_set_criteria(int *nImage, double rLimit, int *periodicType, double *inpu
 double solve_cos(double latF1, double latF2, double latF3, double latS1, double latS2, double latS3, double latT1, double latT2, double latT3);
 
 /**
- * @brief calculate CNs of all atoms in the system
+ * @brief build the cell list of all atoms. The atoms are binned in fractional coordinates, the bins are no smaller than rCut
+ * @param periodicType  3*1 array for recording type of boundary 1: P 0: D
+ * @param Lattice  (lattice vectors * side length) tensor
+ */
+void d3_build_cell_list(D3_CELL_LIST *cellList, double *atomPosition, int natom, double *Lattice, int *periodicType, double rCut);
+
+void d3_free_cell_list(D3_CELL_LIST *cellList);
+
+int d3_floor_div(int a, int b);
+
+/**
+ * @brief append all images of atoms within rCut of atom atomI to the neighbor list.
+ *        If halfList == 1, only atoms with index no larger than atomI are included.
  */
-void d3_CN(SPARC_OBJ *pSPARC, double K1);
+void d3_find_neighbors(D3_CELL_LIST *cellList, double *atomPosition, double *Lattice, int atomI, double rCut, int halfList, D3_NEIGHBOR_LIST *neighborList);
+
+/**
+ * @brief calculate CNs of the atoms atomStart, ..., atomEnd-1 and gather CNs of all atoms.
+ *        The neighbors (index no larger than the center atom) within the CN cutoff are saved into cnList, sorted by atom index, 
+ *        cnListOffset[i-atomStart] is the first neighbor of atom i.
+ */
+void d3_CN(SPARC_OBJ *pSPARC, D3_CELL_LIST *cellList, int atomStart, int atomEnd, D3_NEIGHBOR_LIST *cnList, int *cnListOffset, double K1);
+
+/**
+ * @brief atoms atomStart, ..., atomEnd-1 are assigned to process rank
+ */
+void d3_atom_range(int natom, int nproc, int rank, int *atomStart, int *atomEnd);
 
 /**
  * @brief calculate C6 by interpolation
@@ -60,6 +115,18 @@ void d3_energy_gradient(SPARC_OBJ *pSPARC);
  */
 void d3_comp_dC6_dCNij(double *C6dC6pairIJ, int *atomMaxci, int *atomicNumbers, double *CN, int atomI, int atomJ, double *****c6ab, double k3);
 
+/**
+ * @brief find C6, dC6/dCN of atom a and atom b of the pair (a, b) in the table of pairs within the CN cutoff. 
+ *        Returns NULL if the pair is not in the table
+ */
+double *d3_find_pair_C6(int *c6RowOffset, int *c6Col, double *c6Val, int atomA, int atomB);
+
+/**
+ * @brief add the gradient dE/d|r_ab| * r_ab/|r_ab| of the pair (atomA, atomB) onto the atomic gradients and the stress.
+ *        vec is the vector from atom a to the image of atom b
+ */
+void d3_pair_gradient(int atomA, int atomB, double *vec, double dist2, double dEdr, double rthr, double *grads, double *sigma);
+
 /**
  * @brief used in d3_energy_gradient
  */
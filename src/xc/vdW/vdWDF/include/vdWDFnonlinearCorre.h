@@ -58,15 +58,14 @@ void compute_Gvectors(SPARC_OBJ *pSPARC);
 
 
 /**
- * @brief compose parallel FFT on data gatheredThetaCompl
- * @param inputDataRealSpace: a double _Complex array saving the data to compute their FFT or iFFT. The length is Nx*Ny*DMnz
- * @param outputDataReciSpace: a double _Complex array saving the result of FFT or iFFT. The length is Nx*Ny*DMnz
- * @param gridsizes: a 3-entries array containing Nx, Ny and Nz of the system
+ * @brief compose parallel FFT on the gathered thetas of all nqs model energy ratios, using the persistent plan
+ *        created in vdWDF_Setup_Comms. The nqs vectors are transformed together (batched FFT with FFTW).
+ * @param inputDataRealSpace: a double _Complex array saving the data to compute their FFT. The length is Nx*Ny*DMnz*nqs, q by q
+ * @param outputDataReciSpace: a double _Complex array saving the result of FFT. The length is Nx*Ny*DMnz*nqs, q by q.
+ *        It can be the same array as inputDataRealSpace
  * @param DMnz: the length of grids arranged on the z-axis processor (0, 0, z), it should be equal to data distribution lengthK from FFT modules
- * @param q: the model energy ratio index of the theta vector to compute FFT
- * @param zAxisComm: the cartesion topology communicator linking all z-axis processors (0, 0, z)
  */
-void parallel_FFT(double _Complex *inputDataRealSpace, double _Complex *outputDataReciSpace, int *gridsizes, int DMnz, int q, MPI_Comm zAxisComm);
+void parallel_FFT(SPARC_OBJ *pSPARC, double _Complex *inputDataRealSpace, double _Complex *outputDataReciSpace, int DMnz);
 
 /**
  * @brief generating thetas (ps*rho) in real space, then using FFT to transform thetas to reciprocal space. array vdWDFthetaFTs is the output.
@@ -87,15 +86,14 @@ void interpolate_kernel(SPARC_OBJ *pSPARC);
 void vdWDF_energy(SPARC_OBJ *pSPARC);
 
 /**
- * @brief compose parallel inverse FFT on data gathereduFT
- * @param inputDataReciSpace: a double _Complex array saving the data to compute their FFT or iFFT. The length is Nx*Ny*DMnz
- * @param outputDataRealSpace: a double _Complex array saving the result of FFT or iFFT. The length is Nx*Ny*DMnz
- * @param gridsizes: a 3-entries array containing Nx, Ny and Nz of the system
+ * @brief compose parallel inverse FFT on the gathered u vectors of all nqs model energy ratios, using the persistent plan
+ *        created in vdWDF_Setup_Comms. The nqs vectors are transformed together (batched iFFT with FFTW).
+ * @param inputDataReciSpace: a double _Complex array saving the data to compute their iFFT. The length is Nx*Ny*DMnz*nqs, q by q
+ * @param outputDataRealSpace: a double _Complex array saving the result of iFFT. The length is Nx*Ny*DMnz*nqs, q by q.
+ *        It can be the same array as inputDataReciSpace
  * @param DMnz: the length of grids arranged on the z-axis processor (0, 0, z), it should be equal to data distribution lengthK from FFT modules
- * @param q: the model energy ratio index of the theta vector to compute FFT
- * @param zAxisComm: the cartesion topology communicator linking all z-axis processors (0, 0, z)
  */
-void parallel_iFFT(double _Complex *inputDataReciSpace, double _Complex *outputDataRealSpace, int *gridsizes, int DMnz, int q, MPI_Comm zAxisComm);
+void parallel_iFFT(SPARC_OBJ *pSPARC, double _Complex *inputDataReciSpace, double _Complex *outputDataRealSpace, int DMnz);
 
 /**
  * @brief compute u vectors in reciprocal space, then transform them back to real space by inverse FFT
@@ -35,6 +35,18 @@ int judgeUnavailableLengthK(int FFTsize, int *allLengthK);
 
 void vdWDF_Setup_Comms(SPARC_OBJ *pSPARC, int *gridsizes, int *phiDims);
 
+/**
+ * @brief Create the persistent parallel FFT and iFFT plans (and their buffers) on zAxisComm.
+ *        They are created once in vdWDF_Setup_Comms and reused for all q points and SCF steps.
+ * @param gridsizes  a 3-entries array containing Nx, Ny and Nz of the system
+**/
+void vdWDF_Create_FFT_Plans(SPARC_OBJ *pSPARC, int *gridsizes);
+
+/**
+ * @brief Free the persistent parallel FFT and iFFT plans and their buffers.
+**/
+void vdWDF_Free_FFT_Plans(SPARC_OBJ *pSPARC);
+
 /**
  * @brief Input the vertices on a direction and the dimensions (number of processors) on that direction,
  *        return which dimension (or interval) the node is in
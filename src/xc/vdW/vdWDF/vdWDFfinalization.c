@@ -84,6 +84,7 @@ void vdWDF_free(SPARC_OBJ *pSPARC) {
         free(pSPARC->vdWDFreciLength);
         Free_D2D_Target_AnyDMVert(&pSPARC->gatherThetasSender, &pSPARC->gatherThetasRecvr, pSPARC->dmcomm_phi, pSPARC->zAxisComm);
         Free_D2D_Target_AnyDMVert(&pSPARC->scatterThetasSender, &pSPARC->scatterThetasRecvr, pSPARC->zAxisComm, pSPARC->dmcomm_phi);
+        vdWDF_Free_FFT_Plans(pSPARC);
         if (pSPARC->zAxisComm != MPI_COMM_NULL) {
             int FFTrank;
             MPI_Comm_rank(pSPARC->zAxisComm, &FFTrank);
@@ -435,100 +435,49 @@ void compute_Gvectors(SPARC_OBJ *pSPARC)
 
 
 
-void parallel_FFT(double _Complex *inputDataRealSpace, double _Complex *outputDataReciSpace, int *gridsizes, int DMnz, int q, MPI_Comm zAxisComm)
+/**
+ * @brief apply the persistent parallel FFT (direction = 1) or iFFT (direction = -1) on zAxisComm
+ *        to the nqs vectors of all model energy ratios.
+ */
+static void parallel_FFT_nqs(SPARC_OBJ *pSPARC, double _Complex *inputData, double _Complex *outputData, int DMnz, int direction)
 {
-#if defined(USE_MKL) // use MKL CDFT
-    int rank;
-    MPI_Comm_rank(zAxisComm, &rank);
-    int sizeZcomm;
-    MPI_Comm_size(zAxisComm, &sizeZcomm);
-
-    // initializa parallel FFT
-    DFTI_DESCRIPTOR_DM_HANDLE desc = NULL;
-    MKL_LONG localArrayLength;
-    MKL_LONG dim_sizes[3] = {gridsizes[2], gridsizes[1], gridsizes[0]};
-    DftiCreateDescriptorDM(zAxisComm, &desc, DFTI_DOUBLE, DFTI_COMPLEX, 3, dim_sizes);
-    DftiGetValueDM(desc, CDFT_LOCAL_SIZE, &localArrayLength);
-    // MKL_LONG lengthK, startK;
-    // DftiGetValueDM(desc, CDFT_LOCAL_NX, &lengthK);
-    // DftiGetValueDM(desc, CDFT_LOCAL_X_START, &startK);
-    // int lengthKint = lengthK;
-    // int startKint = startK;
-
-    // compose FFT input to prevent the inconsistency division on Z axis
-    double _Complex *FFTInput = (double _Complex *)malloc(sizeof(double _Complex) * (localArrayLength));
-    double _Complex *FFTOutput = (double _Complex *)malloc(sizeof(double _Complex) * (localArrayLength));
-    assert(FFTInput != NULL);
-    assert(FFTOutput != NULL);
-
-    // the decomposition of space in zAxisComm should be consistent with the data distribution designated by DFT module. DMnz == lengthK
-    // Relative code can be found in function vdWDF_Setup_Comms, file vdWDFparallelization.c.
-    int numElesInGlobalPlane = gridsizes[0] * gridsizes[1];
-    memcpy(FFTInput, inputDataRealSpace, sizeof(double _Complex) * numElesInGlobalPlane * DMnz);
-
-    // make parallel FFT
-    /* Set that we want out-of-place transform (default is DFTI_INPLACE) */
-    DftiSetValueDM(desc, DFTI_PLACEMENT, DFTI_NOT_INPLACE);
-    /* Commit descriptor, calculate FFT, free descriptor */
-    DftiCommitDescriptorDM(desc);
-    DftiComputeForwardDM(desc, FFTInput, FFTOutput);
-
+#if defined(USE_MKL) || defined(USE_FFTW)
+    int nqs = pSPARC->vdWDFnqs;
     // the decomposition of space in zAxisComm should be consistent with the data distribution designated by DFT module. DMnz == lengthK
     // Relative code can be found in function vdWDF_Setup_Comms, file vdWDFparallelization.c.
-    memcpy(outputDataReciSpace, FFTOutput, sizeof(double _Complex) * numElesInGlobalPlane * DMnz);
-
-    DftiFreeDescriptorDM(&desc);
-    free(FFTInput);
-    free(FFTOutput);
-
+    int lenLocal = pSPARC->Nx * pSPARC->Ny * DMnz;
+    double _Complex *FFTInput = pSPARC->vdWDFFFTin;
+    double _Complex *FFTOutput = pSPARC->vdWDFFFTout;
+#endif
+#if defined(USE_MKL) // use MKL CDFT
+    // CDFT has no batched transform, the committed descriptor is applied to each q
+    DFTI_DESCRIPTOR_DM_HANDLE desc = (DFTI_DESCRIPTOR_DM_HANDLE) pSPARC->vdWDFFFTplan;
+    for (int q = 0; q < nqs; q++) {
+        memcpy(FFTInput, inputData + q * lenLocal, sizeof(double _Complex) * lenLocal);
+        if (direction == 1)
+            DftiComputeForwardDM(desc, FFTInput, FFTOutput);
+        else
+            DftiComputeBackwardDM(desc, FFTInput, FFTOutput);
+        memcpy(outputData + q * lenLocal, FFTOutput, sizeof(double _Complex) * lenLocal);
+    }
 #elif defined(USE_FFTW) // use FFTW if MKL is not used
-
-    int rank;
-    MPI_Comm_rank(zAxisComm, &rank);
-    int sizeZcomm;
-    MPI_Comm_size(zAxisComm, &sizeZcomm);
-
-    // initializa parallel FFT
-    const ptrdiff_t N0 = gridsizes[2], N1 = gridsizes[1], N2 = gridsizes[0]; // N0: z; N1:Y; N2:x
-    fftw_plan plan;
-    fftw_complex *FFTInput, *FFTOutput;
-    ptrdiff_t localArrayLength, lengthK, startK;
-    fftw_mpi_init();
-    /* get local data size and allocate */
-    localArrayLength = fftw_mpi_local_size_3d(N0, N1, N2, zAxisComm, &lengthK, &startK);
-    FFTInput = fftw_alloc_complex(localArrayLength);
-    FFTOutput = fftw_alloc_complex(localArrayLength);
-    // // compose FFT input to prevent the inconsistency division on Z axis
-    // int lengthKint = lengthK;
-    // int startKint = startK;
-    // printf("rank %d, DMnz %d\n", rank, DMnz);
-    // if (rank == 0) {
-    //     for (int i = 0; i < sizeZcomm; i++) {
-    //         printf("rank %d, startK %d, lengthK %d\n", i, allStartK[i], allLengthK[i]);
-    //     }
-    // }
-
-    // the decomposition of space in zAxisComm should be consistent with the DFT module. DMnz == lengthK
-    // Relative code can be found in function vdWDF_Setup_Comms, file vdWDFparallelization.c.
-    int numElesInGlobalPlane = gridsizes[0] * gridsizes[1];
-    memcpy(FFTInput, inputDataRealSpace, sizeof(double _Complex) * numElesInGlobalPlane * DMnz);
-
-    /* create plan for in-place forward DFT */
-    plan = fftw_mpi_plan_dft_3d(N0, N1, N2, FFTInput, FFTOutput, zAxisComm, FFTW_FORWARD, FFTW_ESTIMATE);
-    fftw_execute(plan);
-    // // compose FFT output to prevent the inconsistency division on Z axis
-
-    // the decomposition of space in zAxisComm is consistent with the DFT module. Relative code can be found in 
-    // function vdWDF_Setup_Comms, file vdWDFparallelization.c.
-    memcpy(outputDataReciSpace, FFTOutput, sizeof(double _Complex) * numElesInGlobalPlane * DMnz);
-
-    fftw_free(FFTInput);
-    fftw_free(FFTOutput);
-    fftw_destroy_plan(plan);
-    fftw_mpi_cleanup();
-
+    // the batched plan works on interleaved data, i.e., the nqs values of a grid point are contiguous
+    for (int q = 0; q < nqs; q++) {
+        for (int i = 0; i < lenLocal; i++)
+            FFTInput[i * nqs + q] = inputData[q * lenLocal + i];
+    }
+    fftw_execute((fftw_plan) (direction == 1 ? pSPARC->vdWDFFFTplan : pSPARC->vdWDFiFFTplan));
+    for (int q = 0; q < nqs; q++) {
+        for (int i = 0; i < lenLocal; i++)
+            outputData[q * lenLocal + i] = FFTOutput[i * nqs + q];
+    }
 #endif
 }
+
+void parallel_FFT(SPARC_OBJ *pSPARC, double _Complex *inputDataRealSpace, double _Complex *outputDataReciSpace, int DMnz)
+{
+    parallel_FFT_nqs(pSPARC, inputDataRealSpace, outputDataReciSpace, DMnz, 1);
+}
 /*
 Functions above are related to parallel FFT
 */
@@ -566,32 +515,28 @@ void theta_generate_FT(SPARC_OBJ *pSPARC, double *rho)
     double *thetaFTreal = (double *)malloc(sizeof(double) * DMnd);
     double *thetaFTimag = (double *)malloc(sizeof(double) * DMnd);
     double _Complex **thetaFTs = pSPARC->vdWDFthetaFTs;
-    double *gatheredTheta = NULL;
+    // the gathered arrays keep the thetas of all q points, so that they are transformed by one batched FFT
+    double *gatheredTheta = NULL; // real part of the FFT result is put back in here after FFT
     double _Complex *gatheredThetaCompl = NULL;
-    double _Complex *gatheredThetaFFT = NULL;
-    double *gatheredThetaFFT_real = NULL;
     double *gatheredThetaFFT_imag = NULL;
-    int igrid, rigrid;
-    int FFTrank = -1; int FFTsize = -1; int FFTDMnz = -1;
+    int igrid, rigrid, q1;
+    int FFTrank = -1; int FFTsize = -1; int FFTDMnz = -1; int FFTDMnd = 0;
     if (pSPARC->zAxisComm != MPI_COMM_NULL)
     { // the processors on z axis (0, 0, z) receive the theta vectors from all other processors (x, y, z) on its z plane
         // printf("rank %d. pSPARC->zAxisComm not NULL!\n", rank);
         MPI_Comm_rank(pSPARC->zAxisComm, &FFTrank);
         MPI_Comm_size(pSPARC->zAxisComm, &FFTsize);
         FFTDMnz = pSPARC->zAxisVertices[5] - pSPARC->zAxisVertices[4] + 1;
-        gatheredTheta = (double *)malloc(sizeof(double) * gridsizes[0] * gridsizes[1] * FFTDMnz);
-        gatheredThetaCompl = (double _Complex *)malloc(sizeof(double _Complex) * gridsizes[0] * gridsizes[1] * FFTDMnz);
-        gatheredThetaFFT = (double _Complex *)malloc(sizeof(double _Complex) * gridsizes[0] * gridsizes[1] * FFTDMnz);
-        gatheredThetaFFT_real = (double *)malloc(sizeof(double) * gridsizes[0] * gridsizes[1] * FFTDMnz);
-        gatheredThetaFFT_imag = (double *)malloc(sizeof(double) * gridsizes[0] * gridsizes[1] * FFTDMnz);
+        FFTDMnd = gridsizes[0] * gridsizes[1] * FFTDMnz;
+        gatheredTheta = (double *)malloc(sizeof(double) * FFTDMnd * nqs);
+        gatheredThetaCompl = (double _Complex *)malloc(sizeof(double _Complex) * FFTDMnd * nqs);
+        gatheredThetaFFT_imag = (double *)malloc(sizeof(double) * FFTDMnd * nqs);
         assert(gatheredTheta != NULL);
         assert(gatheredThetaCompl != NULL);
-        assert(gatheredThetaFFT != NULL);
-        assert(gatheredThetaFFT_real != NULL);
         assert(gatheredThetaFFT_imag != NULL);
     }
     
-    for (int q1 = 0; q1 < nqs; q1++)
+    for (q1 = 0; q1 < nqs; q1++)
     {
         for (igrid = 0; igrid < DMnd; igrid++)
         {
@@ -599,28 +544,31 @@ void theta_generate_FT(SPARC_OBJ *pSPARC, double *rho)
         }
         D2D_AnyDMVert(&(pSPARC->gatherThetasSender), &(pSPARC->gatherThetasRecvr), gridsizes,
             pSPARC->DMVertices, theta,
-            pSPARC->zAxisVertices, gatheredTheta,
+            pSPARC->zAxisVertices, gatheredTheta + q1 * FFTDMnd,
             pSPARC->dmcomm_phi, phiDims, pSPARC->zAxisComm, zAxisDims, pSPARC->dmcomm_phi);
         // printf("rank %d. D2D for q1 %d finished!\n", rank, q1);
-        if (pSPARC->zAxisComm != MPI_COMM_NULL)
-        { // the processors on z axis (0, 0, z) receive the theta vectors from all other processors (x, y, z) on its z plane
-            for (rigrid = 0; rigrid < gridsizes[0] * gridsizes[1] * FFTDMnz; rigrid++)
-            {
-                gatheredThetaCompl[rigrid] = (double _Complex)gatheredTheta[rigrid];
-            }
-            parallel_FFT(gatheredThetaCompl, gatheredThetaFFT, gridsizes, FFTDMnz, q1, pSPARC->zAxisComm);
-            for (rigrid = 0; rigrid < gridsizes[0] * gridsizes[1] * FFTDMnz; rigrid++)
-            {
-                gatheredThetaFFT_real[rigrid] = creal(gatheredThetaFFT[rigrid]);
-                gatheredThetaFFT_imag[rigrid] = cimag(gatheredThetaFFT[rigrid]);
-            }
+    }
+    if (pSPARC->zAxisComm != MPI_COMM_NULL)
+    { // the processors on z axis (0, 0, z) transform the theta vectors of all q points together
+        for (rigrid = 0; rigrid < FFTDMnd * nqs; rigrid++)
+        {
+            gatheredThetaCompl[rigrid] = (double _Complex)gatheredTheta[rigrid];
         }
+        parallel_FFT(pSPARC, gatheredThetaCompl, gatheredThetaCompl, FFTDMnz);
+        for (rigrid = 0; rigrid < FFTDMnd * nqs; rigrid++)
+        {
+            gatheredTheta[rigrid] = creal(gatheredThetaCompl[rigrid]);
+            gatheredThetaFFT_imag[rigrid] = cimag(gatheredThetaCompl[rigrid]);
+        }
+    }
+    for (q1 = 0; q1 < nqs; q1++)
+    {
         D2D_AnyDMVert(&(pSPARC->scatterThetasSender), &(pSPARC->scatterThetasRecvr), gridsizes, // scatter the real part of theta results from the processors on z axis (0, 0, z) to all other processors
-            pSPARC->zAxisVertices, gatheredThetaFFT_real,
+            pSPARC->zAxisVertices, gatheredTheta + q1 * FFTDMnd,
             pSPARC->DMVertices, thetaFTreal,
             pSPARC->zAxisComm, zAxisDims, pSPARC->dmcomm_phi, phiDims, pSPARC->dmcomm_phi);
         D2D_AnyDMVert(&(pSPARC->scatterThetasSender), &(pSPARC->scatterThetasRecvr), gridsizes, // scatter the imaginary part of theta results from the processors on z axis (0, 0, z) to all other processors
-            pSPARC->zAxisVertices, gatheredThetaFFT_imag,
+            pSPARC->zAxisVertices, gatheredThetaFFT_imag + q1 * FFTDMnd,
             pSPARC->DMVertices, thetaFTimag,
             pSPARC->zAxisComm, zAxisDims, pSPARC->dmcomm_phi, phiDims, pSPARC->dmcomm_phi);
         for (rigrid = 0; rigrid < DMnd; rigrid++)
@@ -643,8 +591,6 @@ void theta_generate_FT(SPARC_OBJ *pSPARC, double *rho)
     { // the processors on z axis (0, 0, z) receive the theta vectors from all other processors (x, y, z) on its z plane
         free(gatheredTheta);
         free(gatheredThetaCompl);
-        free(gatheredThetaFFT);
-        free(gatheredThetaFFT_real);
         free(gatheredThetaFFT_imag);
     }
 }
@@ -763,86 +709,9 @@ Functions above are related to generating thetas (ps*rho) and integrating energy
 /*
 Functions below are related to generating u vectors, transforming them to real space and computing vdW-DF potential.
 */
-void parallel_iFFT(double _Complex *inputDataReciSpace, double _Complex *outputDataRealSpace, int *gridsizes, int DMnz, int q, MPI_Comm zAxisComm)
+void parallel_iFFT(SPARC_OBJ *pSPARC, double _Complex *inputDataReciSpace, double _Complex *outputDataRealSpace, int DMnz)
 {
-#if defined(USE_MKL) // use MKL CDFT
-    int rank;
-    MPI_Comm_rank(zAxisComm, &rank);
-    int sizeZcomm;
-    MPI_Comm_size(zAxisComm, &sizeZcomm);
-    // initializa parallel iFFT
-    DFTI_DESCRIPTOR_DM_HANDLE desc = NULL;
-    MKL_LONG localArrayLength;
-    MKL_LONG dim_sizes[3] = {gridsizes[2], gridsizes[1], gridsizes[0]};
-    DftiCreateDescriptorDM(zAxisComm, &desc, DFTI_DOUBLE, DFTI_COMPLEX, 3, dim_sizes);
-    DftiGetValueDM(desc, CDFT_LOCAL_SIZE, &localArrayLength);
-    // MKL_LONG lengthK, startK;
-    // DftiGetValueDM(desc, CDFT_LOCAL_NX, &lengthK);
-    // DftiGetValueDM(desc, CDFT_LOCAL_X_START, &startK);
-    // int lengthKint = lengthK;
-    // int startKint = startK;
-    // compose iFFT input to prevent the inconsistency division on Z axis
-    double _Complex *iFFTInput = (double _Complex *)malloc(sizeof(double _Complex) * (localArrayLength));
-    double _Complex *iFFTOutput = (double _Complex *)malloc(sizeof(double _Complex) * (localArrayLength));
-    assert(iFFTInput != NULL);
-    assert(iFFTOutput != NULL);
-
-    // the decomposition of space in zAxisComm should be consistent with the data distribution designated by DFT module. DMnz == lengthK
-    // Relative code can be found in function vdWDF_Setup_Comms, file vdWDFparallelization.c.
-    int numElesInGlobalPlane = gridsizes[0] * gridsizes[1];
-    memcpy(iFFTInput, inputDataReciSpace, sizeof(double _Complex) * numElesInGlobalPlane * DMnz);
-    // make parallel FFT
-    /* Set that we want out-of-place transform (default is DFTI_INPLACE) */
-    DftiSetValueDM(desc, DFTI_PLACEMENT, DFTI_NOT_INPLACE);
-    /* Commit descriptor, calculate FFT, free descriptor */
-    DftiCommitDescriptorDM(desc);
-    DftiComputeBackwardDM(desc, iFFTInput, iFFTOutput);
-
-    // the decomposition of space in zAxisComm should be consistent with the data distribution designated by DFT module. DMnz == lengthK
-    // Relative code can be found in function vdWDF_Setup_Comms, file vdWDFparallelization.c.
-    memcpy(outputDataRealSpace, iFFTOutput, sizeof(double _Complex) * numElesInGlobalPlane * DMnz);
-
-    DftiFreeDescriptorDM(&desc);
-    free(iFFTInput);
-    free(iFFTOutput);
-
-#elif defined(USE_FFTW) // use FFTW if MKL is not used
-
-    int rank;
-    MPI_Comm_rank(zAxisComm, &rank);
-    int sizeZcomm;
-    MPI_Comm_size(zAxisComm, &sizeZcomm);
-    // initializa parallel iFFT
-    const ptrdiff_t N0 = gridsizes[2], N1 = gridsizes[1], N2 = gridsizes[0]; // N0: z; N1:Y; N2:x
-    fftw_plan plan;
-    fftw_complex *iFFTInput, *iFFTOutput;
-    ptrdiff_t localArrayLength, lengthK, startK;
-    fftw_mpi_init();
-    /* get local data size and allocate */
-    localArrayLength = fftw_mpi_local_size_3d(N0, N1, N2, zAxisComm, &lengthK, &startK);
-    iFFTInput = fftw_alloc_complex(localArrayLength);
-    iFFTOutput = fftw_alloc_complex(localArrayLength);
-    // compose iFFT input to prevent the inconsistency division on Z axis
-    // int lengthKint = lengthK;
-    // int startKint = startK;
-
-    // the decomposition of space in zAxisComm should be consistent with the data distribution designated by DFT module. DMnz == lengthK
-    // Relative code can be found in function vdWDF_Setup_Comms, file vdWDFparallelization.c.
-    int numElesInGlobalPlane = gridsizes[0] * gridsizes[1];
-    memcpy(iFFTInput, inputDataReciSpace, sizeof(double _Complex) * numElesInGlobalPlane * DMnz);
-    /* create plan for out-place backward DFT */
-    plan = fftw_mpi_plan_dft_3d(N0, N1, N2, iFFTInput, iFFTOutput, zAxisComm, FFTW_BACKWARD, FFTW_ESTIMATE);
-    fftw_execute(plan);
-
-
-    memcpy(outputDataRealSpace, iFFTOutput, sizeof(double _Complex) * numElesInGlobalPlane * DMnz);
-
-    fftw_free(iFFTInput);
-    fftw_free(iFFTOutput);
-    fftw_destroy_plan(plan);
-    fftw_mpi_cleanup();
-
-#endif
+    parallel_FFT_nqs(pSPARC, inputDataReciSpace, outputDataRealSpace, DMnz, -1);
 }
 
 // compute u vectors in reciprocal space, then transform them back to real space by iFFT
@@ -874,27 +743,23 @@ void u_generate_iFT(SPARC_OBJ *pSPARC)
     int rigrid, q1;
     double *uFTreal = (double *)malloc(sizeof(double) * DMnd);
     double *uFTimag = (double *)malloc(sizeof(double) * DMnd);
-    double *gathereduFT_real = NULL;
+    // the gathered arrays keep the u vectors of all q points, so that they are transformed by one batched iFFT
+    double *gathereduFT_real = NULL; // u in real space is put back in here after iFFT
     double *gathereduFT_imag = NULL;
     double _Complex *gathereduFT = NULL;
-    double _Complex *gathereduCompl = NULL;
-    double *gatheredu = NULL;
-    int FFTrank = -1; int FFTsize = -1; int FFTDMnz = -1;
+    int FFTrank = -1; int FFTsize = -1; int FFTDMnz = -1; int FFTDMnd = 0;
     if (pSPARC->zAxisComm != MPI_COMM_NULL)
     {
         MPI_Comm_rank(pSPARC->zAxisComm, &FFTrank);
         MPI_Comm_size(pSPARC->zAxisComm, &FFTsize);
         FFTDMnz = pSPARC->zAxisVertices[5] - pSPARC->zAxisVertices[4] + 1;
-        gathereduFT_real = (double *)malloc(sizeof(double) * gridsizes[0] * gridsizes[1] * FFTDMnz);
-        gathereduFT_imag = (double *)malloc(sizeof(double) * gridsizes[0] * gridsizes[1] * FFTDMnz);
-        gathereduFT = (double _Complex *)malloc(sizeof(double _Complex) * gridsizes[0] * gridsizes[1] * FFTDMnz);
-        gathereduCompl = (double _Complex *)malloc(sizeof(double _Complex) * gridsizes[0] * gridsizes[1] * FFTDMnz);
-        gatheredu = (double *)malloc(sizeof(double) * gridsizes[0] * gridsizes[1] * FFTDMnz);
+        FFTDMnd = gridsizes[0] * gridsizes[1] * FFTDMnz;
+        gathereduFT_real = (double *)malloc(sizeof(double) * FFTDMnd * nqs);
+        gathereduFT_imag = (double *)malloc(sizeof(double) * FFTDMnd * nqs);
+        gathereduFT = (double _Complex *)malloc(sizeof(double _Complex) * FFTDMnd * nqs);
         assert(gathereduFT_real != NULL);
         assert(gathereduFT_imag != NULL);
         assert(gathereduFT != NULL);
-        assert(gathereduCompl != NULL);
-        assert(gatheredu != NULL);
     }
 
     for (q1 = 0; q1 < nqs; q1++)
@@ -906,26 +771,29 @@ void u_generate_iFT(SPARC_OBJ *pSPARC)
         }
         D2D_AnyDMVert(&(pSPARC->gatherThetasSender), &(pSPARC->gatherThetasRecvr), gridsizes,
             pSPARC->DMVertices, uFTreal,
-            pSPARC->zAxisVertices, gathereduFT_real,
+            pSPARC->zAxisVertices, gathereduFT_real + q1 * FFTDMnd,
             pSPARC->dmcomm_phi, phiDims, pSPARC->zAxisComm, zAxisDims, pSPARC->dmcomm_phi);
         D2D_AnyDMVert(&(pSPARC->gatherThetasSender), &(pSPARC->gatherThetasRecvr), gridsizes,
             pSPARC->DMVertices, uFTimag,
-            pSPARC->zAxisVertices, gathereduFT_imag,
+            pSPARC->zAxisVertices, gathereduFT_imag + q1 * FFTDMnd,
             pSPARC->dmcomm_phi, phiDims, pSPARC->zAxisComm, zAxisDims, pSPARC->dmcomm_phi);
-        if (pSPARC->zAxisComm != MPI_COMM_NULL)
+    }
+    if (pSPARC->zAxisComm != MPI_COMM_NULL)
+    {
+        for (rigrid = 0; rigrid < FFTDMnd * nqs; rigrid++)
         {
-            for (rigrid = 0; rigrid < gridsizes[0] * gridsizes[1] * FFTDMnz; rigrid++)
-            {
-                gathereduFT[rigrid] = gathereduFT_real[rigrid] + gathereduFT_imag[rigrid] * I;
-            }
-            parallel_iFFT(gathereduFT, gathereduCompl, gridsizes, FFTDMnz, q1, pSPARC->zAxisComm);
-            for (rigrid = 0; rigrid < gridsizes[0] * gridsizes[1] * FFTDMnz; rigrid++)
-            {
-                gatheredu[rigrid] = creal(gathereduCompl[rigrid]); // MKL original iFFT functions do not divide the iFFT results by N
-            }
+            gathereduFT[rigrid] = gathereduFT_real[rigrid] + gathereduFT_imag[rigrid] * I;
         }
+        parallel_iFFT(pSPARC, gathereduFT, gathereduFT, FFTDMnz);
+        for (rigrid = 0; rigrid < FFTDMnd * nqs; rigrid++)
+        {
+            gathereduFT_real[rigrid] = creal(gathereduFT[rigrid]); // MKL original iFFT functions do not divide the iFFT results by N
+        }
+    }
+    for (q1 = 0; q1 < nqs; q1++)
+    {
         D2D_AnyDMVert(&(pSPARC->scatterThetasSender), &(pSPARC->scatterThetasRecvr), gridsizes, // scatter the real part of theta results from the processors on z axis (0, 0, z) to all other processors
-            pSPARC->zAxisVertices, gatheredu,
+            pSPARC->zAxisVertices, gathereduFT_real + q1 * FFTDMnd,
             pSPARC->DMVertices, u[q1],
             pSPARC->zAxisComm, zAxisDims, pSPARC->dmcomm_phi, phiDims, pSPARC->dmcomm_phi);
         // if ((pSPARC->countPotentialCalculate == 0) && (q1 == 5) && (rank == size - 1)) { // only output result in 1st step
@@ -943,8 +811,6 @@ void u_generate_iFT(SPARC_OBJ *pSPARC)
         free(gathereduFT_real);
         free(gathereduFT_imag);
         free(gathereduFT);
-        free(gathereduCompl);
-        free(gatheredu);
     }
 }
 
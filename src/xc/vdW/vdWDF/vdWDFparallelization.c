@@ -123,7 +123,6 @@ void vdWDF_Setup_Comms(SPARC_OBJ *pSPARC, int *gridsizes, int *phiDims) {
                 startKint = startK;
                 pSPARC->zAxisVertices[4] = startKint;
                 pSPARC->zAxisVertices[5] = startKint + lengthKint - 1;
-                fftw_mpi_cleanup();
             #endif
             MPI_Allgather(&lengthKint, 1, MPI_INT, allLengthK, 1, MPI_INT, pSPARC->zAxisComm);
             if (FFTrank == 0) {
@@ -178,6 +177,75 @@ void vdWDF_Setup_Comms(SPARC_OBJ *pSPARC, int *gridsizes, int *phiDims) {
     // Free_D2D_Target(&scatterThetasSender, &scatterThetasRecvr, newZAxisComm, pSPARC->dmcomm_phi);
     // if (newZAxisComm != MPI_COMM_NULL)
     //     MPI_Comm_free(&newZAxisComm);
+
+    // create the FFT plans once, they are reused for all q points and SCF steps
+    vdWDF_Create_FFT_Plans(pSPARC, gridsizes);
+}
+
+
+/**
+ * @brief Create the persistent parallel FFT and iFFT plans on zAxisComm, together with their buffers.
+ *        FFTW transforms all nqs theta (or u) vectors in one batched plan, the data of the different q points
+ *        are interleaved in the buffers. MKL CDFT does not support batched transforms, so the committed
+ *        descriptor is applied to the q points one by one.
+**/
+void vdWDF_Create_FFT_Plans(SPARC_OBJ *pSPARC, int *gridsizes) {
+    pSPARC->vdWDFFFTplan = NULL;
+    pSPARC->vdWDFiFFTplan = NULL;
+    pSPARC->vdWDFFFTin = NULL;
+    pSPARC->vdWDFFFTout = NULL;
+    if (pSPARC->zAxisComm == MPI_COMM_NULL) return;
+#if defined(USE_MKL) // use MKL CDFT
+    DFTI_DESCRIPTOR_DM_HANDLE desc = NULL;
+    MKL_LONG localArrayLength;
+    MKL_LONG dim_sizes[3] = {gridsizes[2], gridsizes[1], gridsizes[0]};
+    DftiCreateDescriptorDM(pSPARC->zAxisComm, &desc, DFTI_DOUBLE, DFTI_COMPLEX, 3, dim_sizes);
+    DftiGetValueDM(desc, CDFT_LOCAL_SIZE, &localArrayLength);
+    /* Set that we want out-of-place transform (default is DFTI_INPLACE) */
+    DftiSetValueDM(desc, DFTI_PLACEMENT, DFTI_NOT_INPLACE);
+    DftiCommitDescriptorDM(desc);
+    pSPARC->vdWDFFFTplan = (void *) desc;
+    pSPARC->vdWDFFFTin = (double _Complex *)malloc(sizeof(double _Complex) * localArrayLength);
+    pSPARC->vdWDFFFTout = (double _Complex *)malloc(sizeof(double _Complex) * localArrayLength);
+    assert(pSPARC->vdWDFFFTin != NULL && pSPARC->vdWDFFFTout != NULL);
+#elif defined(USE_FFTW) // use FFTW if MKL is not used
+    const ptrdiff_t N[3] = {gridsizes[2], gridsizes[1], gridsizes[0]}; // N0: z; N1:Y; N2:x
+    ptrdiff_t howmany = pSPARC->vdWDFnqs;
+    ptrdiff_t localArrayLength, lengthK, startK;
+    fftw_mpi_init();
+    localArrayLength = fftw_mpi_local_size_many(3, N, howmany, FFTW_MPI_DEFAULT_BLOCK, pSPARC->zAxisComm, &lengthK, &startK);
+    pSPARC->vdWDFFFTin = (double _Complex *) fftw_alloc_complex(localArrayLength);
+    pSPARC->vdWDFFFTout = (double _Complex *) fftw_alloc_complex(localArrayLength);
+    assert(pSPARC->vdWDFFFTin != NULL && pSPARC->vdWDFFFTout != NULL);
+    pSPARC->vdWDFFFTplan = (void *) fftw_mpi_plan_many_dft(3, N, howmany, FFTW_MPI_DEFAULT_BLOCK, FFTW_MPI_DEFAULT_BLOCK,
+        (fftw_complex *) pSPARC->vdWDFFFTin, (fftw_complex *) pSPARC->vdWDFFFTout, pSPARC->zAxisComm, FFTW_FORWARD, FFTW_ESTIMATE);
+    pSPARC->vdWDFiFFTplan = (void *) fftw_mpi_plan_many_dft(3, N, howmany, FFTW_MPI_DEFAULT_BLOCK, FFTW_MPI_DEFAULT_BLOCK,
+        (fftw_complex *) pSPARC->vdWDFFFTin, (fftw_complex *) pSPARC->vdWDFFFTout, pSPARC->zAxisComm, FFTW_BACKWARD, FFTW_ESTIMATE);
+#endif
+}
+
+
+/**
+ * @brief Free the persistent parallel FFT and iFFT plans and their buffers.
+**/
+void vdWDF_Free_FFT_Plans(SPARC_OBJ *pSPARC) {
+    if (pSPARC->zAxisComm == MPI_COMM_NULL) return;
+#if defined(USE_MKL) // use MKL CDFT
+    DFTI_DESCRIPTOR_DM_HANDLE desc = (DFTI_DESCRIPTOR_DM_HANDLE) pSPARC->vdWDFFFTplan;
+    DftiFreeDescriptorDM(&desc);
+    free(pSPARC->vdWDFFFTin);
+    free(pSPARC->vdWDFFFTout);
+#elif defined(USE_FFTW) // use FFTW if MKL is not used
+    fftw_destroy_plan((fftw_plan) pSPARC->vdWDFFFTplan);
+    fftw_destroy_plan((fftw_plan) pSPARC->vdWDFiFFTplan);
+    fftw_free(pSPARC->vdWDFFFTin);
+    fftw_free(pSPARC->vdWDFFFTout);
+    fftw_mpi_cleanup();
+#endif
+    pSPARC->vdWDFFFTplan = NULL;
+    pSPARC->vdWDFiFFTplan = NULL;
+    pSPARC->vdWDFFFTin = NULL;
+    pSPARC->vdWDFFFTout = NULL;
 }
 
 
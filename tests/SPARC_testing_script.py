@@ -185,6 +185,20 @@ SYSTEMS["directory"].append("./")
 SYSTEMS["Tags"].append(['bulk', 'lda', 'denmix', 'orth','gamma','smear_gauss'])
 SYSTEMS["Tols"].append([1e-5, 1e-4, 1]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
 ##################################################################################################################
+# BaTiO3_quick printing the density and energy densities with PRINT_DENSITY_FORMAT: 2 (cube and .bin files);
+# the .bin files hold the same values as the cube files to their 1e-6 relative print precision
+SYSTEMS["systemname"].append('BaTiO3_quick_dens_bin')
+SYSTEMS["directory"].append("./")
+SYSTEMS["Tags"].append(['bulk', 'lda', 'denmix', 'orth','gamma','smear_gauss','dens_bin'])
+SYSTEMS["Tols"].append([1e-5, 1e-4, 1]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
+##################################################################################################################
+# CS_FLAG: 1 solves only the top of the subspace eigenproblem, needs USE_DP_SUBEIG = 1 (stops with an error otherwise);
+# the references come from a CS_FLAG: 1 run and agree with the full solve to 1e-12 Ha/atom and 1e-10 Ha/Bohr
+SYSTEMS["systemname"].append('BaTiO3_CS')
+SYSTEMS["directory"].append("./")
+SYSTEMS["Tags"].append(['bulk', 'gga', 'denmix', 'orth','gamma','smear_gauss','cs'])
+SYSTEMS["Tols"].append([tols["E_tol"], tols["F_tol"], tols["stress_tol"]]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
+##################################################################################################################
 SYSTEMS["systemname"].append('H2O_sheet_quick')
 SYSTEMS["directory"].append("./")
 SYSTEMS["Tags"].append(['surface', 'gga', 'potmix', 'orth','gamma','smear_fd'])
@@ -200,6 +214,11 @@ SYSTEMS["directory"].append("./")
 SYSTEMS["Tags"].append(['molecule', 'gga', 'denmix', 'orth','gamma','smear_gauss'])
 SYSTEMS["Tols"].append([1e-5, 1e-4, 1]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
 ##################################################################################################################
+SYSTEMS["systemname"].append('SiH4_quick_mg')
+SYSTEMS["directory"].append("./")
+SYSTEMS["Tags"].append(['molecule', 'gga', 'denmix', 'orth','gamma','smear_gauss','multigrid'])
+SYSTEMS["Tols"].append([1e-5, 1e-4, 1]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
+##################################################################################################################
 SYSTEMS["systemname"].append('Al18Si18_NPTNH')
 SYSTEMS["directory"].append("./")
 SYSTEMS["Tags"].append(['bulk', 'gga', 'nonorth', 'md_npt'])
@@ -255,6 +274,20 @@ SYSTEMS["directory"].append("./xc_tests/exx_tests/")
 SYSTEMS["Tags"].append(['bulk', 'HSE','gamma' 'nonorth','smear_fd','potmix'])
 SYSTEMS["Tols"].append([tols["E_tol"], tols["F_tol"], tols["stress_tol"]]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
 ##################################################################################################################
+# ISDF exact exchange, the references agree with the exchange of all orbital pairs within the tolerances
+SYSTEMS["systemname"].append('C_HSE_ISDF')
+SYSTEMS["directory"].append("./xc_tests/exx_tests/")
+SYSTEMS["Tags"].append(['bulk', 'HSE', 'gamma', 'nonorth', 'smear_fd', 'potmix', 'isdf'])
+SYSTEMS["Tols"].append([5e-6, 1e-4, 0.1]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
+##################################################################################################################
+# HSE with the short range enhancement factor read from a table (EXX_SR_TABLE_TOL: 1e-6) instead of the
+# analytic expression; the references come from the table with the default ACE operator and agree with an
+# analytic run without ACE to 3e-8 Ha/atom, 2e-6 Ha/Bohr and 1e-3% in the stress
+SYSTEMS["systemname"].append('C_HSE_SR_table')
+SYSTEMS["directory"].append("./xc_tests/exx_tests/")
+SYSTEMS["Tags"].append(['bulk', 'HSE', 'gamma', 'nonorth', 'smear_fd', 'potmix', 'sr_table'])
+SYSTEMS["Tols"].append([tols["E_tol"], tols["F_tol"], tols["stress_tol"]]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
+##################################################################################################################
 SYSTEMS["systemname"].append('Fe2_spin_gamma_ortho_vdWDF1')
 SYSTEMS["directory"].append("./xc_tests/vdW_tests/")
 SYSTEMS["Tags"].append(['bulk', 'spin', 'gga', 'orth', 'gamma','vdWDF'])
@@ -320,11 +353,38 @@ SYSTEMS["directory"].append("./")
 SYSTEMS["Tags"].append(['bulk', 'gga','orth','fast'])
 SYSTEMS["Tols"].append([1e-5, 1e-4, 0.5]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
 ################################################################################################################
+# AlSi_orthogonal_quick_scf with NUM_OMP_THREADS: 2, the references come from 2 processes with 2 threads each
+# and agree with the AlSi_orthogonal_quick_scf references to 3e-9 Ha/atom, 6e-7 Ha/Bohr and 1e-3% in the stress
+SYSTEMS["systemname"].append('AlSi_orthogonal_omp')
+SYSTEMS["directory"].append("./")
+SYSTEMS["Tags"].append(['bulk', 'gga','orth','fast','omp'])
+SYSTEMS["Tols"].append([1e-5, 1e-4, 0.5]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
+################################################################################################################
+# PARAL_AUTOTUNE picks the process layout by timing candidates, which only changes the data distribution:
+# checked against a run with the default layout to 1e-5 Ha/atom, 1e-4 Ha/Bohr and 0.5% in the stress
+SYSTEMS["systemname"].append('AlSi_paral_autotune')
+SYSTEMS["directory"].append("./")
+SYSTEMS["Tags"].append(['bulk', 'gga','orth','fast','autotune'])
+SYSTEMS["Tols"].append([1e-5, 1e-4, 0.5]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
+################################################################################################################
+# single precision Chebyshev filter with k-points, the references agree with the double precision filter to 1e-10 Ha/atom
+SYSTEMS["systemname"].append('AlSi_mixed_prec')
+SYSTEMS["directory"].append("./")
+SYSTEMS["Tags"].append(['bulk', 'gga','orth','fast','mixedprec'])
+SYSTEMS["Tols"].append([1e-5, 1e-4, 0.5]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
+################################################################################################################
 SYSTEMS["systemname"].append('AlSi_primitive_quick_relax')
 SYSTEMS["directory"].append("./")
 SYSTEMS["Tags"].append(['bulk', 'gga','nonorth','relax_atom_lbfgs','kpt','fast'])
 SYSTEMS["Tols"].append([1e-5, 1e-4, 0.5]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
 ################################################################################################################
+# AlSi_primitive_quick_relax with PRINT_TIMING: 1, writes the .timing report of every relaxation step; the
+# energies, forces and stress are the same as AlSi_primitive_quick_relax
+SYSTEMS["systemname"].append('AlSi_relax_timing')
+SYSTEMS["directory"].append("./")
+SYSTEMS["Tags"].append(['bulk', 'gga','nonorth','relax_atom_lbfgs','kpt','fast','timing'])
+SYSTEMS["Tols"].append([1e-5, 1e-4, 0.5]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
+################################################################################################################
 SYSTEMS["systemname"].append('BN_primitive_quick_md')
 SYSTEMS["directory"].append("./")
 SYSTEMS["Tags"].append(['bulk', 'lda','nonorth','md_nve','kpt','fast'])
@@ -340,11 +400,30 @@ SYSTEMS["directory"].append("./")
 SYSTEMS["Tags"].append(['bulk', 'lda','orth','relax_atom_lbfgs','gamma','fast'])
 SYSTEMS["Tols"].append([1e-5, 1e-4, 0.5]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
 ################################################################################################################
+SYSTEMS["systemname"].append('SiC_incremental_relax')
+SYSTEMS["directory"].append("./")
+SYSTEMS["Tags"].append(['bulk', 'lda','orth','relax_atom_lbfgs','gamma','incremental'])
+SYSTEMS["Tols"].append([1e-5, 1e-4, 0.5]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
+################################################################################################################
 SYSTEMS["systemname"].append('TiO2_orthogonal_quick_md')
 SYSTEMS["directory"].append("./")
 SYSTEMS["Tags"].append(['bulk', 'gga','orth','md_nve','gamma','fast'])
 SYSTEMS["Tols"].append([1e-5, 1e-4, 0.5]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
 ################################################################################################################
+# TiO2_orthogonal_quick_md with ORBITAL_EXTRAPOLATION: 1, the orbitals of steps 4 and 5 are extrapolated
+SYSTEMS["systemname"].append('TiO2_orbital_extrap')
+SYSTEMS["directory"].append("./")
+SYSTEMS["Tags"].append(['bulk', 'gga','orth','md_nve','gamma','fast','orbextrap'])
+SYSTEMS["Tols"].append([1e-5, 1e-4, 0.5]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
+################################################################################################################
+# TiO2_orthogonal_quick_md restarted from the .restart and .restart_scf files of its step 3 in standard/, the energies
+# of steps 3 to 5 agree with TiO2_orthogonal_quick_md to 1e-8 Ha/atom and step 3 needs 2 SCF iterations instead of 21.
+# The high accuracy run uses the same files, its grid does not match the .restart_scf file and the default guess is used
+SYSTEMS["systemname"].append('TiO2_restart_scf')
+SYSTEMS["directory"].append("./")
+SYSTEMS["Tags"].append(['bulk', 'gga','orth','md_nve','gamma','fast','restart_scf'])
+SYSTEMS["Tols"].append([1e-5, 1e-4, 0.5]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
+################################################################################################################
 ################################################################################################################
 SYSTEMS["systemname"].append('BaTiO3_scan')
 SYSTEMS["directory"].append("./xc_tests/mgga_tests/")
@@ -401,6 +480,12 @@ SYSTEMS["directory"].append("./highT_tests/")
 SYSTEMS["Tags"].append(['bulk', 'highT', 'orth', 'lda'])
 SYSTEMS["Tols"].append([tols["E_tol"], tols["F_tol"], tols["stress_tol"]]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
 ##################################################################################################################
+# highT_Al with SQ_BLOCK_SIZE: 16, energy, forces and stress should agree with highT_Al
+SYSTEMS["systemname"].append('highT_Al_block')
+SYSTEMS["directory"].append("./highT_tests/")
+SYSTEMS["Tags"].append(['bulk', 'highT', 'orth', 'lda'])
+SYSTEMS["Tols"].append([tols["E_tol"], tols["F_tol"], tols["stress_tol"]]) # E_tol(Ha/atom), F_tol(Ha/Bohr), stress_tol(%)
+##################################################################################################################
 SYSTEMS["systemname"].append('highT_B4C_MD')
 SYSTEMS["directory"].append("./highT_tests/")
 SYSTEMS["Tags"].append(['bulk', 'highT', 'orth', 'lda','md_nvkg'])
@@ -629,16 +714,20 @@ def launchsystems(systems, dirs_sys, memcheck, procs_nodes_cluster, ismempbs, if
 					# os.system("cp *.psp8 temp_run")
 					if ismlff_copy[countx] == True:
 						os.system("cp ./high_accuracy/MLFF* ./temp_run")
-					if syst == "Al16Si16_NPTNH_restart" or syst == "Al16Si16_NPTNP_restart":
+					if syst == "Al16Si16_NPTNH_restart" or syst == "Al16Si16_NPTNP_restart" or syst == "TiO2_restart_scf":
 						os.system("cp ./standard/*.restart ./temp_run")
+					if syst == "TiO2_restart_scf":
+						os.system("cp ./standard/*.restart_scf ./temp_run")
 				if ifVHQ == False:
 					os.system("cp ./standard/*.inpt ./temp_run")
 					os.system("cp ./standard/*.ion ./temp_run")
 					# os.system("cp *.psp8 temp_run")
 					if ismlff_copy[countx] == True:
 						os.system("cp ./standard/MLFF* ./temp_run")
-					if syst == "Al16Si16_NPTNH_restart" or syst == "Al16Si16_NPTNP_restart":
+					if syst == "Al16Si16_NPTNH_restart" or syst == "Al16Si16_NPTNP_restart" or syst == "TiO2_restart_scf":
 						os.system("cp ./standard/*.restart ./temp_run")
+					if syst == "TiO2_restart_scf":
+						os.system("cp ./standard/*.restart_scf ./temp_run")
 			else:
 				os.mkdir("temp_run")
 				
@@ -648,16 +737,20 @@ def launchsystems(systems, dirs_sys, memcheck, procs_nodes_cluster, ismempbs, if
 					# os.system("cp *.psp8 temp_run")
 					if ismlff_copy[countx] == True:
 						os.system("cp ./high_accuracy/MLFF* ./temp_run")
-					if syst == "Al16Si16_NPTNH_restart" or syst == "Al16Si16_NPTNP_restart":
+					if syst == "Al16Si16_NPTNH_restart" or syst == "Al16Si16_NPTNP_restart" or syst == "TiO2_restart_scf":
 						os.system("cp ./standard/*.restart ./temp_run")
+					if syst == "TiO2_restart_scf":
+						os.system("cp ./standard/*.restart_scf ./temp_run")
 				if ifVHQ == False:
 					os.system("cp ./standard/*.inpt ./temp_run")
 					os.system("cp ./standard/*.ion ./temp_run")
 					# os.system("cp *.psp8 temp_run")
 					if ismlff_copy[countx] == True:
 						os.system("cp ./standard/MLFF* ./temp_run")
-					if syst == "Al16Si16_NPTNH_restart" or syst == "Al16Si16_NPTNP_restart":
+					if syst == "Al16Si16_NPTNH_restart" or syst == "Al16Si16_NPTNP_restart" or syst == "TiO2_restart_scf":
 						os.system("cp ./standard/*.restart ./temp_run")
+					if syst == "TiO2_restart_scf":
+						os.system("cp ./standard/*.restart_scf ./temp_run")
 		else:
 			if os.path.isdir("temp_run1"):
 				files = glob.glob("temp_run1/*")
@@ -0,0 +1,117 @@
+################################################################################################################
+# Sweep driver for the SPARC kernel micro-benchmarks (src/bench/sparc_bench.c).
+#
+# For each FD grid, FD order and cell type a Si diamond input is generated in runs/, and the benchmark is run
+# for each number of MPI processes and OpenMP threads. The result lines of all runs are collected in
+# bench_results.txt with the columns
+#
+#   kernel np nthreads Nx Ny Nz order ncol calls t_call(s) GB/s GFLOP/s
+#
+# Example:
+#   python SPARC_bench_script.py -np 1 2 4 -threads 1 2 -grid 40 60 -order 8 12 -ncol 1,8,32
+################################################################################################################
+from __future__ import print_function
+import os
+import sys
+import argparse
+import subprocess
+
+# lattice constant of the conventional diamond Si cell (Bohr)
+a_Si = 10.26
+frac_Si = [[0.00, 0.00, 0.00], [0.50, 0.50, 0.00], [0.00, 0.50, 0.50], [0.50, 0.00, 0.50],
+           [0.25, 0.25, 0.25], [0.75, 0.75, 0.25], [0.25, 0.75, 0.75], [0.75, 0.25, 0.75]]
+here = os.path.dirname(os.path.abspath(__file__))
+psp_Si = os.path.join(here, '..', '..', 'psps', '14_Si_4_1.9_1.9_pbe_n_v1.0.psp8')
+
+
+def write_input(folder, N, order, cell, nthreads):
+	# roughly 0.35 Bohr mesh, at least one conventional cell
+	rep = max(1, int(round(N * 0.35 / a_Si)))
+	L = rep * a_Si
+	with open(os.path.join(folder, 'bench.inpt'), 'w') as f:
+		f.write('# generated by SPARC_bench_script.py\n')
+		if cell == 'nonorth':
+			f.write('LATVEC:\n1.0 0.0 0.0\n0.1 1.0 0.0\n0.0 0.1 1.0\n')
+		f.write('LATVEC_SCALE: %.6f %.6f %.6f\n' % (L, L, L))
+		f.write('FD_GRID: %d %d %d\n' % (N, N, N))
+		f.write('FD_ORDER: %d\n' % order)
+		f.write('BC: P P P\n')
+		f.write('KPOINT_GRID: 1 1 1\n')
+		f.write('EXCHANGE_CORRELATION: GGA_PBE\n')
+		f.write('ELEC_TEMP_TYPE: fermi-dirac\n')
+		f.write('ELEC_TEMP: 315.773\n')
+		f.write('NP_KPOINT_PARAL: 1\n')
+		f.write('NP_BAND_PARAL: 1\n')
+		f.write('NUM_OMP_THREADS: %d\n' % nthreads)
+	with open(os.path.join(folder, 'bench.ion'), 'w') as f:
+		f.write('ATOM_TYPE: Si\n')
+		f.write('N_TYPE_ATOM: %d\n' % (8 * rep**3))
+		f.write('PSEUDO_POT: %s\n' % os.path.abspath(psp_Si))
+		f.write('ATOMIC_MASS: 28.0855\n')
+		f.write('COORD_FRAC:\n')
+		for i in range(rep):
+			for j in range(rep):
+				for k in range(rep):
+					for c in frac_Si:
+						f.write('%.6f %.6f %.6f\n' % ((c[0]+i)/rep, (c[1]+j)/rep, (c[2]+k)/rep))
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Sweep the SPARC kernel micro-benchmarks')
+	parser.add_argument('-exe', default=os.path.join(here, '..', '..', 'lib', 'sparc_bench'), help='benchmark executable')
+	parser.add_argument('-mpirun', default='mpirun', help='MPI launcher, e.g. "srun" or "mpirun --oversubscribe"')
+	parser.add_argument('-np', type=int, nargs='+', default=[1], help='numbers of MPI processes')
+	parser.add_argument('-threads', type=int, nargs='+', default=[1], help='numbers of OpenMP threads per process')
+	parser.add_argument('-grid', type=int, nargs='+', default=[48], help='FD grid points per direction')
+	parser.add_argument('-order', type=int, nargs='+', default=[12], help='FD orders')
+	parser.add_argument('-cell', nargs='+', default=['orth'], choices=['orth', 'nonorth'], help='cell types')
+	parser.add_argument('-ncol', default='1,8,32', help='comma separated numbers of columns')
+	parser.add_argument('-reps', type=int, default=10, help='calls per kernel')
+	parser.add_argument('-kernels', default='all', help='comma separated kernels: stencil,lap,vnl,chefsi,aar,mixing,fft,xc')
+	parser.add_argument('-out', default='bench_results.txt', help='file collecting the results')
+	args = parser.parse_args()
+
+	exe = os.path.abspath(args.exe)
+	if not os.path.isfile(exe):
+		print('Benchmark executable %s not found, run "make bench" in src/' % exe)
+		sys.exit(1)
+
+	header = None
+	rows = []
+	for cell in args.cell:
+		for N in args.grid:
+			for order in args.order:
+				for nthreads in args.threads:
+					folder = os.path.join(here, 'runs', '%s_N%d_o%d_t%d' % (cell, N, order, nthreads))
+					if not os.path.isdir(folder):
+						os.makedirs(folder)
+					write_input(folder, N, order, cell, nthreads)
+					for nproc in args.np:
+						cmd = args.mpirun.split() + ['-np', str(nproc), exe, '-name', 'bench',
+							'-ncol', args.ncol, '-reps', str(args.reps), '-kernels', args.kernels]
+						env = dict(os.environ, OMP_NUM_THREADS=str(nthreads))
+						print(' '.join(cmd) + '   (in %s)' % folder)
+						sys.stdout.flush()
+						p = subprocess.Popen(cmd, cwd=folder, env=env, stdout=subprocess.PIPE, universal_newlines=True)
+						out, _ = p.communicate()
+						if p.returncode != 0:
+							print('  failed with exit code %d' % p.returncode)
+						for line in out.splitlines():
+							if line.startswith('# kernel'):
+								header = line
+							elif len(line.split()) == 12 and line.split()[1].isdigit():
+								rows.append(line)
+								print('  ' + line)
+							elif line.startswith('#'):
+								print('  ' + line)
+
+	with open(args.out, 'w') as f:
+		if header is not None:
+			f.write(header + '\n')
+		for line in rows:
+			f.write(line + '\n')
+	print('%d result lines written to %s' % (len(rows), args.out))
+
+
+if __name__ == '__main__':
+	main()